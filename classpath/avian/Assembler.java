@@ -26,12 +26,18 @@ public class Assembler {
 
   public static final int aaload = 0x32;
   public static final int aastore = 0x53;
+  public static final int aconst_null = 0x01;
   public static final int aload = 0x19;
   public static final int aload_0 = 0x2a;
   public static final int aload_1 = 0x2b;
+  public static final int aload_2 = 0x2c;
+  public static final int aload_3 = 0x2d;
   public static final int astore_0 = 0x4b;
+  public static final int astore_3 = 0x4e;
   public static final int anewarray = 0xbd;
   public static final int areturn = 0xb0;
+  public static final int athrow = 0xbf;
+  public static final int checkcast = 0xc0;
   public static final int dload = 0x18;
   public static final int dreturn = 0xaf;
   public static final int dup = 0x59;
@@ -0,0 +1,214 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.nio.channels.SelectableChannel;
+import java.nio.channels.Selector;
+import java.io.IOException;
+import java.util.List;
+import java.util.ArrayList;
+
+/**
+ * A lightweight thread which runs on one of a fixed pool of carrier
+ * threads and is suspended and resumed using continuations, so that
+ * many fibers may wait at once without each needing an OS thread.
+ *
+ * <p>Fibers require a VM built with continuation support.  A fiber
+ * may be resumed on a different carrier than the one it was
+ * suspended on, so it must not park, yield, or do blocking channel
+ * I/O while holding a monitor, and thread locals it sees are those of
+ * whichever carrier it happens to be running on.  Blocking I/O on
+ * SocketChannel and ServerSocketChannel parks the calling fiber until
+ * the channel is ready; other blocking calls (e.g. Object.wait or
+ * stream I/O) block the carrier.
+ */
+public class Fiber {
+  static final int Ready = 0;
+  static final int Running = 1;
+  static final int Parking = 2;
+  static final int Parked = 3;
+  static final int Done = 4;
+
+  final Runnable task;
+  Callback<Object> continuation;
+  int state = Ready;
+  boolean permit;
+  private List<Fiber> joiners;
+
+  private Fiber(Runnable task) {
+    this.task = task;
+  }
+
+  /**
+   * Creates a fiber which will run the specified task and schedules
+   * it to run.
+   */
+  public static Fiber start(Runnable task) {
+    if (task == null) throw new NullPointerException();
+
+    Fiber f = new Fiber(task);
+    FiberScheduler.instance().schedule(f);
+    return f;
+  }
+
+  /**
+   * Returns the fiber running on the calling thread, or null if the
+   * calling thread is not a carrier.
+   */
+  public static Fiber current() {
+    Thread t = Thread.currentThread();
+    return t instanceof FiberScheduler.Carrier
+      ? ((FiberScheduler.Carrier) t).current : null;
+  }
+
+  /**
+   * Suspends the current fiber and lets other ready fibers run before
+   * it continues.
+   */
+  public static void yield() {
+    currentFiber().suspend(Ready);
+  }
+
+  /**
+   * Suspends the current fiber until it is unparked, returning
+   * immediately if it has been unparked since it last parked.
+   */
+  public static void park() {
+    Fiber f = currentFiber();
+    synchronized (f) {
+      if (f.permit) {
+        f.permit = false;
+        return;
+      }
+    }
+    f.suspend(Parking);
+  }
+
+  /**
+   * Makes this fiber ready to run if it is parked, or lets its next
+   * call to park() return immediately otherwise.
+   */
+  public void unpark() {
+    boolean schedule;
+    synchronized (this) {
+      if (state == Parked) {
+        state = Ready;
+        schedule = true;
+      } else {
+        permit = true;
+        schedule = false;
+      }
+    }
+
+    if (schedule) {
+      FiberScheduler.instance().schedule(this);
+    }
+  }
+
+  /**
+   * Waits for this fiber to finish.  When called from a fiber, the
+   * caller is parked rather than blocking its carrier.
+   */
+  public void join() throws InterruptedException {
+    Fiber f = current();
+    if (f == null) {
+      synchronized (this) {
+        while (state != Done) {
+          wait();
+        }
+      }
+    } else {
+      while (true) {
+        synchronized (this) {
+          if (state == Done) {
+            return;
+          }
+
+          if (joiners == null) {
+            joiners = new ArrayList();
+          }
+          joiners.add(f);
+        }
+        park();
+      }
+    }
+  }
+
+  public synchronized boolean isAlive() {
+    return state != Done;
+  }
+
+  /**
+   * Waits until the specified channel is ready for any of the
+   * specified operations (as in SelectionKey.interestOps).  Fibers
+   * park while a shared poller thread watches the channel; other
+   * threads block in a selector of their own.
+   */
+  public static void awaitReady(SelectableChannel channel, int ops)
+    throws IOException
+  {
+    Fiber f = current();
+    if (f == null) {
+      Selector selector = Selector.open();
+      try {
+        channel.register(selector, ops, null);
+        selector.select();
+      } finally {
+        selector.close();
+      }
+    } else {
+      FiberScheduler.instance().poller().await(channel, ops, f);
+      park();
+    }
+  }
+
+  private static Fiber currentFiber() {
+    Fiber f = current();
+    if (f == null) throw new IllegalStateException("not in a fiber");
+    return f;
+  }
+
+  private void suspend(final int newState) {
+    try {
+      Continuations.callWithCurrentContinuation(new CallbackReceiver() {
+          public Object receive(Callback continuation) {
+            Fiber.this.continuation = continuation;
+            FiberScheduler.Carrier.current().suspended(Fiber.this, newState);
+            throw new AssertionError();
+          }
+        });
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  void run() {
+    try {
+      task.run();
+    } catch (Throwable e) {
+      e.printStackTrace();
+    }
+
+    List<Fiber> joiners;
+    synchronized (this) {
+      state = Done;
+      joiners = this.joiners;
+      this.joiners = null;
+      notifyAll();
+    }
+
+    if (joiners != null) {
+      for (Fiber f: joiners) {
+        f.unpark();
+      }
+    }
+  }
+}
@@ -0,0 +1,370 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.nio.channels.SelectableChannel;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.io.IOException;
+import java.util.List;
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.HashMap;
+
+/**
+ * Runs fibers on a fixed pool of carrier threads.  Each carrier has
+ * its own run queue, taking work from its tail and letting idle
+ * carriers steal from its head, and fibers waiting for channel I/O
+ * are watched by a single poller thread.
+ *
+ * <p>The number of carriers is taken from the avian.fiber.carriers
+ * system property, defaulting to four.
+ */
+class FiberScheduler {
+  private static final int DefaultCarrierCount = 4;
+
+  private static FiberScheduler instance;
+
+  private final Carrier[] carriers;
+  private final Object lock = new Object();
+  private int idleCount;
+  private int nextCarrier;
+  private Poller poller;
+
+  private FiberScheduler(int carrierCount) {
+    carriers = new Carrier[carrierCount];
+    for (int i = 0; i < carrierCount; ++i) {
+      carriers[i] = new Carrier(this, i);
+    }
+    for (Carrier c: carriers) {
+      c.start();
+    }
+  }
+
+  public static synchronized FiberScheduler instance() {
+    if (instance == null) {
+      int count = DefaultCarrierCount;
+      String property = System.getProperty("avian.fiber.carriers");
+      if (property != null) {
+        count = Math.max(1, Integer.parseInt(property));
+      }
+      instance = new FiberScheduler(count);
+    }
+    return instance;
+  }
+
+  public synchronized Poller poller() throws IOException {
+    if (poller == null) {
+      poller = new Poller();
+      poller.start();
+    }
+    return poller;
+  }
+
+  public void schedule(Fiber f) {
+    // keep work on the carrier which made it ready if possible, since
+    // that carrier is likely to have the fiber's data in its cache
+    Thread t = Thread.currentThread();
+    Carrier c;
+    if (t instanceof Carrier && ((Carrier) t).scheduler == this) {
+      c = (Carrier) t;
+    } else {
+      synchronized (lock) {
+        c = carriers[nextCarrier];
+        nextCarrier = (nextCarrier + 1) % carriers.length;
+      }
+    }
+
+    c.queue.push(f);
+
+    synchronized (lock) {
+      if (idleCount > 0) {
+        lock.notify();
+      }
+    }
+  }
+
+  private boolean anyQueued() {
+    for (Carrier c: carriers) {
+      if (c.queue.size() > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  private Fiber steal(Carrier thief) {
+    for (int i = 1; i < carriers.length; ++i) {
+      Fiber f = carriers[(thief.index + i) % carriers.length].queue.steal();
+      if (f != null) {
+        return f;
+      }
+    }
+    return null;
+  }
+
+  Fiber next(Carrier c) {
+    while (true) {
+      Fiber f = c.queue.pop();
+      if (f == null) {
+        f = steal(c);
+      }
+      if (f != null) {
+        return f;
+      }
+
+      synchronized (lock) {
+        // schedule() pushes before taking the lock, so anything queued
+        // since we looked is visible here or will notify us
+        if (! anyQueued()) {
+          ++ idleCount;
+          try {
+            lock.wait();
+          } catch (InterruptedException e) {
+            // ignore
+          } finally {
+            -- idleCount;
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * A double-ended run queue.  The owning carrier pushes and pops at
+   * the tail, so it resumes the fiber it most recently made ready,
+   * while thieves take the oldest fiber from the head.
+   */
+  private static class RunQueue {
+    private Fiber[] array = new Fiber[16];
+    private int head;
+    private int size;
+
+    public synchronized int size() {
+      return size;
+    }
+
+    public synchronized void push(Fiber f) {
+      if (size == array.length) {
+        Fiber[] a = new Fiber[array.length * 2];
+        for (int i = 0; i < size; ++i) {
+          a[i] = array[(head + i) % array.length];
+        }
+        array = a;
+        head = 0;
+      }
+      array[(head + size) % array.length] = f;
+      ++ size;
+    }
+
+    public synchronized Fiber pop() {
+      if (size == 0) {
+        return null;
+      }
+      -- size;
+      int i = (head + size) % array.length;
+      Fiber f = array[i];
+      array[i] = null;
+      return f;
+    }
+
+    public synchronized Fiber steal() {
+      if (size == 0) {
+        return null;
+      }
+      Fiber f = array[head];
+      array[head] = null;
+      head = (head + 1) % array.length;
+      -- size;
+      return f;
+    }
+  }
+
+  static class Carrier extends Thread {
+    final FiberScheduler scheduler;
+    final int index;
+    final RunQueue queue = new RunQueue();
+    Fiber current;
+    private Callback<Object> resume;
+
+    public Carrier(FiberScheduler scheduler, int index) {
+      super("fiber carrier " + index);
+      this.scheduler = scheduler;
+      this.index = index;
+      setDaemon(true);
+    }
+
+    public static Carrier current() {
+      return (Carrier) Thread.currentThread();
+    }
+
+    public void run() {
+      while (true) {
+        final Fiber f = scheduler.next(this);
+        synchronized (f) {
+          f.state = Fiber.Running;
+        }
+        current = f;
+
+        try {
+          Continuations.callWithCurrentContinuation(new CallbackReceiver() {
+              public Object receive(Callback continuation) {
+                Carrier.this.resume = continuation;
+
+                Callback c = f.continuation;
+                if (c == null) {
+                  f.run();
+
+                  // the fiber may have been resumed on, and therefore
+                  // finished on, a different carrier than this one
+                  Carrier.current().finished();
+                } else {
+                  f.continuation = null;
+                  c.handleResult(null);
+                }
+                throw new AssertionError();
+              }
+            });
+        } catch (Exception e) {
+          e.printStackTrace();
+        }
+      }
+    }
+
+    private void finished() {
+      current = null;
+      resume.handleResult(null);
+    }
+
+    void suspended(Fiber f, int state) {
+      current = null;
+
+      boolean schedule;
+      synchronized (f) {
+        if (state == Fiber.Parking && f.permit) {
+          f.permit = false;
+          state = Fiber.Ready;
+        }
+        f.state = state == Fiber.Parking ? Fiber.Parked : state;
+        schedule = f.state == Fiber.Ready;
+      }
+
+      if (schedule) {
+        queue.push(f);
+      }
+
+      resume.handleResult(null);
+    }
+  }
+
+  /**
+   * Watches channels for fibers waiting on them, using a selector
+   * owned by a dedicated thread.  Waits are handed to that thread
+   * through a list of requests, since selectors may not be changed
+   * while another thread is selecting.
+   */
+  static class Poller extends Thread {
+    private final Selector selector;
+    private final List<Waiter> requests = new ArrayList();
+    private final Map<SelectableChannel, Registration> registrations
+      = new HashMap();
+
+    public Poller() throws IOException {
+      super("fiber poller");
+      selector = Selector.open();
+      setDaemon(true);
+    }
+
+    public void await(SelectableChannel channel, int ops, Fiber fiber) {
+      synchronized (requests) {
+        requests.add(new Waiter(channel, ops, fiber));
+      }
+      selector.wakeup();
+    }
+
+    public void run() {
+      List<Waiter> pending = new ArrayList();
+      while (true) {
+        synchronized (requests) {
+          pending.addAll(requests);
+          requests.clear();
+        }
+
+        for (Waiter w: pending) {
+          Registration r = registrations.get(w.channel);
+          if (r == null) {
+            r = new Registration();
+            r.key = w.channel.register(selector, 0, r);
+            registrations.put(w.channel, r);
+          }
+          r.waiters.add(w);
+          r.key.interestOps(r.key.interestOps() | w.ops);
+        }
+        pending.clear();
+
+        try {
+          selector.select();
+        } catch (IOException e) {
+          e.printStackTrace();
+          continue;
+        }
+
+        for (SelectionKey key: selector.selectedKeys()) {
+          ((Registration) key.attachment()).wake(key.readyOps());
+        }
+
+        // wake anything waiting on a channel which has been closed so
+        // it can see the channel is closed
+        for (Iterator<Registration> it = registrations.values().iterator();
+             it.hasNext();)
+        {
+          Registration r = it.next();
+          if (! r.key.channel().isOpen()) {
+            r.wake(-1);
+            it.remove();
+          }
+        }
+      }
+    }
+
+    private static class Waiter {
+      public final SelectableChannel channel;
+      public final int ops;
+      public final Fiber fiber;
+
+      public Waiter(SelectableChannel channel, int ops, Fiber fiber) {
+        this.channel = channel;
+        this.ops = ops;
+        this.fiber = fiber;
+      }
+    }
+
+    private static class Registration {
+      public SelectionKey key;
+      public final List<Waiter> waiters = new ArrayList();
+
+      public void wake(int ready) {
+        int interest = 0;
+        for (Iterator<Waiter> it = waiters.iterator(); it.hasNext();) {
+          Waiter w = it.next();
+          if ((w.ops & ready) != 0) {
+            w.fiber.unpark();
+            it.remove();
+          } else {
+            interest |= w.ops;
+          }
+        }
+        key.interestOps(interest);
+      }
+    }
+  }
+}
@@ -18,6 +18,13 @@ public abstract class Machine {
 
   public static native void dumpHeap(String outputFile);
 
+  public static native void dumpClassHistogram(String outputFile);
+
+  public static native void dumpNativeMemory(String outputFile);
+
+  // returns the number of finalizers and cleaners waiting to be run
+  public static native int finalizeQueueLength();
+
   public static Unsafe getUnsafe() {
     return unsafe;
   }
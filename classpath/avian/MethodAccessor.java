@@ -0,0 +1,353 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import static avian.Stream.write1;
+import static avian.Stream.write2;
+import static avian.Stream.write4;
+import static avian.Stream.set4;
+import static avian.Assembler.*;
+
+import avian.ConstantPool.PoolEntry;
+import avian.Assembler.MethodData;
+
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Modifier;
+import java.util.List;
+import java.util.ArrayList;
+import java.io.OutputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+
+/**
+ * Invokes a specific method with its arguments unpacked from an
+ * array.  Method.invoke switches to a generated subclass of this
+ * class once a method has been invoked reflectively often enough,
+ * which saves the VM from boxing, unboxing and marshalling the
+ * arguments according to the method's signature on every call.
+ */
+public abstract class MethodAccessor {
+  private static int nextNumber;
+
+  public abstract Object invoke(Object instance, Object[] arguments)
+    throws InvocationTargetException;
+
+  public static MethodAccessor make(VMMethod method) {
+    int number;
+    synchronized (MethodAccessor.class) {
+      number = nextNumber++;
+    }
+
+    try {
+      return (MethodAccessor) SystemClassLoader.getClass
+        (makeClass(method, "MethodAccessor-" + number)).newInstance();
+    } catch (Exception e) {
+      return null;
+    }
+  }
+
+  private static void unbox(OutputStream out, List<PoolEntry> pool,
+                            String className, String name, String spec)
+    throws IOException
+  {
+    write1(out, checkcast);
+    write2(out, ConstantPool.addClass(pool, className) + 1);
+    write1(out, invokevirtual);
+    write2(out, ConstantPool.addMethodRef(pool, className, name, spec) + 1);
+  }
+
+  private static void box(OutputStream out, List<PoolEntry> pool,
+                          String className, String spec)
+    throws IOException
+  {
+    write1(out, invokestatic);
+    write2(out, ConstantPool.addMethodRef
+           (pool, className, "valueOf", spec) + 1);
+  }
+
+  private static byte[] makeInvokeCode(List<PoolEntry> pool,
+                                       VMMethod method)
+    throws IOException
+  {
+    String className = new String
+      (method.class_.name, 0, method.class_.name.length - 1, false);
+    String name = new String(method.name, 0, method.name.length - 1, false);
+    byte[] spec = method.spec;
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, (method.parameterFootprint & 0xFF) + 3); // max stack
+    write2(out, 4); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    boolean isStatic = (method.flags & Modifier.STATIC) != 0;
+    if (! isStatic) {
+      write1(out, aload_1);
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass(pool, className) + 1);
+    }
+
+    int ai = 0;
+    int si;
+    for (si = 1; spec[si] != ')'; ++si) {
+      write1(out, aload_2);
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addInteger(pool, ai++) + 1);
+      write1(out, aaload);
+
+      switch (spec[si]) {
+      case 'L': {
+        int start = si + 1;
+        while (spec[si] != ';') ++si;
+
+        write1(out, checkcast);
+        write2(out, ConstantPool.addClass
+               (pool, new String(spec, start, si - start, false)) + 1);
+      } break;
+
+      case '[': {
+        int start = si;
+        while (spec[si] == '[') ++si;
+        if (spec[si] == 'L') {
+          while (spec[si] != ';') ++si;
+        }
+
+        write1(out, checkcast);
+        write2(out, ConstantPool.addClass
+               (pool, new String(spec, start, si - start + 1, false)) + 1);
+      } break;
+
+      case 'Z':
+        unbox(out, pool, "java/lang/Boolean", "booleanValue", "()Z");
+        break;
+
+      case 'B':
+        unbox(out, pool, "java/lang/Byte", "byteValue", "()B");
+        break;
+
+      case 'C':
+        unbox(out, pool, "java/lang/Character", "charValue", "()C");
+        break;
+
+      case 'S':
+        unbox(out, pool, "java/lang/Short", "shortValue", "()S");
+        break;
+
+      case 'I':
+        unbox(out, pool, "java/lang/Integer", "intValue", "()I");
+        break;
+
+      case 'F':
+        unbox(out, pool, "java/lang/Float", "floatValue", "()F");
+        break;
+
+      case 'J':
+        unbox(out, pool, "java/lang/Long", "longValue", "()J");
+        break;
+
+      case 'D':
+        unbox(out, pool, "java/lang/Double", "doubleValue", "()D");
+        break;
+
+      default: throw new IllegalArgumentException();
+      }
+    }
+
+    // code offsets are relative to the end of the eight byte header
+    int tryStart = out.size() - 8;
+
+    int reference = ConstantPool.addMethodRef
+      (pool, className, name,
+       new String(spec, 0, spec.length - 1, false)) + 1;
+
+    if (isStatic) {
+      write1(out, invokestatic);
+      write2(out, reference);
+    } else if ((method.class_.flags & Modifier.INTERFACE) != 0) {
+      write1(out, invokeinterface);
+      write2(out, reference);
+      write2(out, 0); // this will be ignored by the VM
+    } else if ((method.flags & Modifier.PRIVATE) != 0
+               || name.equals("<init>"))
+    {
+      write1(out, invokespecial);
+      write2(out, reference);
+    } else {
+      write1(out, invokevirtual);
+      write2(out, reference);
+    }
+
+    int tryEnd = out.size() - 8;
+
+    switch (spec[si + 1]) {
+    case 'L':
+    case '[':
+      break;
+
+    case 'V':
+      write1(out, aconst_null);
+      break;
+
+    case 'Z':
+      box(out, pool, "java/lang/Boolean", "(Z)Ljava/lang/Boolean;");
+      break;
+
+    case 'B':
+      box(out, pool, "java/lang/Byte", "(B)Ljava/lang/Byte;");
+      break;
+
+    case 'C':
+      box(out, pool, "java/lang/Character", "(C)Ljava/lang/Character;");
+      break;
+
+    case 'S':
+      box(out, pool, "java/lang/Short", "(S)Ljava/lang/Short;");
+      break;
+
+    case 'I':
+      box(out, pool, "java/lang/Integer", "(I)Ljava/lang/Integer;");
+      break;
+
+    case 'F':
+      box(out, pool, "java/lang/Float", "(F)Ljava/lang/Float;");
+      break;
+
+    case 'J':
+      box(out, pool, "java/lang/Long", "(J)Ljava/lang/Long;");
+      break;
+
+    case 'D':
+      box(out, pool, "java/lang/Double", "(D)Ljava/lang/Double;");
+      break;
+
+    default: throw new IllegalArgumentException();
+    }
+
+    write1(out, areturn);
+
+    // an argument of the wrong type fails its cast, and a null where a
+    // primitive is expected fails its unboxing call, either of which
+    // Method.invoke reports as an IllegalArgumentException
+    int argumentHandler = out.size() - 8;
+
+    write1(out, astore_3);
+    write1(out, new_);
+    write2(out, ConstantPool.addClass
+           (pool, "java/lang/IllegalArgumentException") + 1);
+    write1(out, dup);
+    write1(out, aload_3);
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, "java/lang/IllegalArgumentException",
+            "<init>", "(Ljava/lang/Throwable;)V") + 1);
+    write1(out, athrow);
+
+    // anything thrown by the method itself is wrapped
+    int handler = out.size() - 8;
+
+    write1(out, astore_3);
+    write1(out, new_);
+    write2(out, ConstantPool.addClass
+           (pool, "java/lang/reflect/InvocationTargetException") + 1);
+    write1(out, dup);
+    write1(out, aload_3);
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, "java/lang/reflect/InvocationTargetException",
+            "<init>", "(Ljava/lang/Throwable;)V") + 1);
+    write1(out, athrow);
+
+    int codeLength = out.size() - 8;
+
+    if (tryStart > 0) {
+      write2(out, 3); // exception handler table length
+
+      write2(out, 0);
+      write2(out, tryStart);
+      write2(out, argumentHandler);
+      write2(out, ConstantPool.addClass
+             (pool, "java/lang/ClassCastException") + 1);
+
+      write2(out, 0);
+      write2(out, tryStart);
+      write2(out, argumentHandler);
+      write2(out, ConstantPool.addClass
+             (pool, "java/lang/NullPointerException") + 1);
+    } else {
+      write2(out, 1); // exception handler table length
+    }
+
+    write2(out, tryStart);
+    write2(out, tryEnd);
+    write2(out, handler);
+    write2(out, 0); // catch everything
+
+    write2(out, 0); // attribute count
+
+    byte[] result = out.toByteArray();
+    set4(result, 4, codeLength);
+
+    return result;
+  }
+
+  private static byte[] makeConstructorCode(List<PoolEntry> pool)
+    throws IOException
+  {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 1); // max stack
+    write2(out, 1); // max locals
+    write4(out, 5); // length
+
+    write1(out, aload_0);
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, "avian/MethodAccessor", "<init>", "()V") + 1);
+    write1(out, return_);
+
+    write2(out, 0); // exception handler table length
+    write2(out, 0); // attribute count
+
+    return out.toByteArray();
+  }
+
+  private static VMClass makeClass(VMMethod method, String name)
+    throws IOException
+  {
+    List<PoolEntry> pool = new ArrayList();
+
+    MethodData[] methodTable = new MethodData[] {
+      new MethodData
+      (ACC_PUBLIC,
+       ConstantPool.addUtf8(pool, "invoke"),
+       ConstantPool.addUtf8
+       (pool, "(Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;"),
+       makeInvokeCode(pool, method)),
+
+      new MethodData
+      (ACC_PUBLIC,
+       ConstantPool.addUtf8(pool, "<init>"),
+       ConstantPool.addUtf8(pool, "()V"),
+       makeConstructorCode(pool))
+    };
+
+    int nameIndex = ConstantPool.addClass(pool, name);
+    int superIndex = ConstantPool.addClass(pool, "avian/MethodAccessor");
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    Assembler.writeClass
+      (out, pool, nameIndex, superIndex, new int[0], methodTable);
+
+    // define the accessor in the method's own loader so that the
+    // classes named in its signature resolve to the same classes
+    byte[] classData = out.toByteArray();
+    return Classes.defineVMClass
+      (method.class_.loader, classData, 0, classData.length);
+  }
+}
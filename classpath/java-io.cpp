@@ -30,6 +30,7 @@
 #  define READ _read
 #  define WRITE _write
 #  define STAT _wstat
+#  define FSTAT _fstat
 #  define STRUCT_STAT struct _stat
 #  define MKDIR(path, mode) _wmkdir(path)
 #  define CHMOD(path, mode) _wchmod(path, mode)
@@ -59,6 +60,7 @@ typedef wchar_t char_t;
 
 #  include <dirent.h>
 #  include <unistd.h>
+#  include <sys/uio.h>
 #  include "sys/mman.h"
 
 #  define ACCESS access
@@ -67,6 +69,7 @@ typedef wchar_t char_t;
 #  define READ read
 #  define WRITE write
 #  define STAT stat
+#  define FSTAT fstat
 #  define STRUCT_STAT struct stat
 #  define MKDIR mkdir
 #  define CHMOD chmod
@@ -132,10 +135,9 @@ doClose(JNIEnv* e, jint fd)
   }
 }
 
-inline int
-doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
+inline jlong
+readResult(JNIEnv* e, jlong r)
 {
-  int r = READ(fd, data, length);
   if (r > 0) {
     return r;
   } else if (r == 0) {
@@ -146,6 +148,12 @@ doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
   }  
 }
 
+inline int
+doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
+{
+  return readResult(e, READ(fd, data, length));
+}
+
 inline void
 doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
 {
@@ -157,6 +165,232 @@ doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
 
 #ifdef PLATFORM_WINDOWS
 
+// Windows has neither positional nor vectored I/O on file descriptors,
+// so we emulate them.  Unlike the POSIX calls, the positional versions
+// are not atomic with respect to other users of the descriptor.
+
+struct iovec {
+  void* iov_base;
+  size_t iov_len;
+};
+
+inline int
+pread(int fd, void* data, unsigned length, jlong position)
+{
+  __int64 current = _lseeki64(fd, 0, SEEK_CUR);
+  if (current == -1 or _lseeki64(fd, position, SEEK_SET) == -1) {
+    return -1;
+  }
+
+  int r = _read(fd, data, length);
+  int error = errno;
+  _lseeki64(fd, current, SEEK_SET);
+  errno = error;
+  return r;
+}
+
+inline int
+pwrite(int fd, const void* data, unsigned length, jlong position)
+{
+  __int64 current = _lseeki64(fd, 0, SEEK_CUR);
+  if (current == -1 or _lseeki64(fd, position, SEEK_SET) == -1) {
+    return -1;
+  }
+
+  int r = _write(fd, data, length);
+  int error = errno;
+  _lseeki64(fd, current, SEEK_SET);
+  errno = error;
+  return r;
+}
+
+inline int
+readv(int fd, const iovec* vector, int count)
+{
+  int total = 0;
+  for (int i = 0; i < count; ++i) {
+    int r = _read(fd, vector[i].iov_base, vector[i].iov_len);
+    if (r < 0) {
+      return total ? total : r;
+    }
+
+    total += r;
+    if (r < static_cast<int>(vector[i].iov_len)) {
+      break;
+    }
+  }
+  return total;
+}
+
+inline int
+writev(int fd, const iovec* vector, int count)
+{
+  int total = 0;
+  for (int i = 0; i < count; ++i) {
+    int r = _write(fd, vector[i].iov_base, vector[i].iov_len);
+    if (r < 0) {
+      return r;
+    }
+
+    total += r;
+    if (r < static_cast<int>(vector[i].iov_len)) {
+      break;
+    }
+  }
+  return total;
+}
+
+#endif // PLATFORM_WINDOWS
+
+const jint BufferSize = 8 * 1024;
+
+const jint MaxVectorLength = 16;
+
+// Reading from or writing to a regular file never blocks indefinitely,
+// so we may transfer data directly to or from an array body inside a
+// critical region.  A pipe, terminal, or socket could hold off garbage
+// collection for as long as it likes that way, so those go through a
+// stack buffer instead.
+inline bool
+regularFile(jint fd)
+{
+  STRUCT_STAT s;
+  return FSTAT(fd, &s) == 0 and S_ISREG(s.st_mode);
+}
+
+// The Java callers check their ranges too, but a bad range reaching
+// the transfers below would overrun the array or the stack buffer, so
+// every native checks again before doing any I/O.
+bool
+inRange(JNIEnv* e, jarray a, jint offset, jint length)
+{
+  if (offset < 0 or length < 0 or offset > e->GetArrayLength(a) - length) {
+    throwNew(e, "java/lang/IndexOutOfBoundsException", 0);
+    return false;
+  }
+  return true;
+}
+
+int
+readToArray(JNIEnv* e, jint fd, jbyteArray b, jint offset, jint length)
+{
+  if (not inRange(e, b, offset, length)) {
+    return 0;
+  }
+
+  if (regularFile(fd)) {
+    jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+
+    int r = READ(fd, data + offset, length);
+    int error = errno;
+
+    e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+    errno = error;
+    return readResult(e, r);
+  } else {
+    jbyte buffer[BufferSize];
+    int r = doRead(e, fd, buffer, length < BufferSize ? length : BufferSize);
+    if (r > 0) {
+      e->SetByteArrayRegion(b, offset, r, buffer);
+    }
+    return r;
+  }
+}
+
+void
+writeFromArray(JNIEnv* e, jint fd, jbyteArray b, jint offset, jint length)
+{
+  if (not inRange(e, b, offset, length)) {
+    return;
+  }
+
+  if (regularFile(fd)) {
+    jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+
+    int r = WRITE(fd, data + offset, length);
+    int error = errno;
+
+    e->ReleasePrimitiveArrayCritical(b, data, JNI_ABORT);
+
+    if (r != length) {
+      errno = error;
+      throwNewErrno(e, "java/io/IOException");
+    }
+  } else {
+    jbyte buffer[BufferSize];
+    while (length) {
+      jint n = length < BufferSize ? length : BufferSize;
+
+      e->GetByteArrayRegion(b, offset, n, buffer);
+      if (e->ExceptionCheck()) return;
+
+      doWrite(e, fd, buffer, n);
+      if (e->ExceptionCheck()) return;
+
+      offset += n;
+      length -= n;
+    }
+  }
+}
+
+// Fetches up to MaxVectorLength arrays from the specified range of an
+// array of byte arrays, returning how many were fetched, or -1 if the
+// range is out of bounds or one of the arrays was null.
+jint
+getArrays(JNIEnv* e, jobjectArray buffers, jint offset, jint length,
+          jbyteArray* arrays)
+{
+  if (not inRange(e, buffers, offset, length)) {
+    return -1;
+  }
+
+  if (length > MaxVectorLength) {
+    length = MaxVectorLength;
+  }
+
+  for (jint i = 0; i < length; ++i) {
+    arrays[i] = static_cast<jbyteArray>
+      (e->GetObjectArrayElement(buffers, offset + i));
+
+    if (arrays[i] == 0) {
+      throwNew(e, "java/lang/NullPointerException", 0);
+      return -1;
+    }
+  }
+
+  return length;
+}
+
+// Transfers into or out of several arrays with a single system call,
+// holding all of them in critical regions for its duration.
+jlong
+transferVector(JNIEnv* e, jint fd, jbyteArray* arrays, jint count,
+               bool write)
+{
+  iovec vector[MaxVectorLength];
+  for (jint i = 0; i < count; ++i) {
+    vector[i].iov_len = e->GetArrayLength(arrays[i]);
+  }
+
+  for (jint i = 0; i < count; ++i) {
+    vector[i].iov_base = e->GetPrimitiveArrayCritical(arrays[i], 0);
+  }
+
+  jlong r = write ? writev(fd, vector, count) : readv(fd, vector, count);
+  int error = errno;
+
+  for (jint i = count - 1; i >= 0; --i) {
+    e->ReleasePrimitiveArrayCritical
+      (arrays[i], vector[i].iov_base, write ? JNI_ABORT : 0);
+  }
+
+  errno = error;
+  return r;
+}
+
+#ifdef PLATFORM_WINDOWS
+
 class Mapping {
  public:
   Mapping(uint8_t* start, size_t length, HANDLE mapping, HANDLE file):
@@ -711,19 +945,54 @@ extern "C" JNIEXPORT jint JNICALL
 Java_java_io_FileInputStream_read__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return 0;    
+  return readToArray(e, fd, b, offset, length);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_io_FileInputStream_read__IJ_3BII
+(JNIEnv* e, jclass, jint fd, jlong position, jbyteArray b, jint offset,
+ jint length)
+{
+  if (not inRange(e, b, offset, length)) {
+    return 0;
   }
 
-  int r = doRead(e, fd, data, length);
+  // only seekable descriptors support positional reads, and those
+  // never block indefinitely
+  jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
 
-  e->SetByteArrayRegion(b, offset, length, data);
+  int r = pread(fd, data + offset, length, position);
+  int error = errno;
 
-  free(data);
+  e->ReleasePrimitiveArrayCritical(b, data, 0);
 
-  return r;
+  errno = error;
+  return readResult(e, r);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_io_FileInputStream_read__I_3_3BII
+(JNIEnv* e, jclass, jint fd, jobjectArray buffers, jint offset, jint length)
+{
+  jbyteArray arrays[MaxVectorLength];
+  jint count = getArrays(e, buffers, offset, length, arrays);
+  if (count < 0) {
+    return 0;
+  }
+
+  if (regularFile(fd)) {
+    return readResult(e, transferVector(e, fd, arrays, count, false));
+  } else {
+    // a short read is always allowed, so just fill the first array
+    // with room in it
+    for (jint i = 0; i < count; ++i) {
+      jint size = e->GetArrayLength(arrays[i]);
+      if (size) {
+        return readToArray(e, fd, arrays[i], 0, size);
+      }
+    }
+    return 0;
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -758,19 +1027,58 @@ extern "C" JNIEXPORT void JNICALL
 Java_java_io_FileOutputStream_write__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+  writeFromArray(e, fd, b, offset, length);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_io_FileOutputStream_write__IJ_3BII
+(JNIEnv* e, jclass, jint fd, jlong position, jbyteArray b, jint offset,
+ jint length)
+{
+  if (not inRange(e, b, offset, length)) {
+    return;
   }
 
-  e->GetByteArrayRegion(b, offset, length, data);
+  jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
 
-  if (not e->ExceptionCheck()) {
-    doWrite(e, fd, data, length);
+  int r = pwrite(fd, data + offset, length, position);
+  int error = errno;
+
+  e->ReleasePrimitiveArrayCritical(b, data, JNI_ABORT);
+
+  if (r != length) {
+    errno = error;
+    throwNewErrno(e, "java/io/IOException");
+  }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_io_FileOutputStream_write__I_3_3BII
+(JNIEnv* e, jclass, jint fd, jobjectArray buffers, jint offset, jint length)
+{
+  jbyteArray arrays[MaxVectorLength];
+  jint count = getArrays(e, buffers, offset, length, arrays);
+  if (count < 0) {
+    return 0;
+  }
+
+  if (regularFile(fd)) {
+    jlong total = 0;
+    for (jint i = 0; i < count; ++i) {
+      total += e->GetArrayLength(arrays[i]);
+    }
+
+    if (transferVector(e, fd, arrays, count, true) != total) {
+      throwNewErrno(e, "java/io/IOException");
+    }
+  } else {
+    for (jint i = 0; i < count; ++i) {
+      writeFromArray(e, fd, arrays[i], 0, e->GetArrayLength(arrays[i]));
+      if (e->ExceptionCheck()) break;
+    }
   }
 
-  free(data);
+  return count;
 }
 
 extern "C" JNIEXPORT void JNICALL
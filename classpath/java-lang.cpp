@@ -57,9 +57,25 @@
 #  include "sys/sysctl.h"
 #  include "sys/utsname.h"
 #  include "sys/wait.h"
+#  if ((defined __linux__) && (! defined __ANDROID__)) \
+  || ((defined __APPLE__) && (! defined AVIAN_IOS))
+#    include <spawn.h>
+#    define AVIAN_USE_POSIX_SPAWN
+#  endif
 
 #endif // not PLATFORM_WINDOWS
 
+#ifdef AVIAN_IOS
+namespace {
+  const char* environ[] = { 0 };
+}
+#elif defined __APPLE__
+#  include <crt_externs.h>
+#  define environ (*_NSGetEnviron())
+#else
+extern char** environ;
+#endif
+
 namespace {
 #ifdef PLATFORM_WINDOWS
   char* getErrorStr(DWORD err){
@@ -116,12 +132,59 @@ namespace {
     fd = -1;
   }
   
+#ifndef AVIAN_USE_POSIX_SPAWN
   void close(int p[2])
   {
     ::close(p[0]);
     ::close(p[1]);
   }
+#endif
   
+#ifdef AVIAN_USE_POSIX_SPAWN
+  // Starts argv[0] with its stdout, stdin and stderr connected to the
+  // given pipes, returning zero or an error number.
+  int spawn(pid_t* pid, char** argv, int in[2], int out[2], int err[2])
+  {
+    posix_spawn_file_actions_t actions;
+    int r = posix_spawn_file_actions_init(&actions);
+    if (r != 0) return r;
+
+    posix_spawnattr_t attributes;
+    r = posix_spawnattr_init(&attributes);
+    if (r != 0) {
+      posix_spawn_file_actions_destroy(&actions);
+      return r;
+    }
+
+#ifdef POSIX_SPAWN_USEVFORK
+    // older versions of glibc only avoid copying the address space
+    // when asked to
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_USEVFORK);
+#endif
+
+    if ((r = posix_spawn_file_actions_adddup2(&actions, in[1], 1)) == 0
+        and (r = posix_spawn_file_actions_adddup2(&actions, out[0], 0)) == 0
+        and (r = posix_spawn_file_actions_adddup2(&actions, err[1], 2)) == 0)
+    {
+      int* pipes[] = { in, out, err };
+      for (unsigned i = 0; r == 0 and i < 3; ++i) {
+        for (unsigned j = 0; r == 0 and j < 2; ++j) {
+          r = posix_spawn_file_actions_addclose(&actions, pipes[i][j]);
+        }
+      }
+    }
+
+    if (r == 0) {
+      r = posix_spawnp(pid, argv[0], &actions, &attributes, argv, environ);
+    }
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    return r;
+  }
+#endif
+
   void clean(JNIEnv* e, jobjectArray command, char** p)
   {
     int i = 0;
@@ -381,7 +444,6 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   int in[] = { -1, -1 };
   int out[] = { -1, -1 };
   int err[] = { -1, -1 };
-  int msg[] = { -1, -1 };
   
   makePipe(e, in);
   if(e->ExceptionCheck()) return;
@@ -395,6 +457,27 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   if(e->ExceptionCheck()) return;
   jlong errDescriptor = static_cast<jlong>(err[0]);
   e->SetLongArrayRegion(process, 4, 1, &errDescriptor);
+#ifdef AVIAN_USE_POSIX_SPAWN
+  // Unlike fork, posix_spawn doesn't copy the parent's page tables, so
+  // its cost doesn't grow with the heap, and it reports exec failures
+  // directly, so we don't need a pipe for them.
+  pid_t pid;
+  int r = spawn(&pid, argv, in, out, err);
+  if (r != 0) {
+    errno = r;
+    throwNewErrno(e, "java/io/IOException");
+    return;
+  }
+
+  jlong JNIPid = static_cast<jlong>(pid);
+  e->SetLongArrayRegion(process, 0, 1, &JNIPid);
+
+  safeClose(in[1]);
+  safeClose(out[0]);
+  safeClose(err[1]);
+#else
+  int msg[] = { -1, -1 };
+
   makePipe(e, msg);
   if(e->ExceptionCheck()) return;
   if(fcntl(msg[1], F_SETFD, FD_CLOEXEC) != 0) {
@@ -457,6 +540,7 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   }
   
   safeClose(msg[0]);
+#endif
   clean(e, command, argv);
   
   fcntl(in[0], F_SETFD, FD_CLOEXEC);
@@ -645,16 +729,6 @@ Java_java_lang_System_getProperty(JNIEnv* e, jclass, jstring name,
 // System.getEnvironment() implementation
 // TODO: For Win32, replace usage of deprecated _environ and add Unicode
 // support (neither of which is likely to be of great importance).
-#ifdef AVIAN_IOS
-namespace {
-  const char* environ[] = { 0 };
-}
-#elif defined __APPLE__
-#  include <crt_externs.h>
-#  define environ (*_NSGetEnviron())
-#else
-extern char** environ;
-#endif
 extern "C" JNIEXPORT jobjectArray JNICALL
 Java_java_lang_System_getEnvironment(JNIEnv* env, jclass) {
   int length;
@@ -691,6 +765,29 @@ Java_java_lang_System_currentTimeMillis(JNIEnv*, jclass)
 #endif
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_lang_System_nanoTime(JNIEnv*, jclass)
+{
+#ifdef PLATFORM_WINDOWS
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return ((counter.QuadPart / frequency.QuadPart) * 1000000000LL)
+    + (((counter.QuadPart % frequency.QuadPart) * 1000000000LL)
+       / frequency.QuadPart);
+#elif defined CLOCK_MONOTONIC
+  timespec ts = { 0, 0 };
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (static_cast<jlong>(ts.tv_sec) * 1000000000LL) + ts.tv_nsec;
+#else
+  timeval tv = { 0, 0 };
+  gettimeofday(&tv, 0);
+  return (static_cast<jlong>(tv.tv_sec) * 1000000000LL) +
+    (static_cast<jlong>(tv.tv_usec) * 1000);
+#endif
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_java_lang_System_doMapLibraryName(JNIEnv* e, jclass, jstring name)
 {
@@ -19,6 +19,8 @@
 #ifdef PLATFORM_WINDOWS
 #  include <winsock2.h>
 #  include <ws2tcpip.h>
+#  include <mswsock.h>
+#  include <io.h>
 #  include <errno.h>
 #  ifdef _MSC_VER
 #    define snprintf sprintf_s
@@ -31,11 +33,26 @@
 #  include <errno.h>
 #  include <netdb.h>
 #  include <sys/select.h>
+#  ifdef __linux__
+#    include <sys/epoll.h>
+#    define AVIAN_USE_EPOLL
+#  elif (defined __APPLE__) || (defined __FreeBSD__)
+#    include <sys/event.h>
+#    define AVIAN_USE_KQUEUE
+#  endif
 #  include <arpa/inet.h>
 #  include <netinet/in.h>
 #  include <netinet/ip.h>
 #  include <netinet/tcp.h>
 #  include <sys/socket.h>
+#  include <sys/uio.h>
+#  include <sys/mman.h>
+#  ifdef __linux__
+#    include <sys/sendfile.h>
+#  endif
+#  if (defined __linux__) && (! defined __ANDROID__)
+#    define AVIAN_USE_MMSG
+#  endif
 #endif
 
 #define java_nio_channels_SelectionKey_OP_READ 1L
@@ -382,6 +399,328 @@ makeSocket(JNIEnv* e, int type = SOCK_STREAM, int protocol = IPPROTO_TCP)
   return s;
 }
 
+inline uint8_t*
+directAddress(JNIEnv* e, jobject buffer)
+{
+  return static_cast<uint8_t*>(e->GetDirectBufferAddress(buffer));
+}
+
+// The most buffers we pass to a single scattering read or gathering
+// write; callers handle partial transfers anyway.
+const int MaxVectorLength = 16;
+
+#ifdef PLATFORM_WINDOWS
+typedef WSABUF IoVector;
+
+inline void
+setVector(IoVector* v, uint8_t* start, unsigned length)
+{
+  v->buf = reinterpret_cast<char*>(start);
+  v->len = length;
+}
+
+long
+doReadVector(int fd, IoVector* vector, int count)
+{
+  DWORD read;
+  DWORD flags = 0;
+  if (WSARecv(fd, vector, count, &read, &flags, 0, 0) == 0) {
+    return read;
+  } else {
+    return -1;
+  }
+}
+
+long
+doWriteVector(int fd, IoVector* vector, int count)
+{
+  DWORD written;
+  if (WSASend(fd, vector, count, &written, 0, 0, 0) == 0) {
+    return written;
+  } else {
+    return -1;
+  }
+}
+#else
+typedef iovec IoVector;
+
+inline void
+setVector(IoVector* v, uint8_t* start, unsigned length)
+{
+  v->iov_base = start;
+  v->iov_len = length;
+}
+
+long
+doReadVector(int fd, IoVector* vector, int count)
+{
+  return readv(fd, vector, count);
+}
+
+long
+doWriteVector(int fd, IoVector* vector, int count)
+{
+  return writev(fd, vector, count);
+}
+#endif
+
+// Fills in an I/O vector from up to MaxVectorLength direct buffers,
+// using the (position, remaining) pairs the caller has computed for
+// each.  Returns the number of entries used, or -1 on error.
+int
+makeVector(JNIEnv* e, jobjectArray buffers, jint offset, jint length,
+           jintArray ranges, IoVector* vector)
+{
+  if (length > MaxVectorLength) {
+    length = MaxVectorLength;
+  }
+
+  jint r[MaxVectorLength * 2];
+  e->GetIntArrayRegion(ranges, 0, length * 2, r);
+  if (e->ExceptionCheck()) return -1;
+
+  for (jint i = 0; i < length; ++i) {
+    jobject buffer = e->GetObjectArrayElement(buffers, offset + i);
+    if (e->ExceptionCheck()) return -1;
+
+    setVector(vector + i, directAddress(e, buffer) + r[i * 2], r[(i * 2) + 1]);
+
+    e->DeleteLocalRef(buffer);
+  }
+
+  return length;
+}
+
+// The most datagrams we send or receive in a single batch; callers
+// handle partially filled batches anyway.
+const int MaxBatchLength = 64;
+
+// One datagram of a batch.  Heap arrays are staged through a scratch
+// block since the transfer may block, while direct buffers are used in
+// place.
+struct Datagram {
+  uint8_t* start;
+  jint length;
+  bool staged;
+};
+
+// Fills in up to MaxBatchLength datagrams from parallel arrays of
+// direct buffers and heap arrays, exactly one of which is non-null at
+// each index, using the (offset, length) pairs the caller has computed
+// for each.  If copyIn is true, staged datagrams are initialized from
+// their arrays.  Returns the number of datagrams used, or -1 on error,
+// in which case *scratch need not be freed.
+int
+makeBatch(JNIEnv* e, jobjectArray buffers, jobjectArray arrays, jint length,
+          jintArray ranges, bool copyIn, Datagram* batch, uint8_t** scratch)
+{
+  if (length > MaxBatchLength) {
+    length = MaxBatchLength;
+  }
+
+  jint r[MaxBatchLength * 2];
+  e->GetIntArrayRegion(ranges, 0, length * 2, r);
+  if (e->ExceptionCheck()) return -1;
+
+  unsigned scratchSize = 0;
+  for (jint i = 0; i < length; ++i) {
+    jobject buffer = e->GetObjectArrayElement(buffers, i);
+    if (e->ExceptionCheck()) return -1;
+
+    batch[i].length = r[(i * 2) + 1];
+    batch[i].staged = (buffer == 0);
+    if (buffer) {
+      batch[i].start = directAddress(e, buffer) + r[i * 2];
+      e->DeleteLocalRef(buffer);
+    } else {
+      scratchSize += batch[i].length;
+    }
+  }
+
+  *scratch = 0;
+  if (scratchSize) {
+    *scratch = static_cast<uint8_t*>(allocate(e, scratchSize));
+    if (*scratch == 0) return -1;
+  }
+
+  uint8_t* p = *scratch;
+  for (jint i = 0; i < length; ++i) {
+    if (batch[i].staged) {
+      batch[i].start = p;
+      p += batch[i].length;
+
+      if (copyIn) {
+        jbyteArray array = static_cast<jbyteArray>
+          (e->GetObjectArrayElement(arrays, i));
+        if (array) {
+          e->GetByteArrayRegion(array, r[i * 2], batch[i].length,
+                                reinterpret_cast<jbyte*>(batch[i].start));
+          e->DeleteLocalRef(array);
+        }
+
+        if (e->ExceptionCheck()) {
+          free(*scratch);
+          return -1;
+        }
+      }
+    }
+  }
+
+  return length;
+}
+
+// Copies the first count received datagrams that were staged back to
+// their arrays and releases the scratch block.
+void
+finishBatch(JNIEnv* e, jobjectArray arrays, jintArray ranges,
+            Datagram* batch, int count, jint* sizes, uint8_t* scratch)
+{
+  if (scratch == 0) return;
+
+  for (int i = 0; i < count and not e->ExceptionCheck(); ++i) {
+    if (batch[i].staged and sizes[i * 3] > 0) {
+      jint offset;
+      e->GetIntArrayRegion(ranges, i * 2, 1, &offset);
+
+      jbyteArray array = static_cast<jbyteArray>
+        (e->GetObjectArrayElement(arrays, i));
+      if (array) {
+        e->SetByteArrayRegion(array, offset, sizes[i * 3],
+                              reinterpret_cast<jbyte*>(batch[i].start));
+        e->DeleteLocalRef(array);
+      }
+    }
+  }
+
+  free(scratch);
+}
+
+inline void
+setSender(jint* result, sockaddr_in* address)
+{
+  result[1] = ntohl(address->sin_addr.s_addr);
+  result[2] = ntohs(address->sin_port);
+}
+
+#ifdef AVIAN_USE_MMSG
+// Receives up to count datagrams with a single system call, waiting
+// only for the first (and only if the socket is blocking).  Each
+// datagram's size, sender address, and sender port are stored as
+// triples in results.  Returns the number received, or -1 on error.
+int
+doReceiveBatch(int fd, Datagram* batch, int count, jint* results)
+{
+  mmsghdr messages[MaxBatchLength];
+  iovec vector[MaxBatchLength];
+  sockaddr_in addresses[MaxBatchLength];
+
+  memset(messages, 0, count * sizeof(mmsghdr));
+  for (int i = 0; i < count; ++i) {
+    setVector(vector + i, batch[i].start, batch[i].length);
+
+    msghdr* h = &(messages[i].msg_hdr);
+    h->msg_name = addresses + i;
+    h->msg_namelen = sizeof(sockaddr_in);
+    h->msg_iov = vector + i;
+    h->msg_iovlen = 1;
+  }
+
+  int r = recvmmsg(fd, messages, count, MSG_WAITFORONE, 0);
+
+  for (int i = 0; i < r; ++i) {
+    results[i * 3] = messages[i].msg_len;
+    setSender(results + (i * 3), addresses + i);
+  }
+
+  return r;
+}
+
+// Sends up to count datagrams to the socket's peer with a single
+// system call.  Returns the number sent, or -1 on error.
+int
+doSendBatch(int fd, Datagram* batch, int count)
+{
+  mmsghdr messages[MaxBatchLength];
+  iovec vector[MaxBatchLength];
+
+  memset(messages, 0, count * sizeof(mmsghdr));
+  for (int i = 0; i < count; ++i) {
+    setVector(vector + i, batch[i].start, batch[i].length);
+
+    messages[i].msg_hdr.msg_iov = vector + i;
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  return sendmmsg(fd, messages, count, 0);
+}
+#else
+// Returns true if a datagram can be received from the socket without
+// blocking.
+bool
+datagramPending(int fd)
+{
+#ifdef PLATFORM_WINDOWS
+  u_long available;
+  return ioctlsocket(fd, FIONREAD, &available) == 0 and available > 0;
+#else
+  char c;
+  return recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) >= 0;
+#endif
+}
+
+int
+doReceiveBatch(int fd, Datagram* batch, int count, jint* results)
+{
+  // after the first datagram, only take what has already arrived
+  for (int i = 0; i < count; ++i) {
+    if (i > 0 and not datagramPending(fd)) {
+      return i;
+    }
+
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int r = recvfrom
+      (fd, reinterpret_cast<char*>(batch[i].start), batch[i].length, 0,
+       reinterpret_cast<sockaddr*>(&address), &length);
+
+    if (r < 0) {
+      return i ? i : -1;
+    }
+
+    results[i * 3] = r;
+    setSender(results + (i * 3), &address);
+  }
+
+  return count;
+}
+
+int
+doSendBatch(int fd, Datagram* batch, int count)
+{
+  for (int i = 0; i < count; ++i) {
+    if (doWrite(fd, batch[i].start, batch[i].length) < 0) {
+      return i ? i : -1;
+    }
+  }
+
+  return count;
+}
+#endif
+
+// These match the values of FileChannel.MapMode.
+const jint MapReadOnly = 0;
+const jint MapReadWrite = 1;
+
+void
+unmapRegion(void* start, jlong length UNUSED)
+{
+#ifdef PLATFORM_WINDOWS
+  UnmapViewOfFile(start);
+#else
+  munmap(start, length);
+#endif
+}
+
 } // namespace <anonymous>
 
 
@@ -655,84 +994,550 @@ Java_java_nio_channels_DatagramChannel_write(JNIEnv* e,
     (e, c, socket, buffer, offset, length, blocking);
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketChannel_natThrowWriteError(JNIEnv *e,
-							jclass,
-							jint socket)
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketChannel_natReadDirect(JNIEnv *e,
+                                                   jclass,
+                                                   jint socket,
+                                                   jobject buffer,
+                                                   jint offset,
+                                                   jint length)
 {
-  int error;
-  socklen_t size = sizeof(int);
-  int r = getsockopt(socket, SOL_SOCKET, SO_ERROR,
-		     reinterpret_cast<char*>(&error), &size);
-  if (r != 0 or size != sizeof(int)) {
-    throwIOException(e);
-  } else if (error != 0) {
-    throwIOException(e, socketErrorString(e, error));
+  // direct buffers never move, so we can read straight into them
+  // whether or not the socket is blocking
+  int r = ::doRead(socket, directAddress(e, buffer) + offset, length);
+
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  } else if (r == 0) {
+    return -1;
   }
+  return r;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketChannel_natCloseSocket(JNIEnv *,
-						    jclass,
-						    jint socket)
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketChannel_natWriteDirect(JNIEnv *e,
+                                                    jclass,
+                                                    jint socket,
+                                                    jobject buffer,
+                                                    jint offset,
+                                                    jint length)
 {
-  doClose(socket);
-}
+  int r = ::doWrite(socket, directAddress(e, buffer) + offset, length);
 
-namespace {
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  }
+  return r;
+}
 
-class Pipe {
- public:
-#ifdef PLATFORM_WINDOWS
-  // The Windows socket API only accepts socket file descriptors, not
-  // pipe descriptors or others.  Thus, to implement
-  // Selector.wakeup(), we make a socket connection via the loopback
-  // interface and use it as a pipe.
-  Pipe(JNIEnv* e): connected_(false), listener_(-1), reader_(-1), writer_(-1) {
-    sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_port = 0;
-    address.sin_addr.s_addr = inet_addr("127.0.0.1"); //INADDR_LOOPBACK;
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketChannel_natReadVector(JNIEnv *e,
+                                                   jclass,
+                                                   jint socket,
+                                                   jobjectArray buffers,
+                                                   jint offset,
+                                                   jint length,
+                                                   jintArray ranges)
+{
+  IoVector vector[MaxVectorLength];
+  int count = makeVector(e, buffers, offset, length, ranges, vector);
+  if (count < 0) return 0;
 
-    listener_ = makeSocket(e);
-    if (e->ExceptionCheck()) return;
+  long r = ::doReadVector(socket, vector, count);
 
-    setBlocking(e, listener_, false);
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  } else if (r == 0) {
+    return -1;
+  }
+  return r;
+}
 
-    ::doBind(e, listener_, &address);
-    if (e->ExceptionCheck()) return;
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketChannel_natWriteVector(JNIEnv *e,
+                                                    jclass,
+                                                    jint socket,
+                                                    jobjectArray buffers,
+                                                    jint offset,
+                                                    jint length,
+                                                    jintArray ranges)
+{
+  IoVector vector[MaxVectorLength];
+  int count = makeVector(e, buffers, offset, length, ranges, vector);
+  if (count < 0) return 0;
 
-    ::doListen(e, listener_);
-    if (e->ExceptionCheck()) return;
+  long r = ::doWriteVector(socket, vector, count);
 
-    socklen_t length = sizeof(sockaddr_in);
-    int r = getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
-                        &length);
-    if (r) {
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
       throwIOException(e);
-      return;
     }
+  }
+  return r;
+}
 
-    writer_ = makeSocket(e);
-    if (e->ExceptionCheck()) return;
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_writeDirect(JNIEnv* e,
+                                                   jclass c,
+                                                   jint socket,
+                                                   jobject buffer,
+                                                   jint offset,
+                                                   jint length)
+{
+  return Java_java_nio_channels_SocketChannel_natWriteDirect
+    (e, c, socket, buffer, offset, length);
+}
 
-    setBlocking(e, writer_, true);
-    connected_ = ::doConnect(e, writer_, &address);
-  }
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_receiveDirect(JNIEnv* e,
+                                                     jclass,
+                                                     jint socket,
+                                                     jobject buffer,
+                                                     jint offset,
+                                                     jint length,
+                                                     jintArray address)
+{
+  int32_t host;
+  int32_t port;
+  int r = ::doRecv
+    (socket, directAddress(e, buffer) + offset, length, &host, &port);
 
-  void dispose() {
-    if (listener_ >= 0) ::doClose(listener_);
-    if (reader_ >= 0) ::doClose(reader_);
-    if (writer_ >= 0) ::doClose(writer_);
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  } else if (r == 0) {
+    return -1;
+  } else {
+    jint jhost = host; e->SetIntArrayRegion(address, 0, 1, &jhost);
+    jint jport = port; e->SetIntArrayRegion(address, 1, 1, &jport);
   }
 
-  bool connected() {
-    return connected_;
-  }
+  return r;
+}
 
-  void setConnected(bool v) {
-    connected_ = v;
-  }
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_receiveBatch(JNIEnv* e,
+                                                    jclass,
+                                                    jint socket,
+                                                    jobjectArray buffers,
+                                                    jobjectArray arrays,
+                                                    jint length,
+                                                    jintArray ranges,
+                                                    jintArray results)
+{
+  Datagram batch[MaxBatchLength];
+  uint8_t* scratch;
+  int count = makeBatch
+    (e, buffers, arrays, length, ranges, false, batch, &scratch);
+  if (count < 0) return 0;
+
+  jint r[MaxBatchLength * 3];
+  int received = ::doReceiveBatch(socket, batch, count, r);
+
+  if (received < 0) {
+    if (eagain()) {
+      received = 0;
+    } else {
+      throwIOException(e);
+    }
+  }
+
+  finishBatch(e, arrays, ranges, batch, received, r, scratch);
+
+  if (received > 0) {
+    e->SetIntArrayRegion(results, 0, received * 3, r);
+  }
+
+  return received < 0 ? 0 : received;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_writeBatch(JNIEnv* e,
+                                                  jclass,
+                                                  jint socket,
+                                                  jobjectArray buffers,
+                                                  jobjectArray arrays,
+                                                  jint length,
+                                                  jintArray ranges)
+{
+  Datagram batch[MaxBatchLength];
+  uint8_t* scratch;
+  int count = makeBatch
+    (e, buffers, arrays, length, ranges, true, batch, &scratch);
+  if (count < 0) return 0;
+
+  int sent = ::doSendBatch(socket, batch, count);
+
+  if (sent < 0) {
+    if (eagain()) {
+      sent = 0;
+    } else {
+      throwIOException(e);
+    }
+  }
+
+  if (scratch) {
+    free(scratch);
+  }
+
+  return sent < 0 ? 0 : sent;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_FileChannel_natSize(JNIEnv* e, jclass, jint fd)
+{
+#ifdef PLATFORM_WINDOWS
+  struct _stati64 s;
+  int r = _fstati64(fd, &s);
+#else
+  struct stat s;
+  int r = fstat(fd, &s);
+#endif
+  if (r != 0) {
+    throwIOException(e);
+    return 0;
+  }
+  return s.st_size;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_java_nio_channels_FileChannel_natMap(JNIEnv* e, jclass, jint fd,
+                                          jint mode, jlong position,
+                                          jint size)
+{
+  jclass c = e->FindClass("java/nio/MappedByteBuffer");
+  if (c == 0) return 0;
+
+  jmethodID constructor = e->GetMethodID(c, "<init>", "(JJIZ)V");
+  if (constructor == 0) return 0;
+
+  jboolean readOnly = (mode == MapReadOnly);
+
+  if (size == 0) {
+    // nothing to map
+    return e->NewObject(c, constructor, static_cast<jlong>(0),
+                        static_cast<jlong>(0), 0, readOnly);
+  }
+
+  // mappings must start on a boundary of the system's granularity, so
+  // we map from the nearest one below the requested position and
+  // offset the buffer's address accordingly
+#ifdef PLATFORM_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  jlong granularity = info.dwAllocationGranularity;
+#else
+  jlong granularity = sysconf(_SC_PAGESIZE);
+#endif
+  jlong start = position - (position % granularity);
+  jlong length = (position - start) + size;
+
+#ifdef PLATFORM_WINDOWS
+  DWORD protect;
+  DWORD access;
+  switch (mode) {
+  case MapReadOnly:
+    protect = PAGE_READONLY;
+    access = FILE_MAP_READ;
+    break;
+
+  case MapReadWrite:
+    protect = PAGE_READWRITE;
+    access = FILE_MAP_WRITE;
+    break;
+
+  default:
+    protect = PAGE_WRITECOPY;
+    access = FILE_MAP_COPY;
+    break;
+  }
+
+  jlong end = position + size;
+  HANDLE mapping = CreateFileMapping
+    (reinterpret_cast<HANDLE>(_get_osfhandle(fd)), 0, protect,
+     static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), 0);
+  if (mapping == 0) {
+    throwNew(e, "java/io/IOException", "%d", GetLastError());
+    return 0;
+  }
+
+  void* data = MapViewOfFile
+    (mapping, access, static_cast<DWORD>(start >> 32),
+     static_cast<DWORD>(start), length);
+
+  // the view keeps the mapping object alive
+  CloseHandle(mapping);
+
+  if (data == 0) {
+    throwNew(e, "java/io/IOException", "%d", GetLastError());
+    return 0;
+  }
+#else
+  int protect;
+  int flags;
+  switch (mode) {
+  case MapReadOnly:
+    protect = PROT_READ;
+    flags = MAP_SHARED;
+    break;
+
+  case MapReadWrite:
+    protect = PROT_READ | PROT_WRITE;
+    flags = MAP_SHARED;
+    break;
+
+  default:
+    protect = PROT_READ | PROT_WRITE;
+    flags = MAP_PRIVATE;
+    break;
+  }
+
+  if (mode == MapReadWrite) {
+    // as with other implementations, mapping beyond the end of a
+    // writable file extends it
+    struct stat s;
+    if (fstat(fd, &s) != 0
+        or (s.st_size < position + size
+            and ftruncate(fd, position + size) != 0))
+    {
+      throwIOException(e);
+      return 0;
+    }
+  }
+
+  void* data = mmap(0, length, protect, flags, fd, start);
+  if (data == MAP_FAILED) {
+    throwIOException(e);
+    return 0;
+  }
+#endif
+
+  jobject buffer = e->NewObject
+    (c, constructor, reinterpret_cast<jlong>(data),
+     reinterpret_cast<jlong>(static_cast<uint8_t*>(data) + (position - start)),
+     size, readOnly);
+
+  if (buffer == 0) {
+    unmapRegion(data, length);
+  }
+
+  return buffer;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_FileChannel_natTransferTo(JNIEnv* e, jclass, jint fd,
+                                                 jlong position, jlong count,
+                                                 jint target,
+                                                 jboolean socket)
+{
+#ifdef PLATFORM_WINDOWS
+  if (not socket) return -1;
+
+  // TransmitFile lives in mswsock, which we look up at runtime rather
+  // than link against
+  LPFN_TRANSMITFILE transmitFile;
+  GUID id = WSAID_TRANSMITFILE;
+  DWORD size;
+  if (WSAIoctl(target, SIO_GET_EXTENSION_FUNCTION_POINTER, &id, sizeof(GUID),
+               &transmitFile, sizeof(LPFN_TRANSMITFILE), &size, 0, 0) != 0)
+  {
+    return -1;
+  }
+
+  // TransmitFile sends from the file's current position, so we move it
+  // for the duration of the call
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  LARGE_INTEGER zero;
+  zero.QuadPart = 0;
+  LARGE_INTEGER saved;
+  LARGE_INTEGER offset;
+  offset.QuadPart = position;
+  if (not (SetFilePointerEx(file, zero, &saved, FILE_CURRENT)
+           and SetFilePointerEx(file, offset, 0, FILE_BEGIN)))
+  {
+    return -1;
+  }
+
+  const jlong MaxTransmitSize = 0x7FFFFFFE;
+  DWORD length = count > MaxTransmitSize ? MaxTransmitSize : count;
+  BOOL success = transmitFile(target, file, length, 0, 0, 0, 0);
+  int error = WSAGetLastError();
+
+  SetFilePointerEx(file, saved, 0, FILE_BEGIN);
+
+  if (success) {
+    return length;
+  } else if (error == WSAEWOULDBLOCK) {
+    return 0;
+  } else {
+    throwIOException(e, socketErrorString(e, error));
+    return 0;
+  }
+#elif defined __linux__
+  // sendfile accepts any kind of output descriptor and leaves the
+  // input descriptor's position alone when given an offset
+  (void) socket;
+
+  off_t offset = position;
+  ssize_t r = sendfile(target, fd, &offset, count);
+  if (r >= 0) {
+    return r;
+  }
+#elif (defined __APPLE__) || (defined __FreeBSD__)
+  if (not socket) return -1;
+
+  off_t sent;
+#  ifdef __APPLE__
+  sent = count;
+  int r = sendfile(fd, target, position, &sent, 0, 0);
+#  else
+  int r = sendfile(fd, target, position, count, 0, &sent, 0);
+#  endif
+  if (r == 0 or (errno == EAGAIN and sent > 0)) {
+    return sent;
+  }
+#else
+  (void) e;
+  (void) fd;
+  (void) position;
+  (void) count;
+  (void) target;
+  (void) socket;
+  return -1;
+#endif
+
+#ifndef PLATFORM_WINDOWS
+  if (errno == EAGAIN) {
+    return 0;
+  } else if (errno == EINVAL or errno == ENOSYS or errno == ENOTSOCK
+             or errno == EOPNOTSUPP)
+  {
+    // not a combination of descriptors the kernel can handle
+    return -1;
+  } else {
+    throwIOException(e);
+    return 0;
+  }
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_force(JNIEnv* e, jclass, jlong base,
+                                     jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  if (not FlushViewOfFile(reinterpret_cast<void*>(base), length)) {
+    throwNew(e, "java/io/IOException", "%d", GetLastError());
+  }
+#else
+  if (msync(reinterpret_cast<void*>(base), length, MS_SYNC) != 0) {
+    throwIOException(e);
+  }
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_unmap(JNIEnv*, jclass, jlong base,
+                                     jlong length)
+{
+  unmapRegion(reinterpret_cast<void*>(base), length);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketChannel_natThrowWriteError(JNIEnv *e,
+							jclass,
+							jint socket)
+{
+  int error;
+  socklen_t size = sizeof(int);
+  int r = getsockopt(socket, SOL_SOCKET, SO_ERROR,
+		     reinterpret_cast<char*>(&error), &size);
+  if (r != 0 or size != sizeof(int)) {
+    throwIOException(e);
+  } else if (error != 0) {
+    throwIOException(e, socketErrorString(e, error));
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketChannel_natCloseSocket(JNIEnv *,
+						    jclass,
+						    jint socket)
+{
+  doClose(socket);
+}
+
+namespace {
+
+class Pipe {
+ public:
+#ifdef PLATFORM_WINDOWS
+  // The Windows socket API only accepts socket file descriptors, not
+  // pipe descriptors or others.  Thus, to implement
+  // Selector.wakeup(), we make a socket connection via the loopback
+  // interface and use it as a pipe.
+  Pipe(JNIEnv* e): connected_(false), listener_(-1), reader_(-1), writer_(-1) {
+    sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = inet_addr("127.0.0.1"); //INADDR_LOOPBACK;
+
+    listener_ = makeSocket(e);
+    if (e->ExceptionCheck()) return;
+
+    setBlocking(e, listener_, false);
+
+    ::doBind(e, listener_, &address);
+    if (e->ExceptionCheck()) return;
+
+    ::doListen(e, listener_);
+    if (e->ExceptionCheck()) return;
+
+    socklen_t length = sizeof(sockaddr_in);
+    int r = getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                        &length);
+    if (r) {
+      throwIOException(e);
+      return;
+    }
+
+    writer_ = makeSocket(e);
+    if (e->ExceptionCheck()) return;
+
+    setBlocking(e, writer_, true);
+    connected_ = ::doConnect(e, writer_, &address);
+  }
+
+  void dispose() {
+    if (listener_ >= 0) ::doClose(listener_);
+    if (reader_ >= 0) ::doClose(reader_);
+    if (writer_ >= 0) ::doClose(writer_);
+  }
+
+  bool connected() {
+    return connected_;
+  }
+
+  void setConnected(bool v) {
+    connected_ = v;
+  }
 
   int listener() {
     return listener_;
@@ -797,119 +1602,412 @@ class Pipe {
 #endif
 };
 
+// Readiness as reported to Java, which masks it with each key's actual
+// interest set.
+const jint ReadReady = java_nio_channels_SelectionKey_OP_READ
+  | java_nio_channels_SelectionKey_OP_ACCEPT;
+
+const jint WriteReady = java_nio_channels_SelectionKey_OP_WRITE
+  | java_nio_channels_SelectionKey_OP_CONNECT;
+
+// The most events we report from a single call to natDoSocketSelect.
+const unsigned MaxEvents = 256;
+
 struct SelectorState {
+#ifdef AVIAN_USE_EPOLL
+  int epoll;
+#elif defined AVIAN_USE_KQUEUE
+  int queue;
+#else
+  // interest sets, which persist across calls
   fd_set read;
   fd_set write;
-  fd_set except;
+  int max;
+
+  // ready sets, filled in by ::select
+  fd_set readyRead;
+  fd_set readyWrite;
+  fd_set readyExcept;
+#endif
   Pipe control;
   SelectorState(JNIEnv* e) : control(e) { }
 };
 
-} // namespace
+void
+drainControl(JNIEnv* e, SelectorState* s)
+{
+  char c;
+  int r = 1;
+  while (r == 1) {
+    r = ::doRead(s->control.reader(), &c, 1);
+  }
+  if (r < 0 and not eagain()) {
+    throwIOException(e);
+  }
+}
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
+#ifdef AVIAN_USE_EPOLL
+
+bool
+initBackend(JNIEnv* e, SelectorState* s)
 {
-  void *mem = malloc(sizeof(SelectorState));
-  if (mem) {
-    SelectorState *s = new (mem) SelectorState(e);
-    if (e->ExceptionCheck()) return 0;
+  s->epoll = epoll_create(64);
+  if (s->epoll < 0) {
+    throwIOException(e);
+    return false;
+  }
+
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  event.events = EPOLLIN;
+  event.data.fd = s->control.reader();
+  if (epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->control.reader(), &event) != 0) {
+    throwIOException(e);
+    close(s->epoll);
+    return false;
+  }
+
+  return true;
+}
+
+void
+disposeBackend(SelectorState* s)
+{
+  close(s->epoll);
+}
+
+unsigned
+epollEvents(jint interest)
+{
+  unsigned events = 0;
+  if (interest & ReadReady) {
+    events |= EPOLLIN;
+  }
+  if (interest & WriteReady) {
+    events |= EPOLLOUT;
+  }
+  return events;
+}
 
-    if (s) {
-      FD_ZERO(&(s->read));
-      FD_ZERO(&(s->write));
-      FD_ZERO(&(s->except));
-      return reinterpret_cast<jlong>(s);
+void
+clearInterest(SelectorState* s, int socket)
+{
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+
+  // this fails harmlessly if the socket has already been closed, which
+  // removes it from the set implicitly
+  epoll_ctl(s->epoll, EPOLL_CTL_DEL, socket, &event);
+}
+
+void
+updateInterest(JNIEnv* e, SelectorState* s, int socket, jint old,
+               jint interest)
+{
+  unsigned oldEvents = epollEvents(old);
+  unsigned newEvents = epollEvents(interest);
+  if (oldEvents == newEvents) {
+    return;
+  }
+
+  if (newEvents == 0) {
+    clearInterest(s, socket);
+    return;
+  }
+
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  event.events = newEvents;
+  event.data.fd = socket;
+
+  int op = oldEvents ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  int r = epoll_ctl(s->epoll, op, socket, &event);
+  if (r != 0 and op == EPOLL_CTL_MOD and errno == ENOENT) {
+    r = epoll_ctl(s->epoll, EPOLL_CTL_ADD, socket, &event);
+  } else if (r != 0 and op == EPOLL_CTL_ADD and errno == EEXIST) {
+    r = epoll_ctl(s->epoll, EPOLL_CTL_MOD, socket, &event);
+  }
+
+  if (r != 0) {
+    throwIOException(e);
+  }
+}
+
+int
+waitForEvents(JNIEnv* e, SelectorState* s, jlong interval, jint* events,
+              unsigned capacity)
+{
+  int timeout;
+  if (interval > 0) {
+    timeout = interval > 0x7FFFFFFF ? 0x7FFFFFFF : interval;
+  } else if (interval < 0) {
+    timeout = 0;
+  } else {
+    timeout = -1;
+  }
+
+  epoll_event ready[MaxEvents];
+  int r = epoll_wait(s->epoll, ready, capacity, timeout);
+  if (r < 0) {
+    if (errno != EINTR) {
+      throwIOException(e);
     }
+    return 0;
   }
-  throwNew(e, "java/lang/OutOfMemoryError", 0);
-  return 0;
+
+  unsigned count = 0;
+  for (int i = 0; i < r; ++i) {
+    int socket = ready[i].data.fd;
+    if (socket == s->control.reader()) {
+      drainControl(e, s);
+      if (e->ExceptionCheck()) return 0;
+    } else {
+      unsigned flags = ready[i].events;
+      jint ops = 0;
+      if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ops |= ReadReady;
+      }
+      if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+        ops |= WriteReady;
+      }
+
+      events[count * 2] = socket;
+      events[(count * 2) + 1] = ops;
+      ++ count;
+    }
+  }
+
+  return count;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+#elif defined AVIAN_USE_KQUEUE
+
+bool
+initBackend(JNIEnv* e, SelectorState* s)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  if (s->control.connected()) {
-    const char c = 1;
-    int r = ::doWrite(s->control.writer(), &c, 1);
-    if (r != 1) {
+  s->queue = kqueue();
+  if (s->queue < 0) {
+    throwIOException(e);
+    return false;
+  }
+
+  struct kevent change;
+  EV_SET(&change, s->control.reader(), EVFILT_READ, EV_ADD, 0, 0, 0);
+  if (kevent(s->queue, &change, 1, 0, 0, 0) != 0) {
+    throwIOException(e);
+    close(s->queue);
+    return false;
+  }
+
+  return true;
+}
+
+void
+disposeBackend(SelectorState* s)
+{
+  close(s->queue);
+}
+
+void
+clearInterest(SelectorState* s, int socket)
+{
+  // either filter may not be registered, and closing the socket will
+  // already have removed both, so errors are expected here and ignored
+  struct kevent change;
+  EV_SET(&change, socket, EVFILT_READ, EV_DELETE, 0, 0, 0);
+  kevent(s->queue, &change, 1, 0, 0, 0);
+
+  EV_SET(&change, socket, EVFILT_WRITE, EV_DELETE, 0, 0, 0);
+  kevent(s->queue, &change, 1, 0, 0, 0);
+}
+
+bool
+updateFilter(SelectorState* s, int socket, int filter, bool old, bool new_)
+{
+  if (old == new_) {
+    return true;
+  }
+
+  struct kevent change;
+  EV_SET(&change, socket, filter, new_ ? EV_ADD : EV_DELETE, 0, 0, 0);
+  return kevent(s->queue, &change, 1, 0, 0, 0) == 0
+    or ((not new_) and errno == ENOENT);
+}
+
+void
+updateInterest(JNIEnv* e, SelectorState* s, int socket, jint old,
+               jint interest)
+{
+  if (not (updateFilter(s, socket, EVFILT_READ, old & ReadReady,
+                        interest & ReadReady)
+           and updateFilter(s, socket, EVFILT_WRITE, old & WriteReady,
+                            interest & WriteReady)))
+  {
+    throwIOException(e);
+  }
+}
+
+int
+waitForEvents(JNIEnv* e, SelectorState* s, jlong interval, jint* events,
+              unsigned capacity)
+{
+  timespec time;
+  timespec* timeout;
+  if (interval > 0) {
+    time.tv_sec = interval / 1000;
+    time.tv_nsec = (interval % 1000) * 1000 * 1000;
+    timeout = &time;
+  } else if (interval < 0) {
+    time.tv_sec = 0;
+    time.tv_nsec = 0;
+    timeout = &time;
+  } else {
+    timeout = 0;
+  }
+
+  struct kevent ready[MaxEvents];
+  int r = kevent(s->queue, 0, 0, ready, capacity, timeout);
+  if (r < 0) {
+    if (errno != EINTR) {
       throwIOException(e);
     }
+    return 0;
   }
+
+  // each filter is reported separately, so a socket may appear twice;
+  // the caller merges the two
+  unsigned count = 0;
+  for (int i = 0; i < r; ++i) {
+    int socket = ready[i].ident;
+    if (socket == s->control.reader()) {
+      drainControl(e, s);
+      if (e->ExceptionCheck()) return 0;
+    } else {
+      jint ops;
+      if (ready[i].flags & EV_ERROR) {
+        ops = ReadReady | WriteReady;
+      } else if (ready[i].filter == EVFILT_READ) {
+        ops = ReadReady;
+      } else {
+        ops = WriteReady;
+      }
+
+      events[count * 2] = socket;
+      events[(count * 2) + 1] = ops;
+      ++ count;
+    }
+  }
+
+  return count;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketSelector_natClose(JNIEnv *, jclass, jlong state)
+#else // not AVIAN_USE_EPOLL and not AVIAN_USE_KQUEUE
+
+bool
+initBackend(JNIEnv*, SelectorState* s)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  s->control.dispose();
-  free(s);
+  FD_ZERO(&(s->read));
+  FD_ZERO(&(s->write));
+  s->max = 0;
+  return true;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketSelector_natSelectClearAll(JNIEnv *, jclass,
-							jint socket,
-							jlong state)
+void
+disposeBackend(SelectorState*)
+{
+  // ignore
+}
+
+void
+clearInterest(SelectorState* s, int socket)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
   FD_CLR(static_cast<unsigned>(socket), &(s->read));
   FD_CLR(static_cast<unsigned>(socket), &(s->write));
-  FD_CLR(static_cast<unsigned>(socket), &(s->except));
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *,
-								 jclass,
-								 jint socket,
-								 jint interest,
-								 jlong state,
-								 jint max)
+void
+updateInterest(JNIEnv* e UNUSED, SelectorState* s, int socket, jint,
+               jint interest)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  if (interest & (java_nio_channels_SelectionKey_OP_READ |
-		  java_nio_channels_SelectionKey_OP_ACCEPT)) {
+#ifndef PLATFORM_WINDOWS
+  // Windows sockets are handles rather than indexes, so FD_SETSIZE
+  // limits how many there are, not how large they may be
+  if (socket >= FD_SETSIZE) {
+    throwIOException(e, "socket descriptor too large for select");
+    return;
+  }
+#endif
+
+  if (interest & ReadReady) {
     FD_SET(static_cast<unsigned>(socket), &(s->read));
-    if (max < socket) max = socket;
   } else {
     FD_CLR(static_cast<unsigned>(socket), &(s->read));
   }
   
-  if (interest & (java_nio_channels_SelectionKey_OP_WRITE |
-		  java_nio_channels_SelectionKey_OP_CONNECT)) {
+  if (interest & WriteReady) {
     FD_SET(static_cast<unsigned>(socket), &(s->write));
-    FD_SET(static_cast<unsigned>(socket), &(s->except));
-    if (max < socket) max = socket;
   } else {
     FD_CLR(static_cast<unsigned>(socket), &(s->write));
   }
-  return max;
+
+  if (interest and s->max < socket) {
+    s->max = socket;
+  }
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
-							jlong state,
-							jint max,
-							jlong interval)
+bool
+controlSocket(SelectorState* s, int socket)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (socket == s->control.reader()) {
+    return true;
+  }
+
+#ifdef PLATFORM_WINDOWS
+  if (socket == s->control.listener() or socket == s->control.writer()) {
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+void
+addEvent(SelectorState* s, jint* events, unsigned capacity,
+         unsigned* count, int socket, jint ops)
+{
+  if (ops and *count < capacity and not controlSocket(s, socket)) {
+    events[*count * 2] = socket;
+    events[(*count * 2) + 1] = ops;
+    ++ (*count);
+  }
+}
+
+int
+waitForEvents(JNIEnv* e, SelectorState* s, jlong interval, jint* events,
+              unsigned capacity)
+{
+  s->readyRead = s->read;
+  s->readyWrite = s->write;
+  s->readyExcept = s->write;
+
+  int max = s->max;
   if (s->control.reader() >= 0) {
     int socket = s->control.reader();
-    FD_SET(static_cast<unsigned>(socket), &(s->read));
+    FD_SET(static_cast<unsigned>(socket), &(s->readyRead));
     if (max < socket) max = socket;
   }
 
 #ifdef PLATFORM_WINDOWS
   if (s->control.listener() >= 0) {
     int socket = s->control.listener();
-    FD_SET(static_cast<unsigned>(socket), &(s->read));
+    FD_SET(static_cast<unsigned>(socket), &(s->readyRead));
     if (max < socket) max = socket;
   }
 
   if (not s->control.connected()) {
     int socket = s->control.writer();
-    FD_SET(static_cast<unsigned>(socket), &(s->write));
-    FD_SET(static_cast<unsigned>(socket), &(s->except));
+    FD_SET(static_cast<unsigned>(socket), &(s->readyWrite));
+    FD_SET(static_cast<unsigned>(socket), &(s->readyExcept));
     if (max < socket) max = socket;
   }
 #endif
@@ -925,22 +2023,21 @@ Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
     time.tv_sec = 24 * 60 * 60 * 1000;
     time.tv_usec = 0;
   }
-  int r = ::select(max + 1, &(s->read), &(s->write), &(s->except), &time);
+  int r = ::select(max + 1, &(s->readyRead), &(s->readyWrite),
+                   &(s->readyExcept), &time);
 
   if (r < 0) {
     if (errno != EINTR) {
       throwIOException(e);
-      return 0;
     }
+    return 0;
   }
 
 #ifdef PLATFORM_WINDOWS
-  if (FD_ISSET(s->control.writer(), &(s->write)) or
-      FD_ISSET(s->control.writer(), &(s->except)))
+  if (FD_ISSET(s->control.writer(), &(s->readyWrite)) or
+      FD_ISSET(s->control.writer(), &(s->readyExcept)))
   {
     int socket = s->control.writer();
-    FD_CLR(static_cast<unsigned>(socket), &(s->write));
-    FD_CLR(static_cast<unsigned>(socket), &(s->except));
 
     int error;
     socklen_t size = sizeof(int);
@@ -955,63 +2052,149 @@ Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
   }
 
   if (s->control.listener() >= 0 and
-      FD_ISSET(s->control.listener(), &(s->read)))
+      FD_ISSET(s->control.listener(), &(s->readyRead)))
   {
-    FD_CLR(static_cast<unsigned>(s->control.listener()), &(s->read));
-
     s->control.setReader(::doAccept(e, s->control.listener()));
     s->control.setListener(-1);
   }
 #endif
 
   if (s->control.reader() >= 0 and
-      FD_ISSET(s->control.reader(), &(s->read)))
+      FD_ISSET(s->control.reader(), &(s->readyRead)))
   {
-    FD_CLR(static_cast<unsigned>(s->control.reader()), &(s->read));
+    drainControl(e, s);
+  }
+
+  if (e->ExceptionCheck()) return 0;
 
-    char c;
-    int r = 1;
-    while (r == 1) {
-      r = ::doRead(s->control.reader(), &c, 1);
+  unsigned count = 0;
+
+#ifdef PLATFORM_WINDOWS
+  // a Windows fd_set is a list of handles, so we report reads and
+  // writes separately and let the caller merge them
+  for (unsigned i = 0; i < s->readyRead.fd_count; ++i) {
+    addEvent(s, events, capacity, &count, s->readyRead.fd_array[i],
+             ReadReady);
+  }
+
+  for (unsigned i = 0; i < s->readyWrite.fd_count; ++i) {
+    addEvent(s, events, capacity, &count, s->readyWrite.fd_array[i],
+             WriteReady);
+  }
+
+  for (unsigned i = 0; i < s->readyExcept.fd_count; ++i) {
+    addEvent(s, events, capacity, &count, s->readyExcept.fd_array[i],
+             WriteReady);
+  }
+#else
+  for (int socket = 0; socket <= s->max and count < capacity; ++socket) {
+    jint ops = 0;
+    if (FD_ISSET(socket, &(s->readyRead))) {
+      ops |= ReadReady;
     }
-    if (r < 0 and not eagain()) {
-      throwIOException(e);
+
+    if (FD_ISSET(socket, &(s->readyWrite))
+        or FD_ISSET(socket, &(s->readyExcept)))
+    {
+      ops |= WriteReady;
     }
+
+    addEvent(s, events, capacity, &count, socket, ops);
   }
+#endif
 
-  return r;
+  return count;
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
-							jint socket,
-							jint interest,
-							jlong state)
+#endif // not AVIAN_USE_EPOLL and not AVIAN_USE_KQUEUE
+
+} // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
 {
-  SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  jint ready = 0;
-        
-  if (FD_ISSET(socket, &(s->read))) {
-    if (interest & java_nio_channels_SelectionKey_OP_READ) {
-      ready |= java_nio_channels_SelectionKey_OP_READ;
+  void *mem = malloc(sizeof(SelectorState));
+  if (mem) {
+    SelectorState *s = new (mem) SelectorState(e);
+    if (e->ExceptionCheck()) {
+      free(s);
+      return 0;
     }
-    
-    if (interest & java_nio_channels_SelectionKey_OP_ACCEPT) {
-      ready |= java_nio_channels_SelectionKey_OP_ACCEPT;
+
+    if (not initBackend(e, s)) {
+      s->control.dispose();
+      free(s);
+      return 0;
     }
+
+    return reinterpret_cast<jlong>(s);
   }
-  
-  if (FD_ISSET(socket, &(s->write)) or FD_ISSET(socket, &(s->except))) {
-    if (interest & java_nio_channels_SelectionKey_OP_WRITE) {
-      ready |= java_nio_channels_SelectionKey_OP_WRITE;
+  throwNew(e, "java/lang/OutOfMemoryError", 0);
+  return 0;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (s->control.connected()) {
+    const char c = 1;
+    int r = ::doWrite(s->control.writer(), &c, 1);
+    if (r != 1) {
+      throwIOException(e);
     }
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natClose(JNIEnv *, jclass, jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  disposeBackend(s);
+  s->control.dispose();
+  free(s);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natSelectClearAll(JNIEnv *, jclass,
+							jint socket,
+							jlong state)
+{
+  clearInterest(reinterpret_cast<SelectorState*>(state), socket);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *e,
+								 jclass,
+								 jint socket,
+								 jint old,
+								 jint interest,
+								 jlong state)
+{
+  updateInterest
+    (e, reinterpret_cast<SelectorState*>(state), socket, old, interest);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
+							jlong state,
+							jlong interval,
+							jintArray events)
+{
+  unsigned capacity = e->GetArrayLength(events) / 2;
+  if (capacity > MaxEvents) {
+    capacity = MaxEvents;
+  }
+
+  jint buffer[MaxEvents * 2];
+  int count = waitForEvents
+    (e, reinterpret_cast<SelectorState*>(state), interval, buffer, capacity);
 
-    if (interest & java_nio_channels_SelectionKey_OP_CONNECT) {
-      ready |= java_nio_channels_SelectionKey_OP_CONNECT;
-    }    
+  if (count > 0) {
+    e->SetIntArrayRegion(events, 0, count * 2, buffer);
   }
 
-  return ready;
+  return count;
 }
 
 
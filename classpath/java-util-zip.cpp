@@ -10,11 +10,214 @@
 
 #include "stdlib.h"
 #include "string.h"
+#include "stdint.h"
 #include "zlib-custom.h"
 
 #include "jni.h"
 #include "jni-util.h"
 
+#if (defined __x86_64__) || (defined __i386__)
+#  if (defined __GNUC__) and (not defined _MSC_VER)
+#    include <cpuid.h>
+#    include <immintrin.h>
+#    define AVIAN_CRC32_PCLMUL
+#  endif
+#elif (defined __ARM_FEATURE_CRC32)
+#  include <arm_acle.h>
+#  define AVIAN_CRC32_ARM
+#endif
+
+namespace {
+
+// A zlib stream operates on either a byte array or a direct buffer on
+// each side, the array taking precedence when both are given.  Arrays
+// are used in place inside critical regions, which is fine since
+// (de)compression never blocks.  Since no other JNI calls are allowed
+// inside a critical region, all direct buffer addresses must be
+// fetched before any array is acquired.
+class Region {
+ public:
+  Region(JNIEnv* e, jbyteArray array, jobject buffer, jint offset):
+    e(e), array(array), offset(offset), start(0)
+  {
+    if (array == 0) {
+      start = static_cast<uint8_t*>(e->GetDirectBufferAddress(buffer));
+    }
+  }
+
+  uint8_t* acquire() {
+    if (array) {
+      start = static_cast<uint8_t*>(e->GetPrimitiveArrayCritical(array, 0));
+    }
+    return start + offset;
+  }
+
+  void release(bool modified) {
+    if (array) {
+      e->ReleasePrimitiveArrayCritical
+        (array, start, modified ? 0 : JNI_ABORT);
+    }
+  }
+
+  JNIEnv* e;
+  jbyteArray array;
+  jint offset;
+  uint8_t* start;
+};
+
+#ifdef AVIAN_CRC32_PCLMUL
+
+// The smallest amount of data worth folding with PCLMULQDQ, which also
+// must be done in multiples of 16 bytes.
+const unsigned PclmulMinimumLength = 64;
+
+bool
+pclmulSupported()
+{
+  static int supported = -1;
+  if (supported < 0) {
+    unsigned a, b, c, d;
+    supported = __get_cpuid(1, &a, &b, &c, &d)
+      and (c & bit_PCLMUL) and (c & bit_SSE4_1);
+  }
+  return supported;
+}
+
+// Computes the CRC-32 of a buffer whose length is a multiple of 16 and
+// at least 64 by folding it with carry-less multiplication, as
+// described in Intel's "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ Instruction".  Takes and returns the CRC in its
+// inverted, internal form.
+__attribute__((target("pclmul,sse4.1"))) uint32_t
+crc32Pclmul(const uint8_t* p, unsigned length, uint32_t crc)
+{
+  static const uint64_t k1k2[] __attribute__((aligned(16)))
+    = { 0x0154442bd4LL, 0x01c6e41596LL };
+  static const uint64_t k3k4[] __attribute__((aligned(16)))
+    = { 0x01751997d0LL, 0x00ccaa009eLL };
+  static const uint64_t k5k0[] __attribute__((aligned(16)))
+    = { 0x0163cd6124LL, 0x0000000000LL };
+  static const uint64_t poly[] __attribute__((aligned(16)))
+    = { 0x01db710641LL, 0x01f7011641LL };
+
+  const __m128i* v = reinterpret_cast<const __m128i*>(p);
+
+  __m128i x1 = _mm_loadu_si128(v);
+  __m128i x2 = _mm_loadu_si128(v + 1);
+  __m128i x3 = _mm_loadu_si128(v + 2);
+  __m128i x4 = _mm_loadu_si128(v + 3);
+
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+  __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+  v += 4;
+  length -= 64;
+
+  // fold four blocks at a time
+  while (length >= 64) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(v));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(v + 1));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(v + 2));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(v + 3));
+
+    v += 4;
+    length -= 64;
+  }
+
+  // fold the four accumulators into one
+  k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+  __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // fold any remaining blocks one at a time
+  while (length >= 16) {
+    x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(v)), x5);
+
+    ++ v;
+    length -= 16;
+  }
+
+  // fold 128 bits down to 64
+  x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett-reduce to 32 bits
+  k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, k, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, k, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+#endif // AVIAN_CRC32_PCLMUL
+
+uint32_t
+updateCrc32(uint32_t crc, const uint8_t* p, unsigned length)
+{
+#ifdef AVIAN_CRC32_PCLMUL
+  if (length >= PclmulMinimumLength and pclmulSupported()) {
+    unsigned chunk = length & ~15;
+    crc = ~crc32Pclmul(p, chunk, ~crc);
+    p += chunk;
+    length -= chunk;
+  }
+#elif defined AVIAN_CRC32_ARM
+  crc = ~crc;
+  while (length >= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = __crc32d(crc, v);
+    p += 8;
+    length -= 8;
+  }
+  while (length) {
+    crc = __crc32b(crc, *p);
+    ++ p;
+    -- length;
+  }
+  crc = ~crc;
+#endif
+
+  return length ? crc32(crc, p, length) : crc;
+}
+
+} // namespace
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_java_util_zip_Inflater_make
 (JNIEnv* e, jclass, jboolean nowrap)
@@ -48,30 +251,20 @@ Java_java_util_zip_Inflater_dispose(JNIEnv*, jclass, jlong peer)
 extern "C" JNIEXPORT void JNICALL
 Java_java_util_zip_Inflater_inflate
 (JNIEnv* e, jclass, jlong peer,
- jbyteArray input, jint inputOffset, jint inputLength,
- jbyteArray output, jint outputOffset, jint outputLength,
+ jbyteArray inputArray, jobject inputBuffer, jint inputOffset,
+ jint inputLength,
+ jbyteArray outputArray, jobject outputBuffer, jint outputOffset,
+ jint outputLength,
  jintArray results)
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
+  Region input(e, inputArray, inputBuffer, inputOffset);
+  Region output(e, outputArray, outputBuffer, outputOffset);
 
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = input.acquire();
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = output.acquire();
   s->avail_out = outputLength;
 
   int r = inflate(s, Z_SYNC_FLUSH);
@@ -80,10 +273,8 @@ Java_java_util_zip_Inflater_inflate
         static_cast<jint>(inputLength - s->avail_in),
         static_cast<jint>(outputLength - s->avail_out) };
 
-  free(in);
-
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  output.release(true);
+  input.release(false);
 
   e->SetIntArrayRegion(results, 0, 3, resultArray);
 }
@@ -121,30 +312,20 @@ Java_java_util_zip_Deflater_dispose(JNIEnv*, jclass, jlong peer)
 extern "C" JNIEXPORT void JNICALL
 Java_java_util_zip_Deflater_deflate
 (JNIEnv* e, jclass, jlong peer, 
- jbyteArray input, jint inputOffset, jint inputLength,
- jbyteArray output, jint outputOffset, jint outputLength,
+ jbyteArray inputArray, jobject inputBuffer, jint inputOffset,
+ jint inputLength,
+ jbyteArray outputArray, jobject outputBuffer, jint outputOffset,
+ jint outputLength,
  jboolean finish, jintArray results)
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
+  Region input(e, inputArray, inputBuffer, inputOffset);
+  Region output(e, outputArray, outputBuffer, outputOffset);
 
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = input.acquire();
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = output.acquire();
   s->avail_out = outputLength;
 
   int r = deflate(s, finish ? Z_FINISH : Z_NO_FLUSH);
@@ -153,10 +334,22 @@ Java_java_util_zip_Deflater_deflate
         static_cast<jint>(inputLength - s->avail_in),
         static_cast<jint>(outputLength - s->avail_out) };
 
-  free(in);
-
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  output.release(true);
+  input.release(false);
 
   e->SetIntArrayRegion(results, 0, 3, resultArray);
 }
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_util_zip_CRC32_update
+(JNIEnv* e, jclass, jint crc, jbyteArray array, jobject buffer, jint offset,
+ jint length)
+{
+  Region region(e, array, buffer, offset);
+
+  crc = updateCrc32(crc, region.acquire(), length);
+
+  region.release(false);
+
+  return crc;
+}
@@ -10,6 +10,10 @@
 
 package java.io;
 
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.channels.NonWritableChannelException;
+
 public class FileInputStream extends InputStream {
   //   static {
   //     System.loadLibrary("natives");
@@ -42,6 +46,14 @@ public class FileInputStream extends InputStream {
   private static native int read(int fd, byte[] b, int offset, int length)
     throws IOException;
 
+  private static native int read(int fd, long position, byte[] b,
+                                 int offset, int length)
+    throws IOException;
+
+  private static native long read(int fd, byte[][] buffers, int offset,
+                                  int length)
+    throws IOException;
+
   public static native void close(int fd) throws IOException;
 
   public int read() throws IOException {
@@ -57,8 +69,8 @@ public class FileInputStream extends InputStream {
       throw new NullPointerException();
     }
 
-    if (offset < 0 || offset + length > b.length) {
-      throw new ArrayIndexOutOfBoundsException();
+    if (offset < 0 || length < 0 || offset > b.length - length) {
+      throw new IndexOutOfBoundsException();
     }
 
     int c = read(fd, b, offset, length);
@@ -68,6 +80,85 @@ public class FileInputStream extends InputStream {
     return c;
   }
 
+  /**
+   * Reads into the specified range of b from the specified position in
+   * the file without changing the current position of this stream.
+   */
+  public int read(long position, byte[] b, int offset, int length)
+    throws IOException
+  {
+    if (b == null) {
+      throw new NullPointerException();
+    }
+
+    if (position < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    if (offset < 0 || length < 0 || offset > b.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    return read(fd, position, b, offset, length);
+  }
+
+  /**
+   * Reads into the arrays buffers[offset] through
+   * buffers[offset + length - 1] in order, filling each before moving
+   * on to the next, and returns the total number of bytes read, or -1
+   * at the end of the stream.  Fewer bytes than requested may be read,
+   * as with read(byte[], int, int).
+   */
+  public long read(byte[][] buffers, int offset, int length)
+    throws IOException
+  {
+    if (buffers == null) {
+      throw new NullPointerException();
+    }
+
+    if (offset < 0 || length < 0 || offset > buffers.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    long c = read(fd, buffers, offset, length);
+    if (c > 0 && remaining > 0) {
+      remaining -= c;
+    }
+    return c;
+  }
+
+  public FileChannel getChannel() {
+    return new FileChannel(fd, true, false) {
+      public int read(ByteBuffer b) throws IOException {
+        if (! b.hasRemaining()) return 0;
+
+        if (b.hasArray()) {
+          int c = FileInputStream.this.read
+            (b.array(), b.arrayOffset() + b.position(), b.remaining());
+          if (c > 0) {
+            b.position(b.position() + c);
+          }
+          return c;
+        } else {
+          byte[] buffer = new byte[b.remaining()];
+          int c = FileInputStream.this.read(buffer, 0, buffer.length);
+          if (c > 0) {
+            b.put(buffer, 0, c);
+          }
+          return c;
+        }
+      }
+
+      public int write(ByteBuffer b) {
+        throw new NonWritableChannelException();
+      }
+
+      protected void implCloseChannel() throws IOException {
+        FileInputStream.this.close();
+      }
+    };
+  }
+
   public void close() throws IOException {
     if (fd != -1) {
       close(fd);
@@ -10,6 +10,10 @@
 
 package java.io;
 
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.channels.NonReadableChannelException;
+
 public class FileOutputStream extends OutputStream {
   //   static {
   //     System.loadLibrary("natives");
@@ -41,6 +45,14 @@ public class FileOutputStream extends OutputStream {
   private static native void write(int fd, byte[] b, int offset, int length)
     throws IOException;
 
+  private static native void write(int fd, long position, byte[] b,
+                                   int offset, int length)
+    throws IOException;
+
+  private static native int write(int fd, byte[][] buffers, int offset,
+                                  int length)
+    throws IOException;
+
   private static native void close(int fd) throws IOException;
 
   public void write(int c) throws IOException {
@@ -52,13 +64,84 @@ public class FileOutputStream extends OutputStream {
       throw new NullPointerException();
     }
 
-    if (offset < 0 || offset + length > b.length) {
-      throw new ArrayIndexOutOfBoundsException();
+    if (offset < 0 || length < 0 || offset > b.length - length) {
+      throw new IndexOutOfBoundsException();
     }
 
     write(fd, b, offset, length);
   }
 
+  /**
+   * Writes the specified range of b at the specified position in the
+   * file without changing the current position of this stream.
+   */
+  public void write(long position, byte[] b, int offset, int length)
+    throws IOException
+  {
+    if (b == null) {
+      throw new NullPointerException();
+    }
+
+    if (position < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    if (offset < 0 || length < 0 || offset > b.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    write(fd, position, b, offset, length);
+  }
+
+  /**
+   * Writes all of the arrays buffers[offset] through
+   * buffers[offset + length - 1] in order, using as few system calls as
+   * possible.
+   */
+  public void write(byte[][] buffers, int offset, int length)
+    throws IOException
+  {
+    if (buffers == null) {
+      throw new NullPointerException();
+    }
+
+    if (offset < 0 || length < 0 || offset > buffers.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    while (length > 0) {
+      int c = write(fd, buffers, offset, length);
+      offset += c;
+      length -= c;
+    }
+  }
+
+  public FileChannel getChannel() {
+    return new FileChannel(fd, false, true) {
+      public int read(ByteBuffer b) {
+        throw new NonReadableChannelException();
+      }
+
+      public int write(ByteBuffer b) throws IOException {
+        int length = b.remaining();
+        if (b.hasArray()) {
+          FileOutputStream.this.write
+            (b.array(), b.arrayOffset() + b.position(), length);
+          b.position(b.position() + length);
+        } else {
+          byte[] buffer = new byte[length];
+          b.get(buffer);
+          FileOutputStream.this.write(buffer, 0, length);
+        }
+        return length;
+      }
+
+      protected void implCloseChannel() throws IOException {
+        FileOutputStream.this.close();
+      }
+    };
+  }
+
   public void close() throws IOException {
     if (fd != -1) {
       close(fd);
@@ -107,6 +107,29 @@ public final class Integer extends Number implements Comparable<Integer> {
     return ((v + (v >> 4) & 0xF0F0F0F) * 0x1010101) >> 24;
   }
 
+  public static int numberOfLeadingZeros(int v) {
+    if (v == 0) return 32;
+
+    int n = 1;
+    if (v >>> 16 == 0) { n += 16; v <<= 16; }
+    if (v >>> 24 == 0) { n +=  8; v <<=  8; }
+    if (v >>> 28 == 0) { n +=  4; v <<=  4; }
+    if (v >>> 30 == 0) { n +=  2; v <<=  2; }
+    return n - (v >>> 31);
+  }
+
+  public static int numberOfTrailingZeros(int v) {
+    if (v == 0) return 32;
+
+    int n = 31;
+    int y;
+    y = v << 16; if (y != 0) { n -= 16; v = y; }
+    y = v <<  8; if (y != 0) { n -=  8; v = y; }
+    y = v <<  4; if (y != 0) { n -=  4; v = y; }
+    y = v <<  2; if (y != 0) { n -=  2; v = y; }
+    return n - ((v << 1) >>> 31);
+  }
+
   public static int reverseBytes(int v) {
     int byte3 =  v >>> 24;
     int byte2 = (v >>> 8) & 0xFF00;
@@ -132,6 +132,24 @@ public final class Long extends Number implements Comparable<Long> {
     else            return -1;
   }
 
+  public static int bitCount(long v) {
+    return Integer.bitCount((int) v) + Integer.bitCount((int) (v >>> 32));
+  }
+
+  public static int numberOfLeadingZeros(long v) {
+    int high = (int) (v >>> 32);
+    return high == 0
+      ? 32 + Integer.numberOfLeadingZeros((int) v)
+      : Integer.numberOfLeadingZeros(high);
+  }
+
+  public static int numberOfTrailingZeros(long v) {
+    int low = (int) v;
+    return low == 0
+      ? 32 + Integer.numberOfTrailingZeros((int) (v >>> 32))
+      : Integer.numberOfTrailingZeros(low);
+  }
+
   private static long pow(long a, long b) {
     long c = 1;
     for (int i = 0; i < b; ++i) c *= a;
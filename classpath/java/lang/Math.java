@@ -83,6 +83,21 @@ public final class Math {
 
   public static native double ceil(double v);
 
+  public static double rint(double v) {
+    // adding and then subtracting 2^52 rounds away the fraction of any
+    // smaller magnitude, to even at ties, while larger values, NaN and
+    // zeros are returned as they are; negative values are rounded by
+    // magnitude so that small ones give -0.0
+    final double twoToThe52 = 4503599627370496.0;
+    if (v > 0 && v < twoToThe52) {
+      return (v + twoToThe52) - twoToThe52;
+    } else if (v < 0 && v > -twoToThe52) {
+      return -((twoToThe52 - v) - twoToThe52);
+    } else {
+      return v;
+    }
+  }
+
   public static native double exp(double v);
 
   public static native double log(double v);
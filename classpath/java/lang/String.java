@@ -26,6 +26,14 @@ public final class String
   private static final String LATIN_1_ENCODING = "LATIN-1";
   private static final String DEFAULT_ENCODING = UTF_8_ENCODING;
 
+  // store strings built from ASCII chars in a byte array, using half
+  // the space of a char array
+  private static final boolean CompactStrings = true;
+
+  // strings at least this long are searched and compared by the VM,
+  // which uses vector instructions where the processor has them
+  private static final int NativeThreshold = 32;
+
   public static Comparator<String> CASE_INSENSITIVE_ORDER
     = new Comparator<String>() {
     public int compare(String a, String b) {
@@ -43,7 +51,7 @@ public final class String
   }
 
   public String(char[] data, int offset, int length, boolean copy) {
-    this((Object) data, offset, length, copy);
+    this((Object) data, offset, length, copy, CompactStrings);
   }
 
   public String(char[] data, int offset, int length) {
@@ -105,6 +113,12 @@ public final class String
   }
 
   private String(Object data, int offset, int length, boolean copy) {
+    this(data, offset, length, copy, false);
+  }
+
+  private String(Object data, int offset, int length, boolean copy,
+                 boolean compact)
+  {
     int l;
     if (data instanceof char[]) {
       l = ((char[]) data).length;
@@ -119,7 +133,17 @@ public final class String
 
     if(!copy && Utf8.test(data)) copy = true;
 
-    if (copy) {
+    if (compact && isAscii((char[]) data, offset, length)) {
+      char[] src = (char[]) data;
+      byte[] b = new byte[length];
+      for (int i = 0; i < length; ++i) {
+        b[i] = (byte) src[offset + i];
+      }
+
+      this.data = b;
+      this.offset = 0;
+      this.length = length;
+    } else if (copy) {
       Object c;
       if (data instanceof char[]) {
         c = new char[length];
@@ -161,12 +185,21 @@ public final class String
       return true;
     } else if (o instanceof String) {
       String s = (String) o;
-      return s.length == length && compareTo(s) == 0;
+      if (s.length != length) {
+        return false;
+      } else if (length >= NativeThreshold) {
+        return dataEquals(data, offset, s.data, s.offset, length);
+      } else {
+        return compareTo(s) == 0;
+      }
     } else {
       return false;
     }
   }
 
+  private static native boolean dataEquals(Object a, int aOffset, Object b,
+                                           int bOffset, int length);
+
   public boolean equalsIgnoreCase(String o) {
     if (this == o) {
       return true;
@@ -273,6 +306,11 @@ public final class String
   }
 
   public int indexOf(int c, int start) {
+    if (start >= 0 && length - start >= NativeThreshold) {
+      int i = dataIndexOf(data, offset + start, offset + length, c);
+      return i < 0 ? i : i - offset;
+    }
+
     for (int i = start; i < length; ++i) {
       if (charAt(i) == c) {
         return i;
@@ -282,6 +320,11 @@ public final class String
     return -1;
   }
 
+  // returns the index in data of the first element in [start, end)
+  // which charAt would report as c, or -1 if there is none
+  private static native int dataIndexOf(Object data, int start, int end,
+                                        int c);
+
   public int lastIndexOf(int ch) {
     return lastIndexOf(ch, length-1);
   }
@@ -478,6 +521,15 @@ public final class String
     return b;
   }
 
+  private static boolean isAscii(char[] data, int offset, int length) {
+    for (int i = 0; i < length; ++i) {
+      if (data[offset + i] >= 0x80) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   public char charAt(int index) {
     if (index < 0 || index > length) {
       throw new IndexOutOfBoundsException();
@@ -22,7 +22,6 @@ import java.util.Hashtable;
 import java.util.Properties;
 
 public abstract class System {
-  private static final long NanoTimeBaseInMillis = currentTimeMillis();
   
   private static Property properties;
   private static Map<String, String> environment;
@@ -99,9 +98,7 @@ public abstract class System {
 
   public static native int identityHashCode(Object o);
 
-  public static long nanoTime() {
-    return (currentTimeMillis() - NanoTimeBaseInMillis) * 1000000;
-  }
+  public static native long nanoTime();
 
   public static String mapLibraryName(String name) {
     if (name != null) {
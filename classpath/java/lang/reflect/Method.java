@@ -11,14 +11,19 @@
 package java.lang.reflect;
 
 import avian.VMMethod;
+import avian.MethodAccessor;
 import avian.AnnotationInvocationHandler;
 import avian.SystemClassLoader;
 
 import java.lang.annotation.Annotation;
 
 public class Method<T> extends AccessibleObject implements Member {
+  private static final int AccessorThreshold = 16;
+
   private final VMMethod vmMethod;
   private boolean accessible;
+  private int invocationCount;
+  private MethodAccessor accessor;
 
   public Method(VMMethod vmMethod) {
     this.vmMethod = vmMethod;
@@ -133,7 +138,17 @@ public class Method<T> extends AccessibleObject implements Member {
       }
 
       if (arguments.length == vmMethod.parameterCount) {
-        return invoke(vmMethod, instance, arguments);        
+        MethodAccessor accessor = this.accessor;
+        if (accessor == null && ++ invocationCount == AccessorThreshold) {
+          accessor = this.accessor = MethodAccessor.make(vmMethod);
+        }
+
+        if (accessor != null) {
+          return accessor.invoke(instance, arguments);
+        } else {
+          checkArguments(vmMethod, arguments);
+          return invoke(vmMethod, instance, arguments);
+        }
       } else {
         throw new ArrayIndexOutOfBoundsException();
       }
@@ -144,6 +159,34 @@ public class Method<T> extends AccessibleObject implements Member {
     }
   }
 
+  private static boolean isBoxed(Class type, Object o) {
+    return (type == Boolean.TYPE && o instanceof Boolean)
+      || (type == Byte.TYPE && o instanceof Byte)
+      || (type == Character.TYPE && o instanceof Character)
+      || (type == Short.TYPE && o instanceof Short)
+      || (type == Integer.TYPE && o instanceof Integer)
+      || (type == Float.TYPE && o instanceof Float)
+      || (type == Long.TYPE && o instanceof Long)
+      || (type == Double.TYPE && o instanceof Double);
+  }
+
+  // the native invoke path reads each argument as the type given by
+  // the signature, so anything else must be rejected first, just as
+  // the casts in a generated accessor reject it
+  private static void checkArguments(VMMethod vmMethod, Object[] arguments) {
+    Class[] types = getParameterTypes(vmMethod);
+    for (int i = 0; i < types.length; ++i) {
+      Object a = arguments[i];
+      if (types[i].isPrimitive()) {
+        if (! isBoxed(types[i], a)) {
+          throw new IllegalArgumentException();
+        }
+      } else if (a != null && ! types[i].isInstance(a)) {
+        throw new IllegalArgumentException();
+      }
+    }
+  }
+
   private static native Object invoke(VMMethod method, Object instance,
                                       Object ... arguments)
     throws InvocationTargetException, IllegalAccessException;
@@ -0,0 +1,82 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio;
+
+public class MappedByteBuffer extends DirectByteBuffer {
+  // the buffer whose finalizer unmaps the region, or null if this is
+  // that buffer; views refer to it so it stays reachable as long as
+  // they do
+  private final MappedByteBuffer owner;
+  private final long base;
+  private final long mappedLength;
+
+  // called by FileChannel.natMap: the mapping starts at base, which is
+  // page-aligned, while the buffer itself starts at address
+  private MappedByteBuffer(long base, long address, int capacity,
+                           boolean readOnly)
+  {
+    super(address, capacity, readOnly);
+
+    this.owner = null;
+    this.base = base;
+    this.mappedLength = (address - base) + capacity;
+  }
+
+  private MappedByteBuffer(MappedByteBuffer owner, long address,
+                           int capacity, boolean readOnly)
+  {
+    super(address, capacity, readOnly);
+
+    this.owner = owner;
+    this.base = owner.base;
+    this.mappedLength = owner.mappedLength;
+  }
+
+  private MappedByteBuffer root() {
+    return owner == null ? this : owner;
+  }
+
+  public ByteBuffer asReadOnlyBuffer() {
+    ByteBuffer b = new MappedByteBuffer(root(), address, capacity, true);
+    b.position(position());
+    b.limit(limit());
+    return b;
+  }
+
+  public ByteBuffer slice() {
+    return new MappedByteBuffer
+      (root(), address + position, remaining(), true);
+  }
+
+  public final MappedByteBuffer force() {
+    if (base != 0) {
+      force(base, mappedLength);
+    }
+    return this;
+  }
+
+  protected void finalize() {
+    if (owner == null && base != 0) {
+      unmap(base, mappedLength);
+    }
+  }
+
+  public String toString() {
+    return "(MappedByteBuffer with address: " + address
+      + " position: " + position
+      + " limit: " + limit
+      + " capacity: " + capacity + ")";
+  }
+
+  private static native void force(long base, long length);
+
+  private static native void unmap(long base, long length);
+}
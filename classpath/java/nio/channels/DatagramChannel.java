@@ -12,6 +12,7 @@ package java.nio.channels;
 
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
 import java.net.SocketAddress;
 import java.net.InetSocketAddress;
 import java.net.ProtocolFamily;
@@ -25,6 +26,9 @@ public class DatagramChannel extends SelectableChannel
 {
   public static final int InvalidSocket = -1;
 
+  // the most datagrams transferred by a single batch call
+  private static final int MaxBatchLength = 64;
+
   private int socket = InvalidSocket;
   private boolean blocking = true;
 
@@ -95,11 +99,17 @@ public class DatagramChannel extends SelectableChannel
   public int write(ByteBuffer b) throws IOException {
     if (b.remaining() == 0) return 0;
 
-    byte[] array = b.array();
-    if (array == null) throw new NullPointerException();
+    int c;
+    if (b.isDirect()) {
+      c = writeDirect(socket, b, b.position(), b.remaining());
+    } else {
+      byte[] array = b.array();
+      if (array == null) throw new NullPointerException();
 
-    int c = write
-      (socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+      c = write
+        (socket, array, b.arrayOffset() + b.position(), b.remaining(),
+         blocking);
+    }
 
     if (c > 0) {
       b.position(b.position() + c);
@@ -117,14 +127,19 @@ public class DatagramChannel extends SelectableChannel
   public SocketAddress receive(ByteBuffer b) throws IOException {
     if (b.remaining() == 0) return null;
 
-    byte[] array = b.array();
-    if (array == null) throw new NullPointerException();
-
     int[] address = new int[2];
 
-    int c = receive
-      (socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking,
-       address);
+    int c;
+    if (b.isDirect()) {
+      c = receiveDirect(socket, b, b.position(), b.remaining(), address);
+    } else {
+      byte[] array = b.array();
+      if (array == null) throw new NullPointerException();
+
+      c = receive
+        (socket, array, b.arrayOffset() + b.position(), b.remaining(),
+         blocking, address);
+    }
 
     if (c > 0) {
       b.position(b.position() + c);
@@ -135,6 +150,100 @@ public class DatagramChannel extends SelectableChannel
     }
   }
 
+  /**
+   * Receives up to <code>length</code> datagrams, one into each buffer
+   * starting at <code>buffers[offset]</code>, advancing the position
+   * of each buffer filled.  If <code>addresses</code> is non-null, the
+   * sender of the datagram received into <code>buffers[offset + i]</code>
+   * is stored in <code>addresses[i]</code>.  A blocking channel waits
+   * for the first datagram only.  Returns the number of datagrams
+   * received, which may be fewer than requested.
+   */
+  public int receive(ByteBuffer[] buffers, int offset, int length,
+                     SocketAddress[] addresses)
+    throws IOException
+  {
+    if (length > MaxBatchLength) length = MaxBatchLength;
+    if (length <= 0) return 0;
+
+    ByteBuffer[] direct = new ByteBuffer[length];
+    byte[][] arrays = new byte[length][];
+    int[] ranges = new int[length * 2];
+    for (int i = 0; i < length; ++i) {
+      ByteBuffer b = buffers[offset + i];
+      if (b.isReadOnly()) throw new ReadOnlyBufferException();
+      setRange(b, i, direct, arrays, ranges);
+    }
+
+    int[] results = new int[length * 3];
+    int count = receiveBatch(socket, direct, arrays, length, ranges, results);
+
+    for (int i = 0; i < count; ++i) {
+      ByteBuffer b = buffers[offset + i];
+      b.position(b.position() + results[i * 3]);
+
+      if (addresses != null) {
+        addresses[i] = new InetSocketAddress
+          (ipv4ToString(results[(i * 3) + 1]), results[(i * 3) + 2]);
+      }
+    }
+
+    return count;
+  }
+
+  public int receive(ByteBuffer[] buffers, SocketAddress[] addresses)
+    throws IOException
+  {
+    return receive(buffers, 0, buffers.length, addresses);
+  }
+
+  /**
+   * Sends the remaining bytes of up to <code>length</code> buffers
+   * starting at <code>buffers[offset]</code> to the connected peer, one
+   * datagram per buffer, advancing the position of each buffer sent.
+   * Returns the number of datagrams sent, which may be fewer than
+   * requested.
+   */
+  public int write(ByteBuffer[] buffers, int offset, int length)
+    throws IOException
+  {
+    if (length > MaxBatchLength) length = MaxBatchLength;
+    if (length <= 0) return 0;
+
+    ByteBuffer[] direct = new ByteBuffer[length];
+    byte[][] arrays = new byte[length][];
+    int[] ranges = new int[length * 2];
+    for (int i = 0; i < length; ++i) {
+      setRange(buffers[offset + i], i, direct, arrays, ranges);
+    }
+
+    int count = writeBatch(socket, direct, arrays, length, ranges);
+
+    for (int i = 0; i < count; ++i) {
+      ByteBuffer b = buffers[offset + i];
+      b.position(b.limit());
+    }
+
+    return count;
+  }
+
+  public int write(ByteBuffer[] buffers) throws IOException {
+    return write(buffers, 0, buffers.length);
+  }
+
+  private static void setRange(ByteBuffer b, int index, ByteBuffer[] direct,
+                               byte[][] arrays, int[] ranges)
+  {
+    if (b.isDirect()) {
+      direct[index] = b;
+      ranges[index * 2] = b.position();
+    } else {
+      arrays[index] = b.array();
+      ranges[index * 2] = b.arrayOffset() + b.position();
+    }
+    ranges[(index * 2) + 1] = b.remaining();
+  }
+
   private static String ipv4ToString(int address) {
     StringBuilder sb = new StringBuilder();
 
@@ -177,4 +286,19 @@ public class DatagramChannel extends SelectableChannel
                                     int length, boolean blocking,
                                     int[] address)
     throws IOException;
+  private static native int writeDirect(int socket, ByteBuffer buffer,
+                                        int offset, int length)
+    throws IOException;
+  private static native int receiveDirect(int socket, ByteBuffer buffer,
+                                          int offset, int length,
+                                          int[] address)
+    throws IOException;
+  private static native int receiveBatch(int socket, ByteBuffer[] buffers,
+                                         byte[][] arrays, int length,
+                                         int[] ranges, int[] results)
+    throws IOException;
+  private static native int writeBatch(int socket, ByteBuffer[] buffers,
+                                       byte[][] arrays, int length,
+                                       int[] ranges)
+    throws IOException;
 }
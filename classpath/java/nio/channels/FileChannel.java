@@ -0,0 +1,159 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+
+public abstract class FileChannel
+  implements ReadableByteChannel, WritableByteChannel
+{
+  // The most transferTo maps at once when the kernel cannot do the
+  // transfer itself.
+  private static final int TransferChunkSize = 8 * 1024 * 1024;
+
+  private final int fd;
+  private final boolean readable;
+  private final boolean writable;
+  private boolean open = true;
+
+  protected FileChannel(int fd, boolean readable, boolean writable) {
+    this.fd = fd;
+    this.readable = readable;
+    this.writable = writable;
+  }
+
+  public boolean isOpen() {
+    return open;
+  }
+
+  public void close() throws IOException {
+    if (open) {
+      open = false;
+      implCloseChannel();
+    }
+  }
+
+  protected abstract void implCloseChannel() throws IOException;
+
+  private void checkOpen() throws IOException {
+    if (! open) {
+      throw new IOException("channel closed");
+    }
+  }
+
+  public long size() throws IOException {
+    checkOpen();
+
+    return natSize(fd);
+  }
+
+  public MappedByteBuffer map(MapMode mode, long position, long size)
+    throws IOException
+  {
+    checkOpen();
+
+    if (position < 0 || size < 0 || size > Integer.MAX_VALUE) {
+      throw new IllegalArgumentException();
+    }
+
+    // every mapping needs read access, and only read-only ones can do
+    // without write access
+    if (! readable) {
+      throw new NonReadableChannelException();
+    }
+
+    if (mode == MapMode.READ_WRITE && ! writable) {
+      throw new NonWritableChannelException();
+    }
+
+    return natMap(fd, mode.value, position, (int) size);
+  }
+
+  public long transferTo(long position, long count,
+                         WritableByteChannel target)
+    throws IOException
+  {
+    checkOpen();
+
+    if (position < 0 || count < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    if (! readable) {
+      throw new NonReadableChannelException();
+    }
+
+    long size = size();
+    if (position >= size || count == 0) {
+      return 0;
+    }
+
+    if (count > size - position) {
+      count = size - position;
+    }
+
+    if (target instanceof SocketChannel) {
+      long c = natTransferTo
+        (fd, position, count, ((SocketChannel) target).socketFD(), true);
+      if (c >= 0) {
+        return c;
+      }
+    } else if (target instanceof FileChannel) {
+      FileChannel f = (FileChannel) target;
+      if (! f.writable) {
+        throw new NonWritableChannelException();
+      }
+
+      long c = natTransferTo(fd, position, count, f.fd, false);
+      if (c >= 0) {
+        return c;
+      }
+    }
+
+    // the kernel can't send directly to this target, so map the region
+    // and write it in the usual way, which at least avoids copying it
+    // into the heap first
+    return target.write
+      (map(MapMode.READ_ONLY, position, Math.min(count, TransferChunkSize)));
+  }
+
+  public static class MapMode {
+    public static final MapMode READ_ONLY = new MapMode("READ_ONLY", 0);
+    public static final MapMode READ_WRITE = new MapMode("READ_WRITE", 1);
+    public static final MapMode PRIVATE = new MapMode("PRIVATE", 2);
+
+    private final String name;
+    private final int value;
+
+    private MapMode(String name, int value) {
+      this.name = name;
+      this.value = value;
+    }
+
+    public String toString() {
+      return name;
+    }
+  }
+
+  private static native long natSize(int fd) throws IOException;
+
+  private static native MappedByteBuffer natMap(int fd, int mode,
+                                                long position, int size)
+    throws IOException;
+
+  // returns -1 if the kernel cannot transfer to the target directly
+  private static native long natTransferTo(int fd, long position,
+                                           long count, int target,
+                                           boolean socket)
+    throws IOException;
+}
@@ -16,6 +16,7 @@ import java.net.InetSocketAddress;
 import java.net.SocketAddress;
 import java.net.ServerSocket;
 import java.net.Socket;
+import avian.Fiber;
 
 public class ServerSocketChannel extends SelectableChannel {
   private final SocketChannel channel;
@@ -56,7 +57,14 @@ public class ServerSocketChannel extends SelectableChannel {
   }
 
   private int doAccept() throws IOException {
+    boolean emulate = channel.emulateBlocking();
     while (true) {
+      // a non-blocking accept fails rather than returning nothing when
+      // no connection is pending, so wait for one first
+      if (emulate) {
+        Fiber.awaitReady(this, SelectionKey.OP_ACCEPT);
+      }
+
       int s = natDoAccept(channel.socket);
       if (s != -1) {
         return s;
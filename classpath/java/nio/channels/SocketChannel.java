@@ -16,9 +16,10 @@ import java.net.SocketAddress;
 import java.net.InetSocketAddress;
 import java.net.Socket;
 import java.nio.ByteBuffer;
+import avian.Fiber;
 
 public class SocketChannel extends SelectableChannel
-  implements ReadableByteChannel, GatheringByteChannel
+  implements ReadableByteChannel, GatheringByteChannel, ScatteringByteChannel
 {
   public static final int InvalidSocket = -1;
 
@@ -26,6 +27,7 @@ public class SocketChannel extends SelectableChannel
   boolean connected = false;
   boolean readyToConnect = false;
   boolean blocking = true;
+  boolean emulatingBlocking = false;
 
   public static SocketChannel open() throws IOException {
     Socket.init();
@@ -36,11 +38,25 @@ public class SocketChannel extends SelectableChannel
   public SelectableChannel configureBlocking(boolean v) throws IOException {
     blocking = v;
     if (socket != InvalidSocket) {
-      configureBlocking(socket, v);
+      configureBlocking(socket, v && ! emulatingBlocking);
     }
     return this;
   }
 
+  // A fiber must park rather than block its carrier thread, so once a
+  // blocking channel is used from a fiber we make the socket itself
+  // non-blocking and wait for it to become ready whenever an operation
+  // would block, whichever thread happens to be using it.
+  boolean emulateBlocking() throws IOException {
+    if (blocking && (! emulatingBlocking) && Fiber.current() != null) {
+      emulatingBlocking = true;
+      if (socket != InvalidSocket) {
+        configureBlocking(socket, false);
+      }
+    }
+    return blocking && emulatingBlocking;
+  }
+
   public boolean isBlocking() {
     return blocking;
   }
@@ -60,14 +76,23 @@ public class SocketChannel extends SelectableChannel
     } catch (ClassCastException e) {
       throw new UnsupportedAddressTypeException();
     }
+    boolean emulate = emulateBlocking();
     socket = doConnect(a.getHostName(), a.getPort());
     configureBlocking(blocking);
+    if (emulate) {
+      finishConnect();
+    }
     return connected;
   }
 
   public boolean finishConnect() throws IOException {
     if (! connected) {
       while (! readyToConnect) {
+        if (blocking && emulatingBlocking) {
+          Fiber.awaitReady(this, SelectionKey.OP_CONNECT);
+          continue;
+        }
+
         Selector selector = Selector.open();
         SelectionKey key = register(selector, SelectionKey.OP_CONNECT, null);
 
@@ -98,7 +123,7 @@ public class SocketChannel extends SelectableChannel
     if (host == null) throw new NullPointerException();
 
     boolean b[] = new boolean[1];
-    int s = natDoConnect(host, port, blocking, b);
+    int s = natDoConnect(host, port, blocking && ! emulatingBlocking, b);
     connected = b[0];
     return s;
   }
@@ -107,10 +132,22 @@ public class SocketChannel extends SelectableChannel
     if (! isOpen()) return -1;
     if (b.remaining() == 0) return 0;
 
-    byte[] array = b.array();
-    if (array == null) throw new NullPointerException();
+    boolean emulate = emulateBlocking();
+    int r;
+    while (true) {
+      if (b.isDirect()) {
+        r = natReadDirect(socket, b, b.position(), b.remaining());
+      } else {
+        byte[] array = b.array();
+        if (array == null) throw new NullPointerException();
+
+        r = natRead(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking && ! emulate);
+      }
+
+      if (r != 0 || ! emulate) break;
 
-    int r = natRead(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+      Fiber.awaitReady(this, SelectionKey.OP_READ);
+    }
     if (r > 0) {
       b.position(b.position() + r);
     }
@@ -123,10 +160,22 @@ public class SocketChannel extends SelectableChannel
     }
     if (b.remaining() == 0) return 0;
 
-    byte[] array = b.array();
-    if (array == null) throw new NullPointerException();
+    boolean emulate = emulateBlocking();
+    int w;
+    while (true) {
+      if (b.isDirect()) {
+        w = natWriteDirect(socket, b, b.position(), b.remaining());
+      } else {
+        byte[] array = b.array();
+        if (array == null) throw new NullPointerException();
+
+        w = natWrite(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking && ! emulate);
+      }
+
+      if (w != 0 || ! emulate) break;
 
-    int w = natWrite(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+      Fiber.awaitReady(this, SelectionKey.OP_WRITE);
+    }
     if (w > 0) {
       b.position(b.position() + w);
     }
@@ -140,6 +189,25 @@ public class SocketChannel extends SelectableChannel
   public long write(ByteBuffer[] srcs, int offset, int length)
     throws IOException
   {
+    if (allDirect(srcs, offset, length)) {
+      if (! connected) {
+        natThrowWriteError(socket);
+      }
+
+      boolean emulate = emulateBlocking();
+      long w;
+      while (true) {
+        w = natWriteVector
+          (socket, srcs, offset, length, ranges(srcs, offset, length));
+
+        if (w != 0 || ! emulate) break;
+
+        Fiber.awaitReady(this, SelectionKey.OP_WRITE);
+      }
+      advance(srcs, offset, length, w);
+      return w;
+    }
+
     long total = 0;
     for (int i = offset; i < offset + length; ++i) {
       total += write(srcs[i]);
@@ -150,6 +218,84 @@ public class SocketChannel extends SelectableChannel
     return total;
   }
 
+  public long read(ByteBuffer[] dsts) throws IOException {
+    return read(dsts, 0, dsts.length);
+  }
+
+  public long read(ByteBuffer[] dsts, int offset, int length)
+    throws IOException
+  {
+    if (allDirect(dsts, offset, length)) {
+      if (! isOpen()) return -1;
+
+      boolean emulate = emulateBlocking();
+      long r;
+      while (true) {
+        r = natReadVector
+          (socket, dsts, offset, length, ranges(dsts, offset, length));
+
+        if (r != 0 || ! emulate) break;
+
+        Fiber.awaitReady(this, SelectionKey.OP_READ);
+      }
+      advance(dsts, offset, length, r);
+      return r;
+    }
+
+    long total = 0;
+    for (int i = offset; i < offset + length; ++i) {
+      int r = read(dsts[i]);
+      if (r < 0) {
+        return total == 0 ? -1 : total;
+      }
+
+      total += r;
+      if (dsts[i].hasRemaining()) {
+        return total;
+      }
+    }
+    return total;
+  }
+
+  // Scattering reads and gathering writes go straight to the operating
+  // system when every buffer involved is direct, and fall back to one
+  // call per buffer otherwise.
+  private static boolean allDirect(ByteBuffer[] buffers, int offset,
+                                   int length)
+  {
+    if (offset < 0 || length < 0 || offset + length > buffers.length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    for (int i = offset; i < offset + length; ++i) {
+      if (! buffers[i].isDirect()) {
+        return false;
+      }
+    }
+    return length > 0;
+  }
+
+  private static int[] ranges(ByteBuffer[] buffers, int offset, int length) {
+    int[] ranges = new int[length * 2];
+    for (int i = 0; i < length; ++i) {
+      ByteBuffer b = buffers[offset + i];
+      ranges[i * 2] = b.position();
+      ranges[(i * 2) + 1] = b.remaining();
+    }
+    return ranges;
+  }
+
+  private static void advance(ByteBuffer[] buffers, int offset, int length,
+                              long count)
+  {
+    for (int i = offset; i < offset + length && count > 0; ++i) {
+      ByteBuffer b = buffers[i];
+      int n = (int) Math.min(b.remaining(), count);
+      b.position(b.position() + n);
+      count -= n;
+    }
+  }
+
   private void closeSocket() {
     natCloseSocket(socket);
   }
@@ -184,6 +330,14 @@ public class SocketChannel extends SelectableChannel
     throws IOException;
   private static native int natWrite(int socket, byte[] buffer, int offset, int length, boolean blocking)
     throws IOException;
+  private static native int natReadDirect(int socket, ByteBuffer buffer, int offset, int length)
+    throws IOException;
+  private static native int natWriteDirect(int socket, ByteBuffer buffer, int offset, int length)
+    throws IOException;
+  private static native long natReadVector(int socket, ByteBuffer[] buffers, int offset, int length, int[] ranges)
+    throws IOException;
+  private static native long natWriteVector(int socket, ByteBuffer[] buffers, int offset, int length, int[] ranges)
+    throws IOException;
   private static native void natThrowWriteError(int socket) throws IOException;
   private static native void natCloseSocket(int socket);
 }
@@ -12,13 +12,24 @@ package java.nio.channels;
 
 import java.io.IOException;
 import java.util.Iterator;
+import java.util.Map;
+import java.util.HashMap;
 import java.net.Socket;
 
 class SocketSelector extends Selector {
+  private static final int InitialEventCapacity = 64;
+
   protected volatile long state;
   protected final Object lock = new Object();
   protected boolean woken = false;
 
+  // The native backend (epoll, kqueue, or select, depending on the
+  // platform) keeps interest sets across calls, so we only tell it
+  // about changes, and it reports ready sockets as (socket, ops) pairs
+  // in this array rather than making us poll every key.
+  private final Map<Integer, Registration> registrations = new HashMap();
+  private int[] events = new int[InitialEventCapacity * 2];
+
   public SocketSelector() throws IOException {
     Socket.init();
 
@@ -65,46 +76,88 @@ class SocketSelector extends Selector {
     return doSelect(interval);
   }
 
+  private void unregister(SelectionKey key) {
+    int socket = key.channel().socketFD();
+    Registration r = registrations.get(socket);
+    if (r != null && r.key == key) {
+      registrations.remove(socket);
+      natSelectClearAll(socket, state);
+    }
+  }
+
+  private void register(SelectionKey key) throws IOException {
+    int socket = key.channel().socketFD();
+    Registration r = registrations.get(socket);
+    if (r == null || r.key != key) {
+      if (r != null) {
+        natSelectClearAll(socket, state);
+      }
+      r = new Registration(key);
+      registrations.put(socket, r);
+    }
+
+    int interest = key.interestOps();
+    if (interest != r.interest) {
+      natSelectUpdateInterestSet(socket, r.interest, interest, state);
+      r.interest = interest;
+    }
+  }
+
   public int doSelect(long interval) throws IOException {
     if (! isOpen()) {
       throw new ClosedSelectorException();
     }
 
+    for (SelectionKey key : selectedKeys) {
+      key.readyOps(0);
+    }
     selectedKeys.clear();
 
     if (clearWoken()) interval = -1;
 
-    int max=0;
+    // unregister closed channels before registering anything else, in
+    // case a new channel has reused a closed one's descriptor
     for (Iterator<SelectionKey> it = keys.iterator();
          it.hasNext();)
     {
       SelectionKey key = it.next();
-      SelectableChannel c = key.channel();
-      int socket = c.socketFD();
-      if (c.isOpen()) {
-        key.readyOps(0);
-        max = natSelectUpdateInterestSet
-          (socket, key.interestOps(), state, max);
-      } else {
-        natSelectClearAll(socket, state);
+      if (! key.channel().isOpen()) {
+        unregister(key);
         it.remove();
       }
     }
 
-    int r = natDoSocketSelect(state, max, interval);
+    for (SelectionKey key : keys) {
+      register(key);
+    }
+
+    int count = natDoSocketSelect(state, interval, events);
 
-    if (r > 0) {
-      for (SelectionKey key : keys) {
-        SelectableChannel c = key.channel();
-        int socket = c.socketFD();
-        int ready = natUpdateReadySet(socket, key.interestOps(), state);
-        key.readyOps(ready);
+    for (int i = 0; i < count; ++i) {
+      Registration r = registrations.get(events[i * 2]);
+      if (r != null) {
+        SelectionKey key = r.key;
+        int ready = events[(i * 2) + 1] & key.interestOps();
         if (ready != 0) {
-          c.handleReadyOps(ready);
-          selectedKeys.add(key);
+          // a socket may be reported more than once, once per kind of
+          // readiness
+          if (selectedKeys.add(key)) {
+            key.readyOps(ready);
+          } else {
+            key.readyOps(key.readyOps() | ready);
+          }
         }
       }
     }
+
+    for (SelectionKey key : selectedKeys) {
+      key.channel().handleReadyOps(key.readyOps());
+    }
+
+    if (count * 2 == events.length) {
+      events = new int[events.length * 2];
+    }
+
     clearWoken();
 
     return selectedKeys.size();
@@ -119,15 +172,25 @@ class SocketSelector extends Selector {
     }
   }
 
+  private static class Registration {
+    public final SelectionKey key;
+    public int interest;
+
+    public Registration(SelectionKey key) {
+      this.key = key;
+    }
+  }
+
   private static native long natInit();
   private static native void natWakeup(long state);
   private static native void natClose(long state);
   private static native void natSelectClearAll(int socket, long state);
-  private static native int natSelectUpdateInterestSet(int socket,
-                                                       int interest,
-                                                       long state,
-                                                       int max);
-  private static native int natDoSocketSelect(long state, int max, long interval)
+  private static native void natSelectUpdateInterestSet(int socket,
+                                                        int old,
+                                                        int interest,
+                                                        long state)
+    throws IOException;
+  private static native int natDoSocketSelect(long state, long interval,
+                                              int[] events)
     throws IOException;
-  private static native int natUpdateReadySet(int socket, int interest, long state);
 }
@@ -11,8 +11,19 @@
 package java.util;
 
 public class Arrays {
+  // primitive arrays at least this long are handed to the VM, which
+  // uses vector instructions where the processor has them; shorter
+  // ones are cheaper to handle here than to make a native call for
+  private static final int NativeThreshold = 32;
+
   private Arrays() { }
 
+  private static native void fillArray(Object array, int value);
+
+  private static native boolean arraysEqual(Object a, Object b);
+
+  private static native int arrayHashCode(Object array);
+
   public static String toString(Object[] a) {
     return asList(a).toString();
   }
@@ -72,6 +83,99 @@ public class Arrays {
     return hc;
   }
 
+  public static int hashCode(byte[] array) {
+    if (array == null) {
+      return 0;
+    } else if (array.length >= NativeThreshold) {
+      return arrayHashCode(array);
+    }
+
+    int hc = 1;
+    for (int i = 0; i < array.length; ++i) {
+      hc = (hc * 31) + array[i];
+    }
+    return hc;
+  }
+
+  public static int hashCode(char[] array) {
+    if (array == null) {
+      return 0;
+    } else if (array.length >= NativeThreshold) {
+      return arrayHashCode(array);
+    }
+
+    int hc = 1;
+    for (int i = 0; i < array.length; ++i) {
+      hc = (hc * 31) + array[i];
+    }
+    return hc;
+  }
+
+  public static int hashCode(int[] array) {
+    if (array == null) {
+      return 0;
+    } else if (array.length >= NativeThreshold) {
+      return arrayHashCode(array);
+    }
+
+    int hc = 1;
+    for (int i = 0; i < array.length; ++i) {
+      hc = (hc * 31) + array[i];
+    }
+    return hc;
+  }
+
+  public static boolean equals(byte[] a, byte[] b) {
+    if (a == b) {
+      return true;
+    } else if (a == null || b == null || a.length != b.length) {
+      return false;
+    } else if (a.length >= NativeThreshold) {
+      return arraysEqual(a, b);
+    }
+
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  public static boolean equals(char[] a, char[] b) {
+    if (a == b) {
+      return true;
+    } else if (a == null || b == null || a.length != b.length) {
+      return false;
+    } else if (a.length >= NativeThreshold) {
+      return arraysEqual(a, b);
+    }
+
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  public static boolean equals(int[] a, int[] b) {
+    if (a == b) {
+      return true;
+    } else if (a == null || b == null || a.length != b.length) {
+      return false;
+    } else if (a.length >= NativeThreshold) {
+      return arraysEqual(a, b);
+    }
+
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   public static boolean equals(Object[] a, Object[] b) {
     if(a == b) {
       return true;
@@ -185,15 +289,33 @@ public class Arrays {
     };
   }
 
+  public static void fill(byte[] array, byte value) {
+    if (array.length >= NativeThreshold) {
+      fillArray(array, value);
+    } else {
+      for (int i=0;i<array.length;i++) {
+        array[i] = value;
+      }
+    }
+  }
+
   public static void fill(int[] array, int value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
+    if (array.length >= NativeThreshold) {
+      fillArray(array, value);
+    } else {
+      for (int i=0;i<array.length;i++) {
+        array[i] = value;
+      }
     }
   }
 
   public static void fill(char[] array, char value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
+    if (array.length >= NativeThreshold) {
+      fillArray(array, value);
+    } else {
+      for (int i=0;i<array.length;i++) {
+        array[i] = value;
+      }
     }
   }
   
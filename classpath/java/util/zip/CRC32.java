@@ -10,41 +10,54 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+
 public class CRC32 {
-  private static final int Polynomial = 0x04C11DB7;
-  private static final int Width = 32;
-  private static final int Top = 1 << (Width - 1);
-  private static final int InitialRemainder = 0xFFFFFFFF;
-  private static final long ResultXor = 0xFFFFFFFFL;
+  // reflected form of 0x04C11DB7
+  private static final int Polynomial = 0xEDB88320;
+
+  // arrays at least this long are handed to native code, which may use
+  // carry-less multiplication or dedicated CRC instructions
+  private static final int NativeThreshold = 64;
 
   private static final int[] table = new int[256];
 
   static {
     for (int dividend = 0; dividend < 256; ++ dividend) {
-      int remainder = dividend << (Width - 8);
+      int remainder = dividend;
       for (int bit = 8; bit > 0; --bit) {
-        remainder = ((remainder & Top) != 0)
-          ? (remainder << 1) ^ Polynomial
-          : (remainder << 1);
+        remainder = ((remainder & 1) != 0)
+          ? (remainder >>> 1) ^ Polynomial
+          : (remainder >>> 1);
       }
       table[dividend] = remainder;
     }
   }
 
-  private int remainder = InitialRemainder;
+  private int crc;
 
   public void reset() {
-    remainder = InitialRemainder;
+    crc = 0;
   }
 
   public void update(int b) {
-    remainder = table[reflect(b, 8) ^ (remainder >>> (Width - 8))]
-      ^ (remainder << 8);
+    int c = ~crc;
+    crc = ~(table[(c ^ b) & 0xFF] ^ (c >>> 8));
   }
 
   public void update(byte[] array, int offset, int length) {
-    for (int i = 0; i < length; ++i) {
-      update(array[offset + i] & 0xFF);
+    if (offset < 0 || length < 0 || offset + length > array.length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
+    if (length >= NativeThreshold) {
+      crc = update(crc, array, null, offset, length);
+    } else {
+      int c = ~crc;
+      for (int i = offset; i < offset + length; ++i) {
+        c = table[(c ^ array[i]) & 0xFF] ^ (c >>> 8);
+      }
+      crc = ~c;
     }
   }
 
@@ -52,18 +65,25 @@ public class CRC32 {
     update(array, 0, array.length);
   }
 
-  public long getValue() {
-    return (reflect(remainder, Width) ^ ResultXor) & 0xFFFFFFFFL;
-  }
-
-  private static int reflect(int x, int n) {
-    int reflection = 0;
-    for (int i = 0; i < n; ++i) {
-      if ((x & 1) != 0) {
-        reflection |= (1 << ((n - 1) - i));
+  public void update(ByteBuffer buffer) {
+    int length = buffer.remaining();
+    if (buffer.hasArray()) {
+      update(buffer.array(), buffer.arrayOffset() + buffer.position(),
+             length);
+    } else if (buffer.isDirect()) {
+      crc = update(crc, null, buffer, buffer.position(), length);
+    } else {
+      for (int i = buffer.position(); i < buffer.limit(); ++i) {
+        update(buffer.get(i));
       }
-      x = (x >>> 1);
     }
-    return reflection;
+    buffer.position(buffer.limit());
+  }
+
+  public long getValue() {
+    return crc & 0xFFFFFFFFL;
   }
+
+  private static native int update(int crc, byte[] array, ByteBuffer buffer,
+                                   int offset, int length);
 }
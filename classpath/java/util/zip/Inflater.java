@@ -10,6 +10,9 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+
 public class Inflater {
   private static final int Z_OK = 0;
   private static final int Z_STREAM_END = 1;
@@ -21,6 +24,7 @@ public class Inflater {
 
   private long peer;
   private byte[] input;
+  private ByteBuffer inputBuffer;
   private int offset;
   private int length;
   private boolean needDictionary;
@@ -36,6 +40,12 @@ public class Inflater {
     this(false);
   }
 
+  private static void checkBounds(byte[] array, int offset, int length) {
+    if (offset < 0 || length < 0 || offset + length > array.length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+  }
+
   private void check() {
     if (peer == 0) {
       throw new IllegalStateException();      
@@ -65,15 +75,31 @@ public class Inflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    checkBounds(input, offset, length);
+
     this.input = input;
+    this.inputBuffer = null;
     this.offset = offset;
     this.length = length;
   }
 
+  public void setInput(ByteBuffer input) {
+    if (input.hasArray()) {
+      this.input = input.array();
+      this.offset = input.arrayOffset() + input.position();
+    } else {
+      this.input = null;
+      this.offset = input.position();
+    }
+    this.inputBuffer = input;
+    this.length = input.remaining();
+  }
+
   public void reset() {
     dispose();
     peer = make(nowrap);
     input = null;
+    inputBuffer = null;
     offset = length = 0;
     needDictionary = finished = false;
   }
@@ -84,6 +110,34 @@ public class Inflater {
 
   public int inflate(byte[] output, int offset, int length)
     throws DataFormatException
+  {
+    checkBounds(output, offset, length);
+
+    return inflate(output, null, offset, length);
+  }
+
+  public int inflate(ByteBuffer output)
+    throws DataFormatException
+  {
+    if (output.isReadOnly()) {
+      throw new ReadOnlyBufferException();
+    }
+
+    int count;
+    if (output.hasArray()) {
+      count = inflate(output.array(), null,
+                      output.arrayOffset() + output.position(),
+                      output.remaining());
+    } else {
+      count = inflate(null, output, output.position(), output.remaining());
+    }
+    output.position(output.position() + count);
+    return count;
+  }
+
+  private int inflate(byte[] output, ByteBuffer outputBuffer, int offset,
+                      int length)
+    throws DataFormatException
   {
     final int zlibResult = 0;
     final int inputCount = 1;
@@ -93,13 +147,13 @@ public class Inflater {
       throw new IllegalStateException();      
     }
 
-    if (input == null || output == null) {
+    if (input == null && inputBuffer == null) {
       throw new NullPointerException();
     }
 
     int[] results = new int[3];
-    inflate(peer, input, this.offset, this.length,
-            output, offset, length, results);
+    inflate(peer, input, inputBuffer, this.offset, this.length,
+            output, outputBuffer, offset, length, results);
 
     if (results[zlibResult] < 0) {
       throw new DataFormatException();
@@ -117,14 +171,19 @@ public class Inflater {
 
     this.offset += results[inputCount];
     this.length -= results[inputCount];
+    if (inputBuffer != null) {
+      inputBuffer.position(inputBuffer.position() + results[inputCount]);
+    }
     
     return results[outputCount];
   }
 
   private static native void inflate
     (long peer,
-     byte[] input, int inputOffset, int inputLength,
-     byte[] output, int outputOffset, int outputLength,
+     byte[] input, ByteBuffer inputBuffer, int inputOffset,
+     int inputLength,
+     byte[] output, ByteBuffer outputBuffer, int outputOffset,
+     int outputLength,
      int[] results);
 
   public void end() {
@@ -1,5 +1,7 @@
 package sun.misc;
 
+import java.lang.reflect.Field;
+
 public final class Unsafe {
   private void Unsafe() { }
 
@@ -50,6 +52,28 @@ public final class Unsafe {
 
   public native int arrayBaseOffset(Class arrayClass);
 
+  public native int arrayIndexScale(Class arrayClass);
+
+  public native long objectFieldOffset(Field field);
+
+  public native int getIntVolatile(Object o, long offset);
+
+  public native void putIntVolatile(Object o, long offset, int x);
+
+  public native void putOrderedInt(Object o, long offset, int x);
+
+  public native long getLongVolatile(Object o, long offset);
+
+  public native void putLongVolatile(Object o, long offset, long x);
+
+  public native void putOrderedLong(Object o, long offset, long x);
+
+  public native Object getObjectVolatile(Object o, long offset);
+
+  public native void putObjectVolatile(Object o, long offset, Object x);
+
+  public native void putOrderedObject(Object o, long offset, Object x);
+
   public native void copyMemory(Object srcBase, long srcOffset,
                                 Object destBase, long destOffset,
                                 long count);
@@ -9,8 +9,14 @@
    details. */
 
 #include "assembler.h"
+#include "last-move.h"
 #include "vector.h"
 
+#if (defined __linux__) && (defined __arm__) && (! defined __ARM_PCS_VFP)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 #define CAST1(x) reinterpret_cast<UnaryOperationType>(x)
 #define CAST2(x) reinterpret_cast<BinaryOperationType>(x)
 #define CAST3(x) reinterpret_cast<TernaryOperationType>(x)
@@ -173,20 +179,6 @@ inline int blo(int offset) { return SETCOND(b(offset), CC); }
 inline int bhs(int offset) { return SETCOND(b(offset), CS); }
 inline int bpl(int offset) { return SETCOND(b(offset), PL); }
 inline int fmstat() { return fmrx(15, FPSCR); }
-// HARDWARE FLAGS
-bool vfpSupported() {
-  // TODO: Use at runtime detection
-#if defined(__ARM_PCS_VFP)  
-  // armhf
-  return true;
-#else
-  // armel
-  // TODO: allow VFP use for -mfloat-abi=softfp armel builds.
-  // GCC -mfloat-abi=softfp flag allows use of VFP while remaining compatible
-  // with soft-float code. 
-  return false;
-#endif
-}
 }
 
 const uint64_t MASK_LO32 = 0xffffffff;
@@ -279,7 +271,7 @@ class Context {
     s(s), zone(zone), client(0), code(s, a, 1024), tasks(0), result(0),
     firstBlock(new(zone) MyBlock(this, 0)),
     lastBlock(firstBlock), poolOffsetHead(0), poolOffsetTail(0),
-    constantPool(0), constantPoolCount(0)
+    constantPool(0), constantPoolCount(0), rewrites(0)
   { }
 
   System* s;
@@ -294,6 +286,8 @@ class Context {
   PoolOffset* poolOffsetTail;
   ConstantPoolEntry* constantPool;
   unsigned constantPoolCount;
+  LastMove lastMove;
+  unsigned rewrites;
 };
 
 class Task {
@@ -322,9 +316,12 @@ typedef void (*BranchOperationType)
 
 class ArchitectureContext {
  public:
-  ArchitectureContext(System* s): s(s) { }
+  ArchitectureContext(System* s, bool useNativeFeatures):
+    s(s), useNativeFeatures(useNativeFeatures)
+  { }
 
   System* s;
+  bool useNativeFeatures;
   OperationType operations[OperationCount];
   UnaryOperationType unaryOperations[UnaryOperationCount
                                      * OperandTypeCount];
@@ -336,6 +333,56 @@ class ArchitectureContext {
   [BranchOperationCount * OperandTypeCount * OperandTypeCount];
 };
 
+#if (defined __linux__) && (defined __arm__) && (! defined __ARM_PCS_VFP)
+bool
+detectVfp()
+{
+  // look for HWCAP_VFP in the AT_HWCAP entry of the auxiliary vector:
+  const uint32_t AtHwcap = 16;
+  const uint32_t HwcapVfp = 1 << 6;
+
+  bool supported = false;
+  int fd = open("/proc/self/auxv", O_RDONLY);
+  if (fd >= 0) {
+    uint32_t entry[2];
+    while (read(fd, entry, sizeof(entry)) == sizeof(entry) and entry[0]) {
+      if (entry[0] == AtHwcap) {
+        supported = (entry[1] & HwcapVfp) != 0;
+        break;
+      }
+    }
+    close(fd);
+  }
+  return supported;
+}
+#endif
+
+// HARDWARE FLAGS
+bool
+vfpSupported(ArchitectureContext* c UNUSED)
+{
+#if defined(__ARM_PCS_VFP)
+  // armhf
+  return true;
+#elif (defined __linux__) && (defined __arm__)
+  // armel: as with -mfloat-abi=softfp, VFP may be used internally since
+  // floating point values cross native call boundaries in general
+  // purpose registers either way.  We can't assume the target has VFP
+  // when generating a boot image, though.
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectVfp();
+    }
+    return supported;
+  } else {
+    return false;
+  }
+#else
+  return false;
+#endif
+}
+
 inline void NO_RETURN
 abort(Context* con)
 {
@@ -2080,12 +2127,14 @@ populateTables(ArchitectureContext* con)
 
 class MyArchitecture: public Assembler::Architecture {
  public:
-  MyArchitecture(System* system): con(system), referenceCount(0) {
+  MyArchitecture(System* system, bool useNativeFeatures):
+    con(system, useNativeFeatures), referenceCount(0)
+  {
     populateTables(&con);
   }
 
   virtual unsigned floatRegisterSize() {
-    return vfpSupported() ? 8 : 0;
+    return vfpSupported(&con) ? 8 : 0;
   }
 
   virtual uint32_t generalRegisterMask() {
@@ -2093,7 +2142,7 @@ class MyArchitecture: public Assembler::Architecture {
   }
 
   virtual uint32_t floatRegisterMask() {
-    return vfpSupported() ? FPR_MASK : 0;
+    return vfpSupported(&con) ? FPR_MASK : 0;
   }
 
   virtual int scratch() {
@@ -2309,6 +2358,12 @@ class MyArchitecture: public Assembler::Architecture {
       break;
 
     case Absolute:
+    case PopulationCount:
+    case CountLeadingZeros:
+    case CountTrailingZeros:
+    case FloatFloor:
+    case FloatCeiling:
+    case FloatRound:
       *thunk = true;
       break;
 
@@ -2316,7 +2371,7 @@ class MyArchitecture: public Assembler::Architecture {
     case FloatSquareRoot:
     case FloatNegate:
     case Float2Float:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         *aTypeMask = (1 << RegisterOperand);
         *aRegisterMask = FPR_MASK64;
       } else {
@@ -2329,7 +2384,7 @@ class MyArchitecture: public Assembler::Architecture {
       // converting floats to integers, we we need to either use
       // thunks or produce inline machine code which handles edge
       // cases properly.
-      if (false && vfpSupported() && bSize == 4) {
+      if (false && vfpSupported(&con) && bSize == 4) {
         *aTypeMask = (1 << RegisterOperand);
         *aRegisterMask = FPR_MASK64;
       } else {
@@ -2338,7 +2393,7 @@ class MyArchitecture: public Assembler::Architecture {
       break;
 
     case Int2Float:
-      if (vfpSupported() && aSize == 4) {
+      if (vfpSupported(&con) && aSize == 4) {
         *aTypeMask = (1 << RegisterOperand);
         *aRegisterMask = GPR_MASK64;
       } else {
@@ -2406,7 +2461,7 @@ class MyArchitecture: public Assembler::Architecture {
       *srcTypeMask = 1 << RegisterOperand;
       *tmpTypeMask = 1 << RegisterOperand;
       *tmpRegisterMask = GPR_MASK64;
-    } else if (vfpSupported() &&
+    } else if (vfpSupported(&con) &&
                dstTypeMask & 1 << RegisterOperand &&
                dstRegisterMask & FPR_MASK) {
       *srcTypeMask = *tmpTypeMask = 1 << RegisterOperand |
@@ -2454,7 +2509,7 @@ class MyArchitecture: public Assembler::Architecture {
     case FloatSubtract:
     case FloatMultiply:
     case FloatDivide:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         *aTypeMask = *bTypeMask = (1 << RegisterOperand);
         *aRegisterMask = *bRegisterMask = FPR_MASK64;
       } else {
@@ -2472,7 +2527,7 @@ class MyArchitecture: public Assembler::Architecture {
     case JumpIfFloatGreaterOrUnordered:
     case JumpIfFloatLessOrEqualOrUnordered:
     case JumpIfFloatGreaterOrEqualOrUnordered:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         *aTypeMask = *bTypeMask = (1 << RegisterOperand);
         *aRegisterMask = *bRegisterMask = FPR_MASK64;
       } else {
@@ -2514,6 +2569,54 @@ class MyArchitecture: public Assembler::Architecture {
   unsigned referenceCount;
 };
 
+void
+forgetMove(Context* con)
+{
+  con->lastMove.forget();
+}
+
+void
+rememberMove(Context* con, unsigned aSize, OperandType aType,
+             Assembler::Operand* a, unsigned bSize, OperandType bType,
+             Assembler::Operand* b)
+{
+  con->lastMove.remember(con->code.length(), aSize, aType, a, bSize, bType, b);
+}
+
+// Returns true if the specified move need not be emitted as given,
+// either because it only repeats or undoes the move emitted just
+// before it, or because it reloads a register which that move just
+// stored, in which case it is replaced by a register-to-register move.
+bool
+rewriteMove(Context* con, unsigned aSize, OperandType aType,
+            Assembler::Operand* a, unsigned bSize, OperandType bType,
+            Assembler::Operand* b)
+{
+  LastMove* m = &(con->lastMove);
+  switch (m->match(con->code.length(), aSize, aType, a, bSize, bType, b)) {
+  case LastMove::Redundant:
+    ++ con->rewrites;
+    return true;
+
+  case LastMove::Reload: {
+    Assembler::Register* to = static_cast<Assembler::Register*>(b);
+    if (isFpr(to) == isFpr(&(m->a))) {
+      Assembler::Register from(m->a);
+      moveRR(con, aSize, &from, bSize, to);
+      rememberMove(con, aSize, RegisterOperand, &from, bSize,
+                   RegisterOperand, to);
+      ++ con->rewrites;
+      return true;
+    }
+  } break;
+
+  default:
+    break;
+  }
+
+  return false;
+}
+
 class MyAssembler: public Assembler {
  public:
   MyAssembler(System* s, Allocator* a, Zone* zone, MyArchitecture* arch):
@@ -2707,12 +2810,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual void apply(Operation op) {
+    forgetMove(&con);
+
     arch_->con.operations[op](&con);
   }
 
   virtual void apply(UnaryOperation op,
                      unsigned aSize, OperandType aType, Operand* aOperand)
   {
+    forgetMove(&con);
+
     arch_->con.unaryOperations[index(&(arch_->con), op, aType)]
       (&con, aSize, aOperand);
   }
@@ -2721,8 +2828,21 @@ class MyAssembler: public Assembler {
                      unsigned aSize, OperandType aType, Operand* aOperand,
                      unsigned bSize, OperandType bType, Operand* bOperand)
   {
-    arch_->con.binaryOperations[index(&(arch_->con), op, aType, bType)]
-      (&con, aSize, aOperand, bSize, bOperand);
+    if (op == Move) {
+      if (not rewriteMove
+          (&con, aSize, aType, aOperand, bSize, bType, bOperand))
+      {
+        arch_->con.binaryOperations[index(&(arch_->con), op, aType, bType)]
+          (&con, aSize, aOperand, bSize, bOperand);
+
+        rememberMove(&con, aSize, aType, aOperand, bSize, bType, bOperand);
+      }
+    } else {
+      forgetMove(&con);
+
+      arch_->con.binaryOperations[index(&(arch_->con), op, aType, bType)]
+        (&con, aSize, aOperand, bSize, bOperand);
+    }
   }
 
   virtual void apply(TernaryOperation op,
@@ -2732,6 +2852,8 @@ class MyAssembler: public Assembler {
                      unsigned cSize UNUSED, OperandType cType UNUSED,
                      Operand* cOperand)
   {
+    forgetMove(&con);
+
     if (isBranch(op)) {
       assert(&con, aSize == bSize);
       assert(&con, cSize == TargetBytesPerWord);
@@ -2832,10 +2954,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual Promise* offset(bool forTrace) {
+    // the next instruction may be a branch target, so it must not
+    // depend on the one before it:
+    forgetMove(&con);
+
     return ::offset(&con, forTrace);
   }
 
   virtual Block* endBlock(bool startNew) {
+    forgetMove(&con);
+
     MyBlock* b = con.lastBlock;
     b->size = con.code.length() - b->offset;
     if (startNew) {
@@ -2888,6 +3016,10 @@ class MyAssembler: public Assembler {
     return 0;
   }
 
+  virtual unsigned rewriteCount() {
+    return con.rewrites;
+  }
+
   virtual void dispose() {
     con.code.dispose();
   }
@@ -2901,9 +3033,10 @@ class MyAssembler: public Assembler {
 namespace vm {
 
 Assembler::Architecture*
-makeArchitecture(System* system, bool)
+makeArchitecture(System* system, bool useNativeFeatures)
 {
-  return new (allocate(system, sizeof(MyArchitecture))) MyArchitecture(system);
+  return new (allocate(system, sizeof(MyArchitecture)))
+    MyArchitecture(system, useNativeFeatures);
 }
 
 Assembler*
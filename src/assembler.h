@@ -66,11 +66,17 @@ enum BinaryOperation {
   FloatSquareRoot,
   FloatAbsolute,
   Absolute,
+  PopulationCount,
+  CountLeadingZeros,
+  CountTrailingZeros,
+  FloatFloor,
+  FloatCeiling,
+  FloatRound,
   
   NoBinaryOperation = -1
 };
 
-const unsigned BinaryOperationCount = Absolute + 1;
+const unsigned BinaryOperationCount = FloatRound + 1;
 
 enum TernaryOperation {
   Add,
@@ -463,6 +469,8 @@ class Assembler {
 
   virtual unsigned footerSize() = 0;
 
+  virtual unsigned rewriteCount() = 0;
+
   virtual void dispose() = 0;
 };
 
@@ -239,6 +239,33 @@ allFields(Thread* t, object typeMaps, object c, unsigned* count, object* array)
   return fields;
 }
 
+void
+sortFieldsByOffset(Thread* t, object fields, unsigned* order)
+{
+  // the VM may lay out a class's fields in a different order than
+  // they are declared, so we place each class's fields on the target
+  // in build offset order, keeping the zero entries which mark class
+  // boundaries where they are
+  for (unsigned i = 0; i < vectorSize(t, fields); ++i) {
+    order[i] = i;
+
+    object field = vectorBody(t, fields, i);
+    if (field) {
+      for (unsigned j = i; j > 0; --j) {
+        object previous = vectorBody(t, fields, order[j - 1]);
+        if (previous == 0
+            or fieldOffset(t, previous) <= fieldOffset(t, field))
+        {
+          break;
+        }
+
+        order[j] = order[j - 1];
+        order[j - 1] = i;
+      }
+    }
+  }
+}
+
 TypeMap*
 classTypeMap(Thread* t, object typeMaps, object p)
 {
@@ -271,10 +298,84 @@ targetFieldOffset(Thread* t, object typeMaps, object field)
     ->targetFixedOffsets()[fieldOffset(t, field)];
 }
 
+bool
+matches(const char* filter, const char* value)
+{
+  return filter == 0 or ::strcmp(filter, value) == 0;
+}
+
+// Compiles the methods named by a startup trace before any others so
+// that the code run at startup is contiguous in the image.  Each line
+// names a method as "<class>.<method><spec>", optionally preceded by
+// other words as in the log written to the file named by the
+// avian.jit.log property, which lists methods in the order they were
+// first invoked.  Methods excluded by the entry filters, or belonging
+// to classes we can't find, are ignored.
+void
+compileStartupMethods(Thread* t, Zone* zone, object* constants,
+                      object* calls, DelayedPromise** addresses,
+                      OffsetResolver* resolver, const char* trace,
+                      const char* className, const char* methodName,
+                      const char* methodSpec)
+{
+  FILE* in = vm::fopen(trace, "rb");
+  if (in == 0) {
+    fprintf(stderr, "unable to open %s\n", trace);
+    abort(t);
+  }
+
+  const unsigned LineSize = 4096;
+  char line[LineSize];
+  while (fgets(line, LineSize, in)) {
+    unsigned length = strlen(line);
+    while (length and (line[length - 1] == '\n' or line[length - 1] == '\r')) {
+      line[-- length] = 0;
+    }
+
+    char* name = strrchr(line, ' ');
+    name = name ? name + 1 : line;
+
+    char* spec = strchr(name, '(');
+    if (spec == 0) continue;
+
+    char* dot = spec;
+    while (dot > name and *dot != '.') -- dot;
+    if (dot == name) continue;
+
+    *dot = 0;
+    const char* class_ = name;
+    const char* method = dot + 1;
+
+    object c = 0;
+    if (className == 0 or ::strcmp(className, class_) == 0) {
+      c = resolveSystemClass
+        (t, root(t, Machine::BootLoader), makeByteArray(t, "%s", class_),
+         false);
+    }
+
+    if (c) {
+      char specBuffer[LineSize];
+      memcpy(specBuffer, spec, strlen(spec) + 1);
+      *spec = 0;
+
+      if (matches(methodName, method) and matches(methodSpec, specBuffer)) {
+        object m = findMethodOrNull(t, c, method, specBuffer);
+        if (m and (methodCode(t, m) or (methodFlags(t, m) & ACC_NATIVE))) {
+          t->m->processor->compileMethod
+            (t, zone, constants, calls, addresses, m, resolver);
+        }
+      }
+    }
+  }
+
+  fclose(in);
+}
+
 object
 makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
               const char* className, const char* methodName,
-              const char* methodSpec, object typeMaps)
+              const char* methodSpec, const char* startupTrace,
+              object typeMaps)
 {
   PROTECT(t, typeMaps);
 
@@ -422,6 +523,9 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
         Field memberFields[count + 1];
 
+        unsigned order[vectorSize(t, fields) + 1];
+        sortFieldsByOffset(t, fields, order);
+
         unsigned memberIndex;
         unsigned buildMemberOffset;
         unsigned targetMemberOffset;
@@ -470,7 +574,7 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
         unsigned targetStaticOffset = TargetBytesPerWord * StaticHeader;
 
         for (unsigned i = 0; i < vectorSize(t, fields); ++i) {
-          object field = vectorBody(t, fields, i);
+          object field = vectorBody(t, fields, order[i]);
           if (field) {
             unsigned buildSize = fieldSize(t, fieldCode(t, field));
             unsigned targetSize = buildSize;
@@ -590,6 +694,14 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
     }
   }
 
+  if (startupTrace) {
+    // methods compiled here are skipped when we reach them below,
+    // except for being added to the methods list
+    compileStartupMethods
+      (t, zone, &constants, &calls, &addresses, &resolver, startupTrace,
+       className, methodName, methodSpec);
+  }
+
   for (Finder::Iterator it(finder); it.hasMore();) {
     unsigned nameSize = 0;
     const char* name = it.next(&nameSize);
@@ -1274,12 +1386,12 @@ writeBootImage2(Thread* t, OutputStream* bootimageOutput, OutputStream* codeOutp
                 const char* methodName, const char* methodSpec,
                 const char* bootimageStart, const char* bootimageEnd,
                 const char* codeimageStart, const char* codeimageEnd,
-                bool useLZMA)
+                bool useLZMA, const char* startupTrace)
 {
   setRoot(t, Machine::OutOfMemoryError,
           make(t, type(t, Machine::OutOfMemoryErrorType)));
 
-  Zone zone(t->m->system, t->m->heap, 64 * 1024);
+  Zone zone(t->m->system, &(t->m->zonePool), 64 * 1024);
 
   class MyCompilationHandler : public Processor::CompilationHandler {
    public:
@@ -1465,7 +1577,8 @@ writeBootImage2(Thread* t, OutputStream* bootimageOutput, OutputStream* codeOutp
     }
 
     constants = makeCodeImage
-      (t, &zone, image, code, className, methodName, methodSpec, typeMaps);
+      (t, &zone, image, code, className, methodName, methodSpec,
+       startupTrace, typeMaps);
 
     PROTECT(t, constants);
 
@@ -1705,11 +1818,12 @@ writeBootImage(Thread* t, uintptr_t* arguments)
   const char* codeimageStart = reinterpret_cast<const char*>(arguments[9]);
   const char* codeimageEnd = reinterpret_cast<const char*>(arguments[10]);
   bool useLZMA = arguments[11];
+  const char* startupTrace = reinterpret_cast<const char*>(arguments[12]);
 
   writeBootImage2
     (t, bootimageOutput, codeOutput, image, code, className, methodName,
      methodSpec, bootimageStart, bootimageEnd, codeimageStart, codeimageEnd,
-     useLZMA);
+     useLZMA, startupTrace);
 
   return 1;
 }
@@ -1842,6 +1956,8 @@ public:
 
   bool useLZMA;
 
+  const char* startupTrace;
+
   bool maybeSplit(const char* src, char*& destA, char*& destB) {
     if(src) {
       const char* split = strchr(src, ':');
@@ -1872,6 +1988,7 @@ public:
     Arg bootimageSymbols(parser, false, "bootimage-symbols", "<start symbol name>:<end symbol name>");
     Arg codeimageSymbols(parser, false, "codeimage-symbols", "<start symbol name>:<end symbol name>");
     Arg useLZMA(parser, false, "use-lzma", 0);
+    Arg startupTrace(parser, false, "startup-trace", "<avian.jit.log file>");
 
     if(!parser.parse(ac, av)) {
       parser.printUsage(av[0]);
@@ -1882,6 +1999,7 @@ public:
     this->bootimage = bootimage.value;
     this->codeimage = codeimage.value;
     this->useLZMA = useLZMA.value != 0;
+    this->startupTrace = startupTrace.value;
 
     if(entry.value) {
       if(const char* entryClassEnd = strchr(entry.value, '.')) {
@@ -2033,7 +2151,8 @@ main(int ac, const char** av)
     reinterpret_cast<uintptr_t>(args.bootimageEnd),
     reinterpret_cast<uintptr_t>(args.codeimageStart),
     reinterpret_cast<uintptr_t>(args.codeimageEnd),
-    static_cast<uintptr_t>(args.useLZMA)
+    static_cast<uintptr_t>(args.useLZMA),
+    reinterpret_cast<uintptr_t>(args.startupTrace)
   };
 
   run(t, writeBootImage, arguments);
@@ -143,8 +143,53 @@ Avian_avian_Machine_dumpHeap
   }
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_dumpClassHistogram
+(Thread* t, object, uintptr_t* arguments)
+{
+  object outputFile = reinterpret_cast<object>(*arguments);
+
+  unsigned length = stringLength(t, outputFile);
+  THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+  stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
+  FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
+  if (out) {
+    { ENTER(t, Thread::ExclusiveState);
+      dumpClassHistogram(t, out);
+    }
+    fclose(out);
+  } else {
+    throwNew(t, Machine::RuntimeExceptionType, "file not found: %s", n);
+  }
+}
+
 #endif//AVIAN_HEAPDUMP
 
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_dumpNativeMemory
+(Thread* t, object, uintptr_t* arguments)
+{
+  object outputFile = reinterpret_cast<object>(*arguments);
+
+  unsigned length = stringLength(t, outputFile);
+  THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+  stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
+  FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
+  if (out) {
+    dumpNativeMemory(t->m, out);
+    fclose(out);
+  } else {
+    throwNew(t, Machine::RuntimeExceptionType, "file not found: %s", n);
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_finalizeQueueLength
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->finalizeQueueLength;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_java_lang_Runtime_exit
 (Thread* t, object, uintptr_t* arguments)
@@ -11,6 +11,7 @@
 #include "machine.h"
 #include "classpath-common.h"
 #include "process.h"
+#include "simd.h"
 
 using namespace vm;
 
@@ -21,7 +22,8 @@ namespace local {
 class MyClasspath : public Classpath {
  public:
   MyClasspath(Allocator* allocator):
-    allocator(allocator)
+    allocator(allocator),
+    simd(findSimd())
   { }
 
   virtual object
@@ -59,7 +61,7 @@ class MyClasspath : public Classpath {
   {
     PROTECT(t, vmMethod);
 
-    object jmethod = makeJmethod(t, vmMethod, false);
+    object jmethod = makeJmethod(t, vmMethod, false, 0, 0);
 
     return byteArrayBody(t, methodName(t, vmMethod), 0) == '<'
       ? makeJconstructor(t, jmethod) : jmethod;
@@ -132,8 +134,15 @@ class MyClasspath : public Classpath {
   }
 
   Allocator* allocator;
+  const Simd* simd;
 };
 
+const Simd*
+simd(Thread* t)
+{
+  return static_cast<MyClasspath*>(t->m->classpath)->simd;
+}
+
 void
 enumerateThreads(Thread* t, Thread* x, object array, unsigned* index,
                  unsigned limit)
@@ -148,6 +157,17 @@ enumerateThreads(Thread* t, Thread* x, object array, unsigned* index,
   }
 }
 
+// Returns the object whose monitor guards a 64-bit volatile access at
+// the specified offset in o on targets which cannot make one
+// atomically: the field there, as for bytecode accesses, or else the
+// array itself.
+object
+longLock(Thread* t, object o, int64_t offset)
+{
+  return classArrayElementSize(t, objectClass(t, o))
+    ? o : fieldForOffset(t, o, offset);
+}
+
 } // namespace local
 
 } // namespace
@@ -438,6 +458,72 @@ Avian_java_lang_String_intern
   return reinterpret_cast<int64_t>(intern(t, this_));
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_String_dataEquals
+(Thread* t, object, uintptr_t* arguments)
+{
+  object a = reinterpret_cast<object>(arguments[0]);
+  int32_t aOffset = arguments[1];
+  object b = reinterpret_cast<object>(arguments[2]);
+  int32_t bOffset = arguments[3];
+  int32_t length = arguments[4];
+
+  unsigned aSize = classArrayElementSize(t, objectClass(t, a));
+  unsigned bSize = classArrayElementSize(t, objectClass(t, b));
+
+  if (aSize == bSize) {
+    return local::simd(t)->equal
+      (&cast<uint8_t>(a, ArrayBody + (aOffset * aSize)),
+       &cast<uint8_t>(b, ArrayBody + (bOffset * bSize)),
+       length * aSize);
+  } else {
+    // one string is compact and the other is not, so compare them
+    // the way charAt would, sign extending the bytes
+    if (aSize == 2) {
+      object tmp = a; a = b; b = tmp;
+      int32_t tmpOffset = aOffset; aOffset = bOffset; bOffset = tmpOffset;
+    }
+
+    for (int32_t i = 0; i < length; ++i) {
+      if (static_cast<uint16_t>(byteArrayBody(t, a, aOffset + i))
+          != charArrayBody(t, b, bOffset + i))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_String_dataIndexOf
+(Thread* t, object, uintptr_t* arguments)
+{
+  object data = reinterpret_cast<object>(arguments[0]);
+  int32_t start = arguments[1];
+  int32_t end = arguments[2];
+  int32_t c = arguments[3];
+
+  int r;
+  if (classArrayElementSize(t, objectClass(t, data)) == 1) {
+    // charAt sign extends bytes, so only these chars can match one
+    if ((c >= 0 and c < 0x80) or (c >= 0xFF80 and c <= 0xFFFF)) {
+      r = local::simd(t)->indexOf8
+        (reinterpret_cast<uint8_t*>(&byteArrayBody(t, data, start)),
+         c, end - start);
+    } else {
+      r = -1;
+    }
+  } else if (c >= 0 and c <= 0xFFFF) {
+    r = local::simd(t)->indexOf16
+      (&charArrayBody(t, data, start), c, end - start);
+  } else {
+    r = -1;
+  }
+
+  return r < 0 ? r : start + r;
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_getVMProperty
 (Thread* t, object, uintptr_t* arguments)
@@ -483,6 +569,70 @@ Avian_java_lang_System_arraycopy
             arguments[4]);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fillArray
+(Thread* t, object, uintptr_t* arguments)
+{
+  object array = reinterpret_cast<object>(arguments[0]);
+  uint32_t value = arguments[1];
+
+  void* body = &cast<uint8_t>(array, ArrayBody);
+  unsigned length = cast<uintptr_t>(array, BytesPerWord);
+
+  switch (classArrayElementSize(t, objectClass(t, array))) {
+  case 1:
+    local::simd(t)->fill8(static_cast<uint8_t*>(body), value, length);
+    break;
+
+  case 2:
+    local::simd(t)->fill16(static_cast<uint16_t*>(body), value, length);
+    break;
+
+  case 4:
+    local::simd(t)->fill32(static_cast<uint32_t*>(body), value, length);
+    break;
+
+  default: abort(t);
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_util_Arrays_arraysEqual
+(Thread* t, object, uintptr_t* arguments)
+{
+  object a = reinterpret_cast<object>(arguments[0]);
+  object b = reinterpret_cast<object>(arguments[1]);
+
+  return local::simd(t)->equal
+    (&cast<uint8_t>(a, ArrayBody), &cast<uint8_t>(b, ArrayBody),
+     cast<uintptr_t>(a, BytesPerWord)
+     * classArrayElementSize(t, objectClass(t, a)));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_util_Arrays_arrayHashCode
+(Thread* t, object, uintptr_t* arguments)
+{
+  object array = reinterpret_cast<object>(arguments[0]);
+
+  void* body = &cast<uint8_t>(array, ArrayBody);
+  unsigned length = cast<uintptr_t>(array, BytesPerWord);
+
+  // the array is a byte, char or int array
+  switch (classArrayElementSize(t, objectClass(t, array))) {
+  case 1:
+    return local::simd(t)->hash8(1, static_cast<int8_t*>(body), length);
+
+  case 2:
+    return local::simd(t)->hash16(1, static_cast<uint16_t*>(body), length);
+
+  case 4:
+    return local::simd(t)->hash32(1, static_cast<int32_t*>(body), length);
+
+  default: abort(t);
+  }
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_identityHashCode
 (Thread* t, object, uintptr_t* arguments)
@@ -560,13 +710,13 @@ Avian_java_lang_Throwable_resolveTrace
   object trace = reinterpret_cast<object>(*arguments);
   PROTECT(t, trace);
 
-  unsigned length = objectArrayLength(t, trace);
+  unsigned length = traceLength(t, trace);
   object elementType = type(t, Machine::StackTraceElementType);
   object array = makeObjectArray(t, elementType, length);
   PROTECT(t, array);
 
   for (unsigned i = 0; i < length; ++i) {
-    object ste = makeStackTraceElement(t, objectArrayBody(t, trace, i));
+    object ste = makeStackTraceElement(t, trace, i);
     set(t, array, ArrayBody + (i * BytesPerWord), ste);
   }
 
@@ -648,6 +798,135 @@ Avian_java_lang_Thread_yield
   t->m->system->yield();
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_arrayIndexScale
+(Thread* t, object, uintptr_t* arguments)
+{
+  return classArrayElementSize
+    (t, jclassVmClass(t, reinterpret_cast<object>(arguments[1])));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_objectFieldOffset
+(Thread* t, object, uintptr_t* arguments)
+{
+  return fieldOffset
+    (t, jfieldVmField(t, reinterpret_cast<object>(arguments[1])));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_getIntVolatile
+(Thread*, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+
+  int32_t result = cast<int32_t>(o, offset);
+  loadMemoryBarrier();
+  return result;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putOrderedInt
+(Thread*, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+
+  storeStoreMemoryBarrier();
+  cast<int32_t>(o, offset) = arguments[4];
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putIntVolatile
+(Thread* t, object method, uintptr_t* arguments)
+{
+  Avian_sun_misc_Unsafe_putOrderedInt(t, method, arguments);
+  storeLoadMemoryBarrier();
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_getLongVolatile
+(Thread* t, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+
+  if (BytesPerWord < 8) {
+    object lock = local::longLock(t, o, offset);
+    PROTECT(t, lock);
+    acquire(t, lock);
+    int64_t result = cast<int64_t>(o, offset);
+    release(t, lock);
+    return result;
+  } else {
+    int64_t result = cast<int64_t>(o, offset);
+    loadMemoryBarrier();
+    return result;
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putOrderedLong
+(Thread* t, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+  int64_t value; memcpy(&value, arguments + 4, 8);
+
+  if (BytesPerWord < 8) {
+    object lock = local::longLock(t, o, offset);
+    PROTECT(t, lock);
+    acquire(t, lock);
+    cast<int64_t>(o, offset) = value;
+    release(t, lock);
+  } else {
+    storeStoreMemoryBarrier();
+    cast<int64_t>(o, offset) = value;
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putLongVolatile
+(Thread* t, object method, uintptr_t* arguments)
+{
+  Avian_sun_misc_Unsafe_putOrderedLong(t, method, arguments);
+  if (BytesPerWord == 8) {
+    storeLoadMemoryBarrier();
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_getObjectVolatile
+(Thread*, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+
+  uintptr_t result = cast<uintptr_t>(o, offset);
+  loadMemoryBarrier();
+  return result;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putOrderedObject
+(Thread* t, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+
+  storeStoreMemoryBarrier();
+  set(t, o, offset, reinterpret_cast<object>(arguments[4]));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_putObjectVolatile
+(Thread* t, object method, uintptr_t* arguments)
+{
+  Avian_sun_misc_Unsafe_putOrderedObject(t, method, arguments);
+  storeLoadMemoryBarrier();
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_avian_Atomic_getOffset
 (Thread* t, object, uintptr_t* arguments)
@@ -692,10 +971,11 @@ Avian_avian_Classes_defineVMClass
   int length = arguments[3];
 
   uint8_t* buffer = static_cast<uint8_t*>
-    (t->m->heap->allocate(length));
+    (t->m->heap->allocator(Heap::ClassMemory)->allocate(length));
   
   THREAD_RESOURCE2(t, uint8_t*, buffer, int, length,
-                   t->m->heap->free(buffer, length));
+                   t->m->heap->allocator(Heap::ClassMemory)->free
+                   (buffer, length));
 
   memcpy(buffer, &byteArrayBody(t, b, offset), length);
 
@@ -51,71 +51,11 @@ getTrace(Thread* t, unsigned skipCount)
 
   t->m->processor->walkStack(t, &v);
 
-  if (v.trace == 0) v.trace = makeObjectArray(t, 0);
+  if (v.trace == 0) v.trace = makeTrace(t, 0u);
 
   return v.trace;
 }
 
-bool
-compatibleArrayTypes(Thread* t, object a, object b)
-{
-  return classArrayElementSize(t, a)
-    and classArrayElementSize(t, b)
-    and (a == b
-         or (not ((classVmFlags(t, a) & PrimitiveFlag)
-                  or (classVmFlags(t, b) & PrimitiveFlag))));
-}
-
-void
-arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
-          int32_t dstOffset, int32_t length)
-{
-  if (LIKELY(src and dst)) {
-    if (LIKELY(compatibleArrayTypes
-               (t, objectClass(t, src), objectClass(t, dst))))
-    {
-      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
-
-      if (LIKELY(elementSize)) {
-        intptr_t sl = cast<uintptr_t>(src, BytesPerWord);
-        intptr_t dl = cast<uintptr_t>(dst, BytesPerWord);
-        if (LIKELY(length > 0)) {
-          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
-                     dstOffset >= 0 and dstOffset + length <= dl))
-          {
-            uint8_t* sbody = &cast<uint8_t>(src, ArrayBody);
-            uint8_t* dbody = &cast<uint8_t>(dst, ArrayBody);
-            if (src == dst) {
-              memmove(dbody + (dstOffset * elementSize),
-                      sbody + (srcOffset * elementSize),
-                      length * elementSize);
-            } else {
-              memcpy(dbody + (dstOffset * elementSize),
-                     sbody + (srcOffset * elementSize),
-                     length * elementSize);
-            }
-
-            if (classObjectMask(t, objectClass(t, dst))) {
-              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
-            }
-
-            return;
-          } else {
-            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
-          }
-        } else {
-          return;
-        }
-      }
-    }
-  } else {
-    throwNew(t, Machine::NullPointerExceptionType);
-    return;
-  }
-
-  throwNew(t, Machine::ArrayStoreExceptionType);
-}
-
 void
 runOnLoadIfFound(Thread* t, System::Library* library)
 {
@@ -255,8 +195,9 @@ clone(Thread* t, object o)
   if (classArrayElementSize(t, class_)) {
     clone = static_cast<object>(allocate(t, size, classObjectMask(t, class_)));
     memcpy(clone, o, size);
-    // clear any object header flags:
-    setObjectClass(t, o, objectClass(t, o));
+    // clear any object header flags, which describe the original
+    // rather than the clone, e.g. whether its hash has been taken:
+    cast<object>(clone, 0) = objectClass(t, o);
   } else {
     clone = make(t, class_);
     memcpy(reinterpret_cast<void**>(clone) + 1,
@@ -268,11 +209,14 @@ clone(Thread* t, object o)
 }
 
 object
-makeStackTraceElement(Thread* t, object e)
+makeStackTraceElement(Thread* t, object trace, unsigned index)
 {
+  object e = traceMethod(t, trace, index);
   PROTECT(t, e);
 
-  object class_ = className(t, methodClass(t, traceElementMethod(t, e)));
+  int ip = traceIp(t, trace, index);
+
+  object class_ = className(t, methodClass(t, e));
   PROTECT(t, class_);
 
   THREAD_RUNTIME_ARRAY(t, char, s, byteArrayLength(t, class_));
@@ -280,16 +224,15 @@ makeStackTraceElement(Thread* t, object e)
           reinterpret_cast<char*>(&byteArrayBody(t, class_, 0)));
   class_ = makeString(t, "%s", RUNTIME_ARRAY_BODY(s));
 
-  object method = methodName(t, traceElementMethod(t, e));
+  object method = methodName(t, e);
   PROTECT(t, method);
 
   method = t->m->classpath->makeString
     (t, method, 0, byteArrayLength(t, method) - 1);
 
-  unsigned line = t->m->processor->lineNumber
-    (t, traceElementMethod(t, e), traceElementIp(t, e));
+  unsigned line = t->m->processor->lineNumber(t, e, ip);
 
-  object file = classSourceFile(t, methodClass(t, traceElementMethod(t, e)));
+  object file = classSourceFile(t, methodClass(t, e));
   file = file ? t->m->classpath->makeString
     (t, file, 0, byteArrayLength(t, file) - 1) : 0;
 
@@ -329,6 +272,62 @@ translateInvokeResult(Thread* t, unsigned returnCode, object o)
   }
 }
 
+object
+fieldForOffsetInClass(Thread* t, object c, unsigned offset)
+{
+  object super = classSuper(t, c);
+  if (super) {
+    object field = fieldForOffsetInClass(t, super, offset);
+    if (field) {
+      return field;
+    }
+  }
+
+  object table = classFieldTable(t, c);
+  if (table) {
+    for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+      object field = objectArrayBody(t, table, i);
+      if ((fieldFlags(t, field) & ACC_STATIC) == 0
+          and fieldOffset(t, field) == offset)
+      {
+        return field;
+      }
+    }
+  }
+
+  return 0;
+}
+
+// Returns the field of o, or of its class if o is a static table, at
+// the specified offset, which must exist.
+object
+fieldForOffset(Thread* t, object o, unsigned offset)
+{
+  object c = objectClass(t, o);
+  if (classVmFlags(t, c) & SingletonFlag) {
+    c = singletonObject(t, o, 0);
+    object table = classFieldTable(t, c);
+    if (table) {
+      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+        object field = objectArrayBody(t, table, i);
+        if ((fieldFlags(t, field) & ACC_STATIC)
+            and fieldOffset(t, field) == offset)
+        {
+          return field;
+        }
+      }
+    }
+    abort(t);
+  } else {
+    object field = fieldForOffsetInClass(t, c, offset);
+    if (field) {
+      return field;
+    } else {
+      abort(t);
+    }
+  }
+}
+
 } // namespace vm
 
 #endif//CLASSPATH_COMMON_H
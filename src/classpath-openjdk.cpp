@@ -510,6 +510,7 @@ class MyClasspath : public Classpath {
       }
 
       array = charArray;
+      offset = 0;
     } else {
       expect(t, objectClass(t, array) == type(t, Machine::CharArrayType));
     }
@@ -868,7 +869,8 @@ getFinder(Thread* t, const char* name, unsigned nameLength)
     unsigned size;
     uint8_t* data = function(&size);
     if (data) {
-      Finder* f = makeFinder(t->m->system, t->m->heap, data, size);
+      Finder* f = makeFinder
+        (t->m->system, t->m->heap->allocator(Heap::FinderMemory), data, size);
       object finder = makeFinder
         (t, f, n, root(t, Machine::VirtualFileFinders));
 
@@ -1937,7 +1939,7 @@ intercept(Thread* t, object c, const char* name, const char* spec,
 
     methodFlags(t, m) |= ACC_NATIVE;
 
-    object native = makeNativeIntercept(t, function, true, clone);
+    object native = makeNativeIntercept(t, function, true, false, clone);
 
     PROTECT(t, native);
 
@@ -2185,6 +2187,57 @@ countConstructors(Thread* t, object c, bool publicOnly)
   return count;
 }
 
+// Slots of the cache of reflective arrays in a class's runtime data.
+// Each array is built the first time it is asked for, and then only
+// copied, since java.lang.Class keeps the objects we return and hands
+// out copies of them, and Class objects are unique anyway.  A class
+// cannot be redefined, so nothing ever invalidates these.
+enum ReflectionCacheSlot {
+  DeclaredMethodsCache,
+  PublicMethodsCache,
+  DeclaredFieldsCache,
+  PublicFieldsCache,
+  DeclaredConstructorsCache,
+  PublicConstructorsCache,
+  DeclaredClassesCache,
+  InterfacesCache,
+  ReflectionCacheSize
+};
+
+object
+cachedReflection(Thread* t, object c, ReflectionCacheSlot slot)
+{
+  object runtimeData = getClassRuntimeDataIfExists(t, c);
+  if (runtimeData) {
+    object cache = classRuntimeDataReflectionCache(t, runtimeData);
+    if (cache) {
+      return arrayBody(t, cache, slot);
+    }
+  }
+  return 0;
+}
+
+// Caches the specified array for the specified class, returning a
+// copy for the caller to hand out.
+object
+cacheReflection(Thread* t, object c, ReflectionCacheSlot slot, object array)
+{
+  PROTECT(t, array);
+
+  object runtimeData = getClassRuntimeData(t, c);
+  PROTECT(t, runtimeData);
+
+  if (classRuntimeDataReflectionCache(t, runtimeData) == 0) {
+    object cache = makeArray(t, ReflectionCacheSize);
+    set(t, runtimeData, ClassRuntimeDataReflectionCache, cache);
+  }
+
+  set(t, classRuntimeDataReflectionCache(t, runtimeData),
+      ArrayBody + (slot * BytesPerWord), array);
+
+  return clone(t, array);
+}
+
 object
 resolveClassBySpec(Thread* t, object loader, const char* spec,
                    unsigned specLength)
@@ -2626,60 +2679,6 @@ pipeAvailable(int fd, int* available)
 #endif
 }
 
-object
-fieldForOffsetInClass(Thread* t, object c, unsigned offset)
-{
-  object super = classSuper(t, c);
-  if (super) {
-    object field = fieldForOffsetInClass(t, super, offset);
-    if (field) {
-      return field;
-    }
-  }
-
-  object table = classFieldTable(t, c);
-  if (table) {
-    for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
-      object field = objectArrayBody(t, table, i);
-      if ((fieldFlags(t, field) & ACC_STATIC) == 0
-          and fieldOffset(t, field) == offset)
-      {
-        return field;
-      }
-    }
-  }
-
-  return 0;
-}
-
-object
-fieldForOffset(Thread* t, object o, unsigned offset)
-{
-  object c = objectClass(t, o);
-  if (classVmFlags(t, c) & SingletonFlag) {
-    c = singletonObject(t, o, 0);
-    object table = classFieldTable(t, c);
-    if (table) {
-      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
-        object field = objectArrayBody(t, table, i);
-        if ((fieldFlags(t, field) & ACC_STATIC)
-            and fieldOffset(t, field) == offset)
-        {
-          return field;
-        }
-      }
-    }
-    abort(t);
-  } else {
-    object field = fieldForOffsetInClass(t, c, offset);
-    if (field) {
-      return field;
-    } else {
-      abort(t);
-    }
-  }
-}
-
 } // namespace local
 
 } // namespace
@@ -2752,10 +2751,12 @@ Avian_sun_misc_Unsafe_defineClass__Ljava_lang_String_2_3BIILjava_lang_ClassLoade
   object loader = reinterpret_cast<object>(arguments[5]);
   //object domain = reinterpret_cast<object>(arguments[6]);
 
-  uint8_t* buffer = static_cast<uint8_t*>(t->m->heap->allocate(length));
+  uint8_t* buffer = static_cast<uint8_t*>
+    (t->m->heap->allocator(Heap::ClassMemory)->allocate(length));
 
   THREAD_RESOURCE2(t, uint8_t*, buffer, int, length,
-                   t->m->heap->free(buffer, length));
+                   t->m->heap->allocator(Heap::ClassMemory)->free
+                   (buffer, length));
 
   memcpy(buffer, &byteArrayBody(t, data, offset), length);
 
@@ -2922,7 +2923,7 @@ Avian_sun_misc_Unsafe_getLongVolatile
 
   object field;
   if (BytesPerWord < 8) {
-    field = local::fieldForOffset(t, o, offset);
+    field = fieldForOffset(t, o, offset);
 
     PROTECT(t, field);
     acquire(t, field);        
@@ -3100,7 +3101,7 @@ Avian_sun_misc_Unsafe_compareAndSwapLong
   return atomicCompareAndSwap64
     (&cast<uint64_t>(target, offset), expect, update);
 #else
-  ACQUIRE_FIELD_FOR_WRITE(t, local::fieldForOffset(t, target, offset));
+  ACQUIRE_FIELD_FOR_WRITE(t, fieldForOffset(t, target, offset));
   if (cast<uint64_t>(target, offset) == expect) {
     cast<uint64_t>(target, offset) = update;
     return true;
@@ -3597,7 +3598,7 @@ EXPORT(JVM_GetStackTraceDepth)(Thread* t, jobject throwable)
 {
   ENTER(t, Thread::ActiveState);
 
-  return objectArrayLength(t, throwableTrace(t, *throwable));
+  return traceLength(t, throwableTrace(t, *throwable));
 }
 
 uint64_t
@@ -3608,8 +3609,7 @@ jvmGetStackTraceElement(Thread* t, uintptr_t* arguments)
 
   return reinterpret_cast<uint64_t>
     (makeLocalReference
-     (t, makeStackTraceElement
-      (t, objectArrayBody(t, throwableTrace(t, *throwable), index))));
+     (t, makeStackTraceElement(t, throwableTrace(t, *throwable), index)));
 }
 
 extern "C" JNIEXPORT jobject JNICALL
@@ -3833,14 +3833,13 @@ jvmDumpThreads(Thread* t, uintptr_t* arguments)
       object trace = t->m->processor->getStackTrace(t, peer);
       PROTECT(t, trace);
 
-      unsigned traceLength = objectArrayLength(t, trace);
+      unsigned length = traceLength(t, trace);
       object array = makeObjectArray
-        (t, type(t, Machine::StackTraceElementType), traceLength);
+        (t, type(t, Machine::StackTraceElementType), length);
       PROTECT(t, array);
 
-      for (unsigned traceIndex = 0; traceIndex < traceLength; ++ traceIndex) {
-        object ste = makeStackTraceElement
-          (t, objectArrayBody(t, trace, traceIndex));
+      for (unsigned traceIndex = 0; traceIndex < length; ++ traceIndex) {
+        object ste = makeStackTraceElement(t, trace, traceIndex);
         set(t, array, ArrayBody + (traceIndex * BytesPerWord), ste);
       }
 
@@ -3872,12 +3871,11 @@ jvmGetClassContext(Thread* t, uintptr_t*)
   PROTECT(t, trace);
 
   object context = makeObjectArray
-    (t, type(t, Machine::JclassType), objectArrayLength(t, trace));
+    (t, type(t, Machine::JclassType), traceLength(t, trace));
   PROTECT(t, context);
 
-  for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-    object c = getJClass
-      (t, methodClass(t, traceElementMethod(t, objectArrayBody(t, trace, i))));
+  for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+    object c = getJClass(t, methodClass(t, traceMethod(t, trace, i)));
 
     set(t, context, ArrayBody + (i * BytesPerWord), c);
   }
@@ -4381,27 +4379,38 @@ jvmGetClassInterfaces(Thread* t, uintptr_t* arguments)
 {
   jclass c = reinterpret_cast<jclass>(arguments[0]);
 
+  object cached = local::cachedReflection
+    (t, jclassVmClass(t, *c), local::InterfacesCache);
+  if (cached) {
+    return reinterpret_cast<uint64_t>
+      (makeLocalReference(t, clone(t, cached)));
+  }
+
+  object array = 0;
   object addendum = classAddendum(t, jclassVmClass(t, *c));
   if (addendum) {
     object table = classAddendumInterfaceTable(t, addendum);
     if (table) {
       PROTECT(t, table);
 
-      object array = makeObjectArray(t, arrayLength(t, table));
+      array = makeObjectArray(t, arrayLength(t, table));
       PROTECT(t, array);
 
       for (unsigned i = 0; i < arrayLength(t, table); ++i) {
         object c = getJClass(t, arrayBody(t, table, i));
         set(t, array, ArrayBody + (i * BytesPerWord), c);
       }
-
-      return reinterpret_cast<uint64_t>(makeLocalReference(t, array));
     }
   }
 
+  if (array == 0) {
+    array = makeObjectArray(t, type(t, Machine::JclassType), 0);
+  }
+
   return reinterpret_cast<uint64_t>
     (makeLocalReference
-     (t, makeObjectArray(t, type(t, Machine::JclassType), 0)));
+     (t, local::cacheReflection
+      (t, jclassVmClass(t, *c), local::InterfacesCache, array)));
 }
 
 extern "C" JNIEXPORT jobjectArray JNICALL
@@ -4549,6 +4558,14 @@ jvmGetDeclaredClasses(Thread* t, uintptr_t* arguments)
 {
   jclass c = reinterpret_cast<jobject>(arguments[0]);
 
+  object cached = local::cachedReflection
+    (t, jclassVmClass(t, *c), local::DeclaredClassesCache);
+  if (cached) {
+    return reinterpret_cast<uintptr_t>
+      (makeLocalReference(t, clone(t, cached)));
+  }
+
+  object result = 0;
   object addendum = classAddendum(t, jclassVmClass(t, *c));
   if (addendum) {
     object table = classAddendumInnerClassTable(t, addendum);
@@ -4562,7 +4579,7 @@ jvmGetDeclaredClasses(Thread* t, uintptr_t* arguments)
         }
       }
 
-      object result = makeObjectArray(t, count);
+      result = makeObjectArray(t, count);
       PROTECT(t, result);
 
       for (unsigned i = 0; i < arrayLength(t, table); ++i) {
@@ -4576,13 +4593,17 @@ jvmGetDeclaredClasses(Thread* t, uintptr_t* arguments)
           set(t, result, ArrayBody + (count * BytesPerWord), inner);
         }
       }
-
-      return reinterpret_cast<uintptr_t>(makeLocalReference(t, result));
     }
   }
 
+  if (result == 0) {
+    result = makeObjectArray(t, 0);
+  }
+
   return reinterpret_cast<uintptr_t>
-    (makeLocalReference(t, makeObjectArray(t, 0)));
+    (makeLocalReference
+     (t, local::cacheReflection
+      (t, jclassVmClass(t, *c), local::DeclaredClassesCache, result)));
 }
 
 extern "C" JNIEXPORT jobjectArray JNICALL
@@ -4657,11 +4678,21 @@ jvmGetClassDeclaredMethods(Thread* t, uintptr_t* arguments)
   jclass c = reinterpret_cast<jclass>(arguments[0]);
   jboolean publicOnly = arguments[1];
 
+  local::ReflectionCacheSlot slot = publicOnly
+    ? local::PublicMethodsCache : local::DeclaredMethodsCache;
+
+  object cached = local::cachedReflection(t, jclassVmClass(t, *c), slot);
+  if (cached) {
+    return reinterpret_cast<uint64_t>
+      (makeLocalReference(t, clone(t, cached)));
+  }
+
+  object array;
   object table = getClassMethodTable(t, jclassVmClass(t, *c));
   if (table) {
     PROTECT(t, table);
 
-    object array = makeObjectArray
+    array = makeObjectArray
       (t, type(t, Machine::JmethodType),
        local::countMethods(t, jclassVmClass(t, *c), publicOnly));
     PROTECT(t, array);
@@ -4681,13 +4712,13 @@ jvmGetClassDeclaredMethods(Thread* t, uintptr_t* arguments)
         set(t, array, ArrayBody + ((ai++) * BytesPerWord), method);
       }
     }
-
-    return reinterpret_cast<uint64_t>(makeLocalReference(t, array));
   } else {
-    return reinterpret_cast<uint64_t>
-      (makeLocalReference
-       (t, makeObjectArray(t, type(t, Machine::JmethodType), 0)));
+    array = makeObjectArray(t, type(t, Machine::JmethodType), 0);
   }
+
+  return reinterpret_cast<uint64_t>
+    (makeLocalReference
+     (t, local::cacheReflection(t, jclassVmClass(t, *c), slot, array)));
 }
 
 extern "C" JNIEXPORT jobjectArray JNICALL
@@ -4704,11 +4735,22 @@ jvmGetClassDeclaredFields(Thread* t, uintptr_t* arguments)
 {
   jclass c = reinterpret_cast<jclass>(arguments[0]);
   jboolean publicOnly = arguments[1];
+
+  local::ReflectionCacheSlot slot = publicOnly
+    ? local::PublicFieldsCache : local::DeclaredFieldsCache;
+
+  object cached = local::cachedReflection(t, jclassVmClass(t, *c), slot);
+  if (cached) {
+    return reinterpret_cast<uint64_t>
+      (makeLocalReference(t, clone(t, cached)));
+  }
+
+  object array;
   object table = classFieldTable(t, jclassVmClass(t, *c));
   if (table) {
     PROTECT(t, table);
 
-    object array = makeObjectArray
+    array = makeObjectArray
       (t, type(t, Machine::JfieldType),
        local::countFields(t, jclassVmClass(t, *c), publicOnly));
     PROTECT(t, array);
@@ -4727,13 +4769,13 @@ jvmGetClassDeclaredFields(Thread* t, uintptr_t* arguments)
       }
     }
     assert(t, ai == objectArrayLength(t, array));
-
-    return reinterpret_cast<uint64_t>(makeLocalReference(t, array));
   } else {
-    return reinterpret_cast<uint64_t>
-      (makeLocalReference
-       (t, makeObjectArray(t, type(t, Machine::JfieldType), 0)));
+    array = makeObjectArray(t, type(t, Machine::JfieldType), 0);
   }
+
+  return reinterpret_cast<uint64_t>
+    (makeLocalReference
+     (t, local::cacheReflection(t, jclassVmClass(t, *c), slot, array)));
 }
 
 extern "C" JNIEXPORT jobjectArray JNICALL
@@ -4751,11 +4793,21 @@ jvmGetClassDeclaredConstructors(Thread* t, uintptr_t* arguments)
   jclass c = reinterpret_cast<jclass>(arguments[0]);
   jboolean publicOnly = arguments[1];
 
+  local::ReflectionCacheSlot slot = publicOnly
+    ? local::PublicConstructorsCache : local::DeclaredConstructorsCache;
+
+  object cached = local::cachedReflection(t, jclassVmClass(t, *c), slot);
+  if (cached) {
+    return reinterpret_cast<uint64_t>
+      (makeLocalReference(t, clone(t, cached)));
+  }
+
+  object array;
   object table = getClassMethodTable(t, jclassVmClass(t, *c));
   if (table) {
     PROTECT(t, table);
 
-    object array = makeObjectArray
+    array = makeObjectArray
       (t, type(t, Machine::JconstructorType),
        local::countConstructors(t, jclassVmClass(t, *c), publicOnly));
     PROTECT(t, array);
@@ -4777,13 +4829,13 @@ jvmGetClassDeclaredConstructors(Thread* t, uintptr_t* arguments)
         set(t, array, ArrayBody + ((ai++) * BytesPerWord), method);
       }
     }
-
-    return reinterpret_cast<uint64_t>(makeLocalReference(t, array));
   } else {
-    return reinterpret_cast<uint64_t>
-      (makeLocalReference
-       (t, makeObjectArray(t, type(t, Machine::JconstructorType), 0)));
+    array = makeObjectArray(t, type(t, Machine::JconstructorType), 0);
   }
+
+  return reinterpret_cast<uint64_t>
+    (makeLocalReference
+     (t, local::cacheReflection(t, jclassVmClass(t, *c), slot, array)));
 }
 
 extern "C" JNIEXPORT jobjectArray JNICALL
@@ -378,6 +378,19 @@ log(unsigned n)
   return r;
 }
 
+// returns the index of the lowest set bit in w, which must be nonzero
+inline unsigned
+lowestBit(uintptr_t w)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(w);
+#else
+  unsigned r = 0;
+  for (; (w & 1) == 0; w >>= 1) ++r;
+  return r;
+#endif
+}
+
 template <class T>
 inline unsigned
 wordOf(unsigned i)
@@ -488,6 +501,50 @@ mask(T* p)
   return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(p) & PointerMask);
 }
 
+// Returns the number of leading bytes of the specified range which
+// are ASCII, testing a word at a time until the first that is not.
+inline unsigned
+asciiLength(const uint8_t* s, unsigned length)
+{
+  const uintptr_t Mask = static_cast<uintptr_t>(0x8080808080808080ULL);
+
+  unsigned i = 0;
+  for (; i + BytesPerWord <= length; i += BytesPerWord) {
+    uintptr_t w; memcpy(&w, s + i, BytesPerWord);
+    if (w & Mask) {
+      break;
+    }
+  }
+
+  while (i < length and (s[i] & 0x80) == 0) {
+    ++ i;
+  }
+
+  return i;
+}
+
+// Like asciiLength, but for UTF-16 characters.
+inline unsigned
+asciiLength(const uint16_t* s, unsigned length)
+{
+  const uintptr_t Mask = static_cast<uintptr_t>(0xFF80FF80FF80FF80ULL);
+  const unsigned CharsPerWord = BytesPerWord / 2;
+
+  unsigned i = 0;
+  for (; i + CharsPerWord <= length; i += CharsPerWord) {
+    uintptr_t w; memcpy(&w, s + i, BytesPerWord);
+    if (w & Mask) {
+      break;
+    }
+  }
+
+  while (i < length and s[i] < 0x80) {
+    ++ i;
+  }
+
+  return i;
+}
+
 inline uint32_t
 hash(const char* s)
 {
@@ -44,8 +44,66 @@ const bool DebugCallTable = false;
 const bool DebugMethodTree = false;
 const bool DebugFrameMaps = false;
 const bool DebugIntrinsics = false;
+const bool DebugInlineCaches = false;
+const bool DebugLocalReferences = false;
 
 const bool CheckArrayBounds = true;
+const bool EliminateBoundsChecks = true;
+
+const bool InlineAccessors = true;
+
+const bool InterpretInitializers = true;
+
+const bool ScalarReplacement = true;
+
+const bool HoistLoopInvariants = true;
+
+const bool InlineLookupSwitches = true;
+
+const bool ElideNullStoreBarriers = true;
+
+const bool PollSafepoints = true;
+
+const bool IndexCompiledMethods = true;
+
+const bool CacheExceptionHandlers = true;
+
+const bool CallCriticalNativesDirectly = true;
+
+const bool DevirtualizeCalls = true;
+
+// limits on the allocations considered for scalar replacement:
+const unsigned MaxScalarFields = 8;
+const unsigned MaxScalarConstructions = 16;
+
+// lookupswitch instructions with at most MaxSwitchComparisons keys are
+// compiled as a sequence of comparisons, and those whose key range is
+// at most MaxSwitchTableSparseness times their key count as jump
+// tables:
+const unsigned MaxSwitchComparisons = 4;
+const unsigned MaxSwitchTableSparseness = 8;
+
+// number of receiver classes remembered per invokeinterface call site
+// before it is considered megamorphic:
+const unsigned InlineCacheSize = 4;
+
+// JNI local references are allocated from per-thread chunks of this
+// many slots:
+const unsigned LocalReferenceChunkSize = 32;
+
+// (throw address, exception class) pairs whose handler lookup each
+// thread remembers between collections:
+const unsigned HandlerCacheSize = 16;
+
+// most parameters a critical native may take to be called directly
+// from compiled code:
+const unsigned MaxCriticalNativeArguments = 4;
+
+// Java frames recorded per profiler sample, distinct stacks kept, and
+// the default sampling interval:
+const unsigned ProfileDepth = 32;
+const unsigned ProfileTableSize = 4096;
+const unsigned DefaultProfileIntervalInMicroseconds = 10 * 1000;
 
 #ifdef AVIAN_CONTINUATIONS
 const bool Continuations = true;
@@ -68,7 +126,11 @@ enum Root {
   VirtualThunks,
   ReceiveMethod,
   WindMethod,
-  RewindMethod
+  RewindMethod,
+  MethodIndexMethods,
+  BootMethodIndexMethods,
+  SpeculativeCalls,
+  DispatchThunks
 };
 
 enum ThunkIndex {
@@ -85,7 +147,7 @@ enum ThunkIndex {
   dummyIndex
 };
 
-const unsigned RootCount = RewindMethod + 1;
+const unsigned RootCount = DispatchThunks + 1;
 
 inline bool
 isVmInvokeUnsafeStack(void* ip)
@@ -138,6 +200,13 @@ class MyThread: public Thread {
     CallTrace* next;
   };
 
+  class HandlerCacheEntry {
+   public:
+    void* ip;
+    object class_;
+    void* handler;
+  };
+
   class Context {
    public:
     class MyProtector: public Thread::Protector {
@@ -202,15 +271,42 @@ class MyThread: public Thread {
     bool methodIsMostRecent;
   };
 
+  // Local references live in a stack of fixed-size chunks, newest
+  // first, so making one is a store and releasing all those made
+  // since some point only resets a count.
+  class LocalReferenceChunk {
+   public:
+    LocalReferenceChunk(LocalReferenceChunk* next):
+      next(next),
+      count(0)
+    { }
+
+    LocalReferenceChunk* next;
+    unsigned count;
+    object slots[LocalReferenceChunkSize];
+  };
+
+  // a position in the local reference stack:
+  class LocalReferenceMark {
+   public:
+    LocalReferenceMark(LocalReferenceChunk* chunk, unsigned count):
+      chunk(chunk),
+      count(count)
+    { }
+
+    LocalReferenceChunk* chunk;
+    unsigned count;
+  };
+
   class ReferenceFrame {
    public:
-    ReferenceFrame(ReferenceFrame* next, Reference* reference):
+    ReferenceFrame(ReferenceFrame* next, LocalReferenceMark base):
       next(next),
-      reference(reference)
+      base(base)
     { }
 
     ReferenceFrame* next;
-    Reference* reference;
+    LocalReferenceMark base;
   };
 
   static void doTransition(MyThread* t, void* ip, void* stack,
@@ -259,7 +355,7 @@ class MyThread: public Thread {
     codeImage(0),
     thunkTable(0),
     trace(0),
-    reference(0),
+    localReferences(0),
     arch(parent
          ? parent->arch
          : makeArchitecture(m->system, useNativeFeatures)),
@@ -267,9 +363,119 @@ class MyThread: public Thread {
     traceContext(0),
     stackLimit(0),
     referenceFrame(0),
-    methodLockIsClean(true)
+    methodLockIsClean(true),
+    spareLocalReferences(0),
+    localReferenceBase(0, 0),
+    localReferenceCount(0),
+    localReferencePeak(0)
   {
     arch->acquire();
+
+    clearHandlerCache();
+  }
+
+  object* makeLocalReference(object o) {
+    LocalReferenceChunk* c = localReferences;
+    if (c == 0 or c->count == LocalReferenceChunkSize) {
+      if (spareLocalReferences) {
+        c = spareLocalReferences;
+        spareLocalReferences = 0;
+        c->next = localReferences;
+        c->count = 0;
+      } else {
+        c = new (m->heap->allocator(Heap::JniMemory)->allocate
+                  (sizeof(LocalReferenceChunk)))
+          LocalReferenceChunk(localReferences);
+      }
+      localReferences = c;
+    }
+
+    if (++ localReferenceCount > localReferencePeak) {
+      localReferencePeak = localReferenceCount;
+    }
+
+    object* r = c->slots + (c->count++);
+    *r = o;
+    return r;
+  }
+
+  void disposeLocalReference(object* r) {
+    *r = 0;
+
+    // reclaim cleared slots at the top of the stack, but none made
+    // before the innermost mark, which still owns them
+    LocalReferenceChunk* c = localReferences;
+    while (c and c->count and c->slots[c->count - 1] == 0
+           and (c != localReferenceBase.chunk
+                or c->count > localReferenceBase.count))
+    {
+      -- c->count;
+      -- localReferenceCount;
+
+      if (c->count == 0 and c != localReferenceBase.chunk) {
+        localReferences = c->next;
+        freeLocalReferenceChunk(c);
+        c = localReferences;
+      }
+    }
+  }
+
+  // Starts a new group of local references, returning the start of
+  // the enclosing group to be passed to releaseLocalReferences.
+  LocalReferenceMark markLocalReferences() {
+    LocalReferenceMark enclosing = localReferenceBase;
+    localReferenceBase = LocalReferenceMark
+      (localReferences, localReferences ? localReferences->count : 0);
+    return enclosing;
+  }
+
+  // Releases every local reference made since the matching call to
+  // markLocalReferences.
+  void releaseLocalReferences(LocalReferenceMark enclosing) {
+    while (localReferences != localReferenceBase.chunk) {
+      LocalReferenceChunk* c = localReferences;
+      localReferenceCount -= c->count;
+      localReferences = c->next;
+      freeLocalReferenceChunk(c);
+    }
+
+    if (localReferences) {
+      localReferenceCount -= localReferences->count
+        - localReferenceBase.count;
+      localReferences->count = localReferenceBase.count;
+    }
+
+    localReferenceBase = enclosing;
+  }
+
+  void freeLocalReferenceChunk(LocalReferenceChunk* c) {
+    // keep one chunk around so that a native method which makes
+    // references in a loop does not allocate a chunk per iteration
+    if (spareLocalReferences == 0) {
+      spareLocalReferences = c;
+    } else {
+      m->heap->allocator(Heap::JniMemory)->free
+        (c, sizeof(LocalReferenceChunk));
+    }
+  }
+
+  void disposeLocalReferences() {
+    while (localReferences) {
+      LocalReferenceChunk* c = localReferences;
+      localReferences = c->next;
+      m->heap->allocator(Heap::JniMemory)->free
+        (c, sizeof(LocalReferenceChunk));
+    }
+
+    if (spareLocalReferences) {
+      m->heap->allocator(Heap::JniMemory)->free
+        (spareLocalReferences, sizeof(LocalReferenceChunk));
+      spareLocalReferences = 0;
+    }
+  }
+
+  void clearHandlerCache() {
+    memset(handlerCache, 0, sizeof(handlerCache));
   }
 
   void* ip;
@@ -287,13 +493,18 @@ class MyThread: public Thread {
   uint8_t* codeImage;
   void** thunkTable;
   CallTrace* trace;
-  Reference* reference;
+  LocalReferenceChunk* localReferences;
   Assembler::Architecture* arch;
   Context* transition;
   TraceContext* traceContext;
   uintptr_t stackLimit;
   ReferenceFrame* referenceFrame;
   bool methodLockIsClean;
+  HandlerCacheEntry handlerCache[HandlerCacheSize];
+  LocalReferenceChunk* spareLocalReferences;
+  LocalReferenceMark localReferenceBase;
+  unsigned localReferenceCount;
+  unsigned localReferencePeak;
 };
 
 void
@@ -395,6 +606,9 @@ compareIpToMethodBounds(Thread* t, intptr_t ip, object method)
   }
 }
 
+object
+queryMethodIndex(MyThread* t, intptr_t ip, bool* complete);
+
 object
 methodForIp(MyThread* t, void* ip)
 {
@@ -407,6 +621,15 @@ methodForIp(MyThread* t, void* ip)
   // compile(MyThread*, FixedAllocator*, BootContext*, object)):
   loadMemoryBarrier();
 
+  if (IndexCompiledMethods) {
+    bool complete;
+    object method = queryMethodIndex
+      (t, reinterpret_cast<intptr_t>(ip), &complete);
+    if (method or complete) {
+      return method;
+    }
+  }
+
   return treeQuery(t, root(t, MethodTree), reinterpret_cast<intptr_t>(ip),
                    root(t, MethodTreeSentinal), compareIpToMethodBounds);
 }
@@ -865,6 +1088,7 @@ class TraceElement: public TraceHandler {
   static const unsigned VirtualCall = 1 << 0;
   static const unsigned TailCall    = 1 << 1;
   static const unsigned LongCall    = 1 << 2;
+  static const unsigned SpeculativeCall = 1 << 3;
 
   TraceElement(Context* context, unsigned ip, object target, unsigned flags,
                TraceElement* next, unsigned mapSize):
@@ -971,7 +1195,7 @@ enum Thunk {
 #undef THUNK
 };
 
-const unsigned ThunkCount = gcIfNecessaryThunk + 1;
+const unsigned ThunkCount = safepointThunk + 1;
 
 intptr_t
 getThunk(MyThread* t, Thunk thunk);
@@ -1006,6 +1230,31 @@ class BootContext {
   OffsetResolver* resolver;
 };
 
+// Counts of the optimizations applied while compiling a method, as
+// reported in the avian.jit.stats log:
+class CompileStatistics {
+ public:
+  CompileStatistics():
+    inlinedAccessors(0),
+    intrinsics(0),
+    scalarAllocations(0),
+    hoistedLoads(0),
+    uncheckedAccesses(0),
+    nullStores(0),
+    criticalNatives(0),
+    devirtualizedCalls(0)
+  { }
+
+  unsigned inlinedAccessors;
+  unsigned intrinsics;
+  unsigned scalarAllocations;
+  unsigned hoistedLoads;
+  unsigned uncheckedAccesses;
+  unsigned nullStores;
+  unsigned criticalNatives;
+  unsigned devirtualizedCalls;
+};
+
 class Context {
  public:
   class MyResource: public Thread::Resource {
@@ -1025,6 +1274,11 @@ class Context {
 
     virtual void visit(Heap::Visitor* v) {
       v->visit(&(c->method));
+      v->visit(&(c->scalarTable));
+      v->visit(&(c->boundsTable));
+      v->visit(&(c->invariantTable));
+      v->visit(&(c->nullStoreTable));
+      v->visit(&(c->safepointTable));
 
       for (PoolElement* p = c->objectPool; p; p = p->next) {
         v->visit(&(p->target));
@@ -1222,7 +1476,7 @@ class Context {
 
   Context(MyThread* t, BootContext* bootContext, object method):
     thread(t),
-    zone(t->m->system, t->m->heap, InitialZoneCapacityInBytes),
+    zone(t->m->system, &(t->m->zonePool), InitialZoneCapacityInBytes),
     assembler(makeAssembler(t->m->system, t->m->heap, &zone, t->arch)),
     client(t),
     compiler(makeCompiler(t->m->system, assembler, &zone, &client)),
@@ -1231,6 +1485,11 @@ class Context {
     objectPool(0),
     subroutines(0),
     traceLog(0),
+    scalarTable(0),
+    boundsTable(0),
+    invariantTable(0),
+    nullStoreTable(0),
+    safepointTable(0),
     visitTable(makeVisitTable(t, &zone, method)),
     rootTable(makeRootTable(t, &zone, method)),
     subroutineTable(0),
@@ -1248,7 +1507,7 @@ class Context {
 
   Context(MyThread* t):
     thread(t),
-    zone(t->m->system, t->m->heap, InitialZoneCapacityInBytes),
+    zone(t->m->system, &(t->m->zonePool), InitialZoneCapacityInBytes),
     assembler(makeAssembler(t->m->system, t->m->heap, &zone, t->arch)),
     client(t),
     compiler(0),
@@ -1257,6 +1516,11 @@ class Context {
     objectPool(0),
     subroutines(0),
     traceLog(0),
+    scalarTable(0),
+    boundsTable(0),
+    invariantTable(0),
+    nullStoreTable(0),
+    safepointTable(0),
     visitTable(0),
     rootTable(0),
     subroutineTable(0),
@@ -1302,6 +1566,11 @@ class Context {
   PoolElement* objectPool;
   Subroutine* subroutines;
   TraceElement* traceLog;
+  object scalarTable;
+  object boundsTable;
+  object invariantTable;
+  object nullStoreTable;
+  object safepointTable;
   uint16_t* visitTable;
   uintptr_t* rootTable;
   Subroutine** subroutineTable;
@@ -1312,6 +1581,7 @@ class Context {
   unsigned traceLogCount;
   bool dirtyRoots;
   bool leaf;
+  CompileStatistics statistics;
   Vector eventLog;
   MyProtector protector;
   MyResource resource;
@@ -2006,17 +2276,46 @@ findCallNode(MyThread* t, void* address);
 void
 insertCallNode(MyThread* t, object node);
 
+void
+recordSpeculativeCall(MyThread* t, object node);
+
+void
+redirectSpeculativeCall(MyThread* t, object node);
+
 void*
 findExceptionHandler(Thread* t, object method, void* ip)
 {
   if (t->exception) {
     object table = codeExceptionHandlerTable(t, methodCode(t, method));
     if (table) {
+      // Exception tables are scanned linearly and each candidate
+      // handler costs a subtype check, so remember the outcome for
+      // this throw address and exception class.  Entries hold raw
+      // class pointers, which stay valid only until the next
+      // collection moves or frees them, so visitObjects clears the
+      // cache.  The shutdown exception matches no handler whatever
+      // its class, so it is never cached.
+      object class_ = objectClass(t, t->exception);
+      MyThread::HandlerCacheEntry* entry = 0;
+      if (CacheExceptionHandlers
+          and t->exception != root(t, Machine::Shutdown))
+      {
+        entry = static_cast<MyThread*>(t)->handlerCache
+          + ((reinterpret_cast<uintptr_t>(ip)
+              ^ (reinterpret_cast<uintptr_t>(ip) >> 5))
+             & (HandlerCacheSize - 1));
+
+        if (entry->ip == ip and entry->class_ == class_) {
+          return entry->handler;
+        }
+      }
+
       object index = arrayBody(t, table, 0);
       
       uint8_t* compiled = reinterpret_cast<uint8_t*>
         (methodCompiled(t, method));
 
+      void* handler = 0;
       for (unsigned i = 0; i < arrayLength(t, table) - 1; ++i) {
         unsigned start = intArrayBody(t, index, i * 3);
         unsigned end = intArrayBody(t, index, (i * 3) + 1);
@@ -2026,10 +2325,19 @@ findExceptionHandler(Thread* t, object method, void* ip)
           object catchType = arrayBody(t, table, i + 1);
 
           if (exceptionMatch(t, catchType, t->exception)) {
-            return compiled + intArrayBody(t, index, (i * 3) + 2);
+            handler = compiled + intArrayBody(t, index, (i * 3) + 2);
+            break;
           }
         }
       }
+
+      if (entry) {
+        entry->ip = ip;
+        entry->class_ = class_;
+        entry->handler = handler;
+      }
+
+      return handler;
     }
   }
 
@@ -2288,6 +2596,12 @@ stackOverflowThunk(MyThread* t);
 uintptr_t
 virtualThunk(MyThread* t, unsigned index);
 
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index);
+
+void
+skipInitCheck(MyThread* t, void* returnAddress);
+
 bool
 unresolved(MyThread* t, uintptr_t methodAddress);
 
@@ -2305,6 +2619,12 @@ void
 tryInitClass(MyThread* t, object class_)
 {
   initClass(t, class_);
+
+  // NeedInitFlag stays set while this thread is running the class's
+  // initializer, in which case the check must stay in place
+  if ((classVmFlags(t, class_) & NeedInitFlag) == 0) {
+    skipInitCheck(t, getIp(t));
+  }
 }
 
 void
@@ -2333,6 +2653,14 @@ methodAbstract(Thread* t, object method)
     and (methodFlags(t, method) & ACC_NATIVE) == 0;
 }
 
+bool
+methodStaticallyBound(Thread* t, object method)
+{
+  return (not methodVirtual(t, method))
+    or (methodFlags(t, method) & ACC_FINAL)
+    or (classFlags(t, methodClass(t, method)) & ACC_FINAL);
+}
+
 int64_t
 prepareMethodForCall(MyThread* t, object target)
 {
@@ -2367,6 +2695,83 @@ findInterfaceMethodFromInstance(MyThread* t, object method, object instance)
   }
 }
 
+enum InlineCacheEvent {
+  InlineCacheHit,
+  InlineCacheMiss,
+  InlineCacheMegamorphic
+};
+
+void
+countInlineCacheEvent(MyThread* t, InlineCacheEvent event);
+
+// Each cached invokeinterface call site refers to an array holding the
+// interface method followed by up to InlineCacheSize (class, method)
+// pairs.  Pairs are written once, under the class lock, with the
+// method stored before the class, so a reader which sees a class may
+// read its method without locking.
+int64_t
+findInterfaceMethodFromInstanceAndCache
+(MyThread* t, object cache, object instance)
+{
+  if (UNLIKELY(instance == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  object class_ = objectClass(t, instance);
+
+  for (unsigned i = 1; i < arrayLength(t, cache); i += 2) {
+    object c = arrayBody(t, cache, i);
+    if (c == class_) {
+      loadMemoryBarrier();
+
+      if (DebugInlineCaches) {
+        countInlineCacheEvent(t, InlineCacheHit);
+      }
+
+      return prepareMethodForCall(t, arrayBody(t, cache, i + 1));
+    } else if (c == 0) {
+      break;
+    }
+  }
+
+  PROTECT(t, cache);
+  PROTECT(t, class_);
+
+  object method = findInterfaceMethod(t, arrayBody(t, cache, 0), class_);
+  PROTECT(t, method);
+
+  { ACQUIRE(t, t->m->classLock);
+
+    unsigned i = 1;
+    while (i < arrayLength(t, cache)
+           and arrayBody(t, cache, i)
+           and arrayBody(t, cache, i) != class_)
+    {
+      i += 2;
+    }
+
+    if (i == arrayLength(t, cache)) {
+      if (DebugInlineCaches) {
+        countInlineCacheEvent(t, InlineCacheMegamorphic);
+      }
+    } else {
+      if (DebugInlineCaches) {
+        countInlineCacheEvent(t, InlineCacheMiss);
+      }
+
+      if (arrayBody(t, cache, i) == 0) {
+        set(t, cache, ArrayBody + ((i + 1) * BytesPerWord), method);
+
+        storeStoreMemoryBarrier();
+
+        set(t, cache, ArrayBody + (i * BytesPerWord), class_);
+      }
+    }
+  }
+
+  return prepareMethodForCall(t, method);
+}
+
 int64_t
 findInterfaceMethodFromInstanceAndReference
 (MyThread* t, object pair, object instance)
@@ -2683,8 +3088,9 @@ traceSize(Thread* t)
 
   t->m->processor->walkStack(t, &counter);
 
-  return FixedSizeOfArray + (counter.count * ArrayElementSizeOfArray)
-    + (counter.count * FixedSizeOfTraceElement);
+  return FixedSizeOfRawTrace
+    + FixedSizeOfArray + (counter.count * ArrayElementSizeOfArray)
+    + FixedSizeOfIntArray + pad(counter.count * ArrayElementSizeOfIntArray);
 }
 
 void NO_RETURN
@@ -2862,6 +3268,13 @@ makeBlankArray(MyThread* t, unsigned type, int32_t length)
   }
 }
 
+void
+copyArray(MyThread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  arrayCopy(t, src, srcOffset, dst, dstOffset, length);
+}
+
 uint64_t
 lookUpAddress(int32_t key, uintptr_t* start, int32_t count,
               uintptr_t default_)
@@ -2895,6 +3308,30 @@ setMaybeNull(MyThread* t, object o, unsigned offset, object value)
   }
 }
 
+uint64_t
+compareAndSwapInt(object target, uintptr_t offset, uint32_t expect,
+                  uint32_t update)
+{
+  return atomicCompareAndSwap32
+    (&cast<uint32_t>(target, offset), expect, update);
+}
+
+uint64_t
+compareAndSwapLong(object target, uintptr_t offset, uintptr_t expect,
+                   uintptr_t update)
+{
+  // only used on 64-bit targets, where a word holds a long
+  return atomicCompareAndSwap
+    (&cast<uintptr_t>(target, offset), expect, update);
+}
+
+uint64_t
+compareAndSwapObject(MyThread* t, object target, uintptr_t offset,
+                     object expect, object update)
+{
+  return atomicCompareAndSwapObject(t, target, offset, expect, update);
+}
+
 void
 acquireMonitorForObject(MyThread* t, object o)
 {
@@ -3259,6 +3696,20 @@ gcIfNecessary(MyThread* t)
   }
 }
 
+// Called from a loop head's safepoint poll once another thread has
+// asked for the exclusive state, and blocks until it is released.
+void
+safepoint(MyThread* t)
+{
+  t->safepointRequested = 0;
+
+  loadMemoryBarrier();
+
+  if (t->m->exclusive) {
+    ENTER(t, Thread::IdleState);
+  }
+}
+
 unsigned
 resultSize(MyThread* t, unsigned code)
 {
@@ -3455,470 +3906,1262 @@ compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall,
 }
 
 bool
-compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall)
+inTryBlock(MyThread* t, object code, unsigned ip)
 {
-  unsigned rSize = resultSize(t, methodReturnCode(t, target));
-
-  Compiler::Operand* result = 0;
-
-  if (emptyMethod(t, target)) {
-    tailCall = false;
-  } else {
-    BootContext* bc = frame->context->bootContext;
-    if (bc) {
-      if ((methodClass(t, target) == methodClass(t, frame->context->method)
-           or (not classNeedsInit(t, methodClass(t, target))))
-          and (not (TailCalls and tailCall
-                    and (methodFlags(t, target) & ACC_NATIVE))))
+  object table = codeExceptionHandlerTable(t, code);
+  if (table) {
+    unsigned length = exceptionHandlerTableLength(t, table);
+    for (unsigned i = 0; i < length; ++i) {
+      uint64_t eh = exceptionHandlerTableBody(t, table, i);
+      if (ip >= exceptionHandlerStart(eh)
+          and ip < exceptionHandlerEnd(eh))
       {
-        Promise* p = new(bc->zone) ListenPromise(t->m->system, bc->zone);
-
-        PROTECT(t, target);
-        object pointer = makePointer(t, p);
-        bc->calls = makeTriple(t, target, pointer, bc->calls);
-
-        result = compileDirectInvoke
-          (t, frame, target, tailCall, false, rSize, p);
-      } else {
-        result = compileDirectInvoke
-          (t, frame, target, tailCall, true, rSize, 0);
+        return true;
       }
-    } else if (unresolved(t, methodAddress(t, target))
-               or classNeedsInit(t, methodClass(t, target)))
-    {
-      result = compileDirectInvoke
-        (t, frame, target, tailCall, true, rSize, 0);
-    } else {
-      result = compileDirectInvoke
-        (t, frame, target, tailCall, false, rSize, 0);
     }
   }
-
-  frame->pop(methodParameterFootprint(t, target));
-
-  if (rSize) {
-    pushReturnValue(t, frame, methodReturnCode(t, target), result);
-  }
-
-  return tailCall;
+  return false;
 }
 
 unsigned
-methodReferenceParameterFootprint(Thread* t, object reference, bool isStatic)
-{
-  return parameterFootprint
-    (t, reinterpret_cast<const char*>
-     (&byteArrayBody(t, referenceSpec(t, reference), 0)), isStatic);
-}
-
-int
-methodReferenceReturnCode(Thread* t, object reference)
+targetFieldOffset(Context* context, object field)
 {
-  unsigned parameterCount;
-  unsigned returnCode;
-  scanMethodSpec
-    (t, reinterpret_cast<const char*>
-     (&byteArrayBody(t, referenceSpec(t, reference), 0)), &parameterCount,
-     &returnCode);
-
-  return returnCode;
+  if (context->bootContext) {
+    return context->bootContext->resolver->fieldOffset(context->thread, field);
+  } else {
+    return fieldOffset(context->thread, field);
+  }
 }
 
 void
-compileReferenceInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
-                       object reference, bool isStatic, bool tailCall)
+loadField(MyThread* t, Frame* frame, Compiler::Operand* table, object field)
 {
-  unsigned parameterFootprint
-    = methodReferenceParameterFootprint(t, reference, isStatic);
+  Compiler* c = frame->c;
+  Context* context = frame->context;
 
-  int returnCode = methodReferenceReturnCode(t, reference);
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    frame->pushInt
+      (c->load
+       (1, 1, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-  unsigned rSize = resultSize(t, returnCode);
+  case CharField:
+    frame->pushInt
+      (c->loadz
+       (2, 2, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-  Compiler::Operand* result = frame->c->stackCall
-    (method,
-     tailCall ? Compiler::TailJump : 0,
-     frame->trace(0, 0),
-     rSize,
-     operandTypeForFieldCode(t, returnCode),
-     parameterFootprint);
-
-  frame->pop(parameterFootprint);
-
-  if (rSize) {
-    pushReturnValue(t, frame, returnCode, result);
-  }
-}
-
-void
-compileDirectReferenceInvoke(MyThread* t, Frame* frame, Thunk thunk,
-                             object reference, bool isStatic, bool tailCall)
-{
-  Compiler* c = frame->c;
-
-  PROTECT(t, reference);
-
-  object pair = makePair(t, frame->context->method, reference);
+  case ShortField:
+    frame->pushInt
+      (c->load
+       (2, 2, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-  compileReferenceInvoke
-    (t, frame, c->call
-     (c->constant(getThunk(t, thunk), Compiler::AddressType),
-      0,
-      frame->trace(0, 0),
-      TargetBytesPerWord,
-      Compiler::AddressType,
-      2, c->register_(t->arch->thread()), frame->append(pair)),
-     reference, isStatic, tailCall);
-}
+  case FloatField:
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (table, Compiler::FloatType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-void
-compileAbstractInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
-                      object target, bool tailCall)
-{
-  unsigned parameterFootprint = methodParameterFootprint(t, target);
-  
-  int returnCode = methodReturnCode(t, target);
+  case IntField:
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-  unsigned rSize = resultSize(t, returnCode);
+  case DoubleField:
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory
+        (table, Compiler::FloatType, targetFieldOffset
+         (context, field), 0, 1), 8));
+    break;
 
-  Compiler::Operand* result = frame->c->stackCall
-    (method,
-     tailCall ? Compiler::TailJump : 0,
-     frame->trace(0, 0),
-     rSize,
-     operandTypeForFieldCode(t, returnCode),
-     parameterFootprint);
+  case LongField:
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (context, field), 0, 1), 8));
+    break;
 
-  frame->pop(parameterFootprint);
+  case ObjectField:
+    frame->pushObject
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory
+        (table, Compiler::ObjectType, targetFieldOffset
+         (context, field), 0, 1), TargetBytesPerWord));
+    break;
 
-  if (rSize) {
-    pushReturnValue(t, frame, returnCode, result);
-  }    
+  default:
+    abort(t);
+  }
 }
 
-void
-compileDirectAbstractInvoke(MyThread* t, Frame* frame, Thunk thunk,
-                            object target, bool tailCall)
+bool
+storesNull(MyThread* t, Context* context, unsigned ip)
 {
-  Compiler* c = frame->c;
-
-  compileAbstractInvoke
-    (t, frame, c->call
-     (c->constant(getThunk(t, thunk), Compiler::AddressType),
-      0,
-      frame->trace(0, 0),
-      TargetBytesPerWord,
-      Compiler::AddressType,
-      2, c->register_(t->arch->thread()), frame->append(target)),
-     target, tailCall);
+  return context->nullStoreTable
+    and byteArrayBody(t, context->nullStoreTable, ip);
 }
 
 void
-handleMonitorEvent(MyThread* t, Frame* frame, intptr_t function)
+storeField(MyThread* t, Frame* frame, Compiler::Operand* table, object field,
+           Compiler::Operand* value, bool isStatic)
 {
   Compiler* c = frame->c;
-  object method = frame->context->method;
+  Context* context = frame->context;
 
-  if (methodFlags(t, method) & ACC_SYNCHRONIZED) {
-    Compiler::Operand* lock;
-    if (methodFlags(t, method) & ACC_STATIC) {
-      PROTECT(t, method);
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    c->store
+      (TargetBytesPerWord, value, 1, c->memory
+       (table, Compiler::IntegerType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
 
-      lock = frame->append(methodClass(t, method));
-    } else {
-      lock = loadLocal(frame->context, 1, savedTargetIndex(t, method));
-    }
-    
-    c->call(c->constant(function, Compiler::AddressType),
-            0,
-            frame->trace(0, 0),
-            0,
-            Compiler::VoidType,
-            2, c->register_(t->arch->thread()), lock);
-  }
-}
+  case CharField:
+  case ShortField:
+    c->store
+      (TargetBytesPerWord, value, 2, c->memory
+       (table, Compiler::IntegerType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
+      
+  case FloatField:
+    c->store
+      (TargetBytesPerWord, value, 4, c->memory
+       (table, Compiler::FloatType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
 
-void
-handleEntrance(MyThread* t, Frame* frame)
-{
-  object method = frame->context->method;
+  case IntField:
+    c->store
+      (TargetBytesPerWord, value, 4, c->memory
+       (table, Compiler::IntegerType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
 
-  if ((methodFlags(t, method) & (ACC_SYNCHRONIZED | ACC_STATIC))
-      == ACC_SYNCHRONIZED)
-  {
-    // save 'this' pointer in case it is overwritten.
-    unsigned index = savedTargetIndex(t, method);
-    storeLocal(frame->context, 1, loadLocal(frame->context, 1, 0), index);
-    frame->set(index, Frame::Object);
-  }
+  case DoubleField:
+    c->store
+      (8, value, 8, c->memory
+       (table, Compiler::FloatType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
 
-  handleMonitorEvent
-    (t, frame, getThunk(t, acquireMonitorForObjectOnEntranceThunk));
-}
+  case LongField:
+    c->store
+      (8, value, 8, c->memory
+       (table, Compiler::IntegerType, targetFieldOffset
+        (context, field), 0, 1));
+    break;
 
-void
-handleExit(MyThread* t, Frame* frame)
-{
-  handleMonitorEvent
-    (t, frame, getThunk(t, releaseMonitorForObjectThunk));
-}
+  case ObjectField:
+    if (storesNull(t, context, frame->ip)) {
+      // a null can't create an old-to-young reference, so the write
+      // barrier may be skipped:
+      c->store
+        (TargetBytesPerWord, value, TargetBytesPerWord, c->memory
+         (table, Compiler::ObjectType, targetFieldOffset
+          (context, field), 0, 1));
 
-bool
-inTryBlock(MyThread* t, object code, unsigned ip)
-{
-  object table = codeExceptionHandlerTable(t, code);
-  if (table) {
-    unsigned length = exceptionHandlerTableLength(t, table);
-    for (unsigned i = 0; i < length; ++i) {
-      uint64_t eh = exceptionHandlerTableBody(t, table, i);
-      if (ip >= exceptionHandlerStart(eh)
-          and ip < exceptionHandlerEnd(eh))
-      {
-        return true;
-      }
+      ++ context->statistics.nullStores;
+    } else if (not isStatic) {
+      c->call
+        (c->constant
+         (getThunk(t, setMaybeNullThunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         4, c->register_(t->arch->thread()), table,
+         c->constant(targetFieldOffset(context, field),
+                     Compiler::IntegerType),
+         value);
+    } else {
+      c->call
+        (c->constant(getThunk(t, setThunk), Compiler::AddressType),
+         0, 0, 0, Compiler::VoidType,
+         4, c->register_(t->arch->thread()), table,
+         c->constant(targetFieldOffset(context, field),
+                     Compiler::IntegerType),
+         value);
     }
-  }
-  return false;
-}
+    break;
 
-bool
-needsReturnBarrier(MyThread* t, object method)
-{
-  return (methodFlags(t, method) & ConstructorFlag)
-    and (classVmFlags(t, methodClass(t, method)) & HasFinalMemberFlag);
+  default: abort(t);
+  }
 }
 
 bool
-returnsNext(MyThread* t, object code, unsigned ip)
+isReturn(unsigned instruction)
 {
-  switch (codeBody(t, code, ip)) {
-  case return_:
+  switch (instruction) {
   case areturn:
-  case ireturn:
+  case dreturn:
   case freturn:
+  case ireturn:
   case lreturn:
-  case dreturn:
     return true;
 
-  case goto_: {
-    uint32_t offset = codeReadInt16(t, code, ++ip);
-    uint32_t newIp = (ip - 3) + offset;
-    assert(t, newIp < codeLength(t, code));
-
-    return returnsNext(t, code, newIp);
-  }
-
-  case goto_w: {
-    uint32_t offset = codeReadInt32(t, code, ++ip);
-    uint32_t newIp = (ip - 5) + offset;
-    assert(t, newIp < codeLength(t, code));
-    
-    return returnsNext(t, code, newIp);
-  }
-
   default:
     return false;
   }
 }
 
 bool
-isTailCall(MyThread* t, object code, unsigned ip, object caller,
-           int calleeReturnCode)
+isLoadOfFirstArgument(unsigned instruction)
 {
-  return TailCalls
-    and ((methodFlags(t, caller) & ACC_SYNCHRONIZED) == 0)
-    and (not inTryBlock(t, code, ip - 1))
-    and (not needsReturnBarrier(t, caller))
-    and (methodReturnCode(t, caller) == VoidField
-         or methodReturnCode(t, caller) == calleeReturnCode)
-    and returnsNext(t, code, ip);
-}
+  switch (instruction) {
+  case aload_1:
+  case dload_1:
+  case fload_1:
+  case iload_1:
+  case lload_1:
+    return true;
 
-bool
-isTailCall(MyThread* t, object code, unsigned ip, object caller, object callee)
-{
-  return isTailCall(t, code, ip, caller, methodReturnCode(t, callee));
+  default:
+    return false;
+  }
 }
 
+// Replace a call to a statically bound method whose body is a single
+// field access (e.g. a getter or setter) with the access itself.  The
+// callee cannot throw anything but a NullPointerException on its
+// receiver, which the inlined access raises at the call site, so no
+// extra frame metadata is needed for stack walking.
 bool
-isReferenceTailCall(MyThread* t, object code, unsigned ip, object caller,
-                    object calleeReference)
+inlineAccessor(MyThread* t, Frame* frame, object target)
 {
-  return isTailCall
-    (t, code, ip, caller, methodReferenceReturnCode(t, calleeReference));
-}
+  if ((not InlineAccessors)
+      or methodAbstract(t, target)
+      or (methodFlags(t, target) & (ACC_NATIVE | ACC_SYNCHRONIZED)))
+  {
+    return false;
+  }
 
-bool
-integerBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
-              unsigned size, Compiler::Operand* a, Compiler::Operand* b,
-              unsigned* newIpp)
-{
-  if (ip + 3 > codeLength(t, code)) {
+  ensureCode(t, target);
+
+  object code = methodCode(t, target);
+  unsigned length = codeLength(t, code);
+  bool isStatic = (methodFlags(t, target) & ACC_STATIC) != 0;
+  bool isSetter = false;
+  unsigned ip;
+
+  if (isStatic) {
+    if (length != 4
+        or codeBody(t, code, 0) != getstatic
+        or (not isReturn(codeBody(t, code, 3))))
+    {
+      return false;
+    }
+    ip = 1;
+  } else if (length == 5
+             and codeBody(t, code, 0) == aload_0
+             and codeBody(t, code, 1) == getfield
+             and isReturn(codeBody(t, code, 4)))
+  {
+    ip = 2;
+  } else if (length == 6
+             and codeBody(t, code, 0) == aload_0
+             and isLoadOfFirstArgument(codeBody(t, code, 1))
+             and codeBody(t, code, 2) == putfield
+             and codeBody(t, code, 5) == return_)
+  {
+    isSetter = true;
+    ip = 3;
+  } else {
     return false;
   }
 
-  Compiler* c = frame->c;
-  unsigned instruction = codeBody(t, code, ip++);
-  uint32_t offset = codeReadInt16(t, code, ip);
-  uint32_t newIp = (ip - 3) + offset;
-  assert(t, newIp < codeLength(t, code));
-  
-  Compiler::Operand* target = frame->machineIp(newIp);
+  uint16_t index = codeReadInt16(t, code, ip);
 
-  switch (instruction) {
-  case ifeq:
-    c->jumpIfEqual(size, a, b, target);
-    break;
+  PROTECT(t, target);
 
-  case ifne:
-    c->jumpIfNotEqual(size, a, b, target);
-    break;
+  object field = resolveField(t, target, index - 1, false);
 
-  case ifgt:
-    c->jumpIfGreater(size, a, b, target);
-    break;
+  if (field == 0
+      or (fieldFlags(t, field) & ACC_VOLATILE)
+      or ((fieldFlags(t, field) & ACC_STATIC) != 0) != isStatic)
+  {
+    return false;
+  }
 
-  case ifge:
-    c->jumpIfGreaterOrEqual(size, a, b, target);
-    break;
+  if (isStatic and (classNeedsInit(t, methodClass(t, target))
+                    or classNeedsInit(t, fieldClass(t, field))))
+  {
+    return false;
+  }
 
-  case iflt:
-    c->jumpIfLess(size, a, b, target);
-    break;
+  if ((not isSetter)
+      and (resultSize(t, fieldCode(t, field))
+           != resultSize(t, methodReturnCode(t, target))
+           or operandTypeForFieldCode(t, fieldCode(t, field))
+           != operandTypeForFieldCode(t, methodReturnCode(t, target))))
+  {
+    return false;
+  }
 
-  case ifle:
-    c->jumpIfLessOrEqual(size, a, b, target);
-    break;
+  PROTECT(t, field);
 
-  default:
-    ip -= 3;
-    return false;
+  Compiler* c = frame->c;
+
+  if (isStatic) {
+    loadField
+      (t, frame, frame->append(classStaticTable(t, fieldClass(t, field))),
+       field);
+  } else {
+    Compiler::Operand* value = isSetter
+      ? popField(t, frame, fieldCode(t, field)) : 0;
+
+    Compiler::Operand* instance = frame->popObject();
+
+    if (inTryBlock(t, methodCode(t, frame->context->method), frame->ip)) {
+      c->saveLocals();
+      frame->trace(0, 0);
+    }
+
+    if (isSetter) {
+      storeField(t, frame, instance, field, value, false);
+    } else {
+      loadField(t, frame, instance, field);
+    }
   }
 
-  *newIpp = newIp;
+  ++ frame->context->statistics.inlinedAccessors;
+
   return true;
 }
 
 bool
-floatBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
-            unsigned size, bool lessIfUnordered, Compiler::Operand* a,
-            Compiler::Operand* b, unsigned* newIpp)
+compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall)
 {
-  if (ip + 3 > codeLength(t, code)) {
+  if (inlineAccessor(t, frame, target)) {
     return false;
   }
 
-  Compiler* c = frame->c;
-  unsigned instruction = codeBody(t, code, ip++);
-  uint32_t offset = codeReadInt16(t, code, ip);
-  uint32_t newIp = (ip - 3) + offset;
-  assert(t, newIp < codeLength(t, code));
-  
-  Compiler::Operand* target = frame->machineIp(newIp);
+  unsigned rSize = resultSize(t, methodReturnCode(t, target));
 
-  switch (instruction) {
-  case ifeq:
-    c->jumpIfFloatEqual(size, a, b, target);
-    break;
+  Compiler::Operand* result = 0;
 
-  case ifne:
-    c->jumpIfFloatNotEqual(size, a, b, target);
-    break;
+  if (emptyMethod(t, target)) {
+    tailCall = false;
+  } else {
+    BootContext* bc = frame->context->bootContext;
+    if (bc) {
+      if ((methodClass(t, target) == methodClass(t, frame->context->method)
+           or (not classNeedsInit(t, methodClass(t, target))))
+          and (not (TailCalls and tailCall
+                    and (methodFlags(t, target) & ACC_NATIVE))))
+      {
+        Promise* p = new(bc->zone) ListenPromise(t->m->system, bc->zone);
 
-  case ifgt:
-    if (lessIfUnordered) {
-      c->jumpIfFloatGreater(size, a, b, target);
+        PROTECT(t, target);
+        object pointer = makePointer(t, p);
+        bc->calls = makeTriple(t, target, pointer, bc->calls);
+
+        result = compileDirectInvoke
+          (t, frame, target, tailCall, false, rSize, p);
+      } else {
+        result = compileDirectInvoke
+          (t, frame, target, tailCall, true, rSize, 0);
+      }
+    } else if (unresolved(t, methodAddress(t, target))
+               or classNeedsInit(t, methodClass(t, target)))
+    {
+      result = compileDirectInvoke
+        (t, frame, target, tailCall, true, rSize, 0);
     } else {
-      c->jumpIfFloatGreaterOrUnordered(size, a, b, target);
+      result = compileDirectInvoke
+        (t, frame, target, tailCall, false, rSize, 0);
     }
-    break;
+  }
 
-  case ifge:
-    if (lessIfUnordered) {
-      c->jumpIfFloatGreaterOrEqual(size, a, b, target);
-    } else {
-      c->jumpIfFloatGreaterOrEqualOrUnordered(size, a, b, target);
+  frame->pop(methodParameterFootprint(t, target));
+
+  if (rSize) {
+    pushReturnValue(t, frame, methodReturnCode(t, target), result);
+  }
+
+  return tailCall;
+}
+
+// Whether a virtual call to target may be bound to it directly
+// because no class overriding it has been loaded.  See
+// compileSpeculativeInvoke.
+bool
+speculativelyBound(MyThread* t, Context* context, object target)
+{
+  return DevirtualizeCalls
+    and context->bootContext == 0
+    and (not methodAbstract(t, target))
+    and (methodFlags(t, target) & ACC_NATIVE) == 0
+    and (methodVmFlags(t, target) & OverriddenFlag) == 0;
+}
+
+// Compile a virtual call to a method which no loaded class overrides
+// as a direct call.  The call is always aligned so that it can be
+// patched: finish records it as depending on target, and if a class
+// overriding target is loaded later, methodOverridden redirects it to
+// a thunk which dispatches through the receiver's vtable.  Frames
+// already executing target are unaffected, since target is still the
+// right method for their receivers.
+void
+compileSpeculativeInvoke(MyThread* t, Frame* frame, object target)
+{
+  Compiler* c = frame->c;
+
+  unsigned parameterFootprint = methodParameterFootprint(t, target);
+
+  // the vtable load this replaces would have thrown a
+  // NullPointerException for a null receiver, so we must too:
+  if (inTryBlock(t, methodCode(t, frame->context->method), frame->ip)) {
+    c->saveLocals();
+    frame->trace(0, 0);
+  }
+
+  c->nullCheck(c->peek(1, parameterFootprint - 1));
+
+  uintptr_t address;
+  if (unresolved(t, methodAddress(t, target))
+      or classNeedsInit(t, methodClass(t, target)))
+  {
+    address = defaultThunk(t);
+  } else {
+    address = methodAddress(t, target);
+  }
+
+  unsigned flags = Compiler::Aligned;
+  unsigned traceFlags = TraceElement::SpeculativeCall;
+
+  if (useLongJump(t, address)) {
+    flags |= Compiler::LongJumpOrCall;
+    traceFlags |= TraceElement::LongCall;
+  }
+
+  unsigned rSize = resultSize(t, methodReturnCode(t, target));
+
+  Compiler::Operand* result = c->stackCall
+    (c->constant(address, Compiler::AddressType),
+     flags,
+     frame->trace(target, traceFlags),
+     rSize,
+     operandTypeForFieldCode(t, methodReturnCode(t, target)),
+     parameterFootprint);
+
+  frame->pop(parameterFootprint);
+
+  if (rSize) {
+    pushReturnValue(t, frame, methodReturnCode(t, target), result);
+  }
+
+  ++ frame->context->statistics.devirtualizedCalls;
+}
+
+bool
+compileCriticalNativeInvoke(MyThread* t, Frame* frame, object target)
+{
+  // Calls to a bound critical native are compiled as plain calls
+  // using the native calling convention, bypassing nativeThunk and
+  // invokeNative entirely.  The compiler passes floating point
+  // arguments in integer registers and does not extend narrow
+  // results, so only int and long signatures qualify; others still
+  // reach invokeNativeCritical through the thunk.
+  if ((not CallCriticalNativesDirectly)
+      or frame->context->bootContext
+      or (methodFlags(t, target) & ACC_NATIVE) == 0)
+  {
+    return false;
+  }
+
+  int returnCode = methodReturnCode(t, target);
+  if (returnCode != IntField and returnCode != LongField
+      and returnCode != VoidField)
+  {
+    return false;
+  }
+
+  bool wide[MaxCriticalNativeArguments];
+  unsigned count = 0;
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, target), 0)));
+
+  while (it.hasNext()) {
+    if (count == MaxCriticalNativeArguments) {
+      return false;
     }
-    break;
 
-  case iflt:
-    if (lessIfUnordered) {
-      c->jumpIfFloatLessOrUnordered(size, a, b, target);
-    } else {
-      c->jumpIfFloatLess(size, a, b, target);
+    switch (fieldCode(t, *it.next())) {
+    case BooleanField:
+    case ByteField:
+    case CharField:
+    case ShortField:
+    case IntField:
+      wide[count++] = false;
+      break;
+
+    case LongField:
+      wide[count++] = true;
+      break;
+
+    default:
+      return false;
     }
-    break;
+  }
 
-  case ifle:
-    if (lessIfUnordered) {
-      c->jumpIfFloatLessOrEqualOrUnordered(size, a, b, target);
+  void* function = criticalNative(t, target);
+  if (function == 0) {
+    return false;
+  }
+
+  Compiler* c = frame->c;
+
+  // each long argument is preceded by a null marker telling the
+  // compiler it spans two words on 32-bit targets
+  Compiler::Operand* arguments[MaxCriticalNativeArguments * 2];
+  memset(arguments, 0, sizeof(arguments));
+
+  unsigned argumentCount = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    argumentCount += wide[i] ? 2 : 1;
+  }
+
+  unsigned index = argumentCount;
+  for (int i = count - 1; i >= 0; --i) {
+    if (wide[i]) {
+      arguments[-- index] = frame->popLong();
+      arguments[-- index] = 0;
     } else {
-      c->jumpIfFloatLessOrEqual(size, a, b, target);
+      arguments[-- index] = frame->popInt();
     }
-    break;
+  }
 
-  default:
-    ip -= 3;
-    return false;
+  uintptr_t address = reinterpret_cast<uintptr_t>(function);
+  unsigned rSize = resultSize(t, returnCode);
+
+  // unused trailing arguments are ignored by the callee
+  Compiler::Operand* result = c->call
+    (c->constant(address, Compiler::AddressType),
+     useLongJump(t, address) ? Compiler::LongJumpOrCall : 0,
+     0,
+     rSize,
+     operandTypeForFieldCode(t, returnCode),
+     argumentCount,
+     arguments[0], arguments[1], arguments[2], arguments[3],
+     arguments[4], arguments[5], arguments[6], arguments[7]);
+
+  if (rSize) {
+    pushReturnValue(t, frame, returnCode, result);
   }
 
-  *newIpp = newIp;
   return true;
 }
 
-Compiler::Operand*
-popLongAddress(Frame* frame)
+unsigned
+methodReferenceParameterFootprint(Thread* t, object reference, bool isStatic)
 {
-  return TargetBytesPerWord == 8 ? frame->popLong() : frame->c->load
-    (8, 8, frame->popLong(), TargetBytesPerWord);
+  return parameterFootprint
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, referenceSpec(t, reference), 0)), isStatic);
 }
 
-bool
-intrinsic(MyThread* t, Frame* frame, object target)
+int
+methodReferenceReturnCode(Thread* t, object reference)
 {
-#define MATCH(name, constant)                                           \
-  (byteArrayLength(t, name) == sizeof(constant)                         \
-   and ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),    \
-                constant) == 0)
+  unsigned parameterCount;
+  unsigned returnCode;
+  scanMethodSpec
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, referenceSpec(t, reference), 0)), &parameterCount,
+     &returnCode);
 
-  object className = vm::className(t, methodClass(t, target));
-  if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
-    Compiler* c = frame->c;
-    if (MATCH(methodName(t, target), "sqrt")
-        and MATCH(methodSpec(t, target), "(D)D"))
-    {
-      frame->pushLong(c->fsqrt(8, frame->popLong()));
-      return true;
-    } else if (MATCH(methodName(t, target), "abs")) {
-      if (MATCH(methodSpec(t, target), "(I)I")) {
-        frame->pushInt(c->abs(4, frame->popInt()));
-        return true;
-      } else if (MATCH(methodSpec(t, target), "(J)J")) {
-        frame->pushLong(c->abs(8, frame->popLong()));
-        return true;
-      } else if (MATCH(methodSpec(t, target), "(F)F")) {
-        frame->pushInt(c->fabs(4, frame->popInt()));
-        return true;
-      }
-    }
-  } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
-    Compiler* c = frame->c;
-    if (MATCH(methodName(t, target), "getByte")
-        and MATCH(methodSpec(t, target), "(J)B"))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushInt
-        (c->load
-         (1, 1, c->memory(address, Compiler::IntegerType, 0, 0, 1),
-          TargetBytesPerWord));
-      return true;
-    } else if (MATCH(methodName(t, target), "putByte")
-               and MATCH(methodSpec(t, target), "(JB)V"))
-    {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
+  return returnCode;
+}
+
+void
+compileReferenceInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
+                       object reference, bool isStatic, bool tailCall)
+{
+  unsigned parameterFootprint
+    = methodReferenceParameterFootprint(t, reference, isStatic);
+
+  int returnCode = methodReferenceReturnCode(t, reference);
+
+  unsigned rSize = resultSize(t, returnCode);
+
+  Compiler::Operand* result = frame->c->stackCall
+    (method,
+     tailCall ? Compiler::TailJump : 0,
+     frame->trace(0, 0),
+     rSize,
+     operandTypeForFieldCode(t, returnCode),
+     parameterFootprint);
+
+  frame->pop(parameterFootprint);
+
+  if (rSize) {
+    pushReturnValue(t, frame, returnCode, result);
+  }
+}
+
+void
+compileDirectReferenceInvoke(MyThread* t, Frame* frame, Thunk thunk,
+                             object reference, bool isStatic, bool tailCall)
+{
+  Compiler* c = frame->c;
+
+  PROTECT(t, reference);
+
+  object pair = makePair(t, frame->context->method, reference);
+
+  compileReferenceInvoke
+    (t, frame, c->call
+     (c->constant(getThunk(t, thunk), Compiler::AddressType),
+      0,
+      frame->trace(0, 0),
+      TargetBytesPerWord,
+      Compiler::AddressType,
+      2, c->register_(t->arch->thread()), frame->append(pair)),
+     reference, isStatic, tailCall);
+}
+
+void
+compileAbstractInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
+                      object target, bool tailCall)
+{
+  unsigned parameterFootprint = methodParameterFootprint(t, target);
+  
+  int returnCode = methodReturnCode(t, target);
+
+  unsigned rSize = resultSize(t, returnCode);
+
+  Compiler::Operand* result = frame->c->stackCall
+    (method,
+     tailCall ? Compiler::TailJump : 0,
+     frame->trace(0, 0),
+     rSize,
+     operandTypeForFieldCode(t, returnCode),
+     parameterFootprint);
+
+  frame->pop(parameterFootprint);
+
+  if (rSize) {
+    pushReturnValue(t, frame, returnCode, result);
+  }    
+}
+
+void
+compileDirectAbstractInvoke(MyThread* t, Frame* frame, Thunk thunk,
+                            object target, bool tailCall)
+{
+  Compiler* c = frame->c;
+
+  compileAbstractInvoke
+    (t, frame, c->call
+     (c->constant(getThunk(t, thunk), Compiler::AddressType),
+      0,
+      frame->trace(0, 0),
+      TargetBytesPerWord,
+      Compiler::AddressType,
+      2, c->register_(t->arch->thread()), frame->append(target)),
+     target, tailCall);
+}
+
+void
+handleMonitorEvent(MyThread* t, Frame* frame, intptr_t function)
+{
+  Compiler* c = frame->c;
+  object method = frame->context->method;
+
+  if (methodFlags(t, method) & ACC_SYNCHRONIZED) {
+    Compiler::Operand* lock;
+    if (methodFlags(t, method) & ACC_STATIC) {
+      PROTECT(t, method);
+
+      lock = frame->append(methodClass(t, method));
+    } else {
+      lock = loadLocal(frame->context, 1, savedTargetIndex(t, method));
+    }
+    
+    c->call(c->constant(function, Compiler::AddressType),
+            0,
+            frame->trace(0, 0),
+            0,
+            Compiler::VoidType,
+            2, c->register_(t->arch->thread()), lock);
+  }
+}
+
+void
+handleEntrance(MyThread* t, Frame* frame)
+{
+  object method = frame->context->method;
+
+  if ((methodFlags(t, method) & (ACC_SYNCHRONIZED | ACC_STATIC))
+      == ACC_SYNCHRONIZED)
+  {
+    // save 'this' pointer in case it is overwritten.
+    unsigned index = savedTargetIndex(t, method);
+    storeLocal(frame->context, 1, loadLocal(frame->context, 1, 0), index);
+    frame->set(index, Frame::Object);
+  }
+
+  handleMonitorEvent
+    (t, frame, getThunk(t, acquireMonitorForObjectOnEntranceThunk));
+}
+
+void
+handleExit(MyThread* t, Frame* frame)
+{
+  handleMonitorEvent
+    (t, frame, getThunk(t, releaseMonitorForObjectThunk));
+}
+
+bool
+needsReturnBarrier(MyThread* t, object method)
+{
+  return (methodFlags(t, method) & ConstructorFlag)
+    and (classVmFlags(t, methodClass(t, method)) & HasFinalMemberFlag);
+}
+
+bool
+returnsNext(MyThread* t, object code, unsigned ip)
+{
+  switch (codeBody(t, code, ip)) {
+  case return_:
+  case areturn:
+  case ireturn:
+  case freturn:
+  case lreturn:
+  case dreturn:
+    return true;
+
+  case goto_: {
+    uint32_t offset = codeReadInt16(t, code, ++ip);
+    uint32_t newIp = (ip - 3) + offset;
+    assert(t, newIp < codeLength(t, code));
+
+    return returnsNext(t, code, newIp);
+  }
+
+  case goto_w: {
+    uint32_t offset = codeReadInt32(t, code, ++ip);
+    uint32_t newIp = (ip - 5) + offset;
+    assert(t, newIp < codeLength(t, code));
+    
+    return returnsNext(t, code, newIp);
+  }
+
+  default:
+    return false;
+  }
+}
+
+bool
+isTailCall(MyThread* t, object code, unsigned ip, object caller,
+           int calleeReturnCode)
+{
+  return TailCalls
+    and ((methodFlags(t, caller) & ACC_SYNCHRONIZED) == 0)
+    and (not inTryBlock(t, code, ip - 1))
+    and (not needsReturnBarrier(t, caller))
+    and (methodReturnCode(t, caller) == VoidField
+         or methodReturnCode(t, caller) == calleeReturnCode)
+    and returnsNext(t, code, ip);
+}
+
+bool
+isTailCall(MyThread* t, object code, unsigned ip, object caller, object callee)
+{
+  return isTailCall(t, code, ip, caller, methodReturnCode(t, callee));
+}
+
+bool
+isReferenceTailCall(MyThread* t, object code, unsigned ip, object caller,
+                    object calleeReference)
+{
+  return isTailCall
+    (t, code, ip, caller, methodReferenceReturnCode(t, calleeReference));
+}
+
+bool
+integerBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
+              unsigned size, Compiler::Operand* a, Compiler::Operand* b,
+              unsigned* newIpp)
+{
+  if (ip + 3 > codeLength(t, code)) {
+    return false;
+  }
+
+  Compiler* c = frame->c;
+  unsigned instruction = codeBody(t, code, ip++);
+  uint32_t offset = codeReadInt16(t, code, ip);
+  uint32_t newIp = (ip - 3) + offset;
+  assert(t, newIp < codeLength(t, code));
+  
+  Compiler::Operand* target = frame->machineIp(newIp);
+
+  switch (instruction) {
+  case ifeq:
+    c->jumpIfEqual(size, a, b, target);
+    break;
+
+  case ifne:
+    c->jumpIfNotEqual(size, a, b, target);
+    break;
+
+  case ifgt:
+    c->jumpIfGreater(size, a, b, target);
+    break;
+
+  case ifge:
+    c->jumpIfGreaterOrEqual(size, a, b, target);
+    break;
+
+  case iflt:
+    c->jumpIfLess(size, a, b, target);
+    break;
+
+  case ifle:
+    c->jumpIfLessOrEqual(size, a, b, target);
+    break;
+
+  default:
+    ip -= 3;
+    return false;
+  }
+
+  *newIpp = newIp;
+  return true;
+}
+
+bool
+floatBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
+            unsigned size, bool lessIfUnordered, Compiler::Operand* a,
+            Compiler::Operand* b, unsigned* newIpp)
+{
+  if (ip + 3 > codeLength(t, code)) {
+    return false;
+  }
+
+  Compiler* c = frame->c;
+  unsigned instruction = codeBody(t, code, ip++);
+  uint32_t offset = codeReadInt16(t, code, ip);
+  uint32_t newIp = (ip - 3) + offset;
+  assert(t, newIp < codeLength(t, code));
+  
+  Compiler::Operand* target = frame->machineIp(newIp);
+
+  switch (instruction) {
+  case ifeq:
+    c->jumpIfFloatEqual(size, a, b, target);
+    break;
+
+  case ifne:
+    c->jumpIfFloatNotEqual(size, a, b, target);
+    break;
+
+  case ifgt:
+    if (lessIfUnordered) {
+      c->jumpIfFloatGreater(size, a, b, target);
+    } else {
+      c->jumpIfFloatGreaterOrUnordered(size, a, b, target);
+    }
+    break;
+
+  case ifge:
+    if (lessIfUnordered) {
+      c->jumpIfFloatGreaterOrEqual(size, a, b, target);
+    } else {
+      c->jumpIfFloatGreaterOrEqualOrUnordered(size, a, b, target);
+    }
+    break;
+
+  case iflt:
+    if (lessIfUnordered) {
+      c->jumpIfFloatLessOrUnordered(size, a, b, target);
+    } else {
+      c->jumpIfFloatLess(size, a, b, target);
+    }
+    break;
+
+  case ifle:
+    if (lessIfUnordered) {
+      c->jumpIfFloatLessOrEqualOrUnordered(size, a, b, target);
+    } else {
+      c->jumpIfFloatLessOrEqual(size, a, b, target);
+    }
+    break;
+
+  default:
+    ip -= 3;
+    return false;
+  }
+
+  *newIpp = newIp;
+  return true;
+}
+
+Compiler::Operand*
+popLongAddress(Frame* frame)
+{
+  return TargetBytesPerWord == 8 ? frame->popLong() : frame->c->load
+    (8, 8, frame->popLong(), TargetBytesPerWord);
+}
+
+bool
+nativeOperation(MyThread* t, BinaryOperation op, unsigned size,
+                unsigned resultSize)
+{
+  uint8_t typeMask;
+  uint64_t registerMask;
+  bool thunk = false;
+  t->arch->planSource(op, size, &typeMask, &registerMask, resultSize, &thunk);
+  return not thunk;
+}
+
+#define MATCH(name, constant)                                           \
+  (byteArrayLength(t, name) == sizeof(constant)                         \
+   and ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),    \
+                constant) == 0)
+
+// Compiles the compare-and-swap, volatile and ordered accessors of
+// sun.misc.Unsafe and avian.Atomic which take an object and an offset.
+// The loads and stores are done inline with the same barriers we use
+// for volatile fields, and a compare-and-swap becomes a direct call to
+// a thunk instead of a native method invocation.
+bool
+atomicIntrinsic(MyThread* t, Frame* frame, object target, bool instance)
+{
+  Compiler* c = frame->c;
+  object name = methodName(t, target);
+  object spec = methodSpec(t, target);
+
+  if (MATCH(name, "compareAndSwapInt")
+      and MATCH(spec, "(Ljava/lang/Object;JII)Z"))
+  {
+    Compiler::Operand* update = frame->popInt();
+    Compiler::Operand* expect = frame->popInt();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    if (instance) frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, compareAndSwapIntThunk),
+                    Compiler::AddressType),
+        0, 0, 4, Compiler::IntegerType, 4, base, offset, expect, update));
+    return true;
+  } else if (TargetBytesPerWord == 8
+             and MATCH(name, "compareAndSwapLong")
+             and MATCH(spec, "(Ljava/lang/Object;JJJ)Z"))
+  {
+    Compiler::Operand* update = frame->popLong();
+    Compiler::Operand* expect = frame->popLong();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    if (instance) frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, compareAndSwapLongThunk),
+                    Compiler::AddressType),
+        0, 0, 4, Compiler::IntegerType, 6, base, offset,
+        static_cast<Compiler::Operand*>(0), expect,
+        static_cast<Compiler::Operand*>(0), update));
+    return true;
+  } else if (MATCH(name, "compareAndSwapObject")
+             and MATCH(spec, "(Ljava/lang/Object;J"
+                       "Ljava/lang/Object;Ljava/lang/Object;)Z"))
+  {
+    Compiler::Operand* update = frame->popObject();
+    Compiler::Operand* expect = frame->popObject();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    if (instance) frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, compareAndSwapObjectThunk),
+                    Compiler::AddressType),
+        0, 0, 4, Compiler::IntegerType, 5,
+        c->register_(t->arch->thread()), base, offset, expect, update));
+    return true;
+  } else if (not instance) {
+    return false;
+  } else if (MATCH(name, "getIntVolatile")
+             and MATCH(spec, "(Ljava/lang/Object;J)I"))
+  {
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory(base, Compiler::IntegerType, 0, offset, 1),
+        TargetBytesPerWord));
+    c->loadBarrier();
+    return true;
+  } else if (TargetBytesPerWord == 8
+             and MATCH(name, "getLongVolatile")
+             and MATCH(spec, "(Ljava/lang/Object;J)J"))
+  {
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory(base, Compiler::IntegerType, 0, offset, 1), 8));
+    c->loadBarrier();
+    return true;
+  } else if (MATCH(name, "getObjectVolatile")
+             and MATCH(spec, "(Ljava/lang/Object;J)Ljava/lang/Object;"))
+  {
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    frame->pushObject
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory(base, Compiler::ObjectType, 0, offset, 1),
+        TargetBytesPerWord));
+    c->loadBarrier();
+    return true;
+  }
+
+  // putXVolatile stores need a store-load barrier after the store;
+  // putOrderedX stores only need to be ordered after earlier stores
+  bool volatile_;
+  if (MATCH(name, "putIntVolatile")
+      or MATCH(name, "putLongVolatile")
+      or MATCH(name, "putObjectVolatile"))
+  {
+    volatile_ = true;
+  } else if (MATCH(name, "putOrderedInt")
+             or MATCH(name, "putOrderedLong")
+             or MATCH(name, "putOrderedObject"))
+  {
+    volatile_ = false;
+  } else {
+    return false;
+  }
+
+  if (MATCH(spec, "(Ljava/lang/Object;JI)V")) {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    c->storeStoreBarrier();
+    c->store
+      (TargetBytesPerWord, value, 4, c->memory
+       (base, Compiler::IntegerType, 0, offset, 1));
+  } else if (TargetBytesPerWord == 8
+             and MATCH(spec, "(Ljava/lang/Object;JJ)V"))
+  {
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    c->storeStoreBarrier();
+    c->store
+      (8, value, 8, c->memory(base, Compiler::IntegerType, 0, offset, 1));
+  } else if (MATCH(spec, "(Ljava/lang/Object;JLjava/lang/Object;)V")) {
+    Compiler::Operand* value = frame->popObject();
+    Compiler::Operand* offset = popLongAddress(frame);
+    Compiler::Operand* base = frame->popObject();
+    frame->popObject();
+
+    c->storeStoreBarrier();
+    c->call
+      (c->constant(getThunk(t, setThunk), Compiler::AddressType),
+       0, 0, 0, Compiler::VoidType,
+       4, c->register_(t->arch->thread()), base, offset, value);
+  } else {
+    return false;
+  }
+
+  if (volatile_) {
+    c->storeLoadBarrier();
+  }
+  return true;
+}
+
+bool
+intrinsic(MyThread* t, Frame* frame, object target)
+{
+  object className = vm::className(t, methodClass(t, target));
+  if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
+    Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "sqrt")
+        and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->fsqrt(8, frame->popLong()));
+      return true;
+    } else if (MATCH(methodName(t, target), "abs")) {
+      if (MATCH(methodSpec(t, target), "(I)I")) {
+        frame->pushInt(c->abs(4, frame->popInt()));
+        return true;
+      } else if (MATCH(methodSpec(t, target), "(J)J")) {
+        frame->pushLong(c->abs(8, frame->popLong()));
+        return true;
+      } else if (MATCH(methodSpec(t, target), "(F)F")) {
+        frame->pushInt(c->fabs(4, frame->popInt()));
+        return true;
+      } else if (MATCH(methodSpec(t, target), "(D)D")) {
+        // not every backend supports FloatAbsolute on doubles, so
+        // clear the sign bit directly
+        frame->pushLong
+          (c->and_
+           (8, c->constant(INT64_MAX, Compiler::IntegerType),
+            frame->popLong()));
+        return true;
+      }
+    } else if (MATCH(methodSpec(t, target), "(D)D")) {
+      // only intrinsify roundings the target can do in one instruction,
+      // since the thunks would be no faster than the library calls
+      if (MATCH(methodName(t, target), "floor")
+          and nativeOperation(t, FloatFloor, 8, 8))
+      {
+        frame->pushLong(c->ffloor(8, frame->popLong()));
+        return true;
+      } else if (MATCH(methodName(t, target), "ceil")
+                 and nativeOperation(t, FloatCeiling, 8, 8))
+      {
+        frame->pushLong(c->fceil(8, frame->popLong()));
+        return true;
+      } else if (MATCH(methodName(t, target), "rint")
+                 and nativeOperation(t, FloatRound, 8, 8))
+      {
+        frame->pushLong(c->frint(8, frame->popLong()));
+        return true;
+      }
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Integer")
+                      or MATCH(className, "java/lang/Long")))
+  {
+    Compiler* c = frame->c;
+    unsigned size;
+    if (MATCH(methodSpec(t, target), "(I)I")) {
+      size = 4;
+    } else if (MATCH(methodSpec(t, target), "(J)I")) {
+      size = 8;
+    } else {
+      return false;
+    }
+
+    BinaryOperation op;
+    if (MATCH(methodName(t, target), "bitCount")) {
+      op = PopulationCount;
+    } else if (MATCH(methodName(t, target), "numberOfLeadingZeros")) {
+      op = CountLeadingZeros;
+    } else if (MATCH(methodName(t, target), "numberOfTrailingZeros")) {
+      op = CountTrailingZeros;
+    } else {
+      return false;
+    }
+
+    if (not nativeOperation(t, op, size, 4)) {
+      return false;
+    }
+
+    Compiler::Operand* value = size == 8
+      ? frame->popLong() : frame->popInt();
+
+    switch (op) {
+    case PopulationCount:
+      frame->pushInt(c->popcount(size, 4, value));
+      break;
+
+    case CountLeadingZeros:
+      frame->pushInt(c->clz(size, 4, value));
+      break;
+
+    case CountTrailingZeros:
+      frame->pushInt(c->ctz(size, 4, value));
+      break;
+
+    default: abort(t);
+    }
+    return true;
+  } else if (UNLIKELY(MATCH(className, "java/lang/System"))) {
+    Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "arraycopy")
+        and MATCH(methodSpec(t, target),
+                  "(Ljava/lang/Object;ILjava/lang/Object;II)V"))
+    {
+      Compiler::Operand* length = frame->popInt();
+      Compiler::Operand* dstOffset = frame->popInt();
+      Compiler::Operand* dst = frame->popObject();
+      Compiler::Operand* srcOffset = frame->popInt();
+      Compiler::Operand* src = frame->popObject();
+
+      c->call
+        (c->constant(getThunk(t, copyArrayThunk), Compiler::AddressType),
+         0, frame->trace(0, 0), 0, Compiler::VoidType, 6,
+         c->register_(t->arch->thread()), src, srcOffset, dst, dstOffset,
+         length);
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Float"))) {
+    // float values and their raw bits occupy the same stack slot, so
+    // these conversions need no code at all
+    if ((MATCH(methodName(t, target), "floatToRawIntBits")
+         and MATCH(methodSpec(t, target), "(F)I"))
+        or (MATCH(methodName(t, target), "intBitsToFloat")
+            and MATCH(methodSpec(t, target), "(I)F")))
+    {
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Double"))) {
+    if ((MATCH(methodName(t, target), "doubleToRawLongBits")
+         and MATCH(methodSpec(t, target), "(D)J"))
+        or (MATCH(methodName(t, target), "longBitsToDouble")
+            and MATCH(methodSpec(t, target), "(J)D")))
+    {
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "avian/Atomic"))) {
+    return atomicIntrinsic(t, frame, target, false);
+  } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
+    Compiler* c = frame->c;
+    if (atomicIntrinsic(t, frame, target, true)) {
+      return true;
+    } else if (MATCH(methodName(t, target), "getByte")
+        and MATCH(methodSpec(t, target), "(J)B"))
+    {
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      frame->pushInt
+        (c->load
+         (1, 1, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+          TargetBytesPerWord));
+      return true;
+    } else if (MATCH(methodName(t, target), "putByte")
+               and MATCH(methodSpec(t, target), "(JB)V"))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
       c->store
         (TargetBytesPerWord, value, 1, c->memory
          (address, Compiler::IntegerType, 0, 0, 1));
@@ -3928,114 +5171,2056 @@ intrinsic(MyThread* t, Frame* frame, object target)
                or (MATCH(methodName(t, target), "getChar")
                    and MATCH(methodSpec(t, target), "(J)C")))
     {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushInt
-        (c->load
-         (2, 2, c->memory(address, Compiler::IntegerType, 0, 0, 1),
-          TargetBytesPerWord));
-      return true;
-    } else if ((MATCH(methodName(t, target), "putShort")
-                and MATCH(methodSpec(t, target), "(JS)V"))
-               or (MATCH(methodName(t, target), "putChar")
-                   and MATCH(methodSpec(t, target), "(JC)V")))
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      frame->pushInt
+        (c->load
+         (2, 2, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+          TargetBytesPerWord));
+      return true;
+    } else if ((MATCH(methodName(t, target), "putShort")
+                and MATCH(methodSpec(t, target), "(JS)V"))
+               or (MATCH(methodName(t, target), "putChar")
+                   and MATCH(methodSpec(t, target), "(JC)V")))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      c->store
+        (TargetBytesPerWord, value, 2, c->memory
+         (address, Compiler::IntegerType, 0, 0, 1));
+      return true;
+    } else if ((MATCH(methodName(t, target), "getInt")
+                and MATCH(methodSpec(t, target), "(J)I"))
+               or (MATCH(methodName(t, target), "getFloat")
+                   and MATCH(methodSpec(t, target), "(J)F")))
+    {
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      frame->pushInt
+        (c->load
+         (4, 4, c->memory
+          (address, MATCH(methodName(t, target), "getInt")
+           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
+          TargetBytesPerWord));
+      return true;
+    } else if ((MATCH(methodName(t, target), "putInt")
+                and MATCH(methodSpec(t, target), "(JI)V"))
+               or (MATCH(methodName(t, target), "putFloat")
+                   and MATCH(methodSpec(t, target), "(JF)V")))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      c->store
+        (TargetBytesPerWord, value, 4, c->memory
+         (address, MATCH(methodName(t, target), "putInt")
+           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
+      return true;
+    } else if ((MATCH(methodName(t, target), "getLong")
+                and MATCH(methodSpec(t, target), "(J)J"))
+               or (MATCH(methodName(t, target), "getDouble")
+                   and MATCH(methodSpec(t, target), "(J)D")))
+    {
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      frame->pushLong
+        (c->load
+         (8, 8, c->memory
+          (address, MATCH(methodName(t, target), "getLong")
+           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
+          8));
+      return true;
+    } else if ((MATCH(methodName(t, target), "putLong")
+                and MATCH(methodSpec(t, target), "(JJ)V"))
+               or (MATCH(methodName(t, target), "putDouble")
+                   and MATCH(methodSpec(t, target), "(JD)V")))
+    {
+      Compiler::Operand* value = frame->popLong();
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      c->store
+        (8, value, 8, c->memory
+         (address, MATCH(methodName(t, target), "putLong")
+           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
+      return true;
+    } else if (MATCH(methodName(t, target), "getAddress")
+                and MATCH(methodSpec(t, target), "(J)J"))
+    {
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      frame->pushLong
+        (c->load
+         (TargetBytesPerWord, TargetBytesPerWord,
+          c->memory(address, Compiler::AddressType, 0, 0, 1), 8));
+      return true;
+    } else if (MATCH(methodName(t, target), "putAddress")
+               and MATCH(methodSpec(t, target), "(JJ)V"))
+    {
+      Compiler::Operand* value = frame->popLong();
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->popObject();
+      c->store
+        (8, value, TargetBytesPerWord, c->memory
+         (address, Compiler::AddressType, 0, 0, 1));
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the length of the instruction at ip, or zero if it is one
+// which findScalarReplacements does not handle.
+unsigned
+instructionLength(MyThread* t, object code, unsigned ip)
+{
+  unsigned instruction = codeBody(t, code, ip);
+
+  switch (instruction) {
+  case aload:
+  case astore:
+  case bipush:
+  case dload:
+  case dstore:
+  case fload:
+  case fstore:
+  case iload:
+  case istore:
+  case ldc:
+  case lload:
+  case lstore:
+  case newarray:
+    return 2;
+
+  case anewarray:
+  case checkcast:
+  case getfield:
+  case getstatic:
+  case goto_:
+  case if_acmpeq:
+  case if_acmpne:
+  case if_icmpeq:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case if_icmplt:
+  case if_icmpne:
+  case ifeq:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case iflt:
+  case ifne:
+  case ifnonnull:
+  case ifnull:
+  case iinc:
+  case instanceof:
+  case invokespecial:
+  case invokestatic:
+  case invokevirtual:
+  case ldc_w:
+  case ldc2_w:
+  case new_:
+  case putfield:
+  case putstatic:
+  case sipush:
+    return 3;
+
+  case multianewarray:
+    return 4;
+
+  case goto_w:
+  case invokeinterface:
+    return 5;
+
+  case tableswitch: {
+    unsigned index = ((ip + 4) & ~3) + 4; // skip padding and default
+    int32_t bottom = codeReadInt32(t, code, index);
+    int32_t top = codeReadInt32(t, code, index);
+    return index - ip + ((top - bottom + 1) * 4);
+  }
+
+  case lookupswitch: {
+    unsigned index = ((ip + 4) & ~3) + 4; // skip padding and default
+    int32_t pairCount = codeReadInt32(t, code, index);
+    return index - ip + (pairCount * 8);
+  }
+
+  case jsr:
+  case jsr_w:
+  case ret:
+  case wide:
+    return 0;
+
+  default:
+    return instruction > jsr_w ? 0 : 1;
+  }
+}
+
+bool
+isScalarArgument(unsigned instruction)
+{
+  // instructions which may compute constructor arguments without
+  // branching, allocating, calling, or rearranging the operand stack:
+  return (instruction >= aconst_null and instruction <= saload)
+    or (instruction >= iadd and instruction <= lxor)
+    or (instruction >= i2l and instruction <= dcmpg)
+    or instruction == getfield
+    or instruction == getstatic;
+}
+
+bool
+isLocalLoad(unsigned instruction, unsigned* index)
+{
+  if (instruction >= iload_0 and instruction <= aload_3) {
+    *index = (instruction - iload_0) % 4;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+unsigned
+astoreIndex(MyThread* t, object code, unsigned ip)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  if (instruction == astore) {
+    return codeBody(t, code, ip + 1);
+  } else {
+    assert(t, instruction >= astore_0 and instruction <= astore_3);
+    return instruction - astore_0;
+  }
+}
+
+unsigned
+scalarFieldCount(MyThread* t, object class_)
+{
+  object table = classFieldTable(t, class_);
+  unsigned count = 0;
+  if (table) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      if ((fieldFlags(t, arrayBody(t, table, i)) & ACC_STATIC) == 0) {
+        ++ count;
+      }
+    }
+  }
+  return count;
+}
+
+// Returns the position of the specified field among the instance
+// fields of its class, counting long and double fields twice if
+// inSlots is true.
+unsigned
+scalarFieldIndex(MyThread* t, object field, bool inSlots)
+{
+  object table = classFieldTable(t, fieldClass(t, field));
+  unsigned index = 0;
+  for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+    object f = arrayBody(t, table, i);
+    if (f == field) {
+      break;
+    } else if ((fieldFlags(t, f) & ACC_STATIC) == 0) {
+      index += (inSlots and (fieldCode(t, f) == LongField
+                             or fieldCode(t, f) == DoubleField)) ? 2 : 1;
+    }
+  }
+  return index;
+}
+
+unsigned
+scalarFootprint(MyThread* t, object class_)
+{
+  object table = classFieldTable(t, class_);
+  unsigned footprint = 0;
+  if (table) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
+        footprint += (fieldCode(t, field) == LongField
+                      or fieldCode(t, field) == DoubleField) ? 2 : 1;
+      }
+    }
+  }
+  return footprint;
+}
+
+// Returns the class referred to by the specified pool index if
+// instances of it may be replaced by scalars, or zero otherwise.
+object
+scalarClass(MyThread* t, object method, unsigned index)
+{
+  object class_ = resolveClassInPool(t, method, index - 1, false);
+
+  if (class_ == 0
+      or (classFlags(t, class_) & (ACC_INTERFACE | ACC_ABSTRACT))
+      or (classVmFlags(t, class_)
+          & (NeedInitFlag | WeakReferenceFlag | HasFinalizerFlag))
+      or classSuper(t, class_) != type(t, Machine::JobjectType)
+      or scalarFieldCount(t, class_) > MaxScalarFields)
+  {
+    return 0;
+  }
+
+  return class_;
+}
+
+// Matches constructors which only call Object.<init> and assign
+// arguments or zero constants to fields.  For each instance field, in
+// declaration order, assignments receives the local index of the
+// argument last assigned to it, or zero if it keeps its default value.
+bool
+scalarConstructor(MyThread* t, object constructor, uint16_t* assignments)
+{
+  if (methodFlags(t, constructor) & (ACC_NATIVE | ACC_SYNCHRONIZED)) {
+    return false;
+  }
+
+  ensureCode(t, constructor);
+
+  // compiled methods no longer carry their bytecode, and another
+  // thread may compile this one at any time, so we work on a clone:
+  object clone = methodClone(t, constructor);
+  PROTECT(t, clone);
+
+  object code = methodCode(t, clone);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+  if (length < 5
+      or codeBody(t, code, 0) != aload_0
+      or codeBody(t, code, 1) != invokespecial)
+  {
+    return false;
+  }
+
+  unsigned ip = 2;
+  object superConstructor = resolveMethod
+    (t, clone, codeReadInt16(t, code, ip) - 1, false);
+
+  if (superConstructor == 0
+      or methodClass(t, superConstructor) != type(t, Machine::JobjectType)
+      or (methodVmFlags(t, superConstructor) & ConstructorFlag) == 0)
+  {
+    return false;
+  }
+
+  memset(assignments, 0, MaxScalarFields * sizeof(uint16_t));
+
+  unsigned parameterFootprint = methodParameterFootprint(t, clone);
+
+  while (ip < length) {
+    unsigned instruction = codeBody(t, code, ip++);
+    if (instruction == return_) {
+      return ip == length;
+    } else if (instruction != aload_0 or ip + 4 > length) {
+      return false;
+    }
+
+    unsigned argument;
+    instruction = codeBody(t, code, ip++);
+    switch (instruction) {
+    case aconst_null:
+    case dconst_0:
+    case fconst_0:
+    case iconst_0:
+    case lconst_0:
+      argument = 0;
+      break;
+
+    case aload:
+    case dload:
+    case fload:
+    case iload:
+    case lload:
+      argument = codeBody(t, code, ip++);
+      if (argument == 0 or argument >= parameterFootprint) {
+        return false;
+      }
+      break;
+
+    default:
+      if ((not isLocalLoad(instruction, &argument))
+          or argument == 0 or argument >= parameterFootprint)
+      {
+        return false;
+      }
+      break;
+    }
+
+    if (ip + 3 > length or codeBody(t, code, ip++) != putfield) {
+      return false;
+    }
+
+    object field = resolveField
+      (t, clone, codeReadInt16(t, code, ip) - 1, false);
+
+    if (field == 0
+        or (fieldFlags(t, field) & ACC_STATIC)
+        or fieldClass(t, field) != methodClass(t, clone))
+    {
+      return false;
+    }
+
+    assignments[scalarFieldIndex(t, field, false)] = argument;
+  }
+
+  return false;
+}
+
+class ScalarSlot {
+ public:
+  uint16_t classIndex;
+  uint16_t constructions;
+  uint16_t stores;
+  uint16_t base;
+  bool escapes;
+};
+
+class ScalarConstruction {
+ public:
+  unsigned newIp;
+  unsigned invokeIp;
+  unsigned storeIp;
+  unsigned slot;
+  uint16_t assignments[MaxScalarFields];
+};
+
+// Matches "new C; dup; <arguments>; invokespecial C.<init>; astore n"
+// at the specified ip.
+bool
+matchScalarConstruction(MyThread* t, object code, unsigned ip,
+                        ScalarConstruction* construction)
+{
+  unsigned length = codeLength(t, code);
+
+  construction->newIp = ip;
+  ip += 3;
+
+  if (ip >= length or codeBody(t, code, ip++) != dup) {
+    return false;
+  }
+
+  while (ip < length and codeBody(t, code, ip) != invokespecial) {
+    if (not isScalarArgument(codeBody(t, code, ip))) {
+      return false;
+    }
+    ip += instructionLength(t, code, ip);
+  }
+
+  construction->invokeIp = ip;
+  ip += 3;
+
+  if (ip >= length) {
+    return false;
+  }
+
+  unsigned instruction = codeBody(t, code, ip);
+  if (instruction != astore
+      and (instruction < astore_0 or instruction > astore_3))
+  {
+    return false;
+  }
+
+  construction->storeIp = ip;
+  construction->slot = astoreIndex(t, code, ip);
+
+  return true;
+}
+
+void
+markBranchTarget(uintptr_t* targets, unsigned length, unsigned ip,
+                 int32_t offset)
+{
+  unsigned target = ip + offset;
+  if (target < length) {
+    markBit(targets, target);
+  }
+}
+
+// Marks in targets each ip to which the instruction at ip may branch.
+void
+markBranchTargets(MyThread* t, object code, unsigned ip, uintptr_t* targets)
+{
+  unsigned length = codeLength(t, code);
+  unsigned index;
+
+  switch (codeBody(t, code, ip)) {
+  case goto_:
+  case if_acmpeq:
+  case if_acmpne:
+  case if_icmpeq:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case if_icmplt:
+  case if_icmpne:
+  case ifeq:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case iflt:
+  case ifne:
+  case ifnonnull:
+  case ifnull:
+    index = ip + 1;
+    markBranchTarget
+      (targets, length, ip,
+       static_cast<int16_t>(codeReadInt16(t, code, index)));
+    break;
+
+  case goto_w:
+    index = ip + 1;
+    markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+    break;
+
+  case tableswitch: {
+    index = (ip + 4) & ~3;
+    markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+
+    int32_t bottom = codeReadInt32(t, code, index);
+    int32_t top = codeReadInt32(t, code, index);
+    for (int32_t i = bottom; i <= top; ++i) {
+      markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+    }
+  } break;
+
+  case lookupswitch: {
+    index = (ip + 4) & ~3;
+    markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+
+    int32_t pairCount = codeReadInt32(t, code, index);
+    for (int32_t i = 0; i < pairCount; ++i) {
+      index += 4; // skip key
+      markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+    }
+  } break;
+
+  default: break;
+  }
+}
+
+// Looks for allocations whose instances are only ever constructed by
+// trivial constructors, stored to local variables, and read by
+// getfield, and which may therefore be replaced by a set of local
+// variables, one per field.  If any are found, the method's code is
+// replaced with a copy with room for those variables, and a table is
+// returned which is indexed by ip and marks the new_ instructions to
+// be eliminated (with 1), the invokespecial instructions to be
+// replaced with stores to the variables (with 1 + the index in the
+// table of the first variable followed by the constructor's
+// assignments), and the getfield instructions to be replaced with
+// loads from them (with 1 + the variable's index).
+object
+findScalarReplacements(MyThread* t, object method)
+{
+  // without the wide prefix, aload and astore can only address the
+  // first 256 locals:
+  const unsigned SlotCount = 256;
+
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+
+  ScalarSlot slots[SlotCount];
+  memset(slots, 0, sizeof(slots));
+
+  ScalarConstruction constructions[MaxScalarConstructions];
+  unsigned constructionCount = 0;
+
+  unsigned targetsSize = ceiling(length, BitsPerWord);
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, targets, targetsSize);
+  memset(RUNTIME_ARRAY_BODY(targets), 0, targetsSize * BytesPerWord);
+
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return 0;
+    }
+
+    unsigned instruction = codeBody(t, code, ip);
+    unsigned index;
+
+    switch (instruction) {
+    case aload:
+    case aload_0:
+    case aload_1:
+    case aload_2:
+    case aload_3:
+      index = instruction == aload
+        ? codeBody(t, code, ip + 1) : instruction - aload_0;
+
+      if (ip + size >= length or codeBody(t, code, ip + size) != getfield) {
+        slots[index].escapes = true;
+      }
+      break;
+
+    case astore:
+    case astore_0:
+    case astore_1:
+    case astore_2:
+    case astore_3:
+      ++ slots[astoreIndex(t, code, ip)].stores;
+      break;
+
+    case new_:
+      if (constructionCount < MaxScalarConstructions
+          and matchScalarConstruction
+          (t, code, ip, constructions + constructionCount))
+      {
+        ScalarSlot* s = slots + constructions[constructionCount].slot;
+        unsigned classIndex = ip + 1;
+        classIndex = codeReadInt16(t, code, classIndex);
+
+        if (s->constructions == 0) {
+          s->classIndex = classIndex;
+        } else if (s->classIndex != classIndex) {
+          s->escapes = true;
+        }
+
+        ++ s->constructions;
+        ++ constructionCount;
+      }
+      break;
+
+    default:
+      markBranchTargets(t, code, ip, RUNTIME_ARRAY_BODY(targets));
+      break;
+    }
+
+    ip += size;
+  }
+
+  if (constructionCount == 0) {
+    return 0;
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      markBranchTarget
+        (RUNTIME_ARRAY_BODY(targets), length, 0, exceptionHandlerIp
+         (exceptionHandlerTableBody(t, eht, i)));
+    }
+  }
+
+  unsigned parameterFootprint = methodParameterFootprint(t, method);
+
+  for (unsigned i = 0; i < SlotCount; ++i) {
+    ScalarSlot* s = slots + i;
+    if (s->constructions != s->stores or i < parameterFootprint) {
+      s->escapes = true;
+    }
+  }
+
+  // control must not enter a construction sequence anywhere but at
+  // its beginning, and the constructor must be one we understand:
+  for (unsigned i = 0; i < constructionCount; ++i) {
+    ScalarConstruction* construction = constructions + i;
+    ScalarSlot* s = slots + construction->slot;
+
+    if (s->escapes) {
+      continue;
+    }
+
+    for (unsigned ip = construction->newIp + 1;
+         ip <= construction->storeIp; ++ip)
+    {
+      if (getBit(RUNTIME_ARRAY_BODY(targets), ip)) {
+        s->escapes = true;
+        break;
+      }
+    }
+
+    if (s->escapes or scalarClass(t, method, s->classIndex) == 0) {
+      s->escapes = true;
+      continue;
+    }
+
+    unsigned index = construction->invokeIp + 1;
+    object constructor = resolveMethod
+      (t, method, codeReadInt16(t, code, index) - 1, false);
+
+    if (constructor == 0
+        or methodClass(t, constructor)
+        != scalarClass(t, method, s->classIndex)
+        or (not scalarConstructor
+            (t, constructor, construction->assignments)))
     {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (TargetBytesPerWord, value, 2, c->memory
-         (address, Compiler::IntegerType, 0, 0, 1));
-      return true;
-    } else if ((MATCH(methodName(t, target), "getInt")
-                and MATCH(methodSpec(t, target), "(J)I"))
-               or (MATCH(methodName(t, target), "getFloat")
-                   and MATCH(methodSpec(t, target), "(J)F")))
+      s->escapes = true;
+    }
+  }
+
+  // every remaining load must be of a field of the slot's class, and
+  // since the value loaded by getfield will come from a variable
+  // instead, control must not enter between the two:
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned instruction = codeBody(t, code, ip);
+    if (instruction == aload
+        or (instruction >= aload_0 and instruction <= aload_3))
     {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
+      unsigned size = instructionLength(t, code, ip);
+      ScalarSlot* s = slots + (instruction == aload
+                               ? codeBody(t, code, ip + 1)
+                               : instruction - aload_0);
+
+      if (s->escapes or s->constructions == 0) {
+        continue;
+      }
+
+      unsigned index = ip + size + 1;
+      object field = resolveField
+        (t, method, codeReadInt16(t, code, index) - 1, false);
+
+      if (getBit(RUNTIME_ARRAY_BODY(targets), ip + size)
+          or field == 0
+          or (fieldFlags(t, field) & ACC_STATIC)
+          or fieldClass(t, field) != scalarClass(t, method, s->classIndex))
+      {
+        s->escapes = true;
+      }
+    }
+  }
+
+  unsigned maxLocals = codeMaxLocals(t, code);
+  unsigned footprint = 0;
+  unsigned tableLength = length;
+
+  for (unsigned i = 0; i < SlotCount; ++i) {
+    ScalarSlot* s = slots + i;
+    if (s->constructions and not s->escapes) {
+      object class_ = scalarClass(t, method, s->classIndex);
+      s->base = maxLocals + footprint;
+      footprint += scalarFootprint(t, class_);
+      tableLength += s->constructions * (1 + scalarFieldCount(t, class_));
+    }
+  }
+
+  if (tableLength == length or tableLength >= 0xFFFF
+      or maxLocals + footprint >= 0xFFFF)
+  {
+    return 0;
+  }
+
+  object table = makeShortArray(t, tableLength);
+  PROTECT(t, table);
+
+  unsigned position = length;
+  for (unsigned i = 0; i < constructionCount; ++i) {
+    ScalarConstruction* construction = constructions + i;
+    ScalarSlot* s = slots + construction->slot;
+
+    if (not s->escapes) {
+      shortArrayBody(t, table, construction->newIp) = 1;
+      shortArrayBody(t, table, construction->invokeIp) = 1 + position;
+      shortArrayBody(t, table, position++) = s->base;
+
+      unsigned count = scalarFieldCount
+        (t, scalarClass(t, method, s->classIndex));
+      for (unsigned j = 0; j < count; ++j) {
+        shortArrayBody(t, table, position++) = construction->assignments[j];
+      }
+    }
+  }
+
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned instruction = codeBody(t, code, ip);
+    if (instruction == aload
+        or (instruction >= aload_0 and instruction <= aload_3))
+    {
+      unsigned size = instructionLength(t, code, ip);
+      ScalarSlot* s = slots + (instruction == aload
+                               ? codeBody(t, code, ip + 1)
+                               : instruction - aload_0);
+
+      if (s->constructions and not s->escapes) {
+        unsigned index = ip + size + 1;
+        object field = resolveField
+          (t, method, codeReadInt16(t, code, index) - 1, false);
+
+        shortArrayBody(t, table, ip + size)
+          = 1 + s->base + scalarFieldIndex(t, field, true);
+      }
+    }
+  }
+
+  object newCode = makeCode
+    (t, codePool(t, code), codeExceptionHandlerTable(t, code),
+     codeLineNumberTable(t, code), 0, 0, 0, codeMaxStack(t, code),
+     maxLocals + footprint, length);
+
+  memcpy(&codeBody(t, newCode, 0), &codeBody(t, code, 0), length);
+
+  set(t, method, MethodCode, newCode);
+
+  return table;
+}
+
+unsigned
+scalarTableEntry(MyThread* t, Context* context, unsigned ip)
+{
+  return context->scalarTable
+    ? static_cast<uint16_t>(shortArrayBody(t, context->scalarTable, ip))
+    : 0;
+}
+
+// Compiles an invokespecial of a constructor marked by
+// findScalarReplacements, storing its arguments directly into the
+// variables which replace the fields of the instance.
+void
+storeScalars(MyThread* t, Frame* frame, object constructor,
+             unsigned position)
+{
+  Compiler* c = frame->c;
+  object table = frame->context->scalarTable;
+
+  unsigned footprint = methodParameterFootprint(t, constructor);
+  RUNTIME_ARRAY(unsigned, starts, footprint);
+  RUNTIME_ARRAY(char, types, footprint);
+  RUNTIME_ARRAY(Compiler::Operand*, arguments, footprint);
+
+  unsigned count = 0;
+  unsigned index = 1;
+  for (MethodSpecIterator it
+         (t, reinterpret_cast<const char*>
+          (&byteArrayBody(t, methodSpec(t, constructor), 0)));
+       it.hasNext();)
+  {
+    char type = *it.next();
+    RUNTIME_ARRAY_BODY(starts)[count++] = index;
+    RUNTIME_ARRAY_BODY(types)[index] = type;
+    index += (type == 'J' or type == 'D') ? 2 : 1;
+  }
+
+  while (count) {
+    index = RUNTIME_ARRAY_BODY(starts)[--count];
+    switch (RUNTIME_ARRAY_BODY(types)[index]) {
+    case 'J':
+    case 'D':
+      RUNTIME_ARRAY_BODY(arguments)[index] = frame->popLong();
+      break;
+
+    case 'L':
+    case '[':
+      RUNTIME_ARRAY_BODY(arguments)[index] = frame->popObject();
+      break;
+
+    default:
+      RUNTIME_ARRAY_BODY(arguments)[index] = frame->popInt();
+      break;
+    }
+  }
+
+  // pop the null standing in for the receiver; the copy made by dup
+  // will be stored to the local which would have held the instance:
+  frame->pop(1);
+
+  unsigned local = static_cast<uint16_t>(shortArrayBody(t, table, position));
+  object fieldTable = classFieldTable(t, methodClass(t, constructor));
+
+  for (unsigned i = 0; i < arrayLength(t, fieldTable); ++i) {
+    object field = arrayBody(t, fieldTable, i);
+    if (fieldFlags(t, field) & ACC_STATIC) {
+      continue;
+    }
+
+    unsigned argument = shortArrayBody(t, table, ++ position);
+    Compiler::Operand* value = argument
+      ? RUNTIME_ARRAY_BODY(arguments)[argument] : 0;
+
+    switch (fieldCode(t, field)) {
+    case ByteField:
+    case BooleanField:
       frame->pushInt
-        (c->load
-         (4, 4, c->memory
-          (address, MATCH(methodName(t, target), "getInt")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
-          TargetBytesPerWord));
+        (value ? c->load(TargetBytesPerWord, 1, value, TargetBytesPerWord)
+         : c->constant(0, Compiler::IntegerType));
+      frame->storeInt(local++);
+      break;
+
+    case CharField:
+      frame->pushInt
+        (value ? c->loadz(TargetBytesPerWord, 2, value, TargetBytesPerWord)
+         : c->constant(0, Compiler::IntegerType));
+      frame->storeInt(local++);
+      break;
+
+    case ShortField:
+      frame->pushInt
+        (value ? c->load(TargetBytesPerWord, 2, value, TargetBytesPerWord)
+         : c->constant(0, Compiler::IntegerType));
+      frame->storeInt(local++);
+      break;
+
+    case FloatField:
+      frame->pushInt
+        (value ? value : c->constant(floatToBits(0.0), Compiler::FloatType));
+      frame->storeInt(local++);
+      break;
+
+    case IntField:
+      frame->pushInt(value ? value : c->constant(0, Compiler::IntegerType));
+      frame->storeInt(local++);
+      break;
+
+    case DoubleField:
+      frame->pushLong
+        (value ? value
+         : c->constant(doubleToBits(0.0), Compiler::FloatType));
+      frame->storeLong(local);
+      local += 2;
+      break;
+
+    case LongField:
+      frame->pushLong(value ? value : c->constant(0, Compiler::IntegerType));
+      frame->storeLong(local);
+      local += 2;
+      break;
+
+    case ObjectField:
+      frame->pushObject(value ? value : c->constant(0, Compiler::ObjectType));
+      frame->storeObject(local++);
+      break;
+
+    default:
+      abort(t);
+    }
+  }
+}
+
+// Compiles a getfield marked by findScalarReplacements.
+void
+loadScalar(MyThread* t, Frame* frame, object field, unsigned local)
+{
+  // pop the instance, which is either the null loaded from the local
+  // which would have held it or, for a field moved out of a loop by
+  // findLoopInvariants, this:
+  frame->pop(1);
+
+  switch (fieldCode(t, field)) {
+  case DoubleField:
+  case LongField:
+    frame->loadLong(local);
+    break;
+
+  case ObjectField:
+    frame->loadObject(local);
+    break;
+
+  default:
+    frame->loadInt(local);
+    break;
+  }
+}
+
+bool
+isLocalAccess(MyThread* t, object code, unsigned ip, unsigned wideForm,
+              unsigned firstShortForm, unsigned* index)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  if (instruction == wideForm) {
+    *index = codeBody(t, code, ip + 1);
+    return true;
+  } else if (instruction >= firstShortForm
+             and instruction <= firstShortForm + 3)
+  {
+    *index = instruction - firstShortForm;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+bool
+isNonNegativeConstant(MyThread* t, object code, unsigned ip)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  if (instruction >= iconst_0 and instruction <= iconst_5) {
+    return true;
+  } else if (instruction == bipush) {
+    return static_cast<int8_t>(codeBody(t, code, ip + 1)) >= 0;
+  } else if (instruction == sipush) {
+    ++ ip;
+    return static_cast<int16_t>(codeReadInt16(t, code, ip)) >= 0;
+  } else {
+    return false;
+  }
+}
+
+unsigned
+fieldFootprint(MyThread* t, object code, unsigned ip)
+{
+  ++ ip;
+  object o = singletonObject
+    (t, codePool(t, code), codeReadInt16(t, code, ip) - 1);
+
+  loadMemoryBarrier();
+
+  if (objectClass(t, o) == type(t, Machine::ReferenceType)) {
+    int8_t c = byteArrayBody(t, referenceSpec(t, o), 0);
+    return (c == 'J' or c == 'D') ? 2 : 1;
+  } else {
+    return (fieldCode(t, o) == LongField or fieldCode(t, o) == DoubleField)
+      ? 2 : 1;
+  }
+}
+
+// Stores in *pops and *pushes the number of operand stack words
+// consumed and produced by the instruction at ip, returning false if
+// it is not one findArrayAccess follows.
+bool
+stackEffect(MyThread* t, object code, unsigned ip, unsigned* pops,
+            unsigned* pushes)
+{
+  switch (codeBody(t, code, ip)) {
+  case aconst_null: case iconst_m1: case iconst_0: case iconst_1:
+  case iconst_2: case iconst_3: case iconst_4: case iconst_5:
+  case fconst_0: case fconst_1: case fconst_2: case bipush: case sipush:
+  case ldc: case ldc_w: case iload: case fload: case aload:
+  case iload_0: case iload_1: case iload_2: case iload_3:
+  case fload_0: case fload_1: case fload_2: case fload_3:
+  case aload_0: case aload_1: case aload_2: case aload_3:
+    *pops = 0;
+    *pushes = 1;
+    return true;
+
+  case lconst_0: case lconst_1: case dconst_0: case dconst_1: case ldc2_w:
+  case lload: case dload:
+  case lload_0: case lload_1: case lload_2: case lload_3:
+  case dload_0: case dload_1: case dload_2: case dload_3:
+    *pops = 0;
+    *pushes = 2;
+    return true;
+
+  case iinc:
+    *pops = 0;
+    *pushes = 0;
+    return true;
+
+  case ineg: case fneg: case i2f: case f2i: case i2b: case i2c: case i2s:
+  case arraylength:
+    *pops = 1;
+    *pushes = 1;
+    return true;
+
+  case i2l: case i2d: case f2l: case f2d:
+    *pops = 1;
+    *pushes = 2;
+    return true;
+
+  case lneg: case dneg: case l2d: case d2l:
+    *pops = 2;
+    *pushes = 2;
+    return true;
+
+  case l2i: case l2f: case d2i: case d2f:
+  case iaload: case faload: case aaload: case baload: case caload:
+  case saload:
+  case iadd: case isub: case imul: case idiv: case irem: case iand:
+  case ior: case ixor: case ishl: case ishr: case iushr:
+  case fadd: case fsub: case fmul: case fdiv: case frem:
+  case fcmpl: case fcmpg:
+    *pops = 2;
+    *pushes = 1;
+    return true;
+
+  case laload: case daload:
+    *pops = 2;
+    *pushes = 2;
+    return true;
+
+  case lshl: case lshr: case lushr:
+    *pops = 3;
+    *pushes = 2;
+    return true;
+
+  case ladd: case lsub: case lmul: case ldiv_: case lrem: case land:
+  case lor: case lxor:
+  case dadd: case dsub: case dmul: case ddiv: case vm::drem:
+    *pops = 4;
+    *pushes = 2;
+    return true;
+
+  case lcmp: case dcmpl: case dcmpg:
+    *pops = 4;
+    *pushes = 1;
+    return true;
+
+  case getfield:
+    *pops = 1;
+    *pushes = fieldFootprint(t, code, ip);
+    return true;
+
+  case getstatic:
+    *pops = 0;
+    *pushes = fieldFootprint(t, code, ip);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// Starting just after an "aload a; iload i" pair, finds the array
+// access consuming that pair, if it can be found without leaving
+// straight-line code, and returns its ip, or zero otherwise.
+unsigned
+findArrayAccess(MyThread* t, object code, unsigned ip, unsigned limit)
+{
+  // number of words pushed above the pair:
+  unsigned depth = 0;
+
+  while (ip < limit) {
+    unsigned instruction = codeBody(t, code, ip);
+    switch (instruction) {
+    case aaload: case baload: case caload: case daload:
+    case faload: case iaload: case laload: case saload:
+      if (depth == 0) {
+        return ip;
+      }
+      break;
+
+    case aastore: case bastore: case castore: case fastore:
+    case iastore: case sastore:
+      if (depth == 1) {
+        return ip;
+      }
+      break;
+
+    case dastore: case lastore:
+      if (depth == 2) {
+        return ip;
+      }
+      break;
+
+    default: break;
+    }
+
+    unsigned pops;
+    unsigned pushes;
+    if ((not stackEffect(t, code, ip, &pops, &pushes)) or pops > depth) {
+      return 0;
+    }
+
+    depth += pushes - pops;
+    ip += instructionLength(t, code, ip);
+  }
+  return 0;
+}
+
+bool
+branchesInto(MyThread* t, object code, unsigned source, unsigned start,
+             unsigned end)
+{
+  unsigned instruction = codeBody(t, code, source);
+  unsigned index;
+  switch (instruction) {
+  case goto_: case if_acmpeq: case if_acmpne: case if_icmpeq:
+  case if_icmpge: case if_icmpgt: case if_icmple: case if_icmplt:
+  case if_icmpne: case ifeq: case ifge: case ifgt: case ifle: case iflt:
+  case ifne: case ifnonnull: case ifnull: {
+    index = source + 1;
+    unsigned target = source + static_cast<int16_t>
+      (codeReadInt16(t, code, index));
+    return target >= start and target < end;
+  }
+
+  case goto_w: {
+    index = source + 1;
+    unsigned target = source + codeReadInt32(t, code, index);
+    return target >= start and target < end;
+  }
+
+  case tableswitch:
+  case lookupswitch: {
+    index = (source + 4) & ~3;
+    unsigned target = source + codeReadInt32(t, code, index);
+    if (target >= start and target < end) {
       return true;
-    } else if ((MATCH(methodName(t, target), "putInt")
-                and MATCH(methodSpec(t, target), "(JI)V"))
-               or (MATCH(methodName(t, target), "putFloat")
-                   and MATCH(methodSpec(t, target), "(JF)V")))
+    }
+
+    unsigned count;
+    unsigned stride;
+    if (instruction == tableswitch) {
+      int32_t bottom = codeReadInt32(t, code, index);
+      int32_t top = codeReadInt32(t, code, index);
+      count = top - bottom + 1;
+      stride = 4;
+    } else {
+      count = codeReadInt32(t, code, index);
+      stride = 8;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+      unsigned entry = index + (i * stride) + (stride - 4);
+      target = source + codeReadInt32(t, code, entry);
+      if (target >= start and target < end) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  default:
+    return false;
+  }
+}
+
+bool
+isConditionalBranch(unsigned instruction)
+{
+  switch (instruction) {
+  case if_acmpeq: case if_acmpne: case if_icmpeq: case if_icmpge:
+  case if_icmpgt: case if_icmple: case if_icmplt: case if_icmpne:
+  case ifeq: case ifge: case ifgt: case ifle: case iflt: case ifne:
+  case ifnonnull: case ifnull:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// Returns the ip just past the loop starting at top, or zero if the
+// code there is not a loop of the form javac emits:
+//
+//   top: <straight-line test>; if<cond> end
+//   ...
+//   goto top
+//   end:
+//
+// which can only be entered by falling into top from the preceding
+// instruction.  Exception handlers within the loop must only cover
+// code within the loop.
+unsigned
+loopEnd(MyThread* t, object code, unsigned top)
+{
+  unsigned length = codeLength(t, code);
+  unsigned ip = top;
+  unsigned pops;
+  unsigned pushes;
+
+  while (ip < length and stackEffect(t, code, ip, &pops, &pushes)) {
+    ip += instructionLength(t, code, ip);
+  }
+
+  if (ip + 3 > length or not isConditionalBranch(codeBody(t, code, ip))) {
+    return 0;
+  }
+
+  unsigned offset = ip + 1;
+  unsigned end = ip + static_cast<int16_t>(codeReadInt16(t, code, offset));
+
+  if (end < ip + 6 or end > length or codeBody(t, code, end - 3) != goto_) {
+    return 0;
+  }
+
+  offset = end - 2;
+  if (end - 3 + static_cast<int16_t>(codeReadInt16(t, code, offset)) != top) {
+    return 0;
+  }
+
+  for (ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    if ((ip < top or ip >= end) and branchesInto(t, code, ip, top, end)) {
+      return 0;
+    }
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      uint64_t eh = exceptionHandlerTableBody(t, eht, i);
+      if (exceptionHandlerIp(eh) >= top and exceptionHandlerIp(eh) < end
+          and (exceptionHandlerStart(eh) < top
+               or exceptionHandlerEnd(eh) > end))
+      {
+        return 0;
+      }
+    }
+  }
+
+  return end;
+}
+
+// Returns true if the instruction at ip can neither run arbitrary
+// code, e.g. by calling a method or initializing a class, nor
+// synchronize with another thread.  Heap locations which are not
+// written by a loop made only of such instructions may be read once
+// before it instead of on each iteration.
+bool
+isIsolated(MyThread* t, object method, object code, unsigned ip)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  unsigned index = ip + 1;
+
+  switch (instruction) {
+  case getfield:
+  case getstatic:
+  case putfield:
+  case putstatic: {
+    object field = resolveField
+      (t, method, codeReadInt16(t, code, index) - 1, false);
+
+    return field
+      and (fieldFlags(t, field) & ACC_VOLATILE) == 0
+      and ((instruction != getstatic and instruction != putstatic)
+           or not classNeedsInit(t, fieldClass(t, field)));
+  }
+
+  case ldc:
+    return not singletonIsObject
+      (t, codePool(t, code), codeBody(t, code, index) - 1);
+
+  case ldc_w:
+    return not singletonIsObject
+      (t, codePool(t, code), codeReadInt16(t, code, index) - 1);
+
+  case istore: case lstore: case fstore: case dstore: case astore:
+  case istore_0: case istore_1: case istore_2: case istore_3:
+  case lstore_0: case lstore_1: case lstore_2: case lstore_3:
+  case fstore_0: case fstore_1: case fstore_2: case fstore_3:
+  case dstore_0: case dstore_1: case dstore_2: case dstore_3:
+  case astore_0: case astore_1: case astore_2: case astore_3:
+  case iastore: case lastore: case fastore: case dastore: case aastore:
+  case bastore: case castore: case sastore:
+  case pop_: case pop2: case dup: case dup_x1: case dup_x2: case dup2:
+  case dup2_x1: case dup2_x2: case swap:
+  case goto_: case goto_w: case tableswitch: case lookupswitch:
+  case arraylength: case athrow: case nop:
+  case ireturn: case lreturn: case freturn: case dreturn: case areturn:
+  case return_:
+    return true;
+
+  default: {
+    unsigned pops;
+    unsigned pushes;
+    return isConditionalBranch(instruction)
+      or stackEffect(t, code, ip, &pops, &pushes);
+  }
+  }
+}
+
+// Returns the field loaded by the getfield at ip if the instruction
+// before it, at previous, is aload_0, and zero otherwise.
+object
+thisField(MyThread* t, object method, object code, unsigned previous,
+          unsigned ip)
+{
+  if (codeBody(t, code, ip) == getfield
+      and codeBody(t, code, previous) == aload_0)
+  {
+    unsigned index = ip + 1;
+    return resolveField(t, method, codeReadInt16(t, code, index) - 1, false);
+  } else {
+    return 0;
+  }
+}
+
+// Returns a table describing the fields of this which may be loaded
+// once before a loop in method instead of on each iteration, or zero
+// if there are none.  The loops considered are those matched by
+// loopEnd, containing only isolated instructions, in instance methods
+// which never assign local 0.
+//
+// Each replaced getfield ip maps to one plus the local holding its
+// field.  The instruction before each loop maps to one plus the
+// position, past the end of the code, of a count followed by that
+// many (pool index, local) pairs naming the fields to load into
+// locals there.  As with findScalarReplacements, the method's code is
+// replaced with a copy having room for the new locals.
+object
+findLoopInvariants(MyThread* t, object method)
+{
+  // limits on the time spent on a method and the locals added to it:
+  const unsigned MaxLoops = 32;
+  const unsigned MaxInvariants = 8;
+
+  if (methodFlags(t, method) & ACC_STATIC) {
+    return 0;
+  }
+
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+
+  unsigned mapSize = ceiling(length, BitsPerWord);
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, targets, mapSize);
+  memset(RUNTIME_ARRAY_BODY(targets), 0, mapSize * BytesPerWord);
+
+  // targets of backward gotos:
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, tops, mapSize);
+  memset(RUNTIME_ARRAY_BODY(tops), 0, mapSize * BytesPerWord);
+
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    unsigned index;
+    if (size == 0
+        or (isLocalAccess(t, code, ip, astore, astore_0, &index)
+            and index == 0))
     {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (TargetBytesPerWord, value, 4, c->memory
-         (address, MATCH(methodName(t, target), "putInt")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
-      return true;
-    } else if ((MATCH(methodName(t, target), "getLong")
-                and MATCH(methodSpec(t, target), "(J)J"))
-               or (MATCH(methodName(t, target), "getDouble")
-                   and MATCH(methodSpec(t, target), "(J)D")))
+      return 0;
+    }
+
+    markBranchTargets(t, code, ip, RUNTIME_ARRAY_BODY(targets));
+
+    if (codeBody(t, code, ip) == goto_) {
+      unsigned offset = ip + 1;
+      int16_t distance = codeReadInt16(t, code, offset);
+      if (distance < 0) {
+        markBranchTarget(RUNTIME_ARRAY_BODY(tops), length, ip, distance);
+      }
+    }
+
+    ip += size;
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      markBranchTarget
+        (RUNTIME_ARRAY_BODY(targets), length, 0, exceptionHandlerIp
+         (exceptionHandlerTableBody(t, eht, i)));
+    }
+  }
+
+  // for each ip, one plus the index of the invariant assigned to it,
+  // or, for the instruction before a loop, MaxInvariants + 1:
+  THREAD_RUNTIME_ARRAY(t, uint8_t, assignments, length);
+  memset(RUNTIME_ARRAY_BODY(assignments), 0, length);
+
+  unsigned invariantIndexes[MaxInvariants];
+  unsigned invariantLocals[MaxInvariants];
+  unsigned invariantLoops[MaxInvariants];
+  unsigned invariantCount = 0;
+
+  unsigned befores[MaxLoops];
+  unsigned loopCount = 0;
+
+  unsigned maxLocals = codeMaxLocals(t, code);
+  unsigned footprint = 0;
+
+  unsigned previous = 0;
+  for (unsigned ip = 0; ip < length and loopCount < MaxLoops
+         and invariantCount < MaxInvariants;
+       previous = ip, ip += instructionLength(t, code, ip))
+  {
+    if (ip == 0 or not getBit(RUNTIME_ARRAY_BODY(tops), ip)) {
+      continue;
+    }
+
+    unsigned end = loopEnd(t, code, ip);
+    if (end == 0 or RUNTIME_ARRAY_BODY(assignments)[previous]) {
+      continue;
+    }
+
+    // the loads are compiled just before the preceding instruction,
+    // which must fall into the loop; getfield ips are reserved for
+    // the loads' targets:
+    switch (codeBody(t, code, previous)) {
+    case goto_: case goto_w: case tableswitch: case lookupswitch:
+    case athrow: case ireturn: case lreturn: case freturn: case dreturn:
+    case areturn: case return_: case getfield:
+      continue;
+
+    default: break;
+    }
+
+    bool isolated = true;
+    for (unsigned i = ip; i < end; i += instructionLength(t, code, i)) {
+      if (not isIsolated(t, method, code, i)) {
+        isolated = false;
+        break;
+      }
+    }
+
+    if (not isolated) {
+      continue;
+    }
+
+    unsigned firstInvariant = invariantCount;
+    for (unsigned i = ip, last = ip; i < end and invariantCount < MaxInvariants;
+         last = i, i += instructionLength(t, code, i))
     {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushLong
-        (c->load
-         (8, 8, c->memory
-          (address, MATCH(methodName(t, target), "getLong")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
-          8));
-      return true;
-    } else if ((MATCH(methodName(t, target), "putLong")
-                and MATCH(methodSpec(t, target), "(JJ)V"))
-               or (MATCH(methodName(t, target), "putDouble")
-                   and MATCH(methodSpec(t, target), "(JD)V")))
+      // the getfield must not be reachable except from its aload_0:
+      object field = i > ip and not getBit(RUNTIME_ARRAY_BODY(targets), i)
+        ? thisField(t, method, code, last, i) : 0;
+
+      if (field == 0 or RUNTIME_ARRAY_BODY(assignments)[i]) {
+        continue;
+      }
+
+      PROTECT(t, field);
+
+      unsigned invariant = invariantCount;
+      for (unsigned j = firstInvariant; j < invariantCount; ++j) {
+        if (resolveField(t, method, invariantIndexes[j] - 1) == field) {
+          invariant = j;
+          break;
+        }
+      }
+
+      if (invariant == invariantCount) {
+        bool written = false;
+        for (unsigned j = ip; j < end; j += instructionLength(t, code, j)) {
+          unsigned index = j + 1;
+          if (codeBody(t, code, j) == putfield
+              and resolveField
+              (t, method, codeReadInt16(t, code, index) - 1) == field)
+          {
+            written = true;
+            break;
+          }
+        }
+
+        if (written) {
+          continue;
+        }
+
+        unsigned index = i + 1;
+        invariantIndexes[invariantCount] = codeReadInt16(t, code, index);
+        invariantLocals[invariantCount] = maxLocals + footprint;
+        invariantLoops[invariantCount] = loopCount;
+        ++ invariantCount;
+
+        footprint += (fieldCode(t, field) == LongField
+                      or fieldCode(t, field) == DoubleField) ? 2 : 1;
+      }
+
+      RUNTIME_ARRAY_BODY(assignments)[i] = invariant + 1;
+    }
+
+    if (invariantCount > firstInvariant) {
+      RUNTIME_ARRAY_BODY(assignments)[previous] = MaxInvariants + 1;
+      befores[loopCount++] = previous;
+    }
+  }
+
+  unsigned tableLength = length + loopCount + (invariantCount * 2);
+  if (invariantCount == 0 or maxLocals + footprint >= 0xFFFF
+      or tableLength >= 0xFFFF)
+  {
+    return 0;
+  }
+
+  object table = makeShortArray(t, tableLength);
+  PROTECT(t, table);
+
+  for (unsigned ip = 0; ip < length; ++ip) {
+    unsigned invariant = RUNTIME_ARRAY_BODY(assignments)[ip];
+    if (invariant and invariant <= MaxInvariants) {
+      shortArrayBody(t, table, ip) = 1 + invariantLocals[invariant - 1];
+    }
+  }
+
+  unsigned position = length;
+  for (unsigned i = 0; i < loopCount; ++i) {
+    shortArrayBody(t, table, befores[i]) = 1 + position;
+
+    unsigned countPosition = position++;
+    unsigned count = 0;
+    for (unsigned j = 0; j < invariantCount; ++j) {
+      if (invariantLoops[j] == i) {
+        shortArrayBody(t, table, position++) = invariantIndexes[j];
+        shortArrayBody(t, table, position++) = invariantLocals[j];
+        ++ count;
+      }
+    }
+    shortArrayBody(t, table, countPosition) = count;
+  }
+
+  object newCode = makeCode
+    (t, codePool(t, code), codeExceptionHandlerTable(t, code),
+     codeLineNumberTable(t, code), 0, 0, 0, codeMaxStack(t, code),
+     maxLocals + footprint, length);
+
+  memcpy(&codeBody(t, newCode, 0), &codeBody(t, code, 0), length);
+
+  set(t, method, MethodCode, newCode);
+
+  return table;
+}
+
+unsigned
+invariantTableEntry(MyThread* t, object table, unsigned ip)
+{
+  return table ? static_cast<uint16_t>(shortArrayBody(t, table, ip)) : 0;
+}
+
+// If the code at ip is an array reference which cannot change within
+// a loop -- either "aload a" or an "aload_0; getfield" replaced by
+// findLoopInvariants -- stores an identifier for it in *array and
+// returns the ip following it.  Returns zero otherwise.
+unsigned
+arrayReference(MyThread* t, object code, object invariants, unsigned ip,
+               unsigned* array)
+{
+  if (isLocalAccess(t, code, ip, aload, aload_0, array)) {
+    if (codeBody(t, code, ip) == aload_0
+        and codeBody(t, code, ip + 1) == getfield)
     {
-      Compiler::Operand* value = frame->popLong();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (8, value, 8, c->memory
-         (address, MATCH(methodName(t, target), "putLong")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
+      unsigned entry = invariantTableEntry(t, invariants, ip + 1);
+      if (entry) {
+        *array = entry - 1;
+        return ip + 4;
+      } else {
+        return 0;
+      }
+    }
+    return ip + instructionLength(t, code, ip);
+  } else {
+    return 0;
+  }
+}
+
+// Returns whether any ip from start up to but not including end is
+// marked in targets.
+bool
+anyBranchTargets(uintptr_t* targets, unsigned start, unsigned end)
+{
+  for (unsigned ip = start; ip < end; ++ip) {
+    if (getBit(targets, ip)) {
       return true;
-    } else if (MATCH(methodName(t, target), "getAddress")
-                and MATCH(methodSpec(t, target), "(J)J"))
+    }
+  }
+  return false;
+}
+
+// Marks in targets each ip to which control may transfer other than
+// by falling through from the previous instruction.
+void
+markAllBranchTargets(MyThread* t, object code, uintptr_t* targets)
+{
+  unsigned length = codeLength(t, code);
+
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned index = ip + 1;
+    switch (codeBody(t, code, ip)) {
+    case jsr:
+      markBranchTarget
+        (targets, length, ip,
+         static_cast<int16_t>(codeReadInt16(t, code, index)));
+      markBranchTarget(targets, length, ip, 3);
+      break;
+
+    case jsr_w:
+      markBranchTarget(targets, length, ip, codeReadInt32(t, code, index));
+      markBranchTarget(targets, length, ip, 5);
+      break;
+
+    default:
+      markBranchTargets(t, code, ip, targets);
+      break;
+    }
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      markBranchTarget
+        (targets, length, 0, exceptionHandlerIp
+         (exceptionHandlerTableBody(t, eht, i)));
+    }
+  }
+}
+
+// Matches a loop of the form javac emits for
+//
+//   for (int i = c; i < a.length; ++i) { ... }
+//
+// with constant c >= 0, where i is a local not otherwise assigned
+// within the loop and a is either such a local or a field of this
+// which findLoopInvariants loads before the loop:
+//
+//   <c>; istore i
+//   top: iload i; aload a; arraylength; if_icmpge end
+//   ...
+//   iinc i 1; goto top
+//   end:
+//
+// Since i can only grow, one at a time, from a non-negative start and
+// is compared against the length of an array which does not change,
+// any access to a indexed by i in the body is in bounds, provided
+// nothing branches into the middle of the sequence leading to it, as
+// javac's code for (c ? b : a)[i] does.  Such accesses are marked in
+// table.
+void
+markInBoundsLoop(MyThread* t, object code, object invariants,
+                 uintptr_t* targets, unsigned before, unsigned top,
+                 object table)
+{
+  unsigned length = codeLength(t, code);
+  unsigned index;
+  unsigned array;
+  unsigned ip = top;
+
+  if (not isLocalAccess(t, code, ip, iload, iload_0, &index)) {
+    return;
+  }
+  ip += instructionLength(t, code, ip);
+
+  ip = arrayReference(t, code, invariants, ip, &array);
+  if (ip == 0) {
+    return;
+  }
+
+  if (ip + 4 > length
+      or codeBody(t, code, ip) != arraylength
+      or codeBody(t, code, ip + 1) != if_icmpge)
+  {
+    return;
+  }
+
+  unsigned body = ip + 4;
+  unsigned end = loopEnd(t, code, top);
+
+  unsigned initIndex;
+  if (end <= body + 6
+      or (not isLocalAccess(t, code, before, istore, istore_0, &initIndex))
+      or initIndex != index)
+  {
+    return;
+  }
+
+  unsigned increment = 0;
+  for (ip = body; ip < end; ip += instructionLength(t, code, ip)) {
+    unsigned instruction = codeBody(t, code, ip);
+    unsigned local;
+
+    if ((isLocalAccess(t, code, ip, istore, istore_0, &local)
+         and local == index)
+        or (isLocalAccess(t, code, ip, astore, astore_0, &local)
+            and local == array))
     {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushLong
-        (c->load
-         (TargetBytesPerWord, TargetBytesPerWord,
-          c->memory(address, Compiler::AddressType, 0, 0, 1), 8));
-      return true;
-    } else if (MATCH(methodName(t, target), "putAddress")
-               and MATCH(methodSpec(t, target), "(JJ)V"))
+      return;
+    } else if (instruction == iinc and codeBody(t, code, ip + 1) == index) {
+      if (increment or ip != end - 6 or codeBody(t, code, ip + 2) != 1) {
+        return;
+      }
+      increment = ip;
+    }
+  }
+
+  if (increment == 0) {
+    return;
+  }
+
+  // the initialization must not be skipped:
+  for (ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    if (branchesInto(t, code, ip, before, top)) {
+      return;
+    }
+  }
+
+  for (ip = body; ip < increment; ip += instructionLength(t, code, ip)) {
+    unsigned local;
+    unsigned next = arrayReference(t, code, invariants, ip, &local);
+    if (next and local == array) {
+      if (isLocalAccess(t, code, next, iload, iload_0, &local)
+          and local == index)
+      {
+        unsigned access = findArrayAccess
+          (t, code, next + instructionLength(t, code, next), increment);
+
+        if (access and not anyBranchTargets(targets, ip + 1, access + 1)) {
+          byteArrayBody(t, table, access) = 1;
+        }
+      }
+    }
+  }
+}
+
+// Returns a table indexed by ip marking the array accesses which
+// markInBoundsLoop proved to be in bounds, or zero if there are none.
+object
+findInBoundsAccesses(MyThread* t, object method, object invariants)
+{
+  // limit the time spent on methods with many loops, since each
+  // candidate requires a scan of the whole method:
+  const unsigned MaxLoops = 32;
+
+  PROTECT(t, invariants);
+
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return 0;
+    }
+    ip += size;
+  }
+
+  unsigned mapSize = ceiling(length, BitsPerWord);
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, targets, mapSize);
+
+  unsigned loops = 0;
+  unsigned previous = 0;
+  unsigned beforePrevious = 0;
+  object table = 0;
+  PROTECT(t, table);
+
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    unsigned index;
+    if (ip > previous
+        and previous > beforePrevious
+        and isLocalAccess(t, code, previous, istore, istore_0, &index)
+        and isNonNegativeConstant(t, code, beforePrevious)
+        and loops++ < MaxLoops)
     {
-      Compiler::Operand* value = frame->popLong();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (8, value, TargetBytesPerWord, c->memory
-         (address, Compiler::AddressType, 0, 0, 1));
-      return true;
+      if (table == 0) {
+        table = makeByteArray(t, length);
+
+        memset(RUNTIME_ARRAY_BODY(targets), 0, mapSize * BytesPerWord);
+        markAllBranchTargets(t, code, RUNTIME_ARRAY_BODY(targets));
+      }
+
+      markInBoundsLoop(t, code, invariants, RUNTIME_ARRAY_BODY(targets),
+                       previous, ip, table);
     }
+
+    beforePrevious = previous;
+    previous = ip;
+    ip += size;
   }
-  return false;
+
+  if (table) {
+    for (unsigned i = 0; i < length; ++i) {
+      if (byteArrayBody(t, table, i)) {
+        return table;
+      }
+    }
+  }
+
+  return 0;
 }
 
-unsigned
-targetFieldOffset(Context* context, object field)
+// Returns a table indexed by ip marking the putfield, putstatic and
+// aastore instructions which can only store the null pushed by the
+// aconst_null just before them, or zero if there are none.  Such
+// stores need no write barrier.
+object
+findNullStores(MyThread* t, object method)
 {
-  if (context->bootContext) {
-    return context->bootContext->resolver->fieldOffset(context->thread, field);
-  } else {
-    return fieldOffset(context->thread, field);
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+
+  unsigned mapSize = ceiling(length, BitsPerWord);
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, targets, mapSize);
+  memset(RUNTIME_ARRAY_BODY(targets), 0, mapSize * BytesPerWord);
+
+  bool found = false;
+  unsigned previous = 0;
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return 0;
+    }
+
+    switch (codeBody(t, code, ip)) {
+    case jsr: {
+      unsigned index = ip + 1;
+      markBranchTarget
+        (RUNTIME_ARRAY_BODY(targets), length, ip,
+         static_cast<int16_t>(codeReadInt16(t, code, index)));
+    } break;
+
+    case jsr_w: {
+      unsigned index = ip + 1;
+      markBranchTarget
+        (RUNTIME_ARRAY_BODY(targets), length, ip,
+         codeReadInt32(t, code, index));
+    } break;
+
+    case aastore:
+    case putfield:
+    case putstatic:
+      if (ip > 0 and codeBody(t, code, previous) == aconst_null) {
+        found = true;
+      }
+      break;
+
+    default:
+      markBranchTargets(t, code, ip, RUNTIME_ARRAY_BODY(targets));
+      break;
+    }
+
+    previous = ip;
+    ip += size;
+  }
+
+  if (not found) {
+    return 0;
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      markBranchTarget
+        (RUNTIME_ARRAY_BODY(targets), length, 0, exceptionHandlerIp
+         (exceptionHandlerTableBody(t, eht, i)));
+    }
+  }
+
+  // control must reach the store only from the aconst_null, or the
+  // stored value may be something else:
+  object table = 0;
+  previous = 0;
+  for (unsigned ip = 0; ip < length;) {
+    switch (codeBody(t, code, ip)) {
+    case aastore:
+    case putfield:
+    case putstatic:
+      if (ip > 0
+          and codeBody(t, code, previous) == aconst_null
+          and not getBit(RUNTIME_ARRAY_BODY(targets), ip))
+      {
+        if (table == 0) {
+          table = makeByteArray(t, length);
+        }
+
+        byteArrayBody(t, table, ip) = 1;
+      }
+      break;
+
+    default: break;
+    }
+
+    previous = ip;
+    ip += instructionLength(t, code, ip);
+  }
+
+  return table;
+}
+
+// Returns a byte array with a nonzero entry for each ip which is the
+// target of a backward branch, where compiled code polls for a
+// pending safepoint so that a thread spinning in a loop doesn't hold
+// up threads waiting for the exclusive state, or null if there are
+// no such ips.
+object
+findLoopHeads(MyThread* t, object method)
+{
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned length = codeLength(t, code);
+
+  object table = 0;
+  for (unsigned ip = 0; ip < length;) {
+    unsigned index = ip + 1;
+    int32_t offset = 1;
+    unsigned size = instructionLength(t, code, ip);
+
+    switch (codeBody(t, code, ip)) {
+    case goto_:
+    case if_acmpeq:
+    case if_acmpne:
+    case if_icmpeq:
+    case if_icmpge:
+    case if_icmpgt:
+    case if_icmple:
+    case if_icmplt:
+    case if_icmpne:
+    case ifeq:
+    case ifge:
+    case ifgt:
+    case ifle:
+    case iflt:
+    case ifne:
+    case ifnonnull:
+    case ifnull:
+      offset = static_cast<int16_t>(codeReadInt16(t, code, index));
+      break;
+
+    case goto_w:
+      offset = codeReadInt32(t, code, index);
+      break;
+
+    case jsr:
+      size = 3;
+      break;
+
+    case jsr_w:
+      size = 5;
+      break;
+
+    case ret:
+      size = 2;
+      break;
+
+    case wide:
+      size = codeBody(t, code, ip + 1) == iinc ? 6 : 4;
+      break;
+
+    default: break;
+    }
+
+    // an offset of zero is a loop of its own, e.g. "for (;;) { }"
+    if (offset <= 0 and static_cast<int32_t>(ip) + offset >= 0) {
+      if (table == 0) {
+        table = makeByteArray(t, length);
+      }
+
+      byteArrayBody(t, table, ip + offset) = 1;
+    }
+
+    ip += size;
+  }
+
+  return table;
+}
+
+// Compiles the loads of the fields which findLoopInvariants moved
+// out of the loop following the instruction at ip, if any.
+void
+loadInvariants(MyThread* t, Frame* frame, unsigned ip)
+{
+  object table = frame->context->invariantTable;
+  unsigned position = invariantTableEntry(t, table, ip);
+
+  if (position
+      and codeBody(t, methodCode(t, frame->context->method), ip) != getfield)
+  {
+    unsigned count = shortArrayBody(t, table, position - 1);
+    for (unsigned i = 0; i < count; ++i) {
+      unsigned index = shortArrayBody(t, table, position + (i * 2));
+      unsigned local = shortArrayBody(t, table, position + (i * 2) + 1);
+      object field = resolveField(t, frame->context->method, index - 1);
+
+      frame->loadObject(0);
+      loadField(t, frame, frame->popObject(), field);
+
+      switch (fieldCode(t, field)) {
+      case DoubleField:
+      case LongField:
+        frame->storeLong(local);
+        break;
+
+      case ObjectField:
+        frame->storeObject(local);
+        break;
+
+      default:
+        frame->storeInt(local);
+        break;
+      }
+    }
   }
 }
 
+bool
+inBounds(MyThread* t, Context* context, unsigned ip)
+{
+  return context->boundsTable
+    and byteArrayBody(t, context->boundsTable, ip);
+}
+
 class Stack {
  public:
   class MyResource: public Thread::Resource {
@@ -4051,7 +7236,7 @@ class Stack {
 
   Stack(MyThread* t):
     thread(t),
-    zone(t->m->system, t->m->heap, 0),
+    zone(t->m->system, &(t->m->zonePool), 0),
     resource(this)
   { }
 
@@ -4098,7 +7283,8 @@ class SwitchState {
               Compiler::Operand* key,
               Promise* start,
               int bottom,
-              int top):
+              int top,
+              unsigned keys):
     state(state),
     count(count),
     defaultIp(defaultIp),
@@ -4106,6 +7292,7 @@ class SwitchState {
     start(start),
     bottom(bottom),
     top(top),
+    keys(keys),
     index(0)
   { }
 
@@ -4126,9 +7313,83 @@ class SwitchState {
   Promise* start;
   int bottom;
   int top;
+  unsigned keys;
   unsigned index;
 };
 
+// Appends the machine addresses of the count ips in ipTable to the
+// constant pool, returning a promise for the address of the first.
+Promise*
+appendJumpTable(Frame* frame, uint32_t* ipTable, unsigned count)
+{
+  Compiler* c = frame->c;
+  Promise* start = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    Promise* p = c->poolAppendPromise
+      (frame->addressPromise(c->machineIp(ipTable[i])));
+    if (i == 0) {
+      start = p;
+    }
+  }
+  return start;
+}
+
+// Returns the number of bits in the index of a table into which the
+// count keys of the lookupswitch with pairs starting at index in code
+// may be hashed without collisions as (key * multiplier) >>> (32 -
+// bits), setting *multiplier accordingly, or zero if no multiplier is
+// found within a few attempts.
+unsigned
+findSwitchHash(MyThread* t, object code, unsigned index, unsigned count,
+               uint32_t* multiplier)
+{
+  // limits on the size of the table and the multipliers tried for
+  // each size:
+  const unsigned MaxBits = 12;
+  const unsigned MaxAttempts = 32;
+
+  // keep the table at most half full:
+  unsigned bits = 1;
+  while ((1U << bits) < count * 2) {
+    ++ bits;
+  }
+
+  if (bits > MaxBits) {
+    return 0;
+  }
+
+  unsigned mapSize = ceiling(1 << (bits + 1), BitsPerWord);
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, used, mapSize);
+
+  for (unsigned b = bits; b <= bits + 1 and b <= MaxBits; ++b) {
+    uint32_t m = 0x9E3779B1;
+    for (unsigned attempt = 0; attempt < MaxAttempts; ++attempt) {
+      memset(RUNTIME_ARRAY_BODY(used), 0, mapSize * BytesPerWord);
+
+      bool collision = false;
+      for (unsigned i = 0; i < count; ++i) {
+        unsigned p = index + (i * 8);
+        uint32_t slot = (static_cast<uint32_t>(codeReadInt32(t, code, p)) * m)
+          >> (32 - b);
+        if (getBit(RUNTIME_ARRAY_BODY(used), slot)) {
+          collision = true;
+          break;
+        }
+        markBit(RUNTIME_ARRAY_BODY(used), slot);
+      }
+
+      if (not collision) {
+        *multiplier = m;
+        return b;
+      }
+
+      m = ((m * 1664525) + 1013904223) | 1;
+    }
+  }
+
+  return 0;
+}
+
 void
 compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         int exceptionHandlerStart = -1)
@@ -4139,7 +7400,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
     Unsubroutine,
     Untable0,
     Untable1,
-    Unswitch
+    Unswitch,
+    Uncompare
   };
 
   Frame* frame = initialFrame;
@@ -4183,6 +7445,18 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
          Compiler::VoidType,
          1, c->register_(t->arch->thread()));
     }
+
+    if (context->safepointTable
+        and byteArrayBody(t, context->safepointTable, ip))
+    {
+      c->poll(TARGET_THREAD_SAFEPOINTREQUESTED,
+              c->constant(getThunk(t, safepointThunk), Compiler::AddressType),
+              frame->trace(0, 0));
+    }
+
+    if (context->invariantTable) {
+      loadInvariants(t, frame, ip);
+    }
     
 //     fprintf(stderr, "ip: %d map: %ld\n", ip, *(frame->map));
 
@@ -4206,7 +7480,11 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       }
 
       if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+        if (inBounds(t, context, ip - 1)) {
+          ++ context->statistics.uncheckedAccesses;
+        } else {
+          c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+        }
       }
 
       switch (instruction) {
@@ -4301,24 +7579,37 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       }
 
       if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+        if (inBounds(t, context, ip - 1)) {
+          ++ context->statistics.uncheckedAccesses;
+        } else {
+          c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+        }
       }
 
       switch (instruction) {
       case aastore: {
-        c->call
-          (c->constant(getThunk(t, setMaybeNullThunk), Compiler::AddressType),
-           0,
-           frame->trace(0, 0),
-           0,
-           Compiler::VoidType,
-           4, c->register_(t->arch->thread()), array,
-           c->add
-           (4, c->constant(TargetArrayBody, Compiler::IntegerType),
-            c->shl
-            (4, c->constant(log(TargetBytesPerWord), Compiler::IntegerType),
-             index)),
-           value);
+        if (storesNull(t, context, ip - 1)) {
+          c->store
+            (TargetBytesPerWord, value, TargetBytesPerWord, c->memory
+             (array, Compiler::ObjectType, TargetArrayBody, index,
+              TargetBytesPerWord));
+
+          ++ context->statistics.nullStores;
+        } else {
+          c->call
+            (c->constant(getThunk(t, setMaybeNullThunk), Compiler::AddressType),
+             0,
+             frame->trace(0, 0),
+             0,
+             Compiler::VoidType,
+             4, c->register_(t->arch->thread()), array,
+             c->add
+             (4, c->constant(TargetArrayBody, Compiler::IntegerType),
+              c->shl
+              (4, c->constant(log(TargetBytesPerWord), Compiler::IntegerType),
+               index)),
+             value);
+        }
       } break;
 
       case fastore:
@@ -4718,7 +8009,25 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
     case getfield:
     case getstatic: {
+      unsigned scalar = scalarTableEntry(t, context, ip - 1);
       uint16_t index = codeReadInt16(t, code, ip);
+
+      if (scalar) {
+        loadScalar
+          (t, frame, resolveField(t, context->method, index - 1), scalar - 1);
+        break;
+      }
+
+      unsigned invariant = invariantTableEntry
+        (t, context->invariantTable, ip - 1);
+
+      if (invariant) {
+        loadScalar
+          (t, frame, resolveField(t, context->method, index - 1),
+           invariant - 1);
+        ++ context->statistics.hoistedLoads;
+        break;
+      }
         
       object reference = singletonObject
         (t, codePool(t, methodCode(t, context->method)), index - 1);
@@ -4754,10 +8063,12 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           if (fieldClass(t, field) != methodClass(t, context->method)
               and classNeedsInit(t, fieldClass(t, field)))
           {
+            // the call is aligned so that tryInitClass can patch it
+            // once the class is initialized; see skipInitCheck
             c->call
               (c->constant
                (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
+               context->bootContext ? 0 : Compiler::Aligned,
                frame->trace(0, 0),
                0,
                Compiler::VoidType,
@@ -4777,76 +8088,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           }
         }
 
-        switch (fieldCode(t, field)) {
-        case ByteField:
-        case BooleanField:
-          frame->pushInt
-            (c->load
-             (1, 1, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case CharField:
-          frame->pushInt
-            (c->loadz
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case ShortField:
-          frame->pushInt
-            (c->load
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case FloatField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case IntField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case DoubleField:
-          frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
-
-        case LongField:
-          frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
-
-        case ObjectField:
-          frame->pushObject
-            (c->load
-             (TargetBytesPerWord, TargetBytesPerWord,
-              c->memory
-              (table, Compiler::ObjectType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        default:
-          abort(t);
-        }
+        loadField(t, frame, table, field);
 
         if (fieldFlags(t, field) & ACC_VOLATILE) {
           if (TargetBytesPerWord == 4
@@ -5203,8 +8445,18 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       if (LIKELY(target)) {
         checkMethod(t, target, false);
 
-        argument = target;
-        thunk = findInterfaceMethodFromInstanceThunk;
+        if (context->bootContext == 0) {
+          // the boot heap image is read-only, so we only use an inline
+          // cache for code compiled at runtime:
+          PROTECT(t, target);
+
+          argument = makeArray(t, 1 + (InlineCacheSize * 2));
+          set(t, argument, ArrayBody, target);
+          thunk = findInterfaceMethodFromInstanceAndCacheThunk;
+        } else {
+          argument = target;
+          thunk = findInterfaceMethodFromInstanceThunk;
+        }
         parameterFootprint = methodParameterFootprint(t, target);
         returnCode = methodReturnCode(t, target);
         tailCall = isTailCall(t, code, ip, context->method, target);
@@ -5243,10 +8495,18 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
     } break;
 
     case invokespecial: {
-      context->leaf = false;
-
+      unsigned scalar = scalarTableEntry(t, context, ip - 1);
       uint16_t index = codeReadInt16(t, code, ip);
 
+      if (scalar) {
+        storeScalars
+          (t, frame, resolveMethod(t, context->method, index - 1),
+           scalar - 1);
+        break;
+      }
+
+      context->leaf = false;
+
       object reference = singletonObject
         (t, codePool(t, methodCode(t, context->method)), index - 1);
 
@@ -5290,9 +8550,15 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       object target = resolveMethod(t, context->method, index - 1, false);
 
       if (LIKELY(target)) {
+        PROTECT(t, target);
+
         checkMethod(t, target, true);
 
-        if (not intrinsic(t, frame, target)) {
+        if (intrinsic(t, frame, target)) {
+          ++ context->statistics.intrinsics;
+        } else if (compileCriticalNativeInvoke(t, frame, target)) {
+          ++ context->statistics.criticalNatives;
+        } else {
           bool tailCall = isTailCall(t, code, ip, context->method, target);
           compileDirectInvoke(t, frame, target, tailCall);
         }
@@ -5318,10 +8584,21 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       if (LIKELY(target)) {
         checkMethod(t, target, false);
          
-        if (not intrinsic(t, frame, target)) {
+        if (intrinsic(t, frame, target)) {
+          ++ context->statistics.intrinsics;
+        } else if (not (methodStaticallyBound(t, target)
+                        and inlineAccessor(t, frame, target)))
+        {
           bool tailCall = isTailCall(t, code, ip, context->method, target);
 
-          if (LIKELY(methodVirtual(t, target))) {
+          // the guarded call cannot be made as a tail jump, so leave
+          // tail calls to the vtable:
+          if (methodVirtual(t, target)
+              and not (TailCalls and tailCall)
+              and speculativelyBound(t, context, target))
+          {
+            compileSpeculativeInvoke(t, frame, target);
+          } else if (LIKELY(methodVirtual(t, target))) {
             unsigned parameterFootprint = methodParameterFootprint(t, target);
 
             unsigned offset = TargetClassVtable
@@ -5667,6 +8944,148 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       int32_t pairCount = codeReadInt32(t, code, ip);
 
       if (pairCount) {
+        // the keys are sorted, so these are the smallest and largest:
+        unsigned first = ip;
+        int32_t bottom = codeReadInt32(t, code, first);
+        unsigned last = ip + ((pairCount - 1) * 8);
+        int32_t top = codeReadInt32(t, code, last);
+
+        uint32_t multiplier = 0;
+        unsigned bits = 0;
+
+        if (InlineLookupSwitches
+            and static_cast<unsigned>(pairCount) <= MaxSwitchComparisons)
+        {
+          uint32_t* ipTable = static_cast<uint32_t*>
+            (stack.push(sizeof(uint32_t) * pairCount));
+          for (int32_t i = 0; i < pairCount; ++i) {
+            unsigned index = ip + (i * 8) + 4;
+            ipTable[i] = base + codeReadInt32(t, code, index);
+            assert(t, ipTable[i] < codeLength(t, code));
+          }
+
+          // compare the key with each in turn, compiling the code for
+          // each case before the next comparison (see Uncompare):
+          c->jumpIfEqual(4, c->constant(bottom, Compiler::IntegerType), key,
+                         frame->machineIp(ipTable[0]));
+
+          c->save(1, key);
+
+          new (stack.push(sizeof(SwitchState))) SwitchState
+            (c->saveState(), pairCount, defaultIp, key, 0, 0, 0, ip);
+
+          stack.pushValue(Uncompare);
+          ip = ipTable[0];
+          goto start;
+        } else if (InlineLookupSwitches
+                   and static_cast<int64_t>(top) - bottom
+                   < static_cast<int64_t>(pairCount)
+                   * MaxSwitchTableSparseness)
+        {
+          // compile as a tableswitch with the missing keys leading to
+          // the default case:
+          unsigned count = top - bottom + 1;
+          uint32_t* ipTable = static_cast<uint32_t*>
+            (stack.push(sizeof(uint32_t) * count));
+          for (unsigned i = 0; i < count; ++i) {
+            ipTable[i] = defaultIp;
+          }
+
+          for (int32_t i = 0; i < pairCount; ++i) {
+            unsigned index = ip + (i * 8);
+            int32_t key = codeReadInt32(t, code, index);
+            uint32_t newIp = base + codeReadInt32(t, code, index);
+            assert(t, newIp < codeLength(t, code));
+
+            ipTable[key - bottom] = newIp;
+          }
+
+          Promise* start = appendJumpTable(frame, ipTable, count);
+
+          c->jumpIfLess(4, c->constant(bottom, Compiler::IntegerType), key,
+                        frame->machineIp(defaultIp));
+
+          c->save(1, key);
+
+          new (stack.push(sizeof(SwitchState))) SwitchState
+            (c->saveState(), count, defaultIp, key, start, bottom, top, 0);
+
+          stack.pushValue(Untable0);
+          ip = defaultIp;
+          goto start;
+        } else if (InlineLookupSwitches
+                   and (bits = findSwitchHash
+                        (t, code, ip, pairCount, &multiplier)))
+        {
+          // compile as a lookup in a table of keys indexed by their
+          // hashes followed by a table of the corresponding addresses.
+          // Each empty slot holds a key which hashes elsewhere and the
+          // default address.
+          unsigned size = 1 << bits;
+          THREAD_RUNTIME_ARRAY(t, int32_t, slots, size);
+          for (unsigned i = 0; i < size; ++i) {
+            RUNTIME_ARRAY_BODY(slots)[i] = -1;
+          }
+
+          uint32_t* ipTable = static_cast<uint32_t*>
+            (stack.push(sizeof(uint32_t) * pairCount));
+          for (int32_t i = 0; i < pairCount; ++i) {
+            unsigned index = ip + (i * 8);
+            int32_t key = codeReadInt32(t, code, index);
+            ipTable[i] = base + codeReadInt32(t, code, index);
+            assert(t, ipTable[i] < codeLength(t, code));
+
+            RUNTIME_ARRAY_BODY(slots)
+              [(static_cast<uint32_t>(key) * multiplier) >> (32 - bits)] = i;
+          }
+
+          Promise* keyStart = 0;
+          for (unsigned i = 0; i < size; ++i) {
+            int32_t pair = RUNTIME_ARRAY_BODY(slots)[i];
+            unsigned index = ip + ((pair < 0 ? 0 : pair) * 8);
+            Promise* p = c->poolAppend(codeReadInt32(t, code, index));
+            if (i == 0) {
+              keyStart = p;
+            }
+          }
+
+          Promise* addressStart = 0;
+          for (unsigned i = 0; i < size; ++i) {
+            int32_t pair = RUNTIME_ARRAY_BODY(slots)[i];
+            Promise* p = c->poolAppendPromise
+              (frame->addressPromise
+               (c->machineIp(pair < 0 ? defaultIp : ipTable[pair])));
+            if (i == 0) {
+              addressStart = p;
+            }
+          }
+
+          Compiler::Operand* slot = c->ushr
+            (4, c->constant(32 - bits, Compiler::IntegerType),
+             c->mul(4, c->constant(static_cast<int32_t>(multiplier),
+                                  Compiler::IntegerType), key));
+
+          c->jumpIfNotEqual
+            (TargetBytesPerWord, c->load
+             (TargetBytesPerWord, TargetBytesPerWord, c->memory
+              (frame->absoluteAddressOperand(keyStart),
+               Compiler::IntegerType, 0, slot, TargetBytesPerWord),
+              TargetBytesPerWord),
+             c->load(4, 4, key, TargetBytesPerWord),
+             frame->machineIp(defaultIp));
+
+          c->save(1, slot);
+
+          // Untable1 jumps to the address in the slot:
+          new (stack.push(sizeof(SwitchState))) SwitchState
+            (c->saveState(), pairCount, defaultIp, slot, addressStart, 0, 0,
+             0);
+
+          stack.pushValue(Untable1);
+          ip = defaultIp;
+          goto start;
+        }
+
         Compiler::Operand* default_ = frame->addressOperand
           (frame->addressPromise(c->machineIp(defaultIp)));
 
@@ -5704,7 +9123,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
            : address);
 
         new (stack.push(sizeof(SwitchState))) SwitchState
-          (c->saveState(), pairCount, defaultIp, 0, 0, 0, 0);
+          (c->saveState(), pairCount, defaultIp, 0, 0, 0, 0, 0);
 
         goto switchloop;
       } else {
@@ -5853,7 +9272,16 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
     } break;
 
     case new_: {
+      unsigned scalar = scalarTableEntry(t, context, ip - 1);
       uint16_t index = codeReadInt16(t, code, ip);
+
+      if (scalar) {
+        // the instance is replaced by the variables initialized at
+        // its constructor call; see findScalarReplacements
+        frame->pushObject(c->constant(0, Compiler::ObjectType));
+        ++ context->statistics.scalarAllocations;
+        break;
+      }
         
       object reference = singletonObject
         (t, codePool(t, methodCode(t, context->method)), index - 1);
@@ -5936,10 +9364,12 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           {
             PROTECT(t, field);
 
+            // the call is aligned so that tryInitClass can patch it
+            // once the class is initialized; see skipInitCheck
             c->call
               (c->constant
                (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
+               context->bootContext ? 0 : Compiler::Aligned,
                frame->trace(0, 0),
                0,
                Compiler::VoidType,
@@ -5986,77 +9416,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           table = frame->popObject();
         }
 
-        switch (fieldCode) {
-        case ByteField:
-        case BooleanField:
-          c->store
-            (TargetBytesPerWord, value, 1, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
-        case CharField:
-        case ShortField:
-          c->store
-            (TargetBytesPerWord, value, 2, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-            
-        case FloatField:
-          c->store
-            (TargetBytesPerWord, value, 4, c->memory
-             (table, Compiler::FloatType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
-        case IntField:
-          c->store
-            (TargetBytesPerWord, value, 4, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
-        case DoubleField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::FloatType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
-        case LongField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
-        case ObjectField:
-          if (instruction == putfield) {
-            c->call
-              (c->constant
-               (getThunk(t, setMaybeNullThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               4, c->register_(t->arch->thread()), table,
-               c->constant(targetFieldOffset(context, field),
-                           Compiler::IntegerType),
-               value);
-          } else {
-            c->call
-              (c->constant(getThunk(t, setThunk), Compiler::AddressType),
-               0, 0, 0, Compiler::VoidType,
-               4, c->register_(t->arch->thread()), table,
-               c->constant(targetFieldOffset(context, field),
-                           Compiler::IntegerType),
-               value);
-          }
-          break;
-
-        default: abort(t);
-        }
+        storeField(t, frame, table, field, value,
+                   instruction == putstatic);
 
         if (fieldFlags(t, field) & ACC_VOLATILE) {
           if (TargetBytesPerWord == 4
@@ -6196,7 +9557,6 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       int32_t bottom = codeReadInt32(t, code, ip);
       int32_t top = codeReadInt32(t, code, ip);
         
-      Promise* start = 0;
       unsigned count = top - bottom + 1;
       uint32_t* ipTable = static_cast<uint32_t*>
         (stack.push(sizeof(uint32_t) * count));
@@ -6206,13 +9566,9 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         assert(t, newIp < codeLength(t, code));
 
         ipTable[i] = newIp;
-
-        Promise* p = c->poolAppendPromise
-          (frame->addressPromise(c->machineIp(newIp)));
-        if (i == 0) {
-          start = p;
-        }
       }
+
+      Promise* start = appendJumpTable(frame, ipTable, count);
       assert(t, start);
 
       Compiler::Operand* key = frame->popInt();
@@ -6223,7 +9579,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       c->save(1, key);
 
       new (stack.push(sizeof(SwitchState))) SwitchState
-        (c->saveState(), count, defaultIp, key, start, bottom, top);
+        (c->saveState(), count, defaultIp, key, start, bottom, top, 0);
 
       stack.pushValue(Untable0);
       ip = defaultIp;
@@ -6352,6 +9708,37 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       (static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)))->state);
   } goto switchloop;
 
+  case Uncompare: {
+    SwitchState* s = static_cast<SwitchState*>
+      (stack.peek(sizeof(SwitchState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+
+    if (++ s->index < s->count) {
+      unsigned index = s->keys + (s->index * 8);
+      int32_t key = codeReadInt32(t, methodCode(t, context->method), index);
+
+      c->jumpIfEqual(4, c->constant(key, Compiler::IntegerType), s->key,
+                     frame->machineIp(s->ipTable()[s->index]));
+
+      c->save(1, s->key);
+      s->state = c->saveState();
+      ip = s->ipTable()[s->index];
+      stack.pushValue(Uncompare);
+      goto start;
+    } else {
+      // no key matched, so continue with the default case:
+      ip = s->defaultIp;
+      unsigned count = s->count * 4;
+      stack.pop(sizeof(SwitchState));
+      stack.pop(count);
+      frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+      goto loop;
+    }
+  }
+
   case Unsubroutine: {
     ip = stack.popValue();
     unsigned start = stack.popValue();
@@ -6391,6 +9778,10 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
 FILE* compileLog = 0;
 
+FILE* perfMap = 0;
+
+FILE* statisticsLog = 0;
+
 void
 logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
            const char* name, const char* spec);
@@ -7238,14 +10629,6 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
     trap();
   }
 
-  // todo: this is a CPU-intensive operation, so consider doing it
-  // earlier before we've acquired the global class lock to improve
-  // parallelism (the downside being that it may end up being a waste
-  // of cycles if another thread compiles the same method in parallel,
-  // which might be mitigated by fine-grained, per-method locking):
-  c->compile(context->leaf ? 0 : stackOverflowThunk(t),
-             TARGET_THREAD_STACKLIMIT);
-
   // we must acquire the class lock here at the latest
  
   unsigned codeSize = c->resolve
@@ -7307,7 +10690,7 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
     object code = methodCode(t, context->method);
 
     code = makeCode
-      (t, 0, newExceptionHandlerTable, newLineNumberTable,
+      (t, 0, newExceptionHandlerTable, newLineNumberTable, 0,
        reinterpret_cast<uintptr_t>(start), codeSize, codeMaxStack(t, code),
        codeMaxLocals(t, code), 0);
 
@@ -7344,9 +10727,15 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
         RUNTIME_ARRAY_BODY(elements)[index++] = p;
 
         if (p->target) {
-          insertCallNode
-            (t, makeCallNode
-             (t, p->address->value(), p->target, p->flags, 0));
+          object node = makeCallNode
+            (t, p->address->value(), p->target, p->flags, 0);
+          PROTECT(t, node);
+
+          insertCallNode(t, node);
+
+          if (p->flags & TraceElement::SpeculativeCall) {
+            recordSpeculativeCall(t, node);
+          }
         }
       }
     }
@@ -7591,20 +10980,90 @@ compileVirtualMethod(MyThread* t)
   object class_ = objectClass(t, static_cast<object>(t->virtualCallTarget));
   t->virtualCallTarget = 0;
 
-  unsigned index = t->virtualCallIndex;
-  t->virtualCallIndex = 0;
+  unsigned index = t->virtualCallIndex;
+  t->virtualCallIndex = 0;
+
+  return reinterpret_cast<uintptr_t>(compileVirtualMethod2(t, class_, index));
+}
+
+uint64_t
+invokeNativeFast(MyThread* t, object method, void* function)
+{
+  FastNativeFunction f; memcpy(&f, &function, sizeof(void*));
+  return f(t, method,
+           static_cast<uintptr_t*>(t->stack)
+           + t->arch->frameFooterSize()
+           + t->arch->frameReturnAddressSize());
+}
+
+uint64_t
+invokeNativeCritical(MyThread* t, object method, void* function)
+{
+  unsigned footprint = methodParameterFootprint(t, method);
+  unsigned count = methodParameterCount(t, method);
+
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, args, footprint);
+  unsigned argOffset = 0;
+  THREAD_RUNTIME_ARRAY(t, uint8_t, types, count);
+  unsigned typeOffset = 0;
+
+  uintptr_t* sp = static_cast<uintptr_t*>(t->stack)
+    + t->arch->frameFooterSize()
+    + t->arch->frameReturnAddressSize();
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+  
+  while (it.hasNext()) {
+    unsigned type = RUNTIME_ARRAY_BODY(types)[typeOffset++]
+      = fieldType(t, fieldCode(t, *it.next()));
+
+    if (type == INT64_TYPE or type == DOUBLE_TYPE) {
+      memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
+      argOffset += (8 / BytesPerWord);
+      sp += 2;
+    } else {
+      RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
+    }
+  }
+
+  unsigned returnCode = methodReturnCode(t, method);
+
+  // critical natives neither see the heap nor call back into the VM,
+  // so there is no need to leave the active state for the call
+  uint64_t result = t->m->system->call
+    (function,
+     RUNTIME_ARRAY_BODY(args),
+     RUNTIME_ARRAY_BODY(types),
+     count,
+     footprint * BytesPerWord,
+     fieldType(t, returnCode));
+
+  switch (returnCode) {
+  case ByteField:
+  case BooleanField:
+    return static_cast<int8_t>(result);
+
+  case CharField:
+    return static_cast<uint16_t>(result);
+
+  case ShortField:
+    return static_cast<int16_t>(result);
+
+  case FloatField:
+  case IntField:
+    return static_cast<int32_t>(result);
+
+  case LongField:
+  case DoubleField:
+    return result;
 
-  return reinterpret_cast<uintptr_t>(compileVirtualMethod2(t, class_, index));
-}
+  case VoidField:
+    return 0;
 
-uint64_t
-invokeNativeFast(MyThread* t, object method, void* function)
-{
-  FastNativeFunction f; memcpy(&f, &function, sizeof(void*));
-  return f(t, method,
-           static_cast<uintptr_t*>(t->stack)
-           + t->arch->frameFooterSize()
-           + t->arch->frameReturnAddressSize());
+  default: abort(t);
+  }
 }
 
 uint64_t
@@ -7698,7 +11157,7 @@ invokeNativeSlow(MyThread* t, object method, void* function)
     }
   }
 
-  Reference* reference = t->reference;
+  MyThread::LocalReferenceMark enclosing = t->markLocalReferences();
 
   { ENTER(t, Thread::IdleState);
 
@@ -7730,6 +11189,8 @@ invokeNativeSlow(MyThread* t, object method, void* function)
   }
 
   if (UNLIKELY(t->exception)) {
+    t->releaseLocalReferences(enclosing);
+
     object exception = t->exception;
     t->exception = 0;
     vm::throw_(t, exception);
@@ -7770,9 +11231,7 @@ invokeNativeSlow(MyThread* t, object method, void* function)
   default: abort(t);
   }
 
-  while (t->reference != reference) {
-    dispose(t, t->reference);
-  }
+  t->releaseLocalReferences(enclosing);
 
   return result;
 }
@@ -7783,6 +11242,8 @@ invokeNative2(MyThread* t, object method)
   object native = methodRuntimeDataNative(t, getMethodRuntimeData(t, method));
   if (nativeFast(t, native)) {
     return invokeNativeFast(t, method, nativeFunction(t, native));
+  } else if (nativeCritical(t, native)) {
+    return invokeNativeCritical(t, method, nativeFunction(t, native));
   } else {
     return invokeNativeSlow(t, method, nativeFunction(t, native));
   }
@@ -8558,6 +12019,236 @@ class ArgumentList {
   } protector;
 };
 
+// Class initializers run exactly once, so compiling them is often a
+// waste of time, especially for the long straight-line initializers
+// javac generates for constant tables.  This evaluates initializers
+// consisting only of constant pushes, primitive array construction
+// and stores to the class's own static fields.  Such code has no
+// effects visible outside the class being initialized, so we may
+// abandon evaluation at any point and fall back to compiling and
+// running the initializer from the start.
+bool
+interpretInitializer(MyThread* t, object method)
+{
+  PROTECT(t, method);
+
+  ensureCode(t, method);
+
+  object code = methodCode(t, method);
+  PROTECT(t, code);
+
+  unsigned stackSize = codeMaxStack(t, code);
+  THREAD_RUNTIME_ARRAY(t, uint64_t, values, stackSize);
+
+  object objects = makeObjectArray(t, stackSize);
+  PROTECT(t, objects);
+
+  unsigned sp = 0;
+  unsigned ip = 0;
+  while (ip < codeLength(t, code)) {
+    unsigned instruction = codeBody(t, code, ip++);
+
+    bool isObject = false;
+    uint64_t value = 0;
+    object o = 0;
+
+    switch (instruction) {
+    case aconst_null:
+      isObject = true;
+      break;
+
+    case iconst_m1:
+    case iconst_0:
+    case iconst_1:
+    case iconst_2:
+    case iconst_3:
+    case iconst_4:
+    case iconst_5:
+      value = static_cast<int32_t>(instruction) - iconst_0;
+      break;
+
+    case lconst_0:
+    case lconst_1:
+      value = instruction - lconst_0;
+      break;
+
+    case fconst_0:
+    case fconst_1:
+    case fconst_2:
+      value = floatToBits(static_cast<float>(instruction - fconst_0));
+      break;
+
+    case dconst_0:
+    case dconst_1:
+      value = doubleToBits(static_cast<double>(instruction - dconst_0));
+      break;
+
+    case bipush:
+      value = static_cast<int8_t>(codeBody(t, code, ip++));
+      break;
+
+    case sipush:
+      value = static_cast<int16_t>(codeReadInt16(t, code, ip));
+      break;
+
+    case ldc:
+    case ldc_w: {
+      unsigned index = instruction == ldc
+        ? codeBody(t, code, ip++) : codeReadInt16(t, code, ip);
+
+      object pool = codePool(t, code);
+      if (singletonIsObject(t, pool, index - 1)) {
+        o = singletonObject(t, pool, index - 1);
+        if (objectClass(t, o) != type(t, Machine::StringType)) {
+          return false;
+        }
+        isObject = true;
+      } else {
+        value = singletonValue(t, pool, index - 1);
+      }
+    } break;
+
+    case ldc2_w: {
+      unsigned index = codeReadInt16(t, code, ip);
+      memcpy(&value, &singletonValue(t, codePool(t, code), index - 1), 8);
+    } break;
+
+    case dup:
+      if (sp == 0) {
+        return false;
+      }
+      value = RUNTIME_ARRAY_BODY(values)[sp - 1];
+      o = objectArrayBody(t, objects, sp - 1);
+      isObject = o != 0;
+      break;
+
+    case newarray: {
+      unsigned type = codeBody(t, code, ip++);
+      if (sp == 0 or type < T_BOOLEAN or type > T_LONG) {
+        return false;
+      }
+
+      int32_t length = RUNTIME_ARRAY_BODY(values)[--sp];
+      if (length < 0) {
+        return false;
+      }
+
+      o = reinterpret_cast<object>(makeBlankArray(t, type, length));
+      isObject = true;
+    } break;
+
+    case bastore:
+    case castore:
+    case sastore:
+    case iastore:
+    case fastore:
+    case lastore:
+    case dastore: {
+      if (sp < 3) {
+        return false;
+      }
+
+      sp -= 3;
+      object array = objectArrayBody(t, objects, sp);
+      int32_t index = RUNTIME_ARRAY_BODY(values)[sp + 1];
+      uint64_t v = RUNTIME_ARRAY_BODY(values)[sp + 2];
+
+      if (array == 0
+          or index < 0
+          or static_cast<uintptr_t>(index)
+          >= cast<uintptr_t>(array, BytesPerWord))
+      {
+        return false;
+      }
+
+      switch (instruction) {
+      case bastore:
+        cast<int8_t>(array, ArrayBody + index) = v;
+        break;
+
+      case castore:
+      case sastore:
+        cast<int16_t>(array, ArrayBody + (index * 2)) = v;
+        break;
+
+      case iastore:
+      case fastore:
+        cast<int32_t>(array, ArrayBody + (index * 4)) = v;
+        break;
+
+      case lastore:
+      case dastore:
+        cast<int64_t>(array, ArrayBody + (index * 8)) = v;
+        break;
+
+      default: abort(t);
+      }
+    } continue;
+
+    case putstatic: {
+      unsigned index = codeReadInt16(t, code, ip);
+
+      object field = resolveField(t, method, index - 1, false);
+      if (field == 0
+          or sp == 0
+          or (fieldFlags(t, field) & ACC_STATIC) == 0
+          or fieldClass(t, field) != methodClass(t, method))
+      {
+        return false;
+      }
+
+      --sp;
+      object table = classStaticTable(t, fieldClass(t, field));
+      uint64_t v = RUNTIME_ARRAY_BODY(values)[sp];
+
+      switch (fieldCode(t, field)) {
+      case ByteField:
+      case BooleanField:
+        cast<int8_t>(table, fieldOffset(t, field)) = v;
+        break;
+
+      case CharField:
+      case ShortField:
+        cast<int16_t>(table, fieldOffset(t, field)) = v;
+        break;
+
+      case FloatField:
+      case IntField:
+        cast<int32_t>(table, fieldOffset(t, field)) = v;
+        break;
+
+      case DoubleField:
+      case LongField:
+        cast<int64_t>(table, fieldOffset(t, field)) = v;
+        break;
+
+      case ObjectField:
+        set(t, table, fieldOffset(t, field), objectArrayBody(t, objects, sp));
+        break;
+
+      default: abort(t);
+      }
+    } continue;
+
+    case return_:
+      return true;
+
+    default:
+      return false;
+    }
+
+    if (sp == stackSize) {
+      return false;
+    }
+
+    RUNTIME_ARRAY_BODY(values)[sp] = value;
+    set(t, objects, ArrayBody + (sp * BytesPerWord), isObject ? o : 0);
+    ++ sp;
+  }
+
+  return false;
+}
+
 object
 invoke(Thread* thread, object method, ArgumentList* arguments)
 {
@@ -8714,11 +12405,184 @@ isThunkUnsafeStack(MyThread* t, void* ip);
 void
 boot(MyThread* t, BootImage* image, uint8_t* code);
 
+// Aggregates the Java stacks of threads interrupted by the profiling
+// timer.  Samples are recorded from signal context, so the table is
+// preallocated, nothing is resolved beyond machine addresses until
+// the profile is written, and a sample which finds the table busy is
+// dropped rather than waited for.
+class ProfileHandler: public System::SignalHandler {
+ public:
+  class Sample {
+   public:
+    uintptr_t hash;
+    unsigned count;
+    unsigned length;
+    void* ips[ProfileDepth];
+  };
+
+  class Visitor: public Processor::StackVisitor {
+   public:
+    Visitor(MyThread* t, Sample* sample): t(t), sample(sample) { }
+
+    virtual bool visit(Processor::StackWalker* walker) {
+      if (walker->ip()) {
+        sample->ips[sample->length++] = reinterpret_cast<void*>
+          (methodCompiled(t, walker->method()) + walker->ip());
+      }
+      return sample->length < ProfileDepth;
+    }
+
+    MyThread* t;
+    Sample* sample;
+  };
+
+  ProfileHandler():
+    m(0), samples(0), lock(0), dropped(0)
+  { }
+
+  virtual bool handleSignal(void** ip, void**, void** stack, void**) {
+    MyThread* t = static_cast<MyThread*>(m->localThread->get());
+    if (t == 0 or t->state != Thread::ActiveState) {
+      return false;
+    }
+
+    Sample sample;
+    sample.length = 0;
+
+    { MyThread::TraceContext c(t, 0);
+
+      // this mirrors the cases in MyProcessor::getStackTrace, except
+      // that there is no link register to consult when caught in a
+      // thunk, so those samples are attributed to the saved trace
+      if (methodForIp(t, *ip)) {
+        c.ip = *ip;
+        c.stack = *stack;
+        c.methodIsMostRecent = true;
+      } else if (t->transition) {
+        static_cast<MyThread::Context&>(c) = *(t->transition);
+      } else if (t->stack
+                 and (not isVmInvokeUnsafeStack(*ip))
+                 and (not isThunkUnsafeStack(t, *ip))
+                 and (not isVirtualThunk(t, *ip)))
+      {
+        c.ip = getIp(t);
+        c.stack = t->stack;
+      } else {
+        c.ip = 0;
+        c.stack = 0;
+      }
+
+      Visitor visitor(t, &sample);
+      t->m->processor->walkStack(t, &visitor);
+    }
+
+    if (sample.length == 0) {
+      return false;
+    }
+
+    uintptr_t hash = sample.length;
+    for (unsigned i = 0; i < sample.length; ++i) {
+      hash = (hash * 31) + reinterpret_cast<uintptr_t>(sample.ips[i]);
+    }
+
+    if (not acquire()) {
+      ++ dropped;
+      return false;
+    }
+
+    for (unsigned i = 0; i < ProfileTableSize; ++i) {
+      Sample* s = samples + ((hash + i) & (ProfileTableSize - 1));
+      if (s->count == 0) {
+        memcpy(s, &sample, sizeof(Sample));
+        s->hash = hash;
+        s->count = 1;
+        break;
+      } else if (s->hash == hash
+                 and s->length == sample.length
+                 and memcmp(s->ips, sample.ips,
+                            sample.length * BytesPerWord) == 0)
+      {
+        ++ s->count;
+        break;
+      } else if (i == ProfileTableSize - 1) {
+        ++ dropped;
+      }
+    }
+
+    storeStoreMemoryBarrier();
+    lock = 0;
+
+    return false;
+  }
+
+  bool acquire() {
+#ifdef USE_ATOMIC_OPERATIONS
+    return atomicCompareAndSwap(&lock, 0, 1);
+#else
+    // the table can't be shared safely with signal context without
+    // an atomic compare-and-swap, so the profiler is never started
+    return false;
+#endif
+  }
+
+  Machine* m;
+  Sample* samples;
+  uintptr_t lock;
+  unsigned dropped;
+};
+
+// Writes the samples collected by the specified handler to out, one
+// line per distinct stack with frames separated by semicolons from
+// the outermost inward, followed by the number of times it was seen.
+// This is the collapsed format read by flame graph tools.
+void
+writeProfile(MyThread* t, ProfileHandler* handler, FILE* out)
+{
+  for (unsigned i = 0; i < ProfileTableSize; ++i) {
+    ProfileHandler::Sample* s = handler->samples + i;
+    if (s->count) {
+      for (int j = s->length - 1; j >= 0; --j) {
+        object method = methodForIp(t, s->ips[j]);
+        if (method) {
+          fprintf(out, "%s.%s",
+                  &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+                  &byteArrayBody(t, methodName(t, method), 0));
+        } else {
+          fprintf(out, "[unknown]");
+        }
+
+        fprintf(out, "%s", j ? ";" : "");
+      }
+
+      fprintf(out, " %u\n", s->count);
+    }
+  }
+
+  if (handler->dropped) {
+    fprintf(out, "[dropped] %u\n", handler->dropped);
+  }
+}
+
 class MyProcessor;
 
 MyProcessor*
 processor(MyThread* t);
 
+// A sorted array of the start addresses of compiled methods, parallel
+// to an object array root holding the methods themselves.  Methods are
+// only ever appended, so readers can search it without a lock.
+class MethodIndex {
+ public:
+  MethodIndex(unsigned capacity, MethodIndex* previous):
+    count(0), capacity(capacity), previous(previous)
+  { }
+
+  unsigned count;
+  unsigned capacity;
+  MethodIndex* previous;
+  uintptr_t starts[0];
+};
+
 void
 compileThunks(MyThread* t, FixedAllocator* allocator);
 
@@ -8740,9 +12604,7 @@ public:
   Processor::CompilationHandler* handler;
 };
 
-template<class T, class C>
-int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name) {
-  size_t actual = reinterpret_cast<uint8_t*>(&(t->*field)) - reinterpret_cast<uint8_t*>(t);
+int checkConstant(size_t expected, size_t actual, const char* name) {
   if(expected != actual) {
     fprintf(stderr, "constant mismatch (%s): \n\tconstant says: %d\n\tc++ compiler says: %d\n", name, (unsigned) expected, (unsigned) actual);
     return 1;
@@ -8750,6 +12612,12 @@ int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name)
   return 0;
 }
 
+template<class T, class C>
+int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name) {
+  size_t actual = reinterpret_cast<uint8_t*>(&(t->*field)) - reinterpret_cast<uint8_t*>(t);
+  return checkConstant(expected, actual, name);
+}
+
 class MyProcessor: public Processor {
  public:
   class Thunk {
@@ -8774,6 +12642,7 @@ class MyProcessor: public Processor {
     Thunk native;
     Thunk aioob;
     Thunk stackOverflow;
+    Thunk nop;
     Thunk table;
   };
 
@@ -8791,11 +12660,21 @@ class MyProcessor: public Processor {
     divideByZeroHandler(Machine::ArithmeticExceptionType,
                         Machine::ArithmeticException,
                         FixedSizeOfArithmeticException),
+    stackOverflowHandler(Machine::StackOverflowErrorType,
+                         Machine::StackOverflowError,
+                         FixedSizeOfStackOverflowError),
+    profileHandler(),
     codeAllocator(s, 0, 0),
     callTableSize(0),
     useNativeFeatures(useNativeFeatures),
-    compilationHandlers(0)
+    compilationHandlers(0),
+    methodIndex(0),
+    bootMethodIndex(0),
+    methodIndexComplete(true),
+    localReferencePeak(0)
   {
+    memset(inlineCacheEvents, 0, sizeof(inlineCacheEvents));
+
     thunkTable[compileMethodIndex] = voidPointer(local::compileMethod);
     thunkTable[compileVirtualMethodIndex] = voidPointer(compileVirtualMethod);
     thunkTable[invokeNativeIndex] = voidPointer(invokeNative);
@@ -8818,7 +12697,8 @@ class MyProcessor: public Processor {
   virtual Thread*
   makeThread(Machine* m, object javaThread, Thread* parent)
   {
-    MyThread* t = new (m->heap->allocate(sizeof(MyThread)))
+    MyThread* t = new
+      (m->heap->allocator(Heap::ThreadMemory)->allocate(sizeof(MyThread)))
       MyThread(m, javaThread, static_cast<MyThread*>(parent),
                useNativeFeatures);
 
@@ -8830,6 +12710,7 @@ class MyProcessor: public Processor {
 
     int mismatches =
       checkConstant(t, TARGET_THREAD_EXCEPTION, &Thread::exception, "TARGET_THREAD_EXCEPTION") +
+      checkConstant(t, TARGET_THREAD_SAFEPOINTREQUESTED, &Thread::safepointRequested, "TARGET_THREAD_SAFEPOINTREQUESTED") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT, &MyThread::exceptionStackAdjustment, "TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONOFFSET, &MyThread::exceptionOffset, "TARGET_THREAD_EXCEPTIONOFFSET") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONHANDLER, &MyThread::exceptionHandler, "TARGET_THREAD_EXCEPTIONHANDLER") +
@@ -8842,7 +12723,15 @@ class MyProcessor: public Processor {
       checkConstant(t, TARGET_THREAD_HEAPIMAGE, &MyThread::heapImage, "TARGET_THREAD_HEAPIMAGE") +
       checkConstant(t, TARGET_THREAD_CODEIMAGE, &MyThread::codeImage, "TARGET_THREAD_CODEIMAGE") +
       checkConstant(t, TARGET_THREAD_THUNKTABLE, &MyThread::thunkTable, "TARGET_THREAD_THUNKTABLE") +
-      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT");
+      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT") +
+      checkConstant(t, TARGET_THREAD_SCRATCH, &MyThread::scratch, "TARGET_THREAD_SCRATCH") +
+      checkConstant(t, TARGET_THREAD_CONTINUATION, &MyThread::continuation, "TARGET_THREAD_CONTINUATION") +
+      checkConstant(TARGET_CONTINUATION_NEXT, ContinuationNext, "TARGET_CONTINUATION_NEXT") +
+      checkConstant(TARGET_CONTINUATION_ADDRESS, ContinuationAddress, "TARGET_CONTINUATION_ADDRESS") +
+      checkConstant(TARGET_CONTINUATION_RETURNADDRESSOFFSET, ContinuationReturnAddressOffset, "TARGET_CONTINUATION_RETURNADDRESSOFFSET") +
+      checkConstant(TARGET_CONTINUATION_FRAMEPOINTEROFFSET, ContinuationFramePointerOffset, "TARGET_CONTINUATION_FRAMEPOINTEROFFSET") +
+      checkConstant(TARGET_CONTINUATION_LENGTH, ContinuationLength, "TARGET_CONTINUATION_LENGTH") +
+      checkConstant(TARGET_CONTINUATION_BODY, ContinuationBody, "TARGET_CONTINUATION_BODY");
 
     if(mismatches > 0) {
       fprintf(stderr, "%d constant mismatches\n", mismatches);
@@ -8902,7 +12791,7 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions,
        0, objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, staticTable, addendum, loader, 0,
+       fieldTable, methodTable, staticTable, addendum, loader, 0, 0, 0,
        vtableLength);
   }
 
@@ -8917,6 +12806,22 @@ class MyProcessor: public Processor {
     }
   }
 
+  virtual void
+  methodOverridden(Thread* vmt, object method)
+  {
+    MyThread* t = static_cast<MyThread*>(vmt);
+
+    if (root(t, SpeculativeCalls)) {
+      object calls = hashMapRemove
+        (t, root(t, SpeculativeCalls), method, objectHash, objectEqual);
+      PROTECT(t, calls);
+
+      for (; calls; calls = pairSecond(t, calls)) {
+        redirectSpeculativeCall(t, pairFirst(t, calls));
+      }
+    }
+  }
+
   virtual void
   visitObjects(Thread* vmt, Heap::Visitor* v)
   {
@@ -8926,6 +12831,8 @@ class MyProcessor: public Processor {
       v->visit(&roots);
     }
 
+    t->clearHandlerCache();
+
     for (MyThread::CallTrace* trace = t->trace; trace; trace = trace->next) {
       v->visit(&(trace->continuation));
       v->visit(&(trace->nativeMethod));
@@ -8935,8 +12842,12 @@ class MyProcessor: public Processor {
 
     v->visit(&(t->continuation));
 
-    for (Reference* r = t->reference; r; r = r->next) {
-      v->visit(&(r->target));
+    for (MyThread::LocalReferenceChunk* c = t->localReferences; c;
+         c = c->next)
+    {
+      for (unsigned i = 0; i < c->count; ++i) {
+        v->visit(c->slots + i);
+      }
     }
 
     visitStack(t, v);
@@ -8958,25 +12869,10 @@ class MyProcessor: public Processor {
   }
 
   virtual object*
-  makeLocalReference(Thread* vmt, object o)
-  {
-    if (o) {
-      MyThread* t = static_cast<MyThread*>(vmt);
-
-      for (Reference* r = t->reference; r; r = r->next) {
-        if (r->target == o) {
-          acquire(t, r);
-
-          return &(r->target);
-        }
-      }
-
-      Reference* r = new (t->m->heap->allocate(sizeof(Reference)))
-        Reference(o, &(t->reference), false);
-
-      acquire(t, r);
-
-      return &(r->target);
+  makeLocalReference(Thread* vmt, object o)
+  {
+    if (o) {
+      return static_cast<MyThread*>(vmt)->makeLocalReference(o);
     } else {
       return 0;
     }
@@ -8986,7 +12882,7 @@ class MyProcessor: public Processor {
   disposeLocalReference(Thread* t, object* r)
   {
     if (r) {
-      release(t, reinterpret_cast<Reference*>(r));
+      static_cast<MyThread*>(t)->disposeLocalReference(r);
     }
   }
 
@@ -8996,8 +12892,9 @@ class MyProcessor: public Processor {
     MyThread* t = static_cast<MyThread*>(vmt);
 
     t->referenceFrame = new
-      (t->m->heap->allocate(sizeof(MyThread::ReferenceFrame)))
-      MyThread::ReferenceFrame(t->referenceFrame, t->reference);
+      (t->m->heap->allocator(Heap::JniMemory)->allocate
+       (sizeof(MyThread::ReferenceFrame)))
+      MyThread::ReferenceFrame(t->referenceFrame, t->markLocalReferences());
     
     return true;
   }
@@ -9009,11 +12906,10 @@ class MyProcessor: public Processor {
 
     MyThread::ReferenceFrame* f = t->referenceFrame;
     t->referenceFrame = f->next;
-    while (t->reference != f->reference) {
-      vm::dispose(t, t->reference);
-    }
+    t->releaseLocalReferences(f->base);
 
-    t->m->heap->free(f, sizeof(MyThread::ReferenceFrame));
+    t->m->heap->allocator(Heap::JniMemory)->free
+      (f, sizeof(MyThread::ReferenceFrame));
   }
 
   virtual object
@@ -9101,6 +12997,14 @@ class MyProcessor: public Processor {
 
     PROTECT(t, method);
 
+    if (InterpretInitializers
+        and (methodVmFlags(t, method) & ClassInitFlag)
+        and methodAddress(t, method) == defaultThunk(static_cast<MyThread*>(t))
+        and interpretInitializer(static_cast<MyThread*>(t), method))
+    {
+      return 0;
+    }
+
     compile(static_cast<MyThread*>(t),
             local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
 
@@ -9140,28 +13044,84 @@ class MyProcessor: public Processor {
   virtual void dispose(Thread* vmt) {
     MyThread* t = static_cast<MyThread*>(vmt);
 
-    while (t->reference) {
-      vm::dispose(t, t->reference);
+    if (t->localReferencePeak > localReferencePeak) {
+      localReferencePeak = t->localReferencePeak;
     }
 
+    t->disposeLocalReferences();
+
     t->arch->release();
 
-    t->m->heap->free(t, sizeof(*t));
+    t->m->heap->allocator(Heap::ThreadMemory)->free(t, sizeof(*t));
 
   }
 
   virtual void dispose() {
+    if (DebugInlineCaches) {
+      fprintf(stderr, "inline caches: %u hits, %u misses, %u megamorphic\n",
+              inlineCacheEvents[InlineCacheHit],
+              inlineCacheEvents[InlineCacheMiss],
+              inlineCacheEvents[InlineCacheMegamorphic]);
+    }
+
+    if (DebugLocalReferences) {
+      fprintf(stderr, "local references: peak %u per thread\n",
+              localReferencePeak);
+    }
+
     if (codeAllocator.base) {
       s->freeExecutable(codeAllocator.base, codeAllocator.capacity);
     }
 
     compilationHandlers->dispose(allocator);
 
+    disposeMethodIndex(methodIndex);
+    disposeMethodIndex(bootMethodIndex);
+
+    if (profileHandler.samples) {
+      s->handleProfile(0, 0);
+
+      allocator->free(profileHandler.samples, sizeof(ProfileHandler::Sample)
+                      * ProfileTableSize);
+    }
+
+    s->handleStackOverflow(0);
     s->handleSegFault(0);
 
     allocator->free(this, sizeof(*this));
   }
 
+  void disposeMethodIndex(MethodIndex* index) {
+    while (index) {
+      MethodIndex* previous = index->previous;
+      allocator->free
+        (index, sizeof(MethodIndex) + (index->capacity * BytesPerWord));
+      index = previous;
+    }
+  }
+
+  virtual void shutDown(Thread* vmt) {
+    if (profileHandler.samples and profileHandler.m) {
+      MyThread* t = static_cast<MyThread*>(vmt);
+
+      s->handleProfile(0, 0);
+
+      // wait out any sample still being recorded, and leave the lock
+      // held so no more are
+      while (not profileHandler.acquire()) {
+        s->yield();
+      }
+      profileHandler.m = 0;
+
+      const char* path = findProperty(t, "avian.jit.profile");
+      FILE* out = vm::fopen(path, "wb");
+      if (out) {
+        writeProfile(t, &profileHandler, out);
+        fclose(out);
+      }
+    }
+  }
+
   virtual object getStackTrace(Thread* vmt, Thread* vmTarget) {
     MyThread* t = static_cast<MyThread*>(vmt);
     MyThread* target = static_cast<MyThread*>(vmTarget);
@@ -9244,7 +13204,7 @@ class MyProcessor: public Processor {
       collect(t, Heap::MinorCollection);
     }
 
-    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+    return visitor.trace ? visitor.trace : makeTrace(t, 0u);
   }
 
   virtual void initialize(BootImage* image, uint8_t* code, unsigned capacity) {
@@ -9314,9 +13274,26 @@ class MyProcessor: public Processor {
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code) {
     if (codeAllocator.base == 0) {
+      // the avian.jit.code.capacity property, if present, overrides the
+      // default size of the executable area using the same suffixes
+      // as -Xmx (e.g. "64m"):
+      unsigned capacity = ExecutableAreaSizeInBytes;
+      const char* size = findProperty(t, "avian.jit.code.capacity");
+      if (size and parseSize(size) > 0) {
+        capacity = parseSize(size);
+      }
+
       codeAllocator.base = static_cast<uint8_t*>
-        (s->tryAllocateExecutable(ExecutableAreaSizeInBytes));
-      codeAllocator.capacity = ExecutableAreaSizeInBytes;
+        (s->tryAllocateExecutable(capacity));
+      codeAllocator.capacity = capacity;
+      codeAllocator.heap = t->m->heap;
+
+      const char* hugePages = findProperty(t, "avian.hugepages");
+      if (codeAllocator.base and hugePages
+          and strcmp(hugePages, "true") == 0)
+      {
+        s->adviseHugePages(codeAllocator.base, capacity);
+      }
     }
 
     if (image and code) {
@@ -9347,6 +13324,33 @@ class MyProcessor: public Processor {
     divideByZeroHandler.m = t->m;
     expect(t, t->m->system->success
            (t->m->system->handleDivideByZero(&divideByZeroHandler)));
+
+    // the prologue checks against Thread::stackLimit still catch
+    // overflows of the -Xss limit; this catches Java code running off
+    // the end of a thread stack which is exhausted first, where the
+    // platform supports it
+    stackOverflowHandler.m = t->m;
+    t->m->system->handleStackOverflow(&stackOverflowHandler);
+
+#ifdef USE_ATOMIC_OPERATIONS
+    if (findProperty(t, "avian.jit.profile")) {
+      const char* interval = findProperty(t, "avian.jit.profile.interval");
+
+      unsigned size = sizeof(ProfileHandler::Sample) * ProfileTableSize;
+      profileHandler.samples = static_cast<ProfileHandler::Sample*>
+        (allocator->allocate(size));
+      memset(profileHandler.samples, 0, size);
+      profileHandler.m = t->m;
+
+      if (not t->m->system->success
+          (t->m->system->handleProfile
+           (&profileHandler, interval
+            ? atoi(interval) : DefaultProfileIntervalInMicroseconds)))
+      {
+        fprintf(stderr, "warning: unable to start the profiling timer\n");
+      }
+    }
+#endif
   }
 
   virtual void callWithCurrentContinuation(Thread* t, object receiver) {
@@ -9406,6 +13410,8 @@ class MyProcessor: public Processor {
   unsigned codeImageSize;
   SignalHandler segFaultHandler;
   SignalHandler divideByZeroHandler;
+  SignalHandler stackOverflowHandler;
+  ProfileHandler profileHandler;
   FixedAllocator codeAllocator;
   ThunkCollection thunks;
   ThunkCollection bootThunks;
@@ -9413,8 +13419,150 @@ class MyProcessor: public Processor {
   bool useNativeFeatures;
   void* thunkTable[dummyIndex + 1];
   CompilationHandlerList* compilationHandlers;
+  unsigned inlineCacheEvents[InlineCacheMegamorphic + 1];
+  MethodIndex* methodIndex;
+  MethodIndex* bootMethodIndex;
+  bool methodIndexComplete;
+  unsigned localReferencePeak;
 };
 
+object
+queryMethodIndex(MyThread* t, MethodIndex* index, Root methodsRoot,
+                 intptr_t ip)
+{
+  if (index == 0) {
+    return 0;
+  }
+
+  // see appendToMethodIndex for the order in which these are written
+  loadMemoryBarrier();
+
+  object methods = root(t, methodsRoot);
+  unsigned count = index->count;
+
+  loadMemoryBarrier();
+
+  uintptr_t address = ip;
+  if (count == 0 or address < index->starts[0]) {
+    return 0;
+  }
+
+  unsigned low = 0;
+  unsigned high = count;
+  while (high - low > 1) {
+    unsigned middle = low + ((high - low) / 2);
+    if (index->starts[middle] <= address) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  object method = arrayBody(t, methods, low);
+  if (address < index->starts[low] + methodCompiledSize(t, method)) {
+    return method;
+  } else {
+    return 0;
+  }
+}
+
+// Returns the method whose compiled code contains the specified
+// address, if the method index has it.  Sets *complete to whether the
+// indexes cover every compiled method, in which case a miss means
+// there is no such method.
+object
+queryMethodIndex(MyThread* t, intptr_t ip, bool* complete)
+{
+  MyProcessor* p = processor(t);
+
+  *complete = p->methodIndexComplete;
+
+  object method = queryMethodIndex
+    (t, p->bootMethodIndex, BootMethodIndexMethods, ip);
+  if (method == 0) {
+    method = queryMethodIndex(t, p->methodIndex, MethodIndexMethods, ip);
+  }
+  return method;
+}
+
+// Appends the specified method to an index, provided its code lies
+// after that of every method already there.  Methods come from a bump
+// allocator, so that is the usual case; anything else is left to the
+// method tree.  The caller must hold the class lock.
+void
+appendToMethodIndex(MyThread* t, MethodIndex** index, Root methodsRoot,
+                    object method)
+{
+  PROTECT(t, method);
+
+  MyProcessor* p = processor(t);
+  uintptr_t start = methodCompiled(t, method);
+
+  MethodIndex* old = *index;
+  if (old and old->count and start <= old->starts[old->count - 1]) {
+    p->methodIndexComplete = false;
+    return;
+  }
+
+  if (old == 0 or old->count == old->capacity) {
+    unsigned capacity = old ? old->capacity * 2 : 256;
+
+    object methods = makeArray(t, capacity);
+
+    MethodIndex* fresh = new
+      (p->allocator->allocate
+       (sizeof(MethodIndex) + (capacity * BytesPerWord)))
+      MethodIndex(capacity, old);
+
+    if (old) {
+      memcpy(&arrayBody(t, methods, 0), &arrayBody(t, root(t, methodsRoot), 0),
+             old->count * BytesPerWord);
+      mark(t, methods, ArrayBody, old->count);
+
+      memcpy(fresh->starts, old->starts, old->count * BytesPerWord);
+      fresh->count = old->count;
+    }
+
+    // readers load the index before the methods, so publish the
+    // methods first; old indexes stay valid until the processor is
+    // disposed, since a reader may still be using one
+    setRoot(t, methodsRoot, methods);
+    storeStoreMemoryBarrier();
+    *index = fresh;
+  }
+
+  MethodIndex* i = *index;
+  set(t, root(t, methodsRoot), ArrayBody + (i->count * BytesPerWord), method);
+  i->starts[i->count] = start;
+
+  storeStoreMemoryBarrier();
+
+  ++ i->count;
+}
+
+void
+indexMethodTree(MyThread* t, object node, object sentinal)
+{
+  if (node != sentinal) {
+    PROTECT(t, node);
+    PROTECT(t, sentinal);
+
+    indexMethodTree(t, treeNodeLeft(t, node), sentinal);
+
+    appendToMethodIndex
+      (t, &(processor(t)->bootMethodIndex), BootMethodIndexMethods,
+       treeNodeValue(t, node));
+
+    indexMethodTree(t, treeNodeRight(t, node), sentinal);
+  }
+}
+
+void
+countInlineCacheEvent(MyThread* t, InlineCacheEvent event)
+{
+  ++ processor(t)->inlineCacheEvents[event];
+}
+
 const char*
 stringOrNull(const char* str) {
   if(str) {
@@ -9442,6 +13590,16 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
     } else if (DebugCompile) {
       compileLog = stderr;
     }
+
+    // perf(1) looks for symbols for JIT-compiled code in
+    // /tmp/perf-<pid>.map:
+    const char* map = findProperty(t, "avian.jit.perfmap");
+    if (map and ::strcmp(map, "true") == 0) {
+      char path[64];
+      vm::snprintf(path, 64, "/tmp/perf-%d.map",
+                   t->m->system->processId());
+      perfMap = vm::fopen(path, "wb");
+    }
   }
 
   if (compileLog) {
@@ -9450,6 +13608,12 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
             class_, name, spec);
   }
 
+  if (perfMap) {
+    fprintf(perfMap, "%p %x %s%s%s%s\n", code, size,
+            class_ ? class_ : "", class_ ? "." : "", name, spec ? spec : "");
+    fflush(perfMap);
+  }
+
   size_t nameLength = stringOrNullSize(class_) + stringOrNullSize(name) + stringOrNullSize(spec) + 2;
 
   THREAD_RUNTIME_ARRAY(t, char, completeName, nameLength);
@@ -9462,6 +13626,63 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
   }
 }
 
+// Writes a line describing the compilation of context->method to the
+// file named by the avian.jit.stats property, if any, as
+// tab-separated columns described by the first line of the file.  The
+// last column reports the occupancy of the executable area as used
+// and total bytes so the avian.jit.code.capacity property can be
+// sized.
+void
+logStatistics(MyThread* t, Context* context, unsigned bytecodeSize,
+              int64_t microseconds)
+{
+  static bool open = false;
+  if (not open) {
+    open = true;
+    const char* path = findProperty(t, "avian.jit.stats");
+    if (path) {
+      statisticsLog = vm::fopen(path, "wb");
+      if (statisticsLog) {
+        fprintf(statisticsLog, "# method\tbytecode\tcode\tmicroseconds"
+                "\tspills\treloads\taccessors\tintrinsics\tscalars"
+                "\thoisted\tunchecked\tnulls\tcritical\tdevirtualized"
+                "\trewrites\tcache\n");
+      }
+    }
+  }
+
+  if (statisticsLog) {
+    object method = context->method;
+    CompileStatistics* s = &(context->statistics);
+
+    fprintf(statisticsLog, "%s.%s%s\t%u\t%u\t%" LLD "\t%u\t%u\t%u\t%u\t%u"
+            "\t%u\t%u\t%u\t%u\t%u\t%u\t%u/%u\n",
+            &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+            &byteArrayBody(t, methodName(t, method), 0),
+            &byteArrayBody(t, methodSpec(t, method), 0),
+            bytecodeSize,
+            static_cast<unsigned>(methodCompiledSize(t, method)),
+            microseconds,
+            context->compiler->spillCount(),
+            context->compiler->reloadCount(),
+            s->inlinedAccessors,
+            s->intrinsics,
+            s->scalarAllocations,
+            s->hoistedLoads,
+            s->uncheckedAccesses,
+            s->nullStores,
+            s->criticalNatives,
+            s->devirtualizedCalls,
+            context->assembler->rewriteCount(),
+            codeAllocator(t)->offset,
+            codeAllocator(t)->capacity);
+
+    // flush each line so that the log is complete even if the VM
+    // does not exit normally:
+    fflush(statisticsLog);
+  }
+}
+
 void*
 compileMethod2(MyThread* t, void* ip)
 {
@@ -9475,6 +13696,19 @@ compileMethod2(MyThread* t, void* ip)
 
   THREAD_RESOURCE0(t, static_cast<MyThread*>(t)->trace->targetMethod = 0);
 
+  if (callNodeFlags(t, node) & TraceElement::SpeculativeCall) {
+    // a class overriding the target may have been loaded since this
+    // call was made, so the receiver decides which method to run
+    target = resolveTarget(t, t->stack, target);
+    t->trace->targetMethod = target;
+
+    if (methodFlags(t, target) & ACC_NATIVE) {
+      // invokeNative would otherwise find the speculated target in
+      // the call node
+      t->trace->nativeMethod = target;
+    }
+  }
+
   compile(t, codeAllocator(t), 0, target);
 
   uint8_t* updateIp = static_cast<uint8_t*>(ip);
@@ -9506,12 +13740,83 @@ compileMethod2(MyThread* t, void* ip)
       op = AlignedCall;
     }
 
-    updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
+    if (callNodeFlags(t, node) & TraceElement::SpeculativeCall) {
+      ACQUIRE(t, t->m->classLock);
+
+      // once the target has been overridden, methodOverridden or
+      // recordSpeculativeCall has redirected this call for good
+      if ((methodVmFlags(t, callNodeTarget(t, node)) & OverriddenFlag) == 0) {
+        updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
+      }
+    } else {
+      updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
+    }
   }
 
   return reinterpret_cast<void*>(address);
 }
 
+// Point a speculatively bound call at the dispatch thunk for its
+// target's vtable index.  The caller must hold the class lock.
+void
+redirectSpeculativeCall(MyThread* t, object node)
+{
+  PROTECT(t, node);
+
+  uintptr_t thunk = dispatchThunk
+    (t, methodOffset(t, callNodeTarget(t, node)));
+
+  updateCall(t, (callNodeFlags(t, node) & TraceElement::LongCall)
+             ? AlignedLongCall : AlignedCall,
+             reinterpret_cast<void*>(callNodeAddress(t, node)),
+             reinterpret_cast<void*>(thunk));
+}
+
+// Remember that the call described by node is bound to its target
+// until a class overriding the target is loaded.  The caller must
+// hold the class lock.
+void
+recordSpeculativeCall(MyThread* t, object node)
+{
+  object target = callNodeTarget(t, node);
+
+  if (methodVmFlags(t, target) & OverriddenFlag) {
+    // the target was overridden while the caller was being compiled
+    redirectSpeculativeCall(t, node);
+  } else {
+    PROTECT(t, node);
+    PROTECT(t, target);
+
+    if (root(t, SpeculativeCalls) == 0) {
+      setRoot(t, SpeculativeCalls, makeHashMap(t, 0, 0));
+    }
+
+    object calls = makePair
+      (t, node, hashMapFind
+       (t, root(t, SpeculativeCalls), target, objectHash, objectEqual));
+
+    hashMapInsertOrReplace
+      (t, root(t, SpeculativeCalls), target, calls, objectHash, objectEqual);
+  }
+}
+
+void
+skipInitCheck(MyThread* t, void* returnAddress)
+{
+  uint8_t* updateIp = static_cast<uint8_t*>(returnAddress);
+
+  MyProcessor* p = processor(t);
+
+  // code in the boot image is not patched, and its checks were
+  // compiled without the alignment updateCall requires
+  if (updateIp < p->codeImage
+      or updateIp >= p->codeImage + p->codeImageSize)
+  {
+    updateCall(t, AlignedCall, updateIp,
+               reinterpret_cast<void*>(p->thunks.nop.start));
+  }
+}
+
 bool
 isThunk(MyProcessor::ThunkCollection* thunks, void* ip)
 {
@@ -9545,7 +13850,7 @@ isThunkUnsafeStack(MyProcessor::Thunk* thunk, void* ip)
 bool
 isThunkUnsafeStack(MyProcessor::ThunkCollection* thunks, void* ip)
 {
-  const unsigned NamedThunkCount = 5;
+  const unsigned NamedThunkCount = 6;
 
   MyProcessor::Thunk table[NamedThunkCount + ThunkCount];
 
@@ -9554,6 +13859,7 @@ isThunkUnsafeStack(MyProcessor::ThunkCollection* thunks, void* ip)
   table[2] = thunks->native;
   table[3] = thunks->aioob;
   table[4] = thunks->stackOverflow;
+  table[5] = thunks->nop;
     
   for (unsigned i = 0; i < ThunkCount; ++i) {
     new (table + NamedThunkCount + i) MyProcessor::Thunk
@@ -9771,25 +14077,23 @@ void
 fixupHeap(MyThread* t UNUSED, uintptr_t* map, unsigned size, uintptr_t* heap)
 {
   for (unsigned word = 0; word < size; ++word) {
-    uintptr_t w = map[word];
-    if (w) {
-      for (unsigned bit = 0; bit < BitsPerWord; ++bit) {
-        if (w & (static_cast<uintptr_t>(1) << bit)) {
-          unsigned index = indexOf(word, bit);
-
-          uintptr_t* p = heap + index;
-          assert(t, *p);
-          
-          uintptr_t number = *p & BootMask;
-          uintptr_t mark = *p >> BootShift;
+    // visit only the set bits, clearing each as we go, so the cost is
+    // proportional to the number of references rather than the size
+    // of the heap
+    for (uintptr_t w = map[word]; w; w &= w - 1) {
+      unsigned index = indexOf(word, lowestBit(w));
 
-          if (number) {
-            *p = reinterpret_cast<uintptr_t>(heap + (number - 1)) | mark;
-            // fprintf(stderr, "fixup %d: %d 0x%x\n", index, static_cast<unsigned>(number), static_cast<unsigned>(*p));
-          } else {
-            *p = mark;
-          }
-        }
+      uintptr_t* p = heap + index;
+      assert(t, *p);
+
+      uintptr_t number = *p & BootMask;
+      uintptr_t mark = *p >> BootShift;
+
+      if (number) {
+        *p = reinterpret_cast<uintptr_t>(heap + (number - 1)) | mark;
+        // fprintf(stderr, "fixup %d: %d 0x%x\n", index, static_cast<unsigned>(number), static_cast<unsigned>(*p));
+      } else {
+        *p = mark;
       }
     }
   }
@@ -10015,6 +14319,11 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
   image->initialized = true;
 
   setRoot(t, Machine::BootstrapClassMap, makeHashMap(t, 0, 0));
+
+  if (IndexCompiledMethods) {
+    indexMethodTree
+      (t, root(t, MethodTree), root(t, MethodTreeSentinal));
+  }
 }
 
 intptr_t
@@ -10187,6 +14496,21 @@ compileThunks(MyThread* t, FixedAllocator* allocator)
       (t, allocator, a, "stackOverflow", p->thunks.stackOverflow.length);
   }
 
+  { Context context(t);
+    Assembler* a = context.assembler;
+
+    a->apply(Return);
+
+    p->thunks.nop.length = a->endBlock(false)->resolve(0, 0);
+
+    // this thunk never saves the stack pointer, so a thread caught in
+    // it must be walked from its registers, as in an unsafe prologue
+    p->thunks.nop.frameSavedOffset = p->thunks.nop.length;
+
+    p->thunks.nop.start = finish
+      (t, allocator, a, "nop", p->thunks.nop.length);
+  }
+
   { { Context context(t);
       Assembler* a = context.assembler;
 
@@ -10338,6 +14662,86 @@ compileVirtualThunk(MyThread* t, unsigned index, unsigned* size)
   return reinterpret_cast<uintptr_t>(start);
 }
 
+// Generates code which jumps through entry index of the vtable of
+// the receiver of the call which reached it, as an inline virtual
+// call would have.
+uintptr_t
+compileDispatchThunk(MyThread* t, unsigned index)
+{
+  Context context(t);
+  Assembler* a = context.assembler;
+
+  Assembler::Register class_(t->arch->virtualCallTarget());
+  Assembler::Memory receiver
+    (t->arch->stack(),
+     (t->arch->frameFooterSize() + t->arch->frameReturnAddressSize())
+     * TargetBytesPerWord);
+
+  a->apply(Move, TargetBytesPerWord, MemoryOperand, &receiver,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  Assembler::Memory header(class_.low, 0);
+  a->apply(Move, TargetBytesPerWord, MemoryOperand, &header,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  ResolvedPromise maskPromise(TargetPointerMask);
+  Assembler::Constant mask(&maskPromise);
+  a->apply(And, TargetBytesPerWord, ConstantOperand, &mask,
+           TargetBytesPerWord, RegisterOperand, &class_,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  Assembler::Memory entry
+    (class_.low, TargetClassVtable + (index * TargetBytesPerWord));
+  a->apply(Move, TargetBytesPerWord, MemoryOperand, &entry,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  a->apply(Jump, TargetBytesPerWord, RegisterOperand, &class_);
+
+  unsigned size = a->endBlock(false)->resolve(0, 0);
+
+  uint8_t* start = static_cast<uint8_t*>
+    (codeAllocator(t)->allocate(size, TargetBytesPerWord));
+
+  a->setDestination(start);
+  a->write();
+
+  const unsigned maxIntStringLength = 10;
+
+  THREAD_RUNTIME_ARRAY
+    (t, char, name, strlen("dispatchThunk") + maxIntStringLength + 1);
+
+  sprintf(RUNTIME_ARRAY_BODY(name), "dispatchThunk%d", index);
+
+  logCompile(t, start, size, 0, RUNTIME_ARRAY_BODY(name), 0);
+
+  return reinterpret_cast<uintptr_t>(start);
+}
+
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index)
+{
+  ACQUIRE(t, t->m->classLock);
+
+  if (root(t, DispatchThunks) == 0
+      or wordArrayLength(t, root(t, DispatchThunks)) <= index)
+  {
+    object newArray = makeWordArray(t, nextPowerOfTwo(index + 1));
+    if (root(t, DispatchThunks)) {
+      memcpy(&wordArrayBody(t, newArray, 0),
+             &wordArrayBody(t, root(t, DispatchThunks), 0),
+             wordArrayLength(t, root(t, DispatchThunks)) * BytesPerWord);
+    }
+    setRoot(t, DispatchThunks, newArray);
+  }
+
+  if (wordArrayBody(t, root(t, DispatchThunks), index) == 0) {
+    wordArrayBody(t, root(t, DispatchThunks), index)
+      = compileDispatchThunk(t, index);
+  }
+
+  return wordArrayBody(t, root(t, DispatchThunks), index);
+}
+
 uintptr_t
 virtualThunk(MyThread* t, unsigned index)
 {
@@ -10365,6 +14769,30 @@ virtualThunk(MyThread* t, unsigned index)
   return wordArrayBody(t, root(t, VirtualThunks), index * 2);
 }
 
+// Clears CompilingFlag on a method and wakes any threads waiting for
+// it to be compiled, whether compilation succeeds or not.
+class CompilingMethod: public Thread::Resource {
+ public:
+  CompilingMethod(MyThread* t, object method):
+    Resource(t), method(method), protector(t, &(this->method))
+  { }
+
+  ~CompilingMethod() {
+    ACQUIRE(t, t->m->classLock);
+
+    methodVmFlags(t, method) &= ~CompilingFlag;
+
+    t->m->classLock->notifyAll(t->systemThread);
+  }
+
+  virtual void release() {
+    this->CompilingMethod::~CompilingMethod();
+  }
+
+  object method;
+  Thread::SingleProtector protector;
+};
+
 void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method)
@@ -10381,6 +14809,10 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   assert(t, (methodFlags(t, method) & ACC_NATIVE) == 0);
 
+  StartupTimer timer(t, CompileStartupPhase);
+
+  ensureCode(t, method);
+
   // We must avoid acquiring any locks until after the first pass of
   // compilation, since this pass may trigger classloading operations
   // involving application classloaders and thus the potential for
@@ -10398,7 +14830,35 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   PROTECT(t, clone);
 
+  System* s = t->m->system;
+  int64_t start = s->nowMicroseconds();
+  unsigned bytecodeSize = codeLength(t, methodCode(t, clone));
+
+  object scalarTable = ScalarReplacement
+    ? findScalarReplacements(t, clone) : 0;
+  PROTECT(t, scalarTable);
+
+  object invariantTable = HoistLoopInvariants
+    ? findLoopInvariants(t, clone) : 0;
+  PROTECT(t, invariantTable);
+
+  object boundsTable = EliminateBoundsChecks
+    ? findInBoundsAccesses(t, clone, invariantTable) : 0;
+  PROTECT(t, boundsTable);
+
+  object nullStoreTable = ElideNullStoreBarriers
+    ? findNullStores(t, clone) : 0;
+  PROTECT(t, nullStoreTable);
+
+  object safepointTable = PollSafepoints ? findLoopHeads(t, clone) : 0;
+  PROTECT(t, safepointTable);
+
   Context context(t, bootContext, clone);
+  context.scalarTable = scalarTable;
+  context.invariantTable = invariantTable;
+  context.boundsTable = boundsTable;
+  context.nullStoreTable = nullStoreTable;
+  context.safepointTable = safepointTable;
   compile(t, &context);
 
   { object ehTable = codeExceptionHandlerTable(t, methodCode(t, clone));
@@ -10418,13 +14878,43 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
     }
   }
 
-  ACQUIRE(t, t->m->classLock);
+  // time spent waiting for the lock or for another thread compiling
+  // the same method is not counted:
+  int64_t elapsed = s->nowMicroseconds() - start;
 
-  if (methodAddress(t, method) != defaultThunk(t)) {
-    return;
+  { ACQUIRE(t, t->m->classLock);
+
+    // Code generation neither loads classes nor acquires any locks
+    // besides the class lock, so it is safe to wait here for another
+    // thread doing it for the same method rather than duplicate its
+    // work.
+    while (methodVmFlags(t, method) & CompilingFlag) {
+      ENTER(t, Thread::IdleState);
+      t->m->classLock->wait(t->systemThread, 0);
+    }
+
+    if (methodAddress(t, method) != defaultThunk(t)) {
+      return;
+    }
+
+    methodVmFlags(t, method) |= CompilingFlag;
   }
 
+  CompilingMethod compiling(t, method);
+
+  start = s->nowMicroseconds();
+
+  // this is a CPU-intensive operation, so we do it without holding
+  // the global class lock to improve parallelism:
+  context.compiler->compile
+    (context.leaf ? 0 : stackOverflowThunk(t), TARGET_THREAD_STACKLIMIT);
+
+  ACQUIRE(t, t->m->classLock);
+
   finish(t, allocator, &context);
+
+  logStatistics
+    (t, &context, bytecodeSize, elapsed + s->nowMicroseconds() - start);
  
   if (DebugMethodTree) {
     fprintf(stderr, "insert method at %p\n",
@@ -10447,6 +14937,11 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
       methodCompiled(t, clone), clone, root(t, MethodTreeSentinal),
       compareIpToMethodBounds));
 
+  if (IndexCompiledMethods) {
+    appendToMethodIndex
+      (t, &(processor(t)->methodIndex), MethodIndexMethods, clone);
+  }
+
   storeStoreMemoryBarrier();
 
   set(t, method, MethodCode, methodCode(t, clone));
@@ -10463,6 +14958,17 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   treeUpdate(t, root(t, MethodTree), methodCompiled(t, clone),
              method, root(t, MethodTreeSentinal), compareIpToMethodBounds);
+
+  if (IndexCompiledMethods) {
+    MethodIndex* index = processor(t)->methodIndex;
+    if (index and index->count
+        and index->starts[index->count - 1]
+        == static_cast<uintptr_t>(methodCompiled(t, clone)))
+    {
+      set(t, root(t, MethodIndexMethods),
+          ArrayBody + ((index->count - 1) * BytesPerWord), method);
+    }
+  }
 }
 
 object&
@@ -399,7 +399,9 @@ class Context {
     localFootprint(0),
     machineCodeSize(0),
     alignedFrameSize(0),
-    availableGeneralRegisterCount(generalRegisterLimit - generalRegisterStart)
+    availableGeneralRegisterCount(generalRegisterLimit - generalRegisterStart),
+    spillCount(0),
+    reloadCount(0)
   {
     for (unsigned i = generalRegisterStart; i < generalRegisterLimit; ++i) {
       new (registerResources + i) RegisterResource(arch->reserved(i));
@@ -448,6 +450,8 @@ class Context {
   unsigned machineCodeSize;
   unsigned alignedFrameSize;
   unsigned availableGeneralRegisterCount;
+  unsigned spillCount;
+  unsigned reloadCount;
 };
 
 unsigned
@@ -2217,6 +2221,12 @@ frameSite(Context* c, int frameIndex)
     (c, c->arch->stack(), frameIndexToOffset(c, frameIndex), NoRegister, 0);
 }
 
+bool
+isFrameSite(Context* c, Site* s)
+{
+  return s->type(c) == MemoryOperand and not s->isVolatile(c);
+}
+
 void
 move(Context* c, Value* value, Site* src, Site* dst);
 
@@ -2907,6 +2917,12 @@ move(Context* c, Value* value, Site* src, Site* dst)
 
   assert(c, findSite(c, value, dst));
 
+  if (src->type(c) == RegisterOperand and isFrameSite(c, dst)) {
+    ++ c->spillCount;
+  } else if (isFrameSite(c, src) and dst->type(c) == RegisterOperand) {
+    ++ c->reloadCount;
+  }
+
   src->freeze(c, value);
   dst->freeze(c, value);
   
@@ -3140,7 +3156,7 @@ class CallEvent: public Event {
   CallEvent(Context* c, Value* address, unsigned flags,
             TraceHandler* traceHandler, Value* result, unsigned resultSize,
             Stack* argumentStack, unsigned argumentCount,
-            unsigned stackArgumentFootprint):
+            unsigned stackArgumentFootprint, int pollOffset):
     Event(c),
     address(address),
     traceHandler(traceHandler),
@@ -3151,7 +3167,8 @@ class CallEvent: public Event {
     stackArgumentIndex(0),
     flags(flags),
     resultSize(resultSize),
-    stackArgumentFootprint(stackArgumentFootprint)
+    stackArgumentFootprint(stackArgumentFootprint),
+    pollOffset(pollOffset)
   {
     uint32_t registerMask = c->arch->generalRegisterMask();
 
@@ -3391,6 +3408,22 @@ class CallEvent: public Event {
       op = Call;
     }
 
+    CodePromise* skipPromise = 0;
+    if (pollOffset >= 0) {
+      // the call is made only if the word at pollOffset from the
+      // thread register is nonzero; everything it would clobber has
+      // been saved by now either way
+      skipPromise = codePromise(c, static_cast<Promise*>(0));
+
+      ConstantSite zero(resolved(c, 0));
+      MemorySite flag(c->arch->thread(), pollOffset, NoRegister, 1);
+      flag.acquired = true;
+      ConstantSite skip(skipPromise);
+      apply(c, JumpIfEqual, TargetBytesPerWord, &zero, &zero,
+            TargetBytesPerWord, &flag, &flag, TargetBytesPerWord, &skip,
+            &skip);
+    }
+
     apply(c, op, TargetBytesPerWord, address->source, address->source);
 
     if (traceHandler) {
@@ -3398,6 +3431,10 @@ class CallEvent: public Event {
                                 stackArgumentIndex);
     }
 
+    if (skipPromise) {
+      skipPromise->offset = c->assembler->offset();
+    }
+
     if (TailCalls) {
       if (flags & Compiler::TailJump) {
         if (returnAddressSurrogate) {
@@ -3442,18 +3479,19 @@ class CallEvent: public Event {
   unsigned flags;
   unsigned resultSize;
   unsigned stackArgumentFootprint;
+  int pollOffset;
 };
 
 void
 appendCall(Context* c, Value* address, unsigned flags,
            TraceHandler* traceHandler, Value* result, unsigned resultSize,
            Stack* argumentStack, unsigned argumentCount,
-           unsigned stackArgumentFootprint)
+           unsigned stackArgumentFootprint, int pollOffset = -1)
 {
   append(c, new(c->zone)
          CallEvent(c, address, flags, traceHandler, result,
                    resultSize, argumentStack, argumentCount,
-                   stackArgumentFootprint));
+                   stackArgumentFootprint, pollOffset));
 }
 
 bool
@@ -5054,6 +5092,49 @@ appendBoundsCheck(Context* c, Value* object, unsigned lengthOffset,
   append(c, new(c->zone) BoundsCheckEvent(c, object, lengthOffset, index, handler));
 }
 
+// Reads the first word of an object without using the result, so that
+// a null object raises a NullPointerException here via the segfault
+// handler.  The comparison branches to the next instruction either
+// way.
+class NullCheckEvent: public Event {
+ public:
+  NullCheckEvent(Context* c, Value* object):
+    Event(c), object(object)
+  {
+    addRead(c, this, object, generalRegisterMask(c));
+  }
+
+  virtual const char* name() {
+    return "NullCheckEvent";
+  }
+
+  virtual void compile(Context* c) {
+    assert(c, object->source->type(c) == RegisterOperand);
+    MemorySite header(static_cast<RegisterSite*>(object->source)->number,
+                      0, NoRegister, 1);
+    header.acquired = true;
+
+    CodePromise* nextPromise = codePromise(c, static_cast<Promise*>(0));
+
+    ConstantSite zero(resolved(c, 0));
+    ConstantSite next(nextPromise);
+    apply(c, JumpIfEqual, 4, &zero, &zero, 4, &header, &header,
+          TargetBytesPerWord, &next, &next);
+
+    nextPromise->offset = c->assembler->offset();
+
+    popRead(c, this, object);
+  }
+
+  Value* object;
+};
+
+void
+appendNullCheck(Context* c, Value* object)
+{
+  append(c, new(c->zone) NullCheckEvent(c, object));
+}
+
 class FrameSiteEvent: public Event {
  public:
   FrameSiteEvent(Context* c, Value* value, int index):
@@ -6402,6 +6483,16 @@ class MyCompiler: public Compiler {
     return result;
   }
 
+  virtual void poll(int flagOffset, Operand* address,
+                    TraceHandler* traceHandler)
+  {
+    Stack* argumentStack = local::stack
+      (&c, local::register_(&c, c.arch->thread()), c.stack);
+
+    appendCall(&c, static_cast<Value*>(address), 0, traceHandler,
+               value(&c, ValueGeneral), 0, argumentStack, 1, 0, flagOffset);
+  }
+
   virtual void return_(unsigned size, Operand* value) {
     appendReturn(&c, size, static_cast<Value*>(value));
   }
@@ -6487,6 +6578,10 @@ class MyCompiler: public Compiler {
                       static_cast<Value*>(index), handler);
   }
 
+  virtual void nullCheck(Operand* object) {
+    appendNullCheck(&c, static_cast<Value*>(object));
+  }
+
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst)
   {
@@ -6892,6 +6987,54 @@ class MyCompiler: public Compiler {
     return result;
   }
 
+  virtual Operand* popcount(unsigned aSize, unsigned resSize, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, PopulationCount, aSize, static_cast<Value*>(a), resSize, result);
+    return result;
+  }
+
+  virtual Operand* clz(unsigned aSize, unsigned resSize, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, CountLeadingZeros, aSize, static_cast<Value*>(a), resSize, result);
+    return result;
+  }
+
+  virtual Operand* ctz(unsigned aSize, unsigned resSize, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, CountTrailingZeros, aSize, static_cast<Value*>(a), resSize, result);
+    return result;
+  }
+
+  virtual Operand* ffloor(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueFloat);
+    Value* result = value(&c, ValueFloat);
+    appendTranslate
+      (&c, FloatFloor, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* fceil(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueFloat);
+    Value* result = value(&c, ValueFloat);
+    appendTranslate
+      (&c, FloatCeiling, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* frint(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueFloat);
+    Value* result = value(&c, ValueFloat);
+    appendTranslate
+      (&c, FloatRound, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
   virtual void trap() {
     appendOperation(&c, Trap);
   }
@@ -6938,6 +7081,14 @@ class MyCompiler: public Compiler {
     return c.constantCount * TargetBytesPerWord;
   }
 
+  virtual unsigned spillCount() {
+    return c.spillCount;
+  }
+
+  virtual unsigned reloadCount() {
+    return c.reloadCount;
+  }
+
   virtual void write() {
     c.assembler->write();
 
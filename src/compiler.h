@@ -104,6 +104,11 @@ class Compiler {
                              OperandType resultType,
                              unsigned argumentFootprint) = 0;
 
+  // calls address with the thread register as its only argument if
+  // the word flagOffset bytes from the thread register is nonzero:
+  virtual void poll(int flagOffset, Operand* address,
+                    TraceHandler* traceHandler) = 0;
+
   virtual void return_(unsigned size, Operand* value) = 0;
 
   virtual void initLocal(unsigned size, unsigned index, OperandType type) = 0;
@@ -115,6 +120,7 @@ class Compiler {
 
   virtual void checkBounds(Operand* object, unsigned lengthOffset,
                            Operand* index, intptr_t handler) = 0;
+  virtual void nullCheck(Operand* object) = 0;
 
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst) = 0;
@@ -183,6 +189,12 @@ class Compiler {
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* f2i(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* i2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
+  virtual Operand* popcount(unsigned aSize, unsigned resSize, Operand* a) = 0;
+  virtual Operand* clz(unsigned aSize, unsigned resSize, Operand* a) = 0;
+  virtual Operand* ctz(unsigned aSize, unsigned resSize, Operand* a) = 0;
+  virtual Operand* ffloor(unsigned size, Operand* a) = 0;
+  virtual Operand* fceil(unsigned size, Operand* a) = 0;
+  virtual Operand* frint(unsigned size, Operand* a) = 0;
 
   virtual void trap() = 0;
 
@@ -194,6 +206,8 @@ class Compiler {
                        unsigned stackLimitOffset) = 0;
   virtual unsigned resolve(uint8_t* dst) = 0;
   virtual unsigned poolSize() = 0;
+  virtual unsigned spillCount() = 0;
+  virtual unsigned reloadCount() = 0;
   virtual void write() = 0;
 
   virtual void dispose() = 0;
@@ -217,7 +217,36 @@ enum OpCode {
   sipush = 0x11,
   swap = 0x5f,
   tableswitch = 0xaa,
-  wide = 0xc4
+  wide = 0xc4,
+
+  // rewritten forms of the instructions above, which the interpreter
+  // substitutes once they have been resolved.  These never appear in
+  // class files.
+  bgetfield_quick = 0xcb,
+  sgetfield_quick = 0xcc,
+  igetfield_quick = 0xcd,
+  lgetfield_quick = 0xce,
+  agetfield_quick = 0xcf,
+  bputfield_quick = 0xd0,
+  sputfield_quick = 0xd1,
+  iputfield_quick = 0xd2,
+  lputfield_quick = 0xd3,
+  aputfield_quick = 0xd4,
+  invokevirtual_quick = 0xd5,
+  ldc_quick = 0xd6,
+  ldc_w_quick = 0xd7,
+
+  // superinstructions, which replace the first opcode of a common
+  // sequence and execute the whole sequence:
+  aload_0_getfield = 0xd8,
+  aload_0_bgetfield_quick = 0xd9,
+  aload_0_sgetfield_quick = 0xda,
+  aload_0_igetfield_quick = 0xdb,
+  aload_0_lgetfield_quick = 0xdc,
+  aload_0_agetfield_quick = 0xdd,
+  iinc_goto = 0xde,
+  iload_iload_if_icmpge = 0xdf,
+  iload_iload_if_icmplt = 0xe0
 };
 
 enum TypeCode {
@@ -21,6 +21,19 @@ namespace {
 const bool DebugFind = false;
 const bool DebugStat = false;
 
+// With more than one element on the path, look names up in a merged
+// index built from every element's listing on first use instead of
+// asking each element in turn.
+const bool IndexPath = true;
+
+// Directories may change after the index is built, so a name the
+// index has never seen is still looked for in them.
+const bool ProbeDirectoriesOnMiss = true;
+
+// Deflated jar entries read more than once keep their inflated bytes,
+// up to this many per jar, least recently used first out.
+const unsigned InflatedCacheFootprint = 64 * 1024;
+
 class Element {
  public:
   class Iterator {
@@ -37,6 +50,7 @@ class Element {
                                 bool tryDirectory) = 0;
   virtual const char* urlPrefix() = 0;
   virtual const char* sourceUrl() = 0;
+  virtual bool mayChange() = 0;
   virtual void dispose() = 0;
 
   Element* next;
@@ -68,6 +82,7 @@ class DirectoryElement: public Element {
 
       if (last) {
         allocator->free(last, strlen(last) + 1);
+        last = 0;
       }
 
       if (directory) {
@@ -91,7 +106,15 @@ class DirectoryElement: public Element {
     }
 
     virtual void dispose() {
-      directory->dispose();
+      if (it) {
+        it->dispose();
+      }
+      if (last) {
+        allocator->free(last, strlen(last) + 1);
+      }
+      if (directory) {
+        directory->dispose();
+      }
       allocator->free(this, sizeof(*this));
     }
 
@@ -155,6 +178,10 @@ class DirectoryElement: public Element {
     return sourceUrl_;
   }
 
+  virtual bool mayChange() {
+    return true;
+  }
+
   virtual void dispose() {
     allocator->free(originalName, strlen(originalName) + 1);
     allocator->free(name, strlen(name) + 1);
@@ -237,15 +264,61 @@ class JarIndex {
     Deflated = 8
   };
 
+  class Inflated;
+
   class Node {
    public:
     Node(uint32_t hash, const uint8_t* entry, Node* next):
-      hash(hash), entry(entry), next(next)
+      hash(hash), entry(entry), next(next), inflated(0), read(false)
     { }
 
     uint32_t hash;
     const uint8_t* entry;
     Node* next;
+    Inflated* inflated;
+    bool read;
+  };
+
+  class Inflated {
+   public:
+    Inflated(Node* node, unsigned length):
+      node(node), previous(0), next(0), references(1), length(length)
+    { }
+
+    Node* node;
+    Inflated* previous;
+    Inflated* next;
+    unsigned references;
+    unsigned length;
+    uint8_t data[0];
+  };
+
+  class InflatedRegion: public System::Region {
+   public:
+    InflatedRegion(JarIndex* index, Inflated* inflated):
+      index(index), inflated(inflated)
+    { }
+
+    virtual const uint8_t* start() {
+      return inflated->data;
+    }
+
+    virtual size_t length() {
+      return inflated->length;
+    }
+
+    virtual void dispose() {
+      JarIndex* index = this->index;
+      Inflated* inflated = this->inflated;
+      index->allocator->free(this, sizeof(*this));
+
+      index->lock->acquire();
+      index->release(inflated);
+      index->lock->release();
+    }
+
+    JarIndex* index;
+    Inflated* inflated;
   };
 
   JarIndex(System* s, Allocator* allocator, unsigned capacity):
@@ -253,7 +326,11 @@ class JarIndex {
     allocator(allocator),
     capacity(capacity),
     position(0),
-    nodes(static_cast<Node*>(allocator->allocate(sizeof(Node) * capacity)))
+    nodes(static_cast<Node*>(allocator->allocate(sizeof(Node) * capacity))),
+    lock(0),
+    mostRecent(0),
+    leastRecent(0),
+    inflatedFootprint(0)
   {
     memset(table, 0, sizeof(Node*) * capacity);
   }
@@ -283,7 +360,7 @@ class JarIndex {
 
 	    p = endOfEntry(p);
 	  } else {
-	    return index;
+	    return index->init();
 	  }
 	}
       } else {
@@ -291,7 +368,12 @@ class JarIndex {
       }
     }
 
-    return index;
+    return index->init();
+  }
+
+  JarIndex* init() {
+    expect(s, s->success(s->make(&lock)));
+    return this;
   }
 
   JarIndex* add(uint32_t hash, const uint8_t* entry) {
@@ -334,26 +416,16 @@ class JarIndex {
       } break;
 
       case Deflated: {
+        System::Region* cached = findInflated(n, start);
+        if (cached) {
+          return cached;
+        }
+
         DataRegion* region = new
           (allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
           DataRegion(s, allocator, uncompressedSize(p));
           
-        z_stream zStream; memset(&zStream, 0, sizeof(z_stream));
-
-        zStream.next_in = const_cast<uint8_t*>(fileData(start +
-							localHeaderOffset(p)));
-        zStream.avail_in = compressedSize(p);
-        zStream.next_out = region->data;
-        zStream.avail_out = region->length();
-
-        // -15 means max window size and raw deflate (no zlib wrapper)
-        int r = inflateInit2(&zStream, -15);
-        expect(s, r == Z_OK);
-
-        r = inflate(&zStream, Z_FINISH);
-        expect(s, r == Z_STREAM_END);
-
-        inflateEnd(&zStream);
+        inflateEntry(s, p, start, region->data, region->length());
 
         return region;
       } break;
@@ -366,6 +438,117 @@ class JarIndex {
     return 0;
   }
 
+  static void inflateEntry(System* s, const uint8_t* p, const uint8_t* start,
+                           uint8_t* data, unsigned length)
+  {
+    z_stream zStream; memset(&zStream, 0, sizeof(z_stream));
+
+    zStream.next_in = const_cast<uint8_t*>(fileData(start +
+                                                    localHeaderOffset(p)));
+    zStream.avail_in = compressedSize(p);
+    zStream.next_out = data;
+    zStream.avail_out = length;
+
+    // -15 means max window size and raw deflate (no zlib wrapper)
+    int r = inflateInit2(&zStream, -15);
+    expect(s, r == Z_OK);
+
+    r = inflate(&zStream, Z_FINISH);
+    expect(s, r == Z_STREAM_END);
+
+    inflateEnd(&zStream);
+  }
+
+  // Returns a region sharing the cached inflated bytes of the entry
+  // for the specified node, inflating them into the cache if this is
+  // not the first time the entry has been read.  Returns null if the
+  // caller should inflate a private copy instead.
+  System::Region* findInflated(Node* n, const uint8_t* start) {
+    unsigned length = uncompressedSize(n->entry);
+    if (length > InflatedCacheFootprint / 4) {
+      return 0;
+    }
+
+    lock->acquire();
+
+    Inflated* inflated = n->inflated;
+    if (inflated) {
+      unlink(inflated);
+      link(inflated);
+      ++ inflated->references;
+    } else if (not n->read) {
+      n->read = true;
+    } else {
+      lock->release();
+
+      Inflated* fresh = new
+        (allocator->allocate(sizeof(Inflated) + length))
+        Inflated(n, length);
+
+      inflateEntry(s, n->entry, start, fresh->data, length);
+
+      lock->acquire();
+
+      if (n->inflated) {
+        // another thread got here first
+        allocator->free(fresh, sizeof(Inflated) + length);
+      } else {
+        n->inflated = fresh;
+        link(fresh);
+        inflatedFootprint += length;
+
+        while (inflatedFootprint > InflatedCacheFootprint) {
+          evict(leastRecent);
+        }
+      }
+
+      inflated = n->inflated;
+      ++ inflated->references;
+    }
+
+    lock->release();
+
+    return inflated ? new (allocator->allocate(sizeof(InflatedRegion)))
+      InflatedRegion(this, inflated) : 0;
+  }
+
+  void link(Inflated* inflated) {
+    inflated->previous = 0;
+    inflated->next = mostRecent;
+    if (mostRecent) {
+      mostRecent->previous = inflated;
+    } else {
+      leastRecent = inflated;
+    }
+    mostRecent = inflated;
+  }
+
+  void unlink(Inflated* inflated) {
+    if (inflated->previous) {
+      inflated->previous->next = inflated->next;
+    } else {
+      mostRecent = inflated->next;
+    }
+    if (inflated->next) {
+      inflated->next->previous = inflated->previous;
+    } else {
+      leastRecent = inflated->previous;
+    }
+  }
+
+  void evict(Inflated* inflated) {
+    unlink(inflated);
+    inflated->node->inflated = 0;
+    inflatedFootprint -= inflated->length;
+    release(inflated);
+  }
+
+  void release(Inflated* inflated) {
+    if (-- inflated->references == 0) {
+      allocator->free(inflated, sizeof(Inflated) + inflated->length);
+    }
+  }
+
   System::FileType stat(const char* name, unsigned* length, bool tryDirectory)
   {
     Node* node = findNode(name);
@@ -395,6 +578,12 @@ class JarIndex {
   }
 
   void dispose() {
+    while (leastRecent) {
+      evict(leastRecent);
+    }
+    if (lock) {
+      lock->dispose();
+    }
     allocator->free(nodes, sizeof(Node) * capacity);
     allocator->free(this, sizeof(*this) + (sizeof(Node*) * capacity));
   }
@@ -405,6 +594,10 @@ class JarIndex {
   unsigned position;
   
   Node* nodes;
+  System::Mutex* lock;
+  Inflated* mostRecent;
+  Inflated* leastRecent;
+  unsigned inflatedFootprint;
   Node* table[0];
 };
 
@@ -417,7 +610,7 @@ class JarElement: public Element {
     { }
 
     virtual const char* next(unsigned* size) {
-      if (position < index->position) {
+      if (index and position < index->position) {
         JarIndex::Node* n = index->nodes + (position++);
         *size = fileNameLength(n->entry);
         return reinterpret_cast<const char*>(fileName(n->entry));
@@ -519,6 +712,10 @@ class JarElement: public Element {
     return sourceUrl_;
   }
 
+  virtual bool mayChange() {
+    return false;
+  }
+
   virtual void dispose() {
     dispose(sizeof(*this));
   }
@@ -819,6 +1016,145 @@ parsePath(System* s, Allocator* allocator, const char* path,
   return first;
 }
 
+class PathIndex {
+ public:
+  class Node {
+   public:
+    Node(uint32_t hash, Element* element, unsigned length, Node* next):
+      hash(hash), element(element), length(length), next(next)
+    { }
+
+    uint32_t hash;
+    Element* element;
+    unsigned length;
+    Node* next;
+    char name[0];
+  };
+
+  PathIndex(System* s, Allocator* allocator, unsigned capacity):
+    s(s),
+    allocator(allocator),
+    capacity(capacity),
+    count(0),
+    table(static_cast<Node**>(allocator->allocate(sizeof(Node*) * capacity)))
+  {
+    memset(table, 0, sizeof(Node*) * capacity);
+  }
+
+  static PathIndex* make(System* s, Allocator* allocator, Element* path) {
+    PathIndex* index = new (allocator->allocate(sizeof(PathIndex)))
+      PathIndex(s, allocator, 1024);
+
+    for (Element* e = path; e; e = e->next) {
+      Element::Iterator* it = e->iterator();
+      unsigned length;
+      for (const char* name = it->next(&length); name;
+           name = it->next(&length))
+      {
+        index->add(name, length, e);
+      }
+      it->dispose();
+    }
+
+    if (DebugFind) {
+      fprintf(stderr, "indexed %d names\n", index->count);
+    }
+
+    return index;
+  }
+
+  static void trim(const char** name, unsigned* length) {
+    while (*length and **name == '/') {
+      ++ (*name);
+      -- (*length);
+    }
+
+    // jar directory entries end with a slash
+    while (*length and (*name)[*length - 1] == '/') {
+      -- (*length);
+    }
+  }
+
+  void add(const char* name, unsigned length, Element* element) {
+    trim(&name, &length);
+
+    uint32_t h = hash(reinterpret_cast<const uint8_t*>(name), length);
+    if (findNode(h, name, length)) {
+      // an earlier element shadows this one
+      return;
+    }
+
+    if (count >= capacity) {
+      grow();
+    }
+
+    unsigned i = h & (capacity - 1);
+    Node* n = new (allocator->allocate(sizeof(Node) + length))
+      Node(h, element, length, table[i]);
+    memcpy(n->name, name, length);
+    table[i] = n;
+    ++ count;
+  }
+
+  void grow() {
+    unsigned newCapacity = capacity * 2;
+    Node** newTable = static_cast<Node**>
+      (allocator->allocate(sizeof(Node*) * newCapacity));
+    memset(newTable, 0, sizeof(Node*) * newCapacity);
+
+    for (unsigned i = 0; i < capacity; ++i) {
+      for (Node* n = table[i]; n;) {
+        Node* next = n->next;
+        unsigned j = n->hash & (newCapacity - 1);
+        n->next = newTable[j];
+        newTable[j] = n;
+        n = next;
+      }
+    }
+
+    allocator->free(table, sizeof(Node*) * capacity);
+    table = newTable;
+    capacity = newCapacity;
+  }
+
+  Node* findNode(uint32_t h, const char* name, unsigned length) {
+    for (Node* n = table[h & (capacity - 1)]; n; n = n->next) {
+      if (n->hash == h and equal(name, length, n->name, n->length)) {
+        return n;
+      }
+    }
+    return 0;
+  }
+
+  Element* find(const char* name) {
+    unsigned length = strlen(name);
+    trim(&name, &length);
+
+    Node* n = findNode
+      (hash(reinterpret_cast<const uint8_t*>(name), length), name, length);
+
+    return n ? n->element : 0;
+  }
+
+  void dispose() {
+    for (unsigned i = 0; i < capacity; ++i) {
+      for (Node* n = table[i]; n;) {
+        Node* next = n->next;
+        allocator->free(n, sizeof(Node) + n->length);
+        n = next;
+      }
+    }
+    allocator->free(table, sizeof(Node*) * capacity);
+    allocator->free(this, sizeof(*this));
+  }
+
+  System* s;
+  Allocator* allocator;
+  unsigned capacity;
+  unsigned count;
+  Node** table;
+};
+
 class MyIterator: public Finder::IteratorImp {
  public:
   MyIterator(System* s, Allocator* allocator, Element* path):
@@ -862,8 +1198,11 @@ class MyFinder: public Finder {
     system(system),
     allocator(allocator),
     path_(parsePath(system, allocator, path, bootLibrary)),
-    pathString(copy(allocator, path))
-  { }
+    pathString(copy(allocator, path)),
+    index(0)
+  {
+    init();
+  }
 
   MyFinder(System* system, Allocator* allocator, const uint8_t* jarData,
            unsigned jarLength):
@@ -871,8 +1210,39 @@ class MyFinder: public Finder {
     allocator(allocator),
     path_(new (allocator->allocate(sizeof(JarElement)))
           JarElement(system, allocator, jarData, jarLength)),
-    pathString(0)
-  { }
+    pathString(0),
+    index(0)
+  {
+    init();
+  }
+
+  void init() {
+    if (IndexPath and path_ and path_->next) {
+      expect(system, system->success(system->make(&lock)));
+    } else {
+      lock = 0;
+    }
+  }
+
+  // Returns the first element the index lists for the specified name,
+  // or null if the name is not indexed.  Sets *used to whether the
+  // index was consulted at all.
+  Element* lookup(const char* name, bool* used) {
+    if (lock) {
+      lock->acquire();
+      if (index == 0) {
+        index = PathIndex::make(system, allocator, path_);
+      }
+      Element* e = index->find(name);
+      lock->release();
+
+      *used = true;
+      return e;
+    } else {
+      *used = false;
+      return 0;
+    }
+  }
 
   virtual IteratorImp* iterator() {
     return new (allocator->allocate(sizeof(MyIterator)))
@@ -880,6 +1250,27 @@ class MyFinder: public Finder {
   }
 
   virtual System::Region* find(const char* name) {
+    bool used;
+    Element* hit = lookup(name, &used);
+    if (hit) {
+      System::Region* r = hit->find(name);
+      if (r) {
+        return r;
+      }
+    } else if (used) {
+      if (ProbeDirectoriesOnMiss) {
+        for (Element* e = path_; e; e = e->next) {
+          if (e->mayChange()) {
+            System::Region* r = e->find(name);
+            if (r) {
+              return r;
+            }
+          }
+        }
+      }
+      return 0;
+    }
+
     for (Element* e = path_; e; e = e->next) {
       System::Region* r = e->find(name);
       if (r) {
@@ -890,41 +1281,62 @@ class MyFinder: public Finder {
     return 0;
   }
 
-  virtual System::FileType stat(const char* name, unsigned* length,
-                                bool tryDirectory)
+  Element* element(const char* name, unsigned* length, bool tryDirectory,
+                   System::FileType* type)
   {
-    for (Element* e = path_; e; e = e->next) {
-      System::FileType type = e->stat(name, length, tryDirectory);
-      if (type != System::TypeDoesNotExist) {
-        return type;
+    bool used;
+    Element* hit = lookup(name, &used);
+    if (hit) {
+      *type = hit->stat(name, length, tryDirectory);
+      if (*type != System::TypeDoesNotExist) {
+        return hit;
+      }
+    } else if (used) {
+      if (ProbeDirectoriesOnMiss) {
+        for (Element* e = path_; e; e = e->next) {
+          if (e->mayChange()) {
+            *type = e->stat(name, length, tryDirectory);
+            if (*type != System::TypeDoesNotExist) {
+              return e;
+            }
+          }
+        }
       }
+      *type = System::TypeDoesNotExist;
+      return 0;
     }
-    
-    return System::TypeDoesNotExist;
-  }
 
-  virtual const char* urlPrefix(const char* name) {
     for (Element* e = path_; e; e = e->next) {
-      unsigned length;
-      System::FileType type = e->stat(name, &length, true);
-      if (type != System::TypeDoesNotExist) {
-        return e->urlPrefix();
+      *type = e->stat(name, length, tryDirectory);
+      if (*type != System::TypeDoesNotExist) {
+        return e;
       }
     }
 
+    *type = System::TypeDoesNotExist;
     return 0;
   }
 
-  virtual const char* sourceUrl(const char* name) {
-    for (Element* e = path_; e; e = e->next) {
-      unsigned length;
-      System::FileType type = e->stat(name, &length, true);
-      if (type != System::TypeDoesNotExist) {
-        return e->sourceUrl();
-      }
-    }
+  virtual System::FileType stat(const char* name, unsigned* length,
+                                bool tryDirectory)
+  {
+    System::FileType type;
+    element(name, length, tryDirectory, &type);
+    return type;
+  }
 
-    return 0;
+  virtual const char* urlPrefix(const char* name) {
+    unsigned length;
+    System::FileType type;
+    Element* e = element(name, &length, true, &type);
+    return e ? e->urlPrefix() : 0;
+  }
+
+  virtual const char* sourceUrl(const char* name) {
+    unsigned length;
+    System::FileType type;
+    Element* e = element(name, &length, true, &type);
+    return e ? e->sourceUrl() : 0;
   }
 
   virtual const char* path() {
@@ -932,6 +1344,12 @@ class MyFinder: public Finder {
   }
 
   virtual void dispose() {
+    if (index) {
+      index->dispose();
+    }
+    if (lock) {
+      lock->dispose();
+    }
     for (Element* e = path_; e;) {
       Element* t = e;
       e = e->next;
@@ -947,6 +1365,8 @@ class MyFinder: public Finder {
   Allocator* allocator;
   Element* path_;
   const char* pathString;
+  System::Mutex* lock;
+  PathIndex* index;
 };
 
 } // namespace
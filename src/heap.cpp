@@ -26,6 +26,25 @@ const unsigned InitialTenuredFixieCeilingInBytes = 4 * 1024 * 1024;
 
 const unsigned LowMemoryPaddingInBytes = 1024 * 1024;
 
+// the percentage of gen2 left free when it is resized by a major
+// collection, unless overridden with Heap::setFreeRatio:
+const unsigned DefaultFreeRatio = 50;
+const unsigned MaximumFreeRatio = 90;
+
+// with a pause goal, the young generation ranges between these
+// percentages of the size the client would otherwise let it reach,
+// and the tenure threshold drops when more than HighSurvivalRatio
+// percent of it survives a slow minor collection, and rises again
+// when less than LowSurvivalRatio percent survives a fast one:
+const unsigned MinimumYoungRatio = 10;
+const unsigned MaximumYoungRatio = 100;
+const unsigned HighSurvivalRatio = 50;
+const unsigned LowSurvivalRatio = 10;
+
+// segments smaller than this are unlikely to contain a whole huge
+// page, so they are not advised to use them:
+const unsigned HugePageSizeInBytes = 2 * 1024 * 1024;
+
 const bool Verbose = false;
 const bool Verbose2 = false;
 const bool Debug = false;
@@ -60,9 +79,16 @@ void NO_RETURN abort(Context*);
 void assert(Context*, bool);
 #endif
 
-void* tryAllocate(Context* c, unsigned size);
-void* allocate(Context* c, unsigned size);
-void free(Context* c, const void* p, unsigned size);
+void* tryAllocate(Context* c, unsigned size,
+                  Heap::MemoryCategory category = Heap::OtherMemory,
+                  unsigned mapSize = 0);
+void* allocate(Context* c, unsigned size,
+               Heap::MemoryCategory category = Heap::OtherMemory,
+               unsigned mapSize = 0);
+void free(Context* c, const void* p, unsigned size,
+          Heap::MemoryCategory category = Heap::OtherMemory,
+          unsigned mapSize = 0);
+void adviseHugePages(Context* c, void* p, unsigned size);
 
 #ifdef USE_ATOMIC_OPERATIONS
 inline void
@@ -348,7 +374,8 @@ class Segment {
       capacity_ = desired;
       while (data == 0) {
         data = static_cast<uintptr_t*>
-          (tryAllocate(context, (footprint(capacity_)) * BytesPerWord));
+          (tryAllocate(context, (footprint(capacity_)) * BytesPerWord,
+                       Heap::SegmentMemory, mapSize(capacity_)));
 
         if (data == 0) {
           if (capacity_ > minimum) {
@@ -359,11 +386,16 @@ class Segment {
           } else {
             data = static_cast<uintptr_t*>
               (local::allocate
-               (context, (footprint(capacity_)) * BytesPerWord));
+               (context, (footprint(capacity_)) * BytesPerWord,
+                Heap::SegmentMemory, mapSize(capacity_)));
           }
         }
       }
 
+      if (data) {
+        adviseHugePages(context, data, footprint(capacity_) * BytesPerWord);
+      }
+
       if (map) {
         map->init();
       }
@@ -388,6 +420,12 @@ class Segment {
       + (map and capacity ? map->calculateFootprint(capacity) : 0);
   }
 
+  // the number of bytes of a segment of the specified capacity which
+  // are used by its maps rather than its objects:
+  unsigned mapSize(unsigned capacity) {
+    return (footprint(capacity) - capacity) * BytesPerWord;
+  }
+
   unsigned capacity() {
     return capacity_;
   }
@@ -402,7 +440,8 @@ class Segment {
 
   void replaceWith(Segment* s) {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      free(context, data, (footprint(capacity())) * BytesPerWord,
+           Heap::SegmentMemory, mapSize(capacity()));
     }
     data = s->data;
     s->data = 0;
@@ -454,7 +493,8 @@ class Segment {
 
   void dispose() {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      free(context, data, (footprint(capacity())) * BytesPerWord,
+           Heap::SegmentMemory, mapSize(capacity()));
     }
     data = 0;
     map = 0;
@@ -602,6 +642,25 @@ fixie(void* body)
 void
 free(Context* c, Fixie** fixies, bool resetImmortal = false);
 
+// allocates from the heap, accounting what it allocates to a category:
+class CategoryAllocator: public Allocator {
+ public:
+  virtual void* tryAllocate(unsigned size) {
+    return local::tryAllocate(c, size, category);
+  }
+
+  virtual void* allocate(unsigned size) {
+    return local::allocate(c, size, category);
+  }
+
+  virtual void free(const void* p, unsigned size) {
+    local::free(c, p, size, category);
+  }
+
+  Context* c;
+  Heap::MemoryCategory category;
+};
+
 class Context {
  public:
   Context(System* system, unsigned limit):
@@ -614,6 +673,8 @@ class Context {
     
     immortalHeapStart(0),
     immortalHeapEnd(0),
+    hugePages(false),
+    freeRatio(DefaultFreeRatio),
 
     ageMap(&gen1, max(1, log(TenureThreshold)), 1, 0, false),
     gen1(this, &ageMap, 0, 0),
@@ -635,6 +696,7 @@ class Context {
     gen2Base(0),
     incomingFootprint(0),
     tenureFootprint(0),
+    tenureThreshold(TenureThreshold),
     gen1Padding(0),
     tenurePadding(0),
     gen2Padding(0),
@@ -643,6 +705,7 @@ class Context {
     untenuredFixieFootprint(0),
     tenuredFixieFootprint(0),
     tenuredFixieCeiling(InitialTenuredFixieCeilingInBytes),
+    promotionFootprint(0),
 
     mode(Heap::MinorCollection),
 
@@ -654,8 +717,24 @@ class Context {
 
     lastCollectionTime(system->now()),
     totalCollectionTime(0),
-    totalTime(0)
+    totalTime(0),
+
+    pauseGoal(0),
+    overheadGoal(0),
+    youngRatio(MaximumYoungRatio),
+    lastCollectionEnd(system->nowMicroseconds()),
+
+    statistics()
   {
+    memset(ageFootprints, 0, sizeof(ageFootprints));
+
+    memset(memoryUsage, 0, sizeof(memoryUsage));
+    memset(&totalMemoryUsage, 0, sizeof(totalMemoryUsage));
+    for (unsigned i = 0; i < Heap::MemoryCategoryCount; ++i) {
+      allocators[i].c = this;
+      allocators[i].category = static_cast<Heap::MemoryCategory>(i);
+    }
+
     if (not system->success(system->make(&lock))) {
       system->abort();
     }
@@ -687,6 +766,9 @@ class Context {
   uintptr_t* immortalHeapStart;
   uintptr_t* immortalHeapEnd;
 
+  bool hugePages;
+  unsigned freeRatio;
+
   Segment::Map ageMap;
   Segment gen1;
 
@@ -707,6 +789,8 @@ class Context {
   
   unsigned incomingFootprint;
   unsigned tenureFootprint;
+  unsigned ageFootprints[TenureThreshold + 1];
+  unsigned tenureThreshold;
   unsigned gen1Padding;
   unsigned tenurePadding;
   unsigned gen2Padding;
@@ -715,6 +799,7 @@ class Context {
   unsigned untenuredFixieFootprint;
   unsigned tenuredFixieFootprint;
   unsigned tenuredFixieCeiling;
+  unsigned promotionFootprint;
 
   Heap::CollectionType mode;
 
@@ -727,6 +812,17 @@ class Context {
   int64_t lastCollectionTime;
   int64_t totalCollectionTime;
   int64_t totalTime;
+
+  unsigned pauseGoal;
+  unsigned overheadGoal;
+  unsigned youngRatio;
+  int64_t lastCollectionEnd;
+
+  Heap::Statistics statistics;
+
+  Heap::MemoryUsage memoryUsage[Heap::MemoryCategoryCount];
+  Heap::MemoryUsage totalMemoryUsage;
+  CategoryAllocator allocators[Heap::MemoryCategoryCount];
 };
 
 const char*
@@ -773,11 +869,16 @@ minimumNextGen2Capacity(Context* c)
     + c->gen2Padding;
 }
 
+// Returns true if gen2 is well past the size a major collection
+// would give it, in that more of it is free than halfway between the
+// free ratio and 100%.
 inline bool
 oversizedGen2(Context* c)
 {
-  return c->gen2.capacity() > (InitialGen2CapacityInBytes / BytesPerWord)
-    and c->gen2.position() < (c->gen2.capacity() / 4);
+  uint64_t capacity = c->gen2.capacity();
+  return capacity > (InitialGen2CapacityInBytes / BytesPerWord)
+    and (capacity - c->gen2.position()) * 200
+    > capacity * (100 + c->freeRatio);
 }
 
 inline unsigned
@@ -829,7 +930,7 @@ initNextGen2(Context* c)
   unsigned desired = minimum;
 
   if (not (lowMemory(c) or oversizedGen2(c))) {
-    desired *= 2;
+    desired = (static_cast<uint64_t>(minimum) * 100) / (100 - c->freeRatio);
   }
 
   if (desired < InitialGen2CapacityInBytes / BytesPerWord) {
@@ -904,7 +1005,7 @@ free(Context* c, Fixie** fixies, bool resetImmortal)
       if (DebugFixies) {
         fprintf(stderr, "free fixie %p\n", f);
       }
-      free(c, f, f->totalSize());
+      free(c, f, f->totalSize(), Heap::FixieMemory);
     }
   }
 }
@@ -1013,7 +1114,9 @@ copy2(Context* c, void* o)
     return copyTo(c, &(c->nextGen2), o, size);
   } else if (c->gen1.contains(o)) {
     unsigned age = c->ageMap.get(o);
-    if (age == TenureThreshold) {
+    if (age >= c->tenureThreshold) {
+      c->promotionFootprint += size;
+
       if (c->mode == Heap::MinorCollection) {
         assert(c, c->gen2.remaining() >= size);
 
@@ -1029,7 +1132,8 @@ copy2(Context* c, void* o)
       o = copyTo(c, &(c->nextGen1), o, size);
 
       c->nextAgeMap.setOnly(o, age + 1);
-      if (age + 1 == TenureThreshold) {
+      c->ageFootprints[age + 1] += size;
+      if (age + 1 >= c->tenureThreshold) {
         c->tenureFootprint += size;
       }
 
@@ -1639,7 +1743,9 @@ collect2(Context* c)
 {
   c->gen2Base = Top;
   c->tenureFootprint = 0;
+  memset(c->ageFootprints, 0, sizeof(c->ageFootprints));
   c->fixieTenureFootprint = 0;
+  c->promotionFootprint = 0;
   c->gen1Padding = 0;
   c->tenurePadding = 0;
 
@@ -1673,6 +1779,63 @@ collect2(Context* c)
   c->client->visitRoots(&v);
 }
 
+void
+setTenureThreshold(Context* c, unsigned threshold)
+{
+  c->tenureThreshold = threshold;
+
+  // every object in gen1 was copied there by the last collection,
+  // which recorded its new age, so we know exactly which will be
+  // tenured by the next one:
+  c->tenureFootprint = 0;
+  for (unsigned i = threshold; i <= TenureThreshold; ++i) {
+    c->tenureFootprint += c->ageFootprints[i];
+  }
+}
+
+// Adjusts the young generation size and tenure threshold after a
+// minor collection so as to keep pauses under the pause goal while
+// spending no more than the overhead goal in collections: smaller
+// young generations mean shorter pauses but more frequent
+// collections, and tenuring long-lived objects sooner saves copying
+// them again and again.
+void
+adaptToPauseGoal(Context* c)
+{
+  Heap::Statistics* s = &(c->statistics);
+  int64_t now = c->system->nowMicroseconds();
+  int64_t run = now - c->lastCollectionEnd - s->pause;
+  c->lastCollectionEnd = now;
+
+  if (c->pauseGoal == 0 or s->type != Heap::MinorCollection) {
+    return;
+  }
+
+  uint64_t young = s->gen1Before + (c->incomingFootprint * BytesPerWord);
+  unsigned survival = young
+    ? ((s->gen1After + s->promoted) * static_cast<uint64_t>(100)) / young
+    : 0;
+
+  unsigned overhead = run > 0 ? (s->pause * 100) / (s->pause + run) : 100;
+
+  if (s->pause > c->pauseGoal) {
+    c->youngRatio = max((c->youngRatio * 3) / 4, MinimumYoungRatio);
+
+    if (survival > HighSurvivalRatio and c->tenureThreshold > 1) {
+      setTenureThreshold(c, c->tenureThreshold - 1);
+    }
+  } else if (s->pause * 2 < c->pauseGoal) {
+    if (overhead > c->overheadGoal) {
+      c->youngRatio = min(((c->youngRatio * 5) / 4) + 1, MaximumYoungRatio);
+    }
+
+    if (survival < LowSurvivalRatio and c->tenureThreshold < TenureThreshold)
+    {
+      setTenureThreshold(c, c->tenureThreshold + 1);
+    }
+  }
+}
+
 void
 collect(Context* c)
 {
@@ -1709,6 +1872,10 @@ collect(Context* c)
     then = c->system->now();
   }
 
+  int64_t start = c->system->nowMicroseconds();
+  unsigned gen1Before = c->gen1.position();
+  unsigned gen2Before = c->gen2.position();
+
   unsigned count = memoryNeeded(c);
   if (count > c->lowMemoryThreshold) {
     if (Verbose) {
@@ -1743,6 +1910,25 @@ collect(Context* c)
 
   sweepFixies(c);
 
+  if (c->mode == Heap::MajorCollection) {
+    // the old gen2 and any fixies swept above have been freed, so
+    // give what we can back to the system:
+    c->system->releaseFreeMemory();
+  }
+
+  Heap::Statistics* s = &(c->statistics);
+  s->type = c->mode;
+  s->pause = c->system->nowMicroseconds() - start;
+  s->gen1Before = gen1Before * BytesPerWord;
+  s->gen1After = c->gen1.position() * BytesPerWord;
+  s->gen2Before = gen2Before * BytesPerWord;
+  s->gen2After = c->gen2.position() * BytesPerWord;
+  s->promoted = c->promotionFootprint * BytesPerWord;
+  s->untenuredFixies = c->untenuredFixieFootprint;
+  s->tenuredFixies = c->tenuredFixieFootprint;
+
+  adaptToPauseGoal(c);
+
   if (Verbose) {
     int64_t now = c->system->now();
     int64_t collection = now - then;
@@ -1781,8 +1967,27 @@ collect(Context* c)
   }
 }
 
+// adds delta bytes to the specified category, which must be done
+// while holding the heap lock
+void
+account(Context* c, Heap::MemoryCategory category, int delta)
+{
+  Heap::MemoryUsage* u = c->memoryUsage + category;
+  u->current += delta;
+  if (u->current > u->peak) {
+    u->peak = u->current;
+  }
+
+  Heap::MemoryUsage* total = &(c->totalMemoryUsage);
+  total->current += delta;
+  if (total->current > total->peak) {
+    total->peak = total->current;
+  }
+}
+
 void*
-allocate(Context* c, unsigned size, bool limit)
+allocate(Context* c, unsigned size, bool limit,
+         Heap::MemoryCategory category, unsigned mapSize)
 {
   ACQUIRE(c->lock);
 
@@ -1794,6 +1999,9 @@ allocate(Context* c, unsigned size, bool limit)
     void* p = c->system->tryAllocate(size);
     if (p) {
       c->count += size;
+
+      account(c, Heap::SegmentMapMemory, mapSize);
+      account(c, category, size - mapSize);
       
       if (DebugAllocation) {
         static_cast<uintptr_t*>(p)[0] = 0x22377322;
@@ -1808,22 +2016,25 @@ allocate(Context* c, unsigned size, bool limit)
 }
 
 void*
-tryAllocate(Context* c, unsigned size)
+tryAllocate(Context* c, unsigned size, Heap::MemoryCategory category,
+            unsigned mapSize)
 {
-  return allocate(c, size, true);
+  return allocate(c, size, true, category, mapSize);
 }
 
 void*
-allocate(Context* c, unsigned size)
+allocate(Context* c, unsigned size, Heap::MemoryCategory category,
+         unsigned mapSize)
 {
-  void* p = allocate(c, size, false);
+  void* p = allocate(c, size, false, category, mapSize);
   expect(c->system, p);
 
   return p;
 }
 
 void
-free(Context* c, const void* p, unsigned size)
+free(Context* c, const void* p, unsigned size, Heap::MemoryCategory category,
+     unsigned mapSize)
 {
   ACQUIRE(c->lock);
 
@@ -1844,6 +2055,17 @@ free(Context* c, const void* p, unsigned size)
 
   c->system->free(p);
   c->count -= size;
+
+  account(c, Heap::SegmentMapMemory, - static_cast<int>(mapSize));
+  account(c, category, - static_cast<int>(size - mapSize));
+}
+
+void
+adviseHugePages(Context* c, void* p, unsigned size)
+{
+  if (c->hugePages and size >= HugePageSizeInBytes) {
+    c->system->adviseHugePages(p, size);
+  }
 }
 
 void
@@ -1868,6 +2090,26 @@ class MyHeap: public Heap {
     c.immortalHeapEnd = start + sizeInWords;
   }
 
+  virtual void setHugePages(bool value) {
+    c.hugePages = value;
+  }
+
+  virtual void setFreeRatio(unsigned percent) {
+    c.freeRatio = min(percent, MaximumFreeRatio);
+  }
+
+  virtual void setPauseGoal(unsigned pauseInMicroseconds,
+                            unsigned overheadPercent)
+  {
+    c.pauseGoal = pauseInMicroseconds;
+    c.overheadGoal = overheadPercent;
+  }
+
+  virtual unsigned youngGenerationSize(unsigned maximum) {
+    return (static_cast<uint64_t>(maximum) * c.youngRatio)
+      / MaximumYoungRatio;
+  }
+
   virtual unsigned limit() {
     return c.limit;
   }
@@ -1905,6 +2147,12 @@ class MyHeap: public Heap {
       return 0;
     }
 
+    // fixies are freed by this heap when they die, so account those
+    // allocated from it as such:
+    if (allocator == this) {
+      allocator = &(c.allocators[FixieMemory]);
+    }
+
     unsigned total = Fixie::totalSize(sizeInWords, objectMask);
     void* p = allocator->tryAllocate(total);
     if (p == 0) {
@@ -2008,7 +2256,7 @@ class MyHeap: public Heap {
 
   virtual void pad(void* p) {
     if (c.gen1.contains(p)) {
-      if (c.ageMap.get(p) == TenureThreshold) {
+      if (c.ageMap.get(p) >= c.tenureThreshold) {
         ++ c.tenurePadding;
       } else {
         ++ c.gen1Padding;
@@ -2072,6 +2320,27 @@ class MyHeap: public Heap {
     return c.mode;
   }
 
+  virtual const Statistics* statistics() {
+    return &(c.statistics);
+  }
+
+  virtual Allocator* allocator(MemoryCategory category) {
+    return &(c.allocators[category]);
+  }
+
+  virtual void account(MemoryCategory category, int delta) {
+    ACQUIRE(c.lock);
+
+    local::account(&c, category, delta);
+  }
+
+  virtual void memoryUsage(MemoryUsage* categories, MemoryUsage* total) {
+    ACQUIRE(c.lock);
+
+    memcpy(categories, c.memoryUsage, sizeof(c.memoryUsage));
+    *total = c.totalMemoryUsage;
+  }
+
   virtual void disposeFixies() {
     c.disposeFixies();
   }
@@ -16,8 +16,9 @@
 
 namespace vm {
 
-// an object must survive TenureThreshold + 2 garbage collections
-// before being copied to gen2 (must be at least 1):
+// an object must survive at most TenureThreshold + 2 garbage
+// collections before being copied to gen2 (must be at least 1).  The
+// heap may lower the threshold to meet a pause goal:
 const unsigned TenureThreshold = 3;
 
 const unsigned FixieTenureThreshold = TenureThreshold + 2;
@@ -46,6 +47,45 @@ class Heap: public Allocator {
     virtual bool visit(unsigned) = 0;
   };
 
+  // a summary of the most recent collection, with the sizes in bytes
+  // and the pause in microseconds:
+  class Statistics {
+   public:
+    CollectionType type;
+    int64_t pause;
+    unsigned gen1Before;
+    unsigned gen1After;
+    unsigned gen2Before;
+    unsigned gen2After;
+    unsigned promoted;
+    unsigned untenuredFixies;
+    unsigned tenuredFixies;
+  };
+
+  // native memory allocated by or through the heap is accounted to
+  // one of these categories:
+  enum MemoryCategory {
+    SegmentMemory,
+    SegmentMapMemory,
+    FixieMemory,
+    ZoneMemory,
+    CodeMemory,
+    ClassMemory,
+    JniMemory,
+    ThreadMemory,
+    FinderMemory,
+    OtherMemory,
+    MemoryCategoryCount
+  };
+
+  // the number of bytes currently allocated in a category, and the
+  // most which have been allocated at any one time:
+  class MemoryUsage {
+   public:
+    uintptr_t current;
+    uintptr_t peak;
+  };
+
   class Client {
    public:
     virtual void collect(void* context, CollectionType type) = 0;
@@ -59,6 +99,11 @@ class Heap: public Allocator {
 
   virtual void setClient(Client* client) = 0;
   virtual void setImmortalHeap(uintptr_t* start, unsigned sizeInWords) = 0;
+  virtual void setHugePages(bool value) = 0;
+  virtual void setFreeRatio(unsigned percent) = 0;
+  virtual void setPauseGoal(unsigned pauseInMicroseconds,
+                            unsigned overheadPercent) = 0;
+  virtual unsigned youngGenerationSize(unsigned maximum) = 0;
   virtual unsigned limit() = 0;
   virtual bool limitExceeded() = 0;
   virtual void collect(CollectionType type, unsigned footprint) = 0;
@@ -73,6 +118,10 @@ class Heap: public Allocator {
   virtual void postVisit() = 0;
   virtual Status status(void* p) = 0;
   virtual CollectionType collectionType() = 0;
+  virtual const Statistics* statistics() = 0;
+  virtual Allocator* allocator(MemoryCategory category) = 0;
+  virtual void account(MemoryCategory category, int delta) = 0;
+  virtual void memoryUsage(MemoryUsage* categories, MemoryUsage* total) = 0;
   virtual void disposeFixies() = 0;
   virtual void dispose() = 0;
 };
@@ -10,6 +10,7 @@
 
 #include "machine.h"
 #include "heapwalk.h"
+#include "zlib-custom.h"
 
 using namespace vm;
 
@@ -25,28 +26,109 @@ enum {
   Pop
 };
 
+const unsigned BufferSizeInBytes = 256 * 1024;
+
+// Collects the dump in a large buffer which is written out, through
+// a gzip stream if requested, each time it fills.  The heap is
+// dumped with the world stopped, so the fewer and larger the writes,
+// the shorter the pause:
+class Output {
+ public:
+  Output(Thread* t, FILE* out, bool compress):
+    t(t),
+    out(out),
+    buffer(static_cast<uint8_t*>
+           (t->m->heap->allocate(BufferSizeInBytes * 2))),
+    position(0),
+    compress(compress)
+  {
+    if (compress) {
+      memset(&stream, 0, sizeof(z_stream));
+
+      // 16 + 15 selects the gzip format with the largest window; if
+      // zlib can't be initialized, fall back to an uncompressed dump:
+      this->compress
+        = deflateInit2(&stream, Z_BEST_SPEED, 16 + 15) == Z_OK;
+    }
+  }
+
+  void write(const void* p, unsigned size) {
+    const uint8_t* src = static_cast<const uint8_t*>(p);
+    while (size) {
+      unsigned n = min(size, BufferSizeInBytes - position);
+      memcpy(buffer + position, src, n);
+      position += n;
+      src += n;
+      size -= n;
+
+      if (position == BufferSizeInBytes) {
+        flush(false);
+      }
+    }
+  }
+
+  void flush(bool finish) {
+    if (compress) {
+      uint8_t* compressed = buffer + BufferSizeInBytes;
+
+      stream.next_in = buffer;
+      stream.avail_in = position;
+      do {
+        stream.next_out = compressed;
+        stream.avail_out = BufferSizeInBytes;
+
+        deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+
+        size_t n UNUSED = fwrite
+          (compressed, BufferSizeInBytes - stream.avail_out, 1, out);
+      } while (stream.avail_out == 0);
+    } else if (position) {
+      size_t n UNUSED = fwrite(buffer, position, 1, out);
+    }
+
+    position = 0;
+  }
+
+  void dispose() {
+    flush(true);
+
+    if (compress) {
+      deflateEnd(&stream);
+    }
+
+    t->m->heap->free(buffer, BufferSizeInBytes * 2);
+  }
+
+  Thread* t;
+  FILE* out;
+  uint8_t* buffer;
+  unsigned position;
+  bool compress;
+  z_stream stream;
+};
+
 void
-write1(FILE* out, uint8_t v)
+write1(Output* out, uint8_t v)
 {
-  size_t n UNUSED = fwrite(&v, 1, 1, out);
+  out->write(&v, 1);
 }
 
 void
-write4(FILE* out, uint32_t v)
+write4(Output* out, uint32_t v)
 {
   uint8_t b[] = { static_cast<uint8_t>( v >> 24        ),
                   static_cast<uint8_t>((v >> 16) & 0xFF),
                   static_cast<uint8_t>((v >>  8) & 0xFF),
                   static_cast<uint8_t>( v        & 0xFF) };
 
-  size_t n UNUSED = fwrite(b, 4, 1, out);
+  out->write(b, 4);
 }
 
 void
-writeString(FILE* out, int8_t* p, unsigned size)
+writeString(Output* out, int8_t* p, unsigned size)
 {
   write4(out, size);
-  size_t n UNUSED = fwrite(p, size, 1, out);
+  out->write(p, size);
 }
 
 unsigned
@@ -55,6 +137,113 @@ objectSize(Thread* t, object o)
   return extendedSize(t, o, baseSize(t, o, objectClass(t, o)));
 }
 
+class HistogramEntry {
+ public:
+  object class_;
+  unsigned count;
+  uint64_t footprint;
+};
+
+int
+compareHistogramEntries(const void* a, const void* b)
+{
+  uint64_t fa = static_cast<const HistogramEntry*>(a)->footprint;
+  uint64_t fb = static_cast<const HistogramEntry*>(b)->footprint;
+  return fa > fb ? -1 : (fa < fb ? 1 : 0);
+}
+
+// Counts the instances and words of each class in an open hash table
+// keyed by class, which is all the histogram needs beyond the
+// walker's own bookkeeping:
+class Histogram {
+ public:
+  Histogram(Thread* t):
+    t(t),
+    entries(allocate(InitialCapacity)),
+    capacity(InitialCapacity),
+    size(0)
+  { }
+
+  static const unsigned InitialCapacity = 256;
+
+  HistogramEntry* allocate(unsigned capacity) {
+    unsigned footprint = capacity * sizeof(HistogramEntry);
+    HistogramEntry* e = static_cast<HistogramEntry*>
+      (t->m->heap->allocate(footprint));
+    memset(e, 0, footprint);
+    return e;
+  }
+
+  HistogramEntry* find(HistogramEntry* entries, unsigned capacity,
+                       object class_)
+  {
+    unsigned i = (reinterpret_cast<uintptr_t>(class_) / BytesPerWord)
+      & (capacity - 1);
+    while (entries[i].class_ and entries[i].class_ != class_) {
+      i = (i + 1) & (capacity - 1);
+    }
+    return entries + i;
+  }
+
+  void add(object class_, unsigned footprint) {
+    if ((size + 1) * 4 > capacity * 3) {
+      HistogramEntry* old = entries;
+      unsigned oldCapacity = capacity;
+
+      capacity *= 2;
+      entries = allocate(capacity);
+      for (unsigned i = 0; i < oldCapacity; ++i) {
+        if (old[i].class_) {
+          *find(entries, capacity, old[i].class_) = old[i];
+        }
+      }
+
+      t->m->heap->free(old, oldCapacity * sizeof(HistogramEntry));
+    }
+
+    HistogramEntry* e = find(entries, capacity, class_);
+    if (e->class_ == 0) {
+      e->class_ = class_;
+      ++ size;
+    }
+
+    ++ e->count;
+    e->footprint += footprint;
+  }
+
+  // Writes one line per class, largest total first, giving the number
+  // of instances, their total shallow size in bytes, and the name of
+  // the class:
+  void write(FILE* out) {
+    unsigned count = 0;
+    for (unsigned i = 0; i < capacity; ++i) {
+      if (entries[i].class_) {
+        entries[count++] = entries[i];
+      }
+    }
+
+    qsort(entries, count, sizeof(HistogramEntry), compareHistogramEntries);
+
+    fprintf(out, "# instances\tbytes\tclass\n");
+    for (unsigned i = 0; i < count; ++i) {
+      object name = className(t, entries[i].class_);
+      fprintf(out, "%u\t%" LLD "\t%s\n", entries[i].count,
+              static_cast<int64_t>(entries[i].footprint * BytesPerWord),
+              name ? reinterpret_cast<const char*>
+              (&byteArrayBody(t, name, 0)) : "?");
+    }
+  }
+
+  void dispose() {
+    t->m->heap->free(entries, capacity * sizeof(HistogramEntry));
+  }
+
+  Thread* t;
+  HistogramEntry* entries;
+  unsigned capacity;
+  unsigned size;
+};
+
 } // namespace local
 
 } // namespace
@@ -62,14 +251,21 @@ objectSize(Thread* t, object o)
 namespace vm {
 
 void
-dumpHeap(Thread* t, FILE* out)
+dumpHeap(Thread* t, FILE* file)
 {
+  // the avian.heap.dump.compress property, if "true", gzips the dump:
+  const char* compress = findProperty(t, "avian.heap.dump.compress");
+  local::Output out
+    (t, file, compress and ::strcmp(compress, "true") == 0);
+
   class Visitor: public HeapVisitor {
    public:
-    Visitor(Thread* t, FILE* out): t(t), out(out), nextNumber(1) { }
+    Visitor(Thread* t, local::Output* out):
+      t(t), out(out), nextNumber(1)
+    { }
 
     virtual void root() {
-      write1(out, local::Root);      
+      local::write1(out, local::Root);
     }
 
     virtual unsigned visitNew(object p) {
@@ -108,13 +304,52 @@ dumpHeap(Thread* t, FILE* out)
     }
 
     Thread* t;
-    FILE* out;
+    local::Output* out;
     unsigned nextNumber;
-  } visitor(t, out);
+  } visitor(t, &out);
 
   HeapWalker* w = makeHeapWalker(t, &visitor);
   w->visitAllRoots();
   w->dispose();
+
+  out.dispose();
+}
+
+void
+dumpClassHistogram(Thread* t, FILE* out)
+{
+  class Visitor: public HeapVisitor {
+   public:
+    Visitor(Thread* t): t(t), histogram(t), nextNumber(1) { }
+
+    virtual void root() { }
+
+    virtual unsigned visitNew(object p) {
+      if (p) {
+        histogram.add(objectClass(t, p), local::objectSize(t, p));
+        return nextNumber++;
+      } else {
+        return 0;
+      }
+    }
+
+    virtual void visitOld(object, unsigned) { }
+
+    virtual void push(object, unsigned, unsigned) { }
+
+    virtual void pop() { }
+
+    Thread* t;
+    local::Histogram histogram;
+    unsigned nextNumber;
+  } visitor(t);
+
+  HeapWalker* w = makeHeapWalker(t, &visitor);
+  w->visitAllRoots();
+  w->dispose();
+
+  visitor.histogram.write(out);
+  visitor.histogram.dispose();
 }
 
 } // namespace vm
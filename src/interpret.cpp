@@ -26,6 +26,9 @@ const unsigned FrameMethodOffset = 2;
 const unsigned FrameIpOffset = 3;
 const unsigned FrameFootprint = 4;
 
+const bool QuickenInstructions = true;
+const bool FuseInstructions = true;
+
 class Thread: public vm::Thread {
  public:
   class ReferenceFrame {
@@ -307,11 +310,123 @@ setLocalLong(Thread* t, unsigned index, uint64_t value)
   pokeLong(t, frameBase(t, t->frame) + index, value);
 }
 
+unsigned
+instructionLength(Thread* t, object code, unsigned ip)
+{
+  switch (codeBody(t, code, ip)) {
+  case aload: case astore: case bipush: case dload: case dstore:
+  case fload: case fstore: case iload: case istore: case ldc: case lload:
+  case lstore: case newarray: case ret: case ldc_quick:
+  case iload_iload_if_icmpge: case iload_iload_if_icmplt:
+    return 2;
+
+  case anewarray: case checkcast: case getfield: case getstatic: case goto_:
+  case if_acmpeq: case if_acmpne: case if_icmpeq: case if_icmpne:
+  case if_icmpgt: case if_icmpge: case if_icmplt: case if_icmple:
+  case ifeq: case ifne: case ifgt: case ifge: case iflt: case ifle:
+  case ifnonnull: case ifnull: case iinc: case instanceof:
+  case invokespecial: case invokestatic: case invokevirtual: case jsr:
+  case ldc_w: case ldc2_w: case new_: case putfield: case putstatic:
+  case sipush: case bgetfield_quick: case sgetfield_quick:
+  case igetfield_quick: case lgetfield_quick: case agetfield_quick:
+  case bputfield_quick: case sputfield_quick: case iputfield_quick:
+  case lputfield_quick: case aputfield_quick: case invokevirtual_quick:
+  case ldc_w_quick: case iinc_goto:
+    return 3;
+
+  case multianewarray:
+    return 4;
+
+  case goto_w: case invokeinterface: case jsr_w:
+  case 0xba: // invokedynamic
+    return 5;
+
+  case wide:
+    return codeBody(t, code, ip + 1) == iinc ? 6 : 4;
+
+  case tableswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t bottom = codeReadInt32(t, code, p);
+    int32_t top = codeReadInt32(t, code, p);
+    return p + ((top - bottom + 1) * 4) - ip;
+  }
+
+  case lookupswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t count = codeReadInt32(t, code, p);
+    return p + (count * 8) - ip;
+  }
+
+  default:
+    return 1;
+  }
+}
+
+// Sequences which fuseInstructions replaces with superinstructions,
+// chosen from profiles of interpreted loops.  Only the first opcode of
+// a sequence is rewritten, so a branch into the middle of one still
+// finds the original instructions.
+struct Superinstruction {
+  uint8_t sequence[3];
+  unsigned length;
+  uint8_t instruction;
+};
+
+const Superinstruction Superinstructions[] = {
+  { { aload_0, getfield }, 2, aload_0_getfield },
+  { { iinc, goto_ }, 2, iinc_goto },
+  { { iload, iload, if_icmpge }, 3, iload_iload_if_icmpge },
+  { { iload, iload, if_icmplt }, 3, iload_iload_if_icmplt }
+};
+
+const unsigned SuperinstructionCount = sizeof(Superinstructions)
+  / sizeof(Superinstruction);
+
+// Rewrites the sequences in Superinstructions found in the code of
+// method.  This runs when the method is first interpreted, before any
+// of its instructions have been quickened.
+void
+fuseInstructions(Thread* t, object method)
+{
+  object code = methodCode(t, method);
+  unsigned length = codeLength(t, code);
+
+  for (unsigned ip = 0; ip < length;) {
+    unsigned next = ip + instructionLength(t, code, ip);
+
+    for (unsigned i = 0; i < SuperinstructionCount; ++i) {
+      const Superinstruction* s = Superinstructions + i;
+
+      unsigned p = ip;
+      unsigned j = 0;
+      while (j < s->length and p < length
+             and codeBody(t, code, p) == s->sequence[j])
+      {
+        p += instructionLength(t, code, p);
+        ++ j;
+      }
+
+      if (j == s->length) {
+        codeBody(t, code, ip) = s->instruction;
+        next = p;
+        break;
+      }
+    }
+
+    ip = next;
+  }
+
+  methodVmFlags(t, method) |= FusedFlag;
+}
+
 void
 pushFrame(Thread* t, object method)
 {
   PROTECT(t, method);
 
+  // before taking any monitor, since this may take classLock
+  ensureCode(t, method);
+
   unsigned parameterFootprint = methodParameterFootprint(t, method);
   unsigned base = t->sp - parameterFootprint;
   unsigned locals = parameterFootprint;
@@ -334,6 +449,12 @@ pushFrame(Thread* t, object method)
   t->ip = 0;
 
   if ((methodFlags(t, method) & ACC_NATIVE) == 0) {
+    if (FuseInstructions
+        and (methodVmFlags(t, method) & FusedFlag) == 0)
+    {
+      fuseInstructions(t, method);
+    }
+
     t->code = methodCode(t, method);
 
     locals = codeMaxLocals(t, t->code);
@@ -632,6 +753,40 @@ invokeNativeSlow(Thread* t, object method, void* function)
   return returnCode;
 }
 
+unsigned
+invokeNativeCritical(Thread* t, object method, void* function)
+{
+  pushFrame(t, method);
+
+  unsigned footprint = methodParameterFootprint(t, method);
+  unsigned count = methodParameterCount(t, method);
+
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, args, footprint);
+  THREAD_RUNTIME_ARRAY(t, uint8_t, types, count);
+
+  marshalArguments
+    (t, RUNTIME_ARRAY_BODY(args), RUNTIME_ARRAY_BODY(types),
+     frameBase(t, t->frame), method, false);
+
+  unsigned returnCode = methodReturnCode(t, method);
+
+  // critical natives neither see the heap nor call back into the VM,
+  // so there is no need to leave the active state for the call
+  uint64_t result = t->m->system->call
+    (function,
+     RUNTIME_ARRAY_BODY(args),
+     RUNTIME_ARRAY_BODY(types),
+     count,
+     footprint * BytesPerWord,
+     fieldType(t, returnCode));
+
+  popFrame(t);
+
+  pushResult(t, returnCode, result, false);
+
+  return returnCode;
+}
+
 unsigned
 invokeNative(Thread* t, object method)
 {
@@ -665,6 +820,8 @@ invokeNative(Thread* t, object method)
     pushResult(t, methodReturnCode(t, method), result, false);
 
     return methodReturnCode(t, method);
+  } else if (nativeCritical(t, native)) {
+    return invokeNativeCritical(t, method, nativeFunction(t, native));
   } else {
     return invokeNativeSlow(t, method, nativeFunction(t, native));
   }
@@ -760,9 +917,205 @@ pushField(Thread* t, object target, object field)
   }
 }
 
+// Replaces the opcode at ip in code with its quick form.  The
+// operands are left alone, so a thread which has already fetched the
+// original opcode still finds the constant pool index it expects.
+void
+quicken(Thread* t, object code, unsigned ip, unsigned instruction)
+{
+  if (QuickenInstructions) {
+    // the resolved pool entry must be visible before the new opcode
+    storeStoreMemoryBarrier();
+
+    codeBody(t, code, ip) = instruction;
+  }
+}
+
+// Rewrites the opcode at ip to the form of base (one of
+// bgetfield_quick, bputfield_quick or aload_0_bgetfield_quick) for
+// the type of field.  The five forms of each follow one another in
+// the order byte, short, int, long, object.
+void
+quickenFieldInstruction(Thread* t, object code, unsigned ip, object field,
+                        unsigned base)
+{
+  // volatile fields need acquireFieldForRead and friends each time
+  if (fieldFlags(t, field) & ACC_VOLATILE) {
+    return;
+  }
+
+  unsigned kind;
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    kind = 0;
+    break;
+
+  case CharField:
+  case ShortField:
+    kind = 1;
+    break;
+
+  case FloatField:
+  case IntField:
+    kind = 2;
+    break;
+
+  case DoubleField:
+  case LongField:
+    kind = 3;
+    break;
+
+  case ObjectField:
+    kind = 4;
+    break;
+
+  default: abort(t);
+  }
+
+  quicken(t, code, ip, base + kind);
+}
+
+// Returns the field or method a quickened instruction refers to,
+// which was resolved before the instruction was rewritten.
+inline object
+resolvedEntry(Thread* t, object code, unsigned index)
+{
+  loadMemoryBarrier();
+
+  return singletonObject(t, codePool(t, code), index - 1);
+}
+
+void
+traceInstruction(Thread* t, unsigned instruction)
+{
+  fprintf(stderr, "ip: %d; instruction: 0x%x in %s.%s ",
+          t->ip - 1,
+          instruction,
+          &byteArrayBody
+          (t, className(t, methodClass(t, frameMethod(t, t->frame))), 0),
+          &byteArrayBody
+          (t, methodName(t, frameMethod(t, t->frame)), 0));
+
+  int line = findLineNumber(t, frameMethod(t, t->frame), t->ip);
+  switch (line) {
+  case NativeLine:
+    fprintf(stderr, "(native)\n");
+    break;
+  case UnknownLine:
+    fprintf(stderr, "(unknown line)\n");
+    break;
+  default:
+    fprintf(stderr, "(line %d)\n", line);
+  }
+}
+
+// Returns the target of the branch at ip by offset.  A thread
+// spinning in an interpreted loop neither calls nor allocates, so a
+// backward branch first idles the thread if another has asked for the
+// exclusive state, as the safepoint poll at a compiled loop head does.
+inline unsigned
+branchTarget(Thread* t, unsigned ip, int32_t offset)
+{
+  if (offset < 0 and UNLIKELY(t->safepointRequested)) {
+    t->safepointRequested = 0;
+
+    loadMemoryBarrier();
+
+    if (t->m->exclusive) {
+      ENTER(t, Thread::IdleState);
+    }
+  }
+
+  return ip + offset;
+}
+
+// With GCC-compatible compilers, each instruction jumps straight to
+// the next one's handler through a table of label addresses rather
+// than back to a single switch, giving each handler its own indirect
+// branch to predict.  Define AVIAN_SWITCH_DISPATCH to use the switch
+// anyway.
+#if (defined __GNUC__) && (! defined AVIAN_SWITCH_DISPATCH)
+#  define THREADED_DISPATCH
+#endif
+
+#ifdef THREADED_DISPATCH
+#  define HANDLER(x) x##Op:
+#  define CASE(x) case x: x##Op:
+#  define DEFAULT default: defaultOp:
+#  define DISPATCH                              \
+  instruction = codeBody(t, code, ip++);        \
+  if (DebugRun) {                               \
+    traceInstruction(t, instruction);           \
+  }                                             \
+  goto *dispatchTable[instruction]
+#else
+#  define HANDLER(x)
+#  define CASE(x) case x:
+#  define DEFAULT default:
+#  define DISPATCH goto loop
+#endif
+
 object
 interpret3(Thread* t, const int base)
 {
+#ifdef THREADED_DISPATCH
+  static void* const dispatchTable[256] = {
+    // indexed by opcode
+    &&nopOp, &&aconst_nullOp, &&iconst_m1Op, &&iconst_0Op, &&iconst_1Op,
+    &&iconst_2Op, &&iconst_3Op, &&iconst_4Op, &&iconst_5Op, &&lconst_0Op,
+    &&lconst_1Op, &&fconst_0Op, &&fconst_1Op, &&fconst_2Op, &&dconst_0Op,
+    &&dconst_1Op, &&bipushOp, &&sipushOp, &&ldcOp, &&ldc_wOp, &&ldc2_wOp,
+    &&iloadOp, &&lloadOp, &&floadOp, &&dloadOp, &&aloadOp, &&iload_0Op,
+    &&iload_1Op, &&iload_2Op, &&iload_3Op, &&lload_0Op, &&lload_1Op,
+    &&lload_2Op, &&lload_3Op, &&fload_0Op, &&fload_1Op, &&fload_2Op,
+    &&fload_3Op, &&dload_0Op, &&dload_1Op, &&dload_2Op, &&dload_3Op,
+    &&aload_0Op, &&aload_1Op, &&aload_2Op, &&aload_3Op, &&ialoadOp,
+    &&laloadOp, &&faloadOp, &&daloadOp, &&aaloadOp, &&baloadOp, &&caloadOp,
+    &&saloadOp, &&istoreOp, &&lstoreOp, &&fstoreOp, &&dstoreOp, &&astoreOp,
+    &&istore_0Op, &&istore_1Op, &&istore_2Op, &&istore_3Op, &&lstore_0Op,
+    &&lstore_1Op, &&lstore_2Op, &&lstore_3Op, &&fstore_0Op, &&fstore_1Op,
+    &&fstore_2Op, &&fstore_3Op, &&dstore_0Op, &&dstore_1Op, &&dstore_2Op,
+    &&dstore_3Op, &&astore_0Op, &&astore_1Op, &&astore_2Op, &&astore_3Op,
+    &&iastoreOp, &&lastoreOp, &&fastoreOp, &&dastoreOp, &&aastoreOp,
+    &&bastoreOp, &&castoreOp, &&sastoreOp, &&pop_Op, &&pop2Op, &&dupOp,
+    &&dup_x1Op, &&dup_x2Op, &&dup2Op, &&dup2_x1Op, &&dup2_x2Op, &&swapOp,
+    &&iaddOp, &&laddOp, &&faddOp, &&daddOp, &&isubOp, &&lsubOp, &&fsubOp,
+    &&dsubOp, &&imulOp, &&lmulOp, &&fmulOp, &&dmulOp, &&idivOp, &&ldiv_Op,
+    &&fdivOp, &&ddivOp, &&iremOp, &&lremOp, &&fremOp, &&dremOp, &&inegOp,
+    &&lnegOp, &&fnegOp, &&dnegOp, &&ishlOp, &&lshlOp, &&ishrOp, &&lshrOp,
+    &&iushrOp, &&lushrOp, &&iandOp, &&landOp, &&iorOp, &&lorOp, &&ixorOp,
+    &&lxorOp, &&iincOp, &&i2lOp, &&i2fOp, &&i2dOp, &&l2iOp, &&l2fOp, &&l2dOp,
+    &&f2iOp, &&f2lOp, &&f2dOp, &&d2iOp, &&d2lOp, &&d2fOp, &&i2bOp, &&i2cOp,
+    &&i2sOp, &&lcmpOp, &&fcmplOp, &&fcmpgOp, &&dcmplOp, &&dcmpgOp, &&ifeqOp,
+    &&ifneOp, &&ifltOp, &&ifgeOp, &&ifgtOp, &&ifleOp, &&if_icmpeqOp,
+    &&if_icmpneOp, &&if_icmpltOp, &&if_icmpgeOp, &&if_icmpgtOp, &&if_icmpleOp,
+    &&if_acmpeqOp, &&if_acmpneOp, &&goto_Op, &&jsrOp, &&retOp,
+    &&tableswitchOp, &&lookupswitchOp, &&ireturnOp, &&lreturnOp, &&freturnOp,
+    &&dreturnOp, &&areturnOp, &&return_Op, &&getstaticOp, &&putstaticOp,
+    &&getfieldOp, &&putfieldOp, &&invokevirtualOp, &&invokespecialOp,
+    &&invokestaticOp, &&invokeinterfaceOp, &&defaultOp, &&new_Op,
+    &&newarrayOp, &&anewarrayOp, &&arraylengthOp, &&athrowOp, &&checkcastOp,
+    &&instanceofOp, &&monitorenterOp, &&monitorexitOp, &&wideOp,
+    &&multianewarrayOp, &&ifnullOp, &&ifnonnullOp, &&goto_wOp, &&jsr_wOp,
+    &&defaultOp, &&bgetfield_quickOp, &&sgetfield_quickOp,
+    &&igetfield_quickOp, &&lgetfield_quickOp, &&agetfield_quickOp,
+    &&bputfield_quickOp, &&sputfield_quickOp, &&iputfield_quickOp,
+    &&lputfield_quickOp, &&aputfield_quickOp, &&invokevirtual_quickOp,
+    &&ldc_quickOp, &&ldc_w_quickOp, &&aload_0_getfieldOp,
+    &&aload_0_bgetfield_quickOp, &&aload_0_sgetfield_quickOp,
+    &&aload_0_igetfield_quickOp, &&aload_0_lgetfield_quickOp,
+    &&aload_0_agetfield_quickOp, &&iinc_gotoOp, &&iload_iload_if_icmpgeOp,
+    &&iload_iload_if_icmpltOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp, &&defaultOp,
+    &&defaultOp, &&impdep1Op, &&defaultOp
+  };
+#endif
+
   unsigned instruction = nop;
   unsigned& ip = t->ip;
   unsigned& sp = t->sp;
@@ -779,33 +1132,19 @@ interpret3(Thread* t, const int base)
 
   initClass(t, methodClass(t, frameMethod(t, frame)));
 
+#ifdef THREADED_DISPATCH
+  DISPATCH;
+#else
  loop:
   instruction = codeBody(t, code, ip++);
 
   if (DebugRun) {
-    fprintf(stderr, "ip: %d; instruction: 0x%x in %s.%s ",
-            ip - 1,
-            instruction,
-            &byteArrayBody
-            (t, className(t, methodClass(t, frameMethod(t, frame))), 0),
-            &byteArrayBody
-            (t, methodName(t, frameMethod(t, frame)), 0));
-
-    int line = findLineNumber(t, frameMethod(t, frame), ip);
-    switch (line) {
-    case NativeLine:
-      fprintf(stderr, "(native)\n");
-      break;
-    case UnknownLine:
-      fprintf(stderr, "(unknown line)\n");
-      break;
-    default:
-      fprintf(stderr, "(line %d)\n", line);
-    }
+    traceInstruction(t, instruction);
   }
+#endif
 
   switch (instruction) {
-  case aaload: {
+  CASE(aaload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -824,9 +1163,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case aastore: {
+  CASE(aastore) {
     object value = popObject(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -846,33 +1185,129 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case aconst_null: {
+  CASE(aconst_null) {
     pushObject(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case aload: {
+  CASE(aload) {
     pushObject(t, localObject(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case aload_0: {
+  CASE(aload_0) {
     pushObject(t, localObject(t, 0));
-  } goto loop;
+  } DISPATCH;
+
+  CASE(aload_0_getfield) {
+    // skip the getfield opcode
+    ++ ip;
+
+    if (LIKELY(localObject(t, 0))) {
+      uint16_t index = codeReadInt16(t, code, ip);
+    
+      object field = resolveField(t, frameMethod(t, frame), index - 1);
+
+      assert(t, (fieldFlags(t, field) & ACC_STATIC) == 0);
+
+      PROTECT(t, field);
+
+      { ACQUIRE_FIELD_FOR_READ(t, field);
+
+        pushField(t, localObject(t, 0), field);
+      }
+
+      quickenFieldInstruction
+        (t, code, ip - 4, field, aload_0_bgetfield_quick);
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_0_bgetfield_quick) {
+    object o = localObject(t, 0);
+
+    ++ ip;
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int8_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_0_sgetfield_quick) {
+    object o = localObject(t, 0);
+
+    ++ ip;
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int16_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_0_igetfield_quick) {
+    object o = localObject(t, 0);
+
+    ++ ip;
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int32_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_0_lgetfield_quick) {
+    object o = localObject(t, 0);
+
+    ++ ip;
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
 
-  case aload_1: {
+    if (LIKELY(o)) {
+      pushLong(t, cast<int64_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_0_agetfield_quick) {
+    object o = localObject(t, 0);
+
+    ++ ip;
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+
+    if (LIKELY(o)) {
+      pushObject(t, cast<object>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aload_1) {
     pushObject(t, localObject(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case aload_2: {
+  CASE(aload_2) {
     pushObject(t, localObject(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case aload_3: {
+  CASE(aload_3) {
     pushObject(t, localObject(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case anewarray: {
+  CASE(anewarray) {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
@@ -886,20 +1321,20 @@ interpret3(Thread* t, const int base)
         (t, Machine::NegativeArraySizeExceptionType, "%d", count);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case areturn: {
+  CASE(areturn) {
     object result = popObject(t);
     if (frame > base) {
       popFrame(t);
       pushObject(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return result;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case arraylength: {
+  CASE(arraylength) {
     object array = popObject(t);
     if (LIKELY(array)) {
       pushInt(t, cast<uintptr_t>(array, BytesPerWord));
@@ -907,36 +1342,36 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case astore: {
+  CASE(astore) {
     store(t, codeBody(t, code, ip++));
-  } goto loop;
+  } DISPATCH;
 
-  case astore_0: {
+  CASE(astore_0) {
     store(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_1: {
+  CASE(astore_1) {
     store(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_2: {
+  CASE(astore_2) {
     store(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_3: {
+  CASE(astore_3) {
     store(t, 3);
-  } goto loop;
+  } DISPATCH;
 
-  case athrow: {
+  CASE(athrow) {
     exception = popObject(t);
     if (UNLIKELY(exception == 0)) {
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
     }
   } goto throw_;
 
-  case baload: {
+  CASE(baload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -970,9 +1405,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case bastore: {
+  CASE(bastore) {
     int8_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1006,13 +1441,13 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case bipush: {
+  CASE(bipush) {
     pushInt(t, static_cast<int8_t>(codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case caload: {
+  CASE(caload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1031,9 +1466,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case castore: {
+  CASE(castore) {
     uint16_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1053,9 +1488,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case checkcast: {
+  CASE(checkcast) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     if (peekObject(t, sp - 1)) {
@@ -1071,13 +1506,13 @@ interpret3(Thread* t, const int base)
         goto throw_;
       }
     }
-  } goto loop;
+  } DISPATCH;
 
-  case d2f: {
+  CASE(d2f) {
     pushFloat(t, static_cast<float>(popDouble(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case d2i: {
+  CASE(d2i) {
     double f = popDouble(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushInt(t, 0); break;
@@ -1087,9 +1522,9 @@ interpret3(Thread* t, const int base)
          : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case d2l: {
+  CASE(d2l) {
     double f = popDouble(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushLong(t, 0); break;
@@ -1099,16 +1534,16 @@ interpret3(Thread* t, const int base)
          : (f <= INT64_MIN ? INT64_MIN : static_cast<int64_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dadd: {
+  CASE(dadd) {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case daload: {
+  CASE(daload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1127,9 +1562,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dastore: {
+  CASE(dastore) {
     double value = popDouble(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1149,9 +1584,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dcmpg: {
+  CASE(dcmpg) {
     double b = popDouble(t);
     double a = popDouble(t);
     
@@ -1164,9 +1599,9 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, 1);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dcmpl: {
+  CASE(dcmpl) {
     double b = popDouble(t);
     double a = popDouble(t);
     
@@ -1179,60 +1614,60 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, static_cast<unsigned>(-1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dconst_0: {
+  CASE(dconst_0) {
     pushDouble(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case dconst_1: {
+  CASE(dconst_1) {
     pushDouble(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case ddiv: {
+  CASE(ddiv) {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case dmul: {
+  CASE(dmul) {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case dneg: {
+  CASE(dneg) {
     double a = popDouble(t);
     
     pushDouble(t, - a);
-  } goto loop;
+  } DISPATCH;
 
-  case vm::drem: {
+  case vm::drem: HANDLER(drem) {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, fmod(a, b));
-  } goto loop;
+  } DISPATCH;
 
-  case dsub: {
+  CASE(dsub) {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case dup: {
+  CASE(dup) {
     if (DebugStack) {
       fprintf(stderr, "dup\n");
     }
 
     memcpy(stack + ((sp    ) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup_x1: {
+  CASE(dup_x1) {
     if (DebugStack) {
       fprintf(stderr, "dup_x1\n");
     }
@@ -1241,9 +1676,9 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 2) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup_x2: {
+  CASE(dup_x2) {
     if (DebugStack) {
       fprintf(stderr, "dup_x2\n");
     }
@@ -1253,18 +1688,18 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 2) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2: {
+  CASE(dup2) {
     if (DebugStack) {
       fprintf(stderr, "dup2\n");
     }
 
     memcpy(stack + ((sp    ) * 2), stack + ((sp - 2) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2_x1: {
+  CASE(dup2_x1) {
     if (DebugStack) {
       fprintf(stderr, "dup2_x1\n");
     }
@@ -1274,9 +1709,9 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2_x2: {
+  CASE(dup2_x2) {
     if (DebugStack) {
       fprintf(stderr, "dup2_x2\n");
     }
@@ -1287,13 +1722,13 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 2) * 2), stack + ((sp - 4) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 4) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case f2d: {
+  CASE(f2d) {
     pushDouble(t, popFloat(t));
-  } goto loop;
+  } DISPATCH;
 
-  case f2i: {
+  CASE(f2i) {
     float f = popFloat(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushInt(t, 0); break;
@@ -1302,9 +1737,9 @@ interpret3(Thread* t, const int base)
                      : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case f2l: {
+  CASE(f2l) {
     float f = popFloat(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushLong(t, 0); break;
@@ -1312,16 +1747,16 @@ interpret3(Thread* t, const int base)
       break;
     default: pushLong(t, static_cast<int64_t>(f)); break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fadd: {
+  CASE(fadd) {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case faload: {
+  CASE(faload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1340,9 +1775,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fastore: {
+  CASE(fastore) {
     float value = popFloat(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1362,9 +1797,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fcmpg: {
+  CASE(fcmpg) {
     float b = popFloat(t);
     float a = popFloat(t);
     
@@ -1377,9 +1812,9 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, 1);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fcmpl: {
+  CASE(fcmpl) {
     float b = popFloat(t);
     float a = popFloat(t);
     
@@ -1392,55 +1827,55 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, static_cast<unsigned>(-1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_0: {
+  CASE(fconst_0) {
     pushFloat(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_1: {
+  CASE(fconst_1) {
     pushFloat(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_2: {
+  CASE(fconst_2) {
     pushFloat(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case fdiv: {
+  CASE(fdiv) {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case fmul: {
+  CASE(fmul) {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case fneg: {
+  CASE(fneg) {
     float a = popFloat(t);
     
     pushFloat(t, - a);
-  } goto loop;
+  } DISPATCH;
 
-  case frem: {
+  CASE(frem) {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, fmodf(a, b));
-  } goto loop;
+  } DISPATCH;
 
-  case fsub: {
+  CASE(fsub) {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case getfield: {
+  CASE(getfield) {
     if (LIKELY(peekObject(t, sp - 1))) {
       uint16_t index = codeReadInt16(t, code, ip);
     
@@ -1453,13 +1888,75 @@ interpret3(Thread* t, const int base)
       ACQUIRE_FIELD_FOR_READ(t, field);
 
       pushField(t, popObject(t), field);
+
+      quickenFieldInstruction(t, code, ip - 3, field, bgetfield_quick);
     } else {
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case getstatic: {
+  CASE(bgetfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int8_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(sgetfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int16_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(igetfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      pushInt(t, cast<int32_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(lgetfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      pushLong(t, cast<int64_t>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(agetfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      pushObject(t, cast<object>(o, fieldOffset(t, field)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(getstatic) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -1473,50 +1970,50 @@ interpret3(Thread* t, const int base)
     ACQUIRE_FIELD_FOR_READ(t, field);
 
     pushField(t, classStaticTable(t, fieldClass(t, field)), field);
-  } goto loop;
+  } DISPATCH;
 
-  case goto_: {
+  CASE(goto_) {
     int16_t offset = codeReadInt16(t, code, ip);
-    ip = (ip - 3) + offset;
-  } goto loop;
+    ip = branchTarget(t, ip - 3, offset);
+  } DISPATCH;
     
-  case goto_w: {
+  CASE(goto_w) {
     int32_t offset = codeReadInt32(t, code, ip);
-    ip = (ip - 5) + offset;
-  } goto loop;
+    ip = branchTarget(t, ip - 5, offset);
+  } DISPATCH;
 
-  case i2b: {
+  CASE(i2b) {
     pushInt(t, static_cast<int8_t>(popInt(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case i2c: {
+  CASE(i2c) {
     pushInt(t, static_cast<uint16_t>(popInt(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case i2d: {
+  CASE(i2d) {
     pushDouble(t, static_cast<double>(static_cast<int32_t>(popInt(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case i2f: {
+  CASE(i2f) {
     pushFloat(t, static_cast<float>(static_cast<int32_t>(popInt(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case i2l: {
+  CASE(i2l) {
     pushLong(t, static_cast<int32_t>(popInt(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case i2s: {
+  CASE(i2s) {
     pushInt(t, static_cast<int16_t>(popInt(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case iadd: {
+  CASE(iadd) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case iaload: {
+  CASE(iaload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1535,16 +2032,16 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iand: {
+  CASE(iand) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a & b);
-  } goto loop;
+  } DISPATCH;
 
-  case iastore: {
+  CASE(iastore) {
     int32_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1564,37 +2061,37 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_m1: {
+  CASE(iconst_m1) {
     pushInt(t, static_cast<unsigned>(-1));
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_0: {
+  CASE(iconst_0) {
     pushInt(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_1: {
+  CASE(iconst_1) {
     pushInt(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_2: {
+  CASE(iconst_2) {
     pushInt(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_3: {
+  CASE(iconst_3) {
     pushInt(t, 3);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_4: {
+  CASE(iconst_4) {
     pushInt(t, 4);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_5: {
+  CASE(iconst_5) {
     pushInt(t, 5);
-  } goto loop;
+  } DISPATCH;
 
-  case idiv: {
+  CASE(idiv) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
 
@@ -1604,204 +2101,248 @@ interpret3(Thread* t, const int base)
     }
     
     pushInt(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case if_acmpeq: {
+  CASE(if_acmpeq) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     object b = popObject(t);
     object a = popObject(t);
     
     if (a == b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_acmpne: {
+  CASE(if_acmpne) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     object b = popObject(t);
     object a = popObject(t);
     
     if (a != b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpeq: {
+  CASE(if_icmpeq) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a == b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpne: {
+  CASE(if_icmpne) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a != b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpgt: {
+  CASE(if_icmpgt) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a > b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpge: {
+  CASE(if_icmpge) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a >= b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
+    }
+  } DISPATCH;
+
+  CASE(iload_iload_if_icmpge) {
+    int32_t a = localInt(t, codeBody(t, code, ip++));
+
+    // skip the second iload opcode
+    ++ ip;
+    int32_t b = localInt(t, codeBody(t, code, ip++));
+
+    // and the if_icmp opcode
+    ++ ip;
+    int16_t offset = codeReadInt16(t, code, ip);
+    
+    if (a >= b) {
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmplt: {
+  CASE(if_icmplt) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a < b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
+    }
+  } DISPATCH;
+
+  CASE(iload_iload_if_icmplt) {
+    int32_t a = localInt(t, codeBody(t, code, ip++));
+
+    // skip the second iload opcode
+    ++ ip;
+    int32_t b = localInt(t, codeBody(t, code, ip++));
+
+    // and the if_icmp opcode
+    ++ ip;
+    int16_t offset = codeReadInt16(t, code, ip);
+    
+    if (a < b) {
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmple: {
+  CASE(if_icmple) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     if (a <= b) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifeq: {
+  CASE(ifeq) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popInt(t) == 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifne: {
+  CASE(ifne) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popInt(t)) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifgt: {
+  CASE(ifgt) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) > 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifge: {
+  CASE(ifge) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) >= 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iflt: {
+  CASE(iflt) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) < 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifle: {
+  CASE(ifle) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) <= 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifnonnull: {
+  CASE(ifnonnull) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popObject(t)) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifnull: {
+  CASE(ifnull) {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popObject(t) == 0) {
-      ip = (ip - 3) + offset;
+      ip = branchTarget(t, ip - 3, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iinc: {
+  CASE(iinc) {
     uint8_t index = codeBody(t, code, ip++);
     int8_t c = codeBody(t, code, ip++);
     
     setLocalInt(t, index, localInt(t, index) + c);
-  } goto loop;
+  } DISPATCH;
 
-  case iload:
-  case fload: {
+  CASE(iinc_goto) {
+    uint8_t index = codeBody(t, code, ip++);
+    int8_t c = codeBody(t, code, ip++);
+    
+    setLocalInt(t, index, localInt(t, index) + c);
+
+    // skip the goto opcode
+    ++ ip;
+    int16_t offset = codeReadInt16(t, code, ip);
+    ip = branchTarget(t, ip - 3, offset);
+  } DISPATCH;
+
+  CASE(iload)
+  CASE(fload) {
     pushInt(t, localInt(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_0:
-  case fload_0: {
+  CASE(iload_0)
+  CASE(fload_0) {
     pushInt(t, localInt(t, 0));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_1:
-  case fload_1: {
+  CASE(iload_1)
+  CASE(fload_1) {
     pushInt(t, localInt(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_2:
-  case fload_2: {
+  CASE(iload_2)
+  CASE(fload_2) {
     pushInt(t, localInt(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_3:
-  case fload_3: {
+  CASE(iload_3)
+  CASE(fload_3) {
     pushInt(t, localInt(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case imul: {
+  CASE(imul) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case ineg: {
+  CASE(ineg) {
     pushInt(t, - popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case instanceof: {
+  CASE(instanceof) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     if (peekObject(t, sp - 1)) {
@@ -1816,9 +2357,9 @@ interpret3(Thread* t, const int base)
       popObject(t);
       pushInt(t, 0);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case invokeinterface: {
+  CASE(invokeinterface) {
     uint16_t index = codeReadInt16(t, code, ip);
     
     ip += 2;
@@ -1834,9 +2375,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case invokespecial: {
+  CASE(invokespecial) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
@@ -1861,9 +2402,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case invokestatic: {
+  CASE(invokestatic) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
@@ -1874,10 +2415,12 @@ interpret3(Thread* t, const int base)
     code = method;
   } goto invoke;
 
-  case invokevirtual: {
+  CASE(invokevirtual) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
+
+    quicken(t, code, ip - 3, invokevirtual_quick);
     
     unsigned parameterFootprint = methodParameterFootprint(t, method);
     if (LIKELY(peekObject(t, sp - parameterFootprint))) {
@@ -1893,16 +2436,35 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ior: {
+  CASE(invokevirtual_quick) {
+    object method = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    if (LIKELY(peekObject(t, sp - parameterFootprint))) {
+      object class_ = objectClass(t, peekObject(t, sp - parameterFootprint));
+      PROTECT(t, method);
+      PROTECT(t, class_);
+
+      initClass(t, class_);
+
+      code = findVirtualMethod(t, method, class_);
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(ior) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a | b);
-  } goto loop;
+  } DISPATCH;
 
-  case irem: {
+  CASE(irem) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
@@ -1912,114 +2474,114 @@ interpret3(Thread* t, const int base)
     }
     
     pushInt(t, a % b);
-  } goto loop;
+  } DISPATCH;
 
-  case ireturn:
-  case freturn: {
+  CASE(ireturn)
+  CASE(freturn) {
     int32_t result = popInt(t);
     if (frame > base) {
       popFrame(t);
       pushInt(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return makeInt(t, result);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ishl: {
+  CASE(ishl) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a << (b & 0x1F));
-  } goto loop;
+  } DISPATCH;
 
-  case ishr: {
+  CASE(ishr) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a >> (b & 0x1F));
-  } goto loop;
+  } DISPATCH;
 
-  case istore:
-  case fstore: {
+  CASE(istore)
+  CASE(fstore) {
     setLocalInt(t, codeBody(t, code, ip++), popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_0:
-  case fstore_0: {
+  CASE(istore_0)
+  CASE(fstore_0) {
     setLocalInt(t, 0, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_1:
-  case fstore_1: {
+  CASE(istore_1)
+  CASE(fstore_1) {
     setLocalInt(t, 1, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_2:
-  case fstore_2: {
+  CASE(istore_2)
+  CASE(fstore_2) {
     setLocalInt(t, 2, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_3:
-  case fstore_3: {
+  CASE(istore_3)
+  CASE(fstore_3) {
     setLocalInt(t, 3, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case isub: {
+  CASE(isub) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case iushr: {
+  CASE(iushr) {
     int32_t b = popInt(t);
     uint32_t a = popInt(t);
     
     pushInt(t, a >> (b & 0x1F));
-  } goto loop;
+  } DISPATCH;
 
-  case ixor: {
+  CASE(ixor) {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
     pushInt(t, a ^ b);
-  } goto loop;
+  } DISPATCH;
 
-  case jsr: {
+  CASE(jsr) {
     uint16_t offset = codeReadInt16(t, code, ip);
 
     pushInt(t, ip);
-    ip = (ip - 3) + static_cast<int16_t>(offset);
-  } goto loop;
+    ip = branchTarget(t, ip - 3, static_cast<int16_t>(offset));
+  } DISPATCH;
 
-  case jsr_w: {
+  CASE(jsr_w) {
     uint32_t offset = codeReadInt32(t, code, ip);
 
     pushInt(t, ip);
-    ip = (ip - 5) + static_cast<int32_t>(offset);
-  } goto loop;
+    ip = branchTarget(t, ip - 5, static_cast<int32_t>(offset));
+  } DISPATCH;
 
-  case l2d: {
+  CASE(l2d) {
     pushDouble(t, static_cast<double>(static_cast<int64_t>(popLong(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case l2f: {
+  CASE(l2f) {
     pushFloat(t, static_cast<float>(static_cast<int64_t>(popLong(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case l2i: {
+  CASE(l2i) {
     pushInt(t, static_cast<int32_t>(popLong(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case ladd: {
+  CASE(ladd) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case laload: {
+  CASE(laload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -2038,16 +2600,16 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case land: {
+  CASE(land) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a & b);
-  } goto loop;
+  } DISPATCH;
 
-  case lastore: {
+  CASE(lastore) {
     int64_t value = popLong(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -2067,25 +2629,25 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case lcmp: {
+  CASE(lcmp) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushInt(t, a > b ? 1 : a == b ? 0 : -1);
-  } goto loop;
+  } DISPATCH;
 
-  case lconst_0: {
+  CASE(lconst_0) {
     pushLong(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case lconst_1: {
+  CASE(lconst_1) {
     pushLong(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case ldc:
-  case ldc_w: {
+  CASE(ldc)
+  CASE(ldc_w) {
     uint16_t index;
 
     if (instruction == ldc) {
@@ -2107,13 +2669,40 @@ interpret3(Thread* t, const int base)
         pushObject(t, getJClass(t, v));
       } else {     
         pushObject(t, v);
+
+        quicken(t, code, instruction == ldc ? ip - 2 : ip - 3,
+                instruction == ldc ? ldc_quick : ldc_w_quick);
       }
+    } else {
+      pushInt(t, singletonValue(t, pool, index - 1));
+
+      quicken(t, code, instruction == ldc ? ip - 2 : ip - 3,
+              instruction == ldc ? ldc_quick : ldc_w_quick);
+    }
+  } DISPATCH;
+
+  CASE(ldc_quick)
+  CASE(ldc_w_quick) {
+    uint16_t index;
+
+    if (instruction == ldc_quick) {
+      index = codeBody(t, code, ip++);
+    } else {
+      index = codeReadInt16(t, code, ip);
+    }
+
+    // only constants which need no resolution are quickened, so the
+    // pool entry is pushed as it is
+    object pool = codePool(t, code);
+
+    if (singletonIsObject(t, pool, index - 1)) {
+      pushObject(t, singletonObject(t, pool, index - 1));
     } else {
       pushInt(t, singletonValue(t, pool, index - 1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ldc2_w: {
+  CASE(ldc2_w) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object pool = codePool(t, code);
@@ -2121,9 +2710,9 @@ interpret3(Thread* t, const int base)
     uint64_t v;
     memcpy(&v, &singletonValue(t, pool, index - 1), 8);
     pushLong(t, v);
-  } goto loop;
+  } DISPATCH;
 
-  case ldiv_: {
+  CASE(ldiv_) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
@@ -2133,45 +2722,45 @@ interpret3(Thread* t, const int base)
     }
     
     pushLong(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case lload:
-  case dload: {
+  CASE(lload)
+  CASE(dload) {
     pushLong(t, localLong(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_0:
-  case dload_0: {
+  CASE(lload_0)
+  CASE(dload_0) {
     pushLong(t, localLong(t, 0));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_1:
-  case dload_1: {
+  CASE(lload_1)
+  CASE(dload_1) {
     pushLong(t, localLong(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_2:
-  case dload_2: {
+  CASE(lload_2)
+  CASE(dload_2) {
     pushLong(t, localLong(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_3:
-  case dload_3: {
+  CASE(lload_3)
+  CASE(dload_3) {
     pushLong(t, localLong(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case lmul: {
+  CASE(lmul) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case lneg: {
+  CASE(lneg) {
     pushLong(t, - popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lookupswitch: {
+  CASE(lookupswitch) {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2195,22 +2784,22 @@ interpret3(Thread* t, const int base)
       } else if (key > k) {
         bottom = middle + 1;
       } else {
-        ip = base + codeReadInt32(t, code, index);
-        goto loop;
+        ip = branchTarget(t, base, codeReadInt32(t, code, index));
+        DISPATCH;
       }
     }
 
-    ip = base + default_;
-  } goto loop;
+    ip = branchTarget(t, base, default_);
+  } DISPATCH;
 
-  case lor: {
+  CASE(lor) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a | b);
-  } goto loop;
+  } DISPATCH;
 
-  case lrem: {
+  CASE(lrem) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
@@ -2220,81 +2809,81 @@ interpret3(Thread* t, const int base)
     }
     
     pushLong(t, a % b);
-  } goto loop;
+  } DISPATCH;
 
-  case lreturn:
-  case dreturn: {
+  CASE(lreturn)
+  CASE(dreturn) {
     int64_t result = popLong(t);
     if (frame > base) {
       popFrame(t);
       pushLong(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return makeLong(t, result);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case lshl: {
+  CASE(lshl) {
     int32_t b = popInt(t);
     int64_t a = popLong(t);
     
     pushLong(t, a << (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lshr: {
+  CASE(lshr) {
     int32_t b = popInt(t);
     int64_t a = popLong(t);
     
     pushLong(t, a >> (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore:
-  case dstore: {
+  CASE(lstore)
+  CASE(dstore) {
     setLocalLong(t, codeBody(t, code, ip++), popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_0: 
-  case dstore_0:{
+  CASE(lstore_0) 
+  CASE(dstore_0){
     setLocalLong(t, 0, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_1: 
-  case dstore_1: {
+  CASE(lstore_1) 
+  CASE(dstore_1) {
     setLocalLong(t, 1, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_2: 
-  case dstore_2: {
+  CASE(lstore_2) 
+  CASE(dstore_2) {
     setLocalLong(t, 2, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_3: 
-  case dstore_3: {
+  CASE(lstore_3) 
+  CASE(dstore_3) {
     setLocalLong(t, 3, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lsub: {
+  CASE(lsub) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case lushr: {
+  CASE(lushr) {
     int64_t b = popInt(t);
     uint64_t a = popLong(t);
     
     pushLong(t, a >> (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lxor: {
+  CASE(lxor) {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a ^ b);
-  } goto loop;
+  } DISPATCH;
 
-  case monitorenter: {
+  CASE(monitorenter) {
     object o = popObject(t);
     if (LIKELY(o)) {
       acquire(t, o);
@@ -2302,9 +2891,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case monitorexit: {
+  CASE(monitorexit) {
     object o = popObject(t);
     if (LIKELY(o)) {
       release(t, o);
@@ -2312,9 +2901,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case multianewarray: {
+  CASE(multianewarray) {
     uint16_t index = codeReadInt16(t, code, ip);
     uint8_t dimensions = codeBody(t, code, ip++);
 
@@ -2338,9 +2927,9 @@ interpret3(Thread* t, const int base)
     populateMultiArray(t, array, counts, 0, dimensions);
 
     pushObject(t, array);
-  } goto loop;
+  } DISPATCH;
 
-  case new_: {
+  CASE(new_) {
     uint16_t index = codeReadInt16(t, code, ip);
     
     object class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
@@ -2349,9 +2938,9 @@ interpret3(Thread* t, const int base)
     initClass(t, class_);
 
     pushObject(t, make(t, class_));
-  } goto loop;
+  } DISPATCH;
 
-  case newarray: {
+  CASE(newarray) {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
@@ -2401,19 +2990,19 @@ interpret3(Thread* t, const int base)
         (t, Machine::NegativeArraySizeExceptionType, "%d", count);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case nop: goto loop;
+  CASE(nop) DISPATCH;
 
-  case pop_: {
+  CASE(pop_) {
     -- sp;
-  } goto loop;
+  } DISPATCH;
 
-  case pop2: {
+  CASE(pop2) {
     sp -= 2;
-  } goto loop;
+  } DISPATCH;
 
-  case putfield: {
+  CASE(putfield) {
     uint16_t index = codeReadInt16(t, code, ip);
     
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -2482,9 +3071,76 @@ interpret3(Thread* t, const int base)
     if (UNLIKELY(exception)) {
       goto throw_;
     }
-  } goto loop;
 
-  case putstatic: {
+    quickenFieldInstruction(t, code, ip - 3, field, bputfield_quick);
+  } DISPATCH;
+
+  CASE(bputfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    int32_t value = popInt(t);
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      cast<int8_t>(o, fieldOffset(t, field)) = value;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(sputfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    int32_t value = popInt(t);
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      cast<int16_t>(o, fieldOffset(t, field)) = value;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(iputfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    int32_t value = popInt(t);
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      cast<int32_t>(o, fieldOffset(t, field)) = value;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(lputfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    int64_t value = popLong(t);
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      cast<int64_t>(o, fieldOffset(t, field)) = value;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(aputfield_quick) {
+    object field = resolvedEntry(t, code, codeReadInt16(t, code, ip));
+    object value = popObject(t);
+    object o = popObject(t);
+
+    if (LIKELY(o)) {
+      set(t, o, fieldOffset(t, field), value);
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(putstatic) {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -2536,13 +3192,13 @@ interpret3(Thread* t, const int base)
 
     default: abort(t);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ret: {
+  CASE(ret) {
     ip = localInt(t, codeBody(t, code, ip));
-  } goto loop;
+  } DISPATCH;
 
-  case return_: {
+  CASE(return_) {
     object method = frameMethod(t, frame);
     if ((methodFlags(t, method) & ConstructorFlag)
         and (classVmFlags(t, methodClass(t, method)) & HasFinalMemberFlag))
@@ -2552,13 +3208,13 @@ interpret3(Thread* t, const int base)
 
     if (frame > base) {
       popFrame(t);
-      goto loop;
+      DISPATCH;
     } else {
       return 0;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case saload: {
+  CASE(saload) {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -2577,9 +3233,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case sastore: {
+  CASE(sastore) {
     int16_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -2599,20 +3255,20 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case sipush: {
+  CASE(sipush) {
     pushInt(t, static_cast<int16_t>(codeReadInt16(t, code, ip)));
-  } goto loop;
+  } DISPATCH;
 
-  case swap: {
+  CASE(swap) {
     uintptr_t tmp[2];
     memcpy(tmp                   , stack + ((sp - 1) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 2) * 2), tmp                   , BytesPerWord * 2);
-  } goto loop;
+  } DISPATCH;
 
-  case tableswitch: {
+  CASE(tableswitch) {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2626,15 +3282,15 @@ interpret3(Thread* t, const int base)
     
     if (key >= bottom and key <= top) {
       unsigned index = ip + ((key - bottom) * 4);
-      ip = base + codeReadInt32(t, code, index);
+      ip = branchTarget(t, base, codeReadInt32(t, code, index));
     } else {
-      ip = base + default_;
+      ip = branchTarget(t, base, default_);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case wide: goto wide;
+  CASE(wide) goto wide;
 
-  case impdep1: {
+  CASE(impdep1) {
     // this means we're invoking a virtual method on an instance of a
     // bootstrap class, so we need to load the real class to get the
     // real method and call it.
@@ -2656,47 +3312,47 @@ interpret3(Thread* t, const int base)
                  className(t, class_));
 
     ip -= 3;
-  } goto loop;
+  } DISPATCH;
 
-  default: abort(t);
+  DEFAULT abort(t);
   }
 
  wide:
   switch (codeBody(t, code, ip++)) {
   case aload: {
     pushObject(t, localObject(t, codeReadInt16(t, code, ip)));
-  } goto loop;
+  } DISPATCH;
 
   case astore: {
     setLocalObject(t, codeReadInt16(t, code, ip), popObject(t));
-  } goto loop;
+  } DISPATCH;
 
   case iinc: {
     uint16_t index = codeReadInt16(t, code, ip);
     int16_t count = codeReadInt16(t, code, ip);
     
     setLocalInt(t, index, localInt(t, index) + count);
-  } goto loop;
+  } DISPATCH;
 
   case iload: {
     pushInt(t, localInt(t, codeReadInt16(t, code, ip)));
-  } goto loop;
+  } DISPATCH;
 
   case istore: {
     setLocalInt(t, codeReadInt16(t, code, ip), popInt(t));
-  } goto loop;
+  } DISPATCH;
 
   case lload: {
     pushLong(t, localLong(t, codeReadInt16(t, code, ip)));
-  } goto loop;
+  } DISPATCH;
 
   case lstore: {
     setLocalLong(t, codeReadInt16(t, code, ip),  popLong(t));
-  } goto loop;
+  } DISPATCH;
 
   case ret: {
     ip = localInt(t, codeReadInt16(t, code, ip));
-  } goto loop;
+  } DISPATCH;
 
   default: abort(t);
   }
@@ -2708,7 +3364,7 @@ interpret3(Thread* t, const int base)
       checkStack(t, code);
       pushFrame(t, code);
     }
-  } goto loop;
+  } DISPATCH;
 
  throw_:
   if (DebugRun) {
@@ -2723,7 +3379,7 @@ interpret3(Thread* t, const int base)
       ip = exceptionHandlerIp(eh);
       pushObject(t, exception);
       exception = 0;
-      goto loop;
+      DISPATCH;
     }
   }
 
@@ -2946,7 +3602,8 @@ class MyProcessor: public Processor {
   virtual vm::Thread*
   makeThread(Machine* m, object javaThread, vm::Thread* parent)
   {
-    Thread* t = new (m->heap->allocate(sizeof(Thread) + m->stackSizeInBytes))
+    Thread* t = new (m->heap->allocator(Heap::ThreadMemory)->allocate
+                     (sizeof(Thread) + m->stackSizeInBytes))
       Thread(m, javaThread, parent);
     t->init();
     return t;
@@ -2994,7 +3651,7 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions, 0,
        objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, addendum, staticTable, loader, 0, 0);
+       fieldTable, methodTable, addendum, staticTable, loader, 0, 0, 0, 0);
   }
 
   virtual void
@@ -3003,6 +3660,12 @@ class MyProcessor: public Processor {
     // ignore
   }
 
+  virtual void
+  methodOverridden(vm::Thread*, object)
+  {
+    // ignore
+  }
+
   virtual void
   visitObjects(vm::Thread* vmt, Heap::Visitor* v)
   {
@@ -3059,7 +3722,8 @@ class MyProcessor: public Processor {
 
     if (t->sp + capacity < stackSizeInWords(t) / 2) {
       t->referenceFrame = new
-        (t->m->heap->allocate(sizeof(Thread::ReferenceFrame)))
+        (t->m->heap->allocator(Heap::JniMemory)->allocate
+         (sizeof(Thread::ReferenceFrame)))
         Thread::ReferenceFrame(t->referenceFrame, t->sp);
     
       return true;
@@ -3077,7 +3741,8 @@ class MyProcessor: public Processor {
     t->referenceFrame = f->next;
     t->sp = f->sp;
 
-    t->m->heap->free(f, sizeof(Thread::ReferenceFrame));
+    t->m->heap->allocator(Heap::JniMemory)->free
+      (f, sizeof(Thread::ReferenceFrame));
   }
 
   virtual object
@@ -3179,7 +3844,7 @@ class MyProcessor: public Processor {
 
   virtual object getStackTrace(vm::Thread* t, vm::Thread*) {
     // not implemented
-    return makeObjectArray(t, 0);
+    return makeTrace(t, 0u);
   }
 
   virtual void initialize(BootImage*, uint8_t*, unsigned) {
@@ -3236,12 +3901,17 @@ class MyProcessor: public Processor {
   }
 
   virtual void dispose(vm::Thread* t) {
-    t->m->heap->free(t, sizeof(Thread) + t->m->stackSizeInBytes);
+    t->m->heap->allocator(Heap::ThreadMemory)->free
+      (t, sizeof(Thread) + t->m->stackSizeInBytes);
   }
 
   virtual void dispose() {
     allocator->free(this, sizeof(*this));
   }
+
+  virtual void shutDown(vm::Thread*) {
+    // ignore
+  }
   
   System* s;
   Allocator* allocator;
@@ -20,6 +20,8 @@ namespace {
 
 namespace local {
 
+const bool UseFixedArrayElements = true;
+
 jint JNICALL
 AttachCurrentThread(Machine* m, Thread** t, void*)
 {
@@ -134,7 +136,8 @@ GetStringChars(Thread* t, jstring s, jboolean* isCopy)
   ENTER(t, Thread::ActiveState);
 
   jchar* chars = static_cast<jchar*>
-    (t->m->heap->allocate((stringLength(t, *s) + 1) * sizeof(jchar)));
+    (t->m->heap->allocator(Heap::JniMemory)->allocate
+     ((stringLength(t, *s) + 1) * sizeof(jchar)));
   stringChars(t, *s, chars);
 
   if (isCopy) *isCopy = true;
@@ -146,7 +149,8 @@ ReleaseStringChars(Thread* t, jstring s, const jchar* chars)
 {
   ENTER(t, Thread::ActiveState);
 
-  t->m->heap->free(chars, (stringLength(t, *s) + 1) * sizeof(jchar));
+  t->m->heap->allocator(Heap::JniMemory)->free
+    (chars, (stringLength(t, *s) + 1) * sizeof(jchar));
 }
 
 void JNICALL
@@ -203,7 +207,7 @@ GetStringUTFChars(Thread* t, jstring s, jboolean* isCopy)
 
   int length = stringUTFLength(t, *s);
   char* chars = static_cast<char*>
-    (t->m->heap->allocate(length + 1));
+    (t->m->heap->allocator(Heap::JniMemory)->allocate(length + 1));
   stringUTFChars(t, *s, chars, length);
 
   if (isCopy) *isCopy = true;
@@ -215,7 +219,8 @@ ReleaseStringUTFChars(Thread* t, jstring s, const char* chars)
 {
   ENTER(t, Thread::ActiveState);
 
-  t->m->heap->free(chars, stringLength(t, *s) + 1);
+  t->m->heap->allocator(Heap::JniMemory)->free
+    (chars, stringUTFLength(t, *s) + 1);
 }
 
 void JNICALL
@@ -241,8 +246,14 @@ newString(Thread* t, uintptr_t* arguments)
   const jchar* chars = reinterpret_cast<const jchar*>(arguments[0]);
   jsize size = arguments[1];
 
-  object a = makeCharArray(t, size);
-  if (size) {
+  object a;
+  if (asciiLength(chars, size) == static_cast<unsigned>(size)) {
+    a = makeByteArray(t, size);
+    for (jsize i = 0; i < size; ++i) {
+      byteArrayBody(t, a, i) = chars[i];
+    }
+  } else {
+    a = makeCharArray(t, size);
     memcpy(&charArrayBody(t, a, 0), chars, size * sizeof(jchar));
   }
 
@@ -1412,6 +1423,8 @@ callStaticVoidMethodV(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   va_list* a = reinterpret_cast<va_list*>(arguments[1]);
 
+  finishStartup(t);
+
   t->m->processor->invokeList(t, getStaticMethod(t, m), 0, true, *a);
 
   return 0;
@@ -1442,6 +1455,8 @@ callStaticVoidMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[1]);
 
+  finishStartup(t);
+
   t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a);
 
   return 0;
@@ -2459,7 +2474,8 @@ newGlobalRef(Thread* t, jobject o, bool weak)
       }
     }
 
-    Reference* r = new (t->m->heap->allocate(sizeof(Reference)))
+    Reference* r = new
+      (t->m->heap->allocator(Heap::JniMemory)->allocate(sizeof(Reference)))
       Reference(*o, &(t->m->jniReferences), weak);
 
     acquire(t, r);
@@ -2670,15 +2686,26 @@ NewDoubleArray(Thread* t, jsize length)
   return reinterpret_cast<jdoubleArray>(run(t, newArray, arguments));
 }
 
-jboolean* JNICALL
-GetBooleanArrayElements(Thread* t, jbooleanArray array, jboolean* isCopy)
+// Arrays allocated as fixed objects -- those larger than the large
+// object threshold -- never move, so native code may use their bodies
+// directly.  Others are copied, since a collection may move them
+// while the native code runs in the idle state.
+void*
+getArrayElements(Thread* t, object array, unsigned size, jboolean* isCopy)
 {
-  ENTER(t, Thread::ActiveState);
+  uint8_t* body = reinterpret_cast<uint8_t*>(array) + ArrayBody;
+
+  if (UseFixedArrayElements and objectFixed(t, array)) {
+    if (isCopy) {
+      *isCopy = false;
+    }
 
-  unsigned size = booleanArrayLength(t, *array) * sizeof(jboolean);
-  jboolean* p = static_cast<jboolean*>(t->m->heap->allocate(size));
+    return body;
+  }
+
+  void* p = t->m->heap->allocator(Heap::JniMemory)->allocate(size);
   if (size) {
-    memcpy(p, &booleanArrayBody(t, *array, 0), size);
+    memcpy(p, body, size);
   }
 
   if (isCopy) {
@@ -2688,58 +2715,66 @@ GetBooleanArrayElements(Thread* t, jbooleanArray array, jboolean* isCopy)
   return p;
 }
 
-jbyte* JNICALL
-GetByteArrayElements(Thread* t, jbyteArray array, jboolean* isCopy)
+void
+releaseArrayElements(Thread* t, object array, unsigned size, void* p,
+                     jint mode)
 {
-  ENTER(t, Thread::ActiveState);
+  uint8_t* body = reinterpret_cast<uint8_t*>(array) + ArrayBody;
 
-  unsigned size = byteArrayLength(t, *array) * sizeof(jbyte);
-  jbyte* p = static_cast<jbyte*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &byteArrayBody(t, *array, 0), size);
+  if (p == body) {
+    // not a copy, so there is nothing to write back or free
+    return;
   }
 
-  if (isCopy) {
-    *isCopy = true;
+  if (mode == 0 or mode == JNI_COMMIT) {
+    if (size) {
+      memcpy(body, p, size);
+    }
   }
 
-  return p;
+  if (mode == 0 or mode == JNI_ABORT) {
+    t->m->heap->allocator(Heap::JniMemory)->free(p, size);
+  }
 }
 
-jchar* JNICALL
-GetCharArrayElements(Thread* t, jcharArray array, jboolean* isCopy)
+jboolean* JNICALL
+GetBooleanArrayElements(Thread* t, jbooleanArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = charArrayLength(t, *array) * sizeof(jchar);
-  jchar* p = static_cast<jchar*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &charArrayBody(t, *array, 0), size);
-  }
+  return static_cast<jboolean*>
+    (getArrayElements
+     (t, *array, booleanArrayLength(t, *array) * sizeof(jboolean), isCopy));
+}
 
-  if (isCopy) {
-    *isCopy = true;
-  }
+jbyte* JNICALL
+GetByteArrayElements(Thread* t, jbyteArray array, jboolean* isCopy)
+{
+  ENTER(t, Thread::ActiveState);
 
-  return p;
+  return static_cast<jbyte*>
+    (getArrayElements
+     (t, *array, byteArrayLength(t, *array) * sizeof(jbyte), isCopy));
 }
 
-jshort* JNICALL
-GetShortArrayElements(Thread* t, jshortArray array, jboolean* isCopy)
+jchar* JNICALL
+GetCharArrayElements(Thread* t, jcharArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = shortArrayLength(t, *array) * sizeof(jshort);
-  jshort* p = static_cast<jshort*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &shortArrayBody(t, *array, 0), size);
-  }
+  return static_cast<jchar*>
+    (getArrayElements
+     (t, *array, charArrayLength(t, *array) * sizeof(jchar), isCopy));
+}
 
-  if (isCopy) {
-    *isCopy = true;
-  }
+jshort* JNICALL
+GetShortArrayElements(Thread* t, jshortArray array, jboolean* isCopy)
+{
+  ENTER(t, Thread::ActiveState);
 
-  return p;
+  return static_cast<jshort*>
+    (getArrayElements
+     (t, *array, shortArrayLength(t, *array) * sizeof(jshort), isCopy));
 }
 
 jint* JNICALL
@@ -2747,17 +2782,9 @@ GetIntArrayElements(Thread* t, jintArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = intArrayLength(t, *array) * sizeof(jint);
-  jint* p = static_cast<jint*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &intArrayBody(t, *array, 0), size);
-  }
-
-  if (isCopy) {
-    *isCopy = true;
-  }
-
-  return p;
+  return static_cast<jint*>
+    (getArrayElements
+     (t, *array, intArrayLength(t, *array) * sizeof(jint), isCopy));
 }
 
 jlong* JNICALL
@@ -2765,17 +2792,9 @@ GetLongArrayElements(Thread* t, jlongArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = longArrayLength(t, *array) * sizeof(jlong);
-  jlong* p = static_cast<jlong*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &longArrayBody(t, *array, 0), size);
-  }
-
-  if (isCopy) {
-    *isCopy = true;
-  }
-
-  return p;
+  return static_cast<jlong*>
+    (getArrayElements
+     (t, *array, longArrayLength(t, *array) * sizeof(jlong), isCopy));
 }
 
 jfloat* JNICALL
@@ -2783,17 +2802,9 @@ GetFloatArrayElements(Thread* t, jfloatArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = floatArrayLength(t, *array) * sizeof(jfloat);
-  jfloat* p = static_cast<jfloat*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &floatArrayBody(t, *array, 0), size);
-  }
-
-  if (isCopy) {
-    *isCopy = true;
-  }
-
-  return p;
+  return static_cast<jfloat*>
+    (getArrayElements
+     (t, *array, floatArrayLength(t, *array) * sizeof(jfloat), isCopy));
 }
 
 jdouble* JNICALL
@@ -2801,54 +2812,27 @@ GetDoubleArrayElements(Thread* t, jdoubleArray array, jboolean* isCopy)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = doubleArrayLength(t, *array) * sizeof(jdouble);
-  jdouble* p = static_cast<jdouble*>(t->m->heap->allocate(size));
-  if (size) {
-    memcpy(p, &doubleArrayBody(t, *array, 0), size);
-  }
-
-  if (isCopy) {
-    *isCopy = true;
-  }
-
-  return p;
+  return static_cast<jdouble*>
+    (getArrayElements
+     (t, *array, doubleArrayLength(t, *array) * sizeof(jdouble), isCopy));
 }
 
 void JNICALL
-ReleaseBooleanArrayElements(Thread* t, jbooleanArray array, jboolean* p,
-                            jint mode)
+ReleaseBooleanArrayElements(Thread* t, jbooleanArray array, jboolean* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = booleanArrayLength(t, *array) * sizeof(jboolean);
 
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&booleanArrayBody(t, *array, 0), p, size);
-    }
-  }
-
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, booleanArrayLength(t, *array) * sizeof(jboolean), p, mode);
 }
 
 void JNICALL
 ReleaseByteArrayElements(Thread* t, jbyteArray array, jbyte* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = byteArrayLength(t, *array) * sizeof(jbyte);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&byteArrayBody(t, *array, 0), p, size);
-    }
-  }
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, byteArrayLength(t, *array) * sizeof(jbyte), p, mode);
 }
 
 void JNICALL
@@ -2856,108 +2840,53 @@ ReleaseCharArrayElements(Thread* t, jcharArray array, jchar* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
 
-  unsigned size = charArrayLength(t, *array) * sizeof(jchar);
-
-  if (mode == 0 or mode == JNI_COMMIT) {    
-    if (size) {
-      memcpy(&charArrayBody(t, *array, 0), p, size);
-    }
-  }
-
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, charArrayLength(t, *array) * sizeof(jchar), p, mode);
 }
 
 void JNICALL
 ReleaseShortArrayElements(Thread* t, jshortArray array, jshort* p, jint mode)
 {
-  ENTER(t, Thread::ActiveState);  
-
-  unsigned size = shortArrayLength(t, *array) * sizeof(jshort);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&shortArrayBody(t, *array, 0), p, size);
-    }
-  }
+  ENTER(t, Thread::ActiveState);
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, shortArrayLength(t, *array) * sizeof(jshort), p, mode);
 }
 
 void JNICALL
 ReleaseIntArrayElements(Thread* t, jintArray array, jint* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = intArrayLength(t, *array) * sizeof(jint);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&intArrayBody(t, *array, 0), p, size);
-    }
-  }
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, intArrayLength(t, *array) * sizeof(jint), p, mode);
 }
 
 void JNICALL
 ReleaseLongArrayElements(Thread* t, jlongArray array, jlong* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = longArrayLength(t, *array) * sizeof(jlong);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&longArrayBody(t, *array, 0), p, size);
-    }
-  }
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, longArrayLength(t, *array) * sizeof(jlong), p, mode);
 }
 
 void JNICALL
 ReleaseFloatArrayElements(Thread* t, jfloatArray array, jfloat* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = floatArrayLength(t, *array) * sizeof(jfloat);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&floatArrayBody(t, *array, 0), p, size);
-    }
-  }
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, floatArrayLength(t, *array) * sizeof(jfloat), p, mode);
 }
 
 void JNICALL
-ReleaseDoubleArrayElements(Thread* t, jdoubleArray array, jdouble* p,
-                           jint mode)
+ReleaseDoubleArrayElements(Thread* t, jdoubleArray array, jdouble* p, jint mode)
 {
   ENTER(t, Thread::ActiveState);
-    
-  unsigned size = doubleArrayLength(t, *array) * sizeof(jdouble);
-
-  if (mode == 0 or mode == JNI_COMMIT) {
-    if (size) {
-      memcpy(&doubleArrayBody(t, *array, 0), p, size);
-    }
-  }
 
-  if (mode == 0 or mode == JNI_ABORT) {
-    t->m->heap->free(p, size);
-  }
+  releaseArrayElements
+    (t, *array, doubleArrayLength(t, *array) * sizeof(jdouble), p, mode);
 }
 
 void JNICALL
@@ -3146,7 +3075,7 @@ GetPrimitiveArrayCritical(Thread* t, jarray array, jboolean* isCopy)
   }
   
   if (isCopy) {
-    *isCopy = true;
+    *isCopy = false;
   }
 
   expect(t, *array);
@@ -3431,26 +3360,6 @@ struct JavaVMInitArgs {
   jboolean ignoreUnrecognized;
 };
 
-int
-parseSize(const char* s)
-{
-  unsigned length = strlen(s);
-  RUNTIME_ARRAY(char, buffer, length + 1);
-  if (length == 0) {
-    return 0;
-  } else if (s[length - 1] == 'k' or s[length - 1] == 'K') {
-    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
-    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
-    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024;
-  } else if (s[length - 1] == 'm' or s[length - 1] == 'M') {
-    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
-    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
-    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024 * 1024;
-  } else {
-    return atoi(s);
-  }
-}
-
 void
 append(char** p, const char* value, unsigned length, char tail)
 {
@@ -3476,11 +3385,25 @@ boot(Thread* t, uintptr_t*)
   setRoot(t, Machine::OutOfMemoryError,
           makeThrowable(t, Machine::OutOfMemoryErrorType));
 
+  setRoot(t, Machine::StackOverflowError,
+          makeThrowable(t, Machine::StackOverflowErrorType));
+
   setRoot(t, Machine::Shutdown, makeThrowable(t, Machine::ThrowableType));
 
-  setRoot(t, Machine::FinalizerThread, t->m->classpath->makeThread(t, t));
+  object finalizerThreads = makeArray(t, t->m->finalizeThreadCount);
+  PROTECT(t, finalizerThreads);
+
+  for (unsigned i = 0; i < t->m->finalizeThreadCount; ++i) {
+    object thread = t->m->classpath->makeThread(t, t);
+    threadDaemon(t, thread) = true;
+    set(t, finalizerThreads, ArrayBody + (i * BytesPerWord), thread);
+  }
 
-  threadDaemon(t, root(t, Machine::FinalizerThread)) = true;
+  setRoot(t, Machine::FinalizerThreads, finalizerThreads);
+
+  if (t->m->monitorProfile) {
+    startMonitorDumpThread(t);
+  }
 
   t->m->classpath->boot(t);
 
@@ -3754,9 +3677,9 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
     if (strncmp(a->options[i].optionString, "-X", 2) == 0) {
       const char* p = a->options[i].optionString + 2;
       if (strncmp(p, "mx", 2) == 0) {
-        heapLimit = local::parseSize(p + 2);
+        heapLimit = parseSize(p + 2);
       } else if (strncmp(p, "ss", 2) == 0) {
-        stackLimit = local::parseSize(p + 2);
+        stackLimit = parseSize(p + 2);
       } else if (strncmp(p, BOOTCLASSPATH_PREPEND_OPTION ":",
                          sizeof(BOOTCLASSPATH_PREPEND_OPTION)) == 0)
       {
@@ -3830,8 +3753,10 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   }
 
   Finder* bf = makeFinder
-    (s, h, RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary);
-  Finder* af = makeFinder(s, h, classpath, bootLibrary);
+    (s, h->allocator(Heap::FinderMemory),
+     RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary);
+  Finder* af = makeFinder
+    (s, h->allocator(Heap::FinderMemory), classpath, bootLibrary);
   Processor* p = makeProcessor(s, h, true);
 
   const char** properties = static_cast<const char**>
@@ -0,0 +1,120 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef LAST_MOVE_H
+#define LAST_MOVE_H
+
+#include "assembler.h"
+#include "target.h"
+
+namespace vm {
+
+// The most recent word-sized move between registers or between a
+// register and memory, remembered until the next instruction is
+// emitted so that a move which merely repeats, undoes or reloads it
+// may be dropped or replaced with a cheaper one.  Each backend passes
+// the current length of its code as the offset, and decides for
+// itself whether a Reload may become a register-to-register move.
+class LastMove {
+ public:
+  enum Match {
+    NoMatch,
+    Redundant, // repeats or undoes the last move
+    Reload // loads the memory the last move stored register a to
+  };
+
+  LastMove():
+    end(~0), size(0), aType(RegisterOperand), bType(RegisterOperand),
+    a(NoRegister), b(NoRegister), memory(NoRegister, 0)
+  { }
+
+  static bool sameMemory(Assembler::Memory* a, Assembler::Memory* b) {
+    return a->base == b->base and a->offset == b->offset
+      and a->index == b->index and a->scale == b->scale;
+  }
+
+  void forget() {
+    end = ~0;
+  }
+
+  void remember(unsigned offset, unsigned aSize, OperandType aType,
+                Assembler::Operand* a, unsigned bSize, OperandType bType,
+                Assembler::Operand* b)
+  {
+    if (aSize == bSize and aSize >= 4 and aSize <= TargetBytesPerWord
+        and (aType == RegisterOperand or aType == MemoryOperand)
+        and (bType == RegisterOperand or bType == MemoryOperand)
+        and (aType == RegisterOperand or bType == RegisterOperand))
+    {
+      this->end = offset;
+      this->size = aSize;
+      this->aType = aType;
+      this->bType = bType;
+      if (aType == RegisterOperand) {
+        this->a = *static_cast<Assembler::Register*>(a);
+      } else {
+        this->memory = *static_cast<Assembler::Memory*>(a);
+      }
+      if (bType == RegisterOperand) {
+        this->b = *static_cast<Assembler::Register*>(b);
+      } else {
+        this->memory = *static_cast<Assembler::Memory*>(b);
+      }
+    } else {
+      forget();
+    }
+  }
+
+  Match match(unsigned offset, unsigned aSize, OperandType aType,
+              Assembler::Operand* a, unsigned bSize, OperandType bType,
+              Assembler::Operand* b)
+  {
+    if (end != offset or aSize != bSize or aSize != size) {
+      return NoMatch;
+    }
+
+    if (aType == RegisterOperand and bType == RegisterOperand
+        and this->aType == RegisterOperand
+        and this->bType == RegisterOperand)
+    {
+      int from = static_cast<Assembler::Register*>(a)->low;
+      int to = static_cast<Assembler::Register*>(b)->low;
+      if ((from == this->a.low and to == this->b.low)
+          or (from == this->b.low and to == this->a.low))
+      {
+        return Redundant;
+      }
+    } else if (aType == MemoryOperand and bType == RegisterOperand
+               and this->aType == RegisterOperand
+               and this->bType == MemoryOperand
+               and sameMemory(static_cast<Assembler::Memory*>(a), &memory))
+    {
+      if (static_cast<Assembler::Register*>(b)->low == this->a.low) {
+        return Redundant;
+      } else {
+        return Reload;
+      }
+    }
+
+    return NoMatch;
+  }
+
+  unsigned end;
+  unsigned size;
+  OperandType aType;
+  OperandType bType;
+  Assembler::Register a;
+  Assembler::Register b;
+  Assembler::Memory memory;
+};
+
+} // namespace vm
+
+#endif//LAST_MOVE_H
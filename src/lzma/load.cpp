@@ -41,6 +41,13 @@ extern "C" {
 
 namespace {
 
+const unsigned PropHeaderSize = 5;
+const unsigned HeaderSize = 13;
+
+// We decode this much at a time and write it out before decoding
+// more, so the whole uncompressed library is never held in memory.
+const unsigned ChunkSize = 256 * 1024;
+
 int32_t
 read4(const uint8_t* in)
 {
@@ -62,6 +69,74 @@ myFree(void*, void* address)
   free(address);
 }
 
+// Decodes an LZMA stream (with its header) to the given file, one chunk
+// at a time.  Returns the number of bytes written, or -1 on error.
+long
+decodeToFile(int file, const uint8_t* in, SizeT inSize)
+{
+  if (inSize < HeaderSize) {
+    return -1;
+  }
+
+  SizeT expectedSize = read4(in + PropHeaderSize);
+
+  ISzAlloc allocator = { myAllocate, myFree };
+
+  CLzmaDec decoder;
+  LzmaDec_Construct(&decoder);
+  if (LzmaDec_Allocate(&decoder, in, PropHeaderSize, &allocator) != SZ_OK) {
+    return -1;
+  }
+  LzmaDec_Init(&decoder);
+
+  in += HeaderSize;
+  inSize -= HeaderSize;
+
+  long total = -1;
+  uint8_t* out = static_cast<uint8_t*>(malloc(ChunkSize));
+  if (out) {
+    SizeT written = 0;
+    while (true) {
+      SizeT outLength = ChunkSize;
+      SizeT inLength = inSize;
+      ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+      SRes r = LzmaDec_DecodeToBuf
+        (&decoder, out, &outLength, in, &inLength, LZMA_FINISH_ANY, &status);
+
+      in += inLength;
+      inSize -= inLength;
+
+      if (r != SZ_OK) {
+        break;
+      }
+
+      if (outLength) {
+        int c = write(file, out, outLength);
+        if (c < 0 or static_cast<SizeT>(c) != outLength) {
+          break;
+        }
+        written += outLength;
+      }
+
+      if (status == LZMA_STATUS_FINISHED_WITH_MARK) {
+        if (written == expectedSize) {
+          total = written;
+        }
+        break;
+      } else if (inLength == 0 and outLength == 0) {
+        // truncated input
+        break;
+      }
+    }
+
+    free(out);
+  }
+
+  LzmaDec_Free(&decoder, &allocator);
+
+  return total;
+}
+
 #if (defined __MINGW32__) || (defined _MSC_VER)
 
 void*
@@ -131,68 +206,46 @@ temporaryFileName(char* buffer, unsigned)
 int
 main(int ac, const char** av)
 {
-  const unsigned PropHeaderSize = 5;
-  const unsigned HeaderSize = 13;
-
-  SizeT inSize = SYMBOL(end) - SYMBOL(start);
-
-  int32_t outSize32 = read4(SYMBOL(start) + PropHeaderSize);
-  SizeT outSize = outSize32;
-
-  uint8_t* out = static_cast<uint8_t*>(malloc(outSize));
-  if (out) {
-    ISzAlloc allocator = { myAllocate, myFree };
-    ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
-
-    if (SZ_OK == LzmaDecode
-        (out, &outSize, SYMBOL(start) + HeaderSize, &inSize, SYMBOL(start),
-         PropHeaderSize, LZMA_FINISH_END, &status, &allocator))
-    {
-      const unsigned BufferSize = 1024;
-      char buffer[BufferSize];
-      const char* name = temporaryFileName(buffer, BufferSize);
-      if (name) {
-        int file = open(name, O_CREAT | O_EXCL | O_WRONLY | O_BINARY, S_IRWXU);
-        if (file != -1) {
-          SizeT result = write(file, out, outSize);
-          free(out);
-
-          if (close(file) == 0 and outSize == result) {
-            void* library = openLibrary(name);
-            unlink(name);
-
-            if (library) {
-              void* main = librarySymbol(library, "avianMain");
-              if (main) {
-                int (*mainFunction)(const char*, int, const char**);
-                memcpy(&mainFunction, &main, sizeof(void*));
-                return mainFunction(name, ac, av);
-              } else {
-                fprintf(stderr, "unable to find main in %s", name);
-              }
-            } else {
-              fprintf(stderr, "unable to load %s: %s\n", name,
-                      libraryError(library));
-            }
+  const unsigned BufferSize = 1024;
+  char buffer[BufferSize];
+  const char* name = temporaryFileName(buffer, BufferSize);
+  if (name) {
+    int file = open(name, O_CREAT | O_EXCL | O_WRONLY | O_BINARY, S_IRWXU);
+    if (file != -1) {
+      long result = decodeToFile
+        (file, SYMBOL(start), SYMBOL(end) - SYMBOL(start));
+
+      if (close(file) == 0 and result >= 0) {
+        void* library = openLibrary(name);
+        unlink(name);
+
+        if (library) {
+          void* main = librarySymbol(library, "avianMain");
+          if (main) {
+            int (*mainFunction)(const char*, int, const char**);
+            memcpy(&mainFunction, &main, sizeof(void*));
+            return mainFunction(name, ac, av);
           } else {
-            unlink(name);
-
-            fprintf(stderr, "close or write failed; tried %d, got %d; %s\n",
-                    static_cast<int>(outSize), static_cast<int>(result),
-                    strerror(errno));
+            fprintf(stderr, "unable to find main in %s", name);
           }
         } else {
-          fprintf(stderr, "unable to open %s\n", name);
+          fprintf(stderr, "unable to load %s: %s\n", name,
+                  libraryError(library));
         }
       } else {
-        fprintf(stderr, "unable to make temporary file name\n");
+        unlink(name);
+
+        if (result < 0) {
+          fprintf(stderr, "unable to decode LZMA data to %s\n", name);
+        } else {
+          fprintf(stderr, "close failed: %s\n", strerror(errno));
+        }
       }
     } else {
-      fprintf(stderr, "unable to decode LZMA data\n");
+      fprintf(stderr, "unable to open %s\n", name);
     }
   } else {
-    fprintf(stderr, "unable to allocate buffer of size %d\n",
-            static_cast<int>(outSize));
+    fprintf(stderr, "unable to make temporary file name\n");
   }
 
   return -1;
@@ -23,6 +23,10 @@ namespace {
 
 const bool DebugClassReader = false;
 
+const bool DeferCodeParsing = true;
+
+const bool PackFields = true;
+
 const unsigned NoByte = 0xFFFF;
 
 #ifdef USE_ATOMIC_OPERATIONS
@@ -157,6 +161,14 @@ visitAll(Thread* m, Thread* o, void (*visit)(Thread*, Thread*))
   visit(m, o);
 }
 
+void
+requestSafepoint(Thread* m, Thread* o)
+{
+  if (o != m and o->state == Thread::ActiveState) {
+    o->safepointRequested = 1;
+  }
+}
+
 void
 disposeNoRemove(Thread* m, Thread* o)
 {
@@ -217,12 +229,18 @@ turnOffTheLights(Thread* t)
     }
   }
 
+  for (object p = root(t, Machine::ClassFiles); p; p = pairSecond(t, p)) {
+    static_cast<System::Region*>(regionRegion(t, pairFirst(t, p)))->dispose();
+  }
+
   for (object p = root(t, Machine::VirtualFileFinders);
        p; p = finderNext(t, p))
   {
     static_cast<Finder*>(finderFinder(t, p))->dispose();
   }
 
+  disposeNativeSymbols(t);
+
   Machine* m = t->m;
 
   visitAll(t, t->m->rootThread, disposeNoRemove);
@@ -270,6 +288,43 @@ killZombies(Thread* t, Thread* o)
   }
 }
 
+void
+freeRetiredHeaps(Machine* m)
+{
+  for (RetiredHeap* r = m->retiredHeaps; r;) {
+    RetiredHeap* next = r->next;
+    m->heap->allocator(Heap::ThreadMemory)->free
+      (r->heap, r->sizeInWords * BytesPerWord);
+    m->heap->allocator(Heap::ThreadMemory)->free(r, sizeof(RetiredHeap));
+    r = next;
+  }
+  m->retiredHeaps = 0;
+  m->retiredFootprint = 0;
+}
+
+// Each thread's last monitor lookup is a weak reference: it is
+// cleared when the object becomes unreachable, so the cache neither
+// keeps the object alive nor delays its removeMonitor finalizer.
+void
+visitMonitorCaches(Thread* t, Heap::Visitor* v)
+{
+  if (t->lastMonitorObject) {
+    if (t->state == Thread::ZombieState
+        or t->m->heap->status(t->lastMonitorObject) == Heap::Unreachable)
+    {
+      t->lastMonitorObject = 0;
+      t->lastMonitor = 0;
+    } else {
+      v->visit(&(t->lastMonitorObject));
+      v->visit(&(t->lastMonitor));
+    }
+  }
+
+  for (Thread* c = t->child; c; c = c->peer) {
+    visitMonitorCaches(c, v);
+  }
+}
+
 unsigned
 footprint(Thread* t)
 {
@@ -357,6 +412,70 @@ walk(Thread*, Heap::Walker* w, uint32_t* mask, unsigned fixedSize,
   return true;
 }
 
+// Visits the references in the fixed part of an object as given by
+// mask.  The type generator writes an unrolled case for each mask
+// used by the VM's own types, and any other mask is scanned a bit at
+// a time.
+bool
+walkFixed(Heap::Walker* w, uint32_t mask)
+{
+  switch (mask) {
+#include "type-walks.cpp"
+
+  default:
+    for (unsigned i = 0; mask; ++i, mask >>= 1) {
+      if ((mask & 1) and not w->visit(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+// Like the walk above, but for objects whose whole mask fits in a
+// single word, which covers every internal type and most Java
+// classes, so the mask need not be copied or indexed.
+bool
+walk(Heap::Walker* w, uint32_t mask, unsigned fixedSize,
+     unsigned arrayElementSize, unsigned arrayLength)
+{
+  unsigned fixedSizeInWords = ceiling(fixedSize, BytesPerWord);
+  unsigned arrayElementSizeInWords
+    = ceiling(arrayElementSize, BytesPerWord);
+
+  uint32_t fixedMask;
+  uint32_t elementMask;
+  if (fixedSizeInWords < 32) {
+    fixedMask = mask & ((static_cast<uint32_t>(1) << fixedSizeInWords) - 1);
+    elementMask = mask >> fixedSizeInWords;
+    if (arrayElementSizeInWords < 32) {
+      elementMask &= (static_cast<uint32_t>(1) << arrayElementSizeInWords)
+        - 1;
+    }
+  } else {
+    fixedMask = mask;
+    elementMask = 0;
+  }
+
+  if (not walkFixed(w, fixedMask)) {
+    return false;
+  }
+
+  if (elementMask) {
+    for (unsigned i = 0; i < arrayLength; ++i) {
+      unsigned base = fixedSizeInWords + (i * arrayElementSizeInWords);
+      unsigned j = 0;
+      for (uint32_t m = elementMask; m; ++j, m >>= 1) {
+        if ((m & 1) and not w->visit(base + j)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
 object
 findInInterfaces(Thread* t, object class_, object name, object spec,
                  object (*find)(Thread*, object, object, object))
@@ -392,6 +511,7 @@ finalizerTargetUnreachable(Thread* t, Heap::Visitor* v, object* p)
     set(t, finalizer, FinalizerQueueTarget, finalizerTarget(t, finalizer));
     set(t, finalizer, FinalizerQueueNext, root(t, Machine::ObjectsToFinalize));
     setRoot(t, Machine::ObjectsToFinalize, finalizer);
+    ++ t->m->finalizeQueueLength;
   }
 }
 
@@ -412,6 +532,7 @@ referenceTargetUnreachable(Thread* t, Heap::Visitor* v, object* p)
 
     set(t, reference, CleanerQueueNext, root(t, Machine::ObjectsToClean));
     setRoot(t, Machine::ObjectsToClean, reference);
+    ++ t->m->finalizeQueueLength;
   } else {
     if (jreferenceQueue(t, *p)
         and t->m->heap->status(jreferenceQueue(t, *p)) != Heap::Unreachable)
@@ -493,6 +614,134 @@ clearTargetIfFinalizable(Thread* t, object r)
   }
 }
 
+const unsigned MinimumIdentityHashTableCapacity = 64;
+
+inline unsigned
+identityHashBucket(IdentityHashTable* table, object o)
+{
+  return (reinterpret_cast<uintptr_t>(o) / BytesPerWord)
+    & (table->capacity - 1);
+}
+
+void
+resizeIdentityHashTable(Machine* m, IdentityHashTable* table,
+                        unsigned capacity)
+{
+  if (table->buckets) {
+    m->heap->free(table->buckets, table->capacity * sizeof(IdentityHash*));
+  }
+
+  table->capacity = capacity;
+  table->buckets = static_cast<IdentityHash**>
+    (m->heap->allocate(capacity * sizeof(IdentityHash*)));
+  memset(table->buckets, 0, capacity * sizeof(IdentityHash*));
+
+  for (IdentityHash* h = table->list; h; h = h->next) {
+    IdentityHash** p = table->buckets + identityHashBucket(table, h->target);
+    h->bucketNext = *p;
+    *p = h;
+  }
+}
+
+void
+addIdentityHash(Machine* m, IdentityHashTable* table, IdentityHash* h)
+{
+  h->next = table->list;
+  table->list = h;
+  ++ table->count;
+
+  if (table->count > table->capacity) {
+    resizeIdentityHashTable
+      (m, table, max(table->capacity * 2, MinimumIdentityHashTableCapacity));
+  } else {
+    IdentityHash** p = table->buckets + identityHashBucket(table, h->target);
+    h->bucketNext = *p;
+    *p = h;
+  }
+}
+
+// Follows the target of the specified identity hash to wherever the
+// collector has moved it, marking it as such if it has, and returns
+// false if the target is unreachable.
+bool
+followIdentityHash(Thread* t, Heap::Visitor* v, IdentityHash* h)
+{
+  if (t->m->heap->status(h->target) == Heap::Unreachable) {
+    return false;
+  }
+
+  object old = h->target;
+  v->visit(&(h->target));
+
+  if (h->target != old and hashTaken(t, h->target)) {
+    alias(h->target, 0) &= PointerMask;
+    alias(h->target, 0) |= HashMovedMark;
+  }
+
+  return true;
+}
+
+// Updates the identity hash tables after the collector has moved
+// their objects, dropping the hashes of unreachable ones.  As with
+// weak references, hashes of tenured objects are set aside so that
+// minor collections need not look at them.
+void
+updateIdentityHashes(Thread* t, Heap::Visitor* v, bool major)
+{
+  Machine* m = t->m;
+  IdentityHashTable* young = &(m->identityHashes);
+  IdentityHashTable* tenured = &(m->tenuredIdentityHashes);
+
+  IdentityHashTable* tables[] = { tenured, young };
+  for (unsigned i = major ? 0 : 1; i < 2; ++i) {
+    IdentityHashTable* table = tables[i];
+
+    IdentityHash* list = table->list;
+    table->list = 0;
+    table->count = 0;
+    if (table->buckets) {
+      memset(table->buckets, 0, table->capacity * sizeof(IdentityHash*));
+    }
+
+    for (IdentityHash* h = list; h;) {
+      IdentityHash* next = h->next;
+
+      if (followIdentityHash(t, v, h)) {
+        // a tenured hash stays tenured, so nothing is added to the
+        // young table before it is rebuilt below
+        addIdentityHash
+          (m, table == tenured
+           or m->heap->status(h->target) == Heap::Tenured ? tenured : young,
+           h);
+      } else {
+        m->heap->free(h, sizeof(IdentityHash));
+      }
+
+      h = next;
+    }
+
+    if (table->capacity > MinimumIdentityHashTableCapacity
+        and table->count < table->capacity / 4)
+    {
+      resizeIdentityHashTable(m, table, table->capacity / 2);
+    }
+  }
+}
+
+void
+disposeIdentityHashTable(Machine* m, IdentityHashTable* table)
+{
+  for (IdentityHash* h = table->list; h;) {
+    IdentityHash* next = h->next;
+    m->heap->free(h, sizeof(IdentityHash));
+    h = next;
+  }
+
+  if (table->buckets) {
+    m->heap->free(table->buckets, table->capacity * sizeof(IdentityHash*));
+  }
+}
+
 void
 postVisit(Thread* t, Heap::Visitor* v)
 {
@@ -525,6 +774,12 @@ postVisit(Thread* t, Heap::Visitor* v)
     }
   }
 
+  // this must happen before the finalizers below make unreachable
+  // objects reachable again
+  for (Thread* c = m->rootThread; c; c = c->peer) {
+    visitMonitorCaches(c, v);
+  }
+
   object firstNewTenuredFinalizer = 0;
   object lastNewTenuredFinalizer = 0;
 
@@ -646,31 +901,65 @@ postVisit(Thread* t, Heap::Visitor* v)
       }
     }
   }
+
+  if (UseIdentityHashTable) {
+    updateIdentityHashes(t, v, major);
+  }
+}
+
+// Returns the size in words the default heap of the specified thread
+// should have after a collection: larger if the thread outgrew it
+// since the last one, smaller if it used less than a quarter of it.
+unsigned
+adaptDefaultHeapSize(Thread* t)
+{
+  unsigned size = t->defaultHeapSizeInWords;
+  if (t->heapRefillCount) {
+    if (not t->m->heap->limitExceeded()) {
+      size = min(size * 2, ThreadHeapSizeInWords);
+    }
+  } else if (t->heapIndex < size / 4) {
+    size = max(size / 2, MinimumThreadHeapSizeInWords);
+  }
+  return size;
 }
 
 void
 postCollect(Thread* t)
 {
+  t->allocationSinceSample += t->heapIndex * BytesPerWord;
+
+  unsigned size = adaptDefaultHeapSize(t);
+
 #ifdef VM_STRESS
-  t->m->heap->free(t->defaultHeap, ThreadHeapSizeInBytes);
-  t->defaultHeap = static_cast<uintptr_t*>
-    (t->m->heap->allocate(ThreadHeapSizeInBytes));
-  memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
+  bool reallocate = true;
+#else
+  bool reallocate = size != t->defaultHeapSizeInWords;
 #endif
 
-  if (t->heap == t->defaultHeap) {
+  if (reallocate) {
+    t->m->heap->allocator(Heap::ThreadMemory)->free
+      (t->defaultHeap, t->defaultHeapSizeInWords * BytesPerWord);
+    t->defaultHeap = static_cast<uintptr_t*>
+      (t->m->heap->allocator(Heap::ThreadMemory)->allocate
+       (size * BytesPerWord));
+    t->defaultHeapSizeInWords = size;
+    memset(t->defaultHeap, 0, size * BytesPerWord);
+  } else if (t->heap == t->defaultHeap) {
     memset(t->defaultHeap, 0, t->heapIndex * BytesPerWord);
   } else {
-    memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
-    t->heap = t->defaultHeap;
+    memset(t->defaultHeap, 0, t->defaultHeapSizeInWords * BytesPerWord);
   }
 
+  t->heap = t->defaultHeap;
+  t->heapSizeInWords = t->defaultHeapSizeInWords;
   t->heapOffset = 0;
+  t->heapRefillCount = 0;
 
   if (t->m->heap->limitExceeded()) {
     // if we're out of memory, pretend the thread-local heap is
     // already full so we don't make things worse:
-    t->heapIndex = ThreadHeapSizeInWords;
+    t->heapIndex = t->heapSizeInWords;
   } else {
     t->heapIndex = 0;
   }
@@ -796,8 +1085,21 @@ object
 parseUtf8(Thread* t, AbstractStream& s, unsigned length)
 {
   object value = makeByteArray(t, length + 1);
-  unsigned vi = 0;
-  for (unsigned si = 0; si < length; ++si) {
+
+  // read everything at once and only fall back to decoding byte by
+  // byte from the first non-ASCII byte on
+  unsigned start = s.position();
+  uint8_t* body = reinterpret_cast<uint8_t*>(&byteArrayBody(t, value, 0));
+  s.read(body, length);
+
+  unsigned vi = asciiLength(body, length);
+  if (vi == length) {
+    return value;
+  }
+
+  s.setPosition(start + vi);
+
+  for (unsigned si = vi; si < length; ++si) {
     unsigned a = s.read1();
     if (a & 0x80) {
       if (a & 0x20) {
@@ -849,11 +1151,17 @@ removeByteArray(Thread* t, object o)
 object
 internByteArray(Thread* t, object array)
 {
+  object n = hashMapFindNode
+    (t, root(t, Machine::ByteArrayMap), array, byteArrayHash, byteArrayEqual);
+  if (n) {
+    return jreferenceTarget(t, tripleFirst(t, n));
+  }
+
   PROTECT(t, array);
 
   ACQUIRE(t, t->m->referenceLock);
 
-  object n = hashMapFindNode
+  n = hashMapFindNode
     (t, root(t, Machine::ByteArrayMap), array, byteArrayHash, byteArrayEqual);
   if (n) {
     return jreferenceTarget(t, tripleFirst(t, n));
@@ -922,10 +1230,16 @@ parsePoolEntry(Thread* t, Stream& s, uint32_t* index, object pool, unsigned i)
       unsigned si = s.read2() - 1;
       parsePoolEntry(t, s, index, pool, si);
         
-      object value = parseUtf8(t, singletonObject(t, pool, si));
-      value = t->m->classpath->makeString
-        (t, value, 0, cast<uintptr_t>(value, BytesPerWord) - 1);
-      value = intern(t, value);
+      object utf8 = singletonObject(t, pool, si);
+      object value;
+      if (isAscii(t, utf8)) {
+        value = internAscii(t, utf8, 0, byteArrayLength(t, utf8) - 1);
+      } else {
+        value = parseUtf8(t, utf8);
+        value = t->m->classpath->makeString
+          (t, value, 0, cast<uintptr_t>(value, BytesPerWord) - 1);
+        value = intern(t, value);
+      }
       set(t, pool, SingletonBody + (i * BytesPerWord), value);
 
       if(DebugClassReader) {
@@ -992,10 +1306,12 @@ parsePool(Thread* t, Stream& s)
   }
 
   if (count) {
-    uint32_t* index = static_cast<uint32_t*>(t->m->heap->allocate(count * 4));
+    uint32_t* index = static_cast<uint32_t*>
+      (t->m->heap->allocator(Heap::ClassMemory)->allocate(count * 4));
 
     THREAD_RESOURCE2(t, uint32_t*, index, unsigned, count,
-                     t->m->heap->free(index, count * 4));
+                     t->m->heap->allocator(Heap::ClassMemory)->free
+                     (index, count * 4));
 
     for (unsigned i = 0; i < count; ++i) {
       index[i] = s.position();
@@ -1073,8 +1389,8 @@ addInterfaces(Thread* t, object class_, object map)
     for (unsigned i = 0; i < arrayLength(t, table); i += increment) {
       object interface = arrayBody(t, table, i);
       object name = className(t, interface);
-      hashMapInsertMaybe(t, map, name, interface, byteArrayHash,
-                         byteArrayEqual);
+      hashTableInsertMaybe(t, map, name, interface, byteArrayHash,
+                           byteArrayEqual);
     }
   }
 }
@@ -1099,7 +1415,7 @@ parseInterfaceTable(Thread* t, Stream& s, object class_, object pool,
   PROTECT(t, class_);
   PROTECT(t, pool);
   
-  object map = makeHashMap(t, 0, 0);
+  object map = makeHashTable(t, 0, 0);
   PROTECT(t, map);
 
   if (classSuper(t, class_)) {
@@ -1128,14 +1444,15 @@ parseInterfaceTable(Thread* t, Stream& s, object class_, object pool,
 
     set(t, table, ArrayBody + (i * BytesPerWord), interface);
 
-    hashMapInsertMaybe(t, map, name, interface, byteArrayHash, byteArrayEqual);
+    hashTableInsertMaybe
+      (t, map, name, interface, byteArrayHash, byteArrayEqual);
 
     addInterfaces(t, interface, map);
   }
 
   object interfaceTable = 0;
-  if (hashMapSize(t, map)) {
-    unsigned length = hashMapSize(t, map);
+  if (hashTableSize(t, map)) {
+    unsigned length = hashTableSize(t, map);
     if ((classFlags(t, class_) & ACC_INTERFACE) == 0) {
       length *= 2;
     }
@@ -1143,8 +1460,12 @@ parseInterfaceTable(Thread* t, Stream& s, object class_, object pool,
     PROTECT(t, interfaceTable);
 
     unsigned i = 0;
-    for (HashMapIterator it(t, map); it.hasMore();) {
-      object interface = tripleSecond(t, it.next());
+    for (unsigned slot = 0; slot < hashTableCapacity(t, map); ++slot) {
+      if (hashTableKey(t, map, slot) == 0) {
+        continue;
+      }
+
+      object interface = hashTableValue(t, map, slot);
 
       set(t, interfaceTable, ArrayBody + (i * BytesPerWord), interface);
       ++ i;
@@ -1166,6 +1487,32 @@ parseInterfaceTable(Thread* t, Stream& s, object class_, object pool,
   set(t, class_, ClassInterfaceTable, interfaceTable);
 }
 
+unsigned
+fieldLayoutGroup(unsigned code)
+{
+  switch (code) {
+  case LongField:
+  case DoubleField:
+    return 0;
+
+  case ObjectField:
+    return 1;
+
+  case IntField:
+  case FloatField:
+    return 2;
+
+  case CharField:
+  case ShortField:
+    return 3;
+
+  default:
+    return 4;
+  }
+}
+
+const unsigned FieldLayoutGroupCount = 5;
+
 void
 parseFieldTable(Thread* t, Stream& s, object class_, object pool)
 {
@@ -1266,18 +1613,8 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
         intArrayBody(t, staticValueTable, staticCount) = value;
 
         RUNTIME_ARRAY_BODY(staticTypes)[staticCount++] = code;
-      } else {
-        if (flags & ACC_FINAL) {
-          classVmFlags(t, class_) |= HasFinalMemberFlag;
-        }
-
-        while (memberOffset % size) {
-          ++ memberOffset;
-        }
-
-        fieldOffset(t, field) = memberOffset;
-
-        memberOffset += size;
+      } else if (flags & ACC_FINAL) {
+        classVmFlags(t, class_) |= HasFinalMemberFlag;
       }
 
       set(t, fieldTable, ArrayBody + (i * BytesPerWord), field);
@@ -1285,6 +1622,37 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
 
     set(t, class_, ClassFieldTable, fieldTable);
 
+    // The VM and the type generator agree on the layout of the
+    // classes declared in types.def, so those keep their declaration
+    // order.  Other classes get their instance fields grouped by size
+    // (with references kept together), which avoids alignment padding
+    // between them.
+    bool pack = PackFields and hashMapFind
+      (t, root(t, Machine::BootstrapClassMap), className(t, class_),
+       byteArrayHash, byteArrayEqual) == 0;
+
+    for (unsigned group = 0;
+         group < (pack ? FieldLayoutGroupCount : 1);
+         ++ group)
+    {
+      for (unsigned i = 0; i < count; ++i) {
+        object field = arrayBody(t, fieldTable, i);
+        if ((fieldFlags(t, field) & ACC_STATIC) == 0
+            and ((not pack)
+                 or fieldLayoutGroup(fieldCode(t, field)) == group))
+        {
+          unsigned size = fieldSize(t, fieldCode(t, field));
+          while (memberOffset % size) {
+            ++ memberOffset;
+          }
+
+          fieldOffset(t, field) = memberOffset;
+
+          memberOffset += size;
+        }
+      }
+    }
+
     if (staticCount) {
       unsigned footprint = ceiling(staticOffset - (BytesPerWord * 2),
                                    BytesPerWord);
@@ -1784,7 +2152,8 @@ parseCode(Thread* t, Stream& s, object pool)
     fprintf(stderr, "    code: maxStack %d maxLocals %d length %d\n", maxStack, maxLocals, length);
   }
 
-  object code = makeCode(t, pool, 0, 0, 0, 0, maxStack, maxLocals, length);
+  object code = makeCode
+    (t, pool, 0, 0, 0, 0, 0, maxStack, maxLocals, length);
   s.read(&codeBody(t, code, 0), length);
   PROTECT(t, code);
 
@@ -1857,9 +2226,9 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
       if (vtable) {
         for (unsigned j = 0; j < arrayLength(t, vtable); ++j) {
           method = arrayBody(t, vtable, j);
-          object n = hashMapFindNode
-            (t, virtualMap, method, methodHash, methodEqual);
-          if (n == 0) {
+          if (hashTableFind
+              (t, virtualMap, method, methodHash, methodEqual) < 0)
+          {
             method = makeMethod
               (t,
                methodVmFlags(t, method),
@@ -1876,7 +2245,7 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
                class_,
                0);
 
-            hashMapInsert(t, virtualMap, method, method, methodHash);
+            hashTableInsert(t, virtualMap, method, method, methodHash);
 
             if (makeList) {
               if (list == 0) {
@@ -1896,12 +2265,13 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
 }
 
 void
-parseMethodTable(Thread* t, Stream& s, object class_, object pool)
+parseMethodTable(Thread* t, Stream& s, object class_, object pool,
+                 System::Region* region)
 {
   PROTECT(t, class_);
   PROTECT(t, pool);
 
-  object virtualMap = makeHashMap(t, 0, 0);
+  object virtualMap = makeHashTable(t, 0, 0);
   PROTECT(t, virtualMap);
 
   unsigned virtualCount = 0;
@@ -1921,7 +2291,7 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       virtualCount = arrayLength(t, superVirtualTable);
       for (unsigned i = 0; i < virtualCount; ++i) {
         object method = arrayBody(t, superVirtualTable, i);
-        hashMapInsert(t, virtualMap, method, method, methodHash);
+        hashTableInsert(t, virtualMap, method, method, methodHash);
       }
     }
   }
@@ -1967,7 +2337,19 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
         if (vm::strcmp(reinterpret_cast<const int8_t*>("Code"),
                        &byteArrayBody(t, attributeName, 0)) == 0)
         {
-          code = parseCode(t, s, pool);
+          if (region) {
+            // leave the rest for parseDeferredCode, keeping just what
+            // callers need to know before the method is first run
+            object classFile = makeRegion(t, region, s.position());
+            unsigned maxStack = s.read2();
+            unsigned maxLocals = s.read2();
+            s.skip(length - 4);
+
+            code = makeCode
+              (t, pool, 0, 0, classFile, 0, 0, maxStack, maxLocals, 0);
+          } else {
+            code = parseCode(t, s, pool);
+          }
         } else if (vm::strcmp(reinterpret_cast<const int8_t*>("Exceptions"),
                               &byteArrayBody(t, attributeName, 0)) == 0)
         {
@@ -2046,19 +2428,35 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       if (methodVirtual(t, method)) {
         ++ declaredVirtualCount;
 
-        object p = hashMapFindNode
+        int slot = hashTableFind
           (t, virtualMap, method, methodHash, methodEqual);
 
-        if (p) {
-          methodOffset(t, method) = methodOffset(t, tripleFirst(t, p));
+        if (slot >= 0) {
+          methodOffset(t, method) = methodOffset
+            (t, hashTableKey(t, virtualMap, slot));
 
-          set(t, p, TripleSecond, method);
+          hashTableSetValue(t, virtualMap, slot, method);
+
+          // let the processor know that calls to the overridden
+          // method may no longer be bound to it directly:
+          object overridden = hashTableKey(t, virtualMap, slot);
+          if ((methodVmFlags(t, overridden) & OverriddenFlag) == 0) {
+            PROTECT(t, overridden);
+
+            ACQUIRE(t, t->m->classLock);
+
+            if ((methodVmFlags(t, overridden) & OverriddenFlag) == 0) {
+              methodVmFlags(t, overridden) |= OverriddenFlag;
+
+              t->m->processor->methodOverridden(t, overridden);
+            }
+          }
         } else {
           methodOffset(t, method) = virtualCount++;
 
           listAppend(t, newVirtuals, method);
 
-          hashMapInsert(t, virtualMap, method, method, methodHash);
+          hashTableInsert(t, virtualMap, method, method, methodHash);
         }
 
         if (UNLIKELY((classFlags(t, class_) & ACC_INTERFACE) == 0
@@ -2139,8 +2537,14 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
     if (classFlags(t, class_) & ACC_INTERFACE) {
       PROTECT(t, vtable);
 
-      for (HashMapIterator it(t, virtualMap); it.hasMore();) {
-        object method = tripleFirst(t, it.next());
+      for (unsigned slot = 0; slot < hashTableCapacity(t, virtualMap);
+           ++slot)
+      {
+        object method = hashTableKey(t, virtualMap, slot);
+        if (method == 0) {
+          continue;
+        }
+
         assert(t, arrayBody(t, vtable, methodOffset(t, method)) == 0);
         set(t, vtable, ArrayBody + (methodOffset(t, method) * BytesPerWord),
             method);
@@ -2152,7 +2556,8 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       if (superVirtualTable) {
         for (; i < arrayLength(t, superVirtualTable); ++i) {
           object method = arrayBody(t, superVirtualTable, i);
-          method = hashMapFind(t, virtualMap, method, methodHash, methodEqual);
+          method = hashTableGet
+            (t, virtualMap, method, methodHash, methodEqual);
 
           set(t, vtable, ArrayBody + (i * BytesPerWord), method);
         }
@@ -2219,7 +2624,7 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
         
           for (unsigned j = 0; j < arrayLength(t, ivtable); ++j) {
             object method = arrayBody(t, ivtable, j);
-            method = hashMapFind
+            method = hashTableGet
               (t, virtualMap, method, methodHash, methodEqual);
             assert(t, method);
               
@@ -2292,6 +2697,30 @@ parseAttributeTable(Thread* t, Stream& s, object class_, object pool)
   }
 }
 
+// Returns the superclasses of the specified class, ordered from
+// java.lang.Object down to and including the class itself, so that
+// isAssignableFrom can tell whether one class extends another by
+// comparing a single element at the depth of the superclass.
+object
+makeDisplay(Thread* t, object class_)
+{
+  PROTECT(t, class_);
+
+  unsigned depth = 0;
+  for (object c = classSuper(t, class_); c; c = classSuper(t, c)) {
+    ++ depth;
+  }
+
+  object display = makeArray(t, depth + 1);
+
+  unsigned i = depth;
+  for (object c = class_; c; c = classSuper(t, c)) {
+    set(t, display, ArrayBody + ((i--) * BytesPerWord), c);
+  }
+
+  return display;
+}
+
 void
 updateClassTables(Thread* t, object newClass, object oldClass)
 {
@@ -2323,6 +2752,11 @@ updateClassTables(Thread* t, object newClass, object oldClass)
         set(t, arrayBody(t, methodTable, i), MethodClass, newClass);
       }
     }
+
+    PROTECT(t, newClass);
+
+    object display = makeDisplay(t, newClass);
+    set(t, newClass, ClassDisplay, display);
   }
 }
 
@@ -2728,7 +3162,7 @@ boot(Thread* t)
 
   m->processor->boot(t, 0, 0);
 
-  { object bootCode = makeCode(t, 0, 0, 0, 0, 0, 0, 0, 1);
+  { object bootCode = makeCode(t, 0, 0, 0, 0, 0, 0, 0, 0, 1);
     codeBody(t, bootCode, 0) = impdep1;
     object bootMethod = makeMethod
       (t, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, bootCode);
@@ -2749,7 +3183,11 @@ class HeapClient: public Heap::Client {
   virtual void visitRoots(Heap::Visitor* v) {
     ::visitRoots(m, v);
 
+    int64_t start = m->system->nowMicroseconds();
+
     postVisit(m->rootThread, v);
+
+    m->referenceTime = m->system->nowMicroseconds() - start;
   }
 
   virtual void collect(void* context, Heap::CollectionType type) {
@@ -2784,7 +3222,9 @@ class HeapClient: public Heap::Client {
     unsigned n = baseSize(t, o, static_cast<object>
                           (m->heap->follow(objectClass(t, o))));
 
-    if (objectExtended(t, o) or hashTaken(t, o)) {
+    if (objectExtended(t, o)
+        or ((not UseIdentityHashTable) and hashTaken(t, o)))
+    {
       ++ n;
     }
 
@@ -2807,7 +3247,7 @@ class HeapClient: public Heap::Client {
 
     memcpy(dst, src, n * BytesPerWord);
 
-    if (hashTaken(t, src)) {
+    if ((not UseIdentityHashTable) and hashTaken(t, src)) {
       alias(dst, 0) &= PointerMask;
       alias(dst, 0) |= ExtendedMark;
       extendedWord(t, dst, base) = takeHash(t, src);
@@ -2827,46 +3267,544 @@ class HeapClient: public Heap::Client {
   Machine* m;
 };
 
+FILE* heapStatisticsLog = 0;
+
+// Writes a line describing the thread-local heap usage since the last
+// collection to the file named by the avian.heap.stats property, if
+// any: the number of heap pool buffers taken, the words left unused
+// at the end of the buffers they replaced, and the words of pool
+// memory in use.
 void
-doCollect(Thread* t, Heap::CollectionType type)
+logHeapStatistics(Thread* t, Heap::CollectionType type)
 {
-  expect(t, not t->m->collecting);
-
-  t->m->collecting = true;
-  THREAD_RESOURCE0(t, t->m->collecting = false);
+  static bool open = false;
+  if (not open) {
+    open = true;
+    const char* path = findProperty(t, "avian.heap.stats");
+    if (path) {
+      heapStatisticsLog = vm::fopen(path, "wb");
+      if (heapStatisticsLog) {
+        fprintf(heapStatisticsLog, "# collection\trefills\twaste\tpool\n");
+      }
+    }
+  }
 
-#ifdef VM_STRESS
-  bool stress = (t->flags & Thread::StressFlag) != 0;
-  if (not stress) atomicOr(&(t->flags), Thread::StressFlag);
-#endif
+  if (heapStatisticsLog) {
+    fprintf(heapStatisticsLog, "%s\t%u\t%u\t%u\n",
+            type == Heap::MinorCollection ? "minor" : "major",
+            t->m->heapRefillCount,
+            t->m->heapWasteFootprint,
+            t->m->heapPoolFootprint);
+    fflush(heapStatisticsLog);
+  }
+}
 
-  Machine* m = t->m;
+FILE* collectionLog = 0;
 
-  m->unsafe = true;
-  m->heap->collect(type, footprint(m->rootThread));
-  m->unsafe = false;
+// Writes a line describing the collection just finished to the file
+// named by the avian.gc.log property, if any: its type, its pause,
+// the bytes in each generation before and after it, the bytes
+// promoted to the old generation, the bytes of young and tenured
+// fixed objects, the time spent processing references and running
+// native finalizers, the time spent reaching a safepoint, and the
+// number of finalizers and cleaners left queued for the finalizer
+// threads.  Times are in microseconds.
+void
+logCollection(Thread* t, int64_t finalizerTime)
+{
+  static bool open = false;
+  if (not open) {
+    open = true;
+    const char* path = findProperty(t, "avian.gc.log");
+    if (path) {
+      collectionLog = vm::fopen(path, "wb");
+      if (collectionLog) {
+        fprintf(collectionLog, "# collection\tpause\tgen1 before\tgen1 after"
+                "\tgen2 before\tgen2 after\tpromoted\tfixies"
+                "\ttenured fixies\treferences\tfinalizers\tsafepoint"
+                "\tfinalize queue\n");
+      }
+    }
+  }
 
-  postCollect(m->rootThread);
+  const Heap::Statistics* s = t->m->heap->statistics();
 
-  killZombies(t, m->rootThread);
+  unsigned bucket = 0;
+  while (bucket < PauseHistogramSize - 1
+         and (static_cast<int64_t>(1) << (bucket + 1)) <= s->pause)
+  {
+    ++ bucket;
+  }
+  ++ t->m->pauseHistogram[bucket];
+
+  if (collectionLog) {
+    fprintf(collectionLog, "%s\t%" LLD "\t%u\t%u\t%u\t%u\t%u\t%u\t%u"
+            "\t%" LLD "\t%" LLD "\t%" LLD "\t%u\n",
+            s->type == Heap::MinorCollection ? "minor" : "major",
+            s->pause,
+            s->gen1Before,
+            s->gen1After,
+            s->gen2Before,
+            s->gen2After,
+            s->promoted,
+            s->untenuredFixies,
+            s->tenuredFixies,
+            t->m->referenceTime,
+            finalizerTime,
+            t->m->safepointTime,
+            t->m->finalizeQueueLength);
+    fflush(collectionLog);
+  }
+}
 
-  for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
-    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+// Appends the histogram of collection pauses to the avian.gc.log
+// file, one line per non-empty bucket giving the bucket's lower
+// bound in microseconds and the number of pauses in it.
+void
+logPauseHistogram(Machine* m)
+{
+  if (collectionLog) {
+    fprintf(collectionLog, "# pause\tcollections\n");
+    for (unsigned i = 0; i < PauseHistogramSize; ++i) {
+      if (m->pauseHistogram[i]) {
+        fprintf(collectionLog, "# %" LLD "\t%u\n",
+                i ? static_cast<int64_t>(1) << i : 0,
+                m->pauseHistogram[i]);
+      }
+    }
+    fflush(collectionLog);
   }
-  m->heapPoolIndex = 0;
+}
 
-  if (m->heap->limitExceeded()) {
-    // if we're out of memory, disallow further allocations of fixed
-    // objects:
-    m->fixedFootprint = FixedFootprintThresholdInBytes;
-  } else {
-    m->fixedFootprint = 0;
+// Adds the specified number of bytes to the allocation site for the
+// stack of the specified thread, which the caller has already
+// collapsed into the specified string.
+void
+addAllocationSample(Machine* m, const char* stack, unsigned length,
+                    unsigned footprint)
+{
+  uint32_t h = 0;
+  for (unsigned i = 0; i < length; ++i) {
+    h = (h * 31) + stack[i];
   }
 
-#ifdef VM_STRESS
+  AllocationSite** p = m->allocationSites + (h % AllocationSiteTableSize);
+  for (AllocationSite* s = *p; s; s = s->next) {
+    if (s->length == length
+        and memcmp(reinterpret_cast<char*>(s + 1), stack, length) == 0)
+    {
+      s->footprint += footprint;
+      return;
+    }
+  }
+
+  AllocationSite* s = static_cast<AllocationSite*>
+    (m->heap->allocate(sizeof(AllocationSite) + length));
+  s->next = *p;
+  s->footprint = footprint;
+  s->length = length;
+  memcpy(s + 1, stack, length);
+  *p = s;
+}
+
+// Records the stack of the specified thread if it has allocated at
+// least avian.alloc.sample bytes since it was last sampled,
+// attributing all those bytes to the stack.  The caller must hold
+// the state lock.
+void
+sampleAllocation(Thread* t)
+{
+  const unsigned MaxDepth = 64;
+  const unsigned BufferSize = 4096;
+
+  if (t->allocationSinceSample < t->m->allocationSampleInterval
+      or t->javaThread == 0)
+  {
+    return;
+  }
+
+  class Visitor: public Processor::StackVisitor {
+   public:
+    Visitor(): count(0) { }
+
+    virtual bool visit(Processor::StackWalker* walker) {
+      methods[count++] = walker->method();
+      return count < MaxDepth;
+    }
+
+    object methods[MaxDepth];
+    unsigned count;
+  } v;
+
+  t->m->processor->walkStack(t, &v);
+
+  if (v.count == 0) {
+    return;
+  }
+
+  char buffer[BufferSize];
+  unsigned length = 0;
+  for (unsigned i = v.count; i > 0 and length < BufferSize; --i) {
+    object method = v.methods[i - 1];
+    int n = vm::snprintf
+      (buffer + length, BufferSize - length, "%s%s.%s",
+       length ? ";" : "",
+       &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+       &byteArrayBody(t, methodName(t, method), 0));
+    if (n > 0) {
+      length = min(length + n, BufferSize - 1);
+    }
+  }
+
+  addAllocationSample(t->m, buffer, length, t->allocationSinceSample);
+  t->allocationSinceSample = 0;
+}
+
+// Records the time spent running the initializer of the specified
+// class if it is among the slowest seen so far, which are kept in
+// descending order of time:
+void
+addStartupInitializer(Thread* t, StartupStatistics* s, object c,
+                      int64_t time)
+{
+  unsigned i = s->initializerCount;
+  if (i == StartupInitializerCount) {
+    if (time <= s->initializers[i - 1].time) {
+      return;
+    }
+    -- i;
+  } else {
+    ++ s->initializerCount;
+  }
+
+  for (; i > 0 and s->initializers[i - 1].time < time; --i) {
+    s->initializers[i] = s->initializers[i - 1];
+  }
+
+  StartupInitializer* initializer = s->initializers + i;
+  unsigned length = min(byteArrayLength(t, className(t, c)) - 1,
+                        StartupClassNameSize - 1);
+  memcpy(initializer->name, &byteArrayBody(t, className(t, c), 0), length);
+  initializer->name[length] = 0;
+  initializer->time = time;
+}
+
+// Writes the sampled allocation sites to the file named by the
+// avian.alloc.profile property in the collapsed stack format read by
+// flame graph tools: one line per site, giving its frames and the
+// bytes attributed to it.
+void
+writeAllocationProfile(Machine* m)
+{
+  FILE* out = vm::fopen(findProperty(m, "avian.alloc.profile"), "wb");
+
+  for (unsigned i = 0; i < AllocationSiteTableSize; ++i) {
+    for (AllocationSite* s = m->allocationSites[i]; s;) {
+      if (out) {
+        fprintf(out, "%.*s %" LLD "\n", s->length,
+                reinterpret_cast<char*>(s + 1),
+                static_cast<int64_t>(s->footprint));
+      }
+
+      AllocationSite* next = s->next;
+      m->heap->free(s, sizeof(AllocationSite) + s->length);
+      s = next;
+    }
+  }
+
+  m->heap->free
+    (m->allocationSites, AllocationSiteTableSize * sizeof(AllocationSite*));
+
+  if (out) {
+    fclose(out);
+  }
+}
+
+// Names the site of a blocked monitor acquisition by the class of the
+// object locked and the method and line acquiring it, separated by a
+// tab, and describes the stack leading there in collapsed form.
+void
+describeMonitorSite(Thread* t, object o, char* name, char* stack)
+{
+  const unsigned MaxDepth = 32;
+
+  class Visitor: public Processor::StackVisitor {
+   public:
+    Visitor(): count(0) { }
+
+    virtual bool visit(Processor::StackWalker* walker) {
+      methods[count] = walker->method();
+      ips[count] = walker->ip();
+      ++ count;
+      return count < MaxDepth;
+    }
+
+    object methods[MaxDepth];
+    int ips[MaxDepth];
+    unsigned count;
+  } v;
+
+  if (t->javaThread) {
+    t->m->processor->walkStack(t, &v);
+  }
+
+  // a class is named as such when its own monitor is the one taken,
+  // as by static synchronized methods
+  object c = objectClass(t, o);
+  bool isClass = c == type(t, Machine::ClassType);
+  if (isClass) {
+    c = o;
+  }
+
+  int n = vm::snprintf
+    (name, MonitorSiteNameSize, "%s%s\t",
+     &byteArrayBody(t, className(t, c), 0), isClass ? ".class" : "");
+  unsigned length = n > 0 ? min(n, MonitorSiteNameSize - 1) : 0;
+
+  if (v.count) {
+    object method = v.methods[0];
+    vm::snprintf
+      (name + length, MonitorSiteNameSize - length, "%s.%s:%d",
+       &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+       &byteArrayBody(t, methodName(t, method), 0),
+       t->m->processor->lineNumber(t, method, v.ips[0]));
+  } else {
+    vm::snprintf(name + length, MonitorSiteNameSize - length, "-");
+  }
+
+  length = 0;
+  stack[0] = 0;
+  for (unsigned i = v.count; i > 0 and length < MonitorSiteStackSize; --i) {
+    object method = v.methods[i - 1];
+    n = vm::snprintf
+      (stack + length, MonitorSiteStackSize - length, "%s%s.%s",
+       length ? ";" : "",
+       &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+       &byteArrayBody(t, methodName(t, method), 0));
+    if (n > 0) {
+      length = min(length + n, MonitorSiteStackSize - 1);
+    }
+  }
+}
+
+// Charges the specified time spent blocked to the site described by
+// describeMonitorSite.
+void
+recordMonitorContention(Thread* t, MonitorSite* site, int64_t time)
+{
+  uint32_t h = 0;
+  for (const char* p = site->name; *p; ++p) {
+    h = (h * 31) + *p;
+  }
+
+  MonitorProfile* profile = t->m->monitorProfile;
+
+  ACQUIRE_RAW(t, profile->lock);
+
+  MonitorSite** p = profile->sites + (h % MonitorSiteTableSize);
+  MonitorSite* s = *p;
+  while (s and strcmp(s->name, site->name) != 0) {
+    s = s->next;
+  }
+
+  if (s == 0) {
+    s = static_cast<MonitorSite*>(t->m->heap->allocate(sizeof(MonitorSite)));
+    s->next = *p;
+    s->count = 0;
+    s->time = 0;
+    s->maxTime = -1;
+    memcpy(s->name, site->name, MonitorSiteNameSize);
+    *p = s;
+  }
+
+  ++ s->count;
+  s->time += time;
+  if (time > s->maxTime) {
+    s->maxTime = time;
+    memcpy(s->stack, site->stack, MonitorSiteStackSize);
+  }
+}
+
+void
+writeMonitorSite(FILE* out, MonitorSite* s)
+{
+  fprintf(out, "%s\t%" LLD "\t%" LLD "\t%" LLD "\t%s\n", s->name,
+          static_cast<int64_t>(s->count), s->time, s->maxTime, s->stack);
+}
+
+// Labels a thread by its Java name, if it has one we can read, or
+// else by its address.
+void
+threadLabel(Thread* t, Thread* target, char* buffer, unsigned size)
+{
+  object name = target->javaThread ? threadName(t, target->javaThread) : 0;
+  if (name and objectClass(t, name) == type(t, Machine::StringType)
+      and stringLength(t, name) < size)
+  {
+    stringChars(t, name, buffer);
+  } else {
+    vm::snprintf(buffer, size, "%p", target);
+  }
+}
+
+// Writes the sites which have spent the most time blocked so far,
+// followed by every monitor which currently has threads queued to
+// acquire it, along with its owner and those threads in queue order.
+void
+dumpMonitors(Thread* t)
+{
+  const unsigned LabelSize = 256;
+
+  MonitorProfile* profile = t->m->monitorProfile;
+  FILE* out = profile->log;
+
+  fprintf(out, "# dump\ttime\n");
+  fprintf(out, "dump\t%" LLD "\n", t->m->system->now());
+
+  fprintf(out, "# class\tsite\tcount\ttime\tmax\tstack\n");
+  { ACQUIRE_RAW(t, profile->lock);
+
+    MonitorSite* top[MonitorDumpSiteCount];
+    unsigned count = 0;
+    for (unsigned i = 0; i < MonitorSiteTableSize; ++i) {
+      for (MonitorSite* s = profile->sites[i]; s; s = s->next) {
+        unsigned j = count;
+        if (j == MonitorDumpSiteCount) {
+          if (s->time <= top[j - 1]->time) {
+            continue;
+          }
+          -- j;
+        } else {
+          ++ count;
+        }
+
+        for (; j > 0 and top[j - 1]->time < s->time; --j) {
+          top[j] = top[j - 1];
+        }
+        top[j] = s;
+      }
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+      writeMonitorSite(out, top[i]);
+    }
+  }
+
+  fprintf(out, "# monitor\tclass\towner\twaiters\n");
+  { ENTER(t, Thread::ExclusiveState);
+
+    for (HashMapIterator it(t, root(t, Machine::MonitorMap)); it.hasMore();) {
+      object node = it.next();
+      object o = jreferenceTarget(t, tripleFirst(t, node));
+      object monitor = tripleSecond(t, node);
+
+      object waiter = monitorNodeNext(t, monitorAcquireHead(t, monitor));
+      if (o == 0 or waiter == 0) {
+        continue;
+      }
+
+      char label[LabelSize];
+      Thread* owner = static_cast<Thread*>(monitorOwner(t, monitor));
+      if (owner) {
+        threadLabel(t, owner, label, LabelSize);
+      } else {
+        label[0] = '-';
+        label[1] = 0;
+      }
+
+      fprintf(out, "%p\t%s\t%s\t", monitor,
+              &byteArrayBody(t, className(t, objectClass(t, o)), 0), label);
+
+      for (; waiter; waiter = monitorNodeNext(t, waiter)) {
+        threadLabel(t, static_cast<Thread*>(monitorNodeValue(t, waiter)),
+                    label, LabelSize);
+        fprintf(out, "%s%s", label, monitorNodeNext(t, waiter) ? ";" : "");
+      }
+
+      fprintf(out, "\n");
+    }
+  }
+
+  fflush(out);
+}
+
+// Writes every site recorded by the monitor profile and releases it.
+void
+writeMonitorProfile(Machine* m)
+{
+  MonitorProfile* profile = m->monitorProfile;
+  m->monitorProfile = 0;
+
+  m->system->handleDumpRequest(0);
+
+  fprintf(profile->log, "# class\tsite\tcount\ttime\tmax\tstack\n");
+  for (unsigned i = 0; i < MonitorSiteTableSize; ++i) {
+    for (MonitorSite* s = profile->sites[i]; s;) {
+      writeMonitorSite(profile->log, s);
+
+      MonitorSite* next = s->next;
+      m->heap->free(s, sizeof(MonitorSite));
+      s = next;
+    }
+  }
+
+  fclose(profile->log);
+  profile->lock->dispose();
+  m->heap->free(profile, sizeof(MonitorProfile));
+}
+
+void
+doCollect(Thread* t, Heap::CollectionType type)
+{
+  expect(t, not t->m->collecting);
+
+  t->m->collecting = true;
+  THREAD_RESOURCE0(t, t->m->collecting = false);
+
+#ifdef VM_STRESS
+  bool stress = (t->flags & Thread::StressFlag) != 0;
+  if (not stress) atomicOr(&(t->flags), Thread::StressFlag);
+#endif
+
+  Machine* m = t->m;
+
+  m->unsafe = true;
+  m->heap->collect(type, footprint(m->rootThread) + m->retiredFootprint);
+  m->unsafe = false;
+
+  postCollect(m->rootThread);
+
+  killZombies(t, m->rootThread);
+
+  freeRetiredHeaps(m);
+
+  logHeapStatistics(t, type);
+
+  for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
+    m->heap->allocator(Heap::ThreadMemory)->free
+      (m->heapPool[i], m->heapPoolSizes[i] * BytesPerWord);
+  }
+  m->heapPoolIndex = 0;
+  m->heapPoolFootprint = 0;
+  m->heapPoolLimitInWords = m->heap->youngGenerationSize
+    (ThreadHeapPoolSizeInWords);
+  m->heapRefillCount = 0;
+  m->heapWasteFootprint = 0;
+
+  if (m->heap->limitExceeded()) {
+    // if we're out of memory, disallow further allocations of fixed
+    // objects:
+    m->fixedFootprint = FixedFootprintThresholdInBytes;
+  } else {
+    m->fixedFootprint = 0;
+  }
+
+#ifdef VM_STRESS
   if (not stress) atomicAnd(&(t->flags), ~Thread::StressFlag);
 #endif
 
+  int64_t start = m->system->nowMicroseconds();
+
   object finalizeQueue = t->m->finalizeQueue;
   t->m->finalizeQueue = 0;
   for (; finalizeQueue; finalizeQueue = finalizerNext(t, finalizeQueue)) {
@@ -2875,17 +3813,29 @@ doCollect(Thread* t, Heap::CollectionType type)
     function(t, finalizerTarget(t, finalizeQueue));
   }
 
-  if ((root(t, Machine::ObjectsToFinalize) or root(t, Machine::ObjectsToClean))
-      and m->finalizeThread == 0)
-  {
-    m->finalizeThread = m->processor->makeThread
-      (m, root(t, Machine::FinalizerThread), m->rootThread);
-    
-    addThread(t, m->finalizeThread);
+  logCollection(t, m->system->nowMicroseconds() - start);
+
+  // start a finalizer thread for each batch queued, up to the size
+  // of the pool:
+  unsigned wanted = min
+    (m->finalizeThreadCount,
+     ceiling(m->finalizeQueueLength, FinalizeBatchSize));
+
+  for (unsigned i = 0; i < wanted; ++i) {
+    if (m->finalizeThreads[i] == 0) {
+      Thread* p = m->processor->makeThread
+        (m, arrayBody(t, root(t, Machine::FinalizerThreads), i),
+         m->rootThread);
+
+      m->finalizeThreads[i] = p;
+
+      addThread(t, p);
 
-    if (not startThread(t, m->finalizeThread)) {
-      removeThread(t, m->finalizeThread);
-      m->finalizeThread = 0;
+      if (not startThread(t, p)) {
+        removeThread(t, p);
+        m->finalizeThreads[i] = 0;
+        break;
+      }
     }
   }
 }
@@ -2962,9 +3912,12 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   appFinder(appFinder),
   processor(processor),
   classpath(classpath),
+  zonePool(system, heap->allocator(Heap::ZoneMemory),
+           ZonePoolCapacityInBytes),
   rootThread(0),
   exclusive(0),
-  finalizeThread(0),
+  finalizeThreadCount(1),
+  finalizeQueueLength(0),
   jniReferences(0),
   properties(properties),
   propertyCount(propertyCount),
@@ -2997,10 +3950,103 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   triedBuiltinOnLoad(false),
   dumpedHeapOnOOM(false),
   alive(true),
-  heapPoolIndex(0)
+  heapPoolIndex(0),
+  heapPoolFootprint(0),
+  heapPoolLimitInWords(ThreadHeapPoolSizeInWords),
+  heapRefillCount(0),
+  heapWasteFootprint(0),
+  largeObjectThresholdInWords(ThreadHeapSizeInWords),
+  referenceTime(0),
+  safepointTime(0),
+  allocationSampleInterval(0),
+  allocationSites(0),
+  retiredHeaps(0),
+  retiredFootprint(0),
+  pendingClasses(0),
+  pendingClassWaits(0),
+  nativeSymbols(0),
+  startupStatistics(0),
+  monitorProfile(0)
 {
   heap->setClient(heapClient);
 
+  memset(&identityHashes, 0, sizeof(IdentityHashTable));
+  memset(&tenuredIdentityHashes, 0, sizeof(IdentityHashTable));
+
+  // with the avian.startup.log property set, we time the phases of
+  // startup until the first static method is called through JNI,
+  // which is the application's main method when started from our
+  // launcher, and report them then:
+  if (findProperty(this, "avian.startup.log")) {
+    startupStatistics = static_cast<StartupStatistics*>
+      (heap->allocate(sizeof(StartupStatistics)));
+    memset(startupStatistics, 0, sizeof(StartupStatistics));
+    startupStatistics->start = system->nowMicroseconds();
+  }
+
+  memset(pauseHistogram, 0, PauseHistogramSize * sizeof(unsigned));
+
+  memset(finalizeThreads, 0, sizeof(finalizeThreads));
+  const char* finalizeThreadCountProperty
+    = findProperty(this, "avian.finalizer.threads");
+  if (finalizeThreadCountProperty) {
+    int count = atoi(finalizeThreadCountProperty);
+    if (count > 0) {
+      finalizeThreadCount = min(count, MaximumFinalizeThreadCount);
+    }
+  }
+
+  // objects larger than this are allocated as fixed objects, which
+  // are allocated individually from the system and never copied by
+  // the collector.  The threshold may be lowered to keep large arrays
+  // from being copied between generations, but not raised, since
+  // every movable object must fit in a thread-local heap:
+  const char* largeObjectThreshold
+    = findProperty(this, "avian.heap.large.threshold");
+  if (largeObjectThreshold) {
+    largeObjectThresholdInWords = ceiling
+      (max(min(static_cast<unsigned>(parseSize(largeObjectThreshold)),
+               ThreadHeapSizeInBytes),
+           ThreadBackupHeapSizeInBytes), BytesPerWord);
+  }
+
+  // the avian.hugepages property asks that the collector's segments,
+  // which it scans from end to end, be backed by huge pages where the
+  // system supports them, to reduce TLB misses:
+  const char* hugePages = findProperty(this, "avian.hugepages");
+  if (hugePages and ::strcmp(hugePages, "true") == 0) {
+    heap->setHugePages(true);
+  }
+
+  // the avian.heap.free.ratio property sets the percentage of the old
+  // generation left free after a major collection resizes it; the old
+  // generation shrinks once much more than that is free:
+  const char* freeRatio = findProperty(this, "avian.heap.free.ratio");
+  if (freeRatio) {
+    heap->setFreeRatio(atoi(freeRatio));
+  }
+
+  // the avian.gc.pause property sets a goal for the longest minor
+  // collection pause in milliseconds, and avian.gc.overhead the
+  // percentage of time we're willing to spend collecting, which the
+  // heap meets by resizing the young generation, i.e. the heap pool:
+  const char* pauseGoal = findProperty(this, "avian.gc.pause");
+  if (pauseGoal and atoi(pauseGoal) > 0) {
+    const char* overheadGoal = findProperty(this, "avian.gc.overhead");
+    heap->setPauseGoal
+      (atoi(pauseGoal) * 1000, overheadGoal ? atoi(overheadGoal) : 5);
+  }
+
+  if (findProperty(this, "avian.alloc.profile")) {
+    const char* interval = findProperty(this, "avian.alloc.sample");
+    allocationSampleInterval = interval and parseSize(interval) > 0
+      ? parseSize(interval) : DefaultAllocationSampleIntervalInBytes;
+
+    unsigned size = AllocationSiteTableSize * sizeof(AllocationSite*);
+    allocationSites = static_cast<AllocationSite**>(heap->allocate(size));
+    memset(allocationSites, 0, size);
+  }
+
   populateJNITables(&javaVMVTable, &jniEnvVTable);
 
   if (not system->success(system->make(&localThread)) or
@@ -3014,11 +4060,59 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   {
     system->abort();
   }
+
+  nativeSymbols = makeNativeSymbols(this);
+
+  FILE* monitorLog = 0;
+  if (const char* path = findProperty(this, "avian.monitor.profile")) {
+    monitorLog = vm::fopen(path, "wb");
+  }
+
+  if (monitorLog) {
+    monitorProfile = new (heap->allocate(sizeof(MonitorProfile)))
+      MonitorProfile;
+    monitorProfile->log = monitorLog;
+    monitorProfile->thread = 0;
+    monitorProfile->dumpRequested = false;
+    memset(monitorProfile->sites, 0, sizeof(monitorProfile->sites));
+    expect(system, system->success(system->make(&(monitorProfile->lock))));
+
+    if (not system->success(system->handleDumpRequest(monitorProfile))) {
+      fprintf(stderr, "warning: unable to install the monitor dump "
+              "handler\n");
+    }
+  }
+
+  if (startupStatistics) {
+    startupStatistics->phases[MachineStartupPhase]
+      = system->nowMicroseconds() - startupStatistics->start;
+  }
 }
 
 void
 Machine::dispose()
 {
+  logPauseHistogram(this);
+
+  if (startupStatistics) {
+    logStartup(this);
+  }
+
+  if (allocationSites) {
+    writeAllocationProfile(this);
+  }
+
+  if (monitorProfile) {
+    writeMonitorProfile(this);
+  }
+
+  freeRetiredHeaps(this);
+
+  disposeIdentityHashTable(this, &identityHashes);
+  disposeIdentityHashTable(this, &tenuredIdentityHashes);
+
+  zonePool.dispose();
+
   localThread->dispose();
   stateLock->dispose();
   heapLock->dispose();
@@ -3033,15 +4127,16 @@ Machine::dispose()
   for (Reference* r = jniReferences; r;) {
     Reference* tmp = r;
     r = r->next;
-    heap->free(tmp, sizeof(*tmp));
+    heap->allocator(Heap::JniMemory)->free(tmp, sizeof(*tmp));
   }
 
   for (unsigned i = 0; i < heapPoolIndex; ++i) {
-    heap->free(heapPool[i], ThreadHeapSizeInBytes);
+    heap->allocator(Heap::ThreadMemory)->free
+      (heapPool[i], heapPoolSizes[i] * BytesPerWord);
   }
 
   if (bootimage) {
-    heap->free(bootimage, bootimageSize);
+    heap->allocator(Heap::ClassMemory)->free(bootimage, bootimageSize);
   }
 
   heap->free(arguments, sizeof(const char*) * argumentCount);
@@ -3053,6 +4148,101 @@ Machine::dispose()
   heap->free(this, sizeof(*this));
 }
 
+void
+StartupTimer::start()
+{
+  next = statistics->timer;
+  statistics->timer = this;
+  nested = 0;
+  nestedInitializers = 0;
+  begin = t->m->system->nowMicroseconds();
+}
+
+void
+StartupTimer::stop()
+{
+  int64_t elapsed = t->m->system->nowMicroseconds() - begin;
+
+  statistics->phases[phase] += elapsed - nested;
+  statistics->timer = next;
+
+  if (next) {
+    next->nested += elapsed;
+    next->nestedInitializers += phase == ClassInitStartupPhase
+      ? elapsed : nestedInitializers;
+  }
+
+  if (phase == ClassInitStartupPhase and class_) {
+    addStartupInitializer
+      (t, statistics, class_, elapsed - nestedInitializers);
+  }
+}
+
+// Writes the time spent in each phase of startup, followed by the
+// slowest class initializers, to the file named by the
+// avian.startup.log property, and stops timing startup.  Times are in
+// microseconds, and time spent outside any phase, e.g. in the
+// launcher or in C++ code called by it, is reported as "other".
+void
+logStartup(Machine* m)
+{
+  const char* const names[] = {
+    "machine", "boot", "class-loading", "class-init", "compile"
+  };
+
+  StartupStatistics* s = m->startupStatistics;
+  m->startupStatistics = 0;
+
+  FILE* out = vm::fopen(findProperty(m, "avian.startup.log"), "wb");
+  if (out) {
+    int64_t total = m->system->nowMicroseconds() - s->start;
+    int64_t other = total;
+
+    fprintf(out, "# phase\ttime\n");
+    for (unsigned i = 0; i < StartupPhaseCount; ++i) {
+      fprintf(out, "%s\t%" LLD "\n", names[i], s->phases[i]);
+      other -= s->phases[i];
+    }
+    fprintf(out, "other\t%" LLD "\n", other);
+    fprintf(out, "total\t%" LLD "\n", total);
+
+    fprintf(out, "# initializer\ttime\n");
+    for (unsigned i = 0; i < s->initializerCount; ++i) {
+      fprintf(out, "%s\t%" LLD "\n", s->initializers[i].name,
+              s->initializers[i].time);
+    }
+
+    fclose(out);
+  }
+
+  m->heap->free(s, sizeof(StartupStatistics));
+}
+
+// writes the current and peak number of bytes of native memory in
+// each category, as accounted by the heap
+void
+dumpNativeMemory(Machine* m, FILE* out)
+{
+  const char* const names[] = {
+    "segments", "segment-maps", "fixies", "zones", "code", "classes",
+    "jni", "threads", "finders", "other"
+  };
+
+  Heap::MemoryUsage categories[Heap::MemoryCategoryCount];
+  Heap::MemoryUsage total;
+  m->heap->memoryUsage(categories, &total);
+
+  fprintf(out, "# category\tcurrent\tpeak\n");
+  for (unsigned i = 0; i < Heap::MemoryCategoryCount; ++i) {
+    fprintf(out, "%s\t%" LLD "\t%" LLD "\n", names[i],
+            static_cast<int64_t>(categories[i].current),
+            static_cast<int64_t>(categories[i].peak));
+  }
+  fprintf(out, "total\t%" LLD "\t%" LLD "\n",
+          static_cast<int64_t>(total.current),
+          static_cast<int64_t>(total.peak));
+}
+
 Thread::Thread(Machine* m, object javaThread, Thread* parent):
   vtable(&(m->jniEnvVTable)),
   m(m),
@@ -3066,13 +4256,21 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
   lock(0),
   javaThread(javaThread),
   exception(0),
+  lastMonitorObject(0),
+  lastMonitor(0),
   heapIndex(0),
   heapOffset(0),
+  heapSizeInWords(ThreadHeapSizeInWords),
+  defaultHeapSizeInWords(ThreadHeapSizeInWords),
+  heapRefillCount(0),
+  allocationSinceSample(0),
+  safepointRequested(0),
   protector(0),
   classInitStack(0),
   runnable(this),
   defaultHeap(static_cast<uintptr_t*>
-              (m->heap->allocate(ThreadHeapSizeInBytes))),
+              (m->heap->allocator(Heap::ThreadMemory)->allocate
+               (ThreadHeapSizeInBytes))),
   heap(defaultHeap),
   backupHeapIndex(0),
   flags(ActiveFlag)
@@ -3081,7 +4279,7 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
 void
 Thread::init()
 {
-  memset(defaultHeap, 0, ThreadHeapSizeInBytes);
+  memset(defaultHeap, 0, defaultHeapSizeInWords * BytesPerWord);
   memset(backupHeap, 0, ThreadBackupHeapSizeInBytes);
 
   if (parent == 0) {
@@ -3114,7 +4312,8 @@ Thread::init()
 #ifdef AVIAN_USE_LZMA
           m->bootimage = image = reinterpret_cast<BootImage*>
             (decodeLZMA
-             (m->system, m->heap, imageBytes, size, &(m->bootimageSize)));
+             (m->system, m->heap->allocator(Heap::ClassMemory), imageBytes,
+              size, &(m->bootimageSize)));
 #else
           abort(this);
 #endif
@@ -3139,10 +4338,13 @@ Thread::init()
 
     enter(this, ActiveState);
 
-    if (image and code) {
-      m->processor->boot(this, image, code);
-    } else {
-      boot(this);
+    { StartupTimer timer(this, BootStartupPhase);
+
+      if (image and code) {
+        m->processor->boot(this, image, code);
+      } else {
+        boot(this);
+      }
     }
 
     setRoot(this, Machine::ByteArrayMap, makeWeakHashMap(this, 0, 0));
@@ -3176,6 +4378,10 @@ Thread::exit()
     } else {
       threadPeer(this, javaThread) = 0;
 
+      // the OS thread may be reused for another thread, so don't let
+      // signal handlers find this one through it
+      m->localThread->set(0);
+
       enter(this, Thread::ZombieState);
     }
   }
@@ -3194,7 +4400,10 @@ Thread::dispose()
 
   -- m->threadCount;
 
-  m->heap->free(defaultHeap, ThreadHeapSizeInBytes);
+  if (defaultHeap) {
+    m->heap->allocator(Heap::ThreadMemory)->free
+      (defaultHeap, defaultHeapSizeInWords * BytesPerWord);
+  }
 
   m->processor->dispose(this);
 }
@@ -3236,18 +4445,40 @@ shutDown(Thread* t)
     }
   }
 
-  // tell finalize thread to exit and wait for it to do so
+  // tell finalize threads to exit and wait for them to do so
   { ACQUIRE(t, t->m->stateLock);
-    Thread* finalizeThread = t->m->finalizeThread;
-    if (finalizeThread) {
-      t->m->finalizeThread = 0;
-      t->m->stateLock->notifyAll(t->systemThread);
+    Thread* finalizeThreads[MaximumFinalizeThreadCount];
+    memcpy(finalizeThreads, t->m->finalizeThreads,
+           sizeof(finalizeThreads));
+    memset(t->m->finalizeThreads, 0, sizeof(finalizeThreads));
+    t->m->stateLock->notifyAll(t->systemThread);
+
+    for (unsigned i = 0; i < t->m->finalizeThreadCount; ++i) {
+      Thread* finalizeThread = finalizeThreads[i];
+      if (finalizeThread) {
+        while (finalizeThread->state != Thread::ZombieState
+               and finalizeThread->state != Thread::JoinedState)
+        {
+          ENTER(t, Thread::IdleState);
+          t->m->stateLock->wait(t->systemThread, 0);      
+        }
+      }
+    }
+  }
+
+  // likewise for the monitor dump thread, if any
+  if (MonitorProfile* profile = t->m->monitorProfile) {
+    ACQUIRE(t, t->m->stateLock);
+    Thread* dumpThread = profile->thread;
+    profile->thread = 0;
+    t->m->stateLock->notifyAll(t->systemThread);
 
-      while (finalizeThread->state != Thread::ZombieState
-             and finalizeThread->state != Thread::JoinedState)
+    if (dumpThread) {
+      while (dumpThread->state != Thread::ZombieState
+             and dumpThread->state != Thread::JoinedState)
       {
         ENTER(t, Thread::IdleState);
-        t->m->stateLock->wait(t->systemThread, 0);      
+        t->m->stateLock->wait(t->systemThread, 0);
       }
     }
   }
@@ -3262,6 +4493,19 @@ shutDown(Thread* t)
 
     visitAll(t, t->m->rootThread, interruptDaemon);
   }
+
+  // the avian.native.log property, if present, names a file to
+  // which native memory usage is written at exit:
+  const char* nativeLog = findProperty(t, "avian.native.log");
+  if (nativeLog) {
+    FILE* out = vm::fopen(nativeLog, "wb");
+    if (out) {
+      dumpNativeMemory(t->m, out);
+      fclose(out);
+    }
+  }
+
+  t->m->processor->shutDown(t);
 }
 
 void
@@ -3313,8 +4557,20 @@ enter(Thread* t, Thread::State s)
     
     STORE_LOAD_MEMORY_BARRIER;
 
-    while (t->m->activeCount > 1) {
-      t->m->stateLock->wait(t->systemThread, 0);
+    if (t->m->activeCount > 1) {
+      // ask threads running loops to stop at their next
+      // safepoint poll, and measure how long it takes them all to
+      int64_t start = t->m->system->nowMicroseconds();
+
+      visitAll(t, t->m->rootThread, requestSafepoint);
+
+      while (t->m->activeCount > 1) {
+        t->m->stateLock->wait(t->systemThread, 0);
+      }
+
+      t->m->safepointTime = t->m->system->nowMicroseconds() - start;
+    } else {
+      t->m->safepointTime = 0;
     }
   } break;
 
@@ -3444,16 +4700,71 @@ enter(Thread* t, Thread::State s)
   }
 }
 
+// Disposes of the threads under and including o which have exited,
+// without waiting for a collection.  Their default heaps may still
+// hold live objects, so they are kept until the next collection, but
+// threads which have allocated from their backup heaps are left for
+// killZombies.
+void
+retireZombies(Thread* t, Thread* o)
+{
+  for (Thread* p = o->child; p;) {
+    Thread* child = p;
+    p = p->peer;
+    retireZombies(t, child);
+  }
+
+  if ((o->flags & Thread::SystemFlag) == 0
+      and (o->state == Thread::ZombieState
+           or o->state == Thread::JoinedState)
+      and o->backupHeapIndex == 0)
+  {
+    if (o->state == Thread::ZombieState) {
+      join(t, o);
+    }
+
+    RetiredHeap* r = static_cast<RetiredHeap*>
+      (t->m->heap->allocator(Heap::ThreadMemory)->allocate
+       (sizeof(RetiredHeap)));
+    r->next = t->m->retiredHeaps;
+    r->heap = o->defaultHeap;
+    r->sizeInWords = o->defaultHeapSizeInWords;
+    t->m->retiredHeaps = r;
+    t->m->retiredFootprint += o->heapOffset + o->heapIndex;
+
+    o->defaultHeap = 0;
+
+    ::dispose(t, o, true);
+  }
+}
+
 object
 allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
 {
   return allocate3
     (t, t->m->heap,
-     ceiling(sizeInBytes, BytesPerWord) > ThreadHeapSizeInWords ?
+     ceiling(sizeInBytes, BytesPerWord) > t->m->largeObjectThresholdInWords ?
      Machine::FixedAllocation : Machine::MovableAllocation,
      sizeInBytes, objectMask);
 }
 
+// Returns the size in words of the next heap pool buffer to give the
+// specified thread, which doubles with each buffer it takes between
+// collections, or zero if the pool has no room for the specified
+// number of words.
+unsigned
+refillSize(Thread* t, unsigned minimum)
+{
+  unsigned available = t->m->heapPoolLimitInWords - t->m->heapPoolFootprint;
+  if (minimum > available) {
+    return 0;
+  }
+
+  unsigned size = ThreadHeapSizeInWords << min(t->heapRefillCount, 3U);
+  return max(min(min(size, MaximumThreadHeapSizeInWords), available),
+             minimum);
+}
+
 object
 allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
           unsigned sizeInBytes, bool objectMask)
@@ -3470,7 +4781,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     return o;
   } else if (UNLIKELY(t->flags & Thread::TracingFlag)) {
     expect(t, t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-           <= ThreadHeapSizeInWords);
+           <= t->heapSizeInWords);
     return allocateSmall(t, sizeInBytes);
   }
 
@@ -3486,25 +4797,48 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     }
   }
   
+  if (UNLIKELY(t->m->allocationSites)) {
+    // movable allocations are counted a thread-local heap at a time
+    // as they are retired:
+    if (type != Machine::MovableAllocation) {
+      t->allocationSinceSample += sizeInBytes;
+    }
+
+    sampleAllocation(t);
+  }
+
   do {
     switch (type) {
     case Machine::MovableAllocation:
       if (t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-          > ThreadHeapSizeInWords)
+          > t->heapSizeInWords)
       {
+        unsigned size = refillSize(t, ceiling(sizeInBytes, BytesPerWord));
+
         t->heap = 0;
         if ((not t->m->heap->limitExceeded())
-            and t->m->heapPoolIndex < ThreadHeapPoolSize)
+            and t->m->heapPoolIndex < ThreadHeapPoolSize
+            and size)
         {
           t->heap = static_cast<uintptr_t*>
-            (t->m->heap->tryAllocate(ThreadHeapSizeInBytes));
+            (t->m->heap->allocator(Heap::ThreadMemory)->tryAllocate
+             (size * BytesPerWord));
 
           if (t->heap) {
-            memset(t->heap, 0, ThreadHeapSizeInBytes);
+            memset(t->heap, 0, size * BytesPerWord);
 
-            t->m->heapPool[t->m->heapPoolIndex++] = t->heap;
+            t->allocationSinceSample += t->heapIndex * BytesPerWord;
+
+            t->m->heapPool[t->m->heapPoolIndex] = t->heap;
+            t->m->heapPoolSizes[t->m->heapPoolIndex++] = size;
+            t->m->heapPoolFootprint += size;
+            ++ t->m->heapRefillCount;
+            t->m->heapWasteFootprint += t->heapSizeInWords - t->heapIndex;
+
+            ++ t->heapRefillCount;
             t->heapOffset += t->heapIndex;
             t->heapIndex = 0;
+            t->heapSizeInWords = size;
           }
         }
       }
@@ -3532,7 +4866,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     }
   } while (type == Machine::MovableAllocation
            and t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-           > ThreadHeapSizeInWords);
+           > t->heapSizeInWords);
 
   switch (type) {
   case Machine::MovableAllocation: {
@@ -3677,7 +5011,10 @@ stringUTFLength(Thread* t, object string, unsigned start, unsigned length)
     if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
       result = length;
     } else {
-      for (unsigned i = 0; i < length; ++i) {
+      result = asciiLength
+        (&charArrayBody(t, data, stringOffset(t, string) + start), length);
+
+      for (unsigned i = result; i < length; ++i) {
         uint16_t c = charArrayBody
           (t, data, stringOffset(t, string) + start + i);
         if (c == 0)         result += 1; // null char (was 2 bytes in Java)
@@ -3743,10 +5080,17 @@ stringUTFChars(Thread* t, object string, unsigned start, unsigned length,
            length);
     chars[length] = 0; 
   } else {
-    int j = 0;
-    for (unsigned i = 0; i < length; ++i) {
-      uint16_t c = charArrayBody
-        (t, data, stringOffset(t, string) + start + i);
+    const uint16_t* body = length
+      ? &charArrayBody(t, data, stringOffset(t, string) + start) : 0;
+
+    unsigned ascii = length ? asciiLength(body, length) : 0;
+    for (unsigned i = 0; i < ascii; ++i) {
+      chars[i] = static_cast<char>(body[i]);
+    }
+
+    int j = ascii;
+    for (unsigned i = ascii; i < length; ++i) {
+      uint16_t c = body[i];
       if(!c) {                // null char
         chars[j++] = 0;
       } else if (c < 0x80) {  // ASCII char
@@ -3783,6 +5127,13 @@ isAssignableFrom(Thread* t, object a, object b)
   if (a == b) return true;
 
   if (classFlags(t, a) & ACC_INTERFACE) {
+    // the interface table is searched linearly, so remember the last
+    // interface found there, as callers tend to check the same one
+    // repeatedly:
+    if (classInterfaceCache(t, b) == a) {
+      return true;
+    }
+
     if (classVmFlags(t, b) & BootstrapFlag) {
       uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(className(t, b)) };
 
@@ -3797,6 +5148,7 @@ isAssignableFrom(Thread* t, object a, object b)
       unsigned stride = (classFlags(t, b) & ACC_INTERFACE) ? 1 : 2;
       for (unsigned i = 0; i < arrayLength(t, itable); i += stride) {
         if (arrayBody(t, itable, i) == a) {
+          set(t, b, ClassInterfaceCache, a);
           return true;
         }
       }
@@ -3809,6 +5161,15 @@ isAssignableFrom(Thread* t, object a, object b)
   } else if ((classVmFlags(t, a) & PrimitiveFlag)
              == (classVmFlags(t, b) & PrimitiveFlag))
   {
+    object aDisplay = classDisplay(t, a);
+    object bDisplay = classDisplay(t, b);
+    if (aDisplay and bDisplay) {
+      unsigned depth = arrayLength(t, aDisplay) - 1;
+      return depth < arrayLength(t, bDisplay)
+        and arrayBody(t, bDisplay, depth) == a;
+    }
+
+    // bootstrap, primitive and array classes have no display:
     for (; b; b = classSuper(t, b)) {
       if (b == a) {
         return true;
@@ -3927,10 +5288,17 @@ primitiveSize(Thread* t, unsigned code)
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
-           Machine::Type throwType)
+           Machine::Type throwType, System::Region** regionp)
 {
   PROTECT(t, loader);
 
+  // if data is the content of *regionp, we may keep that region and
+  // parse the code of each method when it is first needed instead of
+  // now.  Boot images must carry parsed code for every method, though.
+  System::Region* region
+    = (regionp and DeferCodeParsing and root(t, Machine::PoolMap) == 0)
+    ? *regionp : 0;
+
   class Client: public Stream::Client {
    public:
     Client(Thread* t): t(t) { }
@@ -3979,6 +5347,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
                             0, // static table
                             loader,
                             0, // source
+                            0, // display
+                            0, // interface cache
                             0);// vtable length
   PROTECT(t, class_);
   
@@ -4004,7 +5374,7 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
 
   parseFieldTable(t, s, class_, pool);
 
-  parseMethodTable(t, s, class_, pool);
+  parseMethodTable(t, s, class_, pool, region);
 
   parseAttributeTable(t, s, class_, pool);
 
@@ -4038,6 +5408,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
   updateClassTables(t, real, class_);
 
   if (root(t, Machine::PoolMap)) {
+    ACQUIRE(t, t->m->classLock);
+
     object bootstrapClass = hashMapFind
       (t, root(t, Machine::BootstrapClassMap), className(t, class_),
        byteArrayHash, byteArrayEqual);
@@ -4047,18 +5419,192 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
        pool, objectHash);
   }
 
+  if (region) {
+    // the methods refer to the class file until their code is parsed,
+    // so keep it until shutdown
+    PROTECT(t, real);
+
+    object classFile = makeRegion(t, region, 0);
+
+    ACQUIRE(t, t->m->classLock);
+
+    setRoot(t, Machine::ClassFiles,
+            makePair(t, classFile, root(t, Machine::ClassFiles)));
+
+    *regionp = 0;
+  }
+
   return real;
 }
 
+void
+parseDeferredCode(Thread* t, object method)
+{
+  PROTECT(t, method);
+
+  ACQUIRE(t, t->m->classLock);
+
+  object stub = methodCode(t, method);
+  if (codeClassFile(t, stub) == 0) {
+    // another thread got here first
+    return;
+  }
+
+  PROTECT(t, stub);
+
+  class Client: public Stream::Client {
+   public:
+    Client(Thread* t): t(t) { }
+
+    virtual void NO_RETURN handleError() {
+      vm::abort(t);
+    }
+
+   private:
+    Thread* t;
+  } client(t);
+
+  System::Region* region = static_cast<System::Region*>
+    (regionRegion(t, codeClassFile(t, stub)));
+  unsigned position = regionPosition(t, codeClassFile(t, stub));
+
+  Stream s(&client, region->start() + position, region->length() - position);
+
+  object code = parseCode(t, s, codePool(t, stub));
+
+  codeCompiled(t, code) = codeCompiled(t, stub);
+
+  storeStoreMemoryBarrier();
+
+  set(t, method, MethodCode, code);
+}
+
+// Returns whether waiting for the specified pending class would wait,
+// directly or through the classes its owner and theirs are waiting
+// for, on a class this thread is parsing.  The caller must hold
+// classLock.
+bool
+pendingClassCircular(Thread* t, PendingClass* p)
+{
+  while (p) {
+    if (p->owner == t) {
+      return true;
+    }
+
+    PendingClassWait* w = t->m->pendingClassWaits;
+    while (w and w->waiter != p->owner) {
+      w = w->next;
+    }
+
+    p = w ? w->class_ : 0;
+  }
+  return false;
+}
+
+// Waits while another thread is parsing the class named spec for
+// loader, then returns the class if it has been registered.  Sets
+// *circular and returns zero instead if the wait would never end
+// because the class hierarchy is circular.  The caller must hold
+// classLock.
+object
+waitForPendingClass(Thread* t, object loader, object spec, bool* circular)
+{
+  PROTECT(t, loader);
+  PROTECT(t, spec);
+
+  *circular = false;
+
+  while (true) {
+    PendingClass* p = t->m->pendingClasses;
+    while (p and not (*(p->loader) == loader
+                      and byteArrayEqual(t, *(p->spec), spec)))
+    {
+      p = p->next;
+    }
+
+    if (p == 0) {
+      return hashMapFind
+        (t, classLoaderMap(t, loader), spec, byteArrayHash, byteArrayEqual);
+    }
+
+    if (pendingClassCircular(t, p)) {
+      *circular = true;
+      return 0;
+    }
+
+    PendingClassWait wait;
+    wait.next = t->m->pendingClassWaits;
+    wait.waiter = t;
+    wait.class_ = p;
+    t->m->pendingClassWaits = &wait;
+
+    { ENTER(t, Thread::IdleState);
+      t->m->classLock->wait(t->systemThread, 0);
+    }
+
+    for (PendingClassWait** w = &(t->m->pendingClassWaits); *w;
+         w = &((*w)->next))
+    {
+      if (*w == &wait) {
+        *w = wait.next;
+        break;
+      }
+    }
+  }
+}
+
+// Marks the class named *spec as being parsed by this thread until
+// the resource is released, which must happen with classLock held.
+class PendingClassResource: public Thread::Resource {
+ public:
+  PendingClassResource(Thread* t, object* loader, object* spec):
+    Resource(t)
+  {
+    pending.next = t->m->pendingClasses;
+    pending.owner = t;
+    pending.loader = loader;
+    pending.spec = spec;
+    t->m->pendingClasses = &pending;
+  }
+
+  ~PendingClassResource() {
+    for (PendingClass** p = &(t->m->pendingClasses); *p; p = &((*p)->next)) {
+      if (*p == &pending) {
+        *p = pending.next;
+        break;
+      }
+    }
+
+    // the waiters will look again once they wake up, but until then
+    // they must not lead pendingClassCircular here
+    for (PendingClassWait* w = t->m->pendingClassWaits; w; w = w->next) {
+      if (w->class_ == &pending) {
+        w->class_ = 0;
+      }
+    }
+
+    t->m->classLock->notifyAll(t->systemThread);
+  }
+
+  virtual void release() {
+    this->PendingClassResource::~PendingClassResource();
+  }
+
+ private:
+  PendingClass pending;
+};
+
 uint64_t
 runParseClass(Thread* t, uintptr_t* arguments)
 {
   object loader = reinterpret_cast<object>(arguments[0]);
-  System::Region* region = reinterpret_cast<System::Region*>(arguments[1]);
+  System::Region** regionp = reinterpret_cast<System::Region**>
+    (arguments[1]);
   Machine::Type throwType = static_cast<Machine::Type>(arguments[2]);
 
   return reinterpret_cast<uintptr_t>
-    (parseClass(t, loader, region->start(), region->length(), throwType));
+    (parseClass(t, loader, (*regionp)->start(), (*regionp)->length(),
+                throwType, regionp));
 }
 
 object
@@ -4068,22 +5614,45 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
   PROTECT(t, loader);
   PROTECT(t, spec);
 
+  StartupTimer timer(t, ClassLoadStartupPhase);
+
+  { ACQUIRE(t, t->m->classLock);
+
+    object class_ = hashMapFind
+      (t, classLoaderMap(t, loader), spec, byteArrayHash, byteArrayEqual);
+
+    if (class_) {
+      return class_;
+    }
+  }
+
+  // the parent takes classLock for itself, so don't hold it here or
+  // the parent would parse its classes under it
+  if (classLoaderParent(t, loader)) {
+    object class_ = resolveSystemClass
+      (t, classLoaderParent(t, loader), spec, false);
+    if (class_) {
+      return class_;
+    }
+  }
+
   ACQUIRE(t, t->m->classLock);
 
-  object class_ = hashMapFind
-    (t, classLoaderMap(t, loader), spec, byteArrayHash, byteArrayEqual);
+  bool circular;
+  object class_ = waitForPendingClass(t, loader, spec, &circular);
+
+  if (UNLIKELY(circular)) {
+    if (throw_) {
+      throwNew(t, Machine::ClassCircularityErrorType, "%s",
+               &byteArrayBody(t, spec, 0));
+    } else {
+      return 0;
+    }
+  }
 
   if (class_ == 0) {
     PROTECT(t, class_);
 
-    if (classLoaderParent(t, loader)) {
-      class_ = resolveSystemClass
-        (t, classLoaderParent(t, loader), spec, false);
-      if (class_) {
-        return class_;
-      }
-    }
-
     if (byteArrayBody(t, spec, 0) == '[') {
       class_ = resolveArrayClass(t, loader, spec, throw_, throwType);
     } else {
@@ -4104,16 +5673,28 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
           fprintf(stderr, "parsing %s\n", &byteArrayBody(t, spec, 0));
         }
 
-        { THREAD_RESOURCE(t, System::Region*, region, region->dispose());
+        PendingClassResource pending(t, &loader, &spec);
+
+        // parseClass clears this if it keeps the region
+        System::Region** regionp = &region;
+
+        { THREAD_RESOURCE(t, System::Region**, regionp,
+                          if (*regionp) (*regionp)->dispose());
 
           uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(loader),
-                                    reinterpret_cast<uintptr_t>(region),
+                                    reinterpret_cast<uintptr_t>(regionp),
                                     static_cast<uintptr_t>(throwType) };
 
-          // parse class file
+          // parse class file, letting other threads load other classes
+          // meanwhile.  runRaw catches any exception, so the lock is
+          // always reacquired.
+          release(t, t->m->classLock);
+
           class_ = reinterpret_cast<object>
             (runRaw(t, runParseClass, arguments));
 
+          acquire(t, t->m->classLock);
+
           if (UNLIKELY(t->exception)) {
             if (throw_) {
               object e = t->exception;
@@ -4391,6 +5972,8 @@ postInitClass(Thread* t, object c)
              static_cast<object>(0), 0, exception);
   } else {
     classVmFlags(t, c) &= ~(NeedInitFlag | InitFlag);
+
+    bindNatives(t, c);
   }
   t->m->classLock->notifyAll(t->systemThread);
 }
@@ -4412,6 +5995,7 @@ initClass(Thread* t, object c)
 
     if (initializer) {
       Thread::ClassInitStack stack(t, c);
+      StartupTimer timer(t, ClassInitStartupPhase, c);
 
       t->m->processor->invoke(t, initializer, 0);
     }
@@ -4474,6 +6058,66 @@ makeObjectArray(Thread* t, object elementClass, unsigned count)
   return array;
 }
 
+bool
+compatibleArrayTypes(Thread* t, object a, object b)
+{
+  return classArrayElementSize(t, a)
+    and classArrayElementSize(t, b)
+    and (a == b
+         or (not ((classVmFlags(t, a) & PrimitiveFlag)
+                  or (classVmFlags(t, b) & PrimitiveFlag))));
+}
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  if (LIKELY(src and dst)) {
+    if (LIKELY(compatibleArrayTypes
+               (t, objectClass(t, src), objectClass(t, dst))))
+    {
+      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
+
+      if (LIKELY(elementSize)) {
+        intptr_t sl = cast<uintptr_t>(src, BytesPerWord);
+        intptr_t dl = cast<uintptr_t>(dst, BytesPerWord);
+        if (LIKELY(length > 0)) {
+          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
+                     dstOffset >= 0 and dstOffset + length <= dl))
+          {
+            uint8_t* sbody = &cast<uint8_t>(src, ArrayBody);
+            uint8_t* dbody = &cast<uint8_t>(dst, ArrayBody);
+            if (src == dst) {
+              memmove(dbody + (dstOffset * elementSize),
+                      sbody + (srcOffset * elementSize),
+                      length * elementSize);
+            } else {
+              memcpy(dbody + (dstOffset * elementSize),
+                     sbody + (srcOffset * elementSize),
+                     length * elementSize);
+            }
+
+            if (classObjectMask(t, objectClass(t, dst))) {
+              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
+            }
+
+            return;
+          } else {
+            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
+          }
+        } else {
+          return;
+        }
+      }
+    }
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+    return;
+  }
+
+  throwNew(t, Machine::ArrayStoreExceptionType);
+}
+
 object
 findFieldInClass(Thread* t, object class_, object name, object spec)
 {
@@ -4554,11 +6198,86 @@ addFinalizer(Thread* t, object target, void (*finalize)(Thread*, object))
   t->m->finalizers = f;
 }
 
+// Records the identity hash of the specified object, which is being
+// marked as hashed for the first time.  The caller must hold the
+// heap lock.  The hash only goes on the list of young hashes, not in
+// their buckets, since it cannot be looked up before the object has
+// moved, which is when the collector rebuilds them.
+void
+recordIdentityHash(Thread* t, object o)
+{
+  IdentityHash* h = static_cast<IdentityHash*>
+    (t->m->heap->allocate(sizeof(IdentityHash)));
+  h->bucketNext = 0;
+  h->target = o;
+  h->value = takeHash(t, o);
+
+  h->next = t->m->identityHashes.list;
+  t->m->identityHashes.list = h;
+  ++ t->m->identityHashes.count;
+}
+
+uint32_t
+movedIdentityHash(Thread* t, object o)
+{
+  IdentityHashTable* tables[] = { &(t->m->identityHashes),
+                                  &(t->m->tenuredIdentityHashes) };
+  for (unsigned i = 0; i < 2; ++i) {
+    IdentityHashTable* table = tables[i];
+    if (table->buckets) {
+      for (IdentityHash* h = table->buckets[identityHashBucket(table, o)];
+           h; h = h->bucketNext)
+      {
+        if (h->target == o) {
+          return h->value;
+        }
+      }
+    }
+  }
+
+  abort(t);
+}
+
+// Acquires the monitor for the specified object with the monitor
+// profile enabled, which times any wait for it.
+void
+acquireProfiled(Thread* t, object o)
+{
+  PROTECT(t, o);
+
+  object m = objectMonitor(t, o, true);
+
+  if (not monitorTryAcquire(t, m)) {
+    PROTECT(t, m);
+
+    // describe the site before blocking rather than after, so as not
+    // to add the stack walk to the time the monitor is held
+    MonitorSite site;
+    describeMonitorSite(t, o, site.name, site.stack);
+
+    int64_t start = t->m->system->nowMicroseconds();
+
+    monitorAcquire(t, m);
+
+    recordMonitorContention
+      (t, &site, t->m->system->nowMicroseconds() - start);
+  }
+}
+
 object
 objectMonitor(Thread* t, object o, bool createNew)
 {
   assert(t, t->state == Thread::ActiveState);
 
+  // each thread remembers the last monitor it looked up, which makes
+  // the usual sequence of acquiring and releasing the same monitor,
+  // and repeatedly synchronizing on the same object, avoid the hash
+  // map.  The entry is weak, and postVisit clears it before the
+  // object's removeMonitor finalizer can run.
+  if (t->lastMonitorObject == o) {
+    return t->lastMonitor;
+  }
+
   object m = hashMapFind
     (t, root(t, Machine::MonitorMap), o, objectHash, objectEqual);
 
@@ -4567,6 +6286,9 @@ objectMonitor(Thread* t, object o, bool createNew)
       fprintf(stderr, "found monitor %p for object %x\n", m, objectHash(t, o));
     }
 
+    t->lastMonitorObject = o;
+    t->lastMonitor = m;
+
     return m;
   } else if (createNew) {
     PROTECT(t, o);
@@ -4599,6 +6321,9 @@ objectMonitor(Thread* t, object o, bool createNew)
       addFinalizer(t, o, removeMonitor);
     }
 
+    t->lastMonitorObject = o;
+    t->lastMonitor = m;
+
     return m;
   } else {
     return 0;
@@ -4608,11 +6333,20 @@ objectMonitor(Thread* t, object o, bool createNew)
 object
 intern(Thread* t, object s)
 {
+  // Entries are only inserted under referenceLock and only removed
+  // during collections, which cannot run while we are active, so a
+  // probe without the lock can at worst miss a concurrent insert.
+  object n = hashMapFindNode
+    (t, root(t, Machine::StringMap), s, stringHash, stringEqual);
+  if (n) {
+    return jreferenceTarget(t, tripleFirst(t, n));
+  }
+
   PROTECT(t, s);
 
   ACQUIRE(t, t->m->referenceLock);
 
-  object n = hashMapFindNode
+  n = hashMapFindNode
     (t, root(t, Machine::StringMap), s, stringHash, stringEqual);
 
   if (n) {
@@ -4624,6 +6358,32 @@ intern(Thread* t, object s)
   }
 }
 
+object
+internAscii(Thread* t, object bytes, unsigned offset, unsigned length)
+{
+  const int8_t* chars = &byteArrayBody(t, bytes, offset);
+
+  object array = hashMapArray(t, root(t, Machine::StringMap));
+  if (array) {
+    unsigned index = hash(chars, length) & (arrayLength(t, array) - 1);
+    for (object n = arrayBody(t, array, index); n; n = tripleThird(t, n)) {
+      object s = jreferenceTarget(t, tripleFirst(t, n));
+      if (s and stringLength(t, s) == length) {
+        unsigned i = 0;
+        while (i < length and stringCharAt(t, s, i) == chars[i]) {
+          ++ i;
+        }
+
+        if (i == length) {
+          return s;
+        }
+      }
+    }
+  }
+
+  return intern(t, t->m->classpath->makeString(t, bytes, offset, length));
+}
+
 void
 collect(Thread* t, Heap::CollectionType type)
 {
@@ -4672,12 +6432,17 @@ walk(Thread* t, Heap::Walker* w, object o, unsigned start)
       = (arrayElementSize ?
          cast<uintptr_t>(o, fixedSize - BytesPerWord) : 0);
 
-    THREAD_RUNTIME_ARRAY(t, uint32_t, mask, intArrayLength(t, objectMask));
-    memcpy(RUNTIME_ARRAY_BODY(mask), &intArrayBody(t, objectMask, 0),
-           intArrayLength(t, objectMask) * 4);
+    if (start == 0 and intArrayLength(t, objectMask) == 1) {
+      more = ::walk(w, intArrayBody(t, objectMask, 0), fixedSize,
+                    arrayElementSize, arrayLength);
+    } else {
+      THREAD_RUNTIME_ARRAY(t, uint32_t, mask, intArrayLength(t, objectMask));
+      memcpy(RUNTIME_ARRAY_BODY(mask), &intArrayBody(t, objectMask, 0),
+             intArrayLength(t, objectMask) * 4);
 
-    more = ::walk(t, w, RUNTIME_ARRAY_BODY(mask), fixedSize, arrayElementSize,
-                  arrayLength, start);
+      more = ::walk(t, w, RUNTIME_ARRAY_BODY(mask), fixedSize,
+                    arrayElementSize, arrayLength, start);
+    }
   } else if (classVmFlags(t, class_) & SingletonFlag) {
     unsigned length = singletonLength(t, o);
     if (length) {
@@ -4757,14 +6522,12 @@ printTrace(Thread* t, object exception)
 
     object trace = throwableTrace(t, e);
     if (trace) {
-      for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-        object e = objectArrayBody(t, trace, i);
+      for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+        object m = traceMethod(t, trace, i);
         const int8_t* class_ = &byteArrayBody
-          (t, className(t, methodClass(t, traceElementMethod(t, e))), 0);
-        const int8_t* method = &byteArrayBody
-          (t, methodName(t, traceElementMethod(t, e)), 0);
-        int line = t->m->processor->lineNumber
-          (t, traceElementMethod(t, e), traceElementIp(t, e));
+          (t, className(t, methodClass(t, m)), 0);
+        const int8_t* method = &byteArrayBody(t, methodName(t, m), 0);
+        int line = t->m->processor->lineNumber(t, m, traceIp(t, trace, i));
 
         fprintf(errorLog(t), "  at %s.%s ", class_, method);
 
@@ -4789,6 +6552,17 @@ printTrace(Thread* t, object exception)
   fflush(errorLog(t));
 }
 
+object
+makeTrace(Thread* t, unsigned length)
+{
+  object methods = makeArray(t, length);
+  PROTECT(t, methods);
+
+  object ips = makeIntArray(t, length);
+
+  return makeRawTrace(t, methods, ips);
+}
+
 object
 makeTrace(Thread* t, Processor::StackWalker* walker)
 {
@@ -4798,13 +6572,14 @@ makeTrace(Thread* t, Processor::StackWalker* walker)
 
     virtual bool visit(Processor::StackWalker* walker) {
       if (trace == 0) {
-        trace = makeObjectArray(t, walker->count());
+        trace = makeTrace(t, walker->count());
         vm_assert(t, trace);
       }
 
-      object e = makeTraceElement(t, walker->method(), walker->ip());
-      vm_assert(t, index < objectArrayLength(t, trace));
-      set(t, trace, ArrayBody + (index * BytesPerWord), e);
+      vm_assert(t, index < traceLength(t, trace));
+      set(t, rawTraceMethods(t, trace), ArrayBody + (index * BytesPerWord),
+          walker->method());
+      intArrayBody(t, rawTraceIps(t, trace), index) = walker->ip();
       ++ index;
       return true;
     }
@@ -4817,7 +6592,7 @@ makeTrace(Thread* t, Processor::StackWalker* walker)
 
   walker->walk(&v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  return v.trace ? v.trace : makeTrace(t, 0u);
 }
 
 object
@@ -4838,7 +6613,30 @@ makeTrace(Thread* t, Thread* target)
 
   t->m->processor->walkStack(target, &v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  return v.trace ? v.trace : makeTrace(t, 0u);
+}
+
+// detaches up to FinalizeBatchSize entries from the head of the
+// specified queue, linked through the field at nextOffset, leaving
+// the rest for other finalizer threads
+object
+takeFinalizeBatch(Thread* t, Machine::Root queue, unsigned nextOffset)
+{
+  object batch = root(t, queue);
+  if (batch) {
+    object last = batch;
+    unsigned count = 1;
+    while (count < FinalizeBatchSize and cast<object>(last, nextOffset)) {
+      last = cast<object>(last, nextOffset);
+      ++ count;
+    }
+
+    setRoot(t, queue, cast<object>(last, nextOffset));
+    set(t, last, nextOffset, 0);
+
+    t->m->finalizeQueueLength -= count;
+  }
+  return batch;
 }
 
 void
@@ -4853,7 +6651,7 @@ runFinalizeThread(Thread* t)
   while (true) {
     { ACQUIRE(t, t->m->stateLock);
 
-      while (t->m->finalizeThread
+      while (isFinalizeThread(t)
              and root(t, Machine::ObjectsToFinalize) == 0
              and root(t, Machine::ObjectsToClean) == 0)
       {
@@ -4861,14 +6659,14 @@ runFinalizeThread(Thread* t)
         t->m->stateLock->wait(t->systemThread, 0);
       }
 
-      if (t->m->finalizeThread == 0) {
+      if (not isFinalizeThread(t)) {
         return;
       } else {
-        finalizeList = root(t, Machine::ObjectsToFinalize);
-        setRoot(t, Machine::ObjectsToFinalize, 0);
+        finalizeList = takeFinalizeBatch
+          (t, Machine::ObjectsToFinalize, FinalizerQueueNext);
 
-        cleanList = root(t, Machine::ObjectsToClean);
-        setRoot(t, Machine::ObjectsToClean, 0);
+        cleanList = takeFinalizeBatch
+          (t, Machine::ObjectsToClean, CleanerQueueNext);
       }
     }
 
@@ -4882,6 +6680,56 @@ runFinalizeThread(Thread* t)
   }
 }
 
+// Writes each dump requested of the monitor profile until
+// shutDown tells the thread to exit.
+void
+runMonitorDumpThread(Thread* t)
+{
+  MonitorProfile* profile = t->m->monitorProfile;
+
+  while (true) {
+    { ACQUIRE(t, t->m->stateLock);
+
+      while (isMonitorDumpThread(t) and not profile->dumpRequested) {
+        ENTER(t, Thread::IdleState);
+        t->m->stateLock->wait(t->systemThread, MonitorDumpPollInterval);
+      }
+
+      if (not isMonitorDumpThread(t)) {
+        return;
+      }
+
+      profile->dumpRequested = false;
+    }
+
+    dumpMonitors(t);
+  }
+}
+
+void
+startMonitorDumpThread(Thread* t)
+{
+  MonitorProfile* profile = t->m->monitorProfile;
+
+  object javaThread = t->m->classpath->makeThread(t, t);
+  PROTECT(t, javaThread);
+
+  threadDaemon(t, javaThread) = true;
+
+  Thread* p = t->m->processor->makeThread(t->m, javaThread, t->m->rootThread);
+
+  profile->thread = p;
+
+  addThread(t, p);
+
+  if (not startThread(t, p)) {
+    removeThread(t, p);
+    profile->thread = 0;
+
+    fprintf(stderr, "warning: unable to start the monitor dump thread\n");
+  }
+}
+
 object
 parseUtf8(Thread* t, const char* data, unsigned length)
 {
@@ -4905,15 +6753,10 @@ parseUtf8(Thread* t, const char* data, unsigned length)
 object
 parseUtf8(Thread* t, object array)
 {
-  for (unsigned i = 0; i < byteArrayLength(t, array) - 1; ++i) {
-    if (byteArrayBody(t, array, i) & 0x80) {
-      goto slow_path;
-    }
+  if (isAscii(t, array)) {
+    return array;
   }
 
-  return array;
-
- slow_path:
   class Client: public Stream::Client {
    public:
     Client(Thread* t): t(t) { }
@@ -105,18 +105,89 @@ const uintptr_t HashTakenMark = 1;
 const uintptr_t ExtendedMark = 2;
 const uintptr_t FixedMark = 3;
 
+// With UseIdentityHashTable, an object whose identity hash has been
+// taken keeps its size when the collector moves it.  The hash is
+// recorded in a side table when it is first taken, and the object is
+// marked with HashMovedMark (taking the place of ExtendedMark) after
+// it has moved, so only hashes of moved objects need a lookup.
+// Otherwise, each such object grows by a word holding its hash the
+// first time it moves.
+const bool UseIdentityHashTable = true;
+
+const uintptr_t HashMovedMark = 2;
+
 const unsigned ThreadHeapSizeInBytes = 64 * 1024;
 const unsigned ThreadHeapSizeInWords = ThreadHeapSizeInBytes / BytesPerWord;
 
+// a thread's default heap shrinks toward the minimum while the thread
+// allocates little and grows back to ThreadHeapSizeInBytes when it
+// allocates more, while the buffers it takes from the heap pool double
+// up to the maximum with each refill between collections:
+const unsigned MinimumThreadHeapSizeInBytes = 16 * 1024;
+const unsigned MinimumThreadHeapSizeInWords
+= MinimumThreadHeapSizeInBytes / BytesPerWord;
+
+const unsigned MaximumThreadHeapSizeInBytes = 8 * ThreadHeapSizeInBytes;
+const unsigned MaximumThreadHeapSizeInWords
+= MaximumThreadHeapSizeInBytes / BytesPerWord;
+
 const unsigned ThreadBackupHeapSizeInBytes = 2 * 1024;
 const unsigned ThreadBackupHeapSizeInWords
 = ThreadBackupHeapSizeInBytes / BytesPerWord;
 
 const unsigned ThreadHeapPoolSize = 64;
 
+const unsigned ThreadHeapPoolSizeInWords
+= ThreadHeapPoolSize * ThreadHeapSizeInWords;
+
 const unsigned FixedFootprintThresholdInBytes
 = ThreadHeapPoolSize * ThreadHeapSizeInBytes;
 
+// zones give their segments back to a pool shared by the machine,
+// which keeps up to this many bytes of them for other zones to reuse:
+const unsigned ZonePoolCapacityInBytes = 1024 * 1024;
+
+// finalizers and cleaners are run by a pool of up to
+// avian.finalizer.threads threads (default one), capped at this many:
+const unsigned MaximumFinalizeThreadCount = 16;
+
+// each finalizer thread takes at most this many finalizers and this
+// many cleaners from the queues at a time, so a backlog is shared
+// among the pool:
+const unsigned FinalizeBatchSize = 64;
+
+// collection pauses are counted in power-of-two buckets of
+// microseconds, the last of which holds everything longer:
+const unsigned PauseHistogramSize = 24;
+
+// with the avian.startup.log property set, the slowest class
+// initializers run during startup are reported, up to this many, with
+// their names truncated to fit StartupClassNameSize bytes:
+const unsigned StartupInitializerCount = 16;
+const unsigned StartupClassNameSize = 128;
+
+// with the avian.alloc.profile property set, a thread's stack is
+// sampled about once every avian.alloc.sample bytes it allocates:
+const unsigned DefaultAllocationSampleIntervalInBytes = 512 * 1024;
+
+const unsigned AllocationSiteTableSize = 1024;
+
+// with the avian.monitor.profile property set, blocked monitor
+// acquisitions are aggregated by the class of the object locked and
+// the acquiring method and line, keeping for each site the stack of
+// its longest wait; both are truncated to fit these many bytes:
+const unsigned MonitorSiteTableSize = 1024;
+const unsigned MonitorSiteNameSize = 256;
+const unsigned MonitorSiteStackSize = 1024;
+
+// a dump requested by SIGQUIT (Ctrl-Break on Windows) lists this many
+// of the sites which spent the most time blocked:
+const unsigned MonitorDumpSiteCount = 16;
+
+// how often, in milliseconds, the monitor dump thread checks for such
+// a request, since a signal handler cannot wake it directly:
+const unsigned MonitorDumpPollInterval = 100;
+
 // number of zombie threads which may accumulate before we force a GC
 // to clean them up:
 const unsigned ZombieCollectionThreshold = 16;
@@ -159,6 +230,9 @@ const unsigned ContinuationFlag = 1 << 11;
 // method vmFlags:
 const unsigned ClassInitFlag = 1 << 0;
 const unsigned ConstructorFlag = 1 << 1;
+const unsigned CompilingFlag = 1 << 2;
+const unsigned FusedFlag = 1 << 3;
+const unsigned OverriddenFlag = 1 << 4;
 
 #ifndef JNI_VERSION_1_6
 #define JNI_VERSION_1_6 0x00010006
@@ -1188,8 +1262,128 @@ class Reference {
   bool weak;
 };
 
+// the identity hash of an object, recorded when it was first taken
+class IdentityHash {
+ public:
+  IdentityHash* next;
+  IdentityHash* bucketNext;
+  object target;
+  uint32_t value;
+};
+
+// identity hashes keyed by the current addresses of their objects;
+// the buckets are only changed while the collector has the world
+// stopped, so lookups need no lock
+class IdentityHashTable {
+ public:
+  IdentityHash* list;
+  IdentityHash** buckets;
+  unsigned count;
+  unsigned capacity;
+};
+
 class Classpath;
 
+// a sampled allocation stack, whose frames, outermost first and
+// separated by semicolons, follow this header, and the bytes
+// attributed to it:
+class AllocationSite {
+ public:
+  AllocationSite* next;
+  uint64_t footprint;
+  unsigned length;
+};
+
+// phases of startup timed on the root thread with the
+// avian.startup.log property set; each phase is charged only for time
+// not spent in another phase nested within it:
+enum StartupPhase {
+  MachineStartupPhase,
+  BootStartupPhase,
+  ClassLoadStartupPhase,
+  ClassInitStartupPhase,
+  CompileStartupPhase,
+  StartupPhaseCount
+};
+
+class StartupTimer;
+
+// the time spent running a class initializer, excluding that spent in
+// any other initializer it triggered:
+class StartupInitializer {
+ public:
+  int64_t time;
+  char name[StartupClassNameSize];
+};
+
+class StartupStatistics {
+ public:
+  int64_t start;
+  int64_t phases[StartupPhaseCount];
+  StartupTimer* timer;
+  unsigned initializerCount;
+  StartupInitializer initializers[StartupInitializerCount];
+};
+
+class MonitorSite {
+ public:
+  MonitorSite* next;
+  uint64_t count;
+  int64_t time;
+  int64_t maxTime;
+  char name[MonitorSiteNameSize];
+  char stack[MonitorSiteStackSize];
+};
+
+// the state behind avian.monitor.profile, which doubles as the
+// handler for dump requests; since those arrive as signals, the
+// handler just flags the request, and a dedicated thread writes the
+// dump
+class MonitorProfile: public System::SignalHandler {
+ public:
+  virtual bool handleSignal(void**, void**, void**, void**) {
+    dumpRequested = true;
+    return false;
+  }
+
+  FILE* log;
+  System::Monitor* lock;
+  Thread* thread;
+  uintptr_t dumpRequested;
+  MonitorSite* sites[MonitorSiteTableSize];
+};
+
+// the default heap of a thread disposed of before the collection
+// which would move any live objects out of it:
+class RetiredHeap {
+ public:
+  RetiredHeap* next;
+  uintptr_t* heap;
+  unsigned sizeInWords;
+};
+
+// a class which a thread is parsing outside of classLock; other
+// threads wanting the same class wait for it to be registered
+class NativeSymbols;
+
+class PendingClass {
+ public:
+  PendingClass* next;
+  Thread* owner;
+  object* loader;
+  object* spec;
+};
+
+// a thread waiting for another to finish parsing a class; following
+// these from owner to owner finds a circular hierarchy split across
+// threads, which would otherwise leave each waiting on the other
+class PendingClassWait {
+ public:
+  PendingClassWait* next;
+  Thread* waiter;
+  PendingClass* class_;
+};
+
 class Machine {
  public:
   enum Type {
@@ -1218,19 +1412,21 @@ class Machine {
     JNIMethodTable,
     JNIFieldTable,
     ShutdownHooks,
-    FinalizerThread,
+    FinalizerThreads,
     ObjectsToFinalize,
     ObjectsToClean,
     NullPointerException,
     ArithmeticException,
     ArrayIndexOutOfBoundsException,
     OutOfMemoryError,
+    StackOverflowError,
     Shutdown,
     VirtualFileFinders,
-    VirtualFiles
+    VirtualFiles,
+    ClassFiles
   };
 
-  static const unsigned RootCount = VirtualFiles + 1;
+  static const unsigned RootCount = ClassFiles + 1;
 
   Machine(System* system, Heap* heap, Finder* bootFinder, Finder* appFinder,
           Processor* processor, Classpath* classpath, const char** properties,
@@ -1251,9 +1447,12 @@ class Machine {
   Finder* appFinder;
   Processor* processor;
   Classpath* classpath;
+  Zone::Pool zonePool;
   Thread* rootThread;
   Thread* exclusive;
-  Thread* finalizeThread;
+  Thread* finalizeThreads[MaximumFinalizeThreadCount];
+  unsigned finalizeThreadCount;
+  unsigned finalizeQueueLength;
   Reference* jniReferences;
   const char** properties;
   unsigned propertyCount;
@@ -1281,6 +1480,8 @@ class Machine {
   object finalizeQueue;
   object weakReferences;
   object tenuredWeakReferences;
+  IdentityHashTable identityHashes;
+  IdentityHashTable tenuredIdentityHashes;
   bool unsafe;
   bool collecting;
   bool triedBuiltinOnLoad;
@@ -1289,10 +1490,40 @@ class Machine {
   JavaVMVTable javaVMVTable;
   JNIEnvVTable jniEnvVTable;
   uintptr_t* heapPool[ThreadHeapPoolSize];
+  unsigned heapPoolSizes[ThreadHeapPoolSize];
   unsigned heapPoolIndex;
+  unsigned heapPoolFootprint;
+  unsigned heapPoolLimitInWords;
+  unsigned heapRefillCount;
+  unsigned heapWasteFootprint;
+  unsigned largeObjectThresholdInWords;
   unsigned bootimageSize;
+  int64_t referenceTime;
+  int64_t safepointTime;
+  unsigned pauseHistogram[PauseHistogramSize];
+  unsigned allocationSampleInterval;
+  AllocationSite** allocationSites;
+  RetiredHeap* retiredHeaps;
+  unsigned retiredFootprint;
+  PendingClass* pendingClasses;
+  PendingClassWait* pendingClassWaits;
+  NativeSymbols* nativeSymbols;
+  StartupStatistics* startupStatistics;
+  MonitorProfile* monitorProfile;
 };
 
+NativeSymbols*
+makeNativeSymbols(Machine* m);
+
+void
+disposeNativeSymbols(Thread* t);
+
+// Queues the names of the as yet unbound native methods of the
+// specified class for lookup on a background thread if eager binding
+// is enabled.
+void
+bindNatives(Thread* t, object class_);
+
 void
 printTrace(Thread* t, object exception);
 
@@ -1511,8 +1742,15 @@ class Thread {
   System::Monitor* lock;
   object javaThread;
   object exception;
+  object lastMonitorObject;
+  object lastMonitor;
   unsigned heapIndex;
   unsigned heapOffset;
+  unsigned heapSizeInWords;
+  unsigned defaultHeapSizeInWords;
+  unsigned heapRefillCount;
+  unsigned allocationSinceSample;
+  uintptr_t safepointRequested;
   Protector* protector;
   ClassInitStack* classInitStack;
   Resource* resource;
@@ -1647,6 +1885,60 @@ class StateResource: public Thread::Resource {
   Thread::State oldState;
 };
 
+// charges the time from its construction to its release to a phase of
+// startup, if startup is being timed and t is the root thread
+class StartupTimer: public Thread::Resource {
+ public:
+  StartupTimer(Thread* t, StartupPhase phase, object class_ = 0):
+    Resource(t),
+    statistics(t == t->m->rootThread ? t->m->startupStatistics : 0),
+    phase(phase),
+    class_(class_),
+    protector(t, &(this->class_))
+  {
+    if (UNLIKELY(statistics)) {
+      start();
+    }
+  }
+
+  ~StartupTimer() {
+    if (UNLIKELY(statistics)) {
+      stop();
+    }
+  }
+
+  virtual void release() {
+    this->StartupTimer::~StartupTimer();
+  }
+
+  void start();
+
+  void stop();
+
+  StartupStatistics* statistics;
+  StartupTimer* next;
+  StartupPhase phase;
+  object class_;
+  Thread::SingleProtector protector;
+  int64_t begin;
+  int64_t nested;
+  int64_t nestedInitializers;
+};
+
+void
+logStartup(Machine* m);
+
+inline void
+finishStartup(Thread* t)
+{
+  if (UNLIKELY(t->m->startupStatistics)
+      and t == t->m->rootThread
+      and t->m->startupStatistics->timer == 0)
+  {
+    logStartup(t->m);
+  }
+}
+
 inline void
 dispose(Thread* t, Reference* r)
 {
@@ -1654,7 +1946,7 @@ dispose(Thread* t, Reference* r)
   if (r->next) {
     r->next->handle = r->handle;
   }
-  t->m->heap->free(r, sizeof(*r));
+  t->m->heap->allocator(Heap::JniMemory)->free(r, sizeof(*r));
 }
 
 inline void
@@ -1778,10 +2070,12 @@ expect(Thread* t, bool v)
   expect(t->m->system, v);
 }
 
+// allocates from a fixed area, accounting what it allocates to
+// Heap::CodeMemory if heap is set:
 class FixedAllocator: public Allocator {
  public:
   FixedAllocator(System* s, uint8_t* base, unsigned capacity):
-    s(s), base(base), offset(0), capacity(capacity)
+    s(s), heap(0), base(base), offset(0), capacity(capacity)
   { }
 
   virtual void* tryAllocate(unsigned size) {
@@ -1794,6 +2088,11 @@ class FixedAllocator: public Allocator {
 
     void* p = base + offset;
     offset += paddedSize;
+
+    if (heap) {
+      heap->account(Heap::CodeMemory, paddedSize);
+    }
+
     return p;
   }
 
@@ -1804,12 +2103,17 @@ class FixedAllocator: public Allocator {
   virtual void free(const void* p, unsigned size) {
     if (p >= base and static_cast<const uint8_t*>(p) + size == base + offset) {
       offset -= size;
+
+      if (heap) {
+        heap->account(Heap::CodeMemory, - static_cast<int>(size));
+      }
     } else {
       abort(s);
     }
   }
 
   System* s;
+  Heap* heap;
   uint8_t* base;
   unsigned offset;
   unsigned capacity;
@@ -1819,7 +2123,7 @@ inline bool
 ensure(Thread* t, unsigned sizeInBytes)
 {
   if (t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-      > ThreadHeapSizeInWords)
+      > t->heapSizeInWords)
   {
     if (sizeInBytes <= ThreadBackupHeapSizeInBytes) {
       expect(t, (t->flags & Thread::UseBackupHeapFlag) == 0);
@@ -1846,7 +2150,7 @@ inline object
 allocateSmall(Thread* t, unsigned sizeInBytes)
 {
   assert(t, t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-         <= ThreadHeapSizeInWords);
+         <= t->heapSizeInWords);
 
   object o = reinterpret_cast<object>(t->heap + t->heapIndex);
   t->heapIndex += ceiling(sizeInBytes, BytesPerWord);
@@ -1859,7 +2163,9 @@ allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
   stress(t);
 
   if (UNLIKELY(t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-               > ThreadHeapSizeInWords
+               > t->heapSizeInWords
+               or ceiling(sizeInBytes, BytesPerWord)
+               > t->m->largeObjectThresholdInWords
                or t->m->exclusive))
   {
     return allocate2(t, sizeInBytes, objectMask);
@@ -1920,6 +2226,26 @@ findProperty(Thread* t, const char* name)
   return findProperty(t->m, name);
 }
 
+inline int
+parseSize(const char* s)
+{
+  unsigned length = strlen(s);
+  RUNTIME_ARRAY(char, buffer, length + 1);
+  if (length == 0) {
+    return 0;
+  } else if (s[length - 1] == 'k' or s[length - 1] == 'K') {
+    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
+    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
+    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024;
+  } else if (s[length - 1] == 'm' or s[length - 1] == 'M') {
+    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
+    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
+    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024 * 1024;
+  } else {
+    return atoi(s);
+  }
+}
+
 object&
 arrayBodyUnsafe(Thread*, object, unsigned);
 
@@ -1952,6 +2278,29 @@ runJavaThread(Thread* t)
 void
 runFinalizeThread(Thread* t);
 
+void
+runMonitorDumpThread(Thread* t);
+
+void
+startMonitorDumpThread(Thread* t);
+
+inline bool
+isMonitorDumpThread(Thread* t)
+{
+  return t->m->monitorProfile and t->m->monitorProfile->thread == t;
+}
+
+inline bool
+isFinalizeThread(Thread* t)
+{
+  for (unsigned i = 0; i < t->m->finalizeThreadCount; ++i) {
+    if (t->m->finalizeThreads[i] == t) {
+      return true;
+    }
+  }
+  return false;
+}
+
 inline uint64_t
 runThread(Thread* t, uintptr_t*)
 {
@@ -1959,8 +2308,10 @@ runThread(Thread* t, uintptr_t*)
 
   checkDaemon(t);
 
-  if (t == t->m->finalizeThread) {
+  if (isFinalizeThread(t)) {
     runFinalizeThread(t);
+  } else if (isMonitorDumpThread(t)) {
+    runMonitorDumpThread(t);
   } else if (t->javaThread) {
     runJavaThread(t);
   }
@@ -1968,6 +2319,9 @@ runThread(Thread* t, uintptr_t*)
   return 1;
 }
 
+void
+retireZombies(Thread* t, Thread* o);
+
 inline bool
 startThread(Thread* t, Thread* p)
 {
@@ -2023,6 +2377,10 @@ startThread(Thread* t, object javaThread)
     stress(t);
 
     ACQUIRE_RAW(t, t->m->stateLock);
+
+    if (t->m->threadCount > t->m->liveCount) {
+      retireZombies(t, t->m->rootThread);
+    }
     
     if (t->m->threadCount > t->m->liveCount + ZombieCollectionThreshold) {
       collect(t, Heap::MinorCollection);
@@ -2135,7 +2493,15 @@ objectFixed(Thread*, object o)
 inline bool
 objectExtended(Thread*, object o)
 {
-  return (alias(o, 0) & (~PointerMask)) == ExtendedMark;
+  return (not UseIdentityHashTable)
+    and (alias(o, 0) & (~PointerMask)) == ExtendedMark;
+}
+
+inline bool
+hashMoved(Thread*, object o)
+{
+  return UseIdentityHashTable
+    and (alias(o, 0) & (~PointerMask)) == HashMovedMark;
 }
 
 inline bool
@@ -2155,6 +2521,32 @@ baseSize(Thread* t, object o, object class_)
               BytesPerWord);
 }
 
+// A raw trace records just the method and IP of each frame, in an
+// array and an int array, so capturing one costs the same three
+// allocations however deep the stack is.  Stack trace elements are
+// only made from it on demand.
+
+inline unsigned
+traceLength(Thread* t, object trace)
+{
+  return arrayLength(t, rawTraceMethods(t, trace));
+}
+
+inline object
+traceMethod(Thread* t, object trace, unsigned index)
+{
+  return arrayBody(t, rawTraceMethods(t, trace), index);
+}
+
+inline int
+traceIp(Thread* t, object trace, unsigned index)
+{
+  return intArrayBody(t, rawTraceIps(t, trace), index);
+}
+
+object
+makeTrace(Thread* t, unsigned length);
+
 object
 makeTrace(Thread* t, Processor::StackWalker* walker);
 
@@ -2299,16 +2691,30 @@ extendedSize(Thread* t, object o, unsigned baseSize)
   return baseSize + objectExtended(t, o);
 }
 
+void
+recordIdentityHash(Thread* t, object o);
+
+uint32_t
+movedIdentityHash(Thread* t, object o);
+
 inline void
 markHashTaken(Thread* t, object o)
 {
   assert(t, not objectExtended(t, o));
+  assert(t, not hashMoved(t, o));
   assert(t, not objectFixed(t, o));
 
   ACQUIRE_RAW(t, t->m->heapLock);
 
-  alias(o, 0) |= HashTakenMark;
-  t->m->heap->pad(o);
+  if (UseIdentityHashTable) {
+    if (not hashTaken(t, o)) {
+      alias(o, 0) |= HashTakenMark;
+      recordIdentityHash(t, o);
+    }
+  } else {
+    alias(o, 0) |= HashTakenMark;
+    t->m->heap->pad(o);
+  }
 }
 
 inline uint32_t
@@ -2326,8 +2732,10 @@ objectHash(Thread* t, object o)
 {
   if (objectExtended(t, o)) {
     return extendedWord(t, o, baseSize(t, o, objectClass(t, o)));
+  } else if (hashMoved(t, o)) {
+    return movedIdentityHash(t, o);
   } else {
-    if (not objectFixed(t, o)) {
+    if (not (objectFixed(t, o) or hashTaken(t, o))) {
       markHashTaken(t, o);
     }
     return takeHash(t, o);
@@ -2514,11 +2922,31 @@ scanMethodSpec(Thread* t, const char* s, unsigned* parameterCount,
 object
 findLoadedClass(Thread* t, object loader, object spec);
 
+void
+parseDeferredCode(Thread* t, object method);
+
+// Makes sure the code of method has been parsed.  Classes loaded from
+// a region keep it and leave each method's Code attribute unparsed
+// until the method is first interpreted, compiled or inspected.
+inline void
+ensureCode(Thread* t, object method)
+{
+  object code = methodCode(t, method);
+  if (UNLIKELY(code and codeClassFile(t, code))) {
+    parseDeferredCode(t, method);
+  }
+}
+
 inline bool
 emptyMethod(Thread* t, object method)
 {
-  return ((methodFlags(t, method) & ACC_NATIVE) == 0)
-    and (codeLength(t, methodCode(t, method)) == 1)
+  if (methodFlags(t, method) & ACC_NATIVE) {
+    return false;
+  }
+
+  ensureCode(t, method);
+
+  return (codeLength(t, methodCode(t, method)) == 1)
     and (codeBody(t, methodCode(t, method), 0) == return_);
 }
 
@@ -2530,7 +2958,8 @@ parseUtf8(Thread* t, object array);
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned length,
-           Machine::Type throwType = Machine::NoClassDefFoundErrorType);
+           Machine::Type throwType = Machine::NoClassDefFoundErrorType,
+           System::Region** region = 0);
 
 object
 resolveClass(Thread* t, object loader, object name, bool throw_ = true,
@@ -2607,6 +3036,13 @@ makeObjectArray(Thread* t, unsigned count)
   return makeObjectArray(t, type(t, Machine::JobjectType), count);
 }
 
+bool
+compatibleArrayTypes(Thread* t, object a, object b);
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length);
+
 object
 findFieldInClass(Thread* t, object class_, object name, object spec);
 
@@ -3172,9 +3608,17 @@ class ObjectMonitorResource {
 object
 objectMonitor(Thread* t, object o, bool createNew);
 
+void
+acquireProfiled(Thread* t, object o);
+
 inline void
 acquire(Thread* t, object o)
 {
+  if (UNLIKELY(t->m->monitorProfile)) {
+    acquireProfiled(t, o);
+    return;
+  }
+
   unsigned hash;
   if (DebugMonitors) {
     hash = objectHash(t, o);
@@ -3317,6 +3761,21 @@ exceptionMatch(Thread* t, object type, object exception)
 object
 intern(Thread* t, object s);
 
+// Returns the interned string with the characters of the specified
+// ASCII range of a byte array, only creating a string if there is no
+// such entry yet.
+object
+internAscii(Thread* t, object bytes, unsigned offset, unsigned length);
+
+inline bool
+isAscii(Thread* t, object bytes)
+{
+  unsigned length = byteArrayLength(t, bytes) - 1;
+  return asciiLength
+    (reinterpret_cast<const uint8_t*>(&byteArrayBody(t, bytes, 0)), length)
+    == length;
+}
+
 void
 walk(Thread* t, Heap::Walker* w, object o, unsigned start);
 
@@ -3698,7 +4157,7 @@ getClassRuntimeData(Thread* t, object c)
     ACQUIRE(t, t->m->classLock);
 
     if (classRuntimeDataIndex(t, c) == 0) {
-      object runtimeData = makeClassRuntimeData(t, 0, 0, 0, 0);
+      object runtimeData = makeClassRuntimeData(t, 0, 0, 0, 0, 0);
 
       setRoot(t, Machine::ClassRuntimeDataTable, vectorAppend
               (t, root(t, Machine::ClassRuntimeDataTable), runtimeData));
@@ -3790,7 +4249,7 @@ registerNative(Thread* t, object method, void* function)
 
   expect(t, methodFlags(t, method) & ACC_NATIVE);
 
-  object native = makeNative(t, function, false);
+  object native = makeNative(t, function, false, false);
   PROTECT(t, native);
 
   object runtimeData = getMethodRuntimeData(t, method);
@@ -3828,6 +4287,12 @@ defineClass(Thread* t, object loader, const uint8_t* buffer, unsigned length);
 void
 dumpHeap(Thread* t, FILE* out);
 
+void
+dumpClassHistogram(Thread* t, FILE* out);
+
+void
+dumpNativeMemory(Machine* m, FILE* out);
+
 inline object
 methodClone(Thread* t, object method)
 {
@@ -38,9 +38,19 @@
 #include "dirent.h"
 #include "sched.h"
 
+#ifdef __GLIBC__
+#  include "malloc.h"
+#endif
+
 #include "arch.h"
 #include "system.h"
 
+#if (defined __linux__) && (defined USE_ATOMIC_OPERATIONS)
+#  include "linux/futex.h"
+#  include "sys/syscall.h"
+#  define AVIAN_USE_FUTEX
+#endif
+
 #define ACQUIRE(x) MutexResource MAKE_NAME(mutexResource_) (x)
 
 using namespace vm;
@@ -61,6 +71,121 @@ class MutexResource {
   pthread_mutex_t* m;
 };
 
+#ifdef AVIAN_USE_FUTEX
+
+// a thread which finds a Lock held spins for up to this many
+// iterations, fewer if spinning has not been paying off, before
+// sleeping in the kernel:
+const int MaximumSpinCount = 100;
+
+// a lock built on a futex, after Drepper's "Futexes Are Tricky".  Its
+// state is zero when unlocked, one when locked, and two when locked
+// with threads possibly sleeping on it, so that neither acquiring nor
+// releasing an uncontended lock makes a system call.
+class Lock {
+ public:
+  Lock(System*): state(0), spins(0) { }
+
+  bool tryAcquire() {
+    return atomicCompareAndSwap32(&state, 0, 1);
+  }
+
+  void acquire() {
+    if (atomicCompareAndSwap32(&state, 0, 1)) {
+      return;
+    }
+
+    // spin for about as long as it has recently taken for the lock
+    // to be released, adjusting the estimate as we go:
+    int limit = spins * 2 + 10;
+    if (limit > MaximumSpinCount) {
+      limit = MaximumSpinCount;
+    }
+
+    for (int i = 0; i < limit; ++i) {
+      pause();
+
+      if (*static_cast<volatile uint32_t*>(&state) == 0
+          and atomicCompareAndSwap32(&state, 0, 1))
+      {
+        spins += (i - spins) / 8;
+        return;
+      }
+    }
+    spins += (limit - spins) / 8;
+
+    while (exchange(2) != 0) {
+      syscall(SYS_futex, &state, FUTEX_WAIT_PRIVATE, 2, 0, 0, 0);
+    }
+  }
+
+  void release() {
+    if (exchange(0) == 2) {
+      syscall(SYS_futex, &state, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+    }
+  }
+
+  void dispose() { }
+
+ private:
+  uint32_t exchange(uint32_t value) {
+    uint32_t old;
+    do {
+      old = *static_cast<volatile uint32_t*>(&state);
+    } while (not atomicCompareAndSwap32(&state, old, value));
+    return old;
+  }
+
+  static void pause() {
+#if (defined ARCH_x86_32) || (defined ARCH_x86_64)
+    __asm__ __volatile__("pause");
+#endif
+  }
+
+  uint32_t state;
+  int spins;
+};
+
+#else // not AVIAN_USE_FUTEX
+
+class Lock {
+ public:
+  Lock(System* s): s(s) {
+    pthread_mutex_init(&mutex, 0);
+  }
+
+  bool tryAcquire() {
+    switch (pthread_mutex_trylock(&mutex)) {
+    case EBUSY:
+      return false;
+
+    case 0:
+      return true;
+
+    default:
+      sysAbort(s);
+    }
+  }
+
+  void acquire() {
+    pthread_mutex_lock(&mutex);
+  }
+
+  void release() {
+    pthread_mutex_unlock(&mutex);
+  }
+
+  void dispose() {
+    pthread_mutex_destroy(&mutex);
+  }
+
+ private:
+  System* s;
+  pthread_mutex_t mutex;
+};
+
+#endif // not AVIAN_USE_FUTEX
+
 const int InvalidSignal = -1;
 const int VisitSignal = SIGUSR1;
 const unsigned VisitSignalIndex = 0;
@@ -78,15 +203,35 @@ const int PipeSignal = SIGPIPE;
 const unsigned PipeSignalIndex = 4;
 const int DivideByZeroSignal = SIGFPE;
 const unsigned DivideByZeroSignalIndex = 5;
+const int ProfileSignal = SIGPROF;
+const unsigned ProfileSignalIndex = 6;
+const int DumpSignal = SIGQUIT;
+const unsigned DumpSignalIndex = 7;
 
 const int signals[] = { VisitSignal,
                         SegFaultSignal,
                         InterruptSignal,
                         AltSegFaultSignal,
                         PipeSignal,
-                        DivideByZeroSignal };
+                        DivideByZeroSignal,
+                        ProfileSignal,
+                        DumpSignal };
+
+const unsigned SignalCount = 8;
+
+// the segfault handlers run on a per-thread alternate stack, so they
+// still have room to build a StackOverflowError when the fault was
+// caused by the thread running off the end of its own stack
+const unsigned SignalStackSize = 64 * 1024;
 
-const unsigned SignalCount = 6;
+// a fault this close to the stack pointer is taken to be a stack
+// overflow rather than a bad memory access
+const uintptr_t StackFaultDistance = 64 * 1024;
+
+// the guard region placed below each worker's stack, which is larger
+// than the default single page so that a big frame cannot skip over
+// it into a neighboring mapping
+const unsigned StackGuardSize = 64 * 1024;
 
 class MySystem;
 MySystem* system;
@@ -95,11 +240,13 @@ void
 handleSignal(int signal, siginfo_t* info, void* context);
 
 void*
-run(void* r)
-{
-  static_cast<System::Runnable*>(r)->run();
-  return 0;
-}
+runWorker(void* w);
+
+void
+installSignalStack();
+
+void
+disposeSignalStack(void* p);
 
 void
 pathOfExecutable(System* s, const char** retBuf, unsigned* size)
@@ -129,6 +276,10 @@ const bool Verbose = false;
 
 const unsigned Notified = 1 << 0;
 
+// the most OS threads kept parked after their Java threads exit, to
+// be reused by threads started later:
+const unsigned ThreadPoolSize = 8;
+
 class MySystem: public System {
  public:
   class Thread: public System::Thread {
@@ -137,7 +288,9 @@ class MySystem: public System {
       s(s),
       r(r),
       next(0),
-      flags(0)
+      flags(0),
+      pooled(false),
+      done(false)
     {
       pthread_mutex_init(&mutex, 0);
       pthread_cond_init(&condition, 0);
@@ -148,7 +301,10 @@ class MySystem: public System {
 
       r->setInterrupted(true);
 
-      pthread_kill(thread, InterruptSignal);
+      // once done, the OS thread may be running some other thread
+      if (not done) {
+        pthread_kill(thread, InterruptSignal);
+      }
 
       // pthread_kill won't necessarily wake a thread blocked in
       // pthread_cond_{timed}wait (it does on Linux but not Mac OS),
@@ -168,8 +324,17 @@ class MySystem: public System {
     }
 
     virtual void join() {
-      int rv UNUSED = pthread_join(thread, 0);
-      expect(s, rv == 0);
+      if (pooled) {
+        // the OS thread outlives the runnable, so wait for the latter
+        ACQUIRE(mutex);
+
+        while (not done) {
+          pthread_cond_wait(&condition, &mutex);
+        }
+      } else {
+        int rv UNUSED = pthread_join(thread, 0);
+        expect(s, rv == 0);
+      }
     }
 
     virtual void dispose() {
@@ -185,36 +350,50 @@ class MySystem: public System {
     System::Runnable* r;
     Thread* next;
     unsigned flags;
+    bool pooled;
+    bool done;
   };
 
-  class Mutex: public System::Mutex {
+  // an OS thread which runs the threads passed to start and then
+  // parks in the pool for reuse
+  class Worker {
    public:
-    Mutex(System* s): s(s) {
-      pthread_mutex_init(&mutex, 0);    
+    Worker(Thread* task): task(task), next(0) {
+      pthread_cond_init(&condition, 0);
     }
 
+    pthread_t thread;
+    pthread_cond_t condition;
+    Thread* task;
+    Worker* next;
+  };
+
+  class Mutex: public System::Mutex {
+   public:
+    Mutex(System* s): s(s), lock(s) { }
+
     virtual void acquire() {
-      pthread_mutex_lock(&mutex);
+      lock.acquire();
     }
 
     virtual void release() {
-      pthread_mutex_unlock(&mutex);
+      lock.release();
     }
 
     virtual void dispose() {
-      pthread_mutex_destroy(&mutex);
+      lock.dispose();
       ::free(this);
     }
 
     System* s;
-    pthread_mutex_t mutex;
+    Lock lock;
   };
 
   class Monitor: public System::Monitor {
    public:
-    Monitor(System* s): s(s), owner_(0), first(0), last(0), depth(0) {
-      pthread_mutex_init(&mutex, 0);    
-    }
+    Monitor(System* s):
+      s(s), lock(s), owner_(0), first(0), last(0), depth(0)
+    { }
 
     virtual bool tryAcquire(System::Thread* context) {
       Thread* t = static_cast<Thread*>(context);
@@ -222,19 +401,12 @@ class MySystem: public System {
       if (owner_ == t) {
         ++ depth;
         return true;
+      } else if (lock.tryAcquire()) {
+        owner_ = t;
+        ++ depth;
+        return true;
       } else {
-        switch (pthread_mutex_trylock(&mutex)) {
-        case EBUSY:
-          return false;
-
-        case 0:
-          owner_ = t;
-          ++ depth;
-          return true;
-
-        default:
-          sysAbort(s);
-        }
+        return false;
       }
     }
 
@@ -242,7 +414,7 @@ class MySystem: public System {
       Thread* t = static_cast<Thread*>(context);
 
       if (owner_ != t) {
-        pthread_mutex_lock(&mutex);
+        lock.acquire();
         owner_ = t;
       }
       ++ depth;
@@ -254,7 +426,7 @@ class MySystem: public System {
       if (owner_ == t) {
         if (-- depth == 0) {
           owner_ = 0;
-          pthread_mutex_unlock(&mutex);
+          lock.release();
         }
       } else {
         sysAbort(s);
@@ -340,7 +512,7 @@ class MySystem: public System {
           depth = this->depth;
           this->depth = 0;
           owner_ = 0;
-          pthread_mutex_unlock(&mutex);
+          lock.release();
 
           if (not interrupted) {
             // pretend anything greater than one million years (in
@@ -366,7 +538,7 @@ class MySystem: public System {
           notified = ((t->flags & Notified) != 0);
         }
 
-        pthread_mutex_lock(&mutex);
+        lock.acquire();
 
         { ACQUIRE(t->mutex);
           t->flags = 0;
@@ -439,12 +611,12 @@ class MySystem: public System {
 
     virtual void dispose() {
       expect(s, owner_ == 0);
-      pthread_mutex_destroy(&mutex);
+      lock.dispose();
       ::free(this);
     }
 
     System* s;
-    pthread_mutex_t mutex;
+    Lock lock;
     Thread* owner_;
     Thread* first;
     Thread* last;
@@ -587,12 +759,22 @@ class MySystem: public System {
 
   MySystem():
     threadVisitor(0),
-    visitTarget(0)
+    visitTarget(0),
+    idleWorkers(0),
+    idleWorkerCount(0),
+    workerCount(0),
+    stopping(false)
   {
     expect(this, system == 0);
     system = this;
 
+    pthread_mutex_init(&poolMutex, 0);
+    pthread_cond_init(&poolCondition, 0);
+    pthread_key_create(&workerKey, 0);
+    pthread_key_create(&signalStackKey, disposeSignalStack);
+
     memset(handlers, 0, sizeof(handlers));
+    stackOverflowHandler = 0;
 
     registerHandler(&nullHandler, InterruptSignalIndex);
     registerHandler(&nullHandler, PipeSignalIndex);
@@ -609,6 +791,17 @@ class MySystem: public System {
       memset(&sa, 0, sizeof(struct sigaction));
       sigemptyset(&(sa.sa_mask));
       sa.sa_flags = SA_SIGINFO;
+      if (index == static_cast<int>(ProfileSignalIndex)
+          or index == static_cast<int>(DumpSignalIndex))
+      {
+        // these signals arrive at arbitrary points, so don't let them
+        // interrupt blocking system calls
+        sa.sa_flags |= SA_RESTART;
+      } else if (index == static_cast<int>(SegFaultSignalIndex)
+                 or index == static_cast<int>(AltSegFaultSignalIndex))
+      {
+        sa.sa_flags |= SA_ONSTACK;
+      }
       sa.sa_sigaction = handleSignal;
     
       return sigaction(signals[index], &sa, oldHandlers + index);
@@ -653,6 +846,26 @@ class MySystem: public System {
     munmap(const_cast<void*>(p), sizeInBytes);
   }
 
+  virtual void adviseHugePages(void* p UNUSED, unsigned sizeInBytes UNUSED) {
+#ifdef MADV_HUGEPAGE
+    // only the whole pages within the range may be advised:
+    uintptr_t mask = sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t start = (reinterpret_cast<uintptr_t>(p) + mask) & ~mask;
+    uintptr_t end = (reinterpret_cast<uintptr_t>(p) + sizeInBytes) & ~mask;
+    if (end > start) {
+      madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  virtual void releaseFreeMemory() {
+#ifdef __GLIBC__
+    // glibc keeps freed memory in its arenas; this unmaps or
+    // madvise(MADV_DONTNEED)s whatever whole pages it can:
+    malloc_trim(0);
+#endif
+  }
+
   virtual bool success(Status s) {
     return s == 0;
   }
@@ -660,15 +873,42 @@ class MySystem: public System {
   virtual Status attach(Runnable* r) {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
     t->thread = pthread_self();
+    installSignalStack();
     r->attach(t);
     return 0;
   }
 
   virtual Status start(Runnable* r) {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
+    t->pooled = true;
     r->attach(t);
-    int rv UNUSED = pthread_create(&(t->thread), 0, run, r);
-    expect(this, rv == 0);
+
+    ACQUIRE(poolMutex);
+
+    Worker* w = idleWorkers;
+    if (w) {
+      idleWorkers = w->next;
+      -- idleWorkerCount;
+
+      t->thread = w->thread;
+      w->task = t;
+      pthread_cond_signal(&(w->condition));
+    } else {
+      w = new (allocate(this, sizeof(Worker))) Worker(t);
+      ++ workerCount;
+
+      pthread_attr_t attributes;
+      pthread_attr_init(&attributes);
+      pthread_attr_setguardsize(&attributes, StackGuardSize);
+
+      int rv UNUSED = pthread_create
+        (&(t->thread), &attributes, runWorker, w);
+      expect(this, rv == 0);
+
+      pthread_attr_destroy(&attributes);
+      w->thread = t->thread;
+    }
+
     return 0;
   }
 
@@ -699,6 +939,49 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroSignalIndex);
   }
 
+  virtual Status handleStackOverflow(SignalHandler* handler) {
+    // overflows arrive as segfaults, so this handler is only consulted
+    // while one is registered via handleSegFault
+    if (handler) {
+      stackOverflowHandler = handler;
+      return 0;
+    } else if (stackOverflowHandler) {
+      stackOverflowHandler = 0;
+      return 0;
+    } else {
+      return 1;
+    }
+  }
+
+  virtual Status handleDumpRequest(SignalHandler* handler) {
+    return registerHandler(handler, DumpSignalIndex);
+  }
+
+  virtual Status handleProfile(SignalHandler* handler,
+                               unsigned intervalInMicroseconds)
+  {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(struct itimerval));
+
+    if (handler) {
+      Status s = registerHandler(handler, ProfileSignalIndex);
+      if (s == 0) {
+        timer.it_interval.tv_sec = intervalInMicroseconds / 1000000;
+        timer.it_interval.tv_usec = intervalInMicroseconds % 1000000;
+        timer.it_value = timer.it_interval;
+        s = setitimer(ITIMER_PROF, &timer, 0);
+      }
+      return s;
+    } else {
+      setitimer(ITIMER_PROF, &timer, 0);
+      return registerHandler(0, ProfileSignalIndex);
+    }
+  }
+
+  virtual int processId() {
+    return getpid();
+  }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -908,6 +1191,12 @@ class MySystem: public System {
       (static_cast<int64_t>(tv.tv_usec) / 1000);
   }
 
+  virtual int64_t nowMicroseconds() {
+    timeval tv = { 0, 0 };
+    gettimeofday(&tv, 0);
+    return (static_cast<int64_t>(tv.tv_sec) * 1000000) + tv.tv_usec;
+  }
+
   virtual void yield() {
     sched_yield();
   }
@@ -921,6 +1210,35 @@ class MySystem: public System {
   }
 
   virtual void dispose() {
+    // wake the parked workers and wait for them to exit
+    { ACQUIRE(poolMutex);
+
+      stopping = true;
+
+      for (Worker* w = idleWorkers; w; w = w->next) {
+        pthread_cond_signal(&(w->condition));
+      }
+      idleWorkers = 0;
+
+      // the last thread to exit may be disposing of the system from
+      // a worker, in which case runWorker returns as soon as it can
+      Worker* self = static_cast<Worker*>(pthread_getspecific(workerKey));
+      if (self) {
+        pthread_cond_destroy(&(self->condition));
+        ::free(self);
+        -- workerCount;
+      }
+
+      while (workerCount) {
+        pthread_cond_wait(&poolCondition, &poolMutex);
+      }
+    }
+
+    pthread_key_delete(workerKey);
+    pthread_key_delete(signalStackKey);
+    pthread_mutex_destroy(&poolMutex);
+    pthread_cond_destroy(&poolCondition);
+
     visitLock->dispose();
 
     registerHandler(0, InterruptSignalIndex);
@@ -937,14 +1255,137 @@ class MySystem: public System {
 
   SignalHandler* handlers[SignalCount];
   struct sigaction oldHandlers[SignalCount];
+  SignalHandler* stackOverflowHandler;
 
   ThreadVisitor* threadVisitor;
   Thread* visitTarget;
   System::Monitor* visitLock;
+  pthread_mutex_t poolMutex;
+  pthread_cond_t poolCondition;
+  Worker* idleWorkers;
+  unsigned idleWorkerCount;
+  unsigned workerCount;
+  pthread_key_t workerKey;
+  pthread_key_t signalStackKey;
+  bool stopping;
 };
 
 void
-handleSignal(int signal, siginfo_t*, void* context)
+installSignalStack()
+{
+  if (pthread_getspecific(system->signalStackKey)) {
+    return;
+  }
+
+  // leave alone any alternate stack the embedding application has
+  // already given this thread
+  stack_t old;
+  if (sigaltstack(0, &old) != 0 or (old.ss_flags & SS_DISABLE) == 0) {
+    return;
+  }
+
+  void* p = mmap(0, SignalStackSize, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (p == MAP_FAILED) {
+    return;
+  }
+
+  stack_t stack;
+  memset(&stack, 0, sizeof(stack_t));
+  stack.ss_sp = p;
+  stack.ss_size = SignalStackSize;
+
+  if (sigaltstack(&stack, 0) == 0) {
+    pthread_setspecific(system->signalStackKey, p);
+  } else {
+    munmap(p, SignalStackSize);
+  }
+}
+
+// called on thread exit for any thread installSignalStack set up
+void
+disposeSignalStack(void* p)
+{
+  stack_t stack;
+  memset(&stack, 0, sizeof(stack_t));
+  stack.ss_flags = SS_DISABLE;
+  sigaltstack(&stack, 0);
+
+  munmap(p, SignalStackSize);
+}
+
+bool
+isStackFault(void* address, void* stack)
+{
+  uintptr_t a = reinterpret_cast<uintptr_t>(address);
+  uintptr_t s = reinterpret_cast<uintptr_t>(stack);
+  return (a > s ? a - s : s - a) < StackFaultDistance;
+}
+
+void*
+runWorker(void* w)
+{
+  MySystem::Worker* worker = static_cast<MySystem::Worker*>(w);
+
+  pthread_detach(pthread_self());
+  pthread_setspecific(system->workerKey, worker);
+  installSignalStack();
+
+  while (true) {
+    MySystem::Thread* t = worker->task;
+
+    t->r->run();
+
+    if (system == 0) {
+      // this thread disposed of the system, along with t and worker
+      return 0;
+    }
+
+    // t may be disposed as soon as it is marked done, so don't touch
+    // it after that
+    { ACQUIRE(t->mutex);
+
+      t->done = true;
+      pthread_cond_broadcast(&(t->condition));
+    }
+
+    pthread_mutex_lock(&(system->poolMutex));
+
+    worker->task = 0;
+
+    if (system->stopping or system->idleWorkerCount >= ThreadPoolSize) {
+      break;
+    }
+
+    worker->next = system->idleWorkers;
+    system->idleWorkers = worker;
+    ++ system->idleWorkerCount;
+
+    while (worker->task == 0 and not system->stopping) {
+      pthread_cond_wait(&(worker->condition), &(system->poolMutex));
+    }
+
+    if (worker->task == 0) {
+      break;
+    }
+
+    pthread_mutex_unlock(&(system->poolMutex));
+  }
+
+  // the pool mutex is still held here
+
+  pthread_cond_destroy(&(worker->condition));
+  ::free(worker);
+
+  -- system->workerCount;
+  pthread_cond_signal(&(system->poolCondition));
+  pthread_mutex_unlock(&(system->poolMutex));
+
+  return 0;
+}
+
+void
+handleSignal(int signal, siginfo_t* info, void* context)
 {
   ucontext_t* c = static_cast<ucontext_t*>(context);
 
@@ -993,8 +1434,15 @@ handleSignal(int signal, siginfo_t*, void* context)
       abort();
     }
 
-    bool jump = system->handlers[index]->handleSignal
-      (&ip, &frame, &stack, &thread);
+    System::SignalHandler* handler = system->handlers[index];
+    if (index != DivideByZeroSignalIndex
+        and system->stackOverflowHandler
+        and isStackFault(info->si_addr, stack))
+    {
+      handler = system->stackOverflowHandler;
+    }
+
+    bool jump = handler->handleSignal(&ip, &frame, &stack, &thread);
 
     if (jump) {
       // I'd like to use setcontext here (and get rid of the
@@ -1019,6 +1467,18 @@ handleSignal(int signal, siginfo_t*, void* context)
     index = PipeSignalIndex;
   } break;
 
+  case ProfileSignal: {
+    index = ProfileSignalIndex;
+
+    system->handlers[index]->handleSignal(&ip, &frame, &stack, &thread);
+  } break;
+
+  case DumpSignal: {
+    index = DumpSignalIndex;
+
+    system->handlers[index]->handleSignal(&ip, &frame, &stack, &thread);
+  } break;
+
   default: abort();
   }
 
@@ -1026,6 +1486,8 @@ handleSignal(int signal, siginfo_t*, void* context)
   case VisitSignal:
   case InterruptSignal:
   case PipeSignal:
+  case ProfileSignal:
+  case DumpSignal:
     break;
 
   default:
@@ -9,6 +9,7 @@
    details. */
 
 #include "assembler.h"
+#include "last-move.h"
 #include "vector.h"
 
 #define CAST1(x) reinterpret_cast<UnaryOperationType>(x)
@@ -235,7 +236,7 @@ class Context {
     s(s), zone(zone), client(0), code(s, a, 1024), tasks(0), result(0),
     firstBlock(new(zone) MyBlock(this, 0)),
     lastBlock(firstBlock), jumpOffsetHead(0), jumpOffsetTail(0),
-    constantPool(0), constantPoolCount(0)
+    constantPool(0), constantPoolCount(0), rewrites(0)
   { }
 
   System* s;
@@ -250,6 +251,8 @@ class Context {
   JumpOffset* jumpOffsetTail;
   ConstantPoolEntry* constantPool;
   unsigned constantPoolCount;
+  LastMove lastMove;
+  unsigned rewrites;
 };
 
 class Task {
@@ -2322,6 +2325,12 @@ class MyArchitecture: public Assembler::Architecture {
     case Float2Float:
     case Float2Int:
     case Int2Float:
+    case PopulationCount:
+    case CountLeadingZeros:
+    case CountTrailingZeros:
+    case FloatFloor:
+    case FloatCeiling:
+    case FloatRound:
       *thunk = true;
       break;
 
@@ -2460,6 +2469,52 @@ class MyArchitecture: public Assembler::Architecture {
   unsigned referenceCount;
 };
 
+void
+forgetMove(Context* c)
+{
+  c->lastMove.forget();
+}
+
+void
+rememberMove(Context* c, unsigned aSize, OperandType aType,
+             Assembler::Operand* a, unsigned bSize, OperandType bType,
+             Assembler::Operand* b)
+{
+  c->lastMove.remember(c->code.length(), aSize, aType, a, bSize, bType, b);
+}
+
+// Returns true if the specified move need not be emitted as given,
+// either because it only repeats or undoes the move emitted just
+// before it, or because it reloads a register which that move just
+// stored, in which case it is replaced by a register-to-register move.
+bool
+rewriteMove(Context* c, unsigned aSize, OperandType aType,
+            Assembler::Operand* a, unsigned bSize, OperandType bType,
+            Assembler::Operand* b)
+{
+  LastMove* m = &(c->lastMove);
+  switch (m->match(c->code.length(), aSize, aType, a, bSize, bType, b)) {
+  case LastMove::Redundant:
+    ++ c->rewrites;
+    return true;
+
+  case LastMove::Reload: {
+    Assembler::Register* to = static_cast<Assembler::Register*>(b);
+    Assembler::Register from(m->a);
+    moveRR(c, aSize, &from, bSize, to);
+    rememberMove(c, aSize, RegisterOperand, &from, bSize,
+                 RegisterOperand, to);
+    ++ c->rewrites;
+    return true;
+  }
+
+  default:
+    break;
+  }
+
+  return false;
+}
+
 class MyAssembler: public Assembler {
  public:
   MyAssembler(System* s, Allocator* a, Zone* zone, MyArchitecture* arch):
@@ -2678,12 +2733,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual void apply(Operation op) {
+    forgetMove(&c);
+
     arch_->c.operations[op](&c);
   }
 
   virtual void apply(UnaryOperation op,
                      unsigned aSize, OperandType aType, Operand* aOperand)
   {
+    forgetMove(&c);
+
     arch_->c.unaryOperations[index(&(arch_->c), op, aType)]
       (&c, aSize, aOperand);
   }
@@ -2692,8 +2751,21 @@ class MyAssembler: public Assembler {
                      unsigned aSize, OperandType aType, Operand* aOperand,
                      unsigned bSize, OperandType bType, Operand* bOperand)
   {
-    arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
-      (&c, aSize, aOperand, bSize, bOperand);
+    if (op == Move) {
+      if (not rewriteMove
+          (&c, aSize, aType, aOperand, bSize, bType, bOperand))
+      {
+        arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
+          (&c, aSize, aOperand, bSize, bOperand);
+
+        rememberMove(&c, aSize, aType, aOperand, bSize, bType, bOperand);
+      }
+    } else {
+      forgetMove(&c);
+
+      arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
+        (&c, aSize, aOperand, bSize, bOperand);
+    }
   }
 
   virtual void apply(TernaryOperation op,
@@ -2703,6 +2775,8 @@ class MyAssembler: public Assembler {
                      unsigned cSize UNUSED, OperandType cType UNUSED,
                      Operand* cOperand)
   {
+    forgetMove(&c);
+
     if (isBranch(op)) {
       assert(&c, aSize == bSize);
       assert(&c, cSize == TargetBytesPerWord);
@@ -2794,10 +2868,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual Promise* offset(bool) {
+    // the next instruction may be a branch target, so it must not
+    // depend on the one before it:
+    forgetMove(&c);
+
     return ::offset(&c);
   }
 
   virtual Block* endBlock(bool startNew) {
+    forgetMove(&c);
+
     MyBlock* b = c.lastBlock;
     b->size = c.code.length() - b->offset;
     if (startNew) {
@@ -2850,6 +2930,10 @@ class MyAssembler: public Assembler {
     return c.constantPoolCount * TargetBytesPerWord;
   }
 
+  virtual unsigned rewriteCount() {
+    return c.rewrites;
+  }
+
   virtual void dispose() {
     c.code.dispose();
   }
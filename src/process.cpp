@@ -14,6 +14,308 @@ using namespace vm;
 
 namespace {
 
+const bool CacheNativeSymbols = true;
+
+} // namespace
+
+namespace vm {
+
+// Remembers, for each pair of short and long JNI names looked up, the
+// function found for it or, failing that, the last library searched,
+// so that later lookups of a missing name only search libraries
+// loaded since.  With the avian.natives.eager property set, the names
+// of the native methods of each class are also looked up on a
+// background thread as soon as the class is initialized, so that
+// the first call to each method does not pay for the search.
+class NativeSymbols: public System::Runnable {
+ public:
+  class Entry {
+   public:
+    Entry* next;
+    System::Library* searched;
+    void* function;
+    uint32_t hash;
+    unsigned length;
+    char key[0];
+  };
+
+  class Request {
+   public:
+    Request* next;
+    unsigned length;
+    char key[0];
+  };
+
+  NativeSymbols(Machine* m, System::Monitor* lock, bool eager):
+    m(m),
+    s(m->system),
+    lock(lock),
+    thread(0),
+    buckets(0),
+    capacity(0),
+    count(0),
+    requests(0),
+    lastRequest(0),
+    eager(eager),
+    stopped(false)
+  { }
+
+  virtual void attach(System::Thread* st) {
+    thread = st;
+  }
+
+  virtual void run() {
+    lock->acquire(thread);
+
+    while (true) {
+      while (requests == 0 and not stopped) {
+        lock->wait(thread, 0);
+      }
+
+      if (stopped) {
+        break;
+      }
+
+      Request* r = requests;
+      requests = r->next;
+      if (requests == 0) {
+        lastRequest = 0;
+      }
+
+      lock->release(thread);
+
+      resolve(thread, r->key, r->key + strlen(r->key) + 1);
+
+      s->free(r);
+
+      lock->acquire(thread);
+    }
+
+    lock->release(thread);
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) { }
+
+  Entry* find(const char* undecorated, unsigned undecoratedLength,
+              const char* decorated, uint32_t hash)
+  {
+    if (capacity) {
+      for (Entry* e = buckets[hash & (capacity - 1)]; e; e = e->next) {
+        if (e->hash == hash
+            and memcmp(e->key, undecorated, undecoratedLength + 1) == 0
+            and ::strcmp(e->key + undecoratedLength + 1, decorated) == 0)
+        {
+          return e;
+        }
+      }
+    }
+    return 0;
+  }
+
+  Entry* insert(const char* undecorated, unsigned undecoratedLength,
+                const char* decorated, uint32_t hash)
+  {
+    if (count >= capacity) {
+      unsigned newCapacity = capacity ? capacity * 2 : 256;
+      Entry** newBuckets = static_cast<Entry**>
+        (s->tryAllocate(newCapacity * sizeof(Entry*)));
+      if (newBuckets == 0) {
+        return 0;
+      }
+
+      memset(newBuckets, 0, newCapacity * sizeof(Entry*));
+
+      for (unsigned i = 0; i < capacity; ++i) {
+        for (Entry* e = buckets[i]; e;) {
+          Entry* next = e->next;
+          unsigned index = e->hash & (newCapacity - 1);
+          e->next = newBuckets[index];
+          newBuckets[index] = e;
+          e = next;
+        }
+      }
+
+      if (buckets) {
+        s->free(buckets);
+      }
+
+      buckets = newBuckets;
+      capacity = newCapacity;
+    }
+
+    unsigned length = undecoratedLength + 1 + strlen(decorated) + 1;
+    Entry* e = static_cast<Entry*>(s->tryAllocate(sizeof(Entry) + length));
+    if (e == 0) {
+      return 0;
+    }
+
+    e->searched = 0;
+    e->function = 0;
+    e->hash = hash;
+    e->length = length;
+    memcpy(e->key, undecorated, undecoratedLength + 1);
+    memcpy(e->key + undecoratedLength + 1, decorated,
+           length - undecoratedLength - 1);
+
+    unsigned index = hash & (capacity - 1);
+    e->next = buckets[index];
+    buckets[index] = e;
+    ++ count;
+
+    return e;
+  }
+
+  void* resolve(System::Thread* context, const char* undecorated,
+                const char* decorated)
+  {
+    unsigned undecoratedLength = strlen(undecorated);
+    uint32_t hash = (::hash(undecorated) * 31) ^ ::hash(decorated);
+
+    System::Library* start;
+    lock->acquire(context);
+    { Entry* e = find(undecorated, undecoratedLength, decorated, hash);
+      if (e and e->function) {
+        void* function = e->function;
+        lock->release(context);
+        return function;
+      }
+
+      start = (e and e->searched) ? e->searched->next() : m->libraries;
+    }
+    lock->release(context);
+
+    if (start == 0) {
+      // every library was searched the last time the name missed
+      return 0;
+    }
+
+    // search outside the lock, since dlsym and friends can be slow
+    System::Library* last = 0;
+    void* function = 0;
+    for (System::Library* lib = start; lib; lib = lib->next()) {
+      last = lib;
+      function = lib->resolve(undecorated);
+      if (function == 0) {
+        function = lib->resolve(decorated);
+      }
+      if (function) {
+        break;
+      }
+    }
+
+    lock->acquire(context);
+    { Entry* e = find(undecorated, undecoratedLength, decorated, hash);
+      if (e == 0) {
+        e = insert(undecorated, undecoratedLength, decorated, hash);
+      }
+
+      if (e) {
+        if (e->function) {
+          // another thread found it first
+          function = e->function;
+        } else if (function) {
+          e->function = function;
+        } else {
+          e->searched = last;
+        }
+      }
+    }
+    lock->release(context);
+
+    return function;
+  }
+
+  void request(System::Thread* context, const char* undecorated,
+               const char* decorated)
+  {
+    unsigned undecoratedLength = strlen(undecorated);
+    unsigned length = undecoratedLength + 1 + strlen(decorated) + 1;
+    Request* r = static_cast<Request*>
+      (s->tryAllocate(sizeof(Request) + length));
+    if (r == 0) {
+      return;
+    }
+
+    r->next = 0;
+    r->length = length;
+    memcpy(r->key, undecorated, undecoratedLength + 1);
+    memcpy(r->key + undecoratedLength + 1, decorated,
+           length - undecoratedLength - 1);
+
+    lock->acquire(context);
+
+    if (thread == 0 and not s->success(s->start(this))) {
+      // no background thread, so just leave it to the first call
+      eager = false;
+      lock->release(context);
+      s->free(r);
+      return;
+    }
+
+    if (lastRequest) {
+      lastRequest->next = r;
+    } else {
+      requests = r;
+    }
+    lastRequest = r;
+
+    lock->notify(context);
+    lock->release(context);
+  }
+
+  void dispose(System::Thread* context) {
+    if (thread) {
+      lock->acquire(context);
+      stopped = true;
+      lock->notifyAll(context);
+      lock->release(context);
+
+      thread->join();
+      thread->dispose();
+    }
+
+    for (Request* r = requests; r;) {
+      Request* next = r->next;
+      s->free(r);
+      r = next;
+    }
+
+    for (unsigned i = 0; i < capacity; ++i) {
+      for (Entry* e = buckets[i]; e;) {
+        Entry* next = e->next;
+        s->free(e);
+        e = next;
+      }
+    }
+
+    if (buckets) {
+      s->free(buckets);
+    }
+
+    lock->dispose();
+  }
+
+  Machine* m;
+  System* s;
+  System::Monitor* lock;
+  System::Thread* thread;
+  Entry** buckets;
+  unsigned capacity;
+  unsigned count;
+  Request* requests;
+  Request* lastRequest;
+  bool eager;
+  bool stopped;
+};
+
+} // namespace vm
+
+namespace {
+
 unsigned
 mangledSize(int8_t c)
 {
@@ -132,6 +434,11 @@ makeJNIName(Thread* t, const char* prefix, unsigned prefixLength, char* name,
 void*
 resolveNativeMethod(Thread* t, const char* undecorated, const char* decorated)
 {
+  if (t->m->nativeSymbols) {
+    return t->m->nativeSymbols->resolve
+      (t->systemThread, undecorated, decorated);
+  }
+
   for (System::Library* lib = t->m->libraries; lib; lib = lib->next()) {
     void* p = lib->resolve(undecorated);
     if (p) {
@@ -203,22 +510,74 @@ resolveNativeMethod(Thread* t, object method, const char* prefix,
   return 0;
 }
 
+bool
+criticalCandidate(Thread* t, object method)
+{
+  if ((methodFlags(t, method) & (ACC_STATIC | ACC_SYNCHRONIZED))
+      != ACC_STATIC)
+  {
+    return false;
+  }
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+  while (it.hasNext()) {
+    if (fieldType(t, fieldCode(t, *it.next())) == POINTER_TYPE) {
+      return false;
+    }
+  }
+
+  return methodReturnCode(t, method) != ObjectField;
+}
+
+void*
+resolveCriticalNativeMethod(Thread* t, object method)
+{
+  if (criticalCandidate(t, method)) {
+    return resolveNativeMethod
+      (t, method, "JavaCritical_", 13, methodParameterFootprint(t, method));
+  } else {
+    return 0;
+  }
+}
+
 object
 resolveNativeMethod(Thread* t, object method)
 {
   void* p = resolveNativeMethod(t, method, "Avian_", 6, 3);
   if (p) {
-    return makeNative(t, p, true);
+    return makeNative(t, p, true, false);
+  }
+
+  p = resolveCriticalNativeMethod(t, method);
+  if (p) {
+    return makeNative(t, p, false, true);
   }
 
   p = resolveNativeMethod(t, method, "Java_", 5, -1);
   if (p) {
-    return makeNative(t, p, false);
+    return makeNative(t, p, false, false);
   }
 
   return 0;
 }
 
+void
+setNative(Thread* t, object method, object native)
+{
+  PROTECT(t, native);
+
+  object runtimeData = getMethodRuntimeData(t, method);
+
+  // ensure other threads only see the methodRuntimeDataNative field
+  // populated once the object it points to has been populated:
+  storeStoreMemoryBarrier();
+
+  set(t, runtimeData, MethodRuntimeDataNative, native);
+}
+
 } // namespace
 
 namespace vm {
@@ -241,16 +600,109 @@ resolveNative(Thread* t, object method)
                &byteArrayBody(t, methodSpec(t, method), 0));
     }
 
-    PROTECT(t, native);
+    setNative(t, method, native);
+  } 
+}
+
+NativeSymbols*
+makeNativeSymbols(Machine* m)
+{
+  if (not CacheNativeSymbols) {
+    return 0;
+  }
+
+  System::Monitor* lock;
+  if (not m->system->success(m->system->make(&lock))) {
+    return 0;
+  }
+
+  const char* eager = findProperty(m, "avian.natives.eager");
+
+  return new (m->heap->allocate(sizeof(NativeSymbols)))
+    NativeSymbols(m, lock, eager and ::strcmp(eager, "true") == 0);
+}
+
+void
+disposeNativeSymbols(Thread* t)
+{
+  NativeSymbols* symbols = t->m->nativeSymbols;
+  if (symbols) {
+    t->m->nativeSymbols = 0;
+    symbols->dispose(t->systemThread);
+    t->m->heap->free(symbols, sizeof(NativeSymbols));
+  }
+}
+
+void
+bindNatives(Thread* t, object class_)
+{
+  NativeSymbols* symbols = t->m->nativeSymbols;
+  object table = classMethodTable(t, class_);
+  if (symbols == 0 or (not symbols->eager) or table == 0) {
+    return;
+  }
+
+  for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+    object method = arrayBody(t, table, i);
+    if ((methodFlags(t, method) & ACC_NATIVE) == 0
+        or (methodRuntimeDataIndex(t, method)
+            and methodRuntimeDataNative
+            (t, getMethodRuntimeData(t, method))))
+    {
+      continue;
+    }
+
+    // look the names up in the order resolveNativeMethod tries them
+    const char* prefixes[] = { "Avian_", "JavaCritical_", "Java_" };
+    for (unsigned j = 0; j < 3; ++j) {
+      if (j == 1 and not criticalCandidate(t, method)) {
+        continue;
+      }
 
-    object runtimeData = getMethodRuntimeData(t, method);
+      unsigned prefixLength = strlen(prefixes[j]);
 
-    // ensure other threads only see the methodRuntimeDataNative field
-    // populated once the object it points to has been populated:
-    storeStoreMemoryBarrier();
+      THREAD_RUNTIME_ARRAY
+        (t, char, undecorated,
+         prefixLength + jniNameLength(t, method, false) + 1);
+      makeJNIName(t, prefixes[j], prefixLength,
+                  RUNTIME_ARRAY_BODY(undecorated), method, false);
 
-    set(t, runtimeData, MethodRuntimeDataNative, native);
-  } 
+      THREAD_RUNTIME_ARRAY
+        (t, char, decorated,
+         prefixLength + jniNameLength(t, method, true) + 1);
+      makeJNIName(t, prefixes[j], prefixLength,
+                  RUNTIME_ARRAY_BODY(decorated), method, true);
+
+      symbols->request(t->systemThread, RUNTIME_ARRAY_BODY(undecorated),
+                       RUNTIME_ARRAY_BODY(decorated));
+    }
+  }
+}
+
+void*
+criticalNative(Thread* t, object method)
+{
+  PROTECT(t, method);
+
+  assert(t, methodFlags(t, method) & ACC_NATIVE);
+
+  object native = methodRuntimeDataNative(t, getMethodRuntimeData(t, method));
+  if (native) {
+    return nativeCritical(t, native) ? nativeFunction(t, native) : 0;
+  }
+
+  // only bind the native early if the class is already initialized,
+  // since its static initializer may be what loads the library
+  if (classNeedsInit(t, methodClass(t, method))) {
+    return 0;
+  }
+
+  void* p = resolveCriticalNativeMethod(t, method);
+  if (p) {
+    setNative(t, method, makeNative(t, p, false, true));
+  }
+
+  return p;
 }
 
 int
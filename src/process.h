@@ -59,6 +59,16 @@ isSpecialMethod(Thread* t, object method, object class_)
 void
 resolveNative(Thread* t, object method);
 
+// Returns the function implementing the specified native method if it
+// is a critical native -- a static method with only primitive
+// parameters and result, exported as JavaCritical_<name>, which takes
+// neither a JNIEnv nor a class, never touches the heap and may be
+// called without leaving the active state.  Otherwise, or if the
+// method cannot be bound yet without initializing its class, returns
+// null.  Unlike resolveNative, never throws UnsatisfiedLinkError.
+void*
+criticalNative(Thread* t, object method);
+
 int
 findLineNumber(Thread* t, object method, unsigned ip);
 
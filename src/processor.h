@@ -88,6 +88,11 @@ class Processor {
   virtual void
   initVtable(Thread* t, object c) = 0;
 
+  // called with the class lock held when a class overriding method is
+  // loaded, just after OverriddenFlag is first set on method
+  virtual void
+  methodOverridden(Thread* t, object method) = 0;
+
   virtual void
   visitObjects(Thread* t, Heap::Visitor* v) = 0;
 
@@ -131,6 +136,10 @@ class Processor {
   virtual void
   dispose() = 0;
 
+  // called when the VM begins shutting down, while t is still usable
+  virtual void
+  shutDown(Thread* t) = 0;
+
   virtual object
   getStackTrace(Thread* t, Thread* target) = 0;
 
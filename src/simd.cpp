@@ -0,0 +1,527 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "simd.h"
+
+#if (defined __SSE2__) || (defined _M_X64) \
+  || ((defined _M_IX86_FP) && (_M_IX86_FP >= 2))
+#  define AVIAN_USE_SSE2
+#  include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for any x86 target using function attributes
+// and only used if the processor turns out to support it
+#if (defined __GNUC__) && ((defined __x86_64__) || (defined __i386__)) \
+  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#  define AVIAN_USE_AVX2
+#  define AVX2 __attribute__((target("avx2")))
+#  include <immintrin.h>
+#endif
+
+#if (defined __ARM_NEON__) || (defined __ARM_NEON)
+#  define AVIAN_USE_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace vm;
+
+namespace {
+
+// powers of the Arrays.hashCode multiplier, modulo 2^32
+const uint32_t P1 = 31;
+const uint32_t P4 = P1 * P1 * P1 * P1;
+const uint32_t P8 = P4 * P4;
+const uint32_t P16 = P8 * P8;
+
+// The vectorized hashes keep one partial hash per lane, each lane
+// seeing every nth element of the array.  Every step multiplies the
+// partial hashes by 31^n and adds the next n elements, so once the
+// vectors are used up the lanes are combined by weighting each with
+// the power of 31 its last element would have had.
+uint32_t
+combine(uint32_t hash, uint32_t scale, const uint32_t* lanes,
+        unsigned laneCount)
+{
+  uint32_t sum = 0;
+  for (unsigned i = 0; i < laneCount; ++i) {
+    sum = (sum * P1) + lanes[i];
+  }
+  return (hash * scale) + sum;
+}
+
+void
+fill8(uint8_t* dst, uint8_t value, unsigned count)
+{
+  memset(dst, value, count);
+}
+
+template <class T>
+void
+genericFill(T* dst, T value, unsigned count)
+{
+  for (unsigned i = 0; i < count; ++i) {
+    dst[i] = value;
+  }
+}
+
+bool
+equal(const void* a, const void* b, unsigned sizeInBytes)
+{
+  return memcmp(a, b, sizeInBytes) == 0;
+}
+
+template <class T>
+int32_t
+genericHash(int32_t hash, const T* src, unsigned count)
+{
+  uint32_t h = hash;
+  for (unsigned i = 0; i < count; ++i) {
+    h = (h * P1) + static_cast<uint32_t>(static_cast<int32_t>(src[i]));
+  }
+  return h;
+}
+
+int
+indexOf8(const uint8_t* src, uint8_t value, unsigned count)
+{
+  const void* p = memchr(src, value, count);
+  return p ? static_cast<const uint8_t*>(p) - src : -1;
+}
+
+template <class T>
+int
+genericIndexOf(const T* src, T value, unsigned count)
+{
+  for (unsigned i = 0; i < count; ++i) {
+    if (src[i] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const Simd generic = {
+  "generic",
+  fill8,
+  genericFill<uint16_t>,
+  genericFill<uint32_t>,
+  equal,
+  genericHash<int8_t>,
+  genericHash<uint16_t>,
+  genericHash<int32_t>,
+  indexOf8,
+  genericIndexOf<uint16_t>
+};
+
+#ifdef AVIAN_USE_SSE2
+
+inline __m128i
+sse2Load(const void* src)
+{
+  return _mm_loadu_si128(static_cast<const __m128i*>(src));
+}
+
+// SSE2 has no 32-bit multiply which keeps the low halves, so this
+// multiplies the even and odd lanes separately
+inline __m128i
+sse2Multiply(__m128i a, __m128i b)
+{
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline __m128i
+sse2Step(__m128i hashes, __m128i elements)
+{
+  return _mm_add_epi32
+    (sse2Multiply(hashes, _mm_set1_epi32(P4)), elements);
+}
+
+inline uint32_t
+sse2Combine(uint32_t hash, uint32_t scale, __m128i hashes)
+{
+  uint32_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), hashes);
+  return combine(hash, scale, lanes, 4);
+}
+
+void
+sse2Fill16(uint16_t* dst, uint16_t value, unsigned count)
+{
+  __m128i v = _mm_set1_epi16(value);
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+void
+sse2Fill32(uint32_t* dst, uint32_t value, unsigned count)
+{
+  __m128i v = _mm_set1_epi32(value);
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+int32_t
+sse2Hash8(int32_t hash, const int8_t* src, unsigned count)
+{
+  __m128i hashes = _mm_setzero_si128();
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 16 <= count; i += 16) {
+    // sign extend by unpacking each byte into the high half of a
+    // wider lane and shifting it back down
+    __m128i v = sse2Load(src + i);
+    __m128i low = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+    __m128i high = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+
+    hashes = sse2Step
+      (hashes, _mm_srai_epi32(_mm_unpacklo_epi16(low, low), 16));
+    hashes = sse2Step
+      (hashes, _mm_srai_epi32(_mm_unpackhi_epi16(low, low), 16));
+    hashes = sse2Step
+      (hashes, _mm_srai_epi32(_mm_unpacklo_epi16(high, high), 16));
+    hashes = sse2Step
+      (hashes, _mm_srai_epi32(_mm_unpackhi_epi16(high, high), 16));
+
+    scale *= P16;
+  }
+  return genericHash(sse2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+int32_t
+sse2Hash16(int32_t hash, const uint16_t* src, unsigned count)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i hashes = zero;
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = sse2Load(src + i);
+    hashes = sse2Step(hashes, _mm_unpacklo_epi16(v, zero));
+    hashes = sse2Step(hashes, _mm_unpackhi_epi16(v, zero));
+    scale *= P8;
+  }
+  return genericHash(sse2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+int32_t
+sse2Hash32(int32_t hash, const int32_t* src, unsigned count)
+{
+  __m128i hashes = _mm_setzero_si128();
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    hashes = sse2Step(hashes, sse2Load(src + i));
+    scale *= P4;
+  }
+  return genericHash(sse2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+int
+sse2IndexOf16(const uint16_t* src, uint16_t value, unsigned count)
+{
+  __m128i v = _mm_set1_epi16(value);
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi16(sse2Load(src + i), v));
+    if (mask) {
+      return i + (lowestBit(mask) / 2);
+    }
+  }
+  int r = genericIndexOf(src + i, value, count - i);
+  return r < 0 ? r : i + r;
+}
+
+const Simd sse2 = {
+  "sse2",
+  fill8,
+  sse2Fill16,
+  sse2Fill32,
+  equal,
+  sse2Hash8,
+  sse2Hash16,
+  sse2Hash32,
+  indexOf8,
+  sse2IndexOf16
+};
+
+#endif // AVIAN_USE_SSE2
+
+#ifdef AVIAN_USE_AVX2
+
+AVX2 inline __m256i
+avx2Step(__m256i hashes, __m256i elements)
+{
+  return _mm256_add_epi32
+    (_mm256_mullo_epi32(hashes, _mm256_set1_epi32(P8)), elements);
+}
+
+AVX2 inline uint32_t
+avx2Combine(uint32_t hash, uint32_t scale, __m256i hashes)
+{
+  uint32_t lanes[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), hashes);
+  return combine(hash, scale, lanes, 8);
+}
+
+AVX2 void
+avx2Fill16(uint16_t* dst, uint16_t value, unsigned count)
+{
+  __m256i v = _mm256_set1_epi16(value);
+  unsigned i = 0;
+  for (; i + 16 <= count; i += 16) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+AVX2 void
+avx2Fill32(uint32_t* dst, uint32_t value, unsigned count)
+{
+  __m256i v = _mm256_set1_epi32(value);
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+AVX2 int32_t
+avx2Hash8(int32_t hash, const int8_t* src, unsigned count)
+{
+  __m256i hashes = _mm256_setzero_si256();
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    hashes = avx2Step
+      (hashes, _mm256_cvtepi8_epi32
+       (_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))));
+    scale *= P8;
+  }
+  return genericHash(avx2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+AVX2 int32_t
+avx2Hash16(int32_t hash, const uint16_t* src, unsigned count)
+{
+  __m256i hashes = _mm256_setzero_si256();
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    hashes = avx2Step
+      (hashes, _mm256_cvtepu16_epi32
+       (_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    scale *= P8;
+  }
+  return genericHash(avx2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+AVX2 int32_t
+avx2Hash32(int32_t hash, const int32_t* src, unsigned count)
+{
+  __m256i hashes = _mm256_setzero_si256();
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    hashes = avx2Step
+      (hashes, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+    scale *= P8;
+  }
+  return genericHash(avx2Combine(hash, scale, hashes), src + i, count - i);
+}
+
+AVX2 int
+avx2IndexOf16(const uint16_t* src, uint16_t value, unsigned count)
+{
+  __m256i v = _mm256_set1_epi16(value);
+  unsigned i = 0;
+  for (; i + 16 <= count; i += 16) {
+    unsigned mask = _mm256_movemask_epi8
+      (_mm256_cmpeq_epi16
+       (_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), v));
+    if (mask) {
+      return i + (lowestBit(mask) / 2);
+    }
+  }
+  int r = genericIndexOf(src + i, value, count - i);
+  return r < 0 ? r : i + r;
+}
+
+const Simd avx2 = {
+  "avx2",
+  fill8,
+  avx2Fill16,
+  avx2Fill32,
+  equal,
+  avx2Hash8,
+  avx2Hash16,
+  avx2Hash32,
+  indexOf8,
+  avx2IndexOf16
+};
+
+#endif // AVIAN_USE_AVX2
+
+#ifdef AVIAN_USE_NEON
+
+inline uint32x4_t
+neonStep(uint32x4_t hashes, uint32x4_t elements)
+{
+  return vmlaq_u32(elements, hashes, vdupq_n_u32(P4));
+}
+
+inline uint32_t
+neonCombine(uint32_t hash, uint32_t scale, uint32x4_t hashes)
+{
+  uint32_t lanes[4];
+  vst1q_u32(lanes, hashes);
+  return combine(hash, scale, lanes, 4);
+}
+
+void
+neonFill16(uint16_t* dst, uint16_t value, unsigned count)
+{
+  uint16x8_t v = vdupq_n_u16(value);
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    vst1q_u16(dst + i, v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+void
+neonFill32(uint32_t* dst, uint32_t value, unsigned count)
+{
+  uint32x4_t v = vdupq_n_u32(value);
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_u32(dst + i, v);
+  }
+  genericFill(dst + i, value, count - i);
+}
+
+int32_t
+neonHash8(int32_t hash, const int8_t* src, unsigned count)
+{
+  uint32x4_t hashes = vdupq_n_u32(0);
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t v = vmovl_s8(vld1_s8(src + i));
+    hashes = neonStep
+      (hashes, vreinterpretq_u32_s32(vmovl_s16(vget_low_s16(v))));
+    hashes = neonStep
+      (hashes, vreinterpretq_u32_s32(vmovl_s16(vget_high_s16(v))));
+    scale *= P8;
+  }
+  return genericHash(neonCombine(hash, scale, hashes), src + i, count - i);
+}
+
+int32_t
+neonHash16(int32_t hash, const uint16_t* src, unsigned count)
+{
+  uint32x4_t hashes = vdupq_n_u32(0);
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t v = vld1q_u16(src + i);
+    hashes = neonStep(hashes, vmovl_u16(vget_low_u16(v)));
+    hashes = neonStep(hashes, vmovl_u16(vget_high_u16(v)));
+    scale *= P8;
+  }
+  return genericHash(neonCombine(hash, scale, hashes), src + i, count - i);
+}
+
+int32_t
+neonHash32(int32_t hash, const int32_t* src, unsigned count)
+{
+  uint32x4_t hashes = vdupq_n_u32(0);
+  uint32_t scale = 1;
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    hashes = neonStep
+      (hashes, vreinterpretq_u32_s32(vld1q_s32(src + i)));
+    scale *= P4;
+  }
+  return genericHash(neonCombine(hash, scale, hashes), src + i, count - i);
+}
+
+int
+neonIndexOf16(const uint16_t* src, uint16_t value, unsigned count)
+{
+  uint16x8_t v = vdupq_n_u16(value);
+  unsigned i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // NEON has no movemask, so narrow the comparison to one byte per
+    // element and look at it as two words
+    uint32x2_t mask = vreinterpret_u32_u8
+      (vmovn_u16(vceqq_u16(vld1q_u16(src + i), v)));
+
+    uint32_t low = vget_lane_u32(mask, 0);
+    if (low) {
+      return i + (lowestBit(low) / 8);
+    }
+
+    uint32_t high = vget_lane_u32(mask, 1);
+    if (high) {
+      return i + 4 + (lowestBit(high) / 8);
+    }
+  }
+  int r = genericIndexOf(src + i, value, count - i);
+  return r < 0 ? r : i + r;
+}
+
+const Simd neon = {
+  "neon",
+  fill8,
+  neonFill16,
+  neonFill32,
+  equal,
+  neonHash8,
+  neonHash16,
+  neonHash32,
+  indexOf8,
+  neonIndexOf16
+};
+
+#endif // AVIAN_USE_NEON
+
+} // namespace
+
+namespace vm {
+
+const Simd*
+findSimd()
+{
+#ifdef AVIAN_USE_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return &avx2;
+  }
+#endif
+
+#if (defined AVIAN_USE_SSE2)
+  return &sse2;
+#elif (defined AVIAN_USE_NEON)
+  return &neon;
+#else
+  return &generic;
+#endif
+}
+
+} // namespace vm
@@ -0,0 +1,51 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "common.h"
+
+namespace vm {
+
+// Bulk operations on the bodies of primitive arrays, used by the
+// natives behind Arrays.fill, Arrays.equals, Arrays.hashCode,
+// String.equals and String.indexOf.  Each processor family gets its
+// own table of implementations, and findSimd picks the best one the
+// running processor supports.
+class Simd {
+ public:
+  const char* name;
+
+  void (*fill8)(uint8_t* dst, uint8_t value, unsigned count);
+  void (*fill16)(uint16_t* dst, uint16_t value, unsigned count);
+  void (*fill32)(uint32_t* dst, uint32_t value, unsigned count);
+
+  bool (*equal)(const void* a, const void* b, unsigned sizeInBytes);
+
+  // these continue the Arrays.hashCode computation from hash, so
+  // hashing an array from the start means passing one, and byte
+  // elements are treated as signed
+  int32_t (*hash8)(int32_t hash, const int8_t* src, unsigned count);
+  int32_t (*hash16)(int32_t hash, const uint16_t* src, unsigned count);
+  int32_t (*hash32)(int32_t hash, const int32_t* src, unsigned count);
+
+  // these return the index of the first element equal to value, or
+  // -1 if there is none
+  int (*indexOf8)(const uint8_t* src, uint8_t value, unsigned count);
+  int (*indexOf16)(const uint16_t* src, uint16_t value, unsigned count);
+};
+
+const Simd*
+findSimd();
+
+} // namespace vm
+
+#endif//SIMD_H
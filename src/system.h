@@ -123,6 +123,8 @@ class System {
   virtual void free(const void* p) = 0;
   virtual void* tryAllocateExecutable(unsigned sizeInBytes) = 0;
   virtual void freeExecutable(const void* p, unsigned sizeInBytes) = 0;
+  virtual void adviseHugePages(void* p, unsigned sizeInBytes) = 0;
+  virtual void releaseFreeMemory() = 0;
   virtual Status attach(Runnable*) = 0;
   virtual Status start(Runnable*) = 0;
   virtual Status make(Mutex**) = 0;
@@ -130,6 +132,10 @@ class System {
   virtual Status make(Local**) = 0;
   virtual Status handleSegFault(SignalHandler* handler) = 0;
   virtual Status handleDivideByZero(SignalHandler* handler) = 0;
+  virtual Status handleStackOverflow(SignalHandler* handler) = 0;
+  virtual Status handleDumpRequest(SignalHandler* handler) = 0;
+  virtual Status handleProfile(SignalHandler* handler,
+                               unsigned intervalInMicroseconds) = 0;
   virtual Status visit(Thread* thread, Thread* target,
                        ThreadVisitor* visitor) = 0;
   virtual uint64_t call(void* function, uintptr_t* arguments, uint8_t* types,
@@ -146,6 +152,8 @@ class System {
   virtual const char* toAbsolutePath(Allocator* allocator,
                                      const char* name) = 0;
   virtual int64_t now() = 0;
+  virtual int64_t nowMicroseconds() = 0;
+  virtual int processId() = 0;
   virtual void yield() = 0;
   virtual void exit(int code) = 0;
   virtual void abort() = 0;
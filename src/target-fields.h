@@ -16,42 +16,58 @@
 #  if (TARGET_BYTES_PER_WORD == 8)
 
 #define TARGET_THREAD_EXCEPTION 80
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2256
-#define TARGET_THREAD_EXCEPTIONOFFSET 2264
-#define TARGET_THREAD_EXCEPTIONHANDLER 2272
+#define TARGET_THREAD_SAFEPOINTREQUESTED 128
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2296
+#define TARGET_THREAD_EXCEPTIONOFFSET 2304
+#define TARGET_THREAD_EXCEPTIONHANDLER 2312
 
-#define TARGET_THREAD_IP 2216
-#define TARGET_THREAD_STACK 2224
-#define TARGET_THREAD_NEWSTACK 2232
-#define TARGET_THREAD_SCRATCH 2240
-#define TARGET_THREAD_CONTINUATION 2248
-#define TARGET_THREAD_TAILADDRESS 2280
-#define TARGET_THREAD_VIRTUALCALLTARGET 2288
-#define TARGET_THREAD_VIRTUALCALLINDEX 2296
-#define TARGET_THREAD_HEAPIMAGE 2304
-#define TARGET_THREAD_CODEIMAGE 2312
-#define TARGET_THREAD_THUNKTABLE 2320
-#define TARGET_THREAD_STACKLIMIT 2368
+#define TARGET_THREAD_IP 2256
+#define TARGET_THREAD_STACK 2264
+#define TARGET_THREAD_NEWSTACK 2272
+#define TARGET_THREAD_SCRATCH 2280
+#define TARGET_THREAD_CONTINUATION 2288
+#define TARGET_THREAD_TAILADDRESS 2320
+#define TARGET_THREAD_VIRTUALCALLTARGET 2328
+#define TARGET_THREAD_VIRTUALCALLINDEX 2336
+#define TARGET_THREAD_HEAPIMAGE 2344
+#define TARGET_THREAD_CODEIMAGE 2352
+#define TARGET_THREAD_THUNKTABLE 2360
+#define TARGET_THREAD_STACKLIMIT 2408
+
+#define TARGET_CONTINUATION_NEXT 8
+#define TARGET_CONTINUATION_ADDRESS 32
+#define TARGET_CONTINUATION_RETURNADDRESSOFFSET 40
+#define TARGET_CONTINUATION_FRAMEPOINTEROFFSET 48
+#define TARGET_CONTINUATION_LENGTH 56
+#define TARGET_CONTINUATION_BODY 64
 
 #  elif (TARGET_BYTES_PER_WORD == 4)
 
 #define TARGET_THREAD_EXCEPTION 44
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2164
-#define TARGET_THREAD_EXCEPTIONOFFSET 2168
-#define TARGET_THREAD_EXCEPTIONHANDLER 2172
+#define TARGET_THREAD_SAFEPOINTREQUESTED 80
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2192
+#define TARGET_THREAD_EXCEPTIONOFFSET 2196
+#define TARGET_THREAD_EXCEPTIONHANDLER 2200
+
+#define TARGET_THREAD_IP 2172
+#define TARGET_THREAD_STACK 2176
+#define TARGET_THREAD_NEWSTACK 2180
+#define TARGET_THREAD_SCRATCH 2184
+#define TARGET_THREAD_CONTINUATION 2188
+#define TARGET_THREAD_TAILADDRESS 2204
+#define TARGET_THREAD_VIRTUALCALLTARGET 2208
+#define TARGET_THREAD_VIRTUALCALLINDEX 2212
+#define TARGET_THREAD_HEAPIMAGE 2216
+#define TARGET_THREAD_CODEIMAGE 2220
+#define TARGET_THREAD_THUNKTABLE 2224
+#define TARGET_THREAD_STACKLIMIT 2248
 
-#define TARGET_THREAD_IP 2144
-#define TARGET_THREAD_STACK 2148
-#define TARGET_THREAD_NEWSTACK 2152
-#define TARGET_THREAD_SCRATCH 2156
-#define TARGET_THREAD_CONTINUATION 2160
-#define TARGET_THREAD_TAILADDRESS 2176
-#define TARGET_THREAD_VIRTUALCALLTARGET 2180
-#define TARGET_THREAD_VIRTUALCALLINDEX 2184
-#define TARGET_THREAD_HEAPIMAGE 2188
-#define TARGET_THREAD_CODEIMAGE 2192
-#define TARGET_THREAD_THUNKTABLE 2196
-#define TARGET_THREAD_STACKLIMIT 2220
+#define TARGET_CONTINUATION_NEXT 4
+#define TARGET_CONTINUATION_ADDRESS 16
+#define TARGET_CONTINUATION_RETURNADDRESSOFFSET 20
+#define TARGET_CONTINUATION_FRAMEPOINTEROFFSET 24
+#define TARGET_CONTINUATION_LENGTH 28
+#define TARGET_CONTINUATION_BODY 32
 
 #  else
 #    error
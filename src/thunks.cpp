@@ -1,5 +1,6 @@
 THUNK(tryInitClass)
 THUNK(findInterfaceMethodFromInstance)
+THUNK(findInterfaceMethodFromInstanceAndCache)
 THUNK(findInterfaceMethodFromInstanceAndReference)
 THUNK(findSpecialMethodFromReference)
 THUNK(findStaticMethodFromReference)
@@ -43,8 +44,12 @@ THUNK(longToFloat)
 THUNK(makeBlankObjectArray)
 THUNK(makeBlankObjectArrayFromReference)
 THUNK(makeBlankArray)
+THUNK(copyArray)
 THUNK(lookUpAddress)
 THUNK(setMaybeNull)
+THUNK(compareAndSwapInt)
+THUNK(compareAndSwapLong)
+THUNK(compareAndSwapObject)
 THUNK(acquireMonitorForObject)
 THUNK(acquireMonitorForObjectOnEntrance)
 THUNK(releaseMonitorForObject)
@@ -70,3 +75,4 @@ THUNK(set)
 THUNK(getJClass64)
 THUNK(getJClassFromReference)
 THUNK(gcIfNecessary)
+THUNK(safepoint)
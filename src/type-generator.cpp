@@ -2102,13 +2102,74 @@ writeMaps(Output* out, Object* declarations)
   out->write("\n};");
 }
 
+uint32_t
+typeFixedObjectMask(Object* type)
+{
+  unsigned fixedSizeInWords = typeFixedSize(type) / BytesPerWord;
+  return typeObjectMask(type)
+    & ((static_cast<uint32_t>(1) << fixedSizeInWords) - 1);
+}
+
+void
+writeWalk(Output* out, uint32_t mask)
+{
+  out->write("  return w->visit(0)");
+  for (unsigned i = 1; i < 32; ++i) {
+    if (mask & (static_cast<uint32_t>(1) << i)) {
+      out->write("\n    and w->visit(");
+      out->write(i);
+      out->write(")");
+    }
+  }
+  out->write(";\n");
+}
+
+void
+writeWalks(Output* out, Object* declarations)
+{
+  // several types often share a mask, so we write one case per
+  // distinct mask rather than one per type
+  unsigned count = typeCount(declarations);
+  uint32_t* masks = static_cast<uint32_t*>(malloc(count * sizeof(uint32_t)));
+  unsigned maskCount = 0;
+
+  for (Object* p = declarations; p; p = cdr(p)) {
+    Object* o = car(p);
+    if (o->type == Object::Type and typeObjectMask(o) != 1) {
+      uint32_t mask = typeFixedObjectMask(o);
+
+      bool found = false;
+      for (unsigned i = 0; i < maskCount; ++i) {
+        if (masks[i] == mask) {
+          found = true;
+          break;
+        }
+      }
+
+      if (not found) {
+        masks[maskCount++] = mask;
+
+        out->write("case ");
+        out->write(mask);
+        out->write(": // ");
+        out->write(typeName(o));
+        out->write("\n");
+        writeWalk(out, mask);
+        out->write("\n");
+      }
+    }
+  }
+
+  free(masks);
+}
+
 void
 usageAndExit(const char* command)
 {
   fprintf(stderr,
           "usage: %s <classpath> <input file> <output file> "
           "{enums,declarations,constructors,initializations,"
-          "java-initializations,name-initializations,maps}\n",
+          "java-initializations,name-initializations,maps,walks}\n",
           command);
   exit(-1);
 }
@@ -2139,7 +2200,8 @@ main(int ac, char** av)
               or local::equal(av[4], "initializations")
               or local::equal(av[4], "java-initializations")
               or local::equal(av[4], "name-initializations")
-              or local::equal(av[4], "maps")))
+              or local::equal(av[4], "maps")
+              or local::equal(av[4], "walks")))
   {
     local::usageAndExit(av[0]);
   }
@@ -2212,6 +2274,8 @@ main(int ac, char** av)
     local::writeNameInitializations(&out, declarations);
   } else if (local::equal(av[4], "maps")) {
     local::writeMaps(&out, declarations);
+  } else if (local::equal(av[4], "walks")) {
+    local::writeWalks(&out, declarations);
   }
 
   out.write("\n");
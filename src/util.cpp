@@ -316,10 +316,88 @@ treeAdd(Thread* t, TreeContext* c)
   return newRoot;
 }
 
+unsigned
+hashTableIndex(uint32_t hash, unsigned capacity)
+{
+  // the hashes we get are often weak in their low bits, which linear
+  // probing is sensitive to, so mix them first
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  return hash & (capacity - 1);
+}
+
+void
+hashTablePlace(Thread* t, object array, object key, object value,
+               uint32_t hash)
+{
+  unsigned capacity = arrayLength(t, array) / 2;
+  unsigned i = hashTableIndex(hash, capacity);
+  while (arrayBody(t, array, i * 2)) {
+    i = (i + 1) & (capacity - 1);
+  }
+
+  set(t, array, ArrayBody + ((i * 2) * BytesPerWord), key);
+  set(t, array, ArrayBody + (((i * 2) + 1) * BytesPerWord), value);
+}
+
 } // namespace
 
 namespace vm {
 
+int
+hashTableFind(Thread* t, object table, object key,
+              uint32_t (*hash)(Thread*, object),
+              bool (*equal)(Thread*, object, object))
+{
+  object array = hashTableArray(t, table);
+  if (array) {
+    unsigned capacity = arrayLength(t, array) / 2;
+    // the table is never more than half full, so this terminates
+    for (unsigned i = hashTableIndex(hash(t, key), capacity);;
+         i = (i + 1) & (capacity - 1))
+    {
+      object k = arrayBody(t, array, i * 2);
+      if (k == 0) {
+        break;
+      } else if (equal(t, key, k)) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
+void
+hashTableInsert(Thread* t, object table, object key, object value,
+                uint32_t (*hash)(Thread*, object))
+{
+  PROTECT(t, table);
+  PROTECT(t, key);
+  PROTECT(t, value);
+
+  unsigned capacity = hashTableCapacity(t, table);
+  if ((hashTableSize(t, table) + 1) * 2 > capacity) {
+    unsigned newCapacity = capacity ? capacity * 2 : 8;
+    object newArray = makeArray(t, newCapacity * 2);
+
+    object array = hashTableArray(t, table);
+    for (unsigned i = 0; i < capacity; ++i) {
+      object k = arrayBody(t, array, i * 2);
+      if (k) {
+        hashTablePlace
+          (t, newArray, k, arrayBody(t, array, (i * 2) + 1), hash(t, k));
+      }
+    }
+
+    set(t, table, HashTableArray, newArray);
+  }
+
+  hashTablePlace(t, hashTableArray(t, table), key, value, hash(t, key));
+
+  ++ hashTableSize(t, table);
+}
+
 object
 hashMapFindNode(Thread* t, object map, object key,
                 uint32_t (*hash)(Thread*, object),
@@ -395,6 +473,8 @@ hashMapResize(Thread* t, object map, uint32_t (*hash)(Thread*, object),
       }
     }
   }
+
+  storeStoreMemoryBarrier();
   
   set(t, map, HashMapArray, newArray);
 }
@@ -448,6 +528,11 @@ hashMapInsert(Thread* t, object map, object key, object value,
   unsigned index = h & (arrayLength(t, array) - 1);
 
   set(t, n, TripleThird, arrayBody(t, array, index));
+
+  // some maps are probed without a lock; publish the node only once it
+  // is complete
+  storeStoreMemoryBarrier();
+
   set(t, array, ArrayBody + (index * BytesPerWord), n);
 }
 
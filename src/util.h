@@ -72,6 +72,70 @@ hashMapRemove(Thread* t, object map, object key,
               uint32_t (*hash)(Thread*, object),
               bool (*equal)(Thread*, object, object));
 
+// Hash tables use open addressing: keys and values share one array,
+// the key of slot i at index 2i and its value at 2i + 1, so a probe
+// touches no other objects and an entry costs no node of its own.
+// Tables hold their keys strongly and do not support removal.
+
+inline unsigned
+hashTableCapacity(Thread* t, object table)
+{
+  object array = hashTableArray(t, table);
+  return array ? arrayLength(t, array) / 2 : 0;
+}
+
+inline object
+hashTableKey(Thread* t, object table, unsigned slot)
+{
+  return arrayBody(t, hashTableArray(t, table), slot * 2);
+}
+
+inline object
+hashTableValue(Thread* t, object table, unsigned slot)
+{
+  return arrayBody(t, hashTableArray(t, table), (slot * 2) + 1);
+}
+
+inline void
+hashTableSetValue(Thread* t, object table, unsigned slot, object value)
+{
+  set(t, hashTableArray(t, table), ArrayBody
+      + (((slot * 2) + 1) * BytesPerWord), value);
+}
+
+// Returns the slot holding the specified key, or -1 if there is none.
+int
+hashTableFind(Thread* t, object table, object key,
+              uint32_t (*hash)(Thread*, object),
+              bool (*equal)(Thread*, object, object));
+
+inline object
+hashTableGet(Thread* t, object table, object key,
+             uint32_t (*hash)(Thread*, object),
+             bool (*equal)(Thread*, object, object))
+{
+  int slot = hashTableFind(t, table, key, hash, equal);
+  return slot >= 0 ? hashTableValue(t, table, slot) : 0;
+}
+
+// Inserts an entry for a key which is not already in the table.
+void
+hashTableInsert(Thread* t, object table, object key, object value,
+                uint32_t (*hash)(Thread*, object));
+
+inline bool
+hashTableInsertMaybe(Thread* t, object table, object key, object value,
+                     uint32_t (*hash)(Thread*, object),
+                     bool (*equal)(Thread*, object, object))
+{
+  if (hashTableFind(t, table, key, hash, equal) < 0) {
+    hashTableInsert(t, table, key, value, hash);
+    return true;
+  } else {
+    return false;
+  }
+}
+
 object
 hashMapIterator(Thread* t, object map);
 
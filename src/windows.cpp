@@ -8,6 +8,12 @@
    There is NO WARRANTY for this software.  See license.txt for
    details. */
 
+// TryEnterCriticalSection and InitializeCriticalSectionAndSpinCount
+// are only declared for NT 4.0 SP3 and later
+#ifndef _WIN32_WINNT
+#  define _WIN32_WINNT 0x0500
+#endif
+
 #include "sys/stat.h"
 #include "windows.h"
 #include "sys/timeb.h"
@@ -26,27 +32,56 @@
 #include "arch.h"
 #include "system.h"
 
-#define ACQUIRE(s, x) MutexResource MAKE_NAME(mutexResource_) (s, x)
+#define ACQUIRE(x) MutexResource MAKE_NAME(mutexResource_) (x)
 
 using namespace vm;
 
 namespace {
 
+// number of times to spin on a contended lock before waiting for it
+// in the kernel
+const unsigned LockSpinCount = 4000;
+
+// A lock built on a critical section, which is acquired and released
+// without leaving user mode unless another thread holds it.
+class Lock {
+ public:
+  Lock() {
+    InitializeCriticalSectionAndSpinCount(&section, LockSpinCount);
+  }
+
+  bool tryAcquire() {
+    return TryEnterCriticalSection(&section) != 0;
+  }
+
+  void acquire() {
+    EnterCriticalSection(&section);
+  }
+
+  void release() {
+    LeaveCriticalSection(&section);
+  }
+
+  void dispose() {
+    DeleteCriticalSection(&section);
+  }
+
+ private:
+  CRITICAL_SECTION section;
+};
+
 class MutexResource {
  public:
-  MutexResource(System* s, HANDLE m): s(s), m(m) {
-    int r UNUSED = WaitForSingleObject(m, INFINITE);
-    assert(s, r == WAIT_OBJECT_0);
+  MutexResource(Lock& lock): lock(&lock) {
+    lock.acquire();
   }
 
   ~MutexResource() {
-    bool success UNUSED = ReleaseMutex(m);
-    assert(s, success);
+    lock->release();
   }
 
  private:
-  System* s; 
-  HANDLE m;
+  Lock* lock;
 };
 
 const unsigned SegFaultIndex = 0;
@@ -60,6 +95,9 @@ MySystem* system;
 LONG CALLBACK
 handleException(LPEXCEPTION_POINTERS e);
 
+BOOL WINAPI
+handleConsoleControl(DWORD type);
+
 DWORD WINAPI
 run(void* r)
 {
@@ -82,15 +120,12 @@ class MySystem: public System {
       next(0),
       flags(0)
     {
-      mutex = CreateMutex(0, false, 0);
-      assert(s, mutex);
-
       event = CreateEvent(0, true, false, 0);
       assert(s, event);
     }
 
     virtual void interrupt() {
-      ACQUIRE(s, mutex);
+      ACQUIRE(mutex);
 
       r->setInterrupted(true);
 
@@ -101,7 +136,7 @@ class MySystem: public System {
     }
 
     virtual bool getAndClearInterrupted() {
-      ACQUIRE(s, mutex);
+      ACQUIRE(mutex);
 
       bool interrupted = r->interrupted();
 
@@ -117,13 +152,13 @@ class MySystem: public System {
 
     virtual void dispose() {
       CloseHandle(event);
-      CloseHandle(mutex);
+      mutex.dispose();
       CloseHandle(thread);
       ::free(this);
     }
 
     HANDLE thread;
-    HANDLE mutex;
+    Lock mutex;
     HANDLE event;
     System* s;
     System::Runnable* r;
@@ -133,36 +168,28 @@ class MySystem: public System {
 
   class Mutex: public System::Mutex {
    public:
-    Mutex(System* s): s(s) {
-      mutex = CreateMutex(0, false, 0);
-      assert(s, mutex);
-    }
+    Mutex(System* s): s(s) { }
 
     virtual void acquire() {
-      int r UNUSED = WaitForSingleObject(mutex, INFINITE);
-      assert(s, r == WAIT_OBJECT_0);
+      mutex.acquire();
     }
 
     virtual void release() {
-      bool success UNUSED = ReleaseMutex(mutex);
-      assert(s, success);
+      mutex.release();
     }
 
     virtual void dispose() {
-      CloseHandle(mutex);
+      mutex.dispose();
       ::free(this);
     }
 
     System* s;
-    HANDLE mutex;
+    Lock mutex;
   };
 
   class Monitor: public System::Monitor {
    public:
-    Monitor(System* s): s(s), owner_(0), first(0), last(0), depth(0) {
-      mutex = CreateMutex(0, false, 0);
-      assert(s, mutex);
-    }
+    Monitor(System* s): s(s), owner_(0), first(0), last(0), depth(0) { }
 
     virtual bool tryAcquire(System::Thread* context) {
       Thread* t = static_cast<Thread*>(context);
@@ -171,19 +198,12 @@ class MySystem: public System {
       if (owner_ == t) {
         ++ depth;
         return true;
+      } else if (mutex.tryAcquire()) {
+        owner_ = t;
+        ++ depth;
+        return true;
       } else {
-        switch (WaitForSingleObject(mutex, 0)) {
-        case WAIT_TIMEOUT:
-          return false;
-
-        case WAIT_OBJECT_0:
-          owner_ = t;
-          ++ depth;
-          return true;
-
-        default:
-          sysAbort(s);
-        }
+        return false;
       }
     }
 
@@ -192,8 +212,7 @@ class MySystem: public System {
       assert(s, t);
 
       if (owner_ != t) {
-        int r UNUSED = WaitForSingleObject(mutex, INFINITE);
-        assert(s, r == WAIT_OBJECT_0);
+        mutex.acquire();
         owner_ = t;
       }
       ++ depth;
@@ -206,8 +225,7 @@ class MySystem: public System {
       if (owner_ == t) {
         if (-- depth == 0) {
           owner_ = 0;
-          bool success UNUSED = ReleaseMutex(mutex);
-          assert(s, success);
+          mutex.release();
         }
       } else {
         sysAbort(s);
@@ -280,7 +298,7 @@ class MySystem: public System {
 
         int r UNUSED;
 
-        { ACQUIRE(s, t->mutex);
+        { ACQUIRE(t->mutex);
 
           expect(s, (t->flags & Notified) == 0);
 
@@ -297,21 +315,18 @@ class MySystem: public System {
           this->depth = 0;
           owner_ = 0;
 
-          bool success UNUSED = ReleaseMutex(mutex);
-          assert(s, success);
+          mutex.release();
 
           if (not interrupted) {
-            success = ResetEvent(t->event);
+            bool success UNUSED = ResetEvent(t->event);
             assert(s, success);
 
-            success = ReleaseMutex(t->mutex);
-            assert(s, success);
+            t->mutex.release();
 
             r = WaitForSingleObject(t->event, (time ? time : INFINITE));
             assert(s, r == WAIT_OBJECT_0 or r == WAIT_TIMEOUT);
 
-            r = WaitForSingleObject(t->mutex, INFINITE);
-            assert(s, r == WAIT_OBJECT_0);
+            t->mutex.acquire();
 
             interrupted = t->r->interrupted();
             if (interrupted and clearInterrupted) {
@@ -322,10 +337,9 @@ class MySystem: public System {
           notified = ((t->flags & Notified) != 0);
         }
 
-        r = WaitForSingleObject(mutex, INFINITE);
-        assert(s, r == WAIT_OBJECT_0);
+        mutex.acquire();
 
-        { ACQUIRE(s, t->mutex);
+        { ACQUIRE(t->mutex);
           t->flags = 0;
         }
 
@@ -351,7 +365,7 @@ class MySystem: public System {
     }
 
     void doNotify(Thread* t) {
-      ACQUIRE(s, t->mutex);
+      ACQUIRE(t->mutex);
 
       t->flags |= Notified;
 
@@ -399,12 +413,12 @@ class MySystem: public System {
 
     virtual void dispose() {
       assert(s, owner_ == 0);
-      CloseHandle(mutex);
+      mutex.dispose();
       ::free(this);
     }
 
     System* s;
-    HANDLE mutex;
+    Lock mutex;
     Thread* owner_;
     Thread* first;
     Thread* last;
@@ -559,6 +573,7 @@ class MySystem: public System {
   };
 
   MySystem(const char* crashDumpDirectory):
+    dumpHandler(0),
     oldHandler(0),
     crashDumpDirectory(crashDumpDirectory)
   {
@@ -566,9 +581,6 @@ class MySystem: public System {
     system = this;
 
     memset(handlers, 0, sizeof(handlers));
-
-    mutex = CreateMutex(0, false, 0);
-    assert(this, mutex);
   }
 
   bool findHandler() {
@@ -628,6 +640,15 @@ class MySystem: public System {
     assert(this, r);
   }
 
+  virtual void adviseHugePages(void*, unsigned) {
+    // large pages must be reserved up front via VirtualAlloc and
+    // require a privilege most processes lack, so this is a no-op
+  }
+
+  virtual void releaseFreeMemory() {
+    // the process heap decommits large free blocks on its own
+  }
+
   virtual bool success(Status s) {
     return s == 0;
   }
@@ -674,6 +695,40 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroIndex);
   }
 
+  virtual Status handleStackOverflow(SignalHandler*) {
+    // the guard page below a thread's stack is consumed by the fault
+    // which reports the overflow and is only restored by
+    // _resetstkoflw once the stack has been unwound, which the
+    // handler cannot arrange, so overflows are left to the per-call
+    // checks the JIT emits
+    return 1;
+  }
+
+  virtual Status handleDumpRequest(SignalHandler* handler) {
+    // Ctrl-Break stands in for SIGQUIT here, and its handler is
+    // called on a thread of its own rather than interrupting one
+    if (handler) {
+      dumpHandler = handler;
+      return SetConsoleCtrlHandler(handleConsoleControl, true) ? 0 : 1;
+    } else if (dumpHandler) {
+      dumpHandler = 0;
+      SetConsoleCtrlHandler(handleConsoleControl, false);
+      return 0;
+    } else {
+      return 1;
+    }
+  }
+
+  virtual Status handleProfile(SignalHandler*, unsigned) {
+    // there is no interval timer which interrupts the running thread,
+    // so sampling is unsupported
+    return 1;
+  }
+
+  virtual int processId() {
+    return GetCurrentProcessId();
+  }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -681,7 +736,7 @@ class MySystem: public System {
 
     Thread* target = static_cast<Thread*>(sTarget);
 
-    ACQUIRE(this, mutex);
+    ACQUIRE(mutex);
 
     bool success = false;
     int rv = SuspendThread(target->thread);
@@ -865,6 +920,18 @@ class MySystem: public System {
              | time.dwLowDateTime) / 10000) - 11644473600000LL;
   }
 
+  virtual int64_t nowMicroseconds() {
+    // the system time is only updated on each clock tick, so use the
+    // performance counter, which is intended for measuring intervals:
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return ((counter.QuadPart / frequency.QuadPart) * 1000000)
+      + (((counter.QuadPart % frequency.QuadPart) * 1000000)
+         / frequency.QuadPart);
+  }
+
   virtual void yield() {
     SwitchToThread();
   }
@@ -881,12 +948,13 @@ class MySystem: public System {
 
   virtual void dispose() {
     system = 0;
-    CloseHandle(mutex);
+    mutex.dispose();
     ::free(this);
   }
 
-  HANDLE mutex;
+  Lock mutex;
   SignalHandler* handlers[HandlerCount];
+  SignalHandler* dumpHandler;
   LPTOP_LEVEL_EXCEPTION_FILTER oldHandler;
   const char* crashDumpDirectory;
 };
@@ -1005,6 +1073,18 @@ handleException(LPEXCEPTION_POINTERS e)
   return EXCEPTION_CONTINUE_SEARCH;
 }
 
+BOOL WINAPI
+handleConsoleControl(DWORD type)
+{
+  System::SignalHandler* handler = system ? system->dumpHandler : 0;
+  if (type == CTRL_BREAK_EVENT and handler) {
+    handler->handleSignal(0, 0, 0, 0);
+    return true;
+  } else {
+    return false;
+  }
+}
+
 } // namespace
 
 namespace vm {
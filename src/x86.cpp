@@ -10,6 +10,7 @@
 
 #include "environment.h"
 #include "assembler.h"
+#include "last-move.h"
 #include "target.h"
 #include "vector.h"
 
@@ -158,7 +159,7 @@ class Context {
   Context(System* s, Allocator* a, Zone* zone, ArchitectureContext* ac):
     s(s), zone(zone), client(0), code(s, a, 1024), tasks(0), result(0),
     firstBlock(new(zone) MyBlock(0)),
-    lastBlock(firstBlock), ac(ac)
+    lastBlock(firstBlock), ac(ac), rewrites(0)
   { }
 
   System* s;
@@ -170,6 +171,8 @@ class Context {
   MyBlock* firstBlock;
   MyBlock* lastBlock;
   ArchitectureContext* ac;
+  LastMove lastMove;
+  unsigned rewrites;
 };
 
 void NO_RETURN
@@ -463,6 +466,34 @@ useSSE(ArchitectureContext* c)
   }
 }
 
+bool
+usePopcnt(ArchitectureContext* c)
+{
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x800000, 0);
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
+bool
+useSSE41(ArchitectureContext* c)
+{
+  if (c->useNativeFeatures and useSSE(c)) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x80000, 0);
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
 #define REX_W 0x48
 #define REX_R 0x44
 #define REX_X 0x42
@@ -2438,15 +2469,58 @@ void
 float2IntRR(Context* c, unsigned aSize, Assembler::Register* a,
             unsigned bSize, Assembler::Register* b)
 {
-  assert(c, not floatReg(b));
+  assert(c, floatReg(a) and not floatReg(b));
+
+  // cvttss2si/cvttsd2si produce the minimum integer for NaN and
+  // out-of-range values, whereas Java requires zero for NaN and the
+  // nearest representable integer otherwise, so we check for the
+  // minimum and correct the result as necessary:
   floatRegOp(c, aSize, a, bSize, b, 0x2c);
-}
 
-void
-float2IntMR(Context* c, unsigned aSize, Assembler::Memory* a,
-            unsigned bSize, Assembler::Register* b)
-{
-  floatMemOp(c, aSize, a, bSize, b, 0x2c);
+  ResolvedPromise onePromise(1);
+  Assembler::Constant one(&onePromise);
+
+  // subtracting one overflows only for the minimum integer:
+  compareCR(c, bSize, &one, bSize, b);
+  opcode(c, 0x71); // jno
+  unsigned done = c->code.length();
+  c->code.append(0);
+
+  compareFloatRR(c, aSize, a, aSize, a);
+  opcode(c, 0x7a); // jp
+  unsigned nan = c->code.length();
+  c->code.append(0);
+
+  // b = (sign of a) - 1, i.e. zero or -1, with the high bit flipped:
+  if (aSize == 8) {
+    opcode(c, 0x66);
+  }
+  maybeRex(c, 4, b, a);
+  opcode(c, 0x0f, 0x50); // movmskps or movmskpd
+  modrm(c, 0xc0, a, b);
+
+  andCR(c, bSize, &one, bSize, b);
+  subtractCR(c, bSize, &one, bSize, b);
+
+  maybeRex(c, bSize, b);
+  opcode(c, 0x0f, 0xba); // btc
+  c->code.append(0xf8 + regCode(b));
+  c->code.append((bSize * 8) - 1);
+
+  opcode(c, 0xeb); // jmp
+  unsigned end = c->code.length();
+  c->code.append(0);
+
+  int8_t nanOffset = c->code.length() - nan - 1;
+  c->code.set(nan, &nanOffset, 1);
+
+  xorRR(c, bSize, b, bSize, b);
+
+  int8_t doneOffset = c->code.length() - done - 1;
+  c->code.set(done, &doneOffset, 1);
+
+  int8_t endOffset = c->code.length() - end - 1;
+  c->code.set(end, &endOffset, 1);
 }
 
 void
@@ -2528,6 +2602,107 @@ absoluteRR(Context* c, unsigned aSize, Assembler::Register* a,
   c->client->releaseTemporary(rdx);
 }
 
+void
+populationCountRR(Context* c, unsigned aSize, Assembler::Register* a,
+                  unsigned bSize UNUSED, Assembler::Register* b)
+{
+  opcode(c, 0xf3);
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xb8); // popcnt
+  modrm(c, 0xc0, a, b);
+}
+
+void
+countLeadingZerosRR(Context* c, unsigned aSize, Assembler::Register* a,
+                    unsigned bSize UNUSED, Assembler::Register* b)
+{
+  // the index of the highest set bit, subtracted from the highest bit
+  // index by flipping its bits, or the operand size if there is none:
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xbd); // bsr
+  modrm(c, 0xc0, a, b);
+
+  opcode(c, 0x74); // jz
+  unsigned zero = c->code.length();
+  c->code.append(0);
+
+  ResolvedPromise maskPromise((aSize * 8) - 1);
+  Assembler::Constant mask(&maskPromise);
+  xorCR(c, 4, &mask, 4, b);
+
+  opcode(c, 0xeb); // jmp
+  unsigned done = c->code.length();
+  c->code.append(0);
+
+  int8_t zeroOffset = c->code.length() - zero - 1;
+  c->code.set(zero, &zeroOffset, 1);
+
+  ResolvedPromise sizePromise(aSize * 8);
+  Assembler::Constant size(&sizePromise);
+  moveCR(c, 4, &size, 4, b);
+
+  int8_t doneOffset = c->code.length() - done - 1;
+  c->code.set(done, &doneOffset, 1);
+}
+
+void
+countTrailingZerosRR(Context* c, unsigned aSize, Assembler::Register* a,
+                     unsigned bSize UNUSED, Assembler::Register* b)
+{
+  // the index of the lowest set bit, or the operand size if there is
+  // none:
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xbc); // bsf
+  modrm(c, 0xc0, a, b);
+
+  opcode(c, 0x75); // jnz
+  unsigned done = c->code.length();
+  c->code.append(0);
+
+  ResolvedPromise sizePromise(aSize * 8);
+  Assembler::Constant size(&sizePromise);
+  moveCR(c, 4, &size, 4, b);
+
+  int8_t doneOffset = c->code.length() - done - 1;
+  c->code.set(done, &doneOffset, 1);
+}
+
+void
+floatRoundRR(Context* c, unsigned aSize, Assembler::Register* a,
+             Assembler::Register* b, uint8_t mode)
+{
+  assert(c, floatReg(a) and floatReg(b));
+
+  opcode(c, 0x66);
+  maybeRex(c, 4, b, a);
+  opcode(c, 0x0f, 0x3a);
+  opcode(c, aSize == 8 ? 0x0b : 0x0a); // roundsd or roundss
+  modrm(c, 0xc0, a, b);
+  // the mode, with precision exceptions suppressed:
+  c->code.append(mode | 8);
+}
+
+void
+floatFloorRR(Context* c, unsigned aSize, Assembler::Register* a,
+             unsigned bSize UNUSED, Assembler::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 1);
+}
+
+void
+floatCeilingRR(Context* c, unsigned aSize, Assembler::Register* a,
+               unsigned bSize UNUSED, Assembler::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 2);
+}
+
+void
+floatRoundToEvenRR(Context* c, unsigned aSize, Assembler::Register* a,
+                   unsigned bSize UNUSED, Assembler::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 0);
+}
+
 unsigned
 argumentFootprint(unsigned footprint)
 {
@@ -2722,7 +2897,6 @@ populateTables(ArchitectureContext* c)
   bo[index(c, Float2Float, M, R)] = CAST2(float2FloatMR);
 
   bo[index(c, Float2Int, R, R)] = CAST2(float2IntRR);
-  bo[index(c, Float2Int, M, R)] = CAST2(float2IntMR);
 
   bo[index(c, Int2Float, R, R)] = CAST2(int2FloatRR);
   bo[index(c, Int2Float, M, R)] = CAST2(int2FloatMR);
@@ -2730,6 +2904,14 @@ populateTables(ArchitectureContext* c)
   bo[index(c, Absolute, R, R)] = CAST2(absoluteRR);
   bo[index(c, FloatAbsolute, R, R)] = CAST2(floatAbsoluteRR);
 
+  bo[index(c, PopulationCount, R, R)] = CAST2(populationCountRR);
+  bo[index(c, CountLeadingZeros, R, R)] = CAST2(countLeadingZerosRR);
+  bo[index(c, CountTrailingZeros, R, R)] = CAST2(countTrailingZerosRR);
+
+  bo[index(c, FloatFloor, R, R)] = CAST2(floatFloorRR);
+  bo[index(c, FloatCeiling, R, R)] = CAST2(floatCeilingRR);
+  bo[index(c, FloatRound, R, R)] = CAST2(floatRoundToEvenRR);
+
   bro[branchIndex(c, R, R)] = CAST_BRANCH(branchRR);
   bro[branchIndex(c, C, R)] = CAST_BRANCH(branchCR);
   bro[branchIndex(c, C, M)] = CAST_BRANCH(branchCM);
@@ -2998,6 +3180,14 @@ class MyArchitecture: public Assembler::Architecture {
     case Absolute:
       return true;
 
+    case PopulationCount:
+    case CountLeadingZeros:
+    case CountTrailingZeros:
+    case FloatFloor:
+    case FloatCeiling:
+    case FloatRound:
+      return false;
+
     default:
       abort(&c);
     }
@@ -3094,12 +3284,10 @@ class MyArchitecture: public Assembler::Architecture {
       break;
 
     case Float2Int:
-      // todo: Java requires different semantics than SSE for
-      // converting floats to integers, we we need to either use
-      // thunks or produce inline machine code which handles edge
-      // cases properly.
-      if (false and useSSE(&c) and bSize <= TargetBytesPerWord) {
-        *aTypeMask = (1 << RegisterOperand) | (1 << MemoryOperand);
+      // float2IntRR handles the edge cases where Java's semantics
+      // differ from SSE's, which requires the source in a register:
+      if (useSSE(&c) and bSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand);
         *aRegisterMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
           | FloatRegisterMask;
       } else {
@@ -3117,6 +3305,35 @@ class MyArchitecture: public Assembler::Architecture {
       }
       break;
 
+    case PopulationCount:
+      if (usePopcnt(&c) and aSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case CountLeadingZeros:
+    case CountTrailingZeros:
+      if (aSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case FloatFloor:
+    case FloatCeiling:
+    case FloatRound:
+      if (useSSE41(&c)) {
+        *aTypeMask = (1 << RegisterOperand);
+        *aRegisterMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
+          | FloatRegisterMask;
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case Move:
       *aTypeMask = ~0;
       *aRegisterMask = ~static_cast<uint64_t>(0);
@@ -3170,12 +3387,18 @@ class MyArchitecture: public Assembler::Architecture {
     case FloatSquareRoot:
     case Float2Float:
     case Int2Float:
+    case FloatFloor:
+    case FloatCeiling:
+    case FloatRound:
       *bTypeMask = (1 << RegisterOperand);
       *bRegisterMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
         | FloatRegisterMask;
       break;
 
     case Float2Int:
+    case PopulationCount:
+    case CountLeadingZeros:
+    case CountTrailingZeros:
       *bTypeMask = (1 << RegisterOperand);
       break;
 
@@ -3398,6 +3621,54 @@ class MyArchitecture: public Assembler::Architecture {
   unsigned referenceCount;
 };
 
+void
+forgetMove(Context* c)
+{
+  c->lastMove.forget();
+}
+
+void
+rememberMove(Context* c, unsigned aSize, OperandType aType,
+             Assembler::Operand* a, unsigned bSize, OperandType bType,
+             Assembler::Operand* b)
+{
+  c->lastMove.remember(c->code.length(), aSize, aType, a, bSize, bType, b);
+}
+
+// Returns true if the specified move need not be emitted as given,
+// either because it only repeats or undoes the move emitted just
+// before it, or because it reloads a register which that move just
+// stored, in which case it is replaced by a register-to-register move.
+bool
+rewriteMove(Context* c, unsigned aSize, OperandType aType,
+            Assembler::Operand* a, unsigned bSize, OperandType bType,
+            Assembler::Operand* b)
+{
+  LastMove* m = &(c->lastMove);
+  switch (m->match(c->code.length(), aSize, aType, a, bSize, bType, b)) {
+  case LastMove::Redundant:
+    ++ c->rewrites;
+    return true;
+
+  case LastMove::Reload: {
+    Assembler::Register* to = static_cast<Assembler::Register*>(b);
+    if (floatReg(to) == floatReg(&(m->a))) {
+      Assembler::Register from(m->a);
+      moveRR(c, aSize, &from, bSize, to);
+      rememberMove(c, aSize, RegisterOperand, &from, bSize,
+                   RegisterOperand, to);
+      ++ c->rewrites;
+      return true;
+    }
+  } break;
+
+  default:
+    break;
+  }
+
+  return false;
+}
+
 class MyAssembler: public Assembler {
  public:
   MyAssembler(System* s, Allocator* a, Zone* zone, MyArchitecture* arch):
@@ -3618,12 +3889,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual void apply(Operation op) {
+    forgetMove(&c);
+
     arch_->c.operations[op](&c);
   }
 
   virtual void apply(UnaryOperation op,
                      unsigned aSize, OperandType aType, Operand* aOperand)
   {
+    forgetMove(&c);
+
     arch_->c.unaryOperations[index(&(arch_->c), op, aType)]
       (&c, aSize, aOperand);
   }
@@ -3632,8 +3907,20 @@ class MyAssembler: public Assembler {
                      unsigned aSize, OperandType aType, Operand* aOperand,
                      unsigned bSize, OperandType bType, Operand* bOperand)
   {
-    arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
-      (&c, aSize, aOperand, bSize, bOperand);
+    if (op == Move) {
+      if (not rewriteMove(&c, aSize, aType, aOperand, bSize, bType, bOperand))
+      {
+        arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
+          (&c, aSize, aOperand, bSize, bOperand);
+
+        rememberMove(&c, aSize, aType, aOperand, bSize, bType, bOperand);
+      }
+    } else {
+      forgetMove(&c);
+
+      arch_->c.binaryOperations[index(&(arch_->c), op, aType, bType)]
+        (&c, aSize, aOperand, bSize, bOperand);
+    }
   }
 
   virtual void apply(TernaryOperation op,
@@ -3642,6 +3929,8 @@ class MyAssembler: public Assembler {
                      unsigned cSize UNUSED, OperandType cType UNUSED,
                      Operand* cOperand)
   {
+    forgetMove(&c);
+
     if (isBranch(op)) {
       assert(&c, aSize == bSize);
       assert(&c, cSize == TargetBytesPerWord);
@@ -3695,10 +3984,16 @@ class MyAssembler: public Assembler {
   }
 
   virtual Promise* offset(bool) {
+    // the next instruction may be a branch target, so it must not
+    // depend on the one before it:
+    forgetMove(&c);
+
     return local::offset(&c);
   }
 
   virtual Block* endBlock(bool startNew) {
+    forgetMove(&c);
+
     MyBlock* b = c.lastBlock;
     b->size = c.code.length() - b->offset;
     if (startNew) {
@@ -3721,6 +4016,10 @@ class MyAssembler: public Assembler {
     return 0;
   }
 
+  virtual unsigned rewriteCount() {
+    return c.rewrites;
+  }
+
   virtual void dispose() {
     c.code.dispose();
   }
@@ -18,6 +18,99 @@ namespace vm {
 
 class Zone: public Allocator {
  public:
+  // an allocator which keeps the segments freed by zones, up to a
+  // total of capacity bytes, and hands them out again to zones asking
+  // for segments of the same size, so that short-lived zones (e.g. one
+  // per compiled method) do not allocate and free the same segments
+  // over and over.  It may be shared by zones on different threads.
+  class Pool: public Allocator {
+   public:
+    class Entry {
+     public:
+      Entry(Entry* next, unsigned size): next(next), size(size) { }
+
+      Entry* next;
+      unsigned size;
+    };
+
+    Pool(System* s, Allocator* allocator, unsigned capacity):
+      s(s),
+      allocator(allocator),
+      lock(0),
+      entries(0),
+      footprint(0),
+      capacity(capacity)
+    {
+      if (not s->success(s->make(&lock))) {
+        s->abort();
+      }
+    }
+
+    void* take(unsigned size) {
+      void* p = 0;
+
+      lock->acquire();
+      for (Entry** e = &entries; *e; e = &((*e)->next)) {
+        if ((*e)->size == size) {
+          p = *e;
+          *e = (*e)->next;
+          footprint -= size;
+          break;
+        }
+      }
+      lock->release();
+
+      return p;
+    }
+
+    virtual void* tryAllocate(unsigned size) {
+      void* p = take(size);
+      return p ? p : allocator->tryAllocate(size);
+    }
+
+    virtual void* allocate(unsigned size) {
+      void* p = take(size);
+      return p ? p : allocator->allocate(size);
+    }
+
+    virtual void free(const void* p, unsigned size) {
+      if (size >= sizeof(Entry)) {
+        lock->acquire();
+        bool keep = footprint + size <= capacity;
+        if (keep) {
+          entries = new (const_cast<void*>(p)) Entry(entries, size);
+          footprint += size;
+        }
+        lock->release();
+
+        if (keep) {
+          return;
+        }
+      }
+
+      allocator->free(p, size);
+    }
+
+    void dispose() {
+      for (Entry* e = entries, *next; e; e = next) {
+        next = e->next;
+        allocator->free(e, e->size);
+      }
+
+      entries = 0;
+      footprint = 0;
+
+      lock->dispose();
+    }
+
+    System* s;
+    Allocator* allocator;
+    System::Mutex* lock;
+    Entry* entries;
+    unsigned footprint;
+    unsigned capacity;
+  };
+
   class Segment {
    public:
     Segment(Segment* next, unsigned size):
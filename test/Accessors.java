@@ -0,0 +1,123 @@
+public class Accessors {
+  private static int staticInt = 7;
+
+  private byte byteValue;
+  private char charValue;
+  private short shortValue;
+  private int intValue;
+  private long longValue;
+  private float floatValue;
+  private double doubleValue;
+  private Object objectValue;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int staticInt() {
+    return staticInt;
+  }
+
+  private byte byteValue() { return byteValue; }
+  private char charValue() { return charValue; }
+  private short shortValue() { return shortValue; }
+  private int intValue() { return intValue; }
+  private long longValue() { return longValue; }
+  private float floatValue() { return floatValue; }
+  private double doubleValue() { return doubleValue; }
+  private Object objectValue() { return objectValue; }
+
+  private void byteValue(byte v) { byteValue = v; }
+  private void charValue(char v) { charValue = v; }
+  private void shortValue(short v) { shortValue = v; }
+  private void intValue(int v) { intValue = v; }
+  private void longValue(long v) { longValue = v; }
+  private void floatValue(float v) { floatValue = v; }
+  private void doubleValue(double v) { doubleValue = v; }
+  private void objectValue(Object v) { objectValue = v; }
+
+  private static final class Point {
+    private int x;
+
+    public int x() {
+      return x;
+    }
+
+    public void x(int v) {
+      x = v;
+    }
+  }
+
+  private static class Base {
+    protected int y;
+
+    public final int y() {
+      return y;
+    }
+
+    public int overridden() {
+      return y;
+    }
+  }
+
+  private static class Derived extends Base {
+    public int overridden() {
+      return -y;
+    }
+  }
+
+  public static void main(String[] args) {
+    expect(staticInt() == 7);
+
+    Accessors a = new Accessors();
+
+    a.byteValue((byte) -42);
+    expect(a.byteValue() == -42);
+
+    a.charValue((char) 0xFFFF);
+    expect(a.charValue() == 0xFFFF);
+
+    a.shortValue((short) -4242);
+    expect(a.shortValue() == -4242);
+
+    a.intValue(0x12345678);
+    expect(a.intValue() == 0x12345678);
+
+    a.longValue(0x123456789ABCDEFL);
+    expect(a.longValue() == 0x123456789ABCDEFL);
+
+    a.floatValue(42.5f);
+    expect(a.floatValue() == 42.5f);
+
+    a.doubleValue(-42.25d);
+    expect(a.doubleValue() == -42.25d);
+
+    Object o = new Object();
+    a.objectValue(o);
+    expect(a.objectValue() == o);
+
+    Point p = new Point();
+    p.x(42);
+    expect(p.x() == 42);
+
+    Base b = new Derived();
+    b.y = 42;
+    expect(b.y() == 42);
+    expect(b.overridden() == -42);
+
+    try {
+      ((Point) null).x();
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+
+    try {
+      ((Point) null).x(42);
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+
+    try {
+      ((Accessors) null).objectValue(o);
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+  }
+}
@@ -3,7 +3,67 @@ public class Arrays {
     if (! v) throw new RuntimeException();
   }
 
+  private static int hash(int[] array) {
+    int h = 1;
+    for (int i = 0; i < array.length; ++i) h = (h * 31) + array[i];
+    return h;
+  }
+
+  private static void testBulkOperations() {
+    // lengths on both sides of the point where the work is handed to
+    // native code, and past the widths of the vector loops
+    for (int length = 0; length < 100; ++length) {
+      byte[] bytes = new byte[length];
+      char[] chars = new char[length];
+      int[] ints = new int[length];
+      int[] bytesAsInts = new int[length];
+      int[] charsAsInts = new int[length];
+      for (int i = 0; i < length; ++i) {
+        bytes[i] = (byte) ((i * 37) - 100);
+        chars[i] = (char) ((i * 4099) + 60000);
+        ints[i] = (i * 123456789) - 5;
+        bytesAsInts[i] = bytes[i];
+        charsAsInts[i] = chars[i];
+      }
+
+      expect(java.util.Arrays.hashCode(bytes) == hash(bytesAsInts));
+      expect(java.util.Arrays.hashCode(chars) == hash(charsAsInts));
+      expect(java.util.Arrays.hashCode(ints) == hash(ints));
+
+      byte[] bytes2 = (byte[]) bytes.clone();
+      char[] chars2 = (char[]) chars.clone();
+      int[] ints2 = (int[]) ints.clone();
+      expect(java.util.Arrays.equals(bytes, bytes2));
+      expect(java.util.Arrays.equals(chars, chars2));
+      expect(java.util.Arrays.equals(ints, ints2));
+
+      if (length > 0) {
+        bytes2[length - 1] ^= 1;
+        chars2[length / 2] ^= 1;
+        ints2[0] ^= 1;
+        expect(! java.util.Arrays.equals(bytes, bytes2));
+        expect(! java.util.Arrays.equals(chars, chars2));
+        expect(! java.util.Arrays.equals(ints, ints2));
+      }
+
+      java.util.Arrays.fill(bytes, (byte) -3);
+      java.util.Arrays.fill(chars, (char) 65535);
+      java.util.Arrays.fill(ints, -7);
+      for (int i = 0; i < length; ++i) {
+        expect(bytes[i] == -3);
+        expect(chars[i] == 65535);
+        expect(ints[i] == -7);
+      }
+    }
+
+    expect(java.util.Arrays.hashCode((int[]) null) == 0);
+    expect(! java.util.Arrays.equals(new int[40], null));
+    expect(! java.util.Arrays.equals(new int[40], new int[41]));
+  }
+
   public static void main(String[] args) {
+    testBulkOperations();
+
     { int[] array = new int[0];
       Exception exception = null;
       try {
@@ -72,6 +132,64 @@ public class Arrays {
       expect(array[1022] == 0);
     }
 
+    { long[] array = new long[64];
+      for (int i = 0; i < array.length; ++i) {
+        array[i] = i;
+      }
+
+      long sum = 0;
+      for (int i = 0; i < array.length; ++i) {
+        sum += array[i];
+        array[i] = array[i] * 2;
+      }
+
+      expect(sum == 63 * 32);
+      expect(array[63] == 126);
+    }
+
+    { int[] array = new int[4];
+      Exception exception = null;
+      try {
+        for (int i = 0; i < array.length; ++i) {
+          array[i + 1] = i;
+        }
+      } catch (ArrayIndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+      expect(array[3] == 2);
+    }
+
+    { double[] a = new double[4];
+      double[] b = new double[3];
+      Exception exception = null;
+      try {
+        for (int i = 0; i < a.length; ++i) {
+          b[i] = a[i];
+        }
+      } catch (ArrayIndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
+    { int[] a = new int[4];
+      int[] b = new int[2];
+      Exception exception = null;
+      int sum = 0;
+      try {
+        for (int i = 0; i < a.length; ++i) {
+          sum += (i > 1 ? b : a)[i];
+        }
+      } catch (ArrayIndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
     { Integer[] array = (Integer[])
         java.lang.reflect.Array.newInstance(Integer.class, 1);
       array[0] = Integer.valueOf(42);
@@ -94,5 +212,43 @@ public class Arrays {
       java.util.Arrays.hashCode(a);
       java.util.Arrays.hashCode((Object[])null);
     }
+
+    { int[] a = new int[] { 1, 2, 3, 4 };
+      int[] b = new int[4];
+      System.arraycopy(a, 1, b, 0, 3);
+      expect(b[0] == 2 && b[2] == 4 && b[3] == 0);
+
+      System.arraycopy(a, 0, a, 1, 3);
+      expect(a[0] == 1 && a[1] == 1 && a[3] == 3);
+
+      Object[] c = new Object[] { new Object(), new Object() };
+      Object[] d = new Object[2];
+      System.arraycopy(c, 0, d, 0, 2);
+      expect(c[0] == d[0] && c[1] == d[1]);
+
+      boolean thrown = false;
+      try {
+        System.arraycopy(a, 2, b, 0, 3);
+      } catch (IndexOutOfBoundsException e) {
+        thrown = true;
+      }
+      expect(thrown);
+
+      thrown = false;
+      try {
+        System.arraycopy(null, 0, b, 0, 1);
+      } catch (NullPointerException e) {
+        thrown = true;
+      }
+      expect(thrown);
+
+      thrown = false;
+      try {
+        System.arraycopy(a, 0, c, 0, 1);
+      } catch (ArrayStoreException e) {
+        thrown = true;
+      }
+      expect(thrown);
+    }
   }
 }
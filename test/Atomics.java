@@ -0,0 +1,143 @@
+import avian.Atomic;
+import sun.misc.Unsafe;
+
+public class Atomics {
+  private static final long ValueOffset;
+
+  static {
+    try {
+      ValueOffset = Atomic.getOffset(Atomics.class.getDeclaredField("value"));
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  private Object value;
+  private int intValue;
+  private long longValue;
+  private Object objectValue;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private boolean swap(Object old, Object new_) {
+    return Atomic.compareAndSwapObject(this, ValueOffset, old, new_);
+  }
+
+  private static void testUnsafe(Atomics a) throws Exception {
+    Unsafe u = avian.Machine.getUnsafe();
+
+    long intOffset = u.objectFieldOffset
+      (Atomics.class.getDeclaredField("intValue"));
+    long longOffset = u.objectFieldOffset
+      (Atomics.class.getDeclaredField("longValue"));
+    long objectOffset = u.objectFieldOffset
+      (Atomics.class.getDeclaredField("objectValue"));
+
+    u.putIntVolatile(a, intOffset, 0x12345678);
+    expect(a.intValue == 0x12345678);
+    expect(u.getIntVolatile(a, intOffset) == 0x12345678);
+    u.putOrderedInt(a, intOffset, -2);
+    expect(a.intValue == -2);
+    expect(u.getIntVolatile(a, intOffset) == -2);
+
+    u.putLongVolatile(a, longOffset, 0x123456789ABCDEF0L);
+    expect(a.longValue == 0x123456789ABCDEF0L);
+    expect(u.getLongVolatile(a, longOffset) == 0x123456789ABCDEF0L);
+    u.putOrderedLong(a, longOffset, -3L);
+    expect(a.longValue == -3L);
+    expect(u.getLongVolatile(a, longOffset) == -3L);
+
+    // a is tenured by now, so these stores need the write barrier to
+    // keep their values alive
+    u.putObjectVolatile
+      (a, objectOffset, new StringBuilder().append("p").toString());
+    System.gc();
+    expect(a.objectValue.equals("p"));
+    expect(u.getObjectVolatile(a, objectOffset).equals("p"));
+    u.putOrderedObject
+      (a, objectOffset, new StringBuilder().append("q").toString());
+    System.gc();
+    expect(a.objectValue.equals("q"));
+    expect(u.getObjectVolatile(a, objectOffset).equals("q"));
+
+    int[] ints = new int[3];
+    long[] longs = new long[3];
+    Object[] objects = new Object[3];
+    for (int i = 0; i < 4; ++i) {
+      System.gc();
+    }
+
+    long intElement = u.arrayBaseOffset(int[].class)
+      + u.arrayIndexScale(int[].class);
+    long longElement = u.arrayBaseOffset(long[].class)
+      + u.arrayIndexScale(long[].class);
+    long objectElement = u.arrayBaseOffset(Object[].class)
+      + u.arrayIndexScale(Object[].class);
+
+    u.putIntVolatile(ints, intElement, 0x12345678);
+    expect(ints[1] == 0x12345678);
+    expect(u.getIntVolatile(ints, intElement) == 0x12345678);
+    u.putOrderedInt(ints, intElement, -2);
+    expect(ints[1] == -2);
+    expect(u.getIntVolatile(ints, intElement) == -2);
+    expect(ints[0] == 0 && ints[2] == 0);
+
+    u.putLongVolatile(longs, longElement, 0x123456789ABCDEF0L);
+    expect(longs[1] == 0x123456789ABCDEF0L);
+    expect(u.getLongVolatile(longs, longElement) == 0x123456789ABCDEF0L);
+    u.putOrderedLong(longs, longElement, -3L);
+    expect(longs[1] == -3L);
+    expect(u.getLongVolatile(longs, longElement) == -3L);
+    expect(longs[0] == 0 && longs[2] == 0);
+
+    u.putObjectVolatile
+      (objects, objectElement, new StringBuilder().append("p").toString());
+    System.gc();
+    expect(objects[1].equals("p"));
+    expect(u.getObjectVolatile(objects, objectElement).equals("p"));
+    u.putOrderedObject
+      (objects, objectElement, new StringBuilder().append("q").toString());
+    System.gc();
+    expect(objects[1].equals("q"));
+    expect(u.getObjectVolatile(objects, objectElement).equals("q"));
+    expect(objects[0] == null && objects[2] == null);
+  }
+
+  public static void main(String[] args) throws Exception {
+    Atomics a = new Atomics();
+
+    // let the container get tenured so that the swaps below need the
+    // write barrier to keep their values alive
+    for (int i = 0; i < 4; ++i) {
+      System.gc();
+    }
+
+    expect(a.swap(null, new StringBuilder().append("x").toString()));
+    expect(a.value.equals("x"));
+
+    expect(! a.swap(null, "y"));
+    expect(a.value.equals("x"));
+
+    System.gc();
+    expect(a.value.equals("x"));
+
+    Object v = a.value;
+    Object w = new Object();
+    expect(a.swap(v, w));
+    expect(a.value == w);
+
+    int count = 0;
+    for (int i = 0; i < 1000; ++i) {
+      Object old = a.value;
+      if (a.swap(old, new Integer(i))) {
+        ++ count;
+      }
+    }
+    expect(count == 1000);
+    expect(((Integer) a.value).intValue() == 999);
+
+    testUnsafe(a);
+  }
+}
@@ -0,0 +1,120 @@
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+
+public class ClassCircularity {
+  private static final String[] names = {
+    "ClassCircularityA", "ClassCircularityB"
+  };
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static File classDirectory() {
+    String path = System.getProperty("java.class.path");
+    for (String entry: path.split(File.pathSeparator)) {
+      File file = new File(entry);
+      if (file.isDirectory()) {
+        return file;
+      }
+    }
+    throw new RuntimeException();
+  }
+
+  private static void write2(OutputStream out, int v) throws IOException {
+    out.write(v >>> 8);
+    out.write(v);
+  }
+
+  private static void write4(OutputStream out, int v) throws IOException {
+    write2(out, v >>> 16);
+    write2(out, v);
+  }
+
+  private static void writeUtf8(OutputStream out, String s)
+    throws IOException
+  {
+    byte[] bytes = s.getBytes();
+    out.write(1); // CONSTANT_Utf8
+    write2(out, bytes.length);
+    out.write(bytes);
+  }
+
+  // writes a class file for an empty public class named name which
+  // extends one named superName
+  private static void writeClass(File file, String name, String superName)
+    throws IOException
+  {
+    OutputStream out = new FileOutputStream(file);
+    try {
+      write4(out, 0xCAFEBABE);
+      write2(out, 0); // minor version
+      write2(out, 49); // major version
+
+      write2(out, 5); // constant pool count
+      writeUtf8(out, name); // #1
+      out.write(7); // #2: CONSTANT_Class #1
+      write2(out, 1);
+      writeUtf8(out, superName); // #3
+      out.write(7); // #4: CONSTANT_Class #3
+      write2(out, 3);
+
+      write2(out, 0x21); // ACC_PUBLIC | ACC_SUPER
+      write2(out, 2); // this class
+      write2(out, 4); // super class
+      write2(out, 0); // interfaces
+      write2(out, 0); // fields
+      write2(out, 0); // methods
+      write2(out, 0); // attributes
+    } finally {
+      out.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    File directory = classDirectory();
+    File[] files = new File[names.length];
+    for (int i = 0; i < names.length; ++i) {
+      files[i] = new File(directory, names[i] + ".class");
+      writeClass(files[i], names[i], names[(i + 1) % names.length]);
+    }
+
+    try {
+      // each thread starts from a different end of the cycle, so
+      // whichever parses its superclass second must find the cycle
+      // rather than wait for the other thread forever
+      final Throwable[] errors = new Throwable[names.length];
+      Thread[] threads = new Thread[names.length];
+      for (int i = 0; i < threads.length; ++i) {
+        final int index = i;
+        threads[i] = new Thread() {
+            public void run() {
+              try {
+                Class.forName(names[index]);
+              } catch (Throwable e) {
+                errors[index] = e;
+              }
+            }
+          };
+        threads[i].start();
+      }
+
+      for (int i = 0; i < threads.length; ++i) {
+        threads[i].join();
+        expect(errors[i] instanceof ClassCircularityError);
+      }
+
+      // a circular hierarchy found by a single thread fails the same way
+      try {
+        Class.forName(names[0]);
+        expect(false);
+      } catch (ClassCircularityError e) { }
+    } finally {
+      for (int i = 0; i < files.length; ++i) {
+        files[i].delete();
+      }
+    }
+  }
+}
@@ -21,7 +21,12 @@ public class Datagrams {
     return true;
   }
 
-  public static void main(String[] args) throws Exception {
+  private static ByteBuffer allocate(int capacity, boolean direct) {
+    return direct
+      ? ByteBuffer.allocateDirect(capacity) : ByteBuffer.allocate(capacity);
+  }
+
+  private static void test(boolean direct) throws Exception {
     final String Hostname = "localhost";
     final int Port = 22043;
     final SocketAddress Address = new InetSocketAddress(Hostname, Port);
@@ -46,27 +51,33 @@ public class Datagrams {
             (selector, SelectionKey.OP_READ, null);
 
           int state = 0;
-          ByteBuffer inBuffer = ByteBuffer.allocate(Message.length);
+          ByteBuffer inBuffer = allocate(Message.length, direct);
           loop: while (true) {
             selector.select();
 
             switch (state) {
             case 0: {
               if (outKey.isWritable()) {
-                out.write(ByteBuffer.wrap(Message));
+                ByteBuffer outBuffer = allocate(Message.length, direct);
+                outBuffer.put(Message);
+                outBuffer.flip();
+                out.write(outBuffer);
+                expect(! outBuffer.hasRemaining());
+                outKey.interestOps(0);
                 state = 1;
               }
             } break;
 
             case 1: {
+              expect(! outKey.isWritable());
+
               if (inKey.isReadable()) {
                 in.receive(inBuffer);
                 if (! inBuffer.hasRemaining()) {
-                  expect(equal(inBuffer.array(),
-                               inBuffer.arrayOffset(),
-                               Message,
-                               0,
-                               Message.length));
+                  byte[] received = new byte[Message.length];
+                  inBuffer.flip();
+                  inBuffer.get(received);
+                  expect(equal(received, 0, Message, 0, Message.length));
                   break loop;
                 }
               }
@@ -85,4 +96,70 @@ public class Datagrams {
       out.close();
     }
   }
+
+  private static void testBatch() throws Exception {
+    final SocketAddress Address = new InetSocketAddress("localhost", 22044);
+    final int Count = 8;
+
+    DatagramChannel in = DatagramChannel.open();
+    try {
+      in.socket().bind(Address);
+
+      DatagramChannel out = DatagramChannel.open();
+      try {
+        out.connect(Address);
+
+        ByteBuffer[] outBuffers = new ByteBuffer[Count];
+        for (int i = 0; i < Count; ++i) {
+          outBuffers[i] = allocate(i + 1, i % 2 == 0);
+          for (int j = 0; j <= i; ++j) {
+            outBuffers[i].put((byte) (i * 16 + j));
+          }
+          outBuffers[i].flip();
+        }
+
+        int sent = 0;
+        while (sent < Count) {
+          sent += out.write(outBuffers, sent, Count - sent);
+        }
+
+        for (int i = 0; i < Count; ++i) {
+          expect(! outBuffers[i].hasRemaining());
+        }
+      } finally {
+        out.close();
+      }
+
+      ByteBuffer[] inBuffers = new ByteBuffer[Count];
+      for (int i = 0; i < Count; ++i) {
+        inBuffers[i] = allocate(Count, i % 3 == 0);
+      }
+
+      SocketAddress[] senders = new SocketAddress[Count];
+      int received = 0;
+      while (received < Count) {
+        SocketAddress[] addresses = new SocketAddress[Count];
+        int c = in.receive(inBuffers, received, Count - received, addresses);
+        expect(c > 0);
+        System.arraycopy(addresses, 0, senders, received, c);
+        received += c;
+      }
+
+      for (int i = 0; i < Count; ++i) {
+        expect(senders[i] != null);
+        expect(inBuffers[i].position() == i + 1);
+        for (int j = 0; j <= i; ++j) {
+          expect(inBuffers[i].get(j) == (byte) (i * 16 + j));
+        }
+      }
+    } finally {
+      in.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    test(false);
+    test(true);
+    testBatch();
+  }
 }
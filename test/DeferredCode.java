@@ -0,0 +1,42 @@
+public class DeferredCode {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Unused {
+    // never called, so never parsed
+    public int a() { return 1; }
+    public int b() { return 2; }
+    public int c() { return 3; }
+  }
+
+  private static class Finalizable {
+    protected void finalize() {
+      // not empty
+      expect(true);
+    }
+  }
+
+  private static int handler(int[] array) {
+    try {
+      return array[4];
+    } catch (ArrayIndexOutOfBoundsException e) {
+      return -1;
+    }
+  }
+
+  private static StackTraceElement where() {
+    return new Throwable().getStackTrace()[0];
+  }
+
+  public static void main(String[] args) {
+    expect(handler(new int[5]) == 0);
+    expect(handler(new int[1]) == -1);
+
+    // the line number table is parsed along with the code
+    expect(where().getLineNumber() > 0);
+
+    expect(new Unused() != null);
+    expect(new Finalizable() != null);
+  }
+}
@@ -0,0 +1,96 @@
+public class Devirtualization {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static Object load(String name) {
+    try {
+      return Class.forName("Devirtualization$" + name).newInstance();
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  public static class Base {
+    public int value() { return 1; }
+  }
+
+  // only loaded by testOverrideLoadedLater, after call(Base) has run
+  public static class Derived extends Base {
+    public int value() { return 2; }
+  }
+
+  public static class Outer {
+    public int value() {
+      load("Inner");
+      return 1;
+    }
+  }
+
+  public static class Inner extends Outer {
+    public int value() { return 2; }
+  }
+
+  public static class Lonely {
+    public int value() { return 3; }
+  }
+
+  private static int call(Base b) {
+    return b.value();
+  }
+
+  private static int call(Outer o) {
+    return o.value();
+  }
+
+  private static int call(Lonely l) {
+    return l.value();
+  }
+
+  private static void testOverrideLoadedLater() {
+    Base b = new Base();
+    for (int i = 0; i < 100; ++i) {
+      expect(call(b) == 1);
+    }
+
+    Base d = (Base) load("Derived");
+    expect(call(d) == 2);
+    expect(call(b) == 1);
+  }
+
+  private static void testOverrideLoadedByTarget() {
+    // the override is loaded while the only frame of Outer.value is
+    // still active
+    Outer o = new Outer();
+    expect(call(o) == 1);
+
+    Outer i = (Outer) load("Inner");
+    expect(call(i) == 2);
+    expect(call(o) == 1);
+  }
+
+  private static void testNullReceiver() {
+    expect(call(new Lonely()) == 3);
+
+    try {
+      call((Lonely) null);
+      throw new RuntimeException();
+    } catch (NullPointerException e) {
+      // expected
+    }
+
+    Lonely l = null;
+    try {
+      l.value();
+      throw new RuntimeException();
+    } catch (NullPointerException e) {
+      // expected
+    }
+  }
+
+  public static void main(String[] args) {
+    testOverrideLoadedLater();
+    testOverrideLoadedByTarget();
+    testNullReceiver();
+  }
+}
@@ -0,0 +1,48 @@
+public class ExceptionHandlers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void fail(int kind) throws Exception {
+    switch (kind) {
+    case 0: throw new IllegalArgumentException();
+    case 1: throw new IllegalStateException();
+    case 2: throw new Exception();
+    default: throw new Error();
+    }
+  }
+
+  private static int classify(int kind) throws Exception {
+    try {
+      fail(kind);
+      return -1;
+    } catch (IllegalArgumentException e) {
+      return 0;
+    } catch (RuntimeException e) {
+      return 1;
+    }
+  }
+
+  private static int outer(int kind) {
+    try {
+      return classify(kind);
+    } catch (Exception e) {
+      return 2;
+    } catch (Error e) {
+      return 3;
+    }
+  }
+
+  public static void main(String[] args) {
+    // the same throw sites see several exception classes, so a stale
+    // cached handler for one would be picked for another
+    for (int i = 0; i < 1000; ++i) {
+      int kind = i % 4;
+      expect(outer(kind) == kind);
+
+      if (i % 250 == 0) {
+        System.gc();
+      }
+    }
+  }
+}
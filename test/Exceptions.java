@@ -1,4 +1,7 @@
 public class Exceptions {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
 
   private static void evenMoreDangerous() {
     throw new RuntimeException("chaos! panic! overwhelming anxiety!");
@@ -12,12 +15,32 @@ public class Exceptions {
     moreDangerous();
   }
 
+  private static void recurse(int depth) {
+    if (depth == 0) {
+      throw new RuntimeException();
+    } else {
+      recurse(depth - 1);
+    }
+  }
+
   public static void main(String[] args) {
     try {
       dangerous();
     } catch (Exception e) {
       e.printStackTrace();
     }
+
+    for (int i = 0; i < 100; ++i) {
+      try {
+        recurse(64);
+      } catch (RuntimeException e) {
+        if (i == 99) {
+          StackTraceElement[] trace = e.getStackTrace();
+          expect(trace.length > 64);
+          expect(trace[0].getMethodName().equals("recurse"));
+        }
+      }
+    }
   }
 
 }
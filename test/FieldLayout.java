@@ -0,0 +1,80 @@
+public class FieldLayout {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Base {
+    public byte a;
+    public Object b;
+    public short c;
+    public long d;
+    public boolean e;
+  }
+
+  private static class Derived extends Base {
+    public char f;
+    public double g;
+    public Object h;
+    public int i;
+    public byte j;
+    public Object k;
+    public float l;
+  }
+
+  private static void fill(Derived o, Object x, Object y) {
+    o.a = (byte) 0x12;
+    o.b = x;
+    o.c = (short) 0x3456;
+    o.d = 0x789ABCDEF0123456L;
+    o.e = true;
+    o.f = '\u4321';
+    o.g = 1.5;
+    o.h = y;
+    o.i = 0x7EADBEEF;
+    o.j = (byte) -7;
+    o.k = o;
+    o.l = 2.25f;
+  }
+
+  private static void check(Derived o, Object x, Object y) {
+    expect(o.a == (byte) 0x12);
+    expect(o.b == x);
+    expect(o.c == (short) 0x3456);
+    expect(o.d == 0x789ABCDEF0123456L);
+    expect(o.e);
+    expect(o.f == '\u4321');
+    expect(o.g == 1.5);
+    expect(o.h == y);
+    expect(o.i == 0x7EADBEEF);
+    expect(o.j == (byte) -7);
+    expect(o.k == o);
+    expect(o.l == 2.25f);
+  }
+
+  public static void main(String[] args) throws Exception {
+    Object x = new Object();
+    Object y = "y";
+
+    Derived[] array = new Derived[64];
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = new Derived();
+      fill(array[i], x, y);
+    }
+
+    System.gc();
+
+    for (int i = 0; i < array.length; ++i) {
+      check(array[i], x, y);
+    }
+
+    Derived o = array[0];
+    expect(((Long) Base.class.getField("d").get(o)).longValue()
+           == 0x789ABCDEF0123456L);
+    expect(Derived.class.getField("h").get(o) == y);
+
+    Derived.class.getField("i").set(o, Integer.valueOf(42));
+    expect(o.i == 42);
+    expect(o.j == (byte) -7);
+    expect(o.l == 2.25f);
+  }
+}
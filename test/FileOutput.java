@@ -37,11 +37,101 @@ public class FileOutput {
     }
   }
 
+  private static void testPositionalAndVectored() throws IOException {
+    try {
+      FileOutputStream out = new FileOutputStream("test.txt");
+      out.write(new byte[][] { "Hello".getBytes(), new byte[0],
+                               " world!".getBytes() }, 0, 3);
+      out.write(0, "J".getBytes(), 0, 1);
+      out.write("!".getBytes());
+      out.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      byte[] b = new byte[5];
+      expect(in.read(6, b, 0, 5) == 5);
+      expect("world".equals(new String(b)));
+
+      byte[] first = new byte[4];
+      byte[] second = new byte[32];
+      long c = in.read(new byte[][] { first, second }, 0, 2);
+      expect(c == 13);
+      expect("Jell".equals(new String(first)));
+      expect("o world!!".equals(new String(second, 0, (int) c - 4)));
+      expect(in.read(new byte[][] { first }, 0, 1) == -1);
+      in.close();
+    } finally {
+      expect(new File("test.txt").delete());
+    }
+  }
+
+  private static void expectOutOfBounds(FileInputStream in, byte[] b,
+                                        int offset, int length)
+    throws IOException
+  {
+    try {
+      in.read(b, offset, length);
+      throw new RuntimeException();
+    } catch (IndexOutOfBoundsException e) { }
+
+    try {
+      in.read(0, b, offset, length);
+      throw new RuntimeException();
+    } catch (IndexOutOfBoundsException e) { }
+  }
+
+  private static void expectOutOfBounds(FileOutputStream out, byte[] b,
+                                        int offset, int length)
+    throws IOException
+  {
+    try {
+      out.write(b, offset, length);
+      throw new RuntimeException();
+    } catch (IndexOutOfBoundsException e) { }
+
+    try {
+      out.write(0, b, offset, length);
+      throw new RuntimeException();
+    } catch (IndexOutOfBoundsException e) { }
+  }
+
+  private static void testBadRanges() throws IOException {
+    try {
+      FileOutputStream out = new FileOutputStream("test.txt");
+      byte[] b = new byte[16];
+      out.write(b);
+
+      expectOutOfBounds(out, b, 0, -1);
+      expectOutOfBounds(out, b, -1, 1);
+      expectOutOfBounds(out, b, 1, 16);
+      expectOutOfBounds(out, b, 8, Integer.MAX_VALUE);
+      out.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      expectOutOfBounds(in, b, 0, -1);
+      expectOutOfBounds(in, b, -1, 1);
+      expectOutOfBounds(in, b, 1, 16);
+      expectOutOfBounds(in, b, 8, Integer.MAX_VALUE);
+
+      try {
+        in.read(new byte[][] { b }, 1, Integer.MAX_VALUE);
+        throw new RuntimeException();
+      } catch (IndexOutOfBoundsException e) { }
+
+      in.close();
+    } finally {
+      expect(new File("test.txt").delete());
+    }
+  }
+
   public static void main(String[] args) throws IOException {
     expect(new File("nonexistent-file").length() == 0);
 
     test(false);
     test(true);
+
+    testPositionalAndVectored();
+
+    testBadRanges();
   }
 
 }
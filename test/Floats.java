@@ -329,5 +329,78 @@ public class Floats {
 
     { float v = Float.POSITIVE_INFINITY;
       expect(Long.MAX_VALUE == (long) v); }
+
+    { double[] values = { -0.9d, 2147483647.5d, -2147483648.5d, 1e10d,
+                          -1e19d, Double.NaN };
+      int[] ints = { 0, Integer.MAX_VALUE, Integer.MIN_VALUE,
+                     Integer.MAX_VALUE, Integer.MIN_VALUE, 0 };
+      long[] longs = { 0, 2147483647L, -2147483648L, 10000000000L,
+                       Long.MIN_VALUE, 0 };
+      for (int i = 0; i < values.length; ++i) {
+        expect((int) values[i] == ints[i]);
+        expect((long) values[i] == longs[i]);
+        expect((int) (float) values[i] == ints[i]);
+      } }
+
+    { double v = -42.25d;
+      expect(Math.abs(v) == 42.25d);
+      expect(Math.abs(-0.0d) == 0.0d);
+      expect(Double.doubleToRawLongBits(Math.abs(-0.0d)) == 0);
+      expect(Double.isNaN(Math.abs(Double.NaN))); }
+
+    { float v = -42.5f;
+      expect(Float.floatToRawIntBits(v) == 0xC22A0000);
+      expect(Float.intBitsToFloat(0xC22A0000) == v);
+      expect(Float.intBitsToFloat(Float.floatToRawIntBits(v) + 1) != v); }
+
+    { double v = -42.25d;
+      expect(Double.doubleToRawLongBits(v) == 0xC045200000000000L);
+      expect(Double.longBitsToDouble(0xC045200000000000L) == v);
+      expect(Double.longBitsToDouble(Double.doubleToRawLongBits(v) + 1)
+             != v); }
+
+    { double[] values = { -2.5d, -1.0d, -0.5d, 0.5d, 1.0d, 2.5d };
+      double[] floors = { -3.0d, -1.0d, -1.0d, 0.0d, 1.0d, 2.0d };
+      double[] ceils = { -2.0d, -1.0d, -0.0d, 1.0d, 1.0d, 3.0d };
+      for (int i = 0; i < values.length; ++i) {
+        expect(Math.floor(values[i]) == floors[i]);
+        expect(Math.ceil(values[i]) == ceils[i]);
+      }
+      expect(Double.isNaN(Math.floor(Double.NaN)));
+      expect(Math.ceil(Double.POSITIVE_INFINITY) == Double.POSITIVE_INFINITY);
+    }
+
+    { // ties round to the even neighbour
+      double[] values = { 0.5d, 1.5d, 2.5d, 3.5d, -0.5d, -1.5d, -2.5d,
+                          0.4d, 0.6d, -1.4d, -1.6d };
+      double[] rints = { 0.0d, 2.0d, 2.0d, 4.0d, -0.0d, -2.0d, -2.0d,
+                         0.0d, 1.0d, -1.0d, -2.0d };
+      for (int i = 0; i < values.length; ++i) {
+        expect(Math.rint(values[i]) == rints[i]);
+      }
+
+      // 2^52 - 0.5 is the largest tie; above 2^52 every value is an
+      // integer already
+      double twoToThe52 = 4503599627370496.0d;
+      expect(Math.rint(twoToThe52 - 0.5d) == twoToThe52);
+      expect(Math.rint(-(twoToThe52 - 0.5d)) == -twoToThe52);
+      expect(Math.rint(twoToThe52 - 1.5d) == twoToThe52 - 2.0d);
+      expect(Math.rint(twoToThe52 + 1.0d) == twoToThe52 + 1.0d);
+      expect(Math.rint(-(twoToThe52 + 1.0d)) == -(twoToThe52 + 1.0d));
+      expect(Math.rint(1e300d) == 1e300d);
+      expect(Math.rint(Double.NEGATIVE_INFINITY) == Double.NEGATIVE_INFINITY);
+      expect(Double.isNaN(Math.rint(Double.NaN)));
+    }
+
+    { // results of zero keep the sign of the argument
+      expect(1 / Math.rint(-0.4d) == Double.NEGATIVE_INFINITY);
+      expect(1 / Math.rint(-0.5d) == Double.NEGATIVE_INFINITY);
+      expect(1 / Math.rint(-0.0d) == Double.NEGATIVE_INFINITY);
+      expect(1 / Math.rint(0.4d) == Double.POSITIVE_INFINITY);
+      expect(1 / Math.floor(-0.0d) == Double.NEGATIVE_INFINITY);
+      expect(1 / Math.floor(0.0d) == Double.POSITIVE_INFINITY);
+      expect(1 / Math.ceil(-0.5d) == Double.NEGATIVE_INFINITY);
+      expect(1 / Math.ceil(-0.0d) == Double.NEGATIVE_INFINITY);
+    }
   }
 }
@@ -0,0 +1,72 @@
+public class IdentityHashes {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static Object[] allocate(int count) {
+    Object[] array = new Object[count];
+    for (int i = 0; i < count; ++i) {
+      array[i] = new Object();
+    }
+    return array;
+  }
+
+  private static int[] hash(Object[] array) {
+    int[] hashes = new int[array.length];
+    for (int i = 0; i < array.length; ++i) {
+      hashes[i] = System.identityHashCode(array[i]);
+    }
+    return hashes;
+  }
+
+  private static void check(Object[] array, int[] hashes) {
+    for (int i = 0; i < array.length; ++i) {
+      expect(System.identityHashCode(array[i]) == hashes[i]);
+    }
+  }
+
+  public static void main(String[] args) {
+    Object[] hashed = allocate(10000);
+    int[] hashes = hash(hashed);
+
+    // hashed objects should keep their hashes however many times they
+    // are moved, whichever generation they end up in
+    for (int i = 0; i < 8; ++i) {
+      allocate(100000);
+      System.gc();
+      check(hashed, hashes);
+    }
+
+    // and hashes taken after those objects moved should be unaffected
+    // by hashed objects dying around them
+    Object[] more = allocate(10000);
+    int[] moreHashes = hash(more);
+    for (int i = 0; i < hashed.length; i += 2) {
+      hashed[i] = null;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+      allocate(100000);
+      System.gc();
+      check(more, moreHashes);
+    }
+
+    for (int i = 1; i < hashed.length; i += 2) {
+      expect(System.identityHashCode(hashed[i]) == hashes[i]);
+    }
+
+    // a clone should not inherit the hash state of the original
+    int[] array = new int[4];
+    int arrayHash = System.identityHashCode(array);
+    allocate(100000);
+    System.gc();
+
+    int[] copy = (int[]) array.clone();
+    int copyHash = System.identityHashCode(copy);
+    allocate(100000);
+    System.gc();
+
+    expect(System.identityHashCode(array) == arrayHash);
+    expect(System.identityHashCode(copy) == copyHash);
+  }
+}
@@ -1,4 +1,10 @@
 public class Initializers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int valueDuringInit;
+
   private static class Static2 {
     public static String foo = "Static2.foo";
 
@@ -16,9 +22,36 @@ public class Initializers {
     }
   }
 
+  private static class Static3 {
+    public static int value = 42;
+
+    static {
+      // this runs the check in readStatic3 while Static3 is still
+      // being initialized, so the check must not be patched out yet
+      valueDuringInit = readStatic3();
+    }
+  }
+
+  private static int readStatic3() {
+    return Static3.value;
+  }
+
+  private static void writeStatic3(int v) {
+    Static3.value = v;
+  }
+
   public static void main(String[] args) {
     Object x = new Object();
     System.out.println(Static1.foo);
     x.toString();
+
+    expect(readStatic3() == 42);
+    expect(valueDuringInit == 42);
+
+    // the check in readStatic3 has been patched out by now
+    for (int i = 0; i < 100; ++i) {
+      writeStatic3(i);
+      expect(readStatic3() == i);
+    }
   }
 }
@@ -314,5 +314,24 @@ public class Integers {
 
     { int b = 0xBE; int x = 0; int y = 0xFF;
       expect(((b >>> x) & y) == 0xBE); }
+
+    { int[] values = { 0, 1, -1, 0x80000000, 0x7FFFFFFF, 0xF0F0F0F0 };
+      int[] counts = { 0, 1, 32, 1, 31, 16 };
+      for (int i = 0; i < values.length; ++i) {
+        expect(Integer.bitCount(values[i]) == counts[i]);
+      } }
+
+    expect(Integer.numberOfLeadingZeros(0) == 32);
+    expect(Integer.numberOfTrailingZeros(0) == 32);
+    expect(Integer.numberOfLeadingZeros(-1) == 0);
+    expect(Integer.numberOfTrailingZeros(-1) == 0);
+
+    for (int i = 0; i < 32; ++i) {
+      int v = 1 << i;
+      expect(Integer.numberOfLeadingZeros(v) == 31 - i);
+      expect(Integer.numberOfTrailingZeros(v) == i);
+      expect(Integer.numberOfLeadingZeros(v | 1) == 31 - i);
+      expect(Integer.numberOfTrailingZeros(v | 0x80000000) == i);
+    }
   }
 }
@@ -0,0 +1,56 @@
+public class Interning {
+  private static final int ThreadCount = 4;
+  private static final int KeyCount = 256;
+
+  private static final String[][] results = new String[ThreadCount][];
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static String[] internAll() {
+    String[] keys = new String[KeyCount];
+    for (int i = 0; i < KeyCount; ++i) {
+      keys[i] = new StringBuilder().append("key").append(i).toString()
+        .intern();
+    }
+    return keys;
+  }
+
+  public static void main(String[] args) throws Exception {
+    String a = "literal";
+    String b = new String(new char[] { 'l', 'i', 't', 'e', 'r', 'a', 'l' });
+    expect(a != b);
+    expect(a == b.intern());
+
+    String c = "\u00e9t\u00e9";
+    expect(c == new String(new char[] { '\u00e9', 't', '\u00e9' }).intern());
+
+    Thread[] threads = new Thread[ThreadCount];
+    for (int i = 0; i < ThreadCount; ++i) {
+      final int index = i;
+      threads[i] = new Thread() {
+          public void run() {
+            results[index] = internAll();
+          }
+        };
+      threads[i].start();
+    }
+
+    for (int i = 0; i < ThreadCount; ++i) {
+      threads[i].join();
+    }
+
+    for (int i = 1; i < ThreadCount; ++i) {
+      for (int j = 0; j < KeyCount; ++j) {
+        expect(results[i][j] == results[0][j]);
+      }
+    }
+
+    expect(results[0][7] == "key7");
+
+    System.gc();
+
+    expect(results[0][7] == "key7".intern());
+  }
+}
@@ -59,6 +59,37 @@ public class JNI {
 
   private static native Object testLocalRef(Object o);
 
+  private static native Object testLocalRefs(Object o, int count);
+
+  private static native long incrementElements(int[] array);
+
+  private static void testArrayElements(int length) {
+    int[] array = new int[length];
+    long sum = 0;
+    for (int i = 0; i < length; ++i) {
+      array[i] = i;
+      sum += i;
+    }
+
+    expect(incrementElements(array) == sum);
+
+    for (int i = 0; i < length; ++i) {
+      expect(array[i] == i + 1);
+    }
+  }
+
+  // critical natives, called without a JNIEnv or class argument:
+
+  private static native int addInts(int a, int b);
+
+  private static native long addLongs(long a, int b, long c);
+
+  private static native int addFiveInts(int a, int b, int c, int d, int e);
+
+  private static native double scale(double a, float b);
+
+  private static native boolean isNegative(long a);
+
   public static int method242() { return 242; }
   
   public static final int field950 = 950;
@@ -111,6 +142,20 @@ public class JNI {
 
     { Object o = new Object();
       expect(testLocalRef(o) == o);
+      expect(testLocalRefs(o, 1000) == o);
+    }
+
+    // small arrays are copied, while large ones are fixed in place
+    testArrayElements(16);
+    testArrayElements(256 * 1024);
+
+    for (int i = 0; i < 2; ++i) {
+      expect(addInts(-2, 44) == 42);
+      expect(addLongs(1L << 40, -1, 1L << 41) == (3L << 40) - 1);
+      expect(addFiveInts(1, 2, 3, 4, 5) == 15);
+      expect(scale(21.0d, 2.0f) == 42.0d);
+      expect(isNegative(-1L));
+      expect(! isNegative(1L << 40));
     }
   }
 }
@@ -389,6 +389,23 @@ public class Longs {
     { long b = 0xFFFFFFFFFFFFFFFFL; int s = 20;
       expect((b >>> -s) == 0xFFFFF);
     }
+
+    expect(Long.bitCount(0) == 0);
+    expect(Long.bitCount(-1) == 64);
+    expect(Long.bitCount(0xF0F0F0F0F0F0F0F0L) == 32);
+    expect(Long.numberOfLeadingZeros(0) == 64);
+    expect(Long.numberOfTrailingZeros(0) == 64);
+    expect(Long.numberOfLeadingZeros(-1) == 0);
+    expect(Long.numberOfTrailingZeros(-1) == 0);
+
+    for (int i = 0; i < 64; ++i) {
+      long v = 1L << i;
+      expect(Long.bitCount(v) == 1);
+      expect(Long.numberOfLeadingZeros(v) == 63 - i);
+      expect(Long.numberOfTrailingZeros(v) == i);
+      expect(Long.numberOfLeadingZeros(v | 1) == 63 - i);
+      expect(Long.numberOfTrailingZeros(v | 0x8000000000000000L) == i);
+    }
   }
 
 }
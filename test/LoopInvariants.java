@@ -0,0 +1,98 @@
+public class LoopInvariants {
+  private int[] array;
+  private long scale;
+  private double offset;
+  private int count;
+  private volatile int limit;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private long sum() {
+    long sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i] * scale;
+    }
+    return sum;
+  }
+
+  private double fill() {
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = i;
+    }
+    double total = 0;
+    for (int i = 0; i < array.length; ++i) {
+      total += array[i] + offset;
+    }
+    return total;
+  }
+
+  private int written() {
+    int sum = 0;
+    for (int i = 0; i < 4; ++i) {
+      sum += count;
+      count = count + 1;
+    }
+    return sum;
+  }
+
+  private int overrun() {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i + 1];
+    }
+    return sum;
+  }
+
+  private int limited() {
+    int sum = 0;
+    for (int i = 0; i < limit; ++i) {
+      sum += count;
+    }
+    return sum;
+  }
+
+  private int nested() {
+    int sum = 0;
+    for (int i = 0; i < count; ++i) {
+      for (int j = 0; j < array.length; ++j) {
+        sum += array[j];
+      }
+    }
+    return sum;
+  }
+
+  public static void main(String[] args) {
+    LoopInvariants l = new LoopInvariants();
+
+    l.array = new int[] { 1, 2, 3, 4 };
+    l.scale = 3;
+    expect(l.sum() == 30);
+
+    l.offset = 0.5;
+    expect(l.fill() == 8);
+    expect(l.array[3] == 3);
+
+    l.count = 1;
+    expect(l.written() == 1 + 2 + 3 + 4);
+    expect(l.count == 5);
+
+    l.count = 2;
+    expect(l.nested() == 12);
+
+    l.limit = 3;
+    expect(l.limited() == 15);
+
+    try {
+      l.overrun();
+      throw new RuntimeException();
+    } catch (ArrayIndexOutOfBoundsException e) { }
+
+    l.array = null;
+    try {
+      l.sum();
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+  }
+}
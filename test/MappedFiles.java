@@ -0,0 +1,86 @@
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+
+public class MappedFiles {
+  private static final String Message = "Hello, mapped world!";
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static String read(ByteBuffer b) {
+    byte[] bytes = new byte[b.remaining()];
+    b.get(bytes);
+    return new String(bytes);
+  }
+
+  private static String readFile(String path) throws IOException {
+    FileInputStream in = new FileInputStream(path);
+    try {
+      byte[] buffer = new byte[256];
+      int offset = 0;
+      int c;
+      while ((c = in.read(buffer, offset, buffer.length - offset)) > 0) {
+        offset += c;
+      }
+      return new String(buffer, 0, offset);
+    } finally {
+      in.close();
+    }
+  }
+
+  public static void main(String[] args) throws IOException {
+    try {
+      FileOutputStream out = new FileOutputStream("test.txt");
+      out.write(Message.getBytes());
+      out.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      FileChannel channel = in.getChannel();
+      expect(channel.size() == Message.length());
+
+      MappedByteBuffer b = channel.map
+        (FileChannel.MapMode.READ_ONLY, 7, 6);
+      expect(b.isDirect());
+      expect(b.remaining() == 6);
+      expect(b.get(0) == 'm');
+
+      ByteBuffer slice = b.slice();
+      expect("mapped".equals(read(b)));
+      expect("mapped".equals(read(slice)));
+
+      MappedByteBuffer copy = channel.map
+        (FileChannel.MapMode.PRIVATE, 0, Message.length());
+      copy.put(0, (byte) 'J');
+      expect(copy.get(0) == 'J');
+
+      expect(channel.map(FileChannel.MapMode.READ_ONLY, 0, 0).remaining()
+             == 0);
+
+      FileOutputStream target = new FileOutputStream("test2.txt");
+      FileChannel targetChannel = target.getChannel();
+      long position = 0;
+      while (position < Message.length()) {
+        position += channel.transferTo
+          (position, Message.length() - position, targetChannel);
+      }
+      expect(channel.transferTo(position, 1, targetChannel) == 0);
+      targetChannel.close();
+
+      channel.close();
+      expect(! channel.isOpen());
+
+      // the private mapping must not have changed the file
+      expect(Message.equals(readFile("test.txt")));
+      expect(Message.equals(readFile("test2.txt")));
+    } finally {
+      new File("test2.txt").delete();
+      expect(new File("test.txt").delete());
+    }
+  }
+}
@@ -19,6 +19,40 @@ public class Misc {
     }
   }
 
+  private static class Bar1 implements Bar {
+    public int baz() {
+      return 1;
+    }
+  }
+
+  private static class Bar2 implements Bar {
+    public int baz() {
+      return 2;
+    }
+  }
+
+  private static class Bar3 extends Bar2 {
+    public int baz() {
+      return 3;
+    }
+  }
+
+  private static class Bar4 extends Bar3 { }
+
+  private static class Bar5 implements Bar {
+    public int baz() {
+      return 5;
+    }
+  }
+
+  private static int sumBaz(Bar[] bars) {
+    int sum = 0;
+    for (int i = 0; i < bars.length; ++i) {
+      sum += bars[i].baz();
+    }
+    return sum;
+  }
+
   private static int alpha;
   private static int beta;
   private static byte byte1, byte2, byte3;
@@ -137,6 +171,19 @@ public class Misc {
     Bim bim = new Baz();
     expect(bim.baz() == 42);
 
+    { Bar[] bars = new Bar[] { new Bar1(), new Bar1(), new Baz() };
+      for (int i = 0; i < 3; ++i) {
+        expect(sumBaz(bars) == 44);
+      }
+
+      // more receiver classes than an inline cache holds:
+      bars = new Bar[] { new Bar1(), new Bar2(), new Bar3(), new Bar4(),
+                         new Bar5(), new Baz(), new Bar1() };
+      for (int i = 0; i < 3; ++i) {
+        expect(sumBaz(bars) == 57);
+      }
+    }
+
     expect(queryDefault(new Object()) != null);
 
     { Foo foo = new Foo();
@@ -0,0 +1,37 @@
+import java.lang.ref.Reference;
+import java.lang.ref.WeakReference;
+
+public class Monitors {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void lock(Object o) {
+    synchronized (o) {
+      o.notifyAll();
+    }
+  }
+
+  private static Reference lockedReference() {
+    Object o = new Object();
+    lock(o);
+    return new WeakReference(o);
+  }
+
+  public static void main(String[] args) {
+    // the last object a thread locked must not be kept alive by the
+    // thread's monitor cache
+    Reference r = lockedReference();
+    System.gc();
+    expect(r.get() == null);
+
+    // a cached object which survives a collection must still find its
+    // monitor afterwards
+    Object o = new Object();
+    lock(o);
+    System.gc();
+    lock(o);
+    System.gc();
+    lock(o);
+  }
+}
@@ -0,0 +1,61 @@
+public class NullStores {
+  private static Object staticValue;
+
+  private Object value;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private void clear() {
+    value = null;
+  }
+
+  private static void clearStatic() {
+    staticValue = null;
+  }
+
+  private static void clear(Object[] array, int index) {
+    array[index] = null;
+  }
+
+  private static Object select(boolean flag, Object o) {
+    NullStores s = new NullStores();
+    s.value = flag ? null : o;
+    return s.value;
+  }
+
+  public static void main(String[] args) {
+    Object o = new Object();
+
+    NullStores s = new NullStores();
+    s.value = o;
+    s.clear();
+    expect(s.value == null);
+
+    staticValue = o;
+    clearStatic();
+    expect(staticValue == null);
+
+    Object[] array = new Object[] { o, o };
+    clear(array, 1);
+    expect(array[0] == o);
+    expect(array[1] == null);
+
+    expect(select(true, o) == null);
+    expect(select(false, o) == o);
+
+    try {
+      clear(array, 2);
+      throw new RuntimeException();
+    } catch (ArrayIndexOutOfBoundsException e) { }
+
+    try {
+      ((NullStores) null).clear();
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+
+    System.gc();
+    expect(array[0] == o);
+  }
+}
@@ -0,0 +1,60 @@
+public class ParallelClassLoading {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class A { }
+  private static class B extends A { }
+  private static class C extends B { }
+  private static class D extends A { }
+  private static class E extends D { }
+
+  private static final String[] names = {
+    "ParallelClassLoading$C",
+    "ParallelClassLoading$E",
+    "ParallelClassLoading$B",
+    "ParallelClassLoading$D",
+    "ParallelClassLoading$A"
+  };
+
+  public static void main(String[] args) throws Exception {
+    final Class[][] results = new Class[4][names.length];
+    final Throwable[] errors = new Throwable[results.length];
+
+    Thread[] threads = new Thread[results.length];
+    for (int i = 0; i < threads.length; ++i) {
+      final int index = i;
+      threads[i] = new Thread() {
+          public void run() {
+            try {
+              // start each thread at a different class so that they
+              // race to load the same ones
+              for (int j = 0; j < names.length; ++j) {
+                int k = (index + j) % names.length;
+                results[index][k] = Class.forName(names[k]);
+              }
+            } catch (Throwable e) {
+              errors[index] = e;
+            }
+          }
+        };
+      threads[i].start();
+    }
+
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+      expect(errors[i] == null);
+    }
+
+    // every thread must see the same class for each name
+    for (int i = 0; i < results.length; ++i) {
+      for (int j = 0; j < names.length; ++j) {
+        expect(results[i][j] == results[0][j]);
+      }
+    }
+
+    expect(results[0][0].getSuperclass() == results[0][2]);
+    expect(results[0][2].getSuperclass() == results[0][4]);
+    expect(new C() instanceof A);
+  }
+}
@@ -0,0 +1,89 @@
+public class Quickening {
+  private byte b;
+  private char c;
+  private short s;
+  private int i;
+  private float f;
+  private long l;
+  private double d;
+  private Object o;
+  private volatile long v;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Base {
+    public int value() {
+      return 1;
+    }
+  }
+
+  private static class Derived extends Base {
+    public int value() {
+      return 2;
+    }
+  }
+
+  private static void set(Quickening q, int n, Object o) {
+    q.b = (byte) n;
+    q.c = (char) n;
+    q.s = (short) n;
+    q.i = n;
+    q.f = n;
+    q.l = n;
+    q.d = n;
+    q.o = o;
+    q.v = n;
+  }
+
+  private static long sum(Quickening q) {
+    return q.b + q.c + q.s + q.i + (long) q.f + q.l + (long) q.d + q.v;
+  }
+
+  private static int call(Base b) {
+    return b.value();
+  }
+
+  private static String constant() {
+    return "foo";
+  }
+
+  private static int bigConstant() {
+    return 123456789;
+  }
+
+  public static void main(String[] args) {
+    Quickening q = new Quickening();
+    Object o = new Object();
+
+    // run each instruction more than once, so the later runs use the
+    // rewritten forms
+    for (int n = 1; n < 4; ++n) {
+      set(q, n, o);
+      expect(sum(q) == n * 8);
+      expect(q.o == o);
+
+      expect(call(new Base()) == 1);
+      expect(call(new Derived()) == 2);
+
+      expect(constant().equals("foo"));
+      expect(bigConstant() == 123456789);
+    }
+
+    try {
+      set(null, 0, o);
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+
+    try {
+      sum(null);
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+
+    try {
+      call(null);
+      throw new RuntimeException();
+    } catch (NullPointerException e) { }
+  }
+}
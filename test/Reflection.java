@@ -38,6 +38,80 @@ public class Reflection {
     if (! v) throw new RuntimeException();
   }
 
+  private int base = 100;
+
+  private long add(int a, long b, double c, String d) {
+    if (d == null) throw new IllegalStateException();
+    return base + a + b + (long) c + d.length();
+  }
+
+  public Object identity(Object o) {
+    return o;
+  }
+
+  private static void testRepeatedInvoke() throws Exception {
+    Method add = Reflection.class.getDeclaredMethod
+      ("add", int.class, long.class, double.class, String.class);
+    Method identity = Reflection.class.getMethod("identity", Object.class);
+    Reflection r = new Reflection();
+
+    // enough calls to switch over to a generated accessor
+    for (int i = 0; i < 64; ++i) {
+      expect(((Long) add.invoke
+              (r, i, 1L << 40, 2.5, "four")).longValue()
+             == 100 + i + (1L << 40) + 2 + 4);
+
+      expect(identity.invoke(r, r) == r);
+      expect(identity.invoke(r, (Object) null) == null);
+
+      try {
+        add.invoke(r, i, 0L, 0.0, null);
+        throw new RuntimeException();
+      } catch (java.lang.reflect.InvocationTargetException e) {
+        expect(e.getCause() instanceof IllegalStateException);
+      }
+    }
+  }
+
+  public static String cast(Object o) {
+    return (String) o;
+  }
+
+  private static void expectIllegalArgument(Method m, Object instance,
+                                            Object ... arguments)
+    throws Exception
+  {
+    try {
+      m.invoke(instance, arguments);
+      throw new RuntimeException();
+    } catch (IllegalArgumentException e) {
+      // this must not depend on whether a generated accessor or the
+      // native path made the call
+    }
+  }
+
+  private static void testBadArguments() throws Exception {
+    Method add = Reflection.class.getDeclaredMethod
+      ("add", int.class, long.class, double.class, String.class);
+    Method cast = Reflection.class.getMethod("cast", Object.class);
+    Reflection r = new Reflection();
+
+    // enough calls to switch over to a generated accessor
+    for (int i = 0; i < 64; ++i) {
+      expectIllegalArgument(add, r, "one", 0L, 0.0, "four");
+      expectIllegalArgument(add, r, null, 0L, 0.0, "four");
+      expectIllegalArgument(add, r, i, 0L, 0.0, new Object());
+
+      // a ClassCastException thrown by the method itself is wrapped
+      try {
+        cast.invoke(null, new Object());
+        throw new RuntimeException();
+      } catch (java.lang.reflect.InvocationTargetException e) {
+        expect(e.getCause() instanceof ClassCastException);
+      }
+    }
+  }
+
   public static void main(String[] args) throws Exception {
     Class system = Class.forName("java.lang.System");
     Field out = system.getDeclaredField("out");
@@ -67,5 +141,9 @@ public class Reflection {
 
     expect(7.0 == (Double) Reflection.class.getMethod
            ("doubleMethod").invoke(null));
+
+    testRepeatedInvoke();
+
+    testBadArguments();
   }
 }
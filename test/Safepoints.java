@@ -0,0 +1,44 @@
+public class Safepoints {
+  private static volatile boolean done;
+  private static volatile boolean started;
+  private static long count;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static long spin() {
+    long n = 0;
+    started = true;
+    while (! done) {
+      ++ n;
+    }
+    return n;
+  }
+
+  public static void main(String[] args) throws Exception {
+    Thread spinner = new Thread() {
+        public void run() {
+          count = spin();
+        }
+      };
+    spinner.start();
+
+    while (! started) {
+      Thread.sleep(1);
+    }
+
+    // each collection must wait for the spinning thread to reach a
+    // safepoint in its loop
+    Object o = new Object();
+    for (int i = 0; i < 4; ++i) {
+      System.gc();
+    }
+
+    done = true;
+    spinner.join();
+
+    expect(count > 0);
+    expect(o != null);
+  }
+}
@@ -0,0 +1,134 @@
+public class ScalarReplacement {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Point {
+    final int x;
+    final int y;
+
+    public Point(int x, int y) {
+      this.x = x;
+      this.y = y;
+    }
+  }
+
+  private static class Mixed {
+    final boolean z;
+    final byte b;
+    final char c;
+    final short s;
+    final float f;
+    final long l;
+    final double d;
+    final Object o;
+    int unset;
+
+    public Mixed(boolean z, byte b, char c, short s, float f, long l,
+                 double d, Object o)
+    {
+      this.z = z;
+      this.b = b;
+      this.c = c;
+      this.s = s;
+      this.f = f;
+      this.l = l;
+      this.d = d;
+      this.o = o;
+    }
+  }
+
+  private static class Holder {
+    final Object value;
+
+    public Holder(Object value) {
+      this.value = value;
+    }
+  }
+
+  private static class Pair {
+    final long first;
+    final long second;
+
+    public Pair(long first, long second) {
+      this.first = first;
+      this.second = second;
+    }
+  }
+
+  private static int points(int n) {
+    Point p = new Point(0, 1);
+    for (int i = 0; i < n; ++i) {
+      p = new Point(p.x + 1, p.y * 2);
+    }
+    return p.x + p.y;
+  }
+
+  private static void mixed() {
+    Object o = new Object();
+    Mixed m = new Mixed
+      (true, (byte) -42, (char) 0xFFFF, (short) -4242, 42.5f,
+       0x123456789ABCDEFL, -42.25d, o);
+
+    expect(m.z);
+    expect(m.b == -42);
+    expect(m.c == 0xFFFF);
+    expect(m.s == -4242);
+    expect(m.f == 42.5f);
+    expect(m.l == 0x123456789ABCDEFL);
+    expect(m.d == -42.25d);
+    expect(m.o == o);
+    expect(m.unset == 0);
+  }
+
+  private static void collect() {
+    Object o = new Object();
+    Holder h = new Holder(o);
+    System.gc();
+    expect(h.value == o);
+  }
+
+  private static int exception(int zero) {
+    Point p = new Point(1, 2);
+    try {
+      p = new Point(3, 4 / zero);
+    } catch (ArithmeticException e) {
+      return p.x;
+    }
+    return -1;
+  }
+
+  private static long branches(int n) {
+    Pair p = new Pair(1, 1);
+    for (int i = 0; i < n; ++i) {
+      if ((i & 1) == 0) {
+        p = new Pair(p.second, p.first + p.second);
+      } else {
+        p = new Pair(p.first, p.first * p.second);
+      }
+    }
+    return p.first + p.second;
+  }
+
+  private static Point escape(int x) {
+    Point p = new Point(x, x);
+    return p;
+  }
+
+  public static void main(String[] args) {
+    expect(points(10) == 10 + 1024);
+
+    mixed();
+
+    collect();
+
+    expect(exception(0) == 1);
+
+    expect(branches(0) == 2);
+    expect(branches(1) == 3);
+    expect(branches(3) == 5);
+
+    Point p = escape(42);
+    expect(p.x == 42 && p.y == 42);
+  }
+}
@@ -80,7 +80,39 @@ public class Strings {
            (prematureEOS ? "\u00ae\ufffd" : "\u00ae\uaeaf"));
   }
 
+  private static void testLongStrings() {
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0; i < 100; ++i) {
+      sb.append((char) ('a' + (i % 26)));
+    }
+    String ascii = sb.toString();
+    String wide = ascii.substring(0, 70) + "\u00e9" + ascii.substring(71);
+
+    expect(ascii.equals(new StringBuilder(ascii).toString()));
+    expect(! ascii.equals(wide));
+    expect(wide.equals(new StringBuilder(wide).toString()));
+    expect(ascii.substring(50).equals(new StringBuilder(ascii.substring(50))
+                                      .toString()));
+
+    // the first 70 characters of wide are ascii, whatever the VM
+    // stores them as
+    expect(wide.substring(0, 70).equals(ascii.substring(0, 70)));
+
+    expect(ascii.indexOf('z') == 25);
+    expect(ascii.indexOf('z', 26) == 51);
+    expect(ascii.indexOf('z', 90) == -1);
+    expect(ascii.indexOf('\u00e9') == -1);
+    expect(ascii.indexOf(0xFF00 | 'a') == -1);
+    expect(ascii.indexOf(0x10000 | 'a') == -1);
+    expect(wide.indexOf('\u00e9') == 70);
+    expect(wide.indexOf('\u00e9', 3) == 70);
+    expect(wide.indexOf('d', 60) == 81);
+    expect(ascii.substring(30).indexOf('f') == 1);
+  }
+
   public static void main(String[] args) throws Exception {
+    testLongStrings();
+
     expect(new String(new byte[] { 99, 111, 109, 46, 101, 99, 111, 118, 97,
                                    116, 101, 46, 110, 97, 116, 46, 98, 117,
                                    115, 46, 83, 121, 109, 98, 111, 108 })
@@ -90,6 +122,23 @@ public class Strings {
     expect(months.split("\u00ae").length == 3);
     expect(months.replaceAll("\u00ae", ".").equals("Jan.Feb.Mar."));
 
+    // long ASCII runs on either side of multibyte characters
+    final String mixed
+      = "abcdefghijklmnopqrstuvwxyz\u00ae0123456789abcdefghij\u20ac.";
+    expect(mixed.length() == 26 + 1 + 20 + 1 + 1);
+    expect(mixed.charAt(26) == '\u00ae');
+    expect(mixed.charAt(47) == '\u20ac');
+    expect(mixed.substring(27, 37).equals("0123456789"));
+
+    // strings built from ASCII chars may use a compact representation
+    String compact = new String(new char[] { 'a', 'b', 'c' });
+    expect(compact.equals("abc"));
+    expect(compact.hashCode() == "abc".hashCode());
+    expect(compact.intern() == "abc");
+    expect(new StringBuilder().append(compact).append('\u00e9').toString()
+           .equals("abc\u00e9"));
+    expect(new String(new char[] { '\u00ff' }).charAt(0) == '\u00ff');
+
     expect(arraysEqual
            ("xyz".split("",  0), new String[] { "", "x", "y", "z" }));
     expect(arraysEqual
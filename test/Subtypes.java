@@ -0,0 +1,64 @@
+public class Subtypes {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Shape { }
+
+  private interface Polygon extends Shape { }
+
+  private static class Base { }
+
+  private static class Square extends Base implements Polygon { }
+
+  private static class Cube extends Square { }
+
+  private static class Circle extends Base implements Shape { }
+
+  private static boolean isShape(Object o) {
+    return o instanceof Shape;
+  }
+
+  private static boolean isSquare(Object o) {
+    return o instanceof Square;
+  }
+
+  public static void main(String[] args) {
+    Object square = new Square();
+    Object cube = new Cube();
+    Object circle = new Circle();
+
+    for (int i = 0; i < 2; ++i) {
+      expect(isSquare(square));
+      expect(isSquare(cube));
+      expect(! isSquare(circle));
+      expect(! isSquare(new Object()));
+      expect(! isSquare(null));
+
+      expect(isShape(square));
+      expect(isShape(cube));
+      expect(isShape(circle));
+      expect(! isShape("foo"));
+      expect(! isShape(null));
+    }
+
+    expect(cube instanceof Polygon);
+    expect(! (circle instanceof Polygon));
+    expect(new Cube[0] instanceof Base[]);
+    expect(! (new Base[0] instanceof Square[]));
+
+    expect(Base.class.isAssignableFrom(Cube.class));
+    expect(! Cube.class.isAssignableFrom(Base.class));
+    expect(Object.class.isAssignableFrom(Circle.class));
+    expect(Shape.class.isAssignableFrom(Cube.class));
+    expect(! Polygon.class.isAssignableFrom(Circle.class));
+
+    Square s = (Square) cube;
+    expect(s == cube);
+
+    try {
+      s = (Square) circle;
+      throw new RuntimeException();
+    } catch (ClassCastException e) { }
+  }
+}
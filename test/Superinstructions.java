@@ -0,0 +1,57 @@
+public class Superinstructions {
+  private byte b = 1;
+  private short s = 2;
+  private int i = 3;
+  private long l = 4;
+  private Object o = this;
+  private volatile int v = 5;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private long fields() {
+    return b + s + i + l + v + (o == this ? 1 : 0);
+  }
+
+  private static int value(Superinstructions x) {
+    // aload_0 here loads a parameter which may be null
+    return x.i;
+  }
+
+  private static int countUp(int start, int end) {
+    int n = 0;
+    for (int i = start; i < end; i += 2) {
+      ++ n;
+    }
+    return n;
+  }
+
+  private static int countDown(int a, int b, int c, int d) {
+    int n = 0;
+    while (d >= c) {
+      -- d;
+      ++ n;
+    }
+    return n + a + b;
+  }
+
+  public static void main(String[] args) {
+    Superinstructions x = new Superinstructions();
+
+    for (int j = 0; j < 3; ++j) {
+      expect(x.fields() == 16);
+      expect(value(x) == 3);
+      expect(countUp(0, 10) == 5);
+      expect(countUp(10, 0) == 0);
+      expect(countDown(0, 0, 3, 7) == 5);
+    }
+
+    for (int j = 0; j < 2; ++j) {
+      try {
+        value(null);
+        throw new RuntimeException();
+      } catch (NullPointerException e) { }
+    }
+  }
+}
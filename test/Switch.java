@@ -43,6 +43,57 @@ public class Switch {
     }
   }
 
+  private static int compare(int k) {
+    switch (k) {
+    case -1000:
+      return 1;
+    case 3:
+      return 2;
+    case 70000:
+      return 3;
+    default:
+      return 4;
+    }
+  }
+
+  private static int dense(int k) {
+    switch (k) {
+    case -3:
+      return 1;
+    case 4:
+      return 2;
+    case 10:
+      return 3;
+    case 11:
+      return 4;
+    case 20:
+      return 5;
+    case 27:
+      return 6;
+    default:
+      return 7;
+    }
+  }
+
+  private static int sparse(int k) {
+    switch (k) {
+    case Integer.MIN_VALUE:
+      return 1;
+    case -65536:
+      return 2;
+    case -1:
+      return 3;
+    case 7:
+      return 4;
+    case 1 << 20:
+      return 5;
+    case Integer.MAX_VALUE:
+      return 6;
+    default:
+      return 7;
+    }
+  }
+
   private static void expect(boolean v) {
     if (! v) throw new RuntimeException();
   }
@@ -62,5 +113,33 @@ public class Switch {
     expect(lookup(47) == -47);
     expect(lookup(245) == 245);
     expect(lookup(246) == 91);
+    expect(lookup(-45) == 91);
+
+    expect(compare(-1000) == 1);
+    expect(compare(3) == 2);
+    expect(compare(70000) == 3);
+    expect(compare(4) == 4);
+
+    expect(dense(-3) == 1);
+    expect(dense(4) == 2);
+    expect(dense(10) == 3);
+    expect(dense(11) == 4);
+    expect(dense(20) == 5);
+    expect(dense(27) == 6);
+    expect(dense(-4) == 7);
+    expect(dense(5) == 7);
+    expect(dense(28) == 7);
+
+    expect(sparse(Integer.MIN_VALUE) == 1);
+    expect(sparse(-65536) == 2);
+    expect(sparse(-1) == 3);
+    expect(sparse(7) == 4);
+    expect(sparse(1 << 20) == 5);
+    expect(sparse(Integer.MAX_VALUE) == 6);
+    expect(sparse(0) == 7);
+    expect(sparse(Integer.MIN_VALUE + 1) == 7);
+    for (int i = -100; i < 100; ++i) {
+      expect(sparse(i) == (i == -1 ? 3 : i == 7 ? 4 : 7));
+    }
   }
 }
@@ -0,0 +1,43 @@
+public class ThreadReuse {
+  private static int count;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static synchronized void increment() {
+    ++ count;
+  }
+
+  public static void main(String[] args) throws Exception {
+    Runnable r = new Runnable() {
+        public void run() {
+          increment();
+        }
+      };
+
+    // more threads than the pool holds, started one after another so
+    // that each may reuse the OS thread of the last
+    for (int i = 0; i < 64; ++i) {
+      Thread t = new Thread(r);
+      t.start();
+      t.join();
+    }
+
+    expect(count == 64);
+
+    // and some at once
+    Thread[] threads = new Thread[16];
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i] = new Thread(r);
+      threads[i].start();
+    }
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+    }
+
+    expect(count == 64 + 16);
+
+    System.gc();
+  }
+}
@@ -0,0 +1,103 @@
+import java.nio.ByteBuffer;
+import java.util.zip.CRC32;
+import java.util.zip.Deflater;
+import java.util.zip.Inflater;
+
+public class Zlib {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static long crc(byte[] array, int offset, int length) {
+    CRC32 crc = new CRC32();
+    crc.update(array, offset, length);
+    return crc.getValue();
+  }
+
+  private static void testCRC32() {
+    byte[] check = "123456789".getBytes();
+    expect(crc(check, 0, check.length) == 0xCBF43926L);
+
+    // the byte-at-a-time, small array, and native paths must agree
+    byte[] data = new byte[4099];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) (i * 31 + (i >> 7));
+    }
+
+    for (int length = 0; length < 300; length += 13) {
+      CRC32 bytes = new CRC32();
+      for (int i = 0; i < length; ++i) {
+        bytes.update(data[3 + i]);
+      }
+      expect(bytes.getValue() == crc(data, 3, length));
+    }
+
+    CRC32 pieces = new CRC32();
+    pieces.update(data, 0, 1000);
+    pieces.update(data, 1000, 5);
+    pieces.update(data, 1005, data.length - 1005);
+    expect(pieces.getValue() == crc(data, 0, data.length));
+
+    ByteBuffer direct = ByteBuffer.allocateDirect(data.length);
+    direct.put(data);
+    direct.flip();
+    CRC32 buffer = new CRC32();
+    buffer.update(direct);
+    expect(buffer.getValue() == crc(data, 0, data.length));
+    expect(! direct.hasRemaining());
+
+    buffer.reset();
+    buffer.update(ByteBuffer.wrap(check));
+    expect(buffer.getValue() == 0xCBF43926L);
+  }
+
+  private static void testRoundTrip(boolean direct) throws Exception {
+    byte[] data = new byte[64 * 1024];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) ((i % 251) ^ (i >> 9));
+    }
+
+    ByteBuffer input = direct
+      ? ByteBuffer.allocateDirect(data.length)
+      : ByteBuffer.allocate(data.length);
+    input.put(data);
+    input.flip();
+
+    ByteBuffer compressed = direct
+      ? ByteBuffer.allocateDirect(data.length * 2)
+      : ByteBuffer.allocate(data.length * 2);
+
+    Deflater deflater = new Deflater();
+    deflater.setInput(input);
+    deflater.finish();
+    while (! deflater.finished()) {
+      deflater.deflate(compressed);
+    }
+    deflater.dispose();
+    expect(! input.hasRemaining());
+    compressed.flip();
+
+    ByteBuffer output = direct
+      ? ByteBuffer.allocateDirect(data.length)
+      : ByteBuffer.allocate(data.length);
+
+    Inflater inflater = new Inflater();
+    inflater.setInput(compressed);
+    while (! inflater.finished()) {
+      inflater.inflate(output);
+    }
+    inflater.dispose();
+    expect(! compressed.hasRemaining());
+    expect(output.position() == data.length);
+
+    for (int i = 0; i < data.length; ++i) {
+      expect(output.get(i) == data[i]);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    testCRC32();
+    testRoundTrip(false);
+    testRoundTrip(true);
+  }
+}
@@ -0,0 +1,453 @@
+package bench;
+
+import java.io.InputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.util.List;
+import java.util.ArrayList;
+
+/**
+ * A set of microbenchmarks for the VM, run by "make bench".  Each
+ * benchmark is calibrated to find an operation count which takes
+ * roughly TargetSampleNanos, warmed up, and then sampled repeatedly.
+ * Results are printed one per line as JSON objects, e.g.:
+ *
+ * <pre>
+ *   {"name":"allocation","unit":"ns/op","operations":65536,...}
+ * </pre>
+ *
+ * <p>Usage: bench.Benchmarks [-warmup n] [-iterations n] [name...]
+ */
+public class Benchmarks {
+  static {
+    System.loadLibrary("test");
+  }
+
+  private static final long TargetSampleNanos = 10 * 1000 * 1000;
+
+  private static volatile Object sink;
+
+  private static native int nop(int v);
+
+  private abstract static class Benchmark {
+    public final String name;
+
+    public Benchmark(String name) {
+      this.name = name;
+    }
+
+    public String unit() {
+      return "ns/op";
+    }
+
+    public void setUp() throws Exception { }
+
+    public void tearDown() throws Exception { }
+
+    // performs the benchmarked operation the specified number of times
+    public abstract void run(int count) throws Exception;
+
+    public int calibrate() throws Exception {
+      int count = 1;
+      while (count < (1 << 30)) {
+        long start = System.nanoTime();
+        run(count);
+        if (System.nanoTime() - start >= TargetSampleNanos) {
+          break;
+        }
+        count *= 2;
+      }
+      return count;
+    }
+
+    public double sample(int count) throws Exception {
+      long start = System.nanoTime();
+      run(count);
+      return (double) (System.nanoTime() - start) / count;
+    }
+  }
+
+  // a benchmark whose samples are pause times rather than throughput;
+  // run() is called once per sample and returns the pause it measured
+  private abstract static class PauseBenchmark extends Benchmark {
+    public PauseBenchmark(String name) {
+      super(name);
+    }
+
+    public String unit() {
+      return "ns";
+    }
+
+    public int calibrate() {
+      return 1;
+    }
+
+    public void run(int count) throws Exception {
+      for (int i = 0; i < count; ++i) {
+        pause();
+      }
+    }
+
+    public abstract long pause() throws Exception;
+
+    public double sample(int count) throws Exception {
+      return pause();
+    }
+  }
+
+  private static class Node {
+    public Node next;
+    public Object value;
+
+    public Node(Node next, Object value) {
+      this.next = next;
+      this.value = value;
+    }
+  }
+
+  private abstract static class Shape {
+    public abstract int sides();
+  }
+
+  private static class Triangle extends Shape {
+    public int sides() { return 3; }
+  }
+
+  private static class Square extends Shape {
+    public int sides() { return 4; }
+  }
+
+  private static class Hexagon extends Shape {
+    public int sides() { return 6; }
+  }
+
+  private interface Sided {
+    public int sides();
+  }
+
+  private static class Line implements Sided {
+    public int sides() { return 1; }
+  }
+
+  private static class Pentagon implements Sided {
+    public int sides() { return 5; }
+  }
+
+  private static class Octagon implements Sided {
+    public int sides() { return 8; }
+  }
+
+  private static class BenchmarkException extends Exception { }
+
+  private static void thrower(int depth) throws BenchmarkException {
+    if (depth == 0) {
+      throw new BenchmarkException();
+    } else {
+      thrower(depth - 1);
+    }
+  }
+
+  public static class Loaded {
+    public int value = 42;
+  }
+
+  private static class DefiningClassLoader extends ClassLoader {
+    public DefiningClassLoader(ClassLoader parent) {
+      super(parent);
+    }
+
+    public Class define(String name, byte[] bytes) {
+      return defineClass(name, bytes, 0, bytes.length);
+    }
+  }
+
+  private static byte[] readClass(Class c) throws IOException {
+    String name = c.getName();
+    InputStream in = c.getResourceAsStream
+      ("/" + name.replace('.', '/') + ".class");
+    if (in == null) throw new IOException("unable to find " + name);
+
+    try {
+      ByteArrayOutputStream out = new ByteArrayOutputStream();
+      byte[] buffer = new byte[4096];
+      int n;
+      while ((n = in.read(buffer)) >= 0) {
+        out.write(buffer, 0, n);
+      }
+      return out.toByteArray();
+    } finally {
+      in.close();
+    }
+  }
+
+  private static List<Benchmark> benchmarks() {
+    List<Benchmark> list = new ArrayList();
+
+    list.add(new Benchmark("allocation") {
+        public void run(int count) {
+          for (int i = 0; i < count; ++i) {
+            sink = new Node(null, null);
+          }
+        }
+      });
+
+    list.add(new PauseBenchmark("gc-minor") {
+        private static final int Allocations = 1 << 20;
+
+        private Object[] survivors;
+
+        public void setUp() {
+          survivors = new Object[4096];
+        }
+
+        public void tearDown() {
+          survivors = null;
+        }
+
+        // the longest gap between two consecutive small allocations is
+        // dominated by whichever young generation collection happened
+        // in between, since the nursery fills several times over
+        public long pause() {
+          Object[] survivors = this.survivors;
+          long max = 0;
+          long last = System.nanoTime();
+          for (int i = 0; i < Allocations; ++i) {
+            survivors[i & (survivors.length - 1)] = new Node(null, null);
+            long now = System.nanoTime();
+            if (now - last > max) {
+              max = now - last;
+            }
+            last = now;
+          }
+          return max;
+        }
+      });
+
+    list.add(new PauseBenchmark("gc-major") {
+        private Node live;
+
+        public void setUp() {
+          for (int i = 0; i < 100000; ++i) {
+            live = new Node(live, new int[4]);
+          }
+        }
+
+        public void tearDown() {
+          live = null;
+        }
+
+        public long pause() {
+          long start = System.nanoTime();
+          System.gc();
+          return System.nanoTime() - start;
+        }
+      });
+
+    list.add(new Benchmark("monitor") {
+        private final Object lock = new Object();
+        private int counter;
+
+        public void run(int count) {
+          for (int i = 0; i < count; ++i) {
+            synchronized (lock) {
+              ++ counter;
+            }
+          }
+        }
+      });
+
+    list.add(new Benchmark("dispatch-virtual") {
+        private final Shape[] shapes = new Shape[] {
+          new Triangle(), new Square(), new Hexagon()
+        };
+
+        public void run(int count) {
+          Shape[] shapes = this.shapes;
+          int sum = 0;
+          for (int i = 0; i < count; ++i) {
+            sum += shapes[i % shapes.length].sides();
+          }
+          sink = Integer.valueOf(sum);
+        }
+      });
+
+    list.add(new Benchmark("dispatch-interface") {
+        private final Sided[] shapes = new Sided[] {
+          new Line(), new Pentagon(), new Octagon()
+        };
+
+        public void run(int count) {
+          Sided[] shapes = this.shapes;
+          int sum = 0;
+          for (int i = 0; i < count; ++i) {
+            sum += shapes[i % shapes.length].sides();
+          }
+          sink = Integer.valueOf(sum);
+        }
+      });
+
+    list.add(new Benchmark("exception") {
+        public void run(int count) {
+          for (int i = 0; i < count; ++i) {
+            try {
+              thrower(4);
+            } catch (BenchmarkException e) {
+              sink = e;
+            }
+          }
+        }
+      });
+
+    list.add(new Benchmark("class-loading") {
+        private byte[] bytes;
+
+        public void setUp() throws IOException {
+          bytes = readClass(Loaded.class);
+        }
+
+        public void tearDown() {
+          bytes = null;
+        }
+
+        public void run(int count) throws Exception {
+          for (int i = 0; i < count; ++i) {
+            DefiningClassLoader loader = new DefiningClassLoader
+              (Benchmarks.class.getClassLoader());
+            sink = loader.define(Loaded.class.getName(), bytes).newInstance();
+          }
+        }
+      });
+
+    list.add(new Benchmark("string-interning") {
+        private char[][] keys;
+
+        public void setUp() {
+          keys = new char[1024][];
+          for (int i = 0; i < keys.length; ++i) {
+            keys[i] = ("key" + i).toCharArray();
+          }
+        }
+
+        public void tearDown() {
+          keys = null;
+        }
+
+        public void run(int count) {
+          char[][] keys = this.keys;
+          for (int i = 0; i < count; ++i) {
+            sink = new String(keys[i & (keys.length - 1)]).intern();
+          }
+        }
+      });
+
+    list.add(new Benchmark("jni-call") {
+        public void run(int count) {
+          int sum = 0;
+          for (int i = 0; i < count; ++i) {
+            sum += nop(i);
+          }
+          sink = Integer.valueOf(sum);
+        }
+      });
+
+    return list;
+  }
+
+  private static void sort(double[] array) {
+    for (int i = 1; i < array.length; ++i) {
+      double v = array[i];
+      int j = i - 1;
+      for (; j >= 0 && array[j] > v; --j) {
+        array[j + 1] = array[j];
+      }
+      array[j + 1] = v;
+    }
+  }
+
+  // nearest-rank percentile of a sorted array
+  private static double percentile(double[] sorted, int p) {
+    int index = ((p * sorted.length) + 99) / 100 - 1;
+    return sorted[Math.max(0, Math.min(sorted.length - 1, index))];
+  }
+
+  private static String format(double v) {
+    return String.valueOf(Math.round(v * 1000) / 1000.0);
+  }
+
+  private static void report(Benchmark b, int operations, int warmup,
+                             double[] samples)
+  {
+    double sum = 0;
+    for (double v: samples) {
+      sum += v;
+    }
+    double mean = sum / samples.length;
+
+    double squares = 0;
+    for (double v: samples) {
+      squares += (v - mean) * (v - mean);
+    }
+    double stddev = Math.sqrt(squares / samples.length);
+
+    sort(samples);
+
+    System.out.println
+      ("{\"name\":\"" + b.name + "\""
+       + ",\"unit\":\"" + b.unit() + "\""
+       + ",\"operations\":" + operations
+       + ",\"warmup\":" + warmup
+       + ",\"iterations\":" + samples.length
+       + ",\"mean\":" + format(mean)
+       + ",\"stddev\":" + format(stddev)
+       + ",\"min\":" + format(samples[0])
+       + ",\"p50\":" + format(percentile(samples, 50))
+       + ",\"p90\":" + format(percentile(samples, 90))
+       + ",\"p99\":" + format(percentile(samples, 99))
+       + ",\"max\":" + format(samples[samples.length - 1])
+       + "}");
+  }
+
+  private static void run(Benchmark b, int warmup, int iterations)
+    throws Exception
+  {
+    b.setUp();
+    try {
+      int operations = b.calibrate();
+
+      for (int i = 0; i < warmup; ++i) {
+        b.sample(operations);
+      }
+
+      double[] samples = new double[iterations];
+      for (int i = 0; i < iterations; ++i) {
+        samples[i] = b.sample(operations);
+      }
+
+      report(b, operations, warmup, samples);
+    } finally {
+      b.tearDown();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    int warmup = 5;
+    int iterations = 20;
+    List<String> names = new ArrayList();
+
+    for (int i = 0; i < args.length; ++i) {
+      if ("-warmup".equals(args[i]) && i + 1 < args.length) {
+        warmup = Integer.parseInt(args[++i]);
+      } else if ("-iterations".equals(args[i]) && i + 1 < args.length) {
+        iterations = Math.max(1, Integer.parseInt(args[++i]));
+      } else {
+        names.add(args[i]);
+      }
+    }
+
+    for (Benchmark b: benchmarks()) {
+      if (names.isEmpty() || names.contains(b.name)) {
+        run(b, warmup, iterations);
+      }
+    }
+  }
+}
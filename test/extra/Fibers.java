@@ -0,0 +1,125 @@
+package extra;
+
+import avian.Fiber;
+
+public class Fibers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Counter {
+    public int value;
+
+    public synchronized void increment() {
+      ++ value;
+    }
+  }
+
+  private static void testYield() throws Exception {
+    final Counter counter = new Counter();
+    Fiber[] fibers = new Fiber[100];
+    for (int i = 0; i < fibers.length; ++i) {
+      fibers[i] = Fiber.start(new Runnable() {
+          public void run() {
+            for (int j = 0; j < 10; ++j) {
+              counter.increment();
+              Fiber.yield();
+            }
+          }
+        });
+    }
+
+    for (Fiber f: fibers) {
+      f.join();
+      expect(! f.isAlive());
+    }
+
+    expect(counter.value == 1000);
+  }
+
+  private static void testPingPong() throws Exception {
+    final int[] values = new int[2];
+    final Fiber[] fibers = new Fiber[2];
+
+    for (int i = 0; i < 2; ++i) {
+      final int self = i;
+      Fiber f = Fiber.start(new Runnable() {
+          public void run() {
+            for (int j = 0; j < 100; ++j) {
+              // each fiber waits for the other to catch up before
+              // taking its turn
+              while (true) {
+                synchronized (values) {
+                  if (self == 0 ? values[0] == values[1]
+                      : values[1] < values[0])
+                  {
+                    break;
+                  }
+                }
+                Fiber.park();
+              }
+
+              synchronized (values) {
+                ++ values[self];
+              }
+
+              Fiber other;
+              synchronized (fibers) {
+                other = fibers[1 - self];
+              }
+              if (other != null) {
+                other.unpark();
+              }
+            }
+          }
+        });
+
+      synchronized (fibers) {
+        fibers[i] = f;
+      }
+    }
+
+    // fiber 0 may have unparked nothing if fiber 1 did not exist yet
+    fibers[0].unpark();
+    fibers[1].unpark();
+
+    fibers[0].join();
+    fibers[1].join();
+
+    expect(values[0] == 100);
+    expect(values[1] == 100);
+  }
+
+  private static void testJoinFromFiber() throws Exception {
+    final Fiber inner = Fiber.start(new Runnable() {
+        public void run() {
+          for (int i = 0; i < 10; ++i) {
+            Fiber.yield();
+          }
+        }
+      });
+
+    final boolean[] joined = new boolean[1];
+    Fiber outer = Fiber.start(new Runnable() {
+        public void run() {
+          try {
+            inner.join();
+          } catch (InterruptedException e) {
+            throw new RuntimeException(e);
+          }
+          joined[0] = ! inner.isAlive();
+        }
+      });
+
+    outer.join();
+    expect(joined[0]);
+  }
+
+  public static void main(String[] args) throws Exception {
+    expect(Fiber.current() == null);
+
+    testYield();
+    testPingPong();
+    testJoinFromFiber();
+  }
+}
@@ -107,6 +107,81 @@ Java_JNI_testLocalRef(JNIEnv* e, jclass, jobject o)
   return e->NewLocalRef(o);
 }
 
+extern "C" JNIEXPORT jobject JNICALL
+Java_JNI_testLocalRefs(JNIEnv* e, jclass, jobject o, jint count)
+{
+  if (e->PushLocalFrame(count) != 0) return 0;
+
+  jobject last = 0;
+  for (jint i = 0; i < count; ++i) {
+    jobject r = e->NewLocalRef(o);
+    if (not e->IsSameObject(r, o)) return 0;
+
+    if (i % 2) {
+      e->DeleteLocalRef(r);
+    } else {
+      last = r;
+    }
+  }
+
+  // nothing is left of an inner frame once it is popped
+  for (jint i = 0; i < count; ++i) {
+    if (e->PushLocalFrame(1) != 0) return 0;
+    e->NewLocalRef(o);
+    e->PopLocalFrame(0);
+  }
+
+  return e->PopLocalFrame(last);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_JNI_incrementElements(JNIEnv* e, jclass, jintArray array)
+{
+  jint length = e->GetArrayLength(array);
+  jint* p = e->GetIntArrayElements(array, 0);
+  if (p == 0) return -1;
+
+  jlong sum = 0;
+  for (jint i = 0; i < length; ++i) {
+    sum += p[i];
+    ++ p[i];
+  }
+
+  e->ReleaseIntArrayElements(array, p, 0);
+
+  return sum;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+JavaCritical_JNI_addInts(jint a, jint b)
+{
+  return a + b;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+JavaCritical_JNI_addLongs(jlong a, jint b, jlong c)
+{
+  return a + b + c;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+JavaCritical_JNI_addFiveInts(jint a, jint b, jint c, jint d, jint e)
+{
+  return a + b + c + d + e;
+}
+
+extern "C" JNIEXPORT jdouble JNICALL
+JavaCritical_JNI_scale(jdouble a, jfloat b)
+{
+  return a * b;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+JavaCritical_JNI_isNegative(jlong a)
+{
+  return a < 0;
+}
+
 extern "C" JNIEXPORT jobject JNICALL
 Java_Buffers_allocateNative(JNIEnv* e, jclass, jint capacity)
 {
@@ -121,3 +196,9 @@ Java_Buffers_freeNative(JNIEnv* e, jclass, jobject b)
 {
   free(e->GetDirectBufferAddress(b));
 }
+
+extern "C" JNIEXPORT jint JNICALL
+Java_bench_Benchmarks_nop(JNIEnv*, jclass, jint v)
+{
+  return v;
+}